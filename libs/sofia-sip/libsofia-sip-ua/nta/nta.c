@@ -154,6 +154,9 @@ struct nta_agent_s
   nta_error_magic_t   *sa_error_magic;
   nta_error_tport_f   *sa_error_tport;
 
+  nta_stray_magic_t   *sa_stray_magic;
+  nta_stray_f         *sa_stray;
+
   uint32_t              sa_next; /**< Timestamp for next agent_timer. */
 
   msg_mclass_t const   *sa_mclass;
@@ -3062,6 +3065,15 @@ void agent_recv_request(nta_agent_t *agent,
     leg_recv(leg, msg, sip, tport);
     return;
   }
+  else if (agent->sa_stray && tport_is_dgram(tport) &&
+	   method != sip_method_subscribe &&
+	   (sip->sip_to->a_tag || method == sip_method_cancel) &&
+	   agent->sa_stray(agent->sa_stray_magic, agent, msg, sip) == 0) {
+    /* In-dialog request for a dialog held by another agent on this port */
+    SU_DEBUG_5(("nta: %s (%u) %s\n",
+		method_name, cseq, "passed to stray callback"));
+    return;
+  }
   else if (!agent->sa_is_stateless &&
 	   (leg = dst_find(agent, url, method_name))) {
     /* Dialogless legs - let application process transactions statefully */
@@ -3384,6 +3396,14 @@ void agent_recv_response(nta_agent_t *agent,
   }
 
 
+  if (!orq && agent->sa_stray && tport_is_dgram(tport) &&
+      agent->sa_stray(agent->sa_stray_magic, agent, msg, sip) == 0) {
+    /* Response to a request sent by another agent on this port */
+    SU_DEBUG_5(("nta: %03d %s %s\n", status, phrase,
+		"passed to stray callback"));
+    return;
+  }
+
   agent->sa_stats->as_trless_response++;
 
   if ((orq = agent->sa_default_outgoing)) {
@@ -11936,6 +11956,52 @@ int nta_agent_bind_tport_error(nta_agent_t *agent,
   return 0;
 }
 
+/** Bind callback for messages matching no transaction or dialog.
+ *
+ * When several agents listen on the same port with TPTAG_REUSEPORT(), the
+ * kernel may give a datagram to an agent other than the one holding its
+ * transaction or dialog. The callback is invoked with responses matching
+ * no client transaction and with in-dialog requests matching no dialog.
+ * It returns 0 when it has taken the message, typically to hand it to
+ * nta_agent_recv_stray() of another agent, or nonzero to let the agent
+ * process it as usual.
+ */
+int nta_agent_bind_stray(nta_agent_t *agent,
+			 nta_stray_magic_t *magic,
+			 nta_stray_f *callback)
+{
+  if (!agent)
+    return su_seterrno(EFAULT), -1;
+  agent->sa_stray_magic = magic;
+  agent->sa_stray = callback;
+  return 0;
+}
+
+/** Process a message given up by another agent bound to the same port.
+ *
+ * The message is processed as if it had been received by the primary
+ * datagram transport of @a agent with the same address family. It must be
+ * called from the thread running @a agent. The message is destroyed if
+ * the agent has no such transport.
+ */
+int nta_agent_recv_stray(nta_agent_t *agent, msg_t *msg)
+{
+  su_addrinfo_t const *ai = msg_addrinfo(msg);
+  tport_t *tp;
+
+  if (!agent || !ai) {
+    msg_destroy(msg);
+    return su_seterrno(EFAULT), -1;
+  }
+
+  for (tp = tport_primaries(agent->sa_tports); tp; tp = tport_next(tp)) {
+    if (tport_is_dgram(tp) && tport_get_address(tp)->ai_family == ai->ai_family)
+      break;
+  }
+
+  return tport_redeliver(tp, msg);
+}
+
 /** Check if public transport binding is in progress */
 int nta_agent_tport_is_updating(nta_agent_t *agent)
 {
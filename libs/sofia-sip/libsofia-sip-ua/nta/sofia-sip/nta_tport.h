@@ -59,6 +59,11 @@ typedef NTA_UPDATE_MAGIC_T nta_update_magic_t;
 #endif
 typedef NTA_ERROR_MAGIC_T nta_error_magic_t;
 
+#ifndef NTA_STRAY_MAGIC_T
+#define NTA_STRAY_MAGIC_T void
+#endif
+typedef NTA_STRAY_MAGIC_T nta_stray_magic_t;
+
 struct sigcomp_compartment;
 struct sigcomp_udvm;
 
@@ -94,6 +99,15 @@ int nta_agent_bind_tport_error(nta_agent_t *agent,
 				nta_error_magic_t *magic,
 			    nta_error_tport_f *callback);
 
+typedef int nta_stray_f(nta_stray_magic_t *, nta_agent_t *, msg_t *, sip_t *);
+
+SOFIAPUBFUN
+int nta_agent_bind_stray(nta_agent_t *agent,
+			 nta_stray_magic_t *magic,
+			 nta_stray_f *callback);
+
+SOFIAPUBFUN int nta_agent_recv_stray(nta_agent_t *agent, msg_t *msg);
+
 SOFIA_END_DECLS
 
 #endif /* !defined NTA_TPORT_H */
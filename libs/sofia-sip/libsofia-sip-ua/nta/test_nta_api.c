@@ -1393,6 +1393,120 @@ static int api_test_dialog_matching(agent_t *ag)
 
 }
 
+/* Two agents on one port with SO_REUSEPORT, the dialog held by the owner */
+static struct {
+  nta_agent_t *owner;
+  int handed;			/**< Requests the sibling gave up */
+  int received;			/**< Requests reaching the owner dialog */
+} stray;
+
+static int stray_callback(nta_stray_magic_t *magic,
+			  nta_agent_t *agent,
+			  msg_t *msg,
+			  sip_t *sip)
+{
+  stray.handed++;
+  /* both agents run on one root, so the owner can take it right away */
+  nta_agent_recv_stray(stray.owner, msg);
+  return 0;
+}
+
+static int stray_leg_callback(agent_t *ag,
+			      nta_leg_t *leg,
+			      nta_incoming_t *irq,
+			      sip_t const *sip)
+{
+  stray.received++;
+  return 200;
+}
+
+static int api_test_stray(agent_t *ag)
+{
+  su_root_t *root;
+  nta_agent_t *owner, *sibling;
+  nta_leg_t *dialog;
+  sip_contact_t const *m;
+  su_sockaddr_t su[1];
+  su_socket_t s;
+  char port[16], request[1024];
+  int i, n, sent;
+
+  BEGIN();
+
+  memset(&stray, 0, sizeof stray);
+
+  TEST_1(root = su_root_create(NULL));
+
+  TEST_1(owner = nta_agent_create(root,
+				  (url_string_t *)"sip:127.0.0.1:*;transport=udp",
+				  NULL,
+				  NULL,
+				  TPTAG_REUSEPORT(1),
+				  TAG_END()));
+  TEST_1(m = nta_agent_contact(owner));
+  TEST_1(m->m_url->url_port);
+  snprintf(port, sizeof port, "%s", m->m_url->url_port);
+
+  snprintf(request, sizeof request, "sip:127.0.0.1:%s;transport=udp", port);
+  TEST_1(sibling = nta_agent_create(root,
+				    (url_string_t *)request,
+				    NULL,
+				    NULL,
+				    TPTAG_REUSEPORT(1),
+				    TAG_END()));
+  TEST(nta_agent_bind_stray(sibling, NULL, stray_callback), 0);
+  stray.owner = owner;
+
+  TEST_1(dialog = nta_leg_tcreate(owner, stray_leg_callback, ag,
+				  SIPTAG_CALL_ID_STR("stray-dialog"),
+				  /* local */
+				  SIPTAG_FROM_STR("<sip:bob@127.0.0.1>;tag=owner"),
+				  /* remote */
+				  SIPTAG_TO_STR("<sip:alice@127.0.0.1>;tag=peer"),
+				  TAG_END()));
+
+  memset(su, 0, sizeof su);
+  su->su_family = AF_INET;
+  su->su_port = htons((unsigned short)atoi(port));
+  su_inet_pton(AF_INET, "127.0.0.1", &su->su_sin.sin_addr);
+
+  /* The kernel picks the socket by source address, so keep sending from
+     fresh ones until the sibling has had to give one up */
+  for (sent = 0; sent < 64 && !stray.handed; sent++) {
+    s = su_socket(AF_INET, SOCK_DGRAM, 0); TEST_1(s != INVALID_SOCKET);
+
+    n = snprintf(request, sizeof request,
+		 "INFO sip:bob@127.0.0.1:%s SIP/2.0\r\n"
+		 "Via: SIP/2.0/UDP 127.0.0.1:9;branch=z9hG4bK.stray%u\r\n"
+		 "Max-Forwards: 70\r\n"
+		 "From: <sip:alice@127.0.0.1>;tag=peer\r\n"
+		 "To: <sip:bob@127.0.0.1>;tag=owner\r\n"
+		 "Call-ID: stray-dialog\r\n"
+		 "CSeq: %u INFO\r\n"
+		 "Content-Length: 0\r\n"
+		 "\r\n", port, sent + 1, sent + 1);
+    TEST_SIZE(su_sendto(s, request, n, 0, su, sizeof su->su_sin), n);
+
+    for (i = 0; i < 100 && stray.received == sent; i++)
+      su_root_step(root, 10);
+
+    su_close(s);
+
+    TEST(stray.received, sent + 1);
+  }
+
+  /* Every request reached the dialog, some of them through the sibling */
+  TEST_1(stray.handed > 0);
+  TEST(stray.received, sent);
+
+  TEST_VOID(nta_leg_destroy(dialog));
+  TEST_VOID(nta_agent_destroy(sibling));
+  TEST_VOID(nta_agent_destroy(owner));
+  TEST_VOID(su_root_destroy(root));
+
+  END();
+}
+
 #if HAVE_ALARM
 #include <unistd.h>
 #include <signal.h>
@@ -1506,6 +1620,7 @@ int main(int argc, char *argv[])
     retval |= api_test_params(ag); SINGLE_FAILURE_CHECK();
     retval |= api_test_stats(ag); SINGLE_FAILURE_CHECK();
     retval |= api_test_dialog_matching(ag); SINGLE_FAILURE_CHECK();
+    retval |= api_test_stray(ag); SINGLE_FAILURE_CHECK();
     retval |= api_test_tport(ag); SINGLE_FAILURE_CHECK();
     retval |= api_test_dialogs(ag); SINGLE_FAILURE_CHECK();
     retval |= api_test_default(ag); SINGLE_FAILURE_CHECK();
@@ -339,6 +339,12 @@ TPORT_DLL extern tag_typedef_t tptag_capt;
 TPORT_DLL extern tag_typedef_t tptag_capt_ref;
 #define TPTAG_CAPT_REF(x) tptag_capt_ref, tag_str_vr(&(x))
 
+TPORT_DLL extern tag_typedef_t tptag_reuseport;
+#define TPTAG_REUSEPORT(x) tptag_reuseport, tag_bool_v((x))
+
+TPORT_DLL extern tag_typedef_t tptag_reuseport_ref;
+#define TPTAG_REUSEPORT_REF(x) tptag_reuseport_ref, tag_bool_vr(&(x))
+
 SOFIA_END_DECLS
 
 #endif /* !defined TPORT_TAG_H */
@@ -3047,6 +3047,30 @@ tport_base_deliver(tport_t *self, msg_t *msg, su_time_t now)
   STACK_RECV(self, msg, now);
 }
 
+/** Deliver a datagram received by another transport bound to the same port.
+ *
+ * The message, already parsed, is passed to the protocol stack of @a self
+ * as if it had been received by @a self. The message has already been
+ * logged by the transport that received it, so it is not logged again.
+ *
+ * @a self must be a primary datagram transport. The message is destroyed
+ * if it can not be delivered.
+ *
+ * @sa TPTAG_REUSEPORT()
+ */
+int tport_redeliver(tport_t *self, msg_t *msg)
+{
+  if (!tport_is_primary(self) || !tport_is_dgram(self)) {
+    msg_destroy(msg);
+    return su_seterrno(EINVAL);
+  }
+
+  self->tp_rlogged = msg;
+  tport_deliver(self, msg, NULL, NULL, su_now());
+
+  return 0;
+}
+
 /** Return source transport object for delivered message */
 tport_t *tport_delivered_by(tport_t const *tp, msg_t const *msg)
 {
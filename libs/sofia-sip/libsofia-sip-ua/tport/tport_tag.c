@@ -605,6 +605,19 @@ tag_typedef_t tptag_dump = STRTAG_TYPEDEF(dump);
  */
 tag_typedef_t tptag_capt = STRTAG_TYPEDEF(capt);
 
+/**@def TPTAG_REUSEPORT(x)
+ *
+ * Bind datagram sockets with SO_REUSEPORT, so that several agents can
+ * listen on the same address and port and the kernel spreads the
+ * incoming datagrams between them.
+ *
+ * Use with tport_tbind(), nua_create(), nta_agent_create(),
+ * nta_agent_add_tport(), nth_engine_create(), or initial nth_site_create().
+ *
+ * @sa nta_agent_bind_stray()
+ */
+tag_typedef_t tptag_reuseport = BOOLTAG_TYPEDEF(reuseport);
+
 
 /** Mark transport as trusted.
  *
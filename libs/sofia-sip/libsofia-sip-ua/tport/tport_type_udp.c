@@ -126,6 +126,7 @@ int tport_udp_init_primary(tport_primary_t *pri,
 			   char const **return_culprit)
 {
   unsigned rmem = 0, wmem = 0;
+  int reuseport = 0;
   int events = SU_WAIT_IN;
   int s;
 #if HAVE_IP_ADD_MEMBERSHIP
@@ -139,6 +140,14 @@ int tport_udp_init_primary(tport_primary_t *pri,
 
   pri->pri_primary->tp_socket = s;
 
+  tl_gets(tags, TPTAG_REUSEPORT_REF(reuseport), TAG_END());
+
+  /* Every socket sharing the port has to ask for it before bind() */
+  if (reuseport && su_setreuseaddr(s, 1) < 0) {
+    SU_DEBUG_3(("setsockopt(%s): %s\n",
+		"SO_REUSEPORT", su_strerror(su_errno())));
+  }
+
   if (tport_bind_socket(s, ai, return_culprit) < 0)
     return -1;
 
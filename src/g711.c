@@ -32,6 +32,7 @@
 #endif
 #endif
 
+#include <switch.h>
 #include "g711.h"
 
 /* Copied from the CCITT G.711 specification */
@@ -88,6 +89,406 @@ uint8_t ulaw_to_alaw(uint8_t ulaw)
 	return ulaw_to_alaw_table[ulaw];
 }
 
+/*- End of function --------------------------------------------------------*/
+
+/* Block versions of the above.  The SIMD kernels use the same arithmetic as the inline
+   single sample routines, so the output is bit exact whichever set ends up in use.  Finding
+   the segment is done with an int to float conversion rather than a search for the top bit. */
+
+typedef struct {
+	const char *name;
+	void (*linear_to_ulaw) (uint8_t *ulaw, const int16_t *linear, int samples);
+	void (*ulaw_to_linear) (int16_t *linear, const uint8_t *ulaw, int samples);
+	void (*linear_to_alaw) (uint8_t *alaw, const int16_t *linear, int samples);
+	void (*alaw_to_linear) (int16_t *linear, const uint8_t *alaw, int samples);
+} g711_kernels_t;
+
+static void linear_to_ulaw_block_scalar(uint8_t *ulaw, const int16_t *linear, int samples)
+{
+	int i;
+
+	for (i = 0; i < samples; i++)
+		ulaw[i] = linear_to_ulaw(linear[i]);
+}
+
+/*- End of function --------------------------------------------------------*/
+
+static void ulaw_to_linear_block_scalar(int16_t *linear, const uint8_t *ulaw, int samples)
+{
+	int i;
+
+	for (i = 0; i < samples; i++)
+		linear[i] = ulaw_to_linear(ulaw[i]);
+}
+
+/*- End of function --------------------------------------------------------*/
+
+static void linear_to_alaw_block_scalar(uint8_t *alaw, const int16_t *linear, int samples)
+{
+	int i;
+
+	for (i = 0; i < samples; i++)
+		alaw[i] = linear_to_alaw(linear[i]);
+}
+
+/*- End of function --------------------------------------------------------*/
+
+static void alaw_to_linear_block_scalar(int16_t *linear, const uint8_t *alaw, int samples)
+{
+	int i;
+
+	for (i = 0; i < samples; i++)
+		linear[i] = alaw_to_linear(alaw[i]);
+}
+
+/*- End of function --------------------------------------------------------*/
+
+static const g711_kernels_t g711_kernels_scalar = {
+	"scalar",
+	linear_to_ulaw_block_scalar,
+	ulaw_to_linear_block_scalar,
+	linear_to_alaw_block_scalar,
+	alaw_to_linear_block_scalar
+};
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__) && (defined(__clang__) || __GNUC__ >= 5)
+#define G711_KERNELS_X86 1
+#include <immintrin.h>
+
+/* The kernels are written once against these macros and built for both 128 and 256 bit vectors */
+#define G711_KERNELS(_w, _attr, _v, _p) \
+\
+/* shift each 16 bit lane left by 0 to 7 places, picked by the low 3 bits of n */ \
+_attr static inline _v g711_shl3_##_w(_v x, _v n) \
+{ \
+	x = g711_blend_##_w(_p##_cmpeq_epi16(_p##_and_si##_w(n, _p##_set1_epi16(1)), _p##_set1_epi16(1)), x, _p##_slli_epi16(x, 1)); \
+	x = g711_blend_##_w(_p##_cmpeq_epi16(_p##_and_si##_w(n, _p##_set1_epi16(2)), _p##_set1_epi16(2)), x, _p##_slli_epi16(x, 2)); \
+	return g711_blend_##_w(_p##_cmpeq_epi16(_p##_and_si##_w(n, _p##_set1_epi16(4)), _p##_set1_epi16(4)), x, _p##_slli_epi16(x, 4)); \
+} \
+\
+/* For 128 <= v < 2^24 the float's exponent is top_bit(v) and the top of its mantissa holds the \
+   next bits down, so bits 19 up of the float are the segment and the 4 quantization bits together */ \
+_attr static inline _v g711_segq_##_w(_v v) \
+{ \
+	return _p##_sub_epi32(_p##_srli_epi32(_p##_castps_si##_w(_p##_cvtepi32_ps(v)), 19), _p##_set1_epi32((127 + 7) << 4)); \
+} \
+\
+_attr static _v g711_ulaw_enc_##_w(_v x) \
+{ \
+	_v neg = _p##_srai_epi32(x, 31); \
+	_v lin = _p##_add_epi32(_p##_set1_epi32(ULAW_BIAS), _p##_sub_epi32(_p##_xor_si##_w(x, neg), neg)); \
+	_v mask = _p##_xor_si##_w(_p##_set1_epi32(0xFF), _p##_and_si##_w(neg, _p##_set1_epi32(0x80))); \
+	_v u = g711_segq_##_w(lin); \
+	u = g711_blend_##_w(_p##_cmpgt_epi32(u, _p##_set1_epi32(0x7F)), u, _p##_set1_epi32(0x7F)); \
+	return _p##_xor_si##_w(u, mask); \
+} \
+\
+_attr static _v g711_alaw_enc_##_w(_v x) \
+{ \
+	_v neg = _p##_srai_epi32(x, 31); \
+	_v lin = g711_blend_##_w(neg, x, _p##_sub_epi32(_p##_xor_si##_w(x, neg), _p##_set1_epi32(7))); \
+	_v mask = _p##_or_si##_w(_p##_set1_epi32(ALAW_AMI_MASK), _p##_andnot_si##_w(neg, _p##_set1_epi32(0x80))); \
+	_v a = g711_blend_##_w(_p##_cmpgt_epi32(lin, _p##_set1_epi32(0xFF)), _p##_srai_epi32(lin, 4), g711_segq_##_w(lin)); \
+	/* a tiny step below zero comes out as zero */ \
+	a = _p##_andnot_si##_w(_p##_srai_epi32(lin, 31), a); \
+	return _p##_xor_si##_w(a, mask); \
+} \
+\
+_attr static _v g711_ulaw_dec_##_w(_v u) \
+{ \
+	_v t, sign; \
+	u = _p##_xor_si##_w(u, _p##_set1_epi16(0xFF)); \
+	t = _p##_add_epi16(_p##_slli_epi16(_p##_and_si##_w(u, _p##_set1_epi16(0x0F)), 3), _p##_set1_epi16(ULAW_BIAS)); \
+	t = g711_shl3_##_w(t, _p##_srli_epi16(u, 4)); \
+	t = _p##_sub_epi16(t, _p##_set1_epi16(ULAW_BIAS)); \
+	sign = _p##_cmpeq_epi16(_p##_and_si##_w(u, _p##_set1_epi16(0x80)), _p##_set1_epi16(0x80)); \
+	return _p##_sub_epi16(_p##_xor_si##_w(t, sign), sign); \
+} \
+\
+_attr static _v g711_alaw_dec_##_w(_v a) \
+{ \
+	_v i, seg, neg; \
+	a = _p##_xor_si##_w(a, _p##_set1_epi16(ALAW_AMI_MASK)); \
+	i = _p##_slli_epi16(_p##_and_si##_w(a, _p##_set1_epi16(0x0F)), 4); \
+	seg = _p##_and_si##_w(_p##_srli_epi16(a, 4), _p##_set1_epi16(0x07)); \
+	i = _p##_add_epi16(i, g711_blend_##_w(_p##_cmpeq_epi16(seg, _p##_setzero_si##_w()), _p##_set1_epi16(0x108), _p##_set1_epi16(8))); \
+	i = g711_shl3_##_w(i, _p##_subs_epu16(seg, _p##_set1_epi16(1))); \
+	neg = _p##_cmpeq_epi16(_p##_and_si##_w(a, _p##_set1_epi16(0x80)), _p##_setzero_si##_w()); \
+	return _p##_sub_epi16(_p##_xor_si##_w(i, neg), neg); \
+}
+
+/* sse2 has no blendv, the masks here are always all or nothing per lane so and/or does it */
+#define g711_blend_128(_m, _a, _b) _mm_or_si128(_mm_andnot_si128(_m, _a), _mm_and_si128(_m, _b))
+#define g711_blend_256(_m, _a, _b) _mm256_blendv_epi8(_a, _b, _m)
+
+G711_KERNELS(128, , __m128i, _mm)
+G711_KERNELS(256, __attribute__((target("avx2"))), __m256i, _mm256)
+
+static void linear_to_ulaw_block_sse2(uint8_t *ulaw, const int16_t *linear, int samples)
+{
+	int i = 0;
+
+	for (; i + 8 <= samples; i += 8) {
+		__m128i s = _mm_loadu_si128((const __m128i *) (linear + i));
+		__m128i lo = g711_ulaw_enc_128(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16));
+		__m128i hi = g711_ulaw_enc_128(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16));
+		__m128i p = _mm_packs_epi32(lo, hi);
+
+		_mm_storel_epi64((__m128i *) (ulaw + i), _mm_packus_epi16(p, p));
+	}
+
+	linear_to_ulaw_block_scalar(ulaw + i, linear + i, samples - i);
+}
+
+/*- End of function --------------------------------------------------------*/
+
+static void linear_to_alaw_block_sse2(uint8_t *alaw, const int16_t *linear, int samples)
+{
+	int i = 0;
+
+	for (; i + 8 <= samples; i += 8) {
+		__m128i s = _mm_loadu_si128((const __m128i *) (linear + i));
+		__m128i lo = g711_alaw_enc_128(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16));
+		__m128i hi = g711_alaw_enc_128(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16));
+		__m128i p = _mm_packs_epi32(lo, hi);
+
+		_mm_storel_epi64((__m128i *) (alaw + i), _mm_packus_epi16(p, p));
+	}
+
+	linear_to_alaw_block_scalar(alaw + i, linear + i, samples - i);
+}
+
+/*- End of function --------------------------------------------------------*/
+
+static void ulaw_to_linear_block_sse2(int16_t *linear, const uint8_t *ulaw, int samples)
+{
+	int i = 0;
+
+	for (; i + 8 <= samples; i += 8) {
+		__m128i u = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) (ulaw + i)), _mm_setzero_si128());
+
+		_mm_storeu_si128((__m128i *) (linear + i), g711_ulaw_dec_128(u));
+	}
+
+	ulaw_to_linear_block_scalar(linear + i, ulaw + i, samples - i);
+}
+
+/*- End of function --------------------------------------------------------*/
+
+static void alaw_to_linear_block_sse2(int16_t *linear, const uint8_t *alaw, int samples)
+{
+	int i = 0;
+
+	for (; i + 8 <= samples; i += 8) {
+		__m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) (alaw + i)), _mm_setzero_si128());
+
+		_mm_storeu_si128((__m128i *) (linear + i), g711_alaw_dec_128(a));
+	}
+
+	alaw_to_linear_block_scalar(linear + i, alaw + i, samples - i);
+}
+
+/*- End of function --------------------------------------------------------*/
+
+static const g711_kernels_t g711_kernels_sse2 = {
+	"sse2",
+	linear_to_ulaw_block_sse2,
+	ulaw_to_linear_block_sse2,
+	linear_to_alaw_block_sse2,
+	alaw_to_linear_block_sse2
+};
+
+#define G711_AVX2 __attribute__((target("avx2")))
+
+/* packs works per 128 bit lane so the quadwords have to be put back in order before narrowing to bytes */
+G711_AVX2 static inline __m128i g711_pack_bytes_avx2(__m256i lo, __m256i hi)
+{
+	__m256i p = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+
+	return _mm_packus_epi16(_mm256_castsi256_si128(p), _mm256_extracti128_si256(p, 1));
+}
+
+/*- End of function --------------------------------------------------------*/
+
+G711_AVX2 static void linear_to_ulaw_block_avx2(uint8_t *ulaw, const int16_t *linear, int samples)
+{
+	int i = 0;
+
+	for (; i + 16 <= samples; i += 16) {
+		__m256i lo = g711_ulaw_enc_256(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (linear + i))));
+		__m256i hi = g711_ulaw_enc_256(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (linear + i + 8))));
+
+		_mm_storeu_si128((__m128i *) (ulaw + i), g711_pack_bytes_avx2(lo, hi));
+	}
+
+	linear_to_ulaw_block_scalar(ulaw + i, linear + i, samples - i);
+}
+
+/*- End of function --------------------------------------------------------*/
+
+G711_AVX2 static void linear_to_alaw_block_avx2(uint8_t *alaw, const int16_t *linear, int samples)
+{
+	int i = 0;
+
+	for (; i + 16 <= samples; i += 16) {
+		__m256i lo = g711_alaw_enc_256(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (linear + i))));
+		__m256i hi = g711_alaw_enc_256(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (linear + i + 8))));
+
+		_mm_storeu_si128((__m128i *) (alaw + i), g711_pack_bytes_avx2(lo, hi));
+	}
+
+	linear_to_alaw_block_scalar(alaw + i, linear + i, samples - i);
+}
+
+/*- End of function --------------------------------------------------------*/
+
+G711_AVX2 static void ulaw_to_linear_block_avx2(int16_t *linear, const uint8_t *ulaw, int samples)
+{
+	int i = 0;
+
+	for (; i + 16 <= samples; i += 16) {
+		__m256i u = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) (ulaw + i)));
+
+		_mm256_storeu_si256((__m256i *) (linear + i), g711_ulaw_dec_256(u));
+	}
+
+	ulaw_to_linear_block_scalar(linear + i, ulaw + i, samples - i);
+}
+
+/*- End of function --------------------------------------------------------*/
+
+G711_AVX2 static void alaw_to_linear_block_avx2(int16_t *linear, const uint8_t *alaw, int samples)
+{
+	int i = 0;
+
+	for (; i + 16 <= samples; i += 16) {
+		__m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) (alaw + i)));
+
+		_mm256_storeu_si256((__m256i *) (linear + i), g711_alaw_dec_256(a));
+	}
+
+	alaw_to_linear_block_scalar(linear + i, alaw + i, samples - i);
+}
+
+/*- End of function --------------------------------------------------------*/
+
+static const g711_kernels_t g711_kernels_avx2 = {
+	"avx2",
+	linear_to_ulaw_block_avx2,
+	ulaw_to_linear_block_avx2,
+	linear_to_alaw_block_avx2,
+	alaw_to_linear_block_avx2
+};
+#endif
+
+static const g711_kernels_t *g711_kernels = NULL;
+
+static const g711_kernels_t *g711_kernels_detect(void)
+{
+#ifdef G711_KERNELS_X86
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2"))
+		return &g711_kernels_avx2;
+
+	return &g711_kernels_sse2;
+#else
+	return &g711_kernels_scalar;
+#endif
+}
+
+/*- End of function --------------------------------------------------------*/
+
+static __inline__ const g711_kernels_t *g711_get_kernels(void)
+{
+	/* racing first callers all detect the same answer so there is nothing to lock */
+	if (!g711_kernels)
+		g711_kernels = g711_kernels_detect();
+
+	return g711_kernels;
+}
+
+/*- End of function --------------------------------------------------------*/
+
+G711_DECLARE(int) g711_kernels_select(const char *name)
+{
+	const g711_kernels_t *kernels = NULL;
+
+	if (!name || !*name || !strcasecmp(name, "auto")) {
+		kernels = g711_kernels_detect();
+	} else if (!strcasecmp(name, "scalar")) {
+		kernels = &g711_kernels_scalar;
+#ifdef G711_KERNELS_X86
+	} else if (!strcasecmp(name, "sse2")) {
+		kernels = &g711_kernels_sse2;
+	} else if (!strcasecmp(name, "avx2") && __builtin_cpu_supports("avx2")) {
+		kernels = &g711_kernels_avx2;
+#endif
+	}
+
+	if (!kernels)
+		return -1;
+
+	g711_kernels = kernels;
+
+	return 0;
+}
+
+/*- End of function --------------------------------------------------------*/
+
+G711_DECLARE(const char *) g711_kernels_name(void)
+{
+	return g711_get_kernels()->name;
+}
+
+/*- End of function --------------------------------------------------------*/
+
+G711_DECLARE(void) linear_to_ulaw_block(uint8_t *ulaw, const int16_t *linear, int samples)
+{
+	g711_get_kernels()->linear_to_ulaw(ulaw, linear, samples);
+}
+
+/*- End of function --------------------------------------------------------*/
+
+G711_DECLARE(void) ulaw_to_linear_block(int16_t *linear, const uint8_t *ulaw, int samples)
+{
+	g711_get_kernels()->ulaw_to_linear(linear, ulaw, samples);
+}
+
+/*- End of function --------------------------------------------------------*/
+
+G711_DECLARE(void) linear_to_alaw_block(uint8_t *alaw, const int16_t *linear, int samples)
+{
+	g711_get_kernels()->linear_to_alaw(alaw, linear, samples);
+}
+
+/*- End of function --------------------------------------------------------*/
+
+G711_DECLARE(void) alaw_to_linear_block(int16_t *linear, const uint8_t *alaw, int samples)
+{
+	g711_get_kernels()->alaw_to_linear(linear, alaw, samples);
+}
+
+/*- End of function --------------------------------------------------------*/
+
+G711_DECLARE(void) ulaw_to_alaw_block(uint8_t *alaw, const uint8_t *ulaw, int samples)
+{
+	int i;
+
+	for (i = 0; i < samples; i++)
+		alaw[i] = ulaw_to_alaw_table[ulaw[i]];
+}
+
+/*- End of function --------------------------------------------------------*/
+
+G711_DECLARE(void) alaw_to_ulaw_block(uint8_t *ulaw, const uint8_t *alaw, int samples)
+{
+	int i;
+
+	for (i = 0; i < samples; i++)
+		ulaw[i] = alaw_to_ulaw_table[alaw[i]];
+}
+
 /*- End of function --------------------------------------------------------*/
 /*- End of file ------------------------------------------------------------*/
 
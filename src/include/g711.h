@@ -335,6 +335,57 @@ extern "C" {
 */
 	uint8_t ulaw_to_alaw(uint8_t ulaw);
 
+/* Exported from the core when built into it, plain functions otherwise */
+#ifdef SWITCH_DECLARE
+#define G711_DECLARE(type) SWITCH_DECLARE(type)
+#else
+#define G711_DECLARE(type) type
+#endif
+
+/*! \brief Encode a block of linear samples to u-law, bit exact with linear_to_ulaw().
+    \param ulaw The u-law output, one byte per sample.
+    \param linear The samples to encode.
+    \param samples The number of samples. */
+	G711_DECLARE(void) linear_to_ulaw_block(uint8_t *ulaw, const int16_t *linear, int samples);
+
+/*! \brief Decode a block of u-law to linear samples, bit exact with ulaw_to_linear().
+    \param linear The decoded samples.
+    \param ulaw The u-law input.
+    \param samples The number of samples. */
+	G711_DECLARE(void) ulaw_to_linear_block(int16_t *linear, const uint8_t *ulaw, int samples);
+
+/*! \brief Encode a block of linear samples to A-law, bit exact with linear_to_alaw().
+    \param alaw The A-law output, one byte per sample.
+    \param linear The samples to encode.
+    \param samples The number of samples. */
+	G711_DECLARE(void) linear_to_alaw_block(uint8_t *alaw, const int16_t *linear, int samples);
+
+/*! \brief Decode a block of A-law to linear samples, bit exact with alaw_to_linear().
+    \param linear The decoded samples.
+    \param alaw The A-law input.
+    \param samples The number of samples. */
+	G711_DECLARE(void) alaw_to_linear_block(int16_t *linear, const uint8_t *alaw, int samples);
+
+/*! \brief Transcode a block of u-law straight to A-law without going through linear.
+    \param alaw The A-law output, may be the same buffer as ulaw.
+    \param ulaw The u-law input.
+    \param samples The number of samples. */
+	G711_DECLARE(void) ulaw_to_alaw_block(uint8_t *alaw, const uint8_t *ulaw, int samples);
+
+/*! \brief Transcode a block of A-law straight to u-law without going through linear.
+    \param ulaw The u-law output, may be the same buffer as alaw.
+    \param alaw The A-law input.
+    \param samples The number of samples. */
+	G711_DECLARE(void) alaw_to_ulaw_block(uint8_t *ulaw, const uint8_t *alaw, int samples);
+
+/*! \brief Pick the block kernels, "scalar", "sse2", "avx2" or "auto" for the best the CPU supports.
+    \param name The kernel set.
+    \return 0 on success, -1 if the set is unknown or not supported here. */
+	G711_DECLARE(int) g711_kernels_select(const char *name);
+
+/*! \brief The name of the block kernels in use. */
+	G711_DECLARE(const char *) g711_kernels_name(void);
+
 #ifdef __cplusplus
 }
 #endif
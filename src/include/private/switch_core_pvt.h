@@ -145,11 +145,11 @@ struct switch_core_session {
 
 	char uuid_str[SWITCH_UUID_FORMATTED_LENGTH + 1];
 	void *private_info[SWITCH_CORE_SESSION_MAX_PRIVATES];
-	switch_queue_t *event_queue;
-	switch_queue_t *message_queue;
-	switch_queue_t *signal_data_queue;
-	switch_queue_t *private_event_queue;
-	switch_queue_t *private_event_queue_pri;
+	switch_mpsc_queue_t *event_queue;
+	switch_mpsc_queue_t *message_queue;
+	switch_mpsc_queue_t *signal_data_queue;
+	switch_mpsc_queue_t *private_event_queue;
+	switch_mpsc_queue_t *private_event_queue_pri;
 	switch_thread_rwlock_t *bug_rwlock;
 	switch_media_bug_t *bugs;
 	switch_app_log_t *app_log;
@@ -311,6 +311,7 @@ struct switch_runtime {
 	char *core_db_inner_post_trans_execute;
 	int events_use_dispatch;
 	uint32_t port_alloc_flags;
+	switch_bool_t channel_sql_export;
 };
 
 extern struct switch_runtime runtime;
@@ -335,8 +336,14 @@ extern struct switch_session_manager session_manager;
 
 switch_status_t switch_core_sqldb_start(switch_memory_pool_t *pool, switch_bool_t manage);
 void switch_core_sqldb_stop(void);
+void switch_core_channel_registry_start(switch_memory_pool_t *pool);
+void switch_core_channel_registry_stop(void);
 void switch_core_session_init(switch_memory_pool_t *pool);
 void switch_core_session_uninit(void);
 void switch_core_state_machine_init(switch_memory_pool_t *pool);
 switch_memory_pool_t *switch_core_memory_init(void);
 void switch_core_memory_stop(void);
+void switch_resample_pool_init(switch_memory_pool_t *pool);
+void switch_resample_pool_shutdown(void);
+void switch_ivr_record_writer_start(switch_memory_pool_t *pool);
+void switch_ivr_record_writer_stop(void);
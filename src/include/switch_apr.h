@@ -424,6 +424,16 @@ SWITCH_DECLARE(void) switch_atomic_inc(volatile switch_atomic_t *mem);
  */
 SWITCH_DECLARE(int)  switch_atomic_dec(volatile switch_atomic_t *mem);
 
+/**
+ * Compare the value at the specified location with cmp and, if equal, replace it
+ * with val.  Acts as a full memory barrier.
+ * @param mem The location of the value
+ * @param val The value to store if the comparison succeeds
+ * @param cmp The value to compare against
+ * @return the value found at mem before the operation
+ */
+SWITCH_DECLARE(uint32_t) switch_atomic_cas(volatile switch_atomic_t *mem, uint32_t val, uint32_t cmp);
+
 /** @} */
 
 /**
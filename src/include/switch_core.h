@@ -1682,6 +1682,18 @@ SWITCH_DECLARE(switch_status_t) switch_core_codec_decode(switch_codec_t *codec,
 														 uint32_t encoded_rate,
 														 void *decoded_data, uint32_t *decoded_data_len, uint32_t *decoded_rate, unsigned int *flag);
 
+/*!
+  \brief Transcode directly between PCMU and PCMA without decoding to linear
+  \param from the implementation the data is encoded with
+  \param to the implementation to transcode to
+  \param in the encoded data
+  \param out the buffer to write the transcoded data to, may be the same as in
+  \param len the length of the data, the output is the same length
+  \return SWITCH_STATUS_SUCCESS if the pair is PCMU and PCMA, SWITCH_STATUS_FALSE otherwise
+*/
+SWITCH_DECLARE(switch_status_t) switch_core_codec_g711_transcode(const switch_codec_implementation_t *from, const switch_codec_implementation_t *to,
+																 const void *in, void *out, uint32_t len);
+
 /*!
   \brief Encode video data using a codec handle
   \param codec the codec handle to use
@@ -2426,6 +2438,7 @@ SWITCH_DECLARE(switch_bool_t) switch_check_network_list_ip_token(const char *ip_
 #define switch_check_network_list_ip(_ip_str, _list_name) switch_check_network_list_ip_token(_ip_str, _list_name, NULL)
 SWITCH_DECLARE(void) switch_time_set_monotonic(switch_bool_t enable);
 SWITCH_DECLARE(void) switch_time_set_timerfd(int enable);
+SWITCH_DECLARE(void) switch_time_set_wheel(switch_bool_t enable);
 SWITCH_DECLARE(void) switch_time_set_nanosleep(switch_bool_t enable);
 SWITCH_DECLARE(void) switch_time_set_matrix(switch_bool_t enable);
 SWITCH_DECLARE(void) switch_time_set_cond_yield(switch_bool_t enable);
@@ -2605,6 +2618,52 @@ SWITCH_DECLARE(switch_status_t) switch_cache_db_execute_sql_callback_err(switch_
 																	 switch_core_db_err_callback_func_t err_callback,
 																	 void *pdata, char **err);
 
+/*!
+ \brief Executes sql containing ? placeholders, the compiled statement is cached on the handle
+ \param [in] dbh The handle
+ \param [in] sql - sql to run, the same text with different params reuses the statement
+ \param [in] nparams - number of params
+ \param [in] params - text values for the placeholders in order, NULL binds SQL NULL
+ \param [out] err - Error if it exists
+ \note Only the core db keeps compiled statements, other back ends get the values quoted into the sql
+*/
+SWITCH_DECLARE(switch_status_t) switch_cache_db_execute_sql_params(switch_cache_db_handle_t *dbh, const char *sql, int nparams, const char **params, char **err);
+
+/*!
+ \brief Executes sql containing ? placeholders and uses callback for row-by-row processing
+ \param [in] dbh The handle
+ \param [in] sql - sql to run
+ \param [in] nparams - number of params
+ \param [in] params - text values for the placeholders in order, NULL binds SQL NULL
+ \param [in] callback - function pointer to callback
+ \param [in] pdata - data to pass to callback
+ \param [out] err - Error if it exists
+*/
+SWITCH_DECLARE(switch_status_t) switch_cache_db_execute_sql_callback_params(switch_cache_db_handle_t *dbh, const char *sql, int nparams, const char **params,
+																			switch_core_db_callback_func_t callback, void *pdata, char **err);
+
+/*!
+ \brief Executes sql containing ? placeholders and returns the result as a string
+ \param [in] dbh The handle
+ \param [in] sql - sql to run
+ \param [in] nparams - number of params
+ \param [in] params - text values for the placeholders in order, NULL binds SQL NULL
+ \param [out] str - buffer for result
+ \param [in] len - length of str buffer
+ \param [out] err - Error if it exists
+*/
+SWITCH_DECLARE(char *) switch_cache_db_execute_sql2str_params(switch_cache_db_handle_t *dbh, const char *sql, int nparams, const char **params,
+															  char *str, size_t len, char **err);
+
+/*!
+ \brief Package sql with ? placeholders and its params for switch_sql_queue_manager_push()
+ \param [in] sql - sql to run
+ \param [in] nparams - number of params (less than 256)
+ \param [in] params - text values for the placeholders in order, NULL binds SQL NULL
+ \return a malloc'd job, hand it to the queue manager with dup set to SWITCH_FALSE
+*/
+SWITCH_DECLARE(char *) switch_sql_bind_params(const char *sql, int nparams, const char **params);
+
 /*!
  \brief Get the affected rows of the last performed query
  \param [in] dbh The handle
@@ -2716,12 +2775,79 @@ SWITCH_DECLARE(void) switch_core_recovery_untrack(switch_core_session_t *session
 SWITCH_DECLARE(void) switch_core_recovery_track(switch_core_session_t *session);
 SWITCH_DECLARE(void) switch_core_recovery_flush(const char *technology, const char *profile_name);
 
+typedef enum {
+	SWITCH_CHANNEL_REGISTRY_CHANNELS,
+	SWITCH_CHANNEL_REGISTRY_CALLS,
+	SWITCH_CHANNEL_REGISTRY_DETAILED_CALLS
+} switch_channel_registry_view_t;
+
+/*!
+  \brief Walk the in-memory channel registry in creation order
+  \param view the rows to produce, laid out like the channels table or the basic_calls/detailed_calls views
+  \param like optional sql LIKE pattern matched against uuid, name, cid_name, cid_num, presence_data and accountcode (%like% when it has no %)
+  \param bridged_only only calls with a b leg
+  \param callback called for every row under the registry read lock, return non-zero to stop
+  \param pArg user data for the callback
+  \return the number of rows delivered
+*/
+SWITCH_DECLARE(uint32_t) switch_channel_registry_query(switch_channel_registry_view_t view, const char *like, switch_bool_t bridged_only,
+													   switch_core_db_callback_func_t callback, void *pArg);
+SWITCH_DECLARE(uint32_t) switch_channel_registry_count(switch_channel_registry_view_t view);
+/*!
+  \brief Find channels by uuid or one of the indexed columns (call_uuid, presence_id, hostname)
+  \param column the column to search
+  \param key the exact value
+  \param callback called for every matching row under the registry read lock, return non-zero to stop
+  \param pArg user data for the callback
+  \return the number of rows delivered
+*/
+SWITCH_DECLARE(uint32_t) switch_channel_registry_lookup(const char *column, const char *key, switch_core_db_callback_func_t callback, void *pArg);
+SWITCH_DECLARE(void) switch_channel_registry_status(switch_stream_handle_t *stream);
+
+/*!
+  \brief Tells the channel registry whether a channel is alive, and with snapshot non NULL builds a CHANNEL_CREATE shaped event of it
+*/
+typedef switch_status_t (*switch_channel_registry_live_func_t) (const char *uuid, switch_event_t **snapshot);
+/*!
+  \brief Start the channel registry without binding to the channel events, live stands in for the session table (unit tests)
+*/
+SWITCH_DECLARE(void) switch_channel_registry_test_start(switch_memory_pool_t *pool, switch_channel_registry_live_func_t live);
+/*!
+  \brief Apply one channel event to a registry started with switch_channel_registry_test_start (unit tests)
+*/
+SWITCH_DECLARE(void) switch_channel_registry_test_event(switch_event_t *event);
+/*!
+  \brief Stop the channel registry and free every row (unit tests)
+*/
+SWITCH_DECLARE(void) switch_channel_registry_test_stop(void);
+
 SWITCH_DECLARE(void) switch_sql_queue_manager_pause(switch_sql_queue_manager_t *qm, switch_bool_t flush);
 SWITCH_DECLARE(void) switch_sql_queue_manager_resume(switch_sql_queue_manager_t *qm);
 
 SWITCH_DECLARE(int) switch_sql_queue_manager_size(switch_sql_queue_manager_t *qm, uint32_t index);
 SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push_confirm(switch_sql_queue_manager_t *qm, const char *sql, uint32_t pos, switch_bool_t dup);
 SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push(switch_sql_queue_manager_t *qm, const char *sql, uint32_t pos, switch_bool_t dup);
+/*!
+  \brief Push sql that touches the row key of table, later updates of that row will not be merged ahead of it
+  \note A NULL key is for sql that touches any number of rows of table, no pending update of the table is merged past it
+*/
+SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push_keyed(switch_sql_queue_manager_t *qm, const char *sql, const char *table, const char *key,
+																   uint32_t pos, switch_bool_t dup);
+/*!
+  \brief Queue "update table set cols=values where key_col=key", merged into a still pending update of the same row (last write wins)
+  \param qm the queue manager
+  \param pos the queue index
+  \param table the table name
+  \param key_col the key column
+  \param key the row key
+  \param ncols the number of columns
+  \param cols the column names
+  \param values the column values, NULL for sql NULL
+  \return SWITCH_STATUS_SUCCESS when queued or merged
+*/
+SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push_update(switch_sql_queue_manager_t *qm, uint32_t pos, const char *table, const char *key_col,
+																	 const char *key, int ncols, const char **cols, const char **values);
+SWITCH_DECLARE(void) switch_sql_queue_manager_status(switch_sql_queue_manager_t *qm, switch_stream_handle_t *stream);
 SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_destroy(switch_sql_queue_manager_t **qmp);
 SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_init_name(const char *name,
 																   switch_sql_queue_manager_t **qmp,
@@ -292,6 +292,18 @@ SWITCH_DECLARE(int) switch_core_db_step(switch_core_db_stmt_t *stmt);
  */
 SWITCH_DECLARE(int) switch_core_db_reset(switch_core_db_stmt_t *pStmt);
 
+/**
+ * Set every parameter of a prepared statement back to NULL, so values bound
+ * for one execution do not leak into the next one after switch_core_db_reset().
+ */
+SWITCH_DECLARE(int) switch_core_db_clear_bindings(switch_core_db_stmt_t *pStmt);
+
+/**
+ * Return the number of parameters a prepared statement takes, that is
+ * the index of its largest parameter.
+ */
+SWITCH_DECLARE(int) switch_core_db_bind_parameter_count(switch_core_db_stmt_t *pStmt);
+
 /**
  * In the SQL strings input to switch_core_db_prepare(),
  * one or more literals can be replace by parameters "?" or ":AAA" or
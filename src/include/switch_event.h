@@ -61,6 +61,10 @@
 #include <switch.h>
 
 SWITCH_BEGIN_EXTERN_C
+
+/*! \brief Header names shorter than this are stored inside the header itself */
+#define SWITCH_EVENT_HEADER_NAME_LEN 48
+
 /*! \brief An event Header */
 	struct switch_event_header {
 	/*! the header name */
@@ -74,8 +78,20 @@ SWITCH_BEGIN_EXTERN_C
 	/*! hash of the header name */
 	unsigned long hash;
 	struct switch_event_header *next;
+	/*! storage for short header names */
+	char name_buf[SWITCH_EVENT_HEADER_NAME_LEN];
 };
 
+struct switch_event_header_slab;
+
+/*! \brief Text renderings that can be cached on a frozen event */
+typedef enum {
+	SWITCH_EVENT_RENDER_PLAIN,
+	SWITCH_EVENT_RENDER_JSON,
+	SWITCH_EVENT_RENDER_XML,
+	SWITCH_EVENT_RENDER_MAX
+} switch_event_render_t;
+
 /*! \brief Representation of an event */
 struct switch_event {
 	/*! the event id (descriptor) */
@@ -92,7 +108,7 @@ struct switch_event {
 	switch_event_header_t *last_header;
 	/*! the body of the event */
 	char *body;
-	/*! user data from the subclass provider */
+	/*! user data from the subclass provider, set by the delivery thread for the callback it is running, only valid inside that callback */
 	void *bind_user_data;
 	/*! user data from the event sender */
 	void *event_user_data;
@@ -100,6 +116,22 @@ struct switch_event {
 	unsigned long key;
 	struct switch_event *next;
 	int flags;
+	/*! open addressed index of the first header of each name, built once the event grows */
+	switch_event_header_t **index;
+	/*! number of index slots, a power of 2 */
+	uint32_t index_size;
+	/*! index slots holding a header or a deleted marker */
+	uint32_t index_used;
+	/*! number of headers on the event */
+	uint32_t header_count;
+	/*! header nodes owned by the event */
+	struct switch_event_header_slab *slabs;
+	/*! header nodes ready for reuse */
+	switch_event_header_t *free_headers;
+	/*! holders of a frozen event, the last switch_event_destroy frees it */
+	volatile switch_atomic_t refs;
+	/*! renderings shared by the holders of a frozen event */
+	char *rendered[SWITCH_EVENT_RENDER_MAX];
 };
 
 typedef struct switch_serial_event_s {
@@ -119,7 +151,8 @@ typedef struct switch_serial_event_header_s {
 typedef enum {
 	EF_UNIQ_HEADERS = (1 << 0),
 	EF_NO_CHAT_EXEC = (1 << 1),
-	EF_DEFAULT_ALLOW = (1 << 2)
+	EF_DEFAULT_ALLOW = (1 << 2),
+	EF_FROZEN = (1 << 3)
 } switch_event_flag_t;
 
 
@@ -217,6 +250,24 @@ SWITCH_DECLARE(int) switch_event_add_array(switch_event_t *event, const char *va
 SWITCH_DECLARE(void) switch_event_destroy(switch_event_t **event);
 #define switch_event_safe_destroy(_event) if (_event) switch_event_destroy(_event)
 
+/*!
+  \brief Take a read only reference on an event
+  \param event the event to reference
+  \return the event itself when it was frozen by switch_event_fire, otherwise a duplicate; NULL on error
+  \note release the handle with switch_event_destroy, never modify it.  Once a second holder exists every
+        header, body, subclass or priority change on the event fails with SWITCH_STATUS_FALSE, so a consumer
+        that needs to add or remove headers works on its own switch_event_dup
+*/
+SWITCH_DECLARE(switch_event_t *) switch_event_ref(switch_event_t *event);
+
+/*!
+  \brief Render a frozen event once and share the text with every holder
+  \param event the event to render
+  \param type the rendering (plain is url encoded like ESL sends it)
+  \return the text, owned by the event, or NULL when the event is not frozen
+*/
+SWITCH_DECLARE(const char *) switch_event_get_rendered(switch_event_t *event, switch_event_render_t type);
+
 /*!
   \brief Duplicate an event
   \param event a NULL pointer on which to duplicate the event
@@ -250,6 +301,8 @@ SWITCH_DECLARE(void) switch_event_prep_for_delivery_detailed(const char *file, c
   \param callback the callback functon to bind
   \param user_data optional user specific data to pass whenever the callback is invoked
   \return SWITCH_STATUS_SUCCESS if the event was binded
+  \note the callback is handed a fired event that other subscribers may already hold through switch_event_ref,
+        it must treat it as read only and switch_event_dup it to change anything; writes to a shared event are refused
 */
 SWITCH_DECLARE(switch_status_t) switch_event_bind(const char *id, switch_event_types_t event, const char *subclass_name, switch_event_callback_t callback,
 												  void *user_data);
@@ -268,6 +321,20 @@ SWITCH_DECLARE(switch_status_t) switch_event_get_custom_events(switch_console_ca
 */
 SWITCH_DECLARE(switch_status_t) switch_event_bind_removable(const char *id, switch_event_types_t event, const char *subclass_name,
 															switch_event_callback_t callback, void *user_data, switch_event_node_t **node);
+
+/*!
+  \brief Bind an event callback that must see the events of each call in order
+  \param id an identifier token of the binder
+  \param event the event enumeration to bind to
+  \param subclass_name the event subclass to bind to in the case if SWITCH_EVENT_CUSTOM
+  \param callback the callback functon to bind
+  \param user_data optional user specific data to pass whenever the callback is invoked
+  \param node bind handle to later remove the binding.
+  \return SWITCH_STATUS_SUCCESS if the event was binded
+  \note while such a binding exists, dispatched events with a Unique-ID are pinned to one dispatch thread per call
+*/
+SWITCH_DECLARE(switch_status_t) switch_event_bind_sharded(const char *id, switch_event_types_t event, const char *subclass_name,
+														  switch_event_callback_t callback, void *user_data, switch_event_node_t **node);
 /*!
   \brief Unbind a bound event consumer
   \param node node to unbind
@@ -426,6 +493,11 @@ SWITCH_DECLARE(void) switch_event_add_presence_data_cols(switch_channel_t *chann
 SWITCH_DECLARE(void) switch_json_add_presence_data_cols(switch_event_t *event, cJSON *json, const char *prefix);
 
 SWITCH_DECLARE(void) switch_event_launch_dispatch_threads(uint32_t max);
+/*!
+  \brief Write per thread depth, latency and steal counters of the event dispatch queues
+  \param stream the stream to write to
+*/
+SWITCH_DECLARE(void) switch_event_dispatch_status(switch_stream_handle_t *stream);
 
 SWITCH_DECLARE(switch_status_t) switch_event_channel_broadcast(const char *event_channel, cJSON **json, const char *key, switch_event_channel_id_t id);
 SWITCH_DECLARE(uint32_t) switch_event_channel_unbind(const char *event_channel, switch_event_channel_func_t func);
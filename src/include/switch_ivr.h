@@ -1017,6 +1017,39 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_kill_uuid(const char *uuid, switch_ca
 SWITCH_DECLARE(switch_status_t) switch_ivr_blind_transfer_ack(switch_core_session_t *session, switch_bool_t success);
 SWITCH_DECLARE(switch_status_t) switch_ivr_record_session_mask(switch_core_session_t *session, const char *file, switch_bool_t on);
 
+/*!
+  \brief Set the number of shared recording writer threads
+  \param threads number of writer threads (0 gives every recording its own thread)
+  \return the configured number of threads
+  \note Must be called before the core starts the writer pool
+*/
+SWITCH_DECLARE(uint32_t) switch_ivr_record_writer_set_threads(uint32_t threads);
+
+/*!
+  \brief Set how much audio a recording may have queued for the writers
+  \param bytes queue limit per recording, audio beyond it is dropped and counted
+  \return the configured limit
+*/
+SWITCH_DECLARE(switch_size_t) switch_ivr_record_writer_set_max_buffer(switch_size_t bytes);
+
+/*!
+  \brief Report recording writer counters (bytes queued, dropped, write latency)
+  \param stream stream for status
+*/
+SWITCH_DECLARE(void) switch_ivr_record_writer_status(switch_stream_handle_t *stream);
+
+/*!
+  \brief A recording buffer with no session or file behind it, filled the way a recording fills its own
+  \note Lets the unit tests check the buffer limit and drop accounting, recordings never use it
+*/
+typedef struct switch_ivr_record_buffer_s switch_ivr_record_buffer_t;
+SWITCH_DECLARE(switch_status_t) switch_ivr_record_buffer_create(switch_ivr_record_buffer_t **rbP, switch_size_t max_buffer, const char *file);
+SWITCH_DECLARE(switch_bool_t) switch_ivr_record_buffer_write(switch_ivr_record_buffer_t *rb, const void *data, switch_size_t datalen);
+SWITCH_DECLARE(switch_size_t) switch_ivr_record_buffer_read(switch_ivr_record_buffer_t *rb, void *data, switch_size_t datalen);
+SWITCH_DECLARE(switch_size_t) switch_ivr_record_buffer_inuse(switch_ivr_record_buffer_t *rb);
+SWITCH_DECLARE(switch_size_t) switch_ivr_record_buffer_dropped(switch_ivr_record_buffer_t *rb, switch_time_t *warned);
+SWITCH_DECLARE(void) switch_ivr_record_buffer_destroy(switch_ivr_record_buffer_t **rbP);
+
 
 SWITCH_DECLARE(switch_status_t) switch_ivr_stop_video_write_overlay_session(switch_core_session_t *session);
 SWITCH_DECLARE(switch_status_t) switch_ivr_video_write_overlay_session(switch_core_session_t *session, const char *img_path,
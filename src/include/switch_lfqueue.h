@@ -0,0 +1,122 @@
+/*
+ * FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ * Copyright (C) 2005-2014, Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Version: MPL 1.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ *
+ * The Initial Developer of the Original Code is
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Portions created by the Initial Developer are Copyright (C)
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Anthony Minessale II <anthm@freeswitch.org>
+ *
+ *
+ * switch_lfqueue.h -- Lock free bounded queues
+ *
+ */
+/*! \file switch_lfqueue.h
+    \brief Lock free bounded queues
+
+	Fixed size rings of pointers for the hot paths where switch_queue_t's mutex and condition
+	cost more than the work being queued.  Pushing and polling never take a lock, the mutex and
+	condition are only touched when the consumer is parked in a pop_timeout call.
+
+	The mpsc queue takes any number of producers.  Its pops are safe from any thread as well,
+	but only one consumer may park in switch_mpsc_queue_pop_timeout at a time.
+
+	The spsc queue is for exactly one producer thread and one consumer thread.
+*/
+
+#ifndef SWITCH_LFQUEUE_H
+#define SWITCH_LFQUEUE_H
+
+#include <switch.h>
+
+SWITCH_BEGIN_EXTERN_C
+
+/**
+ * @defgroup switch_lfqueue Lock free bounded queues
+ * @ingroup core1
+ * @{
+ */
+
+typedef struct switch_mpsc_queue switch_mpsc_queue_t;
+typedef struct switch_spsc_queue switch_spsc_queue_t;
+
+/**
+ * create a multiple producer queue
+ * @param queue the new queue
+ * @param capacity maximum number of entries, rounded up to a power of 2
+ * @param pool a pool to allocate the queue from
+ */
+SWITCH_DECLARE(switch_status_t) switch_mpsc_queue_create(switch_mpsc_queue_t **queue, uint32_t capacity, switch_memory_pool_t *pool);
+
+/**
+ * push an object, returning immediately if the queue is full
+ * @returns SWITCH_STATUS_SUCCESS or SWITCH_STATUS_FALSE when full
+ */
+SWITCH_DECLARE(switch_status_t) switch_mpsc_queue_trypush(switch_mpsc_queue_t *queue, void *data);
+
+/**
+ * push an object, yielding until there is room
+ */
+SWITCH_DECLARE(switch_status_t) switch_mpsc_queue_push(switch_mpsc_queue_t *queue, void *data);
+
+/**
+ * pop an object, returning immediately if the queue is empty
+ * @returns SWITCH_STATUS_SUCCESS or SWITCH_STATUS_FALSE when empty
+ */
+SWITCH_DECLARE(switch_status_t) switch_mpsc_queue_trypop(switch_mpsc_queue_t *queue, void **data);
+
+/**
+ * pop an object, parking up to timeout microseconds while the queue is empty
+ * @returns SWITCH_STATUS_SUCCESS or SWITCH_STATUS_TIMEOUT
+ */
+SWITCH_DECLARE(switch_status_t) switch_mpsc_queue_pop_timeout(switch_mpsc_queue_t *queue, void **data, switch_interval_time_t timeout);
+
+/**
+ * the number of queued objects, only a snapshot while producers are active
+ */
+SWITCH_DECLARE(uint32_t) switch_mpsc_queue_size(switch_mpsc_queue_t *queue);
+
+/**
+ * create a single producer, single consumer queue
+ * @param queue the new queue
+ * @param capacity maximum number of entries, rounded up to a power of 2
+ * @param pool a pool to allocate the queue from
+ */
+SWITCH_DECLARE(switch_status_t) switch_spsc_queue_create(switch_spsc_queue_t **queue, uint32_t capacity, switch_memory_pool_t *pool);
+SWITCH_DECLARE(switch_status_t) switch_spsc_queue_trypush(switch_spsc_queue_t *queue, void *data);
+SWITCH_DECLARE(switch_status_t) switch_spsc_queue_trypop(switch_spsc_queue_t *queue, void **data);
+SWITCH_DECLARE(switch_status_t) switch_spsc_queue_pop_timeout(switch_spsc_queue_t *queue, void **data, switch_interval_time_t timeout);
+SWITCH_DECLARE(uint32_t) switch_spsc_queue_size(switch_spsc_queue_t *queue);
+
+/** @} */
+
+SWITCH_END_EXTERN_C
+#endif
+/* For Emacs:
+ * Local Variables:
+ * mode:c
+ * indent-tabs-mode:t
+ * tab-width:4
+ * c-basic-offset:4
+ * End:
+ * For VIM:
+ * vim:set softtabstop=4 shiftwidth=4 tabstop=4 noet:
+ */
@@ -73,6 +73,23 @@ SWITCH_DECLARE(switch_status_t) switch_regex_match_partial(const char *target, c
 SWITCH_DECLARE(void) switch_capture_regex(switch_regex_t *re, int match_count, const char *field_data,
 										  int *ovector, const char *var, switch_cap_callback_t callback, void *user_data);
 
+/*!
+ \brief Set up the compiled pattern cache used by switch_regex_perform and switch_regex_match
+ \param pool the pool to allocate the cache lock from
+*/
+SWITCH_DECLARE(switch_status_t) switch_regex_init(switch_memory_pool_t *pool);
+SWITCH_DECLARE(void) switch_regex_shutdown(void);
+
+/*!
+ \brief Bound the number of compiled patterns kept, 0 compiles on every use
+*/
+SWITCH_DECLARE(void) switch_regex_set_cache_size(uint32_t size);
+
+/*!
+ \brief Write the compiled pattern cache counters
+*/
+SWITCH_DECLARE(void) switch_regex_cache_status(switch_stream_handle_t *stream);
+
 SWITCH_DECLARE_NONSTD(void) switch_regex_set_var_callback(const char *var, const char *val, void *user_data);
 SWITCH_DECLARE_NONSTD(void) switch_regex_set_event_header_callback(const char *var, const char *val, void *user_data);
 
@@ -52,7 +52,7 @@ SWITCH_BEGIN_EXTERN_C
   \{
 */
 /*! \brief An audio resampling handle */
-	typedef struct {
+	typedef struct switch_audio_resampler_s {
 	/*! a pointer to store the resampler object */
 	void *resampler;
 	/*! the rate to resample from in hz */
@@ -69,6 +69,12 @@ SWITCH_BEGIN_EXTERN_C
 	uint32_t to_size;
 	/*! the number of channels */
 	int channels;
+	/*! the quality the handle was created with */
+	int quality;
+	/*! integer ratio polyphase filter used in place of the speex resampler when set */
+	void *polyphase;
+	/*! the next idle handle in the resampler pool */
+	struct switch_audio_resampler_s *next;
 
 } switch_audio_resampler_t;
 
@@ -90,9 +96,24 @@ SWITCH_DECLARE(switch_status_t) switch_resample_perform_create(switch_audio_resa
 /*!
   \brief Destroy an existing resampler handle
   \param resampler the resampler handle to destroy
+  \note the handle is kept in a pool keyed by rate, channels and quality and handed out again by the next create that matches
  */
 SWITCH_DECLARE(void) switch_resample_destroy(switch_audio_resampler_t **resampler);
 
+/*!
+  \brief Use the integer ratio polyphase filter for 2x, 3x and 6x conversions (on by default)
+  \param enabled SWITCH_FALSE to always use the speex resampler
+ */
+SWITCH_DECLARE(void) switch_resample_set_polyphase(switch_bool_t enabled);
+
+/*!
+  \brief Report how the resampler pool is doing
+  \param hits creates served from the pool
+  \param misses creates that had to build a new handle
+  \param idle handles waiting in the pool
+ */
+SWITCH_DECLARE(void) switch_resample_pool_stats(uint64_t *hits, uint64_t *misses, uint32_t *idle);
+
 /*!
   \brief Resample one float buffer into another using specifications of a given handle
   \param resampler the resample handle
@@ -175,6 +196,41 @@ SWITCH_DECLARE(uint32_t) switch_merge_sln(int16_t *data, uint32_t samples, int16
 SWITCH_DECLARE(uint32_t) switch_unmerge_sln(int16_t *data, uint32_t samples, int16_t *other_data, uint32_t other_samples, int channels);
 SWITCH_DECLARE(void) switch_mux_channels(int16_t *data, switch_size_t samples, uint32_t orig_channels, uint32_t channels);
 
+/*!
+  \brief Pick the implementation behind the switch_sln_* mixing kernels
+  \param name auto, scalar, sse2 or avx2
+  \return SWITCH_STATUS_SUCCESS if the implementation is available on this cpu
+ */
+SWITCH_DECLARE(switch_status_t) switch_sln_kernels_select(const char *name);
+SWITCH_DECLARE(const char *) switch_sln_kernels_name(void);
+
+/*!
+  \brief Add a signed linear frame into a 32 bit mix accumulator
+ */
+SWITCH_DECLARE(void) switch_sln_accumulate(int32_t *acc, const int16_t *data, uint32_t samples);
+
+/*!
+  \brief Take a signed linear frame back out of a 32 bit mix accumulator
+ */
+SWITCH_DECLARE(void) switch_sln_deaccumulate(int32_t *acc, const int16_t *data, uint32_t samples);
+
+/*!
+  \brief Saturate a 32 bit mix accumulator down to signed linear
+ */
+SWITCH_DECLARE(void) switch_sln_narrow(int16_t *data, const int32_t *acc, uint32_t samples);
+
+/*!
+  \brief Saturate a 32 bit mix accumulator down to signed linear minus the listener's own contribution
+  \param self the listener's own audio, may be NULL
+  \param self_samples how much of self is valid, the rest of the frame is narrowed as is
+ */
+SWITCH_DECLARE(void) switch_sln_mix_minus(int16_t *data, const int32_t *acc, const int16_t *self, uint32_t self_samples, uint32_t samples);
+
+/*!
+  \brief Scale a signed linear frame by a fixed point gain, 4096 is unity
+ */
+SWITCH_DECLARE(void) switch_sln_gain(int16_t *data, uint32_t samples, int32_t gain);
+
 #define switch_resample_calc_buffer_size(_to, _from, _srclen) ((uint32_t)(((float)_to / (float)_from) * (float)_srclen) * 2)
 
 SWITCH_DECLARE(void) switch_agc_set(switch_agc_t *agc, uint32_t energy_avg, 
@@ -204,6 +204,21 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_set_remote_ssrc(switch_rtp_t *rtp_ses
 */
 SWITCH_DECLARE(switch_port_t) switch_rtp_set_end_port(switch_port_t port);
 
+/*!
+  \brief Set the number of shared media reactor threads
+  \param threads number of epoll driven I/O threads (0 disables the reactor)
+  \return the configured number of threads
+  \note Must be called before switch_rtp_init, sessions created afterwards
+        have their sockets serviced by the reactor with recvmmsg/sendmmsg
+*/
+SWITCH_DECLARE(uint32_t) switch_rtp_set_media_reactor_threads(uint32_t threads);
+
+/*!
+  \brief Report media reactor counters (packets per syscall etc.)
+  \param stream stream for status
+*/
+SWITCH_DECLARE(void) switch_rtp_media_reactor_status(switch_stream_handle_t *stream);
+
 /*!
   \brief Request a new port to be used for media
   \param ip the ip to request a port from
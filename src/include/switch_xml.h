@@ -357,7 +357,12 @@ SWITCH_DECLARE(switch_xml_t) switch_xml_root(void);
 ///\param root a pointer to point at the root node
 ///\param node a pointer to the requested node
 ///\param params optional URL formatted params to pass to external gateways
+///\param clone return a private copy of the node rather than a reference into the document
 ///\return SWITCH_STATUS_SUCCESS if successful root and node will be assigned
+///\note without clone the root is shared and must be treated as read only: the main root always was,
+///      and for sections listed in xml-cache-sections a binding result is now shared with the cache and
+///      every other caller of the same key instead of being a private document.  Release it with
+///      switch_xml_free() and switch_xml_dup() anything that has to be changed.
 SWITCH_DECLARE(switch_status_t) switch_xml_locate(_In_z_ const char *section,
 												  _In_opt_z_ const char *tag_name,
 												  _In_opt_z_ const char *key_name,
@@ -387,6 +392,27 @@ SWITCH_DECLARE(switch_status_t) switch_xml_locate_user_in_domain(_In_z_ const ch
 SWITCH_DECLARE(switch_status_t) switch_xml_locate_user_merged(const char *key, const char *user_name, const char *domain_name,
 															  const char *ip, switch_xml_t *user, switch_event_t *params);
 SWITCH_DECLARE(uint32_t) switch_xml_clear_user_cache(const char *key, const char *user_name, const char *domain_name);
+
+/* event headers that tell two binding lookups apart unless xml-cache-key-params says otherwise */
+#define SWITCH_XML_RESULT_CACHE_KEY_PARAMS "Event-Calling-Function,Hunt-Context,Hunt-Destination-Number,Hunt-Caller-ID-Number,"\
+	"Caller-Context,Caller-Destination-Number,Caller-Caller-ID-Number,action,purpose,profile,key,user,domain"
+
+///\brief flush cached binding results
+///\param section only flush this section, NULL for all of them
+///\return the number of documents released
+SWITCH_DECLARE(uint32_t) switch_xml_clear_result_cache(const char *section);
+
+///\brief choose which sections have binding results cached, e.g. "directory,dialplan" (empty disables the cache)
+SWITCH_DECLARE(void) switch_xml_set_result_cache_sections(const char *sections);
+
+///\brief default lifetime in seconds for cached binding results, a cache-ttl attribute on the returned document wins
+SWITCH_DECLARE(void) switch_xml_set_result_cache_ttl(uint32_t seconds);
+
+///\brief comma separated request params that are part of the cache key besides section, tag and key
+SWITCH_DECLARE(void) switch_xml_set_result_cache_key_params(const char *params);
+
+///\brief write binding result cache counters to a stream as CSV
+SWITCH_DECLARE(void) switch_xml_result_cache_status(switch_stream_handle_t *stream);
 SWITCH_DECLARE(void) switch_xml_merge_user(switch_xml_t user, switch_xml_t domain, switch_xml_t group);
 
 SWITCH_DECLARE(switch_xml_t) switch_xml_dup(switch_xml_t xml);
@@ -716,6 +716,50 @@ SWITCH_STANDARD_API(db_cache_function)
 	return SWITCH_STATUS_SUCCESS;
 }
 
+SWITCH_STANDARD_API(event_dispatch_function)
+{
+	if (zstr(cmd) || !strcasecmp(cmd, "status")) {
+		switch_event_dispatch_status(stream);
+	} else {
+		stream->write_function(stream, "-USAGE: %s\n", "status");
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_STANDARD_API(rtp_reactor_function)
+{
+	if (zstr(cmd) || !strcasecmp(cmd, "status")) {
+		switch_rtp_media_reactor_status(stream);
+	} else {
+		stream->write_function(stream, "-USAGE: %s\n", "status");
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_STANDARD_API(record_writer_function)
+{
+	if (zstr(cmd) || !strcasecmp(cmd, "status")) {
+		switch_ivr_record_writer_status(stream);
+	} else {
+		stream->write_function(stream, "-USAGE: %s\n", "status");
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_STANDARD_API(channel_registry_function)
+{
+	if (zstr(cmd) || !strcasecmp(cmd, "status")) {
+		switch_channel_registry_status(stream);
+	} else {
+		stream->write_function(stream, "-USAGE: %s\n", "status");
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 SWITCH_STANDARD_API(host_lookup_function)
 {
 	char host[256] = "";
@@ -5593,13 +5637,39 @@ SWITCH_STANDARD_API(coalesce_function)
 	return status;
 }
 
-#define SHOW_SYNTAX "codec|endpoint|application|api|dialplan|file|timer|calls [count]|channels [count|like <match string>]|calls|detailed_calls|bridged_calls|detailed_bridged_calls|aliases|complete|chat|management|modules|nat_map|say|interfaces|interface_types|tasks|limits|status"
+#define SHOW_SYNTAX "codec|endpoint|application|api|dialplan|file|timer|calls [count]|channels [count|like <match string>]|calls|detailed_calls|bridged_calls|detailed_bridged_calls|aliases|complete|chat|management|modules|nat_map|say|interfaces|interface_types|tasks|limits|regex_cache|status"
+/* the channel and call listings come from the core channel registry instead of the db */
+struct show_registry {
+	int active;
+	switch_channel_registry_view_t view;
+	const char *like;
+	switch_bool_t bridged_only;
+};
+
+static void show_execute(switch_cache_db_handle_t *db, const char *sql, struct show_registry *registry,
+						 switch_core_db_callback_func_t callback, struct holder *holder, char **errmsg)
+{
+	if (!registry->active) {
+		switch_cache_db_execute_sql_callback(db, sql, callback, holder, errmsg);
+	} else if (holder->justcount) {
+		char count[32];
+		char *argv[1] = { count };
+		char *names[1] = { "count" };
+
+		switch_snprintf(count, sizeof(count), "%u", switch_channel_registry_query(registry->view, registry->like, registry->bridged_only, NULL, NULL));
+		callback(holder, 1, argv, names);
+	} else {
+		switch_channel_registry_query(registry->view, registry->like, registry->bridged_only, callback, holder);
+	}
+}
+
 SWITCH_STANDARD_API(show_function)
 {
 	char sql[1024];
-	char *errmsg;
-	switch_cache_db_handle_t *db;
+	char *errmsg = NULL;
+	switch_cache_db_handle_t *db = NULL;
 	struct holder holder = { 0 };
+	struct show_registry registry = { 0 };
 	int help = 0;
 	char *mydata = NULL, *argv[6] = { 0 };
 	char *command = NULL, *as = NULL;
@@ -5613,16 +5683,6 @@ SWITCH_STANDARD_API(show_function)
 	set_format(holder.format, stream);
 	html = holder.format->html; /* html is just a shortcut */
 
-	if (!(cflags & SCF_USE_SQL)) {
-		stream->write_function(stream, "-ERR SQL disabled, no data available!\n");
-		return SWITCH_STATUS_SUCCESS;
-	}
-
-	if (switch_core_db_handle(&db) != SWITCH_STATUS_SUCCESS) {
-		stream->write_function(stream, "%s", "-ERR Database error!\n");
-		return SWITCH_STATUS_SUCCESS;
-	}
-
 	holder.justcount = 0;
 
 	if (cmd && *cmd && (mydata = strdup(cmd))) {
@@ -5645,6 +5705,9 @@ SWITCH_STANDARD_API(show_function)
 		}
 		switch_api_execute(command, as, NULL, stream);
 		goto end;
+	} else if (!strcasecmp(command, "regex_cache")) {
+		switch_regex_cache_status(stream);
+		goto end;
 	/* If you change the field qty or order of any of these select          */
 	/* statements, you must also change show_callback and friends to match! */
 	} else if (!strncasecmp(command, "codec", 5) ||
@@ -5722,9 +5785,9 @@ SWITCH_STANDARD_API(show_function)
 		}
 
 		if (!strcasecmp(command, "calls")) {
-			switch_snprintfv(sql, sizeof(sql), "select * from basic_calls where hostname='%q' order by call_created_epoch", switch_core_get_switchname());
+			registry.active = 1;
+			registry.view = SWITCH_CHANNEL_REGISTRY_CALLS;
 			if (argv[1] && !strcasecmp(argv[1], "count")) {
-				switch_snprintfv(sql, sizeof(sql), "select count(*) from basic_calls where hostname='%q'", switch_core_get_switchname());
 				holder.justcount = 1;
 				if (argv[3] && !strcasecmp(argv[2], "as")) {
 					as = argv[3];
@@ -5741,48 +5804,39 @@ SWITCH_STANDARD_API(show_function)
 			}
 		} else if (!strcasecmp(command, "channels") && argv[1] && !strcasecmp(argv[1], "like")) {
 			if (argv[2]) {
-				char *p;
-				for (p = argv[2]; p && *p; p++) {
-					if (*p == '\'' || *p == ';') {
-						*p = ' ';
-					}
-				}
-				if (strchr(argv[2], '%')) {
-					switch_snprintfv(sql, sizeof(sql),
-						"select * from channels where hostname='%q' and uuid like '%q' or name like '%q' or cid_name like '%q' or cid_num like '%q' or presence_data like '%q' or accountcode like '%q' order by created_epoch",
-						switch_core_get_switchname(), argv[2], argv[2], argv[2], argv[2], argv[2], argv[2]);
-				} else {
-					switch_snprintfv(sql, sizeof(sql),
-						"select * from channels where hostname='%q' and uuid like '%%%q%%' or name like '%%%q%%' or cid_name like '%%%q%%' or cid_num like '%%%q%%' or presence_data like '%%%q%%' or accountcode like '%%%q%%' order by created_epoch",
-						switch_core_get_switchname(), argv[2], argv[2], argv[2], argv[2], argv[2], argv[2]);
-				}
+				registry.like = argv[2];
 				if (argv[4] && !strcasecmp(argv[3], "as")) {
 					as = argv[4];
 				}
-			} else {
-				switch_snprintfv(sql, sizeof(sql), "select * from channels where hostname='%q' order by created_epoch", switch_core_get_switchname());
 			}
+			registry.active = 1;
+			registry.view = SWITCH_CHANNEL_REGISTRY_CHANNELS;
 		} else if (!strcasecmp(command, "channels")) {
-			switch_snprintfv(sql, sizeof(sql), "select * from channels where hostname='%q' order by created_epoch", switch_core_get_switchname());
+			registry.active = 1;
+			registry.view = SWITCH_CHANNEL_REGISTRY_CHANNELS;
 			if (argv[1] && !strcasecmp(argv[1], "count")) {
-				switch_snprintfv(sql, sizeof(sql), "select count(*) from channels where hostname='%q'", switch_core_get_switchname());
 				holder.justcount = 1;
 				if (argv[3] && !strcasecmp(argv[2], "as")) {
 					as = argv[3];
 				}
 			}
 		} else if (!strcasecmp(command, "detailed_calls")) {
-			switch_snprintfv(sql, sizeof(sql), "select * from detailed_calls where hostname='%q' order by created_epoch", switch_core_get_switchname());
+			registry.active = 1;
+			registry.view = SWITCH_CHANNEL_REGISTRY_DETAILED_CALLS;
 			if (argv[2] && !strcasecmp(argv[1], "as")) {
 				as = argv[2];
 			}
 		} else if (!strcasecmp(command, "bridged_calls")) {
-			switch_snprintfv(sql, sizeof(sql), "select * from basic_calls where b_uuid is not null and hostname='%q' order by created_epoch", switch_core_get_switchname());
+			registry.active = 1;
+			registry.view = SWITCH_CHANNEL_REGISTRY_CALLS;
+			registry.bridged_only = SWITCH_TRUE;
 			if (argv[2] && !strcasecmp(argv[1], "as")) {
 				as = argv[2];
 			}
 		} else if (!strcasecmp(command, "detailed_bridged_calls")) {
-			switch_snprintfv(sql, sizeof(sql), "select * from detailed_calls where b_uuid is not null and hostname='%q' order by created_epoch", switch_core_get_switchname());
+			registry.active = 1;
+			registry.view = SWITCH_CHANNEL_REGISTRY_DETAILED_CALLS;
+			registry.bridged_only = SWITCH_TRUE;
 			if (argv[2] && !strcasecmp(argv[1], "as")) {
 				as = argv[2];
 			}
@@ -5793,6 +5847,18 @@ SWITCH_STANDARD_API(show_function)
 		}
 	}
 
+	if (!registry.active) {
+		if (!(cflags & SCF_USE_SQL)) {
+			stream->write_function(stream, "-ERR SQL disabled, no data available!\n");
+			goto end;
+		}
+
+		if (switch_core_db_handle(&db) != SWITCH_STATUS_SUCCESS) {
+			stream->write_function(stream, "%s", "-ERR Database error!\n");
+			goto end;
+		}
+	}
+
 	holder.stream = stream;
 	holder.count = 0;
 
@@ -5819,7 +5885,7 @@ SWITCH_STANDARD_API(show_function)
 				holder.delim = ",";
 			}
 		}
-		switch_cache_db_execute_sql_callback(db, sql, show_callback, &holder, &errmsg);
+		show_execute(db, sql, &registry, show_callback, &holder, &errmsg);
 		if (html) {
 			holder.stream->write_function(holder.stream, "</table>");
 		}
@@ -5835,7 +5901,7 @@ SWITCH_STANDARD_API(show_function)
 			stream->write_function(stream, "%s%u total.%s", nl, holder.count, nl);
 		}
 	} else if (!strcasecmp(as, "xml")) {
-		switch_cache_db_execute_sql_callback(db, sql, show_as_xml_callback, &holder, &errmsg);
+		show_execute(db, sql, &registry, show_as_xml_callback, &holder, &errmsg);
 
 		if (errmsg) {
 			stream->write_function(stream, "-ERR SQL error [%s]\n", errmsg);
@@ -5863,7 +5929,7 @@ SWITCH_STANDARD_API(show_function)
 		}
 	} else if (!strcasecmp(as, "json")) {
 
-		switch_cache_db_execute_sql_callback(db, sql, show_as_json_callback, &holder, &errmsg);
+		show_execute(db, sql, &registry, show_as_json_callback, &holder, &errmsg);
 
 		if (errmsg) {
 			stream->write_function(stream, "-ERR SQL Error [%s]\n", errmsg);
@@ -6592,6 +6658,7 @@ SWITCH_STANDARD_API(xml_flush_function)
 		r = switch_xml_clear_user_cache(argv[0], argv[1], argv[2]);
 	} else {
 		r = switch_xml_clear_user_cache(NULL, NULL, NULL);
+		r += switch_xml_clear_result_cache(NULL);
 	}
 
 
@@ -6601,6 +6668,30 @@ SWITCH_STANDARD_API(xml_flush_function)
 	return SWITCH_STATUS_SUCCESS;
 }
 
+#define XML_CACHE_SYNTAX "status|flush [<section>]"
+SWITCH_STANDARD_API(xml_cache_function)
+{
+	char *mycmd = NULL, *argv[2] = { 0 };
+	int argc = 0;
+	uint32_t r;
+
+	if (!zstr(cmd) && (mycmd = strdup(cmd))) {
+		argc = switch_split(mycmd, ' ', argv);
+	}
+
+	if (argc >= 1 && !strcasecmp(argv[0], "status")) {
+		switch_xml_result_cache_status(stream);
+	} else if (argc >= 1 && !strcasecmp(argv[0], "flush")) {
+		r = switch_xml_clear_result_cache(argv[1]);
+		stream->write_function(stream, "+OK cleared %u entr%s\n", r, r == 1 ? "y" : "ies");
+	} else {
+		stream->write_function(stream, "-USAGE: %s\n", XML_CACHE_SYNTAX);
+	}
+
+	switch_safe_free(mycmd);
+	return SWITCH_STATUS_SUCCESS;
+}
+
 SWITCH_STANDARD_API(escape_function)
 {
 	int len;
@@ -7440,6 +7531,7 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_commands_load)
 	SWITCH_ADD_API(commands_api_interface, "domain_data", "Find domain data", domain_data_function, "<domain> [var|param|attr] <name>");
 	SWITCH_ADD_API(commands_api_interface, "domain_exists", "Check if a domain exists", domain_exists_function, "<domain>");
 	SWITCH_ADD_API(commands_api_interface, "echo", "Echo", echo_function, "<data>");
+	SWITCH_ADD_API(commands_api_interface, "event_dispatch", "Show event dispatch queue counters", event_dispatch_function, "status");
 	SWITCH_ADD_API(commands_api_interface, "event_channel_broadcast", "Broadcast", event_channel_broadcast_api_function, "<channel> <json>");
 	SWITCH_ADD_API(commands_api_interface, "escape", "Escape a string", escape_function, "<data>");
 	SWITCH_ADD_API(commands_api_interface, "eval", "eval (noop)", eval_function, "[uuid:<uuid> ]<expression>");
@@ -7481,6 +7573,9 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_commands_load)
 	SWITCH_ADD_API(commands_api_interface, "reloadacl", "Reload XML", reload_acl_function, "");
 	SWITCH_ADD_API(commands_api_interface, "reload", "Reload module", reload_function, UNLOAD_SYNTAX);
 	SWITCH_ADD_API(commands_api_interface, "reloadxml", "Reload XML", reload_xml_function, "");
+	SWITCH_ADD_API(commands_api_interface, "rtp_reactor", "Show media reactor counters", rtp_reactor_function, "status");
+	SWITCH_ADD_API(commands_api_interface, "record_writer", "Show recording writer counters", record_writer_function, "status");
+	SWITCH_ADD_API(commands_api_interface, "channel_registry", "Show channel registry counters", channel_registry_function, "status");
 	SWITCH_ADD_API(commands_api_interface, "replace", "Replace a string", replace_function, "<data>|<string1>|<string2>");
 	SWITCH_ADD_API(commands_api_interface, "say_string", "", say_string_function, SAY_STRING_SYNTAX);
 	SWITCH_ADD_API(commands_api_interface, "sched_api", "Schedule an api command", sched_api_function, SCHED_SYNTAX);
@@ -7564,6 +7659,7 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_commands_load)
 	SWITCH_ADD_API(commands_api_interface, "uuid_jitterbuffer", "uuid_jitterbuffer", uuid_jitterbuffer_function, JITTERBUFFER_SYNTAX);
 	SWITCH_ADD_API(commands_api_interface, "uuid_zombie_exec", "Set zombie_exec flag on the specified uuid", uuid_zombie_exec_function, "<uuid>");
 	SWITCH_ADD_API(commands_api_interface, "uuid_xfer_zombie", "Allow A leg to hangup and continue originating", uuid_xfer_zombie, XFER_ZOMBIE_SYNTAX);
+	SWITCH_ADD_API(commands_api_interface, "xml_cache", "Binding result cache", xml_cache_function, XML_CACHE_SYNTAX);
 	SWITCH_ADD_API(commands_api_interface, "xml_flush_cache", "Clear xml cache", xml_flush_function, "<id> <key> <val>");
 	SWITCH_ADD_API(commands_api_interface, "xml_locate", "Find some xml", xml_locate_function, "[root | <section> <tag> <tag_attr_name> <tag_attr_val>]");
 	SWITCH_ADD_API(commands_api_interface, "xml_wrap", "Wrap another api command in xml", xml_wrap_api_function, "<command> <args>");
@@ -7587,6 +7683,7 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_commands_load)
 	switch_console_set_complete("add complete add");
 	switch_console_set_complete("add complete del");
 	switch_console_set_complete("add db_cache status");
+	switch_console_set_complete("add event_dispatch status");
 	switch_console_set_complete("add fsctl debug_level");
 	switch_console_set_complete("add fsctl debug_pool");
 	switch_console_set_complete("add fsctl debug_sql");
@@ -7647,6 +7744,9 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_commands_load)
 	switch_console_set_complete("add nat_map status");
 	switch_console_set_complete("add reload ::console::list_loaded_modules");
 	switch_console_set_complete("add reloadacl reloadxml");
+	switch_console_set_complete("add rtp_reactor status");
+	switch_console_set_complete("add record_writer status");
+	switch_console_set_complete("add channel_registry status");
 	switch_console_set_complete("add show aliases");
 	switch_console_set_complete("add show api");
 	switch_console_set_complete("add show application");
@@ -7668,6 +7768,7 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_commands_load)
 	switch_console_set_complete("add show management");
 	switch_console_set_complete("add show modules");
 	switch_console_set_complete("add show nat_map");
+	switch_console_set_complete("add show regex_cache");
 	switch_console_set_complete("add show registrations");
 	switch_console_set_complete("add show say");
 	switch_console_set_complete("add show status");
@@ -7761,6 +7862,8 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_commands_load)
 	switch_console_set_complete("add uuid_video_bandwidth ::console::list_uuid");
 	switch_console_set_complete("add uuid_xfer_zombie ::console::list_uuid");
 	switch_console_set_complete("add version");
+	switch_console_set_complete("add xml_cache status");
+	switch_console_set_complete("add xml_cache flush");
 	switch_console_set_complete("add uuid_warning ::console::list_uuid");
 	switch_console_set_complete("add ...");
 	switch_console_set_complete("add file_exists");
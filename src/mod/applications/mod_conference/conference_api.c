@@ -123,7 +123,9 @@ api_command_t conference_api_sub_commands[] = {
 	{"vid-fgimg", (void_fn_t) & conference_api_sub_canvas_fgimg, CONF_API_SUB_ARGS_SPLIT, "vid-fgimg", "<file> | clear [<canvas-id>]"},
 	{"vid-bgimg", (void_fn_t) & conference_api_sub_canvas_bgimg, CONF_API_SUB_ARGS_SPLIT, "vid-bgimg", "<file> | clear [<canvas-id>]"},
 	{"vid-bandwidth", (void_fn_t) & conference_api_sub_vid_bandwidth, CONF_API_SUB_ARGS_SPLIT, "vid-bandwidth", "<BW>"},
-	{"vid-personal", (void_fn_t) & conference_api_sub_vid_personal, CONF_API_SUB_ARGS_SPLIT, "vid-personal", "[on|off]"}
+	{"vid-personal", (void_fn_t) & conference_api_sub_vid_personal, CONF_API_SUB_ARGS_SPLIT, "vid-personal", "[on|off]"},
+	{"encode-stats", (void_fn_t) & conference_api_sub_encode_stats, CONF_API_SUB_ARGS_SPLIT, "encode-stats", ""},
+	{"mixer-stats", (void_fn_t) & conference_api_sub_mixer_stats, CONF_API_SUB_ARGS_SPLIT, "mixer-stats", ""}
 };
 
 switch_status_t conference_api_sub_pause_play(conference_obj_t *conference, switch_stream_handle_t *stream, int argc, char **argv)
@@ -2239,6 +2241,11 @@ switch_status_t conference_api_sub_list(conference_obj_t *conference, switch_str
 				fcount++;
 			}
 
+			if (conference_utils_test_flag(conference, CFLAG_MINIMIZE_AUDIO_ENCODING)) {
+				stream->write_function(stream, "%sminimize_audio_encoding", fcount ? "|" : "");
+				fcount++;
+			}
+
 			if (conference_utils_test_flag(conference, CFLAG_MANAGE_INBOUND_VIDEO_BITRATE)) {
 				stream->write_function(stream, "%smanage_inbound_bitrate", fcount ? "|" : "");
 				fcount++;
@@ -3319,6 +3326,10 @@ void _conference_api_sub_relate_set_member_relationship(conference_obj_t *confer
 				switch_core_session_request_video_refresh(member->session);
 			}
 
+			switch_mutex_lock(conference->member_mutex);
+			conference->relationship_seq++;
+			switch_mutex_unlock(conference->member_mutex);
+
 			stream->write_function(stream, "+OK %u->%u %s set\n", id, oid, action);
 		} else {
 			stream->write_function(stream, "-ERR error!\n");
@@ -3928,6 +3939,61 @@ switch_status_t conference_api_sub_file_vol(conference_obj_t *conference, switch
 	}
 }
 
+switch_status_t conference_api_sub_encode_stats(conference_obj_t *conference, switch_stream_handle_t *stream, int argc, char **argv)
+{
+	int i;
+	uint64_t total;
+
+	switch_assert(conference != NULL);
+	switch_assert(stream != NULL);
+
+	if (!conference_utils_test_flag(conference, CFLAG_MINIMIZE_AUDIO_ENCODING)) {
+		stream->write_function(stream, "-ERR minimize-audio-encoding is not enabled for conference %s\n", conference->name);
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	switch_mutex_lock(conference->mutex);
+
+	total = conference->audio_encodes + conference->audio_encodes_saved;
+
+	stream->write_function(stream, "+OK conference %s shared audio encodes %" SWITCH_UINT64_T_FMT " saved %" SWITCH_UINT64_T_FMT " (%d%%)\n",
+						   conference->name, conference->audio_encodes, conference->audio_encodes_saved,
+						   total ? (int) (conference->audio_encodes_saved * 100 / total) : 0);
+
+	for (i = 0; i < conference->audio_write_codecs_count; i++) {
+		audio_codec_set_t *codec_set = conference->audio_write_codecs[i];
+
+		if (!switch_core_codec_ready(&codec_set->codec)) {
+			continue;
+		}
+
+		stream->write_function(stream, "group %d codec %s@%uh@%ui encodes %" SWITCH_UINT64_T_FMT " frames %" SWITCH_UINT64_T_FMT "\n",
+							   i, codec_set->codec.implementation->iananame, codec_set->codec.implementation->actual_samples_per_second,
+							   codec_set->codec.implementation->microseconds_per_packet / 1000, codec_set->encodes, codec_set->frames);
+	}
+
+	switch_mutex_unlock(conference->mutex);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+switch_status_t conference_api_sub_mixer_stats(conference_obj_t *conference, switch_stream_handle_t *stream, int argc, char **argv)
+{
+	switch_assert(conference != NULL);
+	switch_assert(stream != NULL);
+
+	switch_mutex_lock(conference->mutex);
+
+	stream->write_function(stream, "+OK conference %s mixer threads %d ticks %" SWITCH_UINT64_T_FMT " parallel %" SWITCH_UINT64_T_FMT
+						   " overruns %" SWITCH_UINT64_T_FMT " last %" SWITCH_TIME_T_FMT "us max %" SWITCH_TIME_T_FMT "us interval %dms\n",
+						   conference->name, conference->mixer ? conference->mixer->threads : 0, conference->mix_ticks, conference->mix_parallel_ticks,
+						   conference->mix_overruns, conference->mix_tick_last, conference->mix_tick_max, conference->interval);
+
+	switch_mutex_unlock(conference->mutex);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 switch_status_t conference_api_sub_pin(conference_obj_t *conference, switch_stream_handle_t *stream, int argc, char **argv)
 {
 	switch_assert(conference != NULL);
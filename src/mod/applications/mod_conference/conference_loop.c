@@ -1447,6 +1447,7 @@ void conference_loop_output(conference_member_t *member)
 		int use_timer = 0;
 		switch_buffer_t *use_buffer = NULL;
 		uint32_t mux_used = 0;
+		void *pop = NULL;
 
 
 		//if (member->reset_media || switch_channel_test_flag(member->channel, CF_CONFERENCE_RESET_MEDIA)) {
@@ -1519,6 +1520,26 @@ void conference_loop_output(conference_member_t *member)
 
 		if (switch_channel_test_app_flag(channel, CF_APP_TAGGED)) {
 			conference_utils_member_set_flag_locked(member, MFLAG_FLUSH_BUFFER);
+		} else if (member->audio_packets && switch_queue_trypop(member->audio_packets, &pop) == SWITCH_STATUS_SUCCESS && pop) {
+			/* the mixer already encoded this interval once for everybody sharing our codec, pass the payload straight out.
+			   The packet is shared with the rest of the group so only our own copy of the frame is touched */
+			audio_codec_packet_t *packet = (audio_codec_packet_t *) pop;
+			switch_codec_t *write_codec = switch_core_session_get_write_codec(member->session);
+			switch_frame_t frame = packet->frame;
+
+			low_count = 0;
+
+			if (write_codec && write_codec->implementation == packet->codec_set->codec.implementation) {
+				frame.codec = write_codec;
+
+				if (switch_core_session_write_frame(member->session, &frame, SWITCH_IO_FLAG_NONE, 0) != SWITCH_STATUS_SUCCESS) {
+					conference_audio_codec_packet_release(packet);
+					switch_mutex_unlock(member->write_mutex);
+					break;
+				}
+			}
+
+			conference_audio_codec_packet_release(packet);
 		} else if (mux_used >= bytes) {
 			/* Flush the output buffer and write all the data (presumably muxed) back to the channel */
 			switch_mutex_lock(member->audio_out_mutex);
@@ -1561,6 +1582,8 @@ void conference_loop_output(conference_member_t *member)
 				switch_buffer_zero(member->mux_buffer);
 				switch_mutex_unlock(member->audio_out_mutex);
 			}
+
+			conference_audio_codec_flush_member(member);
 			conference_utils_member_clear_flag_locked(member, MFLAG_FLUSH_BUFFER);
 		}
 
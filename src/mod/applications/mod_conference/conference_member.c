@@ -624,6 +624,7 @@ conference_relationship_t *conference_member_add_relationship(conference_member_
 	lock_member(member);
 	switch_mutex_lock(member->conference->member_mutex);
 	member->conference->relationship_total++;
+	member->conference->relationship_seq++;
 	switch_mutex_unlock(member->conference->member_mutex);
 	rel->next = member->relationships;
 	member->relationships = rel;
@@ -674,6 +675,7 @@ switch_status_t conference_member_del_relationship(conference_member_t *member,
 
 			switch_mutex_lock(member->conference->member_mutex);
 			member->conference->relationship_total--;
+			member->conference->relationship_seq++;
 			switch_mutex_unlock(member->conference->member_mutex);
 
 			continue;
@@ -1036,6 +1038,7 @@ switch_status_t conference_member_add(conference_obj_t *conference, conference_m
 	switch_mutex_lock(conference->member_mutex);
 	member->next = conference->members;
 	conference->members = member;
+	conference->relationship_seq++;
 	switch_mutex_unlock(conference->member_mutex);
 	switch_mutex_unlock(conference->mutex);
 	status = SWITCH_STATUS_SUCCESS;
@@ -1231,6 +1234,8 @@ switch_status_t conference_member_del(conference_obj_t *conference, conference_m
 		last = imember;
 	}
 
+	conference->relationship_seq++;
+
 	switch_mutex_lock(member->flag_mutex);
 	switch_img_free(&member->avatar_png_img);
 	switch_img_free(&member->video_mute_img);
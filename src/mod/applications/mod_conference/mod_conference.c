@@ -204,6 +204,502 @@ void conference_send_notify(conference_obj_t *conference, const char *status, co
 }
 
 
+/* Work out once per membership or relationship change which members each listener must not hear
+   so the mixer only has to look at a bitmask per tick instead of walking every relationship per sample. */
+void conference_mix_exclude_rebuild(conference_obj_t *conference)
+{
+	conference_member_t *imember, *omember;
+	uint32_t count = 0, words, i = 0;
+
+	switch_mutex_lock(conference->member_mutex);
+
+	conference->mix_exclude_seq = conference->relationship_seq;
+
+	for (imember = conference->members; imember; imember = imember->next) {
+		count++;
+	}
+
+	words = (count + 31) / 32;
+
+	switch_safe_free(conference->mix_members);
+	switch_safe_free(conference->mix_exclude);
+	switch_safe_free(conference->mix_pinned);
+	conference->mix_members_count = 0;
+	conference->mix_exclude_words = words;
+
+	if (!count) {
+		switch_mutex_unlock(conference->member_mutex);
+		return;
+	}
+
+	switch_zmalloc(conference->mix_members, count * sizeof(conference_member_t *));
+	switch_zmalloc(conference->mix_exclude, count * words * sizeof(uint32_t));
+	switch_zmalloc(conference->mix_pinned, words * sizeof(uint32_t));
+
+	for (imember = conference->members; imember; imember = imember->next) {
+		imember->mix_index = i;
+		conference->mix_members[i++] = imember;
+	}
+
+	conference->mix_members_count = count;
+
+	for (omember = conference->members; omember; omember = omember->next) {
+		uint32_t *row = conference->mix_exclude + omember->mix_index * words;
+
+		omember->mix_excluded = 0;
+
+		for (imember = conference->members; imember; imember = imember->next) {
+			conference_relationship_t *rel;
+			int exclude = 0;
+
+			if (imember == omember) {
+				continue;
+			}
+
+			for (rel = imember->relationships; rel; rel = rel->next) {
+				if ((rel->id == omember->id || rel->id == 0) && !switch_test_flag(rel, RFLAG_CAN_SPEAK)) {
+					exclude = 1;
+					break;
+				}
+			}
+
+			if (!exclude) {
+				for (rel = omember->relationships; rel; rel = rel->next) {
+					if ((rel->id == imember->id || rel->id == 0) && !switch_test_flag(rel, RFLAG_CAN_HEAR)) {
+						exclude = 1;
+						break;
+					}
+				}
+			}
+
+			if (exclude) {
+				row[imember->mix_index / 32] |= 1U << (imember->mix_index % 32);
+				omember->mix_excluded = 1;
+			}
+		}
+	}
+
+	switch_mutex_unlock(conference->member_mutex);
+}
+
+/* Produce one member's share of the tick: silence if they can't hear, otherwise the main frame minus their own voice
+   and minus anybody their relationships exclude.  With pinned set only members pinned for this tick are touched. */
+switch_size_t conference_mix_member(conference_obj_t *conference, conference_member_t *omember, int32_t *main_frame,
+									int32_t *mix_frame, int16_t *write_frame, uint32_t bytes, int use_masks, uint32_t *pinned)
+{
+	conference_member_t *imember;
+	int32_t *mix = main_frame;
+	switch_size_t ok = 1;
+
+	if (!conference_utils_member_test_flag(omember, MFLAG_CAN_HEAR)) {
+		switch_mutex_lock(omember->audio_out_mutex);
+		memset(write_frame, 255, bytes);
+		switch_buffer_write(omember->mux_buffer, write_frame, bytes);
+		switch_mutex_unlock(omember->audio_out_mutex);
+		return ok;
+	}
+
+	/* when there are relationships, take out everybody this member should not be hearing.
+	   Who that is only changes with membership or relationships so it comes from the precomputed exclusion mask.
+	*/
+	if (use_masks && omember->mix_excluded) {
+		uint32_t *row = conference->mix_exclude + omember->mix_index * conference->mix_exclude_words;
+		uint32_t i;
+
+		memcpy(mix_frame, main_frame, bytes / 2 * sizeof(int32_t));
+		mix = mix_frame;
+
+		for (i = 0; i < conference->mix_members_count; i++) {
+			if (!(row[i / 32] & (1U << (i % 32)))) {
+				continue;
+			}
+
+			if (pinned && !(pinned[i / 32] & (1U << (i % 32)))) {
+				continue;
+			}
+
+			imember = conference->mix_members[i];
+
+			if (conference_utils_member_test_flag(imember, MFLAG_HAS_AUDIO)) {
+				switch_sln_deaccumulate(mix_frame, (int16_t *) imember->frame, MIN(imember->read, bytes) / 2);
+			}
+		}
+	}
+
+	/* subtract my own contribution so I don't hear myself and convert to 16 bit */
+	if (conference_utils_member_test_flag(omember, MFLAG_HAS_AUDIO)) {
+		switch_sln_mix_minus(write_frame, mix, (int16_t *) omember->frame, MIN(omember->read, bytes) / 2, bytes / 2);
+	} else {
+		switch_sln_narrow(write_frame, mix, bytes / 2);
+	}
+
+	switch_mutex_lock(omember->audio_out_mutex);
+	ok = switch_buffer_write(omember->mux_buffer, write_frame, bytes);
+	switch_mutex_unlock(omember->audio_out_mutex);
+
+	return ok;
+}
+
+static void conference_mixer_run_slice(conference_obj_t *conference, conference_mixer_slice_t *slice)
+{
+	conference_mixer_t *mixer = conference->mixer;
+	uint32_t parts = mixer->threads + 1;
+	uint32_t start = (uint32_t) ((uint64_t) mixer->count * slice->index / parts);
+	uint32_t end = (uint32_t) ((uint64_t) mixer->count * (slice->index + 1) / parts);
+	uint32_t i;
+
+	for (i = start; i < end; i++) {
+		if (!conference_mix_member(conference, mixer->members[i], mixer->main_frame, slice->mix_frame, slice->write_frame,
+								   mixer->bytes, mixer->use_masks, mixer->use_masks ? conference->mix_pinned : NULL)) {
+			mixer->failed = 1;
+		}
+	}
+}
+
+static void *SWITCH_THREAD_FUNC conference_mixer_thread_run(switch_thread_t *thread, void *obj)
+{
+	conference_mixer_slice_t *slice = (conference_mixer_slice_t *) obj;
+	conference_obj_t *conference = slice->conference;
+	conference_mixer_t *mixer = conference->mixer;
+	uint32_t seen = 0;
+
+	switch_mutex_lock(mixer->mutex);
+
+	while (mixer->running) {
+		if (mixer->generation == seen) {
+			switch_thread_cond_wait(mixer->work_cond, mixer->mutex);
+			continue;
+		}
+
+		seen = mixer->generation;
+		switch_mutex_unlock(mixer->mutex);
+
+		conference_mixer_run_slice(conference, slice);
+
+		switch_mutex_lock(mixer->mutex);
+		if (--mixer->pending == 0) {
+			switch_thread_cond_signal(mixer->done_cond);
+		}
+	}
+
+	switch_mutex_unlock(mixer->mutex);
+
+	return NULL;
+}
+
+void conference_mixer_create(conference_obj_t *conference)
+{
+	conference_mixer_t *mixer;
+	switch_threadattr_t *thd_attr = NULL;
+	int i;
+
+	mixer = switch_core_alloc(conference->pool, sizeof(*mixer));
+	switch_mutex_init(&mixer->mutex, SWITCH_MUTEX_NESTED, conference->pool);
+	switch_thread_cond_create(&mixer->work_cond, conference->pool);
+	switch_thread_cond_create(&mixer->done_cond, conference->pool);
+	mixer->threads = conference->mixer_threads;
+	mixer->running = 1;
+
+	for (i = 0; i <= mixer->threads; i++) {
+		mixer->slices[i].conference = conference;
+		mixer->slices[i].index = i;
+		mixer->slices[i].mix_frame = switch_core_alloc(conference->pool, SWITCH_RECOMMENDED_BUFFER_SIZE * sizeof(int32_t));
+		mixer->slices[i].write_frame = switch_core_alloc(conference->pool, SWITCH_RECOMMENDED_BUFFER_SIZE);
+	}
+
+	conference->mixer = mixer;
+
+	switch_threadattr_create(&thd_attr, conference->pool);
+	switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+	switch_threadattr_priority_set(thd_attr, SWITCH_PRI_REALTIME);
+
+	for (i = 0; i < mixer->threads; i++) {
+		if (switch_thread_create(&mixer->thread[i], thd_attr, conference_mixer_thread_run, &mixer->slices[i + 1], conference->pool) != SWITCH_STATUS_SUCCESS) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Conference %s: cannot start mixer thread %d\n", conference->name, i);
+			break;
+		}
+	}
+
+	/* whatever did not start is covered by the conference thread itself */
+	mixer->threads = i;
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Conference %s: parallel mixer with %d worker threads\n", conference->name, mixer->threads);
+}
+
+/* Mix every member in the snapshot across the pool and wait on the barrier until the whole tick is done */
+void conference_mixer_run(conference_obj_t *conference, int32_t *main_frame, uint32_t bytes, int use_masks)
+{
+	conference_mixer_t *mixer = conference->mixer;
+
+	mixer->main_frame = main_frame;
+	mixer->bytes = bytes;
+	mixer->use_masks = use_masks;
+
+	switch_mutex_lock(mixer->mutex);
+	mixer->pending = mixer->threads;
+	mixer->generation++;
+	switch_thread_cond_broadcast(mixer->work_cond);
+	switch_mutex_unlock(mixer->mutex);
+
+	conference_mixer_run_slice(conference, &mixer->slices[0]);
+
+	switch_mutex_lock(mixer->mutex);
+	while (mixer->pending > 0) {
+		switch_thread_cond_wait(mixer->done_cond, mixer->mutex);
+	}
+	switch_mutex_unlock(mixer->mutex);
+}
+
+void conference_mixer_destroy(conference_obj_t *conference)
+{
+	conference_mixer_t *mixer = conference->mixer;
+	switch_status_t st;
+	int i;
+
+	if (!mixer) {
+		return;
+	}
+
+	switch_mutex_lock(mixer->mutex);
+	mixer->running = 0;
+	switch_thread_cond_broadcast(mixer->work_cond);
+	switch_mutex_unlock(mixer->mutex);
+
+	for (i = 0; i < mixer->threads; i++) {
+		switch_thread_join(&st, mixer->thread[i]);
+	}
+
+	switch_safe_free(mixer->held);
+	switch_safe_free(mixer->members);
+	conference->mixer = NULL;
+}
+
+/* A listener shares a group encoder when its codec runs at the conference rate, channels and interval,
+   the mix can then go into the encoder as it is. */
+switch_bool_t conference_audio_codec_groupable(conference_obj_t *conference, switch_codec_t *write_codec)
+{
+	const switch_codec_implementation_t *imp;
+
+	if (!switch_core_codec_ready(write_codec)) {
+		return SWITCH_FALSE;
+	}
+
+	imp = write_codec->implementation;
+
+	return (imp->actual_samples_per_second == conference->rate && imp->number_of_channels == conference->channels &&
+			imp->microseconds_per_packet == conference->interval * 1000) ? SWITCH_TRUE : SWITCH_FALSE;
+}
+
+/* PCMU, PCMA and L16 carry nothing from one frame to the next, any encoder of them may feed a decoder.
+   Every other codec (G.722, Opus, G.729, ...) leaves the far end decoder in step with one encoder only. */
+switch_bool_t conference_audio_codec_stateless(switch_codec_t *write_codec)
+{
+	const char *iananame = write_codec->implementation->iananame;
+
+	return (!strcasecmp(iananame, "PCMU") || !strcasecmp(iananame, "PCMA") || !strcasecmp(iananame, "L16")) ? SWITCH_TRUE : SWITCH_FALSE;
+}
+
+/* Decide whether omember hears exactly the shared listener mix this interval and can take the group encode
+   instead of running its own encoder.  Returns SWITCH_TRUE when the member was queued on a group.
+   A member that can speak leaves its group every time it talks, which only a stateless codec survives,
+   so members with a stateful codec are grouped while they cannot speak and stay on the group encoder until unmuted. */
+switch_bool_t conference_audio_codec_add_member(conference_obj_t *conference, conference_member_t *member)
+{
+	switch_codec_t *write_codec;
+	audio_codec_set_t *codec_set = NULL;
+	int i;
+
+	if (!member->audio_packets || !member->session ||
+		conference_utils_member_test_flag(member, MFLAG_HAS_AUDIO) ||
+		conference_utils_member_test_flag(member, MFLAG_NO_MINIMIZE_ENCODING) ||
+		conference->relationship_total || member->fnode || member->volume_out_level) {
+		return SWITCH_FALSE;
+	}
+
+	if (!(write_codec = switch_core_session_get_write_codec(member->session)) || !conference_audio_codec_groupable(conference, write_codec) ||
+		switch_core_media_bug_count(member->session, NULL)) {
+		return SWITCH_FALSE;
+	}
+
+	if (!conference_audio_codec_stateless(write_codec) && conference_utils_member_test_flag(member, MFLAG_CAN_SPEAK)) {
+		return SWITCH_FALSE;
+	}
+
+	/* anything still queued in the mux buffer has to play out first or the audio would be reordered */
+	if (switch_buffer_inuse(member->mux_buffer)) {
+		return SWITCH_FALSE;
+	}
+
+	for (i = 0; i < conference->audio_write_codecs_count; i++) {
+		switch_codec_t *check_codec = &conference->audio_write_codecs[i]->codec;
+
+		if (check_codec->implementation == write_codec->implementation &&
+			!strcmp(switch_str_nil(check_codec->fmtp_in), switch_str_nil(write_codec->fmtp_in))) {
+			codec_set = conference->audio_write_codecs[i];
+			break;
+		}
+	}
+
+	if (!codec_set) {
+		if (conference->audio_write_codecs_count >= MAX_AUDIO_ENCODE_GROUPS) {
+			return SWITCH_FALSE;
+		}
+
+		codec_set = switch_core_alloc(conference->pool, sizeof(*codec_set));
+
+		if (switch_core_codec_copy(write_codec, &codec_set->codec, NULL, conference->pool) != SWITCH_STATUS_SUCCESS) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Conference %s: cannot create shared audio encoder for %s\n",
+							  conference->name, write_codec->implementation->iananame);
+			return SWITCH_FALSE;
+		}
+
+		codec_set->stateless = conference_audio_codec_stateless(write_codec);
+		switch_mutex_init(&codec_set->mutex, SWITCH_MUTEX_NESTED, conference->pool);
+
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Conference %s: setting up shared audio encoder %d for %s@%uh@%ui%s%s\n",
+						  conference->name, conference->audio_write_codecs_count, codec_set->codec.implementation->iananame,
+						  codec_set->codec.implementation->actual_samples_per_second, conference->interval,
+						  codec_set->codec.fmtp_in ? " fmtp " : "", switch_str_nil(codec_set->codec.fmtp_in));
+
+		conference->audio_write_codecs[conference->audio_write_codecs_count++] = codec_set;
+	}
+
+	member->audio_codec_next = codec_set->members;
+	codec_set->members = member;
+	codec_set->member_count++;
+
+	return SWITCH_TRUE;
+}
+
+static audio_codec_packet_t *audio_codec_packet_get(conference_obj_t *conference, audio_codec_set_t *codec_set)
+{
+	audio_codec_packet_t *packet;
+
+	switch_mutex_lock(codec_set->mutex);
+	if ((packet = codec_set->free_packets)) {
+		codec_set->free_packets = packet->next;
+	}
+	switch_mutex_unlock(codec_set->mutex);
+
+	if (!packet) {
+		packet = switch_core_alloc(conference->pool, sizeof(*packet));
+		packet->codec_set = codec_set;
+		packet->frame.data = packet->data;
+		packet->frame.buflen = sizeof(packet->data);
+		packet->frame.codec = &codec_set->codec;
+		packet->frame.rate = codec_set->codec.implementation->samples_per_second;
+		packet->frame.channels = conference->channels;
+	}
+
+	packet->next = NULL;
+
+	return packet;
+}
+
+void conference_audio_codec_packet_release(audio_codec_packet_t *packet)
+{
+	audio_codec_set_t *codec_set = packet->codec_set;
+
+	if (switch_atomic_dec(&packet->refs)) {
+		return;
+	}
+
+	switch_mutex_lock(codec_set->mutex);
+	packet->next = codec_set->free_packets;
+	codec_set->free_packets = packet;
+	switch_mutex_unlock(codec_set->mutex);
+}
+
+/* Hand back whatever the mixer queued for a member that is leaving. */
+void conference_audio_codec_flush_member(conference_member_t *member)
+{
+	void *pop;
+
+	if (!member->audio_packets) {
+		return;
+	}
+
+	while (switch_queue_trypop(member->audio_packets, &pop) == SWITCH_STATUS_SUCCESS && pop) {
+		conference_audio_codec_packet_release((audio_codec_packet_t *) pop);
+	}
+}
+
+/* Encode the shared listener mix once per group and queue the one packet to every member of the group.
+   A stateless group with a single member gains nothing so it gets the raw mix back the normal way,
+   a stateful group is encoded even for one member so its listeners never change encoder. */
+void conference_audio_codec_write_groups(conference_obj_t *conference, int16_t *data, uint32_t bytes, uint32_t samples)
+{
+	int i;
+
+	for (i = 0; i < conference->audio_write_codecs_count; i++) {
+		audio_codec_set_t *codec_set = conference->audio_write_codecs[i];
+		audio_codec_packet_t *packet = NULL;
+		conference_member_t *imember;
+		uint32_t encoded_len = SWITCH_RECOMMENDED_BUFFER_SIZE, encoded_rate = conference->rate, flag = 0, queued = 0;
+
+		if (!codec_set->members) {
+			continue;
+		}
+
+		if (codec_set->member_count > 1 || !codec_set->stateless) {
+			packet = audio_codec_packet_get(conference, codec_set);
+			/* the mixer holds a reference of its own until every member has been given the packet */
+			switch_atomic_set(&packet->refs, 1);
+
+			if (switch_core_codec_encode(&codec_set->codec, NULL, data, bytes, conference->rate,
+										 packet->data, &encoded_len, &encoded_rate, &flag) == SWITCH_STATUS_SUCCESS && encoded_len) {
+				packet->frame.datalen = encoded_len;
+				packet->frame.samples = samples;
+				codec_set->encodes++;
+				conference->audio_encodes++;
+			} else {
+				conference_audio_codec_packet_release(packet);
+				packet = NULL;
+			}
+		}
+
+		for (imember = codec_set->members; imember; imember = imember->audio_codec_next) {
+			if (!packet) {
+				switch_mutex_lock(imember->audio_out_mutex);
+				switch_buffer_write(imember->mux_buffer, data, bytes);
+				switch_mutex_unlock(imember->audio_out_mutex);
+				continue;
+			}
+
+			switch_atomic_inc(&packet->refs);
+
+			if (switch_queue_trypush(imember->audio_packets, packet) != SWITCH_STATUS_SUCCESS) {
+				conference_audio_codec_packet_release(packet);
+				continue;
+			}
+
+			queued++;
+			codec_set->frames++;
+		}
+
+		if (packet) {
+			if (queued) {
+				conference->audio_encodes_saved += queued - 1;
+			}
+			conference_audio_codec_packet_release(packet);
+		}
+
+		codec_set->members = NULL;
+		codec_set->member_count = 0;
+	}
+}
+
+void conference_audio_codec_destroy_groups(conference_obj_t *conference)
+{
+	int i;
+
+	for (i = 0; i < conference->audio_write_codecs_count; i++) {
+		if (switch_core_codec_ready(&conference->audio_write_codecs[i]->codec)) {
+			switch_core_codec_destroy(&conference->audio_write_codecs[i]->codec);
+		}
+	}
+}
+
 /* Main monitor thread (1 per distinct conference room) */
 void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *obj)
 {
@@ -216,9 +712,9 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 	switch_event_t *event;
 	uint8_t *file_frame;
 	uint8_t *async_file_frame;
+	int32_t *mix_frame;
 	int16_t *bptr;
 	uint32_t x = 0;
-	int32_t z = 0;
 	int divisor = 0;
 	conference_cdr_node_t *np;
 
@@ -228,6 +724,7 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 
 	file_frame = switch_core_alloc(conference->pool, SWITCH_RECOMMENDED_BUFFER_SIZE);
 	async_file_frame = switch_core_alloc(conference->pool, SWITCH_RECOMMENDED_BUFFER_SIZE);
+	mix_frame = switch_core_alloc(conference->pool, SWITCH_RECOMMENDED_BUFFER_SIZE * sizeof(int32_t));
 
 	if (switch_core_timer_init(&timer, conference->timer_name, conference->interval, samples, conference->pool) == SWITCH_STATUS_SUCCESS) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Setup timer success interval: %u  samples: %u\n", conference->interval, samples);
@@ -240,6 +737,10 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 	conference_globals.threads++;
 	switch_mutex_unlock(conference_globals.hash_mutex);
 
+	if (conference->mixer_threads > 0) {
+		conference_mixer_create(conference);
+	}
+
 	conference->auto_recording = 0;
 	conference->record_count = 0;
 
@@ -250,6 +751,7 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 		int nomoh = 0;
 		uint32_t floor_holder;
 		switch_status_t moh_status = SWITCH_STATUS_SUCCESS;
+		switch_time_t tick_start;
 
 		/* Sync the conference to a single timing source */
 		if (switch_core_timer_next(&timer) != SWITCH_STATUS_SUCCESS) {
@@ -257,6 +759,8 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 			break;
 		}
 
+		tick_start = switch_micro_time_now();
+
 		switch_mutex_lock(conference->mutex);
 		has_file_data = ready = total = 0;
 
@@ -568,8 +1072,10 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 
 		if (ready || has_file_data) {
 			/* Use more bits in the main_frame to preserve the exact sum of the audio samples. */
-			int main_frame[SWITCH_RECOMMENDED_BUFFER_SIZE] = { 0 };
+			int32_t main_frame[SWITCH_RECOMMENDED_BUFFER_SIZE] = { 0 };
 			int16_t write_frame[SWITCH_RECOMMENDED_BUFFER_SIZE] = { 0 };
+			int grouped = 0, parallel = 0, use_masks = 0;
+			uint32_t held = 0;
 
 
 			/* Init the main frame with file data if there is any. */
@@ -588,6 +1094,50 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 			conference->mux_loop_count = 0;
 			conference->member_loop_count = 0;
 
+			/* rebuild on any membership or relationship change, even once the last relationship is gone,
+			   so mix_members and every member's mix_excluded never outlive the state they were built from */
+			if (conference->mix_exclude_seq != conference->relationship_seq) {
+				conference_mix_exclude_rebuild(conference);
+			}
+
+			use_masks = conference->relationship_total ? 1 : 0;
+
+			if (conference->mixer && conference->count >= MIXER_PARALLEL_MIN_MEMBERS) {
+				conference_mixer_t *mixer = conference->mixer;
+				uint32_t count = 0;
+
+				for (omember = conference->members; omember; omember = omember->next) {
+					count++;
+				}
+
+				if (count > mixer->size) {
+					mixer->size = count * 2;
+					mixer->held = realloc(mixer->held, mixer->size * sizeof(conference_member_t *));
+					mixer->members = realloc(mixer->members, mixer->size * sizeof(conference_member_t *));
+					switch_assert(mixer->held && mixer->members);
+				}
+
+				if (use_masks && conference->mix_pinned) {
+					memset(conference->mix_pinned, 0, conference->mix_exclude_words * sizeof(uint32_t));
+				}
+
+				/* hold everybody so nobody can leave while the pool works outside the conference mutex,
+				   a member we can't hold is already on the way out and is left out of this tick */
+				mixer->held_count = mixer->count = 0;
+
+				for (omember = conference->members; omember; omember = omember->next) {
+					if (switch_thread_rwlock_tryrdlock(omember->rwlock) == SWITCH_STATUS_SUCCESS) {
+						mixer->held[mixer->held_count++] = omember;
+
+						if (use_masks) {
+							conference->mix_pinned[omember->mix_index / 32] |= 1U << (omember->mix_index % 32);
+						}
+					}
+				}
+
+				parallel = 1;
+			}
+
 
 			/* Copy audio from every member known to be producing audio into the main frame. */
 			for (omember = conference->members; omember; omember = omember->next) {
@@ -597,10 +1147,7 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 					continue;
 				}
 
-				bptr = (int16_t *) omember->frame;
-				for (x = 0; x < omember->read / 2; x++) {
-					main_frame[x] += (int32_t) bptr[x];
-				}
+				switch_sln_accumulate(main_frame, (int16_t *) omember->frame, MIN(omember->read, bytes) / 2);
 			}
 
 			/* Create write frame once per member who is not deaf for each sample in the main frame
@@ -610,74 +1157,71 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 			*/
 			for (omember = conference->members; omember; omember = omember->next) {
 				switch_size_t ok = 1;
+				int is_held = 0;
+
+				/* held follows the member list order so this is just a walk alongside it */
+				if (parallel && held < conference->mixer->held_count && conference->mixer->held[held] == omember) {
+					is_held = 1;
+					held++;
+				}
 
 				if (!conference_utils_member_test_flag(omember, MFLAG_RUNNING)) {
 					continue;
 				}
 
-				if (!conference_utils_member_test_flag(omember, MFLAG_CAN_HEAR)) {
-					switch_mutex_lock(omember->audio_out_mutex);
-					memset(write_frame, 255, bytes);
-					ok = switch_buffer_write(omember->mux_buffer, write_frame, bytes);
-					switch_mutex_unlock(omember->audio_out_mutex);
+				/* members who are not talking hear the plain main frame, let them share one encode */
+				if (conference_utils_test_flag(conference, CFLAG_MINIMIZE_AUDIO_ENCODING) && conference_utils_member_test_flag(omember, MFLAG_CAN_HEAR) &&
+					conference_audio_codec_add_member(conference, omember)) {
+					grouped++;
 					continue;
 				}
 
-				bptr = (int16_t *) omember->frame;
+				if (parallel) {
+					if (is_held) {
+						conference->mixer->members[conference->mixer->count++] = omember;
+					}
+					continue;
+				}
 
-				for (x = 0; x < bytes / 2 ; x++) {
-					z = main_frame[x];
+				ok = conference_mix_member(conference, omember, main_frame, mix_frame, write_frame, bytes, use_masks, NULL);
 
-					/* bptr[x] represents my own contribution to this audio sample */
-					if (conference_utils_member_test_flag(omember, MFLAG_HAS_AUDIO) && x <= omember->read / 2) {
-						z -= (int32_t) bptr[x];
-					}
+				if (!ok) {
+					switch_mutex_unlock(conference->mutex);
+					goto end;
+				}
+			}
 
-					/* when there are relationships, we have to do more work by scouring all the members to see if there are any
-					   reasons why we should not be hearing a paticular member, and if not, delete their samples as well.
-					*/
-					if (conference->relationship_total) {
-						for (imember = conference->members; imember; imember = imember->next) {
-							if (imember != omember && conference_utils_member_test_flag(imember, MFLAG_HAS_AUDIO)) {
-								conference_relationship_t *rel;
-								switch_size_t found = 0;
-								int16_t *rptr = (int16_t *) imember->frame;
-								for (rel = imember->relationships; rel; rel = rel->next) {
-									if ((rel->id == omember->id || rel->id == 0) && !switch_test_flag(rel, RFLAG_CAN_SPEAK)) {
-										z -= (int32_t) rptr[x];
-										found = 1;
-										break;
-									}
-								}
-								if (!found) {
-									for (rel = omember->relationships; rel; rel = rel->next) {
-										if ((rel->id == imember->id || rel->id == 0) && !switch_test_flag(rel, RFLAG_CAN_HEAR)) {
-											z -= (int32_t) rptr[x];
-											break;
-										}
-									}
-								}
-
-							}
-						}
-					}
+			if (grouped) {
+				switch_sln_narrow(write_frame, main_frame, bytes / 2);
+				conference_audio_codec_write_groups(conference, write_frame, bytes, samples);
+			}
+
+			if (parallel) {
+				conference_mixer_t *mixer = conference->mixer;
+				uint32_t i;
 
-					/* Now we can convert to 16 bit. */
-					switch_normalize_to_16bit(z);
-					write_frame[x] = (int16_t) z;
+				conference->mix_parallel_ticks++;
+				mixer->failed = 0;
+
+				/* everything the pool touches is pinned, let the rest of the world at the conference meanwhile */
+				switch_mutex_unlock(conference->mutex);
+				conference_mixer_run(conference, main_frame, bytes, use_masks);
+
+				for (i = 0; i < mixer->held_count; i++) {
+					switch_thread_rwlock_unlock(mixer->held[i]->rwlock);
 				}
+				mixer->held_count = mixer->count = 0;
 
-				switch_mutex_lock(omember->audio_out_mutex);
-				ok = switch_buffer_write(omember->mux_buffer, write_frame, bytes);
-				switch_mutex_unlock(omember->audio_out_mutex);
+				switch_mutex_lock(conference->mutex);
 
-				if (!ok) {
+				if (mixer->failed) {
 					switch_mutex_unlock(conference->mutex);
 					goto end;
 				}
 			}
 		} else { /* There is no source audio.  Push silence into all of the buffers */
 			int16_t write_frame[SWITCH_RECOMMENDED_BUFFER_SIZE] = { 0 };
+			int grouped = 0;
 
 			if (conference->comfort_noise_level) {
 				switch_generate_sln_silence(write_frame, samples, conference->channels, conference->comfort_noise_level * (conference->rate / 8000));
@@ -692,6 +1236,12 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 					continue;
 				}
 
+				if (conference_utils_test_flag(conference, CFLAG_MINIMIZE_AUDIO_ENCODING) && conference_utils_member_test_flag(omember, MFLAG_CAN_HEAR) &&
+					conference_audio_codec_add_member(conference, omember)) {
+					grouped++;
+					continue;
+				}
+
 				switch_mutex_lock(omember->audio_out_mutex);
 				ok = switch_buffer_write(omember->mux_buffer, write_frame, bytes);
 				switch_mutex_unlock(omember->audio_out_mutex);
@@ -701,6 +1251,10 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 					goto end;
 				}
 			}
+
+			if (grouped) {
+				conference_audio_codec_write_groups(conference, write_frame, bytes, samples);
+			}
 		}
 
 		if (conference->async_fnode && conference->async_fnode->done) {
@@ -754,6 +1308,18 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 			conference_utils_set_flag(conference, CFLAG_ENDCONF_FORCED);
 		}
 
+		/* a tick that takes longer than the interval means every member is about to hear a gap */
+		conference->mix_tick_last = switch_micro_time_now() - tick_start;
+		conference->mix_ticks++;
+
+		if (conference->mix_tick_last > conference->mix_tick_max) {
+			conference->mix_tick_max = conference->mix_tick_last;
+		}
+
+		if (conference->mix_tick_last > conference->interval * 1000) {
+			conference->mix_overruns++;
+		}
+
 		switch_mutex_unlock(conference->mutex);
 	}
 	/* Rinse ... Repeat */
@@ -810,6 +1376,11 @@ void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *ob
 	}
 
 	switch_core_timer_destroy(&timer);
+	conference_audio_codec_destroy_groups(conference);
+	conference_mixer_destroy(conference);
+	switch_safe_free(conference->mix_members);
+	switch_safe_free(conference->mix_exclude);
+	switch_safe_free(conference->mix_pinned);
 	switch_mutex_lock(conference_globals.hash_mutex);
 	if (conference_utils_test_flag(conference, CFLAG_INHASH)) {
 		switch_core_hash_delete(conference_globals.conference_hash, conference->name);
@@ -2412,6 +2983,11 @@ SWITCH_STANDARD_APP(conference_function)
 		switch_frame_buffer_create(&member.fb, 500);
 	}
 
+	if (conference_utils_test_flag(conference, CFLAG_MINIMIZE_AUDIO_ENCODING)) {
+		/* same half second ceiling the mux buffer is flushed at */
+		switch_queue_create(&member.audio_packets, 500 / conference->interval, member.pool);
+	}
+
 	/* Add the caller to the conference */
 	if (conference_member_add(conference, &member) != SWITCH_STATUS_SUCCESS) {
 		switch_core_codec_destroy(&member.read_codec);
@@ -2514,6 +3090,8 @@ SWITCH_STANDARD_APP(conference_function)
 		switch_frame_buffer_destroy(&member.fb);
 	}
 
+	conference_audio_codec_flush_member(&member);
+
 	if (conference) {
 		switch_mutex_lock(conference->mutex);
 		if (conference_utils_test_flag(conference, CFLAG_DYNAMIC) && conference->count == 0 && conference->count_ghosts == 0) {
@@ -2707,6 +3285,7 @@ conference_obj_t *conference_new(char *name, conference_xml_cfg_t cfg, switch_co
 	int auto_kps_debounce = 5000;
 	float fps = 30.0f;
 	uint32_t max_members = 0;
+	int mixer_threads = 0;
 	uint32_t announce_count = 0;
 	char *maxmember_sound = NULL;
 	uint32_t rate = 8000, interval = 20;
@@ -3025,6 +3604,12 @@ conference_obj_t *conference_new(char *name, conference_xml_cfg_t cfg, switch_co
 					max_members = 0;	/* set to 0 to disable max counts */
 					switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "max-members %s is invalid, not setting a limit\n", val);
 				}
+			} else if (!strcasecmp(var, "mixer-threads") && !zstr(val)) {
+				mixer_threads = atoi(val);
+				if (mixer_threads < 0 || mixer_threads > MAX_MIXER_THREADS) {
+					switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "mixer-threads %s is invalid, must be 0 to %d\n", val, MAX_MIXER_THREADS);
+					mixer_threads = 0;
+				}
 			} else if (!strcasecmp(var, "max-members-sound") && !zstr(val)) {
 				maxmember_sound = val;
 			} else if (!strcasecmp(var, "announce-count") && !zstr(val)) {
@@ -3528,6 +4113,7 @@ conference_obj_t *conference_new(char *name, conference_xml_cfg_t cfg, switch_co
 	}
 	/* its going to be 0 by default, set to a value otherwise so this should be safe */
 	conference->max_members = max_members;
+	conference->mixer_threads = mixer_threads;
 	conference->announce_count = announce_count;
 
 	conference->name = switch_core_strdup(conference->pool, name);
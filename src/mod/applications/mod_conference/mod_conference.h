@@ -106,6 +106,9 @@
 #define CONFFUNCAPISIZE (sizeof(conference_api_sub_commands)/sizeof(conference_api_sub_commands[0]))
 
 #define MAX_MUX_CODECS 50
+#define MAX_AUDIO_ENCODE_GROUPS 16
+#define MAX_MIXER_THREADS 32
+#define MIXER_PARALLEL_MIN_MEMBERS 64
 
 #define ALC_HRTF_SOFT  0x1992
 
@@ -261,6 +264,7 @@ typedef enum {
 	CFLAG_REFRESH_LAYOUT,
 	CFLAG_VIDEO_MUTE_EXIT_CANVAS,
 	CFLAG_NO_MOH,
+	CFLAG_MINIMIZE_AUDIO_ENCODING,
 	/////////////////////////////////
 	CFLAG_MAX
 } conference_flag_t;
@@ -539,6 +543,31 @@ typedef struct codec_set_s {
 	char *video_codec_group;
 } codec_set_t;
 
+struct audio_codec_set_s;
+
+/* One group encode of one interval, read by every member it was queued for.
+   The last member to write it out hands it back to its group. */
+typedef struct audio_codec_packet_s {
+	switch_frame_t frame;
+	uint8_t data[SWITCH_RECOMMENDED_BUFFER_SIZE];
+	volatile switch_atomic_t refs;
+	struct audio_codec_set_s *codec_set;
+	struct audio_codec_packet_s *next;
+} audio_codec_packet_t;
+
+/* Listeners who hear the same mix through the same codec, fmtp and ptime share one encoder.
+   A stateful codec only groups listeners that cannot speak, see conference_audio_codec_add_member() */
+typedef struct audio_codec_set_s {
+	switch_codec_t codec;
+	switch_bool_t stateless;
+	switch_mutex_t *mutex;
+	audio_codec_packet_t *free_packets;
+	conference_member_t *members;
+	uint32_t member_count;
+	uint64_t encodes;
+	uint64_t frames;
+} audio_codec_set_t;
+
 
 typedef struct mcu_canvas_s {
 	int width;
@@ -578,6 +607,35 @@ typedef struct mcu_canvas_s {
 	int write_codecs_count;
 } mcu_canvas_t;
 
+/* Worker pool that splits the per member mix-minus of one tick, slice 0 is run by the conference thread itself */
+typedef struct conference_mixer_slice_s {
+	struct conference_obj *conference;
+	int index;
+	int32_t *mix_frame;
+	int16_t *write_frame;
+} conference_mixer_slice_t;
+
+typedef struct conference_mixer_s {
+	switch_mutex_t *mutex;
+	switch_thread_cond_t *work_cond;
+	switch_thread_cond_t *done_cond;
+	uint32_t generation;
+	int pending;
+	int running;
+	int threads;
+	switch_thread_t *thread[MAX_MIXER_THREADS];
+	conference_mixer_slice_t slices[MAX_MIXER_THREADS + 1];
+	conference_member_t **held;
+	uint32_t held_count;
+	conference_member_t **members;
+	uint32_t count;
+	uint32_t size;
+	int32_t *main_frame;
+	uint32_t bytes;
+	int use_masks;
+	int failed;
+} conference_mixer_t;
+
 /* Record Node */
 typedef struct conference_record {
 	struct conference_obj *conference;
@@ -723,6 +781,12 @@ typedef struct conference_obj {
 	int endconference_grace_time;
 
 	uint32_t relationship_total;
+	uint32_t relationship_seq;
+	uint32_t mix_exclude_seq;
+	conference_member_t **mix_members;
+	uint32_t mix_members_count;
+	uint32_t *mix_exclude;
+	uint32_t mix_exclude_words;
 	uint32_t score;
 	int mux_loop_count;
 	int member_loop_count;
@@ -764,6 +828,18 @@ typedef struct conference_obj {
 	uint32_t floor_holder_score_iir;
 	char *default_layout_name;
 	int mux_paused;
+	audio_codec_set_t *audio_write_codecs[MAX_AUDIO_ENCODE_GROUPS];
+	int audio_write_codecs_count;
+	uint64_t audio_encodes;
+	uint64_t audio_encodes_saved;
+	int mixer_threads;
+	conference_mixer_t *mixer;
+	uint32_t *mix_pinned;
+	uint64_t mix_ticks;
+	uint64_t mix_parallel_ticks;
+	uint64_t mix_overruns;
+	switch_time_t mix_tick_last;
+	switch_time_t mix_tick_max;
 } conference_obj_t;
 
 /* Relationship with another member */
@@ -842,6 +918,8 @@ struct conference_member {
 	uint32_t resample_out_len;
 	conference_file_node_t *fnode;
 	conference_relationship_t *relationships;
+	uint32_t mix_index;
+	uint8_t mix_excluded;
 	switch_speech_handle_t lsh;
 	switch_speech_handle_t *sh;
 	uint32_t verbose_events;
@@ -880,6 +958,8 @@ struct conference_member {
 	uint32_t auto_kps_debounce_ticks;
 	uint32_t layer_loops;
 	switch_frame_buffer_t *fb;
+	switch_queue_t *audio_packets;
+	conference_member_t *audio_codec_next;
 	switch_image_t *avatar_png_img;
 	switch_image_t *video_mute_img;
 	uint32_t floor_packets;
@@ -1107,6 +1187,19 @@ switch_status_t conference_member_del_relationship(conference_member_t *member,
 switch_status_t conference_member_add(conference_obj_t *conference, conference_member_t *member);
 switch_status_t conference_member_del(conference_obj_t *conference, conference_member_t *member);
 void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *obj);
+void conference_mix_exclude_rebuild(conference_obj_t *conference);
+switch_size_t conference_mix_member(conference_obj_t *conference, conference_member_t *omember, int32_t *main_frame,
+									int32_t *mix_frame, int16_t *write_frame, uint32_t bytes, int use_masks, uint32_t *pinned);
+void conference_mixer_create(conference_obj_t *conference);
+void conference_mixer_run(conference_obj_t *conference, int32_t *main_frame, uint32_t bytes, int use_masks);
+void conference_mixer_destroy(conference_obj_t *conference);
+switch_bool_t conference_audio_codec_groupable(conference_obj_t *conference, switch_codec_t *write_codec);
+switch_bool_t conference_audio_codec_stateless(switch_codec_t *write_codec);
+void conference_audio_codec_packet_release(audio_codec_packet_t *packet);
+void conference_audio_codec_flush_member(conference_member_t *member);
+switch_bool_t conference_audio_codec_add_member(conference_obj_t *conference, conference_member_t *member);
+void conference_audio_codec_write_groups(conference_obj_t *conference, int16_t *data, uint32_t bytes, uint32_t samples);
+void conference_audio_codec_destroy_groups(conference_obj_t *conference);
 void *SWITCH_THREAD_FUNC conference_video_muxing_thread_run(switch_thread_t *thread, void *obj);
 void *SWITCH_THREAD_FUNC conference_video_super_muxing_thread_run(switch_thread_t *thread, void *obj);
 void conference_loop_output(conference_member_t *member);
@@ -1258,6 +1351,8 @@ switch_status_t conference_api_sub_record(conference_obj_t *conference, switch_s
 switch_status_t conference_api_sub_norecord(conference_obj_t *conference, switch_stream_handle_t *stream, int argc, char **argv);
 switch_status_t conference_api_sub_vid_bandwidth(conference_obj_t *conference, switch_stream_handle_t *stream, int argc, char **argv);
 switch_status_t conference_api_sub_vid_personal(conference_obj_t *conference, switch_stream_handle_t *stream, int argc, char **argv);
+switch_status_t conference_api_sub_encode_stats(conference_obj_t *conference, switch_stream_handle_t *stream, int argc, char **argv);
+switch_status_t conference_api_sub_mixer_stats(conference_obj_t *conference, switch_stream_handle_t *stream, int argc, char **argv);
 switch_status_t conference_api_dispatch(conference_obj_t *conference, switch_stream_handle_t *stream, int argc, char **argv, const char *cmdline, int argn);
 switch_status_t conference_api_sub_syntax(char **syntax);
 switch_status_t conference_api_main_real(const char *cmd, switch_core_session_t *session, switch_stream_handle_t *stream);
@@ -0,0 +1,74 @@
+#include <mod_conference.h>
+#include <tap.h>
+
+typedef struct {
+  const char *iananame;
+  uint32_t rate;
+  int ptime;
+  int groupable;
+  int stateless;
+} codec_case_t;
+
+static codec_case_t cases[] = {
+  { "PCMU", 8000, 20, 1, 1 },
+  { "PCMA", 8000, 20, 1, 1 },
+  { "L16", 8000, 20, 1, 1 },
+  { "pcmu", 8000, 20, 1, 1 },
+  { "PCMU", 8000, 30, 0, 1 },
+  { "L16", 16000, 20, 0, 1 },
+  { "G722", 8000, 20, 1, 0 },
+  { "G729", 8000, 20, 1, 0 },
+  { "opus", 8000, 20, 1, 0 },
+  { "opus", 48000, 20, 0, 0 },
+  { "iLBC", 8000, 30, 0, 0 },
+};
+
+int main () {
+  switch_memory_pool_t *pool = NULL;
+  switch_codec_interface_t codec_interface = { 0 };
+  switch_mutex_t *mutex = NULL;
+  conference_obj_t conference;
+  const char *err = NULL;
+  int x, n = sizeof(cases) / sizeof(cases[0]);
+
+  plan(2 + n * 2);
+
+  if (!ok(switch_core_init(SCF_MINIMAL, SWITCH_TRUE, &err) == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+  switch_core_new_memory_pool(&pool);
+  switch_mutex_init(&mutex, SWITCH_MUTEX_NESTED, pool);
+
+  memset(&conference, 0, sizeof(conference));
+  conference.rate = 8000;
+  conference.channels = 1;
+  conference.interval = 20;
+
+  for (x = 0; x < n; x++) {
+    switch_codec_implementation_t imp = { 0 };
+    switch_codec_t codec = { 0 };
+
+    imp.iananame = (char *) cases[x].iananame;
+    imp.actual_samples_per_second = cases[x].rate;
+    imp.number_of_channels = 1;
+    imp.microseconds_per_packet = cases[x].ptime * 1000;
+
+    codec.implementation = &imp;
+    codec.codec_interface = &codec_interface;
+    codec.mutex = mutex;
+    codec.flags = SWITCH_CODEC_FLAG_READY;
+
+    ok(conference_audio_codec_groupable(&conference, &codec) == (cases[x].groupable ? SWITCH_TRUE : SWITCH_FALSE),
+       "%s@%uh@%di %s", cases[x].iananame, cases[x].rate, cases[x].ptime, cases[x].groupable ? "can share a group encoder" : "keeps its own encoder");
+    ok(conference_audio_codec_stateless(&codec) == (cases[x].stateless ? SWITCH_TRUE : SWITCH_FALSE),
+       "%s %s", cases[x].iananame, cases[x].stateless ? "groups members that talk" : "only groups members that cannot speak");
+  }
+
+  ok(conference_audio_codec_groupable(&conference, NULL) == SWITCH_FALSE, "no write codec is never grouped");
+
+  switch_core_destroy_memory_pool(&pool);
+  switch_core_destroy();
+
+  done_testing();
+}
@@ -70,11 +70,19 @@ static void send_report(switch_event_t *event, const char * Status) {
 	}
 }
 
-static void event_handler(switch_event_t *event)
+static void event_handler(switch_event_t *shared)
 {
-	const char *dest_proto = switch_event_get_header(event, "dest_proto");
-	const char *check_failure = switch_event_get_header(event, "Delivery-Failure");
-	const char *check_nonblocking = switch_event_get_header(event, "Nonblocking-Delivery");
+	switch_event_t *event = NULL;
+	const char *dest_proto, *check_failure, *check_nonblocking;
+
+	/* the fired event may be shared with other subscribers, mark our own copy */
+	if (switch_event_dup(&event, shared) != SWITCH_STATUS_SUCCESS) {
+		return;
+	}
+
+	dest_proto = switch_event_get_header(event, "dest_proto");
+	check_failure = switch_event_get_header(event, "Delivery-Failure");
+	check_nonblocking = switch_event_get_header(event, "Nonblocking-Delivery");
 
 	switch_event_add_header(event, SWITCH_STACK_BOTTOM, "skip_global_process", "true");
 
@@ -83,18 +91,17 @@ static void event_handler(switch_event_t *event)
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Delivery Failure\n");
 		DUMP_EVENT(event);
 		send_report(event, "Failure");
-		return;
 	} else if ( check_failure && switch_false(check_failure) ) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "SMS Delivery Success\n");
 		send_report(event, "Success");
-		return;
 	} else if ( check_nonblocking && switch_true(check_nonblocking) ) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "SMS Delivery assumed successful due to being sent in non-blocking manner\n");
 		send_report(event, "Accepted");
-		return;
+	} else {
+		switch_core_chat_send(dest_proto, event);
 	}
 
-	switch_core_chat_send(dest_proto, event);
+	switch_event_destroy(&event);
 }
 
 typedef enum {
@@ -3277,8 +3277,9 @@ static switch_status_t voicemail_inject(const char *data, switch_core_session_t
 		switch_core_new_memory_pool(&pool);
 
 
+		/* the domain document may be shared with the xml result cache, merge into private copies */
 		if (isgroup) {
-			switch_xml_t group = NULL, groups = NULL, users = NULL;
+			switch_xml_t group = NULL, groups = NULL, users = NULL, merged;
 			if ((groups = switch_xml_child(x_domain, "groups"))) {
 				if ((group = switch_xml_find_child_multi(groups, "group", "name", user, NULL))) {
 					if ((users = switch_xml_child(group, "users"))) {
@@ -3290,22 +3291,26 @@ static switch_status_t voicemail_inject(const char *data, switch_core_session_t
 								switch_xml_t ux;
 
 								if (switch_xml_locate_user_in_domain(uname, x_domain, &ux, NULL) == SWITCH_STATUS_SUCCESS) {
-									switch_xml_merge_user(ux, x_domain, group);
+									merged = switch_xml_dup(ux);
+									switch_xml_merge_user(merged, x_domain, group);
 									switch_event_create(&my_params, SWITCH_EVENT_REQUEST_PARAMS);
 									status =
-										deliver_vm(profile, ux, domain, path, 0, read_flags, my_params, pool, cid_name, cid_num, forwarded_by,
+										deliver_vm(profile, merged, domain, path, 0, read_flags, my_params, pool, cid_name, cid_num, forwarded_by,
 												   SWITCH_TRUE, session ? switch_core_session_get_uuid(session) : NULL, session);
 									switch_event_destroy(&my_params);
+									switch_xml_free(merged);
 								}
 								continue;
 							}
 
-							switch_xml_merge_user(ut, x_domain, group);
+							merged = switch_xml_dup(ut);
+							switch_xml_merge_user(merged, x_domain, group);
 							switch_event_create(&my_params, SWITCH_EVENT_REQUEST_PARAMS);
-							status = deliver_vm(profile, ut, domain, path, 0, read_flags,
+							status = deliver_vm(profile, merged, domain, path, 0, read_flags,
 												my_params, pool, cid_name, cid_num, forwarded_by, SWITCH_TRUE,
 												session ? switch_core_session_get_uuid(session) : NULL, session);
 							switch_event_destroy(&my_params);
+							switch_xml_free(merged);
 						}
 					}
 				} else {
@@ -3313,7 +3318,7 @@ static switch_status_t voicemail_inject(const char *data, switch_core_session_t
 				}
 			}
 		} else if (isall) {
-			switch_xml_t group = NULL, groups = NULL, users = NULL;
+			switch_xml_t group = NULL, groups = NULL, users = NULL, merged;
 			if ((groups = switch_xml_child(x_domain, "groups"))) {
 				for (group = switch_xml_child(groups, "group"); group; group = group->next) {
 					if ((users = switch_xml_child(group, "users"))) {
@@ -3324,12 +3329,14 @@ static switch_status_t voicemail_inject(const char *data, switch_core_session_t
 								continue;
 							}
 
-							switch_xml_merge_user(ut, x_domain, group);
+							merged = switch_xml_dup(ut);
+							switch_xml_merge_user(merged, x_domain, group);
 							switch_event_create(&my_params, SWITCH_EVENT_REQUEST_PARAMS);
-							status = deliver_vm(profile, ut, domain, path, 0, read_flags,
+							status = deliver_vm(profile, merged, domain, path, 0, read_flags,
 												my_params, pool, cid_name, cid_num, forwarded_by, SWITCH_TRUE,
 												session ? switch_core_session_get_uuid(session) : NULL, session);
 							switch_event_destroy(&my_params);
+							switch_xml_free(merged);
 						}
 					}
 				}
@@ -3339,12 +3346,15 @@ static switch_status_t voicemail_inject(const char *data, switch_core_session_t
 			switch_xml_t x_group = NULL;
 
 			if ((status = switch_xml_locate_user_in_domain(user, x_domain, &ut, &x_group)) == SWITCH_STATUS_SUCCESS) {
-				switch_xml_merge_user(ut, x_domain, x_group);
+				switch_xml_t merged = switch_xml_dup(ut);
+
+				switch_xml_merge_user(merged, x_domain, x_group);
 				switch_event_create(&my_params, SWITCH_EVENT_REQUEST_PARAMS);
-				status = deliver_vm(profile, ut, domain, path, 0, read_flags,
+				status = deliver_vm(profile, merged, domain, path, 0, read_flags,
 									my_params, pool, cid_name, cid_num, forwarded_by, SWITCH_TRUE,
 									session ? switch_core_session_get_uuid(session) : NULL, session);
 				switch_event_destroy(&my_params);
+				switch_xml_free(merged);
 			} else {
 				status = SWITCH_STATUS_FALSE;
 			}
@@ -35,7 +35,8 @@
 #include <fcntl.h>
 
 SWITCH_MODULE_LOAD_FUNCTION(mod_dialplan_xml_load);
-SWITCH_MODULE_DEFINITION(mod_dialplan_xml, mod_dialplan_xml_load, NULL, NULL);
+SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_dialplan_xml_shutdown);
+SWITCH_MODULE_DEFINITION(mod_dialplan_xml, mod_dialplan_xml_load, mod_dialplan_xml_shutdown, NULL);
 
 typedef enum {
 	BREAK_ON_TRUE,
@@ -44,6 +45,46 @@ typedef enum {
 	BREAK_NEVER
 } break_t;
 
+/*
+ * A context with compile="true" is turned into a program once per XML root, the program
+ * holds a reference on that root until reloadxml or a newer root replaces it.
+ * Extensions whose first condition tests destination_number against an anchored
+ * literal or literal prefix are filed in a trie; a hunt only visits the extensions
+ * the trie returns plus those that could not be indexed, in document order.
+ * Everything that runs is still interpreted by parse_exten().
+ */
+typedef struct dp_id_s {
+	uint32_t id;
+	struct dp_id_s *next;
+} dp_id_t;
+
+typedef struct dp_trie_node_s {
+	char c;
+	dp_id_t *exact;
+	dp_id_t *prefix;
+	struct dp_trie_node_s *child;
+	struct dp_trie_node_s *next;
+} dp_trie_node_t;
+
+typedef struct dp_program_s {
+	switch_memory_pool_t *pool;
+	switch_xml_t root;
+	switch_xml_t *extens;
+	uint32_t count;
+	uint32_t indexed;
+	uint32_t words;
+	uint32_t *always;
+	dp_trie_node_t trie;
+	int refs;
+} dp_program_t;
+
+static struct {
+	switch_memory_pool_t *pool;
+	switch_mutex_t *mutex;
+	switch_hash_t *programs;
+	switch_event_node_t *reload_node;
+} globals;
+
 
 static switch_status_t exec_app(switch_core_session_t *session, const char *app, const char *arg)
 {
@@ -598,6 +639,292 @@ static int parse_exten(switch_core_session_t *session, switch_caller_profile_t *
 	return proceed;
 }
 
+static void dp_program_destroy(dp_program_t *program)
+{
+	switch_memory_pool_t *pool = program->pool;
+
+	switch_xml_free(program->root);
+	switch_core_destroy_memory_pool(&pool);
+}
+
+static void dp_program_release(dp_program_t *program)
+{
+	int refs;
+
+	switch_mutex_lock(globals.mutex);
+	refs = --program->refs;
+	switch_mutex_unlock(globals.mutex);
+
+	if (!refs) {
+		dp_program_destroy(program);
+	}
+}
+
+static void dp_program_flush(void)
+{
+	switch_hash_index_t *hi = NULL;
+	const void *var;
+	void *val;
+	dp_program_t *program;
+
+	switch_mutex_lock(globals.mutex);
+	while ((hi = switch_core_hash_first_iter(globals.programs, hi))) {
+		switch_core_hash_this(hi, &var, NULL, &val);
+		program = (dp_program_t *) val;
+		switch_core_hash_delete(globals.programs, var);
+
+		if (!--program->refs) {
+			dp_program_destroy(program);
+		}
+	}
+	switch_mutex_unlock(globals.mutex);
+
+	switch_safe_free(hi);
+}
+
+static void reload_event_handler(switch_event_t *event)
+{
+	dp_program_flush();
+}
+
+/* Copies the literal prefix of an anchored expression into buf and sets *exact when the
+   expression is nothing but that literal; returns 0 when there is no usable prefix. */
+static int dp_literal_prefix(const char *expression, char *buf, switch_size_t len, int *exact)
+{
+	const char *p;
+	switch_size_t i = 0;
+
+	*exact = 0;
+
+	if (!expression || *expression != '^' || strchr(expression, '|')) {
+		return 0;
+	}
+
+	for (p = expression + 1; *p && i < len - 1; p++) {
+		if (*p == '\\') {
+			if (!p[1] || isalnum((unsigned char) p[1])) {
+				break;
+			}
+			buf[i++] = *++p;
+			continue;
+		}
+
+		if (*p == '$' && !p[1]) {
+			*exact = 1;
+			break;
+		}
+
+		if (strchr(".[]()*+?{}^$", *p)) {
+			if ((*p == '*' || *p == '?' || *p == '{') && i) {
+				/* the last literal is optional */
+				i--;
+			}
+			break;
+		}
+
+		buf[i++] = *p;
+	}
+
+	buf[i] = '\0';
+
+	return i > 0;
+}
+
+/* The first condition decides the extension on its own when it can only fail quietly. */
+static const char *dp_indexable_expression(switch_xml_t xexten)
+{
+	switch_xml_t xcond, xexpression;
+	const char *expression;
+	int i;
+
+	if (!(xcond = switch_xml_child(xexten, "condition"))) {
+		return NULL;
+	}
+
+	for (i = 0; xcond->attr[i]; i += 2) {
+		const char *name = xcond->attr[i], *val = xcond->attr[i + 1];
+
+		if (!strcasecmp(name, "field")) {
+			if (strcasecmp(val, "destination_number")) {
+				return NULL;
+			}
+		} else if (!strcasecmp(name, "break")) {
+			if (strcasecmp(val, "on-false")) {
+				return NULL;
+			}
+		} else if (strcasecmp(name, "expression")) {
+			return NULL;
+		}
+	}
+
+	if (!switch_xml_attr(xcond, "field") || switch_xml_child(xcond, "anti-action")) {
+		return NULL;
+	}
+
+	if ((xexpression = switch_xml_child(xcond, "expression"))) {
+		expression = xexpression->txt;
+	} else {
+		expression = switch_xml_attr(xcond, "expression");
+	}
+
+	if (zstr(expression) || strstr(expression, "${")) {
+		/* variables are expanded per call */
+		return NULL;
+	}
+
+	return expression;
+}
+
+static void dp_trie_add(dp_program_t *program, const char *key, int exact, uint32_t id)
+{
+	dp_trie_node_t *node = &program->trie, *child;
+	dp_id_t *entry, **list;
+	const char *p;
+
+	for (p = key; *p; p++) {
+		for (child = node->child; child && child->c != *p; child = child->next);
+
+		if (!child) {
+			child = switch_core_alloc(program->pool, sizeof(*child));
+			child->c = *p;
+			child->next = node->child;
+			node->child = child;
+		}
+
+		node = child;
+	}
+
+	entry = switch_core_alloc(program->pool, sizeof(*entry));
+	entry->id = id;
+
+	/* keep the lists in document order so nothing needs sorting later */
+	for (list = exact ? &node->exact : &node->prefix; *list; list = &(*list)->next);
+	*list = entry;
+}
+
+static dp_program_t *dp_program_compile(switch_xml_t root, switch_xml_t xcontext, const char *context)
+{
+	switch_memory_pool_t *pool = NULL;
+	dp_program_t *program;
+	switch_xml_t xexten;
+	uint32_t id = 0;
+
+	switch_core_new_memory_pool(&pool);
+	program = switch_core_alloc(pool, sizeof(*program));
+	program->pool = pool;
+	program->root = root;
+	program->refs = 1;
+
+	for (xexten = switch_xml_child(xcontext, "extension"); xexten; xexten = xexten->next) {
+		program->count++;
+	}
+
+	program->words = (program->count + 31) / 32;
+	program->extens = switch_core_alloc(pool, sizeof(switch_xml_t) * (program->count + 1));
+	program->always = switch_core_alloc(pool, sizeof(uint32_t) * (program->words + 1));
+
+	for (xexten = switch_xml_child(xcontext, "extension"); xexten; xexten = xexten->next, id++) {
+		const char *expression;
+		char key[256];
+		int exact = 0;
+
+		program->extens[id] = xexten;
+
+		if ((expression = dp_indexable_expression(xexten)) && dp_literal_prefix(expression, key, sizeof(key), &exact)) {
+			dp_trie_add(program, key, exact, id);
+			program->indexed++;
+		} else {
+			program->always[id / 32] |= (1u << (id % 32));
+		}
+	}
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Compiled dialplan context %s: %u extensions, %u indexed by destination_number\n",
+					  context, program->count, program->indexed);
+
+	return program;
+}
+
+/* A new program takes over the caller's reference on root and clears *root.  Holding it keeps the
+   document, and so its address, alive for as long as the program is cached, which is what makes
+   comparing roots by pointer safe. */
+static dp_program_t *dp_program_get(switch_xml_t *root, switch_xml_t xcontext, const char *context)
+{
+	dp_program_t *program, *old = NULL;
+
+	switch_mutex_lock(globals.mutex);
+	if ((program = switch_core_hash_find(globals.programs, context))) {
+		if (program->root == *root) {
+			program->refs++;
+			switch_mutex_unlock(globals.mutex);
+			return program;
+		}
+		switch_core_hash_delete(globals.programs, context);
+		old = program;
+	}
+	switch_mutex_unlock(globals.mutex);
+
+	if (old) {
+		dp_program_release(old);
+	}
+
+	program = dp_program_compile(*root, xcontext, context);
+	*root = NULL;
+
+	switch_mutex_lock(globals.mutex);
+	if ((old = switch_core_hash_find(globals.programs, context))) {
+		/* raced with another hunt, the newer copy wins */
+		switch_core_hash_delete(globals.programs, context);
+		if (!--old->refs) {
+			dp_program_destroy(old);
+		}
+	}
+	switch_core_hash_insert(globals.programs, context, program);
+	program->refs++;
+	switch_mutex_unlock(globals.mutex);
+
+	return program;
+}
+
+static void dp_program_select(dp_program_t *program, const char *destination_number, uint32_t *bits)
+{
+	dp_trie_node_t *node = &program->trie;
+	dp_id_t *entry;
+	const char *p;
+
+	memcpy(bits, program->always, sizeof(uint32_t) * program->words);
+
+	for (p = destination_number; node; p++) {
+		for (entry = node->prefix; entry; entry = entry->next) {
+			bits[entry->id / 32] |= (1u << (entry->id % 32));
+		}
+
+		if (!*p) {
+			for (entry = node->exact; entry; entry = entry->next) {
+				bits[entry->id / 32] |= (1u << (entry->id % 32));
+			}
+			break;
+		}
+
+		for (node = node->child; node && node->c != *p; node = node->next);
+	}
+}
+
+static switch_xml_t dp_program_next(dp_program_t *program, uint32_t *bits, uint32_t *pos)
+{
+	uint32_t id;
+
+	for (id = *pos; id < program->count; id++) {
+		if (bits[id / 32] & (1u << (id % 32))) {
+			*pos = id + 1;
+			return program->extens[id];
+		}
+	}
+
+	*pos = program->count;
+
+	return NULL;
+}
+
 static switch_status_t dialplan_xml_locate(switch_core_session_t *session, switch_caller_profile_t *caller_profile, switch_xml_t *root,
 										   switch_xml_t *node)
 {
@@ -622,6 +949,8 @@ SWITCH_STANDARD_DIALPLAN(dialplan_hunt)
 	switch_xml_t alt_root = NULL, cfg, xml = NULL, xcontext, xexten = NULL;
 	char *alt_path = (char *) arg;
 	const char *hunt = NULL;
+	dp_program_t *program = NULL;
+	uint32_t *bits = NULL, pos = 0;
 
 	if (!caller_profile) {
 		if (!(caller_profile = switch_channel_get_caller_profile(channel))) {
@@ -673,7 +1002,20 @@ SWITCH_STANDARD_DIALPLAN(dialplan_hunt)
 		xexten = switch_xml_find_child(xcontext, "extension", "name", caller_profile->destination_number);
 	}
 
-	if (!xexten) {
+	if (!xexten && zstr(alt_path) && switch_true(switch_xml_attr(xcontext, "compile"))) {
+		const char *destination_number = switch_str_nil(caller_profile->destination_number);
+		switch_xml_t main_root = switch_xml_root();
+
+		/* documents handed out by bindings live for one lookup, only the main root is worth compiling */
+		if (main_root == xml && !strchr(destination_number, '\n')) {
+			program = dp_program_get(&main_root, xcontext, caller_profile->context);
+			switch_zmalloc(bits, sizeof(uint32_t) * (program->words + 1));
+			dp_program_select(program, destination_number, bits);
+			xexten = dp_program_next(program, bits, &pos);
+		}
+
+		switch_xml_free(main_root);
+	} else if (!xexten) {
 		xexten = switch_xml_child(xcontext, "extension");
 	}
 
@@ -702,13 +1044,17 @@ SWITCH_STANDARD_DIALPLAN(dialplan_hunt)
 			break;
 		}
 
-		xexten = xexten->next;
+		xexten = program ? dp_program_next(program, bits, &pos) : xexten->next;
 	}
 
 	switch_xml_free(xml);
 	xml = NULL;
 
   done:
+	if (program) {
+		dp_program_release(program);
+	}
+	switch_safe_free(bits);
 	switch_xml_free(xml);
 	return extension;
 }
@@ -721,10 +1067,28 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_dialplan_xml_load)
 	*module_interface = switch_loadable_module_create_module_interface(pool, modname);
 	SWITCH_ADD_DIALPLAN(dp_interface, "XML", dialplan_hunt);
 
+	memset(&globals, 0, sizeof(globals));
+	globals.pool = pool;
+	switch_mutex_init(&globals.mutex, SWITCH_MUTEX_NESTED, globals.pool);
+	switch_core_hash_init(&globals.programs);
+
+	if (switch_event_bind_removable(modname, SWITCH_EVENT_RELOADXML, NULL, reload_event_handler, NULL, &globals.reload_node) != SWITCH_STATUS_SUCCESS) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Couldn't bind reloadxml, compiled contexts will rebuild on first use only\n");
+	}
+
 	/* indicate that the module should continue to be loaded */
 	return SWITCH_STATUS_SUCCESS;
 }
 
+SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_dialplan_xml_shutdown)
+{
+	switch_event_unbind(&globals.reload_node);
+	dp_program_flush();
+	switch_core_hash_destroy(&globals.programs);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 /* For Emacs:
  * Local Variables:
  * mode:c
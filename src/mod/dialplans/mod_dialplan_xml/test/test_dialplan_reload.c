@@ -0,0 +1,98 @@
+#include <switch.h>
+#include <tap.h>
+
+/* the compiled program helpers are static, test them in place */
+#include "../mod_dialplan_xml.c"
+
+static switch_xml_t install_root(const char *number)
+{
+  char *text = switch_mprintf("<document type=\"freeswitch/xml\"><section name=\"dialplan\">"
+                              "<context name=\"default\" compile=\"true\">"
+                              "<extension name=\"%s\"><condition field=\"destination_number\" expression=\"^%s$\">"
+                              "<action application=\"answer\"/></condition></extension>"
+                              "<extension name=\"catchall\"><condition field=\"${sip_user}\" expression=\"x\"/></extension>"
+                              "</context></section></document>", number, number);
+  switch_xml_t xml = switch_xml_parse_str_dup(text);
+
+  free(text);
+  switch_xml_set_root(xml);
+
+  return xml;
+}
+
+static switch_xml_t default_context(switch_xml_t root)
+{
+  switch_xml_t section = switch_xml_find_child(root, "section", "name", "dialplan");
+
+  return switch_xml_find_child(section, "context", "name", "default");
+}
+
+static const char *first_match(dp_program_t *program, const char *number)
+{
+  uint32_t *bits, pos = 0;
+  switch_xml_t xexten;
+
+  switch_zmalloc(bits, sizeof(uint32_t) * (program->words + 1));
+  dp_program_select(program, number, bits);
+  xexten = dp_program_next(program, bits, &pos);
+  free(bits);
+
+  return xexten ? switch_xml_attr(xexten, "name") : NULL;
+}
+
+int main () {
+  switch_loadable_module_interface_t *module_interface = NULL;
+  switch_memory_pool_t *pool = NULL;
+  switch_xml_t old_doc, root;
+  dp_program_t *first, *again, *second;
+  const char *err = NULL;
+
+  plan(10);
+
+  if (!ok(switch_core_init(SCF_MINIMAL, SWITCH_TRUE, &err) == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+  switch_core_new_memory_pool(&pool);
+  mod_dialplan_xml_load(&module_interface, pool);
+
+  old_doc = install_root("1000");
+  root = switch_xml_root();
+  first = dp_program_get(&root, default_context(old_doc), "default");
+  ok(root == NULL, "compiled program keeps the root reference");
+  is(first_match(first, "1000"), "1000", "program indexes the first document");
+
+  root = switch_xml_root();
+  again = dp_program_get(&root, default_context(old_doc), "default");
+  ok(again == first && root == old_doc, "same root reuses the cached program");
+  switch_xml_free(root);
+  dp_program_release(again);
+
+  /* a newer root drops the main reference on the old one, the program's keeps it alive */
+  install_root("2000");
+  is(switch_xml_attr(switch_xml_child(default_context(first->root), "extension"), "name"), "1000", "replaced root stays readable while cached");
+
+  root = switch_xml_root();
+  second = dp_program_get(&root, default_context(root), "default");
+  ok(second != first, "new root compiles a new program");
+  is(first_match(second, "2000"), "2000", "new program indexes the new document");
+  ok(first_match(second, "1000") && !strcmp(first_match(second, "1000"), "catchall"), "old extension is gone");
+
+  /* the hunt that held the first program lets go, that frees the old document */
+  dp_program_release(first);
+  dp_program_release(second);
+
+  reload_event_handler(NULL);
+  ok(switch_core_hash_empty(globals.programs), "reloadxml drops every program");
+
+  root = switch_xml_root();
+  second = dp_program_get(&root, default_context(root), "default");
+  is(first_match(second, "2000"), "2000", "program is rebuilt after reloadxml");
+  dp_program_release(second);
+
+  mod_dialplan_xml_shutdown();
+  switch_core_destroy_memory_pool(&pool);
+  switch_core_destroy();
+
+  done_testing();
+}
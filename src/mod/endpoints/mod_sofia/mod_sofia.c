@@ -457,6 +457,13 @@ switch_status_t sofia_on_hangup(switch_core_session_t *session)
 		char *sql = switch_mprintf("delete from sip_dialogs where uuid='%q'", switch_core_session_get_uuid(session));
 		switch_assert(sql);
 		sofia_glue_execute_sql_now(tech_pvt->profile, &sql, SWITCH_TRUE);
+
+		if (sofia_presence_store_enabled(tech_pvt->profile)) {
+			sofia_dlg_match_t match = { 0 };
+
+			match.uuid = switch_core_session_get_uuid(session);
+			sofia_presence_store_dialog_delete(tech_pvt->profile->pres_store, &match);
+		}
 	}
 
 	if (tech_pvt->kick && (a_session = switch_core_session_locate(tech_pvt->kick))) {
@@ -1470,6 +1477,15 @@ static switch_status_t sofia_receive_message(switch_core_session_t *session, swi
 										   switch_core_session_get_uuid(session));
 				switch_assert(sql);
 				sofia_glue_execute_sql_now(tech_pvt->profile, &sql, SWITCH_TRUE);
+
+				if (sofia_presence_store_enabled(tech_pvt->profile)) {
+					sofia_dlg_match_t match = { 0 };
+					sofia_dlg_col_t set[] = { SOFIA_DLG_COL_PRESENCE_ID };
+					const char *val = switch_str_nil(presence_id);
+
+					match.uuid = switch_core_session_get_uuid(session);
+					sofia_presence_store_dialog_update(tech_pvt->profile->pres_store, &match, set, &val, 1);
+				}
 			}
 
 			if (sofia_test_media_flag(tech_pvt->profile, SCMF_AUTOFIX_TIMING)) {
@@ -2764,11 +2780,21 @@ static int sql2str_callback(void *pArg, int argc, char **argv, char **columnName
 	return 0;
 }
 
+static int username_store_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	return sql2str_callback(pArg, 1, &argv[SOFIA_REG_COL_SIP_USERNAME], NULL);
+}
+
 static uint32_t sofia_profile_reg_count(sofia_profile_t *profile)
 {
 	struct cb_helper_sql2str cb;
 	char reg_count[80] = "";
 	char *sql;
+
+	if (sofia_reg_store_enabled(profile)) {
+		return sofia_reg_store_count(profile->reg_store);
+	}
+
 	cb.buf = reg_count;
 	cb.len = sizeof(reg_count);
 	sql = switch_mprintf("select count(*) from sip_registrations where profile_name = '%q'", profile->name);
@@ -2777,6 +2803,38 @@ static uint32_t sofia_profile_reg_count(sofia_profile_t *profile)
 	return strtoul(reg_count, NULL, 10);
 }
 
+/* the rows "sofia status profile <name> reg|pres|user" selects, the store's first 20 columns are the ones the show callbacks read */
+static void sofia_reg_store_show(sofia_profile_t *profile, char **argv, switch_core_db_callback_func_t callback, void *pArg)
+{
+	sofia_reg_match_t match = { 0 };
+	char *dup = NULL;
+
+	if (!strcasecmp(argv[2], "pres")) {
+		match.presence_like = argv[3];
+	} else if (!strcasecmp(argv[2], "reg")) {
+		match.contact_like = argv[3];
+	} else if (!strcasecmp(argv[2], "user")) {
+		char *host = NULL, *user = NULL;
+
+		dup = strdup(argv[3]);
+		switch_assert(dup);
+
+		if ((host = strchr(dup, '@'))) {
+			*host++ = '\0';
+			user = dup;
+		} else {
+			host = dup;
+		}
+
+		match.user = zstr(user) ? NULL : user;
+		match.host = zstr(host) ? NULL : host;
+	}
+
+	sofia_reg_store_select(profile->reg_store, &match, callback, pArg);
+
+	switch_safe_free(dup);
+}
+
 static const char *status_names[] = { "DOWN", "UP", NULL };
 
 static switch_status_t cmd_status(char **argv, int argc, switch_stream_handle_t *stream)
@@ -2923,6 +2981,7 @@ static switch_status_t cmd_status(char **argv, int argc, switch_stream_handle_t
 						stream->write_function(stream, "URL              \t%s\n", switch_str_nil(profile->url));
 						stream->write_function(stream, "BIND-URL         \t%s\n", switch_str_nil(profile->bindurl));
 					}
+					sofia_listener_status(profile, stream);
 					if (sofia_test_pflag(profile, PFLAG_TLS)) {
 						stream->write_function(stream, "TLS-URL          \t%s\n", switch_str_nil(profile->tls_url));
 						stream->write_function(stream, "TLS-BIND-URL     \t%s\n", switch_str_nil(profile->tls_bindurl));
@@ -2965,7 +3024,17 @@ static switch_status_t cmd_status(char **argv, int argc, switch_stream_handle_t
 					stream->write_function(stream, "FAILED-CALLS-IN  \t%u\n", profile->ib_failed_calls);
 					stream->write_function(stream, "CALLS-OUT        \t%u\n", profile->ob_calls);
 					stream->write_function(stream, "FAILED-CALLS-OUT \t%u\n", profile->ob_failed_calls);
-					stream->write_function(stream, "REGISTRATIONS    \t%lu\n", sofia_profile_reg_count(profile));
+					if (sofia_reg_store_enabled(profile)) {
+						sofia_reg_store_status(profile->reg_store, stream);
+					} else {
+						stream->write_function(stream, "REGISTRATIONS    \t%lu\n", sofia_profile_reg_count(profile));
+					}
+					if (sofia_nonce_store_enabled(profile)) {
+						sofia_nonce_store_status(profile->nonce_store, stream);
+					}
+					if (sofia_presence_store_enabled(profile)) {
+						sofia_presence_store_status(profile->pres_store, stream);
+					}
 				}
 
 				cb.profile = profile;
@@ -3022,7 +3091,11 @@ static switch_status_t cmd_status(char **argv, int argc, switch_stream_handle_t
 				if (sql) {
 					stream->write_function(stream, "\nRegistrations:\n%s\n", line);
 
-					sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, show_reg_callback, &cb);
+					if (sofia_reg_store_enabled(profile)) {
+						sofia_reg_store_show(profile, argv, show_reg_callback, &cb);
+					} else {
+						sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, show_reg_callback, &cb);
+					}
 					switch_safe_free(sql);
 
 					stream->write_function(stream, "Total items returned: %d\n", cb.row_process);
@@ -3089,6 +3162,9 @@ static switch_status_t cmd_status(char **argv, int argc, switch_stream_handle_t
 	switch_mutex_unlock(mod_sofia_globals.hash_mutex);
 	stream->write_function(stream, "%s\n", line);
 	stream->write_function(stream, "%d profile%s %d alias%s\n", c, c == 1 ? "" : "s", ac, ac == 1 ? "" : "es");
+	stream->write_function(stream, "%s\n", line);
+	sofia_msg_queue_status(stream);
+	stream->write_function(stream, "%s\n", line);
 	return SWITCH_STATUS_SUCCESS;
 }
 
@@ -3331,7 +3407,11 @@ static switch_status_t cmd_xml_status(char **argv, int argc, switch_stream_handl
 				if (sql) {
 					stream->write_function(stream, "  <registrations>\n");
 
-					sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, show_reg_callback_xml, &cb);
+					if (sofia_reg_store_enabled(profile)) {
+						sofia_reg_store_show(profile, argv, show_reg_callback_xml, &cb);
+					} else {
+						sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, show_reg_callback_xml, &cb);
+					}
 					switch_safe_free(sql);
 
 					stream->write_function(stream, "  </registrations>\n");
@@ -3641,7 +3721,7 @@ static switch_status_t cmd_profile(char **argv, int argc, switch_stream_handle_t
 	if (!strcasecmp(argv[1], "siptrace")) {
 		if (argc > 2) {
 			int value = switch_true(argv[2]);
-			nua_set_params(profile->nua, TPTAG_LOG(value), TAG_END());
+			sofia_glue_profile_siptrace(profile, value);
 			stream->write_function(stream, "%s sip debugging on %s", value ? "Enabled" : "Disabled", profile->name);
 		} else {
 			stream->write_function(stream, "Usage: sofia profile <name> siptrace <on/off>\n");
@@ -3652,7 +3732,7 @@ static switch_status_t cmd_profile(char **argv, int argc, switch_stream_handle_t
 	if (!strcasecmp(argv[1], "capture")) {
 		if (argc > 2) {
 			int value = switch_true(argv[2]);
-			nua_set_params(profile->nua, TPTAG_CAPT(value ? mod_sofia_globals.capture_server : NULL), TAG_END());
+			sofia_glue_profile_capture(profile, value);
 			stream->write_function(stream, "%s sip capturing on %s", value ? "Enabled" : "Disabled", profile->name);
 		} else {
 			stream->write_function(stream, "Usage: sofia profile <name> capture <on/off>\n");
@@ -3696,6 +3776,25 @@ static switch_status_t cmd_profile(char **argv, int argc, switch_stream_handle_t
 	return SWITCH_STATUS_SUCCESS;
 }
 
+struct contact_store_helper {
+	struct cb_helper *cb;
+	const char *concat;
+};
+
+static int contact_callback(void *pArg, int argc, char **argv, char **columnNames);
+
+static int contact_store_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	struct contact_store_helper *helper = (struct contact_store_helper *) pArg;
+	char *row[3];
+
+	row[0] = argv[SOFIA_REG_COL_CONTACT];
+	row[1] = argv[SOFIA_REG_COL_PROFILE_NAME];
+	row[2] = (char *) (helper->concat ? helper->concat : "");
+
+	return contact_callback(helper->cb, 3, row, NULL);
+}
+
 static int contact_callback(void *pArg, int argc, char **argv, char **columnNames)
 {
 	struct cb_helper *cb = (struct cb_helper *) pArg;
@@ -3787,19 +3886,27 @@ SWITCH_STANDARD_API(sofia_count_reg_function)
 				domain = profile->name;
 			}
 
-			if (zstr(user)) {
-				sql = switch_mprintf("select count(*) "
-									 "from sip_registrations where (sip_host='%q' or presence_hosts like '%%%q%%')",
-									 domain, domain);
+			if (sofia_reg_store_enabled(profile)) {
+				sofia_reg_match_t match = { 0 };
 
+				match.user = zstr(user) ? NULL : user;
+				match.host_or_presence = domain;
+				switch_snprintf(reg_count, sizeof(reg_count), "%u", sofia_reg_store_select(profile->reg_store, &match, NULL, NULL));
 			} else {
-				sql = switch_mprintf("select count(*) "
-									 "from sip_registrations where sip_user='%q' and (sip_host='%q' or presence_hosts like '%%%q%%')",
-									 user, domain, domain);
+				if (zstr(user)) {
+					sql = switch_mprintf("select count(*) "
+										 "from sip_registrations where (sip_host='%q' or presence_hosts like '%%%q%%')",
+										 domain, domain);
+
+				} else {
+					sql = switch_mprintf("select count(*) "
+										 "from sip_registrations where sip_user='%q' and (sip_host='%q' or presence_hosts like '%%%q%%')",
+										 user, domain, domain);
+				}
+				switch_assert(sql);
+				sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sql2str_callback, &cb);
+				switch_safe_free(sql);
 			}
-			switch_assert(sql);
-			sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sql2str_callback, &cb);
-			switch_safe_free(sql);
 			if (!zstr(reg_count)) {
 				stream->write_function(stream, "%s", reg_count);
 			} else {
@@ -3882,14 +3989,22 @@ SWITCH_STANDARD_API(sofia_username_of_function)
 
 			switch_assert(!zstr(user));
 
-			sql = switch_mprintf("select sip_username "
-									"from sip_registrations where sip_user='%q' and (sip_host='%q' or presence_hosts like '%%%q%%')",
-									user, domain, domain);
+			if (sofia_reg_store_enabled(profile)) {
+				sofia_reg_match_t match = { 0 };
 
-			switch_assert(sql);
+				match.user = user;
+				match.host_or_presence = domain;
+				sofia_reg_store_select(profile->reg_store, &match, username_store_callback, &cb);
+			} else {
+				sql = switch_mprintf("select sip_username "
+										"from sip_registrations where sip_user='%q' and (sip_host='%q' or presence_hosts like '%%%q%%')",
+										user, domain, domain);
+
+				switch_assert(sql);
 
-			sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sql2str_callback, &cb);
-			switch_safe_free(sql);
+				sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sql2str_callback, &cb);
+				switch_safe_free(sql);
+			}
 			if (!zstr(username)) {
 				stream->write_function(stream, "%s", username);
 			} else {
@@ -3933,6 +4048,19 @@ static void select_from_profile(sofia_profile_t *profile,
 	cb.stream = stream;
 	cb.dedup = dedup;
 
+	if (sofia_reg_store_enabled(profile)) {
+		struct contact_store_helper helper = { &cb, concat };
+		sofia_reg_match_t match = { 0 };
+
+		match.user = user;
+		match.user_nocase = SWITCH_TRUE;
+		match.host_or_presence = domain;
+		match.user_agent_like = match_user_agent;
+		match.exclude_contact_like = exclude_contact;
+		sofia_reg_store_select(profile->reg_store, &match, contact_store_callback, &helper);
+		return;
+	}
+
 	if (match_user_agent) {
 		sql_match_user_agent = switch_mprintf(" and user_agent like '%%%q%%'",  match_user_agent);
 	}
@@ -4348,6 +4476,9 @@ SWITCH_STANDARD_API(sofia_function)
 		"sofia <status|xmlstatus> gateway <name>\n\n"
 		"sofia loglevel <all|default|tport|iptsec|nea|nta|nth_client|nth_server|nua|soa|sresolv|stun> [0-9]\n"
 		"sofia tracelevel <console|alert|crit|err|warning|notice|info|debug>\n\n"
+		"sofia regstore bench <registrations> [<rounds>]\n"
+		"sofia noncestore bench <auths> [<profile>]\n"
+		"sofia presstore bench <subscriptions> [<watchers per extension>]\n\n"
 		"sofia help\n"
 		"--------------------------------------------------------------------------------\n";
 
@@ -4500,6 +4631,44 @@ SWITCH_STANDARD_API(sofia_function)
 
 		goto done;
 
+	} else if (!strcasecmp(argv[0], "regstore")) {
+		if (argc > 2 && !strcasecmp(argv[1], "bench") && atoi(argv[2]) > 0) {
+			sofia_reg_store_bench(atoi(argv[2]), argc > 3 && atoi(argv[3]) > 0 ? atoi(argv[3]) : 3, stream);
+		} else {
+			stream->write_function(stream, "-ERR Usage: regstore bench <registrations> [<rounds>]\n");
+		}
+
+		goto done;
+
+	} else if (!strcasecmp(argv[0], "noncestore")) {
+		if (argc > 2 && !strcasecmp(argv[1], "bench") && atoi(argv[2]) > 0) {
+			sofia_profile_t *profile = NULL;
+
+			if (argc > 3 && !(profile = sofia_glue_find_profile(argv[3]))) {
+				stream->write_function(stream, "-ERR No such profile %s\n", argv[3]);
+				goto done;
+			}
+
+			sofia_nonce_store_bench(profile, atoi(argv[2]), stream);
+
+			if (profile) {
+				sofia_glue_release_profile(profile);
+			}
+		} else {
+			stream->write_function(stream, "-ERR Usage: noncestore bench <auths> [<profile>]\n");
+		}
+
+		goto done;
+
+	} else if (!strcasecmp(argv[0], "presstore")) {
+		if (argc > 2 && !strcasecmp(argv[1], "bench") && atoi(argv[2]) > 0) {
+			sofia_presence_store_bench(atoi(argv[2]), argc > 3 && atoi(argv[3]) > 0 ? atoi(argv[3]) : 10, stream);
+		} else {
+			stream->write_function(stream, "-ERR Usage: presstore bench <subscriptions> [<watchers per extension>]\n");
+		}
+
+		goto done;
+
 	} else if (!strcasecmp(argv[0], "recover")) {
 		if (argv[1] && !strcasecmp(argv[1], "flush")) {
 			sofia_glue_recover(SWITCH_TRUE);
@@ -5661,7 +5830,7 @@ void general_event_handler(switch_event_t *event)
 			}
 
 			if (call_id) {
-				nh = nua_handle_by_call_id(profile->nua, call_id);
+				nh = sofia_glue_handle_by_call_id(profile, call_id);
 
 				if (!nh) {
 					switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Invalid Call-ID %s\n", call_id);
@@ -6166,11 +6335,6 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_sofia_load)
 		mod_sofia_globals.max_msg_queues = SOFIA_MAX_MSG_QUEUE;
 	}
 
-	switch_queue_create(&mod_sofia_globals.msg_queue, SOFIA_MSG_QUEUE_SIZE * mod_sofia_globals.max_msg_queues, mod_sofia_globals.pool);
-
-	/* start one message thread */
-	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "Starting initial message thread.\n");
-
 
 	if (sofia_init() != SWITCH_STATUS_SUCCESS) {
 		switch_goto_status(SWITCH_STATUS_GENERR, err);
@@ -6183,7 +6347,8 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_sofia_load)
 		return SWITCH_STATUS_GENERR;
 	}
 
-	sofia_msg_thread_start(0);
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "Starting %d message threads.\n", mod_sofia_globals.max_msg_queues);
+	sofia_msg_thread_start(mod_sofia_globals.max_msg_queues - 1);
 
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Waiting for profiles to start\n");
 	switch_yield(1500000);
@@ -6302,6 +6467,9 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_sofia_load)
 	switch_console_set_complete("add sofia profile ::sofia::list_profiles gwlist ::[up:down");
 
 	switch_console_set_complete("add sofia recover flush");
+	switch_console_set_complete("add sofia regstore bench");
+	switch_console_set_complete("add sofia noncestore bench");
+	switch_console_set_complete("add sofia presstore bench");
 
 	switch_console_set_complete("add sofia xmlstatus profile ::sofia::list_profiles reg");
 	switch_console_set_complete("add sofia xmlstatus gateway ::sofia::list_gateways");
@@ -6331,7 +6499,6 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_sofia_load)
 
 void mod_sofia_shutdown_cleanup() {
 	int sanity = 0;
-	int i;
 	switch_status_t st;
 
 	switch_event_free_subclass(MY_EVENT_NOTIFY_REFER);
@@ -6381,14 +6548,7 @@ void mod_sofia_shutdown_cleanup() {
 		}
 	}
 
-	for (i = 0; mod_sofia_globals.msg_queue_thread[i]; i++) {
-		switch_queue_push(mod_sofia_globals.msg_queue, NULL);
-		switch_queue_interrupt_all(mod_sofia_globals.msg_queue);
-	}
-
-	for (i = 0; mod_sofia_globals.msg_queue_thread[i]; i++) {
-		switch_thread_join(&st, mod_sofia_globals.msg_queue_thread[i]);
-	}
+	sofia_msg_thread_stop();
 
 	if (mod_sofia_globals.presence_thread) {
 		switch_thread_join(&st, mod_sofia_globals.presence_thread);
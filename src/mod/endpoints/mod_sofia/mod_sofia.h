@@ -72,6 +72,15 @@ struct sofia_profile;
 typedef struct sofia_profile sofia_profile_t;
 #define NUA_MAGIC_T sofia_profile_t
 
+struct sofia_reg_store;
+typedef struct sofia_reg_store sofia_reg_store_t;
+
+struct sofia_nonce_store;
+typedef struct sofia_nonce_store sofia_nonce_store_t;
+
+struct sofia_presence_store;
+typedef struct sofia_presence_store sofia_presence_store_t;
+
 typedef struct sofia_private sofia_private_t;
 
 struct private_object;
@@ -146,6 +155,7 @@ typedef struct private_object private_object_t;
 #include "sofia-sip/msg_parser.h"
 #include "sofia-sip/sip_parser.h"
 #include "sofia-sip/tport_tag.h"
+#include <sofia-sip/nta_tport.h>
 #include <sofia-sip/msg.h>
 #include <sofia-sip/uniqueid.h>
 
@@ -309,6 +319,11 @@ typedef enum {
 	PFLAG_FIRE_BYE_RESPONSE_EVENTS,
 	PFLAG_AUTO_INVITE_100,
 	PFLAG_UPDATE_REFRESHER,
+	PFLAG_SQL_REGISTRATIONS,
+	PFLAG_REG_DB_MIRROR,
+	PFLAG_SQL_NONCES,
+	PFLAG_STATELESS_NONCES,
+	PFLAG_SQL_PRESENCE,
 
 	/* No new flags below this line */
 	PFLAG_MAX
@@ -369,6 +384,18 @@ typedef enum {
 #define SOFIA_MAX_MSG_QUEUE 64
 #define SOFIA_MSG_QUEUE_SIZE 1000
 
+/* one dispatch queue and its worker, events are sharded over them by Call-ID so a dialog
+   is always handled by the same thread and in order */
+typedef struct sofia_msg_queue_s {
+	switch_mpsc_queue_t *queue;
+	switch_thread_t *thread;
+	int id;
+	uint64_t processed;
+	uint64_t stolen;
+	switch_time_t busy;
+	switch_time_t max_service;
+} sofia_msg_queue_t;
+
 struct mod_sofia_globals {
 	switch_memory_pool_t *pool;
 	switch_hash_t *profile_hash;
@@ -383,10 +410,11 @@ struct mod_sofia_globals {
 	char guess_ip[80];
 	char hostname[512];
 	switch_queue_t *presence_queue;
-	switch_queue_t *msg_queue;
 	switch_queue_t *general_event_queue;
-	switch_thread_t *msg_queue_thread[SOFIA_MAX_MSG_QUEUE];
+	sofia_msg_queue_t msg_queues[SOFIA_MAX_MSG_QUEUE];
 	int msg_queue_len;
+	switch_mpsc_queue_t *msg_steal_queue;
+	int msg_work_stealing;
 	struct sofia_private destroy_private;
 	struct sofia_private keep_private;
 	int guess_mask;
@@ -597,6 +625,20 @@ typedef enum {
 	KA_INFO
 } ka_type_t;
 
+#define SOFIA_MAX_LISTENERS 16
+
+/* one of several sip stacks sharing the profile udp port through SO_REUSEPORT, messages the
+   kernel gives to a stack not holding their dialog or transaction are passed round the others */
+typedef struct sofia_listener_s {
+	nua_t *nua;
+	int shutdown;
+	uint64_t handed;
+	uint64_t taken;
+	msg_t *redelivering;
+	int origin;
+	int hops;
+} sofia_listener_t;
+
 struct sofia_profile {
 	int debug;
 	int parse_invite_tel_params;
@@ -691,6 +733,10 @@ struct sofia_profile {
 	switch_hash_t *chat_hash;
 	switch_hash_t *reg_nh_hash;
 	switch_hash_t *mwi_debounce_hash;
+	sofia_reg_store_t *reg_store;
+	sofia_nonce_store_t *nonce_store;
+	sofia_presence_store_t *pres_store;
+	uint32_t presence_notify_interval;
 	//switch_core_db_t *master_db;
 	switch_thread_rwlock_t *rwlock;
 	switch_mutex_t *flag_mutex;
@@ -782,6 +828,10 @@ struct sofia_profile {
 	ka_type_t keepalive;
 	int bind_attempts;
 	int bind_attempt_interval;
+	int listen_instances;
+	sofia_listener_t listeners[SOFIA_MAX_LISTENERS];
+	int listener_count;
+	int listeners_running;
 	char *proxy_notify_events;
 	char *proxy_info_content_types;
 };
@@ -874,6 +924,144 @@ struct callback_t {
 	long exptime;
 };
 
+/* columns of a registration in the memory store, the first 20 are in the order sofia status selects them */
+typedef enum {
+	SOFIA_REG_COL_CALL_ID,
+	SOFIA_REG_COL_SIP_USER,
+	SOFIA_REG_COL_SIP_HOST,
+	SOFIA_REG_COL_CONTACT,
+	SOFIA_REG_COL_STATUS,
+	SOFIA_REG_COL_RPID,
+	SOFIA_REG_COL_EXPIRES,
+	SOFIA_REG_COL_USER_AGENT,
+	SOFIA_REG_COL_SERVER_USER,
+	SOFIA_REG_COL_SERVER_HOST,
+	SOFIA_REG_COL_PROFILE_NAME,
+	SOFIA_REG_COL_HOSTNAME,
+	SOFIA_REG_COL_NETWORK_IP,
+	SOFIA_REG_COL_NETWORK_PORT,
+	SOFIA_REG_COL_SIP_USERNAME,
+	SOFIA_REG_COL_SIP_REALM,
+	SOFIA_REG_COL_MWI_USER,
+	SOFIA_REG_COL_MWI_HOST,
+	SOFIA_REG_COL_PING_STATUS,
+	SOFIA_REG_COL_PING_TIME,
+	SOFIA_REG_COL_PRESENCE_HOSTS,
+	SOFIA_REG_COL_SUB_HOST,
+	SOFIA_REG_COL_ORIG_SERVER_HOST,
+	SOFIA_REG_COL_ORIG_HOSTNAME,
+	SOFIA_REG_COL_PING_COUNT,
+	SOFIA_REG_COL_FORCE_PING,
+	SOFIA_REG_COL_MAX
+} sofia_reg_col_t;
+
+/* what a store lookup matches on, unset members match anything */
+typedef struct {
+	const char *call_id;
+	const char *call_id_not;
+	const char *user;
+	switch_bool_t user_nocase;
+	const char *host;
+	const char *host_or_presence;
+	const char *username;
+	const char *contact;
+	const char *contact_like;
+	const char *exclude_contact_like;
+	const char *presence_like;
+	const char *user_agent_like;
+	const char *network_ip;
+	const char *network_port;
+	const char *expires_not;
+	switch_bool_t expiring;
+} sofia_reg_match_t;
+
+#define sofia_reg_store_enabled(_profile) ((_profile)->reg_store && !sofia_test_pflag(_profile, PFLAG_SQL_REGISTRATIONS))
+#define sofia_nonce_store_enabled(_profile) ((_profile)->nonce_store && !sofia_test_pflag(_profile, PFLAG_SQL_NONCES))
+
+/* columns of a subscription in the presence store, the first 14 are in the order the presence fan-out selects them */
+typedef enum {
+	SOFIA_SUB_COL_PROTO,
+	SOFIA_SUB_COL_SIP_USER,
+	SOFIA_SUB_COL_SIP_HOST,
+	SOFIA_SUB_COL_SUB_TO_USER,
+	SOFIA_SUB_COL_SUB_TO_HOST,
+	SOFIA_SUB_COL_EVENT,
+	SOFIA_SUB_COL_CONTACT,
+	SOFIA_SUB_COL_CALL_ID,
+	SOFIA_SUB_COL_FULL_FROM,
+	SOFIA_SUB_COL_FULL_VIA,
+	SOFIA_SUB_COL_EXPIRES,
+	SOFIA_SUB_COL_USER_AGENT,
+	SOFIA_SUB_COL_ACCEPT,
+	SOFIA_SUB_COL_PROFILE_NAME,
+	SOFIA_SUB_COL_PRESENCE_HOSTS,
+	SOFIA_SUB_COL_VERSION,
+	SOFIA_SUB_COL_ORIG_PROTO,
+	SOFIA_SUB_COL_FULL_TO,
+	SOFIA_SUB_COL_NETWORK_IP,
+	SOFIA_SUB_COL_NETWORK_PORT,
+	SOFIA_SUB_COL_MAX
+} sofia_sub_col_t;
+
+/* unset members match anything, hosts[] matches sub_to_host against each of them or presence_hosts against the first,
+   expired_by matches subscriptions with an expiry at or before it */
+typedef struct {
+	const char *call_id;
+	const char *proto;
+	const char *sub_to_user;
+	const char *sub_to_host;
+	const char *hosts[3];
+	const char *event;
+	const char *alt_event;
+	time_t expired_by;
+} sofia_sub_match_t;
+
+/* columns of a call dialog in the presence store, the first 5 are in the order the presence handler selects them */
+typedef enum {
+	SOFIA_DLG_COL_STATE,
+	SOFIA_DLG_COL_STATUS,
+	SOFIA_DLG_COL_RPID,
+	SOFIA_DLG_COL_PRESENCE_ID,
+	SOFIA_DLG_COL_UUID,
+	SOFIA_DLG_COL_CALL_ID,
+	SOFIA_DLG_COL_SIP_FROM_USER,
+	SOFIA_DLG_COL_SIP_FROM_HOST,
+	SOFIA_DLG_COL_CALL_INFO,
+	SOFIA_DLG_COL_CALL_INFO_STATE,
+	SOFIA_DLG_COL_RCD,
+	SOFIA_DLG_COL_MAX
+} sofia_dlg_col_t;
+
+/* user and host match the from user and host or the presence id of the dialog */
+typedef struct {
+	const char *uuid;
+	const char *uuid_not;
+	const char *call_id;
+	const char *user;
+	const char *host;
+	const char *call_info;
+	const char *call_info_state;
+	switch_bool_t not_seized;
+} sofia_dlg_match_t;
+
+/* a NOTIFY the presence store holds back until its subscriber is due another one */
+typedef struct sofia_presence_notify_s {
+	char *full_to;
+	char *full_from;
+	char *contact;
+	char *expires;
+	char *call_id;
+	char *event;
+	char *remote_ip;
+	char *remote_port;
+	char *ct;
+	char *pl;
+	switch_time_t due;
+	struct sofia_presence_notify_s *next;
+} sofia_presence_notify_t;
+
+#define sofia_presence_store_enabled(_profile) ((_profile)->pres_store && !sofia_test_pflag(_profile, PFLAG_SQL_PRESENCE))
+
 typedef enum {
 	REG_REGISTER,
 	REG_AUTO_REGISTER,
@@ -1065,6 +1253,8 @@ char *sofia_overcome_sip_uri_weakness(switch_core_session_t *session, const char
 switch_bool_t sofia_glue_execute_sql_callback(sofia_profile_t *profile, switch_mutex_t *mutex, char *sql, switch_core_db_callback_func_t callback,
 											  void *pdata);
 char *sofia_glue_execute_sql2str(sofia_profile_t *profile, switch_mutex_t *mutex, char *sql, char *resbuf, size_t len);
+char *sofia_glue_execute_sql2str_params(sofia_profile_t *profile, switch_mutex_t *mutex, const char *sql, int nparams, const char **params,
+										char *resbuf, size_t len);
 void sofia_glue_del_profile(sofia_profile_t *profile);
 
 switch_status_t sofia_glue_add_profile(char *key, sofia_profile_t *profile);
@@ -1213,6 +1403,10 @@ switch_console_callback_match_t *sofia_reg_find_reg_url_with_positive_expires_mu
 switch_bool_t sofia_glue_profile_exists(const char *key);
 void sofia_glue_global_siptrace(switch_bool_t on);
 void sofia_glue_global_capture(switch_bool_t on);
+void sofia_glue_profile_siptrace(sofia_profile_t *profile, switch_bool_t on);
+void sofia_glue_profile_capture(sofia_profile_t *profile, switch_bool_t on);
+nua_handle_t *sofia_glue_handle_by_call_id(sofia_profile_t *profile, const char *call_id);
+nua_handle_t *sofia_glue_handle_by_replaces(sofia_profile_t *profile, sip_replaces_t const *replaces);
 void sofia_glue_global_watchdog(switch_bool_t on);
 uint32_t sofia_presence_get_cseq(sofia_profile_t *profile);
 
@@ -1223,7 +1417,16 @@ void sofia_process_dispatch_event(sofia_dispatch_event_t **dep);
 void sofia_process_dispatch_event_in_thread(sofia_dispatch_event_t **dep);
 char *sofia_glue_get_host(const char *str, switch_memory_pool_t *pool);
 void sofia_presence_check_subscriptions(sofia_profile_t *profile, time_t now);
+void sofia_presence_store_load(sofia_profile_t *profile);
+void sofia_presence_store_subscribe(sofia_profile_t *profile, const char *proto, const char *orig_proto, const char *from_user, const char *from_host,
+									const char *to_user, const char *to_host, const char *event, const char *contact, const char *call_id,
+									const char *full_from, const char *full_via, const char *full_to, const char *to_tag,
+									const char *user_agent, const char *accept, sofia_nat_parse_t *np, time_t expires);
 void sofia_msg_thread_start(int idx);
+void sofia_msg_thread_stop(void);
+uint32_t sofia_msg_queue_depth(void);
+void sofia_msg_queue_status(switch_stream_handle_t *stream);
+void sofia_listener_status(sofia_profile_t *profile, switch_stream_handle_t *stream);
 void crtp_init(switch_loadable_module_interface_t *module_interface);
 int sofia_recover_callback(switch_core_session_t *session);
 void sofia_glue_set_name(private_object_t *tech_pvt, const char *channame);
@@ -1231,6 +1434,7 @@ private_object_t *sofia_glue_new_pvt(switch_core_session_t *session);
 switch_status_t sofia_init(void);
 void sofia_glue_fire_events(sofia_profile_t *profile);
 void sofia_event_fire(sofia_profile_t *profile, switch_event_t **event);
+int sofia_msg_queue_select(nua_event_t event, sip_t const *sip, sofia_private_t *sofia_private, const void *handle, int len, switch_bool_t stealing);
 void sofia_queue_message(sofia_dispatch_event_t *de);
 int sofia_glue_check_nat(sofia_profile_t *profile, const char *network_ip);
 void general_event_handler(switch_event_t *event);
@@ -1239,6 +1443,55 @@ switch_status_t sofia_glue_ext_address_lookup(sofia_profile_t *profile, char **i
 											  const char *sourceip, switch_memory_pool_t *pool);
 void sofia_reg_check_socket(sofia_profile_t *profile, const char *call_id, const char *network_addr, const char *network_ip);
 void sofia_reg_close_handles(sofia_profile_t *profile);
+void sofia_reg_execute_sql(sofia_profile_t *profile, char **sqlp, switch_bool_t now);
+void sofia_reg_store_load(sofia_profile_t *profile);
+void sofia_reg_store_drop(sofia_profile_t *profile, int multi_reg, int multi_reg_contact,
+						  const char *user, const char *host, const char *contact, const char *call_id);
+
+switch_status_t sofia_reg_store_create(sofia_reg_store_t **store, int ping_interval, switch_memory_pool_t *pool);
+void sofia_reg_store_destroy(sofia_reg_store_t **store);
+switch_status_t sofia_reg_store_insert(sofia_reg_store_t *store, const char *const *cols);
+char *sofia_reg_store_load_sql(const char *hostname, const char *profile_name);
+int sofia_reg_store_load_callback(void *pArg, int argc, char **argv, char **columnNames);
+uint32_t sofia_reg_store_update(sofia_reg_store_t *store, const sofia_reg_match_t *match, const sofia_reg_col_t *set, const char *const *vals, int nset);
+uint32_t sofia_reg_store_select(sofia_reg_store_t *store, const sofia_reg_match_t *match, switch_core_db_callback_func_t callback, void *pArg);
+uint32_t sofia_reg_store_delete(sofia_reg_store_t *store, const sofia_reg_match_t *match, switch_core_db_callback_func_t callback, void *pArg);
+uint32_t sofia_reg_store_expire(sofia_reg_store_t *store, time_t now, switch_core_db_callback_func_t callback, void *pArg);
+uint32_t sofia_reg_store_ping(sofia_reg_store_t *store, time_t now, int interval, switch_core_db_callback_func_t callback, void *pArg);
+switch_bool_t sofia_reg_store_ping_wanted(sofia_profile_t *profile, char *const *col);
+uint32_t sofia_reg_store_count(sofia_reg_store_t *store);
+void sofia_reg_store_status(sofia_reg_store_t *store, switch_stream_handle_t *stream);
+void sofia_reg_store_bench(uint32_t count, uint32_t rounds, switch_stream_handle_t *stream);
+
+switch_status_t sofia_nonce_store_create(sofia_nonce_store_t **store, switch_memory_pool_t *pool);
+void sofia_nonce_store_destroy(sofia_nonce_store_t **store);
+void sofia_nonce_store_set_secret(sofia_nonce_store_t *store, const char *secret);
+void sofia_nonce_store_issue(sofia_nonce_store_t *store, switch_bool_t stateless, time_t expires, char *buf, switch_size_t len);
+switch_status_t sofia_nonce_store_check(sofia_nonce_store_t *store, const char *nonce, uint32_t nc, uint32_t *last_nc);
+void sofia_nonce_store_update(sofia_nonce_store_t *store, const char *nonce, time_t expires, uint32_t nc);
+void sofia_nonce_store_delete(sofia_nonce_store_t *store, const char *nonce);
+uint32_t sofia_nonce_store_expire(sofia_nonce_store_t *store, time_t now);
+void sofia_nonce_store_status(sofia_nonce_store_t *store, switch_stream_handle_t *stream);
+void sofia_nonce_store_bench(sofia_profile_t *profile, uint32_t count, switch_stream_handle_t *stream);
+
+switch_status_t sofia_presence_store_create(sofia_presence_store_t **store, switch_memory_pool_t *pool);
+void sofia_presence_store_destroy(sofia_presence_store_t **store);
+void sofia_presence_store_sub_insert(sofia_presence_store_t *store, const char *const *cols);
+uint32_t sofia_presence_store_sub_update(sofia_presence_store_t *store, const sofia_sub_match_t *match, const sofia_sub_col_t *set, const char *const *vals, int nset);
+uint32_t sofia_presence_store_sub_select(sofia_presence_store_t *store, const sofia_sub_match_t *match, switch_bool_t bump,
+										 switch_core_db_callback_func_t callback, void *pArg);
+uint32_t sofia_presence_store_sub_delete(sofia_presence_store_t *store, const sofia_sub_match_t *match);
+void sofia_presence_store_dialog_insert(sofia_presence_store_t *store, const char *const *cols);
+uint32_t sofia_presence_store_dialog_update(sofia_presence_store_t *store, const sofia_dlg_match_t *match, const sofia_dlg_col_t *set, const char *const *vals, int nset);
+uint32_t sofia_presence_store_dialog_select(sofia_presence_store_t *store, const sofia_dlg_match_t *match, switch_core_db_callback_func_t callback, void *pArg);
+uint32_t sofia_presence_store_dialog_delete(sofia_presence_store_t *store, const sofia_dlg_match_t *match);
+switch_bool_t sofia_presence_store_hold_notify(sofia_presence_store_t *store, const sofia_presence_notify_t *notify, switch_interval_time_t interval);
+void sofia_presence_store_notify_sent(sofia_presence_store_t *store, const char *call_id);
+sofia_presence_notify_t *sofia_presence_store_due_notifies(sofia_presence_store_t *store, switch_time_t now);
+void sofia_presence_store_free_notify(sofia_presence_notify_t *notify);
+uint32_t sofia_presence_store_held(void);
+void sofia_presence_store_status(sofia_presence_store_t *store, switch_stream_handle_t *stream);
+void sofia_presence_store_bench(uint32_t count, uint32_t watchers, switch_stream_handle_t *stream);
 
 void write_csta_xml_chunk(switch_event_t *event, switch_stream_handle_t stream, const char *csta_event, char *fwd_type);
 void sofia_glue_clear_soa(switch_core_session_t *session, switch_bool_t partner);
@@ -145,6 +145,14 @@ void sofia_handle_sip_r_notify(switch_core_session_t *session, int status,
 		sql = switch_mprintf("delete from sip_subscriptions where call_id='%q'", sip->sip_call_id->i_id);
 		switch_assert(sql != NULL);
 		sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+
+		if (sofia_presence_store_enabled(profile)) {
+			sofia_sub_match_t match = { 0 };
+
+			match.call_id = sip->sip_call_id->i_id;
+			sofia_presence_store_sub_delete(profile->pres_store, &match);
+		}
+
 		nua_handle_destroy(nh);
 	}
 
@@ -1755,8 +1763,18 @@ static void our_sofia_event_callback(nua_event_t event,
 		break;
 	case nua_r_shutdown:
 		if (status >= 200) {
-			sofia_set_pflag(profile, PFLAG_SHUTDOWN);
-			su_root_break(profile->s_root);
+			if (nua != profile->nua) {
+				int i;
+
+				for (i = 1; i < profile->listener_count; i++) {
+					if (profile->listeners[i].nua == nua) {
+						profile->listeners[i].shutdown = 1;
+					}
+				}
+			} else {
+				sofia_set_pflag(profile, PFLAG_SHUTDOWN);
+				su_root_break(profile->s_root);
+			}
 		}
 		break;
 	case nua_r_message:
@@ -2027,6 +2045,11 @@ static void our_sofia_event_callback(nua_event_t event,
 
 				sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
 
+				if (sofia_presence_store_enabled(profile)) {
+					sofia_presence_store_subscribe(profile, proto, orig_proto, from_user, from_host, to_user, to_host, event_str, contact_str, call_id,
+												   full_from, full_via, full_to, to_tag, full_agent, accept_header, &np, switch_epoch_time_now(NULL) + 60);
+				}
+
 				sip_to_tag(nh->nh_home, sip->sip_to, to_tag);
 			}
 
@@ -2053,7 +2076,17 @@ static void our_sofia_event_callback(nua_event_t event,
 										   sofia_private->call_id, sofia_private->network_ip, sofia_private->network_port);
 				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG1, "SOCKET DISCONNECT: %s %s:%s\n",
 								  sofia_private->call_id, sofia_private->network_ip, sofia_private->network_port);
-				sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+
+				if (sofia_reg_store_enabled(profile)) {
+					sofia_reg_match_t match = { 0 };
+
+					match.call_id = sofia_private->call_id;
+					match.network_ip = sofia_private->network_ip;
+					match.network_port = sofia_private->network_port;
+					sofia_reg_store_delete(profile->reg_store, &match, NULL, NULL);
+				}
+
+				sofia_reg_execute_sql(profile, &sql, SWITCH_FALSE);
 
 				switch_core_del_registration(sofia_private->user, sofia_private->realm, sofia_private->call_id);
 
@@ -2262,92 +2295,203 @@ void sofia_process_dispatch_event(sofia_dispatch_event_t **dep)
 
 
 
-static int msg_queue_threads = 0;
-//static int count = 0;
+/* pushed to a worker to tell it there is something on the steal queue */
+static int sofia_msg_steal_token;
 
-void *SWITCH_THREAD_FUNC sofia_msg_thread_run(switch_thread_t *thread, void *obj)
+static void sofia_msg_queue_dispatch(sofia_msg_queue_t *mq, sofia_dispatch_event_t *de)
 {
-	void *pop;
-	switch_queue_t *q = (switch_queue_t *) obj;
-	int my_id;
+	switch_time_t start = switch_time_now(), took;
 
+	sofia_process_dispatch_event(&de);
 
-	for (my_id = 0; my_id < mod_sofia_globals.msg_queue_len; my_id++) {
-		if (mod_sofia_globals.msg_queue_thread[my_id] == thread) {
-			break;
-		}
-	}
+	took = switch_time_now() - start;
+	mq->processed++;
+	mq->busy += took;
 
-	switch_mutex_lock(mod_sofia_globals.mutex);
-	msg_queue_threads++;
-	switch_mutex_unlock(mod_sofia_globals.mutex);
+	if (took > mq->max_service) {
+		mq->max_service = took;
+	}
+}
 
-	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "MSG Thread %d Started\n", my_id);
+void *SWITCH_THREAD_FUNC sofia_msg_thread_run(switch_thread_t *thread, void *obj)
+{
+	sofia_msg_queue_t *mq = (sofia_msg_queue_t *) obj;
+	void *pop;
+	int running = 1;
 
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "MSG Thread %d Started\n", mq->id);
 
-	for(;;) {
+	while (running) {
 
-		if (switch_queue_pop(q, &pop) != SWITCH_STATUS_SUCCESS) {
-			switch_cond_next();
+		if (switch_mpsc_queue_pop_timeout(mq->queue, &pop, 1000000) != SWITCH_STATUS_SUCCESS) {
 			continue;
 		}
 
-		if (pop) {
-			sofia_dispatch_event_t *de = (sofia_dispatch_event_t *) pop;
-			sofia_process_dispatch_event(&de);
-		} else {
-			break;
+		if (!pop) {
+			running = 0;
+		} else if (pop != &sofia_msg_steal_token) {
+			sofia_msg_queue_dispatch(mq, (sofia_dispatch_event_t *) pop);
+		} else if (switch_mpsc_queue_trypop(mod_sofia_globals.msg_steal_queue, &pop) == SWITCH_STATUS_SUCCESS) {
+			/* every token is good for at least one event so a busy queue can't starve the steal queue */
+			mq->stolen++;
+			sofia_msg_queue_dispatch(mq, (sofia_dispatch_event_t *) pop);
 		}
-	}
 
-	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "MSG Thread Ended\n");
+		/* out of dialog pings can go to whoever is idle first */
+		while ((!running || !switch_mpsc_queue_size(mq->queue)) &&
+			   switch_mpsc_queue_trypop(mod_sofia_globals.msg_steal_queue, &pop) == SWITCH_STATUS_SUCCESS) {
+			mq->stolen++;
+			sofia_msg_queue_dispatch(mq, (sofia_dispatch_event_t *) pop);
+		}
+	}
 
-	switch_mutex_lock(mod_sofia_globals.mutex);
-	msg_queue_threads--;
-	switch_mutex_unlock(mod_sofia_globals.mutex);
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "MSG Thread %d Ended\n", mq->id);
 
 	return NULL;
 }
 
 void sofia_msg_thread_start(int idx)
 {
+	int i;
 
-	if (idx >= mod_sofia_globals.max_msg_queues ||
-		idx >= SOFIA_MAX_MSG_QUEUE || (idx < mod_sofia_globals.msg_queue_len && mod_sofia_globals.msg_queue_thread[idx])) {
+	if (idx >= mod_sofia_globals.max_msg_queues || idx >= SOFIA_MAX_MSG_QUEUE || idx < mod_sofia_globals.msg_queue_len) {
 		return;
 	}
 
 	switch_mutex_lock(mod_sofia_globals.mutex);
 
-	if (idx >= mod_sofia_globals.msg_queue_len) {
-		int i;
-		mod_sofia_globals.msg_queue_len = idx + 1;
+	if (!mod_sofia_globals.msg_steal_queue) {
+		switch_mpsc_queue_create(&mod_sofia_globals.msg_steal_queue, SOFIA_MSG_QUEUE_SIZE, mod_sofia_globals.pool);
+	}
 
-		for (i = 0; i < mod_sofia_globals.msg_queue_len; i++) {
-			if (!mod_sofia_globals.msg_queue_thread[i]) {
-				switch_threadattr_t *thd_attr = NULL;
+	for (i = mod_sofia_globals.msg_queue_len; i <= idx; i++) {
+		sofia_msg_queue_t *mq = &mod_sofia_globals.msg_queues[i];
+		switch_threadattr_t *thd_attr = NULL;
 
-				switch_threadattr_create(&thd_attr, mod_sofia_globals.pool);
-				switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
-				//switch_threadattr_priority_set(thd_attr, SWITCH_PRI_REALTIME);
-				switch_thread_create(&mod_sofia_globals.msg_queue_thread[i],
-									 thd_attr,
-									 sofia_msg_thread_run,
-									 mod_sofia_globals.msg_queue,
-									 mod_sofia_globals.pool);
-			}
-		}
+		mq->id = i;
+		switch_mpsc_queue_create(&mq->queue, SOFIA_MSG_QUEUE_SIZE, mod_sofia_globals.pool);
+
+		switch_threadattr_create(&thd_attr, mod_sofia_globals.pool);
+		switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+		switch_thread_create(&mq->thread, thd_attr, sofia_msg_thread_run, mq, mod_sofia_globals.pool);
 	}
 
+	/* only publish the queues once they all have a worker */
+	mod_sofia_globals.msg_queue_len = idx + 1;
+
 	switch_mutex_unlock(mod_sofia_globals.mutex);
 }
 
-//static int foo = 0;
+void sofia_msg_thread_stop(void)
+{
+	switch_status_t st;
+	int i, len = mod_sofia_globals.msg_queue_len;
+
+	for (i = 0; i < len; i++) {
+		switch_mpsc_queue_push(mod_sofia_globals.msg_queues[i].queue, NULL);
+	}
+
+	for (i = 0; i < len; i++) {
+		switch_thread_join(&st, mod_sofia_globals.msg_queues[i].thread);
+	}
+}
+
+uint32_t sofia_msg_queue_depth(void)
+{
+	uint32_t depth = 0;
+	int i;
+
+	for (i = 0; i < mod_sofia_globals.msg_queue_len; i++) {
+		depth += switch_mpsc_queue_size(mod_sofia_globals.msg_queues[i].queue);
+	}
+
+	if (mod_sofia_globals.msg_steal_queue) {
+		depth += switch_mpsc_queue_size(mod_sofia_globals.msg_steal_queue);
+	}
+
+	return depth;
+}
+
+void sofia_msg_queue_status(switch_stream_handle_t *stream)
+{
+	int i;
+
+	stream->write_function(stream, "%25s\t%8s\t%12s\t%12s\t%10s\t%10s\n", "MSG Queue", "Depth", "Processed", "Stolen", "Avg(us)", "Max(us)");
+
+	for (i = 0; i < mod_sofia_globals.msg_queue_len; i++) {
+		sofia_msg_queue_t *mq = &mod_sofia_globals.msg_queues[i];
+		uint64_t processed = mq->processed;
+
+		stream->write_function(stream, "%25d\t%8u\t%12" SWITCH_UINT64_T_FMT "\t%12" SWITCH_UINT64_T_FMT "\t%10" SWITCH_INT64_T_FMT "\t%10" SWITCH_INT64_T_FMT "\n",
+							   mq->id, switch_mpsc_queue_size(mq->queue), processed, mq->stolen,
+							   processed ? (int64_t) (mq->busy / processed) : (int64_t) 0, (int64_t) mq->max_service);
+	}
+
+	if (mod_sofia_globals.msg_work_stealing && mod_sofia_globals.msg_steal_queue) {
+		stream->write_function(stream, "%25s\t%8u\n", "steal", switch_mpsc_queue_size(mod_sofia_globals.msg_steal_queue));
+	}
+}
+
+static sofia_msg_queue_t *sofia_msg_queue_shortest(void)
+{
+	sofia_msg_queue_t *best = &mod_sofia_globals.msg_queues[0];
+	uint32_t best_size = switch_mpsc_queue_size(best->queue), size;
+	int i;
+
+	for (i = 1; i < mod_sofia_globals.msg_queue_len && best_size; i++) {
+		if ((size = switch_mpsc_queue_size(mod_sofia_globals.msg_queues[i].queue)) < best_size) {
+			best = &mod_sofia_globals.msg_queues[i];
+			best_size = size;
+		}
+	}
+
+	return best;
+}
+
+/* Which worker queue an event goes on, or -1 for the steal queue any idle worker may take it from.
+   Everything that belongs to a dialog or a handle has to land on the same worker every time or it can be
+   handled out of order, so the key is the call-id of the message, else the call-id the handle was bound with,
+   else the handle itself for events nua raises on its own (nua_i_state, nua_i_terminated, local timeouts).
+   Only OPTIONS outside a dialog carry no state worth keeping in order. */
+int sofia_msg_queue_select(nua_event_t event, sip_t const *sip, sofia_private_t *sofia_private, const void *handle, int len, switch_bool_t stealing)
+{
+	const char *call_id = NULL;
+	switch_ssize_t hlen = -1;
+
+	if (len <= 0) {
+		return -1;
+	}
+
+	if (stealing && event == nua_i_options && sip && !(sip->sip_to && sip->sip_to->a_tag)) {
+		return -1;
+	}
+
+	if (sip && sip->sip_call_id) {
+		call_id = sip->sip_call_id->i_id;
+	}
+
+	if (zstr(call_id) && sofia_private && sofia_private != &mod_sofia_globals.destroy_private &&
+		sofia_private != &mod_sofia_globals.keep_private) {
+		call_id = sofia_private->call_id;
+	}
+
+	if (!zstr(call_id)) {
+		return (int) (switch_hashfunc_default(call_id, &hlen) % len);
+	}
+
+	if (handle) {
+		return (int) ((uint32_t) (((uintptr_t) handle >> 4) * 2654435761u) % len);
+	}
+
+	return stealing ? -1 : 0;
+}
+
 void sofia_queue_message(sofia_dispatch_event_t *de)
 {
-	int launch = 0;
+	int len = mod_sofia_globals.msg_queue_len;
+	int index;
 
-	if (mod_sofia_globals.running == 0 || !mod_sofia_globals.msg_queue) {
+	if (mod_sofia_globals.running == 0 || !len) {
 		sofia_process_dispatch_event(&de);
 		return;
 	}
@@ -2359,19 +2503,20 @@ void sofia_queue_message(sofia_dispatch_event_t *de)
 		return;
 	}
 
+	index = sofia_msg_queue_select(de->data->e_event, de->sip, nua_handle_magic(de->nh), de->nh, len,
+								   mod_sofia_globals.msg_work_stealing ? SWITCH_TRUE : SWITCH_FALSE);
 
-	if ((switch_queue_size(mod_sofia_globals.msg_queue) > (SOFIA_MSG_QUEUE_SIZE * (unsigned int)msg_queue_threads))) {
-		launch++;
-	}
-
-
-	if (launch) {
-		if (mod_sofia_globals.msg_queue_len < mod_sofia_globals.max_msg_queues) {
-			sofia_msg_thread_start(mod_sofia_globals.msg_queue_len + 1);
+	if (index < 0) {
+		if (switch_mpsc_queue_trypush(mod_sofia_globals.msg_steal_queue, de) == SWITCH_STATUS_SUCCESS) {
+			switch_mpsc_queue_trypush(sofia_msg_queue_shortest()->queue, &sofia_msg_steal_token);
+			return;
 		}
+
+		/* steal queue is full, any worker will do */
+		index = (int) (((uintptr_t) de->nh >> 4) % len);
 	}
 
-	switch_queue_push(mod_sofia_globals.msg_queue, de);
+	switch_mpsc_queue_push(mod_sofia_globals.msg_queues[index].queue, de);
 }
 
 static void set_call_id(private_object_t *tech_pvt, sip_t const *sip)
@@ -2460,7 +2605,7 @@ void sofia_event_callback(nua_event_t event,
 			}
 
 
-			if (switch_queue_size(mod_sofia_globals.msg_queue) > (unsigned int)critical) {
+			if (sofia_msg_queue_depth() > (unsigned int)critical) {
 				nua_respond(nh, 503, "System Busy", SIPTAG_RETRY_AFTER_STR("300"), NUTAG_WITH_THIS(nua), TAG_END());
 				goto end;
 			}
@@ -2718,7 +2863,8 @@ void event_handler(switch_event_t *event)
 			sql = switch_mprintf("delete from sip_registrations where sip_user='%q' and sip_host='%q'", from_user, from_host);
 		}
 
-		sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+		sofia_reg_store_drop(profile, sofia_test_pflag(profile, PFLAG_MULTIREG), 0, from_user, from_host, NULL, call_id);
+		sofia_reg_execute_sql(profile, &sql, SWITCH_FALSE);
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Expired propagated registration for %s@%s->%s\n", from_user, from_host, contact_str);
 
 		if (profile) {
@@ -2820,7 +2966,8 @@ void event_handler(switch_event_t *event)
 		}
 
 
-		sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+		sofia_reg_store_drop(profile, sofia_test_pflag(profile, PFLAG_MULTIREG), 0, from_user, from_host, NULL, call_id);
+		sofia_reg_execute_sql(profile, &sql, SWITCH_FALSE);
 
 		switch_find_local_ip(guess_ip4, sizeof(guess_ip4), NULL, AF_INET);
 		sql = switch_mprintf("insert into sip_registrations "
@@ -2832,8 +2979,43 @@ void event_handler(switch_event_t *event)
 							 profile_name, mod_sofia_globals.hostname, network_ip, network_port, username, realm, mwi_user, mwi_host,
 							 orig_server_host, orig_hostname, "Reachable", 0);
 
+		if (sofia_reg_store_enabled(profile)) {
+			const char *cols[SOFIA_REG_COL_MAX] = { 0 };
+			char expires_c[32];
+
+			switch_snprintf(expires_c, sizeof(expires_c), "%ld", expires);
+
+			cols[SOFIA_REG_COL_CALL_ID] = call_id;
+			cols[SOFIA_REG_COL_SIP_USER] = from_user;
+			cols[SOFIA_REG_COL_SIP_HOST] = from_host;
+			cols[SOFIA_REG_COL_PRESENCE_HOSTS] = presence_hosts;
+			cols[SOFIA_REG_COL_CONTACT] = contact_str;
+			cols[SOFIA_REG_COL_STATUS] = "Registered";
+			cols[SOFIA_REG_COL_RPID] = rpid;
+			cols[SOFIA_REG_COL_EXPIRES] = expires_c;
+			cols[SOFIA_REG_COL_USER_AGENT] = user_agent;
+			cols[SOFIA_REG_COL_SERVER_USER] = to_user;
+			cols[SOFIA_REG_COL_SERVER_HOST] = guess_ip4;
+			cols[SOFIA_REG_COL_PROFILE_NAME] = profile_name;
+			cols[SOFIA_REG_COL_HOSTNAME] = mod_sofia_globals.hostname;
+			cols[SOFIA_REG_COL_NETWORK_IP] = network_ip;
+			cols[SOFIA_REG_COL_NETWORK_PORT] = network_port;
+			cols[SOFIA_REG_COL_SIP_USERNAME] = username;
+			cols[SOFIA_REG_COL_SIP_REALM] = realm;
+			cols[SOFIA_REG_COL_MWI_USER] = mwi_user;
+			cols[SOFIA_REG_COL_MWI_HOST] = mwi_host;
+			cols[SOFIA_REG_COL_ORIG_SERVER_HOST] = orig_server_host;
+			cols[SOFIA_REG_COL_ORIG_HOSTNAME] = orig_hostname;
+			cols[SOFIA_REG_COL_PING_STATUS] = "Reachable";
+			cols[SOFIA_REG_COL_PING_COUNT] = "0";
+			cols[SOFIA_REG_COL_PING_TIME] = "0";
+			cols[SOFIA_REG_COL_FORCE_PING] = "0";
+
+			sofia_reg_store_insert(profile->reg_store, cols);
+		}
+
 		if (sql) {
-			sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+			sofia_reg_execute_sql(profile, &sql, SWITCH_FALSE);
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Propagating registration for %s@%s->%s\n", from_user, from_host, contact_str);
 		}
 
@@ -2862,8 +3044,18 @@ void event_handler(switch_event_t *event)
 				sql = switch_mprintf("update sip_registrations set ping_status='%q' where sip_user='%q' and sip_host='%q' and call_id='%q'",
 								 	"Unreachable", from_user, from_host, call_id);
 			}
+			if (sofia_reg_store_enabled(profile)) {
+				sofia_reg_col_t set = SOFIA_REG_COL_PING_STATUS;
+				const char *val = !strcmp(ping_status, "REACHABLE") ? "Reachable" : "Unreachable";
+				sofia_reg_match_t match = { 0 };
+
+				match.user = from_user;
+				match.host = from_host;
+				match.call_id = call_id;
+				sofia_reg_store_update(profile->reg_store, &match, &set, &val, 1);
+			}
 			if (sql) {
-				sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+				sofia_reg_execute_sql(profile, &sql, SWITCH_FALSE);
 				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Propagating sip_user_state for %s@%s. Ping-Status: %s\n", from_user, from_host, ping_status);
 			}
 
@@ -3102,6 +3294,318 @@ switch_thread_t *launch_sofia_worker_thread(sofia_profile_t *profile)
 	return thread;
 }
 
+static void sofia_profile_set_nua_params(sofia_profile_t *profile, nua_t *nua, const char *supported)
+{
+	nua_set_params(nua,
+				   SIPTAG_ALLOW_STR("INVITE, ACK, BYE, CANCEL, OPTIONS, MESSAGE, INFO"),
+				   SIPTAG_USER_AGENT(SIP_NONE),
+				   NUTAG_AUTOANSWER(0),
+				   NUTAG_AUTOACK(0),
+				   NUTAG_AUTOALERT(0),
+				   NUTAG_ENABLEMESSENGER(1),
+				   NTATAG_EXTRA_100(0),
+				   TAG_IF(sofia_test_pflag(profile, PFLAG_ALLOW_UPDATE), NUTAG_ALLOW("UPDATE")),
+				   TAG_IF((profile->mflags & MFLAG_REGISTER), NUTAG_ALLOW("REGISTER")),
+				   TAG_IF((profile->mflags & MFLAG_REFER), NUTAG_ALLOW("REFER")),
+				   TAG_IF(!sofia_test_pflag(profile, PFLAG_DISABLE_100REL), NUTAG_ALLOW("PRACK")),
+				   NUTAG_ALLOW("INFO"),
+				   NUTAG_ALLOW("NOTIFY"),
+				   NUTAG_ALLOW_EVENTS("talk"),
+				   NUTAG_ALLOW_EVENTS("hold"),
+				   NUTAG_ALLOW_EVENTS("conference"),
+				   NUTAG_APPL_METHOD("OPTIONS"),
+				   NUTAG_APPL_METHOD("INVITE"),
+				   NUTAG_APPL_METHOD("REFER"),
+				   NUTAG_APPL_METHOD("REGISTER"),
+				   NUTAG_APPL_METHOD("NOTIFY"), NUTAG_APPL_METHOD("INFO"), NUTAG_APPL_METHOD("ACK"), NUTAG_APPL_METHOD("SUBSCRIBE"),
+#ifdef MANUAL_BYE
+				   NUTAG_APPL_METHOD("BYE"),
+#endif
+				   NUTAG_APPL_METHOD("MESSAGE"),
+
+				   TAG_IF(profile->session_timeout && profile->minimum_session_expires, NUTAG_MIN_SE(profile->minimum_session_expires)),
+				   NUTAG_SESSION_TIMER(profile->session_timeout),
+				   NTATAG_MAX_PROCEEDING(profile->max_proceeding),
+				   TAG_IF(profile->pres_type, NUTAG_ALLOW("PUBLISH")),
+				   TAG_IF(profile->pres_type, NUTAG_ALLOW("SUBSCRIBE")),
+				   TAG_IF(profile->pres_type, NUTAG_ENABLEMESSAGE(1)),
+				   TAG_IF(profile->pres_type, NUTAG_ALLOW_EVENTS("presence")),
+				   TAG_IF(profile->pres_type, NUTAG_ALLOW_EVENTS("as-feature-event")),
+				   TAG_IF((profile->pres_type || sofia_test_pflag(profile, PFLAG_MANAGE_SHARED_APPEARANCE)), NUTAG_ALLOW_EVENTS("dialog")),
+				   TAG_IF((profile->pres_type || sofia_test_pflag(profile, PFLAG_MANAGE_SHARED_APPEARANCE)), NUTAG_ALLOW_EVENTS("line-seize")),
+				   TAG_IF(profile->pres_type, NUTAG_ALLOW_EVENTS("call-info")),
+				   TAG_IF((profile->pres_type || sofia_test_pflag(profile, PFLAG_MANAGE_SHARED_APPEARANCE)), NUTAG_ALLOW_EVENTS("sla")),
+				   TAG_IF(profile->pres_type, NUTAG_ALLOW_EVENTS("include-session-description")),
+				   TAG_IF(profile->pres_type, NUTAG_ALLOW_EVENTS("presence.winfo")),
+				   TAG_IF(profile->pres_type, NUTAG_ALLOW_EVENTS("message-summary")),
+				   TAG_IF(profile->pres_type == PRES_TYPE_PNP, NUTAG_ALLOW_EVENTS("ua-profile")),
+				   NUTAG_ALLOW_EVENTS("refer"), SIPTAG_SUPPORTED_STR(supported),
+				   TAG_IF(strcasecmp(profile->user_agent, "_undef_"), SIPTAG_USER_AGENT_STR(profile->user_agent)),
+				   TAG_END());
+}
+
+/* a datagram handed from one listener stack to the next */
+typedef struct sofia_stray_s {
+	sofia_profile_t *profile;
+	msg_t *msg;
+	int target;
+	int origin;
+	int hops;
+} sofia_stray_t;
+
+static void sofia_listener_stray_deinit(su_msg_arg_t *arg)
+{
+	sofia_stray_t *stray = (sofia_stray_t *) arg;
+
+	if (stray->msg) {
+		msg_destroy(stray->msg);
+		stray->msg = NULL;
+	}
+}
+
+/* runs in the thread of the target stack */
+static void sofia_listener_stray_recv(su_root_magic_t *magic, su_msg_r m, su_msg_arg_t *arg)
+{
+	sofia_stray_t *stray = (sofia_stray_t *) arg;
+	sofia_listener_t *listener = &stray->profile->listeners[stray->target];
+	msg_t *msg = stray->msg;
+
+	stray->msg = NULL;
+
+	if (!stray->profile->listeners_running) {
+		msg_destroy(msg);
+		return;
+	}
+
+	listener->taken++;
+	listener->redelivering = msg;
+	listener->origin = stray->origin;
+	listener->hops = stray->hops;
+
+	nta_agent_recv_stray(listener->nua->nua_nta, msg);
+
+	listener->redelivering = NULL;
+}
+
+/* called by an agent with a response or in-dialog request it has no transaction or dialog for,
+   the message goes round the other stacks in turn and the last one handles it as usual */
+static int sofia_listener_stray(nta_stray_magic_t *magic, nta_agent_t *agent, msg_t *msg, sip_t *sip)
+{
+	sofia_profile_t *profile = (sofia_profile_t *) magic;
+	sofia_listener_t *listener = NULL;
+	sofia_stray_t *stray;
+	su_msg_r m = SU_MSG_R_INIT;
+	int i, origin, hops, target;
+
+	if (!profile->listeners_running) {
+		return -1;
+	}
+
+	for (i = 0; i < profile->listener_count; i++) {
+		if (profile->listeners[i].nua->nua_nta == agent) {
+			listener = &profile->listeners[i];
+			break;
+		}
+	}
+
+	if (!listener) {
+		return -1;
+	}
+
+	if (listener->redelivering == msg) {
+		origin = listener->origin;
+		hops = listener->hops + 1;
+	} else {
+		origin = i;
+		hops = 1;
+	}
+
+	if (hops >= profile->listener_count) {
+		return -1;
+	}
+
+	/* skip the stack the message arrived on */
+	target = hops - 1 < origin ? hops - 1 : hops;
+
+	if (su_msg_create(m, su_clone_task(profile->listeners[target].nua->nua_clone), su_task_null,
+					  sofia_listener_stray_recv, sizeof(*stray)) != 0) {
+		return -1;
+	}
+
+	stray = (sofia_stray_t *) su_msg_data(m);
+	stray->profile = profile;
+	stray->msg = msg;
+	stray->target = target;
+	stray->origin = origin;
+	stray->hops = hops;
+	su_msg_deinitializer(m, sofia_listener_stray_deinit);
+
+	if (su_msg_send(m) != 0) {
+		/* the deinitializer has destroyed the message already */
+		return 0;
+	}
+
+	listener->handed++;
+
+	return 0;
+}
+
+static char *sofia_listener_bindurl(sofia_profile_t *profile)
+{
+	char *url = NULL;
+
+	if (sofia_test_pflag(profile, PFLAG_TLS) && profile->tls_only) {
+		return NULL;
+	}
+
+	/* the extra stacks only take udp, a tcp connection has to stay with the stack that owns it */
+	if (switch_stristr("transport=udp,tcp", profile->bindurl)) {
+		char *tmp = switch_string_replace(profile->bindurl, "transport=udp,tcp", "transport=udp");
+		url = switch_core_strdup(profile->pool, tmp);
+		switch_safe_free(tmp);
+	} else if (switch_stristr("transport=udp", profile->bindurl)) {
+		url = profile->bindurl;
+	}
+
+	return url;
+}
+
+static void sofia_listeners_start(sofia_profile_t *profile, const char *supported)
+{
+	char *url;
+	int i;
+
+	memset(profile->listeners, 0, sizeof(profile->listeners));
+	profile->listeners[0].nua = profile->nua;
+	profile->listener_count = 1;
+	profile->listeners_running = 0;
+
+	if (profile->listen_instances < 2) {
+		return;
+	}
+
+	if (!(url = sofia_listener_bindurl(profile))) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Profile %s does not listen on udp, ignoring listen-instances\n", profile->name);
+		return;
+	}
+
+	for (i = 1; i < profile->listen_instances; i++) {
+		nua_t *nua = nua_create(profile->s_root,	/* Event loop */
+								sofia_event_callback,	/* Callback for processing events */
+								profile,	/* Additional data to pass to callback */
+								NUTAG_URL(url),
+								TPTAG_REUSEPORT(1),
+								NTATAG_USER_VIA(1),
+								NUTAG_RETRY_AFTER_ENABLE(0),
+								NUTAG_AUTO_INVITE_100(0),
+								TAG_IF(!strchr(profile->sipip, ':'),
+									   SOATAG_AF(SOA_AF_IP4_ONLY)),
+								TAG_IF(strchr(profile->sipip, ':'),
+									   SOATAG_AF(SOA_AF_IP6_ONLY)),
+								TAG_IF(!strchr(profile->sipip, ':'),
+									   NTATAG_UDP_MTU(65535)),
+								TAG_IF(sofia_test_pflag(profile, PFLAG_DISABLE_SRV),
+									   NTATAG_USE_SRV(0)),
+								TAG_IF(sofia_test_pflag(profile, PFLAG_DISABLE_NAPTR),
+									   NTATAG_USE_NAPTR(0)),
+								TAG_IF(sofia_test_pflag(profile, PFLAG_DISABLE_SRV503),
+									   NTATAG_SRV_503(0)),
+								NTATAG_DEFAULT_PROXY(profile->outbound_proxy),
+								NTATAG_SERVER_RPORT(profile->server_rport_level),
+								NTATAG_CLIENT_RPORT(profile->client_rport_level),
+								TPTAG_LOG(sofia_test_flag(profile, TFLAG_TPORT_LOG)),
+								TPTAG_CAPT(sofia_test_flag(profile, TFLAG_CAPTURE) ? mod_sofia_globals.capture_server : NULL),
+								TAG_IF(sofia_test_pflag(profile, PFLAG_SIPCOMPACT),
+									   NTATAG_SIPFLAGS(MSG_DO_COMPACT)),
+								TAG_IF(profile->timer_t1, NTATAG_SIP_T1(profile->timer_t1)),
+								TAG_IF(profile->timer_t1x64, NTATAG_SIP_T1X64(profile->timer_t1x64)),
+								TAG_IF(profile->timer_t2, NTATAG_SIP_T2(profile->timer_t2)),
+								TAG_IF(profile->timer_t4, NTATAG_SIP_T4(profile->timer_t4)),
+								SIPTAG_ACCEPT_STR("application/sdp, multipart/mixed"),
+								TAG_END());	/* Last tag should always finish the sequence */
+
+		if (!nua) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error Creating SIP listener %d for profile: %s (%s)\n", i, profile->name, url);
+			break;
+		}
+
+		sofia_profile_set_nua_params(profile, nua, supported);
+		switch_mutex_lock(profile->flag_mutex);
+		profile->listeners[i].nua = nua;
+		profile->listener_count++;
+		switch_mutex_unlock(profile->flag_mutex);
+	}
+
+	if (profile->listener_count > 1) {
+		for (i = 0; i < profile->listener_count; i++) {
+			nta_agent_bind_stray(profile->listeners[i].nua->nua_nta, profile, sofia_listener_stray);
+		}
+		profile->listeners_running = 1;
+	}
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "Profile %s listening on %s with %d sip stacks\n",
+					  profile->name, url, profile->listener_count);
+}
+
+static void sofia_listeners_shutdown(sofia_profile_t *profile)
+{
+	int i;
+
+	profile->listeners_running = 0;
+
+	for (i = 1; i < profile->listener_count; i++) {
+		nua_shutdown(profile->listeners[i].nua);
+	}
+}
+
+static int sofia_listeners_down(sofia_profile_t *profile)
+{
+	int i;
+
+	for (i = 1; i < profile->listener_count; i++) {
+		if (!profile->listeners[i].shutdown) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static void sofia_listeners_destroy(sofia_profile_t *profile)
+{
+	nua_t *nuas[SOFIA_MAX_LISTENERS];
+	int i, count;
+
+	/* hide the stacks from the lookups in sofia_glue first, they walk the listeners under flag_mutex */
+	switch_mutex_lock(profile->flag_mutex);
+	count = profile->listener_count;
+	profile->listener_count = 1;
+
+	for (i = 1; i < count; i++) {
+		nuas[i] = profile->listeners[i].nua;
+		profile->listeners[i].nua = NULL;
+	}
+	switch_mutex_unlock(profile->flag_mutex);
+
+	for (i = 1; i < count; i++) {
+		nua_destroy(nuas[i]);
+	}
+}
+
+void sofia_listener_status(sofia_profile_t *profile, switch_stream_handle_t *stream)
+{
+	int i;
+
+	switch_mutex_lock(profile->flag_mutex);
+	stream->write_function(stream, "LISTENERS        \t%d\n", profile->listener_count);
+
+	for (i = 0; profile->listener_count > 1 && i < profile->listener_count; i++) {
+		stream->write_function(stream, "LISTENER %-2d      \thanded %" SWITCH_UINT64_T_FMT " taken %" SWITCH_UINT64_T_FMT "\n",
+							   i, profile->listeners[i].handed, profile->listeners[i].taken);
+	}
+	switch_mutex_unlock(profile->flag_mutex);
+}
+
 void *SWITCH_THREAD_FUNC sofia_profile_thread_run(switch_thread_t *thread, void *obj)
 {
 	sofia_profile_t *profile = (sofia_profile_t *) obj;
@@ -3133,6 +3637,14 @@ void *SWITCH_THREAD_FUNC sofia_profile_thread_run(switch_thread_t *thread, void
 		goto end;
 	}
 
+	if (sofia_reg_store_enabled(profile)) {
+		sofia_reg_store_load(profile);
+	}
+
+	if (sofia_presence_store_enabled(profile)) {
+		sofia_presence_store_load(profile);
+	}
+
 	supported = switch_core_sprintf(profile->pool, "%s%s%spath, replaces", use_100rel ? "precondition, 100rel, " : "", use_timer ? "timer, " : "", use_rfc_5626 ? "outbound, " : "");
 
 	if (sofia_test_pflag(profile, PFLAG_AUTO_NAT) && switch_nat_get_type()) {
@@ -3222,6 +3734,8 @@ void *SWITCH_THREAD_FUNC sofia_profile_thread_run(switch_thread_t *thread, void
 								  SIPTAG_ACCEPT_STR("application/sdp, multipart/mixed"),
 								  TAG_IF(sofia_test_pflag(profile, PFLAG_NO_CONNECTION_REUSE),
 										 TPTAG_REUSE(0)),
+								  TAG_IF(profile->listen_instances > 1,
+										 TPTAG_REUSEPORT(1)),
 								  TAG_END());	/* Last tag should always finish the sequence */
 
 		if (!profile->nua) {
@@ -3245,52 +3759,7 @@ void *SWITCH_THREAD_FUNC sofia_profile_thread_run(switch_thread_t *thread, void
 
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Created agent for %s\n", profile->name);
 
-	nua_set_params(profile->nua,
-				   SIPTAG_ALLOW_STR("INVITE, ACK, BYE, CANCEL, OPTIONS, MESSAGE, INFO"),
-				   SIPTAG_USER_AGENT(SIP_NONE),
-				   NUTAG_AUTOANSWER(0),
-				   NUTAG_AUTOACK(0),
-				   NUTAG_AUTOALERT(0),
-				   NUTAG_ENABLEMESSENGER(1),
-				   NTATAG_EXTRA_100(0),
-				   TAG_IF(sofia_test_pflag(profile, PFLAG_ALLOW_UPDATE), NUTAG_ALLOW("UPDATE")),
-				   TAG_IF((profile->mflags & MFLAG_REGISTER), NUTAG_ALLOW("REGISTER")),
-				   TAG_IF((profile->mflags & MFLAG_REFER), NUTAG_ALLOW("REFER")),
-				   TAG_IF(!sofia_test_pflag(profile, PFLAG_DISABLE_100REL), NUTAG_ALLOW("PRACK")),
-				   NUTAG_ALLOW("INFO"),
-				   NUTAG_ALLOW("NOTIFY"),
-				   NUTAG_ALLOW_EVENTS("talk"),
-				   NUTAG_ALLOW_EVENTS("hold"),
-				   NUTAG_ALLOW_EVENTS("conference"),
-				   NUTAG_APPL_METHOD("OPTIONS"),
-				   NUTAG_APPL_METHOD("INVITE"),
-				   NUTAG_APPL_METHOD("REFER"),
-				   NUTAG_APPL_METHOD("REGISTER"),
-				   NUTAG_APPL_METHOD("NOTIFY"), NUTAG_APPL_METHOD("INFO"), NUTAG_APPL_METHOD("ACK"), NUTAG_APPL_METHOD("SUBSCRIBE"),
-#ifdef MANUAL_BYE
-				   NUTAG_APPL_METHOD("BYE"),
-#endif
-				   NUTAG_APPL_METHOD("MESSAGE"),
-
-				   TAG_IF(profile->session_timeout && profile->minimum_session_expires, NUTAG_MIN_SE(profile->minimum_session_expires)),
-				   NUTAG_SESSION_TIMER(profile->session_timeout),
-				   NTATAG_MAX_PROCEEDING(profile->max_proceeding),
-				   TAG_IF(profile->pres_type, NUTAG_ALLOW("PUBLISH")),
-				   TAG_IF(profile->pres_type, NUTAG_ALLOW("SUBSCRIBE")),
-				   TAG_IF(profile->pres_type, NUTAG_ENABLEMESSAGE(1)),
-				   TAG_IF(profile->pres_type, NUTAG_ALLOW_EVENTS("presence")),
-				   TAG_IF(profile->pres_type, NUTAG_ALLOW_EVENTS("as-feature-event")),
-				   TAG_IF((profile->pres_type || sofia_test_pflag(profile, PFLAG_MANAGE_SHARED_APPEARANCE)), NUTAG_ALLOW_EVENTS("dialog")),
-				   TAG_IF((profile->pres_type || sofia_test_pflag(profile, PFLAG_MANAGE_SHARED_APPEARANCE)), NUTAG_ALLOW_EVENTS("line-seize")),
-				   TAG_IF(profile->pres_type, NUTAG_ALLOW_EVENTS("call-info")),
-				   TAG_IF((profile->pres_type || sofia_test_pflag(profile, PFLAG_MANAGE_SHARED_APPEARANCE)), NUTAG_ALLOW_EVENTS("sla")),
-				   TAG_IF(profile->pres_type, NUTAG_ALLOW_EVENTS("include-session-description")),
-				   TAG_IF(profile->pres_type, NUTAG_ALLOW_EVENTS("presence.winfo")),
-				   TAG_IF(profile->pres_type, NUTAG_ALLOW_EVENTS("message-summary")),
-				   TAG_IF(profile->pres_type == PRES_TYPE_PNP, NUTAG_ALLOW_EVENTS("ua-profile")),
-				   NUTAG_ALLOW_EVENTS("refer"), SIPTAG_SUPPORTED_STR(supported),
-				   TAG_IF(strcasecmp(profile->user_agent, "_undef_"), SIPTAG_USER_AGENT_STR(profile->user_agent)),
-				   TAG_END());
+	sofia_profile_set_nua_params(profile, profile->nua, supported);
 
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Set params for %s\n", profile->name);
 
@@ -3315,6 +3784,8 @@ void *SWITCH_THREAD_FUNC sofia_profile_thread_run(switch_thread_t *thread, void
 		config_sofia_profile_urls(profile);
 	}
 
+	sofia_listeners_start(profile, supported);
+
 	for (node = profile->aliases; node; node = node->next) {
 		node->nua = nua_create(profile->s_root,	/* Event loop */
 							   sofia_event_callback,	/* Callback for processing events */
@@ -3409,10 +3880,11 @@ void *SWITCH_THREAD_FUNC sofia_profile_thread_run(switch_thread_t *thread, void
 
 
 	sofia_reg_unregister(profile);
+	sofia_listeners_shutdown(profile);
 	nua_shutdown(profile->nua);
 
 	sanity = 100;
-	while (!sofia_test_pflag(profile, PFLAG_SHUTDOWN) || profile->queued_events > 0) {
+	while (!sofia_test_pflag(profile, PFLAG_SHUTDOWN) || !sofia_listeners_down(profile) || profile->queued_events > 0) {
 		su_root_step(profile->s_root, 1000);
 		if (!--sanity) {
 			break;
@@ -3438,6 +3910,7 @@ void *SWITCH_THREAD_FUNC sofia_profile_thread_run(switch_thread_t *thread, void
 			break;
 		}
 	}
+	sofia_listeners_destroy(profile);
 	nua_destroy(profile->nua);
 
 	switch_mutex_lock(profile->ireg_mutex);
@@ -3487,6 +3960,9 @@ void *SWITCH_THREAD_FUNC sofia_profile_thread_run(switch_thread_t *thread, void
 	switch_core_hash_destroy(&profile->chat_hash);
 	switch_core_hash_destroy(&profile->reg_nh_hash);
 	switch_core_hash_destroy(&profile->mwi_debounce_hash);
+	sofia_reg_store_destroy(&profile->reg_store);
+	sofia_nonce_store_destroy(&profile->nonce_store);
+	sofia_presence_store_destroy(&profile->pres_store);
 
 	switch_thread_rwlock_unlock(profile->rwlock);
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Write unlock %s\n", profile->name);
@@ -4464,6 +4940,19 @@ switch_status_t config_sofia(sofia_config_t reload, char *profile_name)
 					mod_sofia_globals.max_reg_threads = x;
 				}
 
+			} else if (!strcasecmp(var, "message-threads") && val) {
+				int x = atoi(val);
+
+				/* the Call-ID sharding is fixed once the workers are running */
+				if (mod_sofia_globals.msg_queue_len) {
+					if (x != mod_sofia_globals.max_msg_queues) {
+						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "message-threads only changes on module load\n");
+					}
+				} else if (x > 0) {
+					mod_sofia_globals.max_msg_queues = x > SOFIA_MAX_MSG_QUEUE ? SOFIA_MAX_MSG_QUEUE : x;
+				}
+			} else if (!strcasecmp(var, "message-work-stealing")) {
+				mod_sofia_globals.msg_work_stealing = switch_true(val);
 			} else if (!strcasecmp(var, "auto-restart")) {
 				mod_sofia_globals.auto_restart = switch_true(val);
 			} else if (!strcasecmp(var, "reg-deny-binding-fetch-and-no-lookup")) {          /* backwards compatibility */
@@ -4556,10 +5045,14 @@ switch_status_t config_sofia(sofia_config_t reload, char *profile_name)
 					switch_core_hash_init(&profile->chat_hash);
 					switch_core_hash_init(&profile->reg_nh_hash);
 					switch_core_hash_init(&profile->mwi_debounce_hash);
+					sofia_reg_store_create(&profile->reg_store, IPING_SECONDS, profile->pool);
+					sofia_nonce_store_create(&profile->nonce_store, profile->pool);
+					sofia_presence_store_create(&profile->pres_store, profile->pool);
 					switch_thread_rwlock_create(&profile->rwlock, profile->pool);
 					switch_mutex_init(&profile->flag_mutex, SWITCH_MUTEX_NESTED, profile->pool);
 					profile->dtmf_duration = 100;
 					profile->rtp_digit_delay = 40;
+					profile->presence_notify_interval = 200;
 					profile->sip_force_expires = 0;
 					profile->sip_force_expires_min = 0;
 					profile->sip_force_expires_max = 0;
@@ -4586,6 +5079,7 @@ switch_status_t config_sofia(sofia_config_t reload, char *profile_name)
 					sofia_set_pflag(profile, PFLAG_SEND_DISPLAY_UPDATE);
 					sofia_set_pflag(profile, PFLAG_MESSAGE_QUERY_ON_FIRST_REGISTER);
 					//sofia_set_pflag(profile, PFLAG_PRESENCE_ON_FIRST_REGISTER);
+					sofia_set_pflag(profile, PFLAG_REG_DB_MIRROR);
 
 					sofia_clear_pflag(profile, PFLAG_CHANNEL_XML_FETCH_ON_NIGHTMARE_TRANSFER);
 					sofia_clear_pflag(profile, PFLAG_MAKE_EVERY_TRANSFER_A_NIGHTMARE);
@@ -4603,6 +5097,7 @@ switch_status_t config_sofia(sofia_config_t reload, char *profile_name)
 					profile->paid_type = PAID_DEFAULT;
 					profile->bind_attempts = 2;
 					profile->bind_attempt_interval = 5;
+					profile->listen_instances = 1;
 					profile->dtmf_type = DTMF_2833;
 					profile->tls_verify_policy = TPTLS_VERIFY_NONE;
 					/* lib default */
@@ -4658,6 +5153,17 @@ switch_status_t config_sofia(sofia_config_t reload, char *profile_name)
 						if (bai >= 0) {
 							profile->bind_attempt_interval = bai;
 						}
+					} else if (!strcasecmp(var, "listen-instances") && val) {
+						int li = atoi(val);
+
+						if (li < 1) {
+							li = 1;
+						} else if (li > SOFIA_MAX_LISTENERS) {
+							switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "listen-instances capped at %d\n", SOFIA_MAX_LISTENERS);
+							li = SOFIA_MAX_LISTENERS;
+						}
+
+						profile->listen_instances = li;
 					} else if (!strcasecmp(var, "shutdown-on-fail")) {
 						profile->shutdown_type = switch_core_strdup(profile->pool, val);
 					} else if (!strcasecmp(var, "sip-trace")) {
@@ -4669,7 +5175,7 @@ switch_status_t config_sofia(sofia_config_t reload, char *profile_name)
 					} else if (!strcasecmp(var, "sip-capture")) {
 						if (switch_true(val)) {
 							sofia_set_flag(profile, TFLAG_CAPTURE);
-							nua_set_params(profile->nua, TPTAG_CAPT(mod_sofia_globals.capture_server), TAG_END());
+							sofia_glue_profile_capture(profile, SWITCH_TRUE);
 						} else {
 							sofia_clear_flag(profile, TFLAG_CAPTURE);
 						}
@@ -5482,8 +5988,43 @@ switch_status_t config_sofia(sofia_config_t reload, char *profile_name)
 						} else {
 							sofia_clear_pflag(profile, PFLAG_EXTENDED_INFO_PARSING);
 						}
+					} else if (!strcasecmp(var, "registration-store") && !zstr(val)) {
+						if (!strcasecmp(val, "sql")) {
+							sofia_set_pflag(profile, PFLAG_SQL_REGISTRATIONS);
+						} else {
+							sofia_clear_pflag(profile, PFLAG_SQL_REGISTRATIONS);
+						}
+					} else if (!strcasecmp(var, "registration-db-mirror")) {
+						if (switch_true(val)) {
+							sofia_set_pflag(profile, PFLAG_REG_DB_MIRROR);
+						} else {
+							sofia_clear_pflag(profile, PFLAG_REG_DB_MIRROR);
+						}
 					} else if (!strcasecmp(var, "nonce-ttl") && !zstr(val)) {
 						profile->nonce_ttl = atoi(val);
+					} else if (!strcasecmp(var, "nonce-store") && !zstr(val)) {
+						sofia_clear_pflag(profile, PFLAG_SQL_NONCES);
+						sofia_clear_pflag(profile, PFLAG_STATELESS_NONCES);
+
+						if (!strcasecmp(val, "sql")) {
+							sofia_set_pflag(profile, PFLAG_SQL_NONCES);
+						} else if (!strcasecmp(val, "stateless")) {
+							sofia_set_pflag(profile, PFLAG_STATELESS_NONCES);
+						} else if (strcasecmp(val, "memory")) {
+							switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Invalid nonce-store '%s', using memory\n", val);
+						}
+					} else if (!strcasecmp(var, "presence-store") && !zstr(val)) {
+						if (!strcasecmp(val, "sql")) {
+							sofia_set_pflag(profile, PFLAG_SQL_PRESENCE);
+						} else {
+							sofia_clear_pflag(profile, PFLAG_SQL_PRESENCE);
+						}
+					} else if (!strcasecmp(var, "presence-notify-interval") && !zstr(val)) {
+						int interval = atoi(val);
+
+						profile->presence_notify_interval = interval > 0 ? interval : 0;
+					} else if (!strcasecmp(var, "nonce-secret") && !zstr(val) && profile->nonce_store) {
+						sofia_nonce_store_set_secret(profile->nonce_store, val);
 					} else if (!strcasecmp(var, "max-auth-validity") && !zstr(val)) {
 						profile->max_auth_validity = atoi(val);
 					} else if (!strcasecmp(var, "accept-blind-reg")) {
@@ -6242,6 +6783,47 @@ int sofia_sip_user_status_callback(void *pArg, int argc, char **argv, char **col
 	return 1;
 }
 
+static int sofia_sip_user_status_store_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	char *row[3];
+
+	row[0] = argv[SOFIA_REG_COL_PING_STATUS];
+	row[1] = argv[SOFIA_REG_COL_PING_COUNT];
+	row[2] = argv[SOFIA_REG_COL_CONTACT];
+
+	return sofia_sip_user_status_callback(pArg, 3, row, NULL);
+}
+
+/* sets one column of the registration an OPTIONS ping went to, and ping_time unless it is negative */
+static void sofia_sip_user_status_update(sofia_profile_t *profile, sip_t const *sip, const char *call_id,
+										 sofia_reg_col_t col, const char *val, int ping_time)
+{
+	sofia_reg_col_t set[2];
+	const char *vals[2];
+	char ping_time_c[32];
+	sofia_reg_match_t match = { 0 };
+	int n = 0;
+
+	if (!sofia_reg_store_enabled(profile)) {
+		return;
+	}
+
+	set[n] = col;
+	vals[n++] = val;
+
+	if (ping_time >= 0) {
+		switch_snprintf(ping_time_c, sizeof(ping_time_c), "%d", ping_time);
+		set[n] = SOFIA_REG_COL_PING_TIME;
+		vals[n++] = ping_time_c;
+	}
+
+	match.user = sip->sip_to->a_url->url_user;
+	match.host = sip->sip_to->a_url->url_host;
+	match.call_id = call_id;
+
+	sofia_reg_store_update(profile->reg_store, &match, set, vals, n);
+}
+
 static void sofia_handle_sip_r_options(switch_core_session_t *session, int status,
 									   char const *phrase,
 									   nua_t *nua, sofia_profile_t *profile, nua_handle_t *nh, sofia_private_t *sofia_private, sip_t const *sip,
@@ -6322,6 +6904,7 @@ static void sofia_handle_sip_r_options(switch_core_session_t *session, int statu
 
 		char *sip_user = switch_mprintf("%s@%s", sip->sip_to->a_url->url_user, sip->sip_to->a_url->url_host);
 		int ping_time = 0;
+		char count_c[16];
 
 		if (sofia_private && sofia_private->ping_sent) {
 			ping_time = (int)(switch_time_now() - sofia_private->ping_sent);
@@ -6331,40 +6914,56 @@ static void sofia_handle_sip_r_options(switch_core_session_t *session, int statu
 		sip_user_status.status_len = sizeof(ping_status);
 		sip_user_status.contact = sip_contact;
 		sip_user_status.contact_len = sizeof(sip_contact);
-		sql = switch_mprintf("select ping_status, ping_count, contact from sip_registrations where sip_user='%q' and sip_host='%q' and call_id='%q'",
-				     sip->sip_to->a_url->url_user, sip->sip_to->a_url->url_host, call_id);
-		sofia_glue_execute_sql_callback(profile, profile->ireg_mutex, sql, sofia_sip_user_status_callback, &sip_user_status);
-		switch_safe_free(sql);
+		if (sofia_reg_store_enabled(profile)) {
+			sofia_reg_match_t match = { 0 };
+
+			match.user = sip->sip_to->a_url->url_user;
+			match.host = sip->sip_to->a_url->url_host;
+			match.call_id = call_id;
+			sofia_reg_store_select(profile->reg_store, &match, sofia_sip_user_status_store_callback, &sip_user_status);
+		} else {
+			sql = switch_mprintf("select ping_status, ping_count, contact from sip_registrations where sip_user='%q' and sip_host='%q' and call_id='%q'",
+							 sip->sip_to->a_url->url_user, sip->sip_to->a_url->url_host, call_id);
+			sofia_glue_execute_sql_callback(profile, profile->ireg_mutex, sql, sofia_sip_user_status_callback, &sip_user_status);
+			switch_safe_free(sql);
+		}
 
 		if (status != 200 && status != 486) {
 			sip_user_status.count--;
 			if (sip_user_status.count >= 0) {
 				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG, "Ping to sip user '%s@%s' failed with code %d - count %d, state %s\n",
 						  sip->sip_to->a_url->url_user, sip->sip_to->a_url->url_host, status, sip_user_status.count, sip_user_status.status);
+				switch_snprintf(count_c, sizeof(count_c), "%d", sip_user_status.count);
+				sofia_sip_user_status_update(profile, sip, call_id, SOFIA_REG_COL_PING_COUNT, count_c, ping_time);
 				sql = switch_mprintf("update sip_registrations set ping_count=%d, ping_time=%d where sip_user='%q' and sip_host='%q' and call_id='%q'",
 									 sip_user_status.count, ping_time, sip->sip_to->a_url->url_user, sip->sip_to->a_url->url_host, call_id);
-				sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+				sofia_reg_execute_sql(profile, &sql, SWITCH_FALSE);
 				switch_safe_free(sql);
 			}
 			if (sip_user_status.count < sip_user_ping_min) {
 				if (strcmp(sip_user_status.status, "Unreachable")) {
 					switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_WARNING, "Sip user '%s@%s' is now Unreachable\n",
 							  sip->sip_to->a_url->url_user, sip->sip_to->a_url->url_host);
+					sofia_sip_user_status_update(profile, sip, call_id, SOFIA_REG_COL_PING_STATUS, "Unreachable", ping_time);
 					sql = switch_mprintf("update sip_registrations set ping_status='Unreachable', ping_time=%d where sip_user='%q' and sip_host='%q' and call_id='%q'",
 										 ping_time, sip->sip_to->a_url->url_user, sip->sip_to->a_url->url_host, call_id);
-					sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+					sofia_reg_execute_sql(profile, &sql, SWITCH_FALSE);
 					switch_safe_free(sql);
 					sofia_reg_fire_custom_sip_user_state_event(profile, sip_user, sip_user_status.contact, sip->sip_to->a_url->url_user,
 															   sip->sip_to->a_url->url_host, call_id, SOFIA_REG_REACHABLE, status, phrase);
 
 					if (sofia_test_pflag(profile, PFLAG_UNREG_OPTIONS_FAIL)) {
 						time_t now = switch_epoch_time_now(NULL);
+						char now_c[32];
+
 						switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_WARNING, "Expire sip user '%s@%s' due to options failure\n",
 								  sip->sip_to->a_url->url_user, sip->sip_to->a_url->url_host);
 
+						switch_snprintf(now_c, sizeof(now_c), "%ld", (long) now);
+						sofia_sip_user_status_update(profile, sip, call_id, SOFIA_REG_COL_EXPIRES, now_c, ping_time);
 						sql = switch_mprintf("update sip_registrations set expires=%ld, ping_time=%d where sip_user='%q' and sip_host='%q' and call_id='%q'",
 											 (long) now, ping_time, sip->sip_to->a_url->url_user, sip->sip_to->a_url->url_host, call_id);
-						sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+						sofia_reg_execute_sql(profile, &sql, SWITCH_FALSE);
 						switch_safe_free(sql);
 					}
 				}
@@ -6374,18 +6973,21 @@ static void sofia_handle_sip_r_options(switch_core_session_t *session, int statu
 			if (sip_user_status.count <= sip_user_ping_max) {
 				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG, "Ping to sip user '%s@%s' succeeded with code %d - count %d, state %s\n",
 						  sip->sip_to->a_url->url_user, sip->sip_to->a_url->url_host, status, sip_user_status.count, sip_user_status.status);
+				switch_snprintf(count_c, sizeof(count_c), "%d", sip_user_status.count);
+				sofia_sip_user_status_update(profile, sip, call_id, SOFIA_REG_COL_PING_COUNT, count_c, ping_time);
 				sql = switch_mprintf("update sip_registrations set ping_count=%d, ping_time=%d where sip_user='%q' and sip_host='%q' and call_id='%q'",
 									 sip_user_status.count, ping_time, sip->sip_to->a_url->url_user, sip->sip_to->a_url->url_host, call_id);
-				sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+				sofia_reg_execute_sql(profile, &sql, SWITCH_FALSE);
 				switch_safe_free(sql);
 			}
 			if (sip_user_status.count >= sip_user_ping_min) {
 				if (strcmp(sip_user_status.status, "Reachable")) {
 					switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_WARNING, "Sip user '%s@%s' is now Reachable\n",
 							  sip->sip_to->a_url->url_user, sip->sip_to->a_url->url_host);
+					sofia_sip_user_status_update(profile, sip, call_id, SOFIA_REG_COL_PING_STATUS, "Reachable", -1);
 					sql = switch_mprintf("update sip_registrations set ping_status='Reachable' where sip_user='%q' and sip_host='%q' and call_id='%q'",
 							     sip->sip_to->a_url->url_user, sip->sip_to->a_url->url_host, call_id);
-					sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+					sofia_reg_execute_sql(profile, &sql, SWITCH_FALSE);
 					switch_safe_free(sql);
 					sofia_reg_fire_custom_sip_user_state_event(profile, sip_user, sip_user_status.contact, sip->sip_to->a_url->url_user,
 															   sip->sip_to->a_url->url_host, call_id, SOFIA_REG_UNREACHABLE, status, phrase);
@@ -6544,6 +7146,17 @@ static void sofia_handle_sip_r_invite(switch_core_session_t *session, int status
 
 						sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
 
+						if (sofia_presence_store_enabled(profile)) {
+							sofia_dlg_match_t match = { 0 };
+							sofia_dlg_col_t set[] = { SOFIA_DLG_COL_CALL_INFO, SOFIA_DLG_COL_CALL_INFO_STATE };
+							const char *vals[2];
+
+							vals[0] = buf;
+							vals[1] = state;
+							match.uuid = switch_core_session_get_uuid(session);
+							sofia_presence_store_dialog_update(profile->pres_store, &match, set, vals, 2);
+						}
+
 						switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_WARNING, "Auto-Fixing Broken SLA [<sip:%s>;%s]\n",
 										  sip->sip_from->a_url->url_host, buf);
 						switch_channel_set_variable_printf(channel, "presence_call_info_full", "<sip:%s>;%s", sip->sip_from->a_url->url_host, buf);
@@ -7003,6 +7616,23 @@ static void sofia_handle_sip_r_invite(switch_core_session_t *session, int status
 
 					sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
 
+					if (sofia_presence_store_enabled(profile)) {
+						const char *cols[SOFIA_DLG_COL_MAX] = { 0 };
+						char rcd[32];
+
+						switch_snprintf(rcd, sizeof(rcd), "%ld", (long) now);
+
+						cols[SOFIA_DLG_COL_STATE] = astate;
+						cols[SOFIA_DLG_COL_PRESENCE_ID] = presence_id;
+						cols[SOFIA_DLG_COL_UUID] = switch_core_session_get_uuid(session);
+						cols[SOFIA_DLG_COL_CALL_ID] = call_id;
+						cols[SOFIA_DLG_COL_SIP_FROM_USER] = from_user;
+						cols[SOFIA_DLG_COL_SIP_FROM_HOST] = from_host;
+						cols[SOFIA_DLG_COL_CALL_INFO] = p;
+						cols[SOFIA_DLG_COL_RCD] = rcd;
+						sofia_presence_store_dialog_insert(profile->pres_store, cols);
+					}
+
 					if ( full_contact ) {
 						su_free(nua_handle_home(tech_pvt->nh), full_contact);
 					}
@@ -7017,6 +7647,17 @@ static void sofia_handle_sip_r_invite(switch_core_session_t *session, int status
 									 switch_core_session_get_uuid(session));
 				switch_assert(sql);
 				sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+
+				if (sofia_presence_store_enabled(profile)) {
+					sofia_dlg_match_t match = { 0 };
+					sofia_dlg_col_t set[] = { SOFIA_DLG_COL_STATE, SOFIA_DLG_COL_PRESENCE_ID };
+					const char *vals[2];
+
+					vals[0] = astate;
+					vals[1] = presence_id;
+					match.uuid = switch_core_session_get_uuid(session);
+					sofia_presence_store_dialog_update(profile->pres_store, &match, set, vals, 2);
+				}
 			}
 
 			extract_header_vars(profile, sip, session, nh);
@@ -7722,7 +8363,8 @@ static void sofia_handle_sip_i_state(switch_core_session_t *session, int status,
 							home = su_home_new(sizeof(*home));
 							switch_assert(home != NULL);
 							if ((replaces = sip_replaces_make(home, replaces_str))
-								&& (bnh = nua_handle_by_replaces(nua, replaces))) {
+								&& ((bnh = sofia_glue_handle_by_replaces(profile, replaces))
+									|| (bnh = sofia_glue_handle_by_call_id(profile, replaces->rp_call_id)))) {
 								sofia_private_t *b_private;
 
 								switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG, "Processing Replaces Attended Transfer\n");
@@ -8640,8 +9282,8 @@ nua_handle_t *sofia_global_nua_handle_by_replaces(sip_replaces_t *replaces)
 		for (hi = switch_core_hash_first(mod_sofia_globals.profile_hash); hi; hi = switch_core_hash_next(&hi)) {
 			switch_core_hash_this(hi, &var, NULL, &val);
 			if ((profile = (sofia_profile_t *) val)) {
-				if (!(nh = nua_handle_by_replaces(profile->nua, replaces))) {
-					nh = nua_handle_by_call_id(profile->nua, replaces->rp_call_id);
+				if (!(nh = sofia_glue_handle_by_replaces(profile, replaces))) {
+					nh = sofia_glue_handle_by_call_id(profile, replaces->rp_call_id);
 				}
 				if (nh)
 					break;
@@ -8783,8 +9425,8 @@ void sofia_handle_sip_i_refer(nua_t *nua, sofia_profile_t *profile, nua_handle_t
 			}
 
 			if ((replaces = sip_replaces_make(home, rep))) {
-				if (!(bnh = nua_handle_by_replaces(nua, replaces))) {
-					if (!(bnh = nua_handle_by_call_id(nua, replaces->rp_call_id))) {
+				if (!(bnh = sofia_glue_handle_by_replaces(profile, replaces))) {
+					if (!(bnh = sofia_glue_handle_by_call_id(profile, replaces->rp_call_id))) {
 						bnh = sofia_global_nua_handle_by_replaces(replaces);
 					}
 				}
@@ -10850,6 +11492,16 @@ void sofia_handle_sip_i_invite(switch_core_session_t *session, nua_t *nua, sofia
 
 				sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
 
+				if (sofia_presence_store_enabled(profile)) {
+					sofia_dlg_match_t match = { 0 };
+					sofia_dlg_col_t set[] = { SOFIA_DLG_COL_CALL_INFO, SOFIA_DLG_COL_CALL_INFO_STATE };
+					const char *vals[2];
+
+					vals[0] = buf;
+					vals[1] = state;
+					match.uuid = switch_core_session_get_uuid(session);
+					sofia_presence_store_dialog_update(profile->pres_store, &match, set, vals, 2);
+				}
 
 				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_WARNING, "Auto-Fixing Broken SLA [<sip:%s>;%s]\n",
 								  sip->sip_from->a_url->url_host, buf);
@@ -10970,7 +11622,7 @@ void sofia_handle_sip_i_invite(switch_core_session_t *session, nua_t *nua, sofia
 				 switch_str_nil(p), switch_str_nil(p), user, host, user, host);
 
 			if ((str = sofia_glue_execute_sql2str(profile, profile->dbh_mutex, sql, cid, sizeof(cid)))) {
-				bnh = nua_handle_by_call_id(nua, str);
+				bnh = sofia_glue_handle_by_call_id(profile, str);
 			}
 
 			if (mod_sofia_globals.debug_sla > 1) {
@@ -10997,8 +11649,8 @@ void sofia_handle_sip_i_invite(switch_core_session_t *session, nua_t *nua, sofia
 	profile_dup_clean(destination_number, tech_pvt->caller_profile->destination_number, tech_pvt->caller_profile->pool);
 
 	if (!bnh && sip->sip_replaces) {
-		if (!(bnh = nua_handle_by_replaces(nua, sip->sip_replaces))) {
-			if (!(bnh = nua_handle_by_call_id(nua, sip->sip_replaces->rp_call_id))) {
+		if (!(bnh = sofia_glue_handle_by_replaces(profile, sip->sip_replaces))) {
+			if (!(bnh = sofia_glue_handle_by_call_id(profile, sip->sip_replaces->rp_call_id))) {
 				bnh = sofia_global_nua_handle_by_replaces(sip->sip_replaces);
 			}
 		}
@@ -11067,6 +11719,15 @@ void sofia_handle_sip_i_invite(switch_core_session_t *session, nua_t *nua, sofia
 							}
 							sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
 
+							if (sofia_presence_store_enabled(profile)) {
+								sofia_dlg_match_t match = { 0 };
+								sofia_dlg_col_t set[] = { SOFIA_DLG_COL_CALL_INFO_STATE };
+								const char *val = "idle";
+
+								match.call_id = b_call_id;
+								sofia_presence_store_dialog_update(profile->pres_store, &match, set, &val, 1);
+							}
+
 							switch_channel_presence(b_channel, "unknown", "idle", NULL);
 						}
 						switch_channel_set_flag(tech_pvt->channel, CF_SLA_INTERCEPT);
@@ -11378,6 +12039,23 @@ void sofia_handle_sip_i_invite(switch_core_session_t *session, nua_t *nua, sofia
 
 		sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
 
+		if (sofia_presence_store_enabled(profile)) {
+			const char *cols[SOFIA_DLG_COL_MAX] = { 0 };
+			char rcd[32];
+
+			switch_snprintf(rcd, sizeof(rcd), "%ld", (long) now);
+
+			cols[SOFIA_DLG_COL_STATE] = "confirmed";
+			cols[SOFIA_DLG_COL_PRESENCE_ID] = presence_id;
+			cols[SOFIA_DLG_COL_UUID] = tech_pvt->sofia_private->uuid;
+			cols[SOFIA_DLG_COL_CALL_ID] = call_id;
+			cols[SOFIA_DLG_COL_SIP_FROM_USER] = dialog_from_user;
+			cols[SOFIA_DLG_COL_SIP_FROM_HOST] = dialog_from_host;
+			cols[SOFIA_DLG_COL_CALL_INFO] = p;
+			cols[SOFIA_DLG_COL_RCD] = rcd;
+			sofia_presence_store_dialog_insert(profile->pres_store, cols);
+		}
+
 		if ( full_contact ) {
 			su_free(nua_handle_home(tech_pvt->nh), full_contact);
 		}
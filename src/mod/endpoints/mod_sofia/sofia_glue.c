@@ -1773,7 +1773,7 @@ void sofia_glue_global_siptrace(switch_bool_t on)
 		for (hi = switch_core_hash_first(mod_sofia_globals.profile_hash); hi; hi = switch_core_hash_next(&hi)) {
 			switch_core_hash_this(hi, &var, NULL, &val);
 			if ((pptr = (sofia_profile_t *) val)) {
-				nua_set_params(pptr->nua, TPTAG_LOG(on), TAG_END());
+				sofia_glue_profile_siptrace(pptr, on);
 			}
 		}
 	}
@@ -1817,7 +1817,7 @@ void sofia_glue_global_capture(switch_bool_t on)
                for (hi = switch_core_hash_first(mod_sofia_globals.profile_hash); hi; hi = switch_core_hash_next(&hi)) {
                        switch_core_hash_this(hi, &var, NULL, &val);
                        if ((pptr = (sofia_profile_t *) val)) {
-                               nua_set_params(pptr->nua, TPTAG_CAPT(on ? mod_sofia_globals.capture_server : NULL), TAG_END());
+                               sofia_glue_profile_capture(pptr, on);
                        }
                }
        }
@@ -1825,6 +1825,67 @@ void sofia_glue_global_capture(switch_bool_t on)
 
 }
 
+/* the listener stacks log and capture on their own, keep them in step with the profile;
+   the listeners are walked under flag_mutex since sofia_listeners_destroy can drop them meanwhile */
+void sofia_glue_profile_siptrace(sofia_profile_t *profile, switch_bool_t on)
+{
+	int i;
+
+	nua_set_params(profile->nua, TPTAG_LOG(on), TAG_END());
+
+	switch_mutex_lock(profile->flag_mutex);
+	for (i = 1; i < profile->listener_count; i++) {
+		nua_set_params(profile->listeners[i].nua, TPTAG_LOG(on), TAG_END());
+	}
+	switch_mutex_unlock(profile->flag_mutex);
+}
+
+void sofia_glue_profile_capture(sofia_profile_t *profile, switch_bool_t on)
+{
+	int i;
+
+	nua_set_params(profile->nua, TPTAG_CAPT(on ? mod_sofia_globals.capture_server : NULL), TAG_END());
+
+	switch_mutex_lock(profile->flag_mutex);
+	for (i = 1; i < profile->listener_count; i++) {
+		nua_set_params(profile->listeners[i].nua, TPTAG_CAPT(on ? mod_sofia_globals.capture_server : NULL), TAG_END());
+	}
+	switch_mutex_unlock(profile->flag_mutex);
+}
+
+/* a dialog lives in the stack that received or sent its first request, look in all of them */
+nua_handle_t *sofia_glue_handle_by_call_id(sofia_profile_t *profile, const char *call_id)
+{
+	nua_handle_t *nh;
+	int i;
+
+	if (!(nh = nua_handle_by_call_id(profile->nua, call_id))) {
+		switch_mutex_lock(profile->flag_mutex);
+		for (i = 1; !nh && i < profile->listener_count; i++) {
+			nh = nua_handle_by_call_id(profile->listeners[i].nua, call_id);
+		}
+		switch_mutex_unlock(profile->flag_mutex);
+	}
+
+	return nh;
+}
+
+nua_handle_t *sofia_glue_handle_by_replaces(sofia_profile_t *profile, sip_replaces_t const *replaces)
+{
+	nua_handle_t *nh;
+	int i;
+
+	if (!(nh = nua_handle_by_replaces(profile->nua, replaces))) {
+		switch_mutex_lock(profile->flag_mutex);
+		for (i = 1; !nh && i < profile->listener_count; i++) {
+			nh = nua_handle_by_replaces(profile->listeners[i].nua, replaces);
+		}
+		switch_mutex_unlock(profile->flag_mutex);
+	}
+
+	return nh;
+}
+
 
 void sofia_glue_global_watchdog(switch_bool_t on)
 {
@@ -2555,6 +2616,43 @@ char *sofia_glue_execute_sql2str(sofia_profile_t *profile, switch_mutex_t *mutex
 	return ret;
 }
 
+char *sofia_glue_execute_sql2str_params(sofia_profile_t *profile, switch_mutex_t *mutex, const char *sql, int nparams, const char **params,
+										char *resbuf, size_t len)
+{
+	char *ret = NULL;
+	char *err = NULL;
+	switch_cache_db_handle_t *dbh = NULL;
+
+	if (mutex) {
+		switch_mutex_lock(mutex);
+	}
+
+	if (!(dbh = sofia_glue_get_db_handle(profile))) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error Opening DB\n");
+
+		if (mutex) {
+			switch_mutex_unlock(mutex);
+		}
+
+		return NULL;
+	}
+
+	ret = switch_cache_db_execute_sql2str_params(dbh, sql, nparams, params, resbuf, len, &err);
+
+	if (mutex) {
+		switch_mutex_unlock(mutex);
+	}
+
+	if (err) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "SQL ERR: [%s]\n%s\n", err, sql);
+		free(err);
+	}
+
+	switch_cache_db_release_db_handle(&dbh);
+
+	return ret;
+}
+
 char *sofia_glue_get_register_host(const char *uri)
 {
 	char *register_host = NULL;
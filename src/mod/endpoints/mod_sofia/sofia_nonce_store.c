@@ -0,0 +1,539 @@
+/*
+ * FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ * Copyright (C) 2005-2014, Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Version: MPL 1.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ *
+ * The Initial Developer of the Original Code is
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Portions created by the Initial Developer are Copyright (C)
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Anthony Minessale II <anthm@freeswitch.org>
+ *
+ *
+ * sofia_nonce_store.c -- SOFIA SIP Endpoint (in memory digest nonces)
+ *
+ */
+#include "mod_sofia.h"
+
+/* must be a power of 2 */
+#define NONCE_SHARDS 16
+#define NONCE_HMAC_BLOCK 64
+
+/* stateless nonces are <expires:8 hex><random:32 hex><mac:16 hex> */
+#define NONCE_STATELESS_LEN (8 + 32 + 16)
+
+typedef struct {
+	time_t expires;
+	uint32_t last_nc;
+	int revoked;
+} nonce_entry_t;
+
+typedef struct {
+	switch_mutex_t *mutex;
+	switch_hash_t *hash;
+	uint32_t count;
+	uint64_t issued;
+	uint64_t accepted;
+	uint64_t rejected;
+} nonce_shard_t;
+
+struct sofia_nonce_store {
+	nonce_shard_t shard[NONCE_SHARDS];
+	unsigned char key[NONCE_HMAC_BLOCK];
+};
+
+static nonce_shard_t *nonce_shard(sofia_nonce_store_t *store, const char *nonce)
+{
+	uint32_t h = 2166136261u;
+
+	for (; *nonce; nonce++) {
+		h = (h ^ (unsigned char) *nonce) * 16777619u;
+	}
+
+	return &store->shard[h & (NONCE_SHARDS - 1)];
+}
+
+/* rfc 2104 over md5, the only digest the core already carries */
+static void nonce_hmac(sofia_nonce_store_t *store, const char *data, switch_size_t len, unsigned char digest[SWITCH_MD5_DIGESTSIZE])
+{
+	unsigned char buf[NONCE_HMAC_BLOCK + 64];
+	int i;
+
+	switch_assert(len <= 64);
+
+	for (i = 0; i < NONCE_HMAC_BLOCK; i++) {
+		buf[i] = store->key[i] ^ 0x36;
+	}
+	memcpy(buf + NONCE_HMAC_BLOCK, data, len);
+	switch_md5(digest, buf, NONCE_HMAC_BLOCK + len);
+
+	for (i = 0; i < NONCE_HMAC_BLOCK; i++) {
+		buf[i] = store->key[i] ^ 0x5c;
+	}
+	memcpy(buf + NONCE_HMAC_BLOCK, digest, SWITCH_MD5_DIGESTSIZE);
+	switch_md5(digest, buf, NONCE_HMAC_BLOCK + SWITCH_MD5_DIGESTSIZE);
+}
+
+static void nonce_hex(const unsigned char *in, switch_size_t len, char *out)
+{
+	static const char hex[] = "0123456789abcdef";
+	switch_size_t i;
+
+	for (i = 0; i < len; i++) {
+		*out++ = hex[in[i] >> 4];
+		*out++ = hex[in[i] & 0xf];
+	}
+	*out = '\0';
+}
+
+/* a well formed stateless nonce with a good mac that has not run out, judged without the table */
+static switch_bool_t nonce_stateless_valid(sofia_nonce_store_t *store, const char *nonce, time_t now, time_t *expires)
+{
+	unsigned char digest[SWITCH_MD5_DIGESTSIZE];
+	char mac[SWITCH_MD5_DIGESTSIZE * 2 + 1];
+	char stamp[9];
+	const char *p;
+	int diff = 0, i;
+
+	if (strlen(nonce) != NONCE_STATELESS_LEN) {
+		return SWITCH_FALSE;
+	}
+
+	for (p = nonce; *p; p++) {
+		if (!isxdigit((unsigned char) *p)) {
+			return SWITCH_FALSE;
+		}
+	}
+
+	nonce_hmac(store, nonce, NONCE_STATELESS_LEN - 16, digest);
+	nonce_hex(digest, 8, mac);
+
+	/* no early exit, the time taken must not say how much of the mac was right */
+	for (i = 0; i < 16; i++) {
+		diff |= mac[i] ^ nonce[NONCE_STATELESS_LEN - 16 + i];
+	}
+
+	if (diff) {
+		return SWITCH_FALSE;
+	}
+
+	memcpy(stamp, nonce, 8);
+	stamp[8] = '\0';
+	*expires = (time_t) strtoul(stamp, NULL, 16);
+
+	return *expires > now ? SWITCH_TRUE : SWITCH_FALSE;
+}
+
+switch_status_t sofia_nonce_store_create(sofia_nonce_store_t **store, switch_memory_pool_t *pool)
+{
+	sofia_nonce_store_t *ns;
+	switch_uuid_t uuid;
+	int i;
+
+	ns = switch_core_alloc(pool, sizeof(*ns));
+
+	for (i = 0; i < NONCE_SHARDS; i++) {
+		switch_mutex_init(&ns->shard[i].mutex, SWITCH_MUTEX_NESTED, pool);
+		switch_core_hash_init(&ns->shard[i].hash);
+	}
+
+	/* a random key until nonce-secret gives one the whole cluster shares */
+	for (i = 0; i < NONCE_HMAC_BLOCK; i += sizeof(uuid.data)) {
+		switch_uuid_get(&uuid);
+		memcpy(ns->key + i, uuid.data, sizeof(uuid.data));
+	}
+
+	*store = ns;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+void sofia_nonce_store_destroy(sofia_nonce_store_t **store)
+{
+	int i;
+
+	if (!store || !*store) {
+		return;
+	}
+
+	for (i = 0; i < NONCE_SHARDS; i++) {
+		switch_mutex_lock((*store)->shard[i].mutex);
+		switch_core_hash_destroy(&(*store)->shard[i].hash);
+		switch_mutex_unlock((*store)->shard[i].mutex);
+	}
+
+	*store = NULL;
+}
+
+void sofia_nonce_store_set_secret(sofia_nonce_store_t *store, const char *secret)
+{
+	switch_size_t len = strlen(secret);
+
+	memset(store->key, 0, sizeof(store->key));
+
+	if (len > NONCE_HMAC_BLOCK) {
+		switch_md5(store->key, secret, len);
+	} else {
+		memcpy(store->key, secret, len);
+	}
+}
+
+static void nonce_insert(nonce_shard_t *shard, const char *nonce, time_t expires, uint32_t last_nc)
+{
+	nonce_entry_t *entry;
+
+	switch_zmalloc(entry, sizeof(*entry));
+	entry->expires = expires;
+	entry->last_nc = last_nc;
+
+	switch_core_hash_insert_destructor(shard->hash, nonce, entry, free);
+	shard->count++;
+}
+
+void sofia_nonce_store_issue(sofia_nonce_store_t *store, switch_bool_t stateless, time_t expires, char *buf, switch_size_t len)
+{
+	nonce_shard_t *shard;
+	switch_uuid_t uuid;
+
+	switch_uuid_get(&uuid);
+
+	if (stateless) {
+		char nonce[NONCE_STATELESS_LEN + 1];
+		unsigned char digest[SWITCH_MD5_DIGESTSIZE];
+
+		switch_snprintf(nonce, sizeof(nonce), "%08x", (uint32_t) expires);
+		nonce_hex(uuid.data, sizeof(uuid.data), nonce + 8);
+		nonce_hmac(store, nonce, NONCE_STATELESS_LEN - 16, digest);
+		nonce_hex(digest, 8, nonce + NONCE_STATELESS_LEN - 16);
+
+		switch_copy_string(buf, nonce, len);
+	} else {
+		switch_uuid_format(buf, &uuid);
+	}
+
+	shard = nonce_shard(store, buf);
+	switch_mutex_lock(shard->mutex);
+	shard->issued++;
+
+	if (!stateless) {
+		nonce_insert(shard, buf, expires, 0);
+	}
+	switch_mutex_unlock(shard->mutex);
+}
+
+/* the same test as "select nonce,last_nc from sip_authentication where nonce=? and last_nc < nc" */
+switch_status_t sofia_nonce_store_check(sofia_nonce_store_t *store, const char *nonce, uint32_t nc, uint32_t *last_nc)
+{
+	nonce_shard_t *shard = nonce_shard(store, nonce);
+	nonce_entry_t *entry;
+	time_t expires;
+	switch_status_t status = SWITCH_STATUS_FALSE;
+
+	switch_mutex_lock(shard->mutex);
+
+	if (!(entry = switch_core_hash_find(shard->hash, nonce)) &&
+		nonce_stateless_valid(store, nonce, switch_epoch_time_now(NULL), &expires)) {
+		/* first answer to a stateless challenge, from here on its nonce count is tracked like any other */
+		nonce_insert(shard, nonce, expires, 0);
+		entry = switch_core_hash_find(shard->hash, nonce);
+	}
+
+	if (entry && !entry->revoked && (!nc || entry->last_nc < nc)) {
+		*last_nc = entry->last_nc;
+		status = SWITCH_STATUS_SUCCESS;
+		shard->accepted++;
+	} else {
+		shard->rejected++;
+	}
+
+	switch_mutex_unlock(shard->mutex);
+
+	return status;
+}
+
+void sofia_nonce_store_update(sofia_nonce_store_t *store, const char *nonce, time_t expires, uint32_t nc)
+{
+	nonce_shard_t *shard = nonce_shard(store, nonce);
+	nonce_entry_t *entry;
+
+	switch_mutex_lock(shard->mutex);
+	if ((entry = switch_core_hash_find(shard->hash, nonce)) && !entry->revoked) {
+		entry->expires = expires;
+		entry->last_nc = nc;
+	}
+	switch_mutex_unlock(shard->mutex);
+}
+
+void sofia_nonce_store_delete(sofia_nonce_store_t *store, const char *nonce)
+{
+	nonce_shard_t *shard = nonce_shard(store, nonce);
+	nonce_entry_t *entry;
+	time_t expires;
+
+	switch_mutex_lock(shard->mutex);
+	if ((entry = switch_core_hash_find(shard->hash, nonce))) {
+		if (nonce_stateless_valid(store, nonce, switch_epoch_time_now(NULL), &expires)) {
+			/* its mac is still good, keep a tombstone until it runs out or it would be let straight back in */
+			entry->revoked = 1;
+			entry->expires = expires;
+		} else {
+			switch_core_hash_delete(shard->hash, nonce);
+			shard->count--;
+		}
+	}
+	switch_mutex_unlock(shard->mutex);
+}
+
+struct nonce_expire_helper {
+	sofia_nonce_store_t *store;
+	time_t now;
+	time_t clock;
+	uint32_t count;
+};
+
+SWITCH_HASH_DELETE_FUNC(nonce_expire_callback)
+{
+	struct nonce_expire_helper *helper = (struct nonce_expire_helper *) pData;
+	const nonce_entry_t *entry = (const nonce_entry_t *) val;
+	time_t expires;
+
+	if (helper->now && entry->expires > helper->now) {
+		return SWITCH_FALSE;
+	}
+
+	/* a stateless nonce whose mac still holds would be taken back with a fresh nonce count,
+	   its nc tracking or revocation has to outlive any flush until the mac runs out */
+	if (nonce_stateless_valid(helper->store, (const char *) key, helper->clock, &expires)) {
+		return SWITCH_FALSE;
+	}
+
+	helper->count++;
+	return SWITCH_TRUE;
+}
+
+/* drops every nonce due by now, or all of them when now is 0, one shard at a time.
+   Stateless nonces are kept either way until their own mac expires. */
+uint32_t sofia_nonce_store_expire(sofia_nonce_store_t *store, time_t now)
+{
+	time_t clock = switch_epoch_time_now(NULL);
+	uint32_t total = 0;
+	int i;
+
+	for (i = 0; i < NONCE_SHARDS; i++) {
+		nonce_shard_t *shard = &store->shard[i];
+		struct nonce_expire_helper helper = { store, now, now > clock ? now : clock, 0 };
+
+		switch_mutex_lock(shard->mutex);
+		if (shard->count) {
+			switch_core_hash_delete_multi(shard->hash, nonce_expire_callback, &helper);
+			shard->count -= helper.count;
+		}
+		switch_mutex_unlock(shard->mutex);
+
+		total += helper.count;
+	}
+
+	return total;
+}
+
+void sofia_nonce_store_status(sofia_nonce_store_t *store, switch_stream_handle_t *stream)
+{
+	uint64_t issued = 0, accepted = 0, rejected = 0;
+	uint32_t count = 0;
+	int i;
+
+	for (i = 0; i < NONCE_SHARDS; i++) {
+		nonce_shard_t *shard = &store->shard[i];
+
+		switch_mutex_lock(shard->mutex);
+		count += shard->count;
+		issued += shard->issued;
+		accepted += shard->accepted;
+		rejected += shard->rejected;
+		switch_mutex_unlock(shard->mutex);
+	}
+
+	stream->write_function(stream, "NONCES           \t%u\n", count);
+	stream->write_function(stream, "NONCES-ISSUED    \t%" SWITCH_UINT64_T_FMT "\n", issued);
+	stream->write_function(stream, "NONCES-ACCEPTED  \t%" SWITCH_UINT64_T_FMT "\n", accepted);
+	stream->write_function(stream, "NONCES-REJECTED  \t%" SWITCH_UINT64_T_FMT "\n", rejected);
+}
+
+typedef struct {
+	sofia_nonce_store_t *store;
+	switch_bool_t stateless;
+	uint32_t count;
+	uint32_t failed;
+} nonce_bench_t;
+
+/* one challenge, then a REGISTER answering it and two refreshes reusing it with a rising nonce count */
+static void *SWITCH_THREAD_FUNC nonce_bench_thread(switch_thread_t *thread, void *obj)
+{
+	nonce_bench_t *b = (nonce_bench_t *) obj;
+	time_t expires = switch_epoch_time_now(NULL) + 60;
+	char nonce[80];
+	uint32_t i, nc, last_nc;
+
+	for (i = 0; i < b->count; i++) {
+		sofia_nonce_store_issue(b->store, b->stateless, expires, nonce, sizeof(nonce));
+
+		for (nc = 1; nc <= 3; nc++) {
+			if (sofia_nonce_store_check(b->store, nonce, nc, &last_nc) != SWITCH_STATUS_SUCCESS) {
+				b->failed++;
+				break;
+			}
+			sofia_nonce_store_update(b->store, nonce, expires, nc);
+		}
+
+		/* a replay of the last answer has to be refused */
+		if (sofia_nonce_store_check(b->store, nonce, 3, &last_nc) == SWITCH_STATUS_SUCCESS) {
+			b->failed++;
+		}
+	}
+
+	return NULL;
+}
+
+static double nonce_bench_memory(switch_bool_t stateless, int threads, uint32_t count, uint32_t *failed, switch_memory_pool_t *pool)
+{
+	sofia_nonce_store_t *store = NULL;
+	switch_threadattr_t *thd_attr = NULL;
+	switch_thread_t *thread[8];
+	nonce_bench_t bench[8];
+	switch_time_t start, elapsed;
+	switch_status_t st;
+	int i;
+
+	sofia_nonce_store_create(&store, pool);
+	switch_threadattr_create(&thd_attr, pool);
+	switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+
+	start = switch_micro_time_now();
+
+	for (i = 0; i < threads; i++) {
+		bench[i].store = store;
+		bench[i].stateless = stateless;
+		bench[i].count = count / threads;
+		bench[i].failed = 0;
+		switch_thread_create(&thread[i], thd_attr, nonce_bench_thread, &bench[i], pool);
+	}
+
+	for (i = 0; i < threads; i++) {
+		switch_thread_join(&st, thread[i]);
+		*failed += bench[i].failed;
+	}
+
+	elapsed = switch_micro_time_now() - start;
+
+	sofia_nonce_store_expire(store, 0);
+	sofia_nonce_store_destroy(&store);
+
+	return elapsed / (double) (count ? count : 1);
+}
+
+static int nonce_bench_sql_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	(*(uint32_t *) pArg)++;
+	return 0;
+}
+
+/* the statements sofia_reg_auth_challenge and sofia_reg_parse_auth run when nonces live in sip_authentication */
+static double nonce_bench_sql(sofia_profile_t *profile, uint32_t count, uint32_t *failed)
+{
+	const char *bench_name = "__nonce_bench__";
+	long expires = (long) switch_epoch_time_now(NULL) + 60;
+	char nonce[SWITCH_UUID_FORMATTED_LENGTH + 1];
+	switch_uuid_t uuid;
+	switch_time_t start, elapsed;
+	uint32_t i, nc, found;
+	char *sql;
+
+	start = switch_micro_time_now();
+
+	for (i = 0; i < count; i++) {
+		switch_uuid_get(&uuid);
+		switch_uuid_format(nonce, &uuid);
+
+		sql = switch_mprintf("insert into sip_authentication (nonce,expires,profile_name,hostname, last_nc) "
+							 "values('%q', %ld, '%q', '%q', 0)", nonce, expires, bench_name, mod_sofia_globals.hostname);
+		sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+
+		for (nc = 1; nc <= 3; nc++) {
+			found = 0;
+			sql = switch_mprintf("select nonce,last_nc from sip_authentication where nonce='%q' and last_nc < %lu", nonce, (unsigned long) nc);
+			sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, nonce_bench_sql_callback, &found);
+			free(sql);
+
+			if (!found) {
+				(*failed)++;
+				break;
+			}
+
+			sql = switch_mprintf("update sip_authentication set expires='%ld',last_nc=%lu where nonce='%q'", expires, (unsigned long) nc, nonce);
+			sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+		}
+	}
+
+	elapsed = switch_micro_time_now() - start;
+
+	sql = switch_mprintf("delete from sip_authentication where profile_name='%q'", bench_name);
+	sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+
+	return elapsed / (double) (count ? count : 1);
+}
+
+void sofia_nonce_store_bench(sofia_profile_t *profile, uint32_t count, switch_stream_handle_t *stream)
+{
+	switch_memory_pool_t *pool = NULL;
+	int threads[] = { 1, 4, 8 };
+	uint32_t failed;
+	double us;
+	int i, s;
+
+	switch_core_new_memory_pool(&pool);
+
+	for (s = 0; s < 2; s++) {
+		for (i = 0; i < (int) (sizeof(threads) / sizeof(threads[0])); i++) {
+			failed = 0;
+			us = nonce_bench_memory(s ? SWITCH_TRUE : SWITCH_FALSE, threads[i], count, &failed, pool);
+			stream->write_function(stream, "memory %-9s %d threads %8u auths: %8.3f us each%s\n", s ? "stateless" : "stateful",
+								   threads[i], count, us, failed ? " (FAILED CHECKS)" : "");
+		}
+	}
+
+	if (profile) {
+		failed = 0;
+		us = nonce_bench_sql(profile, count, &failed);
+		stream->write_function(stream, "sql    %-9s %d threads %8u auths: %8.3f us each%s\n", profile->name, 1, count, us,
+							   failed ? " (FAILED CHECKS)" : "");
+	}
+
+	switch_core_destroy_memory_pool(&pool);
+}
+
+/* For Emacs:
+ * Local Variables:
+ * mode:c
+ * indent-tabs-mode:t
+ * tab-width:4
+ * c-basic-offset:4
+ * End:
+ * For VIM:
+ * vim:set softtabstop=4 shiftwidth=4 tabstop=4 noet:
+ */
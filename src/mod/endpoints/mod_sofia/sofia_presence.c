@@ -39,6 +39,7 @@
 #include "switch_stun.h"
 
 #define SUB_OVERLAP 300
+#define HELD_NOTIFY_CHECK_USEC 100000
 struct state_helper {
 	switch_hash_t *hash;
 	sofia_profile_t *profile;
@@ -57,6 +58,9 @@ static int broadsoft_sla_notify_callback(void *pArg, int argc, char **argv, char
 static int sync_sla(sofia_profile_t *profile, const char *to_user, const char *to_host, switch_bool_t clear, switch_bool_t unseize, const char *call_id);
 static int sofia_dialog_probe_callback(void *pArg, int argc, char **argv, char **columnNames);
 static int sofia_dialog_probe_notify_callback(void *pArg, int argc, char **argv, char **columnNames);
+static int sofia_presence_store_dialog_callback(void *pArg, int argc, char **argv, char **columnNames);
+static int sofia_presence_store_sub_callback(void *pArg, int argc, char **argv, char **columnNames);
+static void send_held_notifies(void);
 
 struct pres_sql_cb {
 	sofia_profile_t *profile;
@@ -93,9 +97,24 @@ struct presence_helper {
 	switch_event_t *event;
 	switch_stream_handle_t stream;
 	char last_uuid[512];
+	char last_status[1024];
 	int hup;
 	int calls_up;
+	int coalesce;
+};
 
+/* what the presence join used to add to every subscription row, sip_presence is looked up once per watched entity */
+struct presence_store_fanout {
+	struct presence_helper *helper;
+	struct dialog_helper *dh;
+	const char *status;
+	const char *rpid;
+	const char *host;
+	char pres_key[512];
+	char pres_status[512];
+	char pres_rpid[512];
+	char pres_open_closed[128];
+	int pres_found;
 };
 
 switch_status_t sofia_presence_chat_send(switch_event_t *message_event)
@@ -826,6 +845,29 @@ static void do_normal_probe(switch_event_t *event)
 	switch_safe_free(probe_user);
 }
 
+/* lays a stored subscription out the way the probe's subscription query does */
+static int sofia_presence_store_probe_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	static char *names[] = { "call_id", "expires", "sub_to_user", "sub_to_host", "event", "version", "'full'",
+							 "full_to", "full_from", "contact", "network_ip", "network_port" };
+	char *row[12];
+
+	row[0] = argv[SOFIA_SUB_COL_CALL_ID];
+	row[1] = argv[SOFIA_SUB_COL_EXPIRES];
+	row[2] = argv[SOFIA_SUB_COL_SUB_TO_USER];
+	row[3] = argv[SOFIA_SUB_COL_SUB_TO_HOST];
+	row[4] = argv[SOFIA_SUB_COL_EVENT];
+	row[5] = argv[SOFIA_SUB_COL_VERSION];
+	row[6] = "full";
+	row[7] = argv[SOFIA_SUB_COL_FULL_TO];
+	row[8] = argv[SOFIA_SUB_COL_FULL_FROM];
+	row[9] = argv[SOFIA_SUB_COL_CONTACT];
+	row[10] = argv[SOFIA_SUB_COL_NETWORK_IP];
+	row[11] = argv[SOFIA_SUB_COL_NETWORK_PORT];
+
+	return sofia_dialog_probe_notify_callback(pArg, 12, row, names);
+}
+
 static void do_dialog_probe(switch_event_t *event)
 {
 	// Received SUBSCRIBE for "dialog" events.
@@ -917,6 +959,25 @@ static void do_dialog_probe(switch_event_t *event)
 		if (mod_sofia_globals.debug_presence > 1) {
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "%s DUMP DIALOG_PROBE set version sql:\n%s\n", profile->name, sql);
 		}
+
+		if (sofia_presence_store_enabled(profile) && !zstr(sub_call_id)) {
+			sofia_sub_match_t match = { 0 };
+
+			/* the store owns the version now, sql only has to catch up */
+			sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+
+			match.call_id = sub_call_id;
+			sofia_presence_store_sub_select(profile->pres_store, &match, SWITCH_TRUE, NULL, NULL);
+
+			/* the full state goes out below, a partial one still held for this subscriber would undo it */
+			sofia_presence_store_notify_sent(profile->pres_store, sub_call_id);
+
+			match.sub_to_user = probe_euser;
+			match.sub_to_host = probe_host;
+			sofia_presence_store_sub_select(profile->pres_store, &match, SWITCH_FALSE, sofia_presence_store_probe_callback, h4235);
+			goto probed;
+		}
+
 		sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
 		switch_safe_free(sql);
 
@@ -936,6 +997,8 @@ static void do_dialog_probe(switch_event_t *event)
 		sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_dialog_probe_notify_callback, h4235);
 		switch_safe_free(sql);
 
+	probed:
+
 		sofia_glue_release_profile(profile);
 		switch_core_hash_destroy(&h4235->hash);
 		h4235 = NULL;
@@ -947,6 +1010,29 @@ static void do_dialog_probe(switch_event_t *event)
 	switch_safe_free(probe_user);
 }
 
+/* conference subscriptions get their expiry moved or are dropped in sql, with a NULL expires they are dropped */
+static void store_conference_subs(sofia_profile_t *profile, const char *user, const char *host, const char *event_str,
+								  const char *call_id, const char *expires)
+{
+	sofia_sub_match_t match = { 0 };
+	sofia_sub_col_t set[] = { SOFIA_SUB_COL_EXPIRES };
+
+	if (!sofia_presence_store_enabled(profile)) {
+		return;
+	}
+
+	match.sub_to_user = user;
+	match.sub_to_host = host;
+	match.event = event_str;
+	match.call_id = call_id;
+
+	if (expires) {
+		sofia_presence_store_sub_update(profile->pres_store, &match, set, &expires, 1);
+	} else {
+		sofia_presence_store_sub_delete(profile->pres_store, &match);
+	}
+}
+
 static void send_conference_data(sofia_profile_t *profile, switch_event_t *event)
 {
 	char *sql;
@@ -982,6 +1068,13 @@ static void send_conference_data(sofia_profile_t *profile, switch_event_t *event
 							 from_user, from_host, event_str);
 
 		sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+
+		if (sofia_presence_store_enabled(profile)) {
+			char now_str[32];
+
+			switch_snprintf(now_str, sizeof(now_str), "%ld", (long) switch_epoch_time_now(NULL));
+			store_conference_subs(profile, from_user, from_host, event_str, NULL, now_str);
+		}
 	}
 
 	if (call_id) {
@@ -994,6 +1087,7 @@ static void send_conference_data(sofia_profile_t *profile, switch_event_t *event
 							   from_user, from_host, event_str, call_id);
 
 		  sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+		  store_conference_subs(profile, from_user, from_host, event_str, call_id, "0");
 	   }
 
 		sql = switch_mprintf("select full_to, full_from, contact %q ';_;isfocus', expires, call_id, event, network_ip, network_port, "
@@ -1015,6 +1109,7 @@ static void send_conference_data(sofia_profile_t *profile, switch_event_t *event
 							  from_user, from_host, event_str);
 
 		 sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+		 store_conference_subs(profile, from_user, from_host, event_str, NULL, "0");
 	  }
 
 		sql = switch_mprintf("select full_to, full_from, contact %q ';_;isfocus', expires, call_id, event, network_ip, network_port, "
@@ -1047,6 +1142,7 @@ static void send_conference_data(sofia_profile_t *profile, switch_event_t *event
 		}
 
 		sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+		store_conference_subs(profile, from_user, from_host, event_str, call_id, NULL);
 	}
 
 
@@ -1342,6 +1438,25 @@ static switch_event_t *actual_sofia_presence_event_handler(switch_event_t *event
 					}
 					sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
 
+					if (sofia_presence_store_enabled(profile)) {
+						sofia_dlg_match_t dmatch = { 0 };
+						sofia_dlg_col_t set[] = { SOFIA_DLG_COL_CALL_INFO, SOFIA_DLG_COL_CALL_INFO_STATE };
+						const char *vals[2];
+
+						vals[0] = call_info;
+						vals[1] = call_info_state;
+
+						if (uuid) {
+							dmatch.uuid = uuid;
+						} else {
+							dmatch.user = euser;
+							dmatch.host = host;
+							dmatch.call_info = call_info;
+						}
+
+						sofia_presence_store_dialog_update(profile->pres_store, &dmatch, set, vals, 2);
+					}
+
 
 
 					if (mod_sofia_globals.debug_sla > 1) {
@@ -1372,7 +1487,17 @@ static switch_event_t *actual_sofia_presence_event_handler(switch_event_t *event
 										 uuid, mod_sofia_globals.hostname, profile->name, euser, host, euser, host);
 				}
 
-				sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_presence_dialog_callback, &dh);
+				if (sofia_presence_store_enabled(profile)) {
+					sofia_dlg_match_t dmatch = { 0 };
+
+					dmatch.uuid_not = zstr(uuid) ? NULL : uuid;
+					dmatch.user = euser;
+					dmatch.host = host;
+					dmatch.not_seized = SWITCH_TRUE;
+					sofia_presence_store_dialog_select(profile->pres_store, &dmatch, sofia_presence_store_dialog_callback, &dh);
+				} else {
+					sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_presence_dialog_callback, &dh);
+				}
 
 				if (mod_sofia_globals.debug_presence > 0) {
 					switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "CHECK SQL: %s@%s [%s]\nhits: %d\n", euser, host, sql, dh.hits);
@@ -1435,7 +1560,12 @@ static switch_event_t *actual_sofia_presence_event_handler(switch_event_t *event
 						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "PRES SQL %s\n", sql);
 					}
 
-					sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+					if (sofia_presence_store_enabled(profile)) {
+						/* the store bumps its own copy below, sql only has to catch up */
+						sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+					} else {
+						sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+					}
 
 
 
@@ -1474,7 +1604,12 @@ static switch_event_t *actual_sofia_presence_event_handler(switch_event_t *event
 						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "PRES SQL %s\n", sql);
 					}
 
-					sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+					if (sofia_presence_store_enabled(profile)) {
+						/* the store bumps its own copy below, sql only has to catch up */
+						sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+					} else {
+						sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+					}
 
 
 					sql = switch_mprintf("select distinct sip_subscriptions.proto,sip_subscriptions.sip_user,sip_subscriptions.sip_host,"
@@ -1523,7 +1658,34 @@ static switch_event_t *actual_sofia_presence_event_handler(switch_event_t *event
 					free(buf);
 				}
 
-				sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_presence_sub_callback, &helper);
+				if (sofia_presence_store_enabled(profile)) {
+					struct presence_store_fanout fanout = { 0 };
+					sofia_sub_match_t smatch = { 0 };
+
+					fanout.helper = &helper;
+					fanout.dh = &dh;
+					fanout.status = switch_str_nil(status);
+					fanout.rpid = switch_str_nil(rpid);
+					fanout.host = host;
+
+					if (zstr(call_id)) {
+						smatch.proto = proto;
+						smatch.event = event_type;
+						smatch.alt_event = alt_event_type;
+						smatch.sub_to_user = euser;
+						smatch.hosts[0] = host;
+						smatch.hosts[1] = profile->sipip;
+						smatch.hosts[2] = profile->extsipip ? profile->extsipip : "N/A";
+					} else {
+						smatch.call_id = call_id;
+					}
+
+					helper.coalesce = 1;
+					sofia_presence_store_sub_select(profile->pres_store, &smatch, SWITCH_TRUE, sofia_presence_store_sub_callback, &fanout);
+					helper.coalesce = 0;
+				} else {
+					sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_presence_sub_callback, &helper);
+				}
 				switch_safe_free(sql);
 
 				if (mod_sofia_globals.debug_presence > 0) {
@@ -1602,6 +1764,7 @@ void *SWITCH_THREAD_FUNC sofia_presence_event_thread_run(switch_thread_t *thread
 {
 	void *pop;
 	int done = 0;
+	switch_time_t next_held_check = 0;
 
 	switch_mutex_lock(mod_sofia_globals.mutex);
 	if (!EVENT_THREAD_RUNNING) {
@@ -1620,8 +1783,19 @@ void *SWITCH_THREAD_FUNC sofia_presence_event_thread_run(switch_thread_t *thread
 
 	while (mod_sofia_globals.running == 1) {
 		int count = 0;
+		switch_status_t status;
+		switch_time_t now;
+
+		/* wake up now and then to send the NOTIFYs the presence stores held back */
+		status = switch_queue_pop_timeout(mod_sofia_globals.presence_queue, &pop, HELD_NOTIFY_CHECK_USEC);
+
+		/* walking the profiles for them is not free, do it once per check interval however busy the queue is */
+		if (sofia_presence_store_held() && (now = switch_micro_time_now()) >= next_held_check) {
+			next_held_check = now + HELD_NOTIFY_CHECK_USEC;
+			send_held_notifies();
+		}
 
-		if (switch_queue_pop(mod_sofia_globals.presence_queue, &pop) == SWITCH_STATUS_SUCCESS) {
+		if (status == SWITCH_STATUS_SUCCESS) {
 			switch_event_t *event = (switch_event_t *) pop;
 
 			if (!pop) {
@@ -2377,6 +2551,40 @@ static void _send_presence_notify(sofia_profile_t *profile,
 }
 
 
+static void send_held_notifies(void)
+{
+	switch_console_callback_match_t *matches = NULL;
+	switch_console_callback_match_node_t *m;
+	sofia_profile_t *profile;
+
+	if (list_profiles_full(NULL, NULL, &matches, SWITCH_FALSE) != SWITCH_STATUS_SUCCESS) {
+		return;
+	}
+
+	for (m = matches->head; m; m = m->next) {
+		sofia_presence_notify_t *due, *notify;
+
+		if (!(profile = sofia_glue_find_profile(m->val))) {
+			continue;
+		}
+
+		if (profile->pres_store) {
+			due = sofia_presence_store_due_notifies(profile->pres_store, switch_micro_time_now());
+
+			for (notify = due; notify; notify = notify->next) {
+				send_presence_notify(profile, notify->full_to, notify->full_from, notify->contact, notify->expires, notify->call_id,
+									 notify->event, notify->remote_ip, notify->remote_port, notify->ct, notify->pl, NULL);
+			}
+
+			sofia_presence_store_free_notify(due);
+		}
+
+		sofia_glue_release_profile(profile);
+	}
+
+	switch_console_free_matches(&matches);
+}
+
 static int sofia_dialog_probe_notify_callback(void *pArg, int argc, char **argv, char **columnNames)
 {
 	struct rfc4235_helper *sh = (struct rfc4235_helper *) pArg;
@@ -3084,6 +3292,14 @@ static int sofia_presence_sub_callback(void *pArg, int argc, char **argv, char *
 			helper->stream.write_function(&helper->stream, "update sip_dialogs set state='%q' where hostname='%q' and profile_name='%q' and uuid='%q';",
 										  astate, mod_sofia_globals.hostname, profile->name, uuid);
 			switch_copy_string(helper->last_uuid, uuid, sizeof(helper->last_uuid));
+
+			if (sofia_presence_store_enabled(profile)) {
+				sofia_dlg_match_t dmatch = { 0 };
+				sofia_dlg_col_t set[] = { SOFIA_DLG_COL_STATE };
+
+				dmatch.uuid = uuid;
+				sofia_presence_store_dialog_update(profile->pres_store, &dmatch, set, &astate, 1);
+			}
 		}
 
 		if (zstr(astate)) astate = "";
@@ -3218,10 +3434,48 @@ static int sofia_presence_sub_callback(void *pArg, int argc, char **argv, char *
 		const char *register_source = switch_event_get_header_nil(helper->event, "register-source");
 
 		if (!zstr(uuid) && strchr(uuid, '-') && !zstr(status_line) && !zstr(rpid) && (zstr(register_source) || strcasecmp(register_source, "register"))) {
-			char *sql = switch_mprintf("update sip_dialogs set rpid='%q',status='%q' where hostname='%q' and profile_name='%q' and uuid='%q'",
-									   rpid, status_line,
-									   mod_sofia_globals.hostname, profile->name, uuid);
-			sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+			char last_status[1024];
+
+			/* every watcher of the channel would write the same row again */
+			switch_snprintf(last_status, sizeof(last_status), "%s|%s|%s", uuid, rpid, status_line);
+
+			if (strcmp(helper->last_status, last_status)) {
+				char *sql = switch_mprintf("update sip_dialogs set rpid='%q',status='%q' where hostname='%q' and profile_name='%q' and uuid='%q'",
+										   rpid, status_line,
+										   mod_sofia_globals.hostname, profile->name, uuid);
+				sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+				switch_copy_string(helper->last_status, last_status, sizeof(helper->last_status));
+
+				if (sofia_presence_store_enabled(profile)) {
+					sofia_dlg_match_t dmatch = { 0 };
+					sofia_dlg_col_t set[] = { SOFIA_DLG_COL_RPID, SOFIA_DLG_COL_STATUS };
+					const char *vals[2];
+
+					vals[0] = rpid;
+					vals[1] = status_line;
+					dmatch.uuid = uuid;
+					sofia_presence_store_dialog_update(profile->pres_store, &dmatch, set, vals, 2);
+				}
+			}
+		}
+	}
+
+	if (helper->coalesce) {
+		sofia_presence_notify_t notify = { 0 };
+
+		notify.full_to = full_to;
+		notify.full_from = full_from;
+		notify.contact = contact;
+		notify.expires = expires;
+		notify.call_id = call_id;
+		notify.event = event;
+		notify.remote_ip = ip;
+		notify.remote_port = port;
+		notify.ct = (char *) ct;
+		notify.pl = pl;
+
+		if (sofia_presence_store_hold_notify(profile->pres_store, &notify, (switch_interval_time_t) profile->presence_notify_interval * 1000)) {
+			goto end;
 		}
 	}
 
@@ -3244,6 +3498,72 @@ static int sofia_presence_sub_callback(void *pArg, int argc, char **argv, char *
 	return 0;
 }
 
+static int sofia_presence_store_dialog_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	return sofia_presence_dialog_callback(pArg, 5, argv, columnNames);
+}
+
+static int sofia_presence_store_presence_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	struct presence_store_fanout *fanout = (struct presence_store_fanout *) pArg;
+
+	switch_copy_string(fanout->pres_status, switch_str_nil(argv[0]), sizeof(fanout->pres_status));
+	switch_copy_string(fanout->pres_rpid, switch_str_nil(argv[1]), sizeof(fanout->pres_rpid));
+	switch_copy_string(fanout->pres_open_closed, switch_str_nil(argv[2]), sizeof(fanout->pres_open_closed));
+	fanout->pres_found = 1;
+
+	return 1;
+}
+
+/* lays a stored subscription out the way the presence join did and hands it to the usual row callback */
+static int sofia_presence_store_sub_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	static char *names[] = {
+		"proto", "sip_user", "sip_host", "sub_to_user", "sub_to_host", "event", "contact", "call_id", "full_from", "full_via",
+		"expires", "user_agent", "accept", "profile_name", "status", "rpid", "host", "status", "rpid", "open_closed",
+		"dialog_status", "dialog_rpid", "version", "presence_id", "orig_proto", "full_to", "network_ip", "network_port"
+	};
+	struct presence_store_fanout *fanout = (struct presence_store_fanout *) pArg;
+	sofia_profile_t *profile = fanout->helper->profile;
+	char key[512];
+	char *row[28];
+	int i;
+
+	switch_snprintf(key, sizeof(key), "%s@%s", argv[SOFIA_SUB_COL_SUB_TO_USER], argv[SOFIA_SUB_COL_SUB_TO_HOST]);
+
+	if (strcmp(fanout->pres_key, key)) {
+		char *sql = switch_mprintf("select status,rpid,open_closed from sip_presence where sip_user='%q' and sip_host='%q' and "
+								   "profile_name='%q' and hostname='%q'",
+								   argv[SOFIA_SUB_COL_SUB_TO_USER], argv[SOFIA_SUB_COL_SUB_TO_HOST], profile->name, mod_sofia_globals.hostname);
+
+		switch_copy_string(fanout->pres_key, key, sizeof(fanout->pres_key));
+		fanout->pres_found = 0;
+		sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_presence_store_presence_callback, fanout);
+		switch_safe_free(sql);
+	}
+
+	for (i = 0; i <= SOFIA_SUB_COL_PROFILE_NAME; i++) {
+		row[i] = argv[i];
+	}
+
+	row[14] = (char *) fanout->status;
+	row[15] = (char *) fanout->rpid;
+	row[16] = (char *) fanout->host;
+	row[17] = fanout->pres_found ? fanout->pres_status : NULL;
+	row[18] = fanout->pres_found ? fanout->pres_rpid : NULL;
+	row[19] = fanout->pres_found ? fanout->pres_open_closed : NULL;
+	row[20] = fanout->dh->status;
+	row[21] = fanout->dh->rpid;
+	row[22] = argv[SOFIA_SUB_COL_VERSION];
+	row[23] = fanout->dh->presence_id;
+	row[24] = argv[SOFIA_SUB_COL_ORIG_PROTO];
+	row[25] = argv[SOFIA_SUB_COL_FULL_TO];
+	row[26] = argv[SOFIA_SUB_COL_NETWORK_IP];
+	row[27] = argv[SOFIA_SUB_COL_NETWORK_PORT];
+
+	return sofia_presence_sub_callback(fanout->helper, 28, row, names);
+}
+
 static int sofia_presence_mwi_callback(void *pArg, int argc, char **argv, char **columnNames)
 {
 	//char *sub_to_user = argv[3];
@@ -3935,6 +4255,30 @@ void sofia_presence_handle_sip_i_subscribe(int status,
 		}
 
 		sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+
+		if (sofia_presence_store_enabled(profile)) {
+			sofia_sub_match_t match = { 0 };
+			sofia_sub_col_t set[] = { SOFIA_SUB_COL_EXPIRES, SOFIA_SUB_COL_NETWORK_IP, SOFIA_SUB_COL_NETWORK_PORT, SOFIA_SUB_COL_SIP_USER,
+									  SOFIA_SUB_COL_SIP_HOST, SOFIA_SUB_COL_FULL_VIA, SOFIA_SUB_COL_FULL_TO, SOFIA_SUB_COL_FULL_FROM, SOFIA_SUB_COL_CONTACT };
+			const char *vals[9];
+			char expires_str[32], port_str[16];
+
+			switch_snprintf(expires_str, sizeof(expires_str), "%ld", (long) switch_epoch_time_now(NULL) + exp_delta);
+			switch_snprintf(port_str, sizeof(port_str), "%d", np.network_port);
+
+			vals[0] = expires_str;
+			vals[1] = np.network_ip;
+			vals[2] = port_str;
+			vals[3] = from_user;
+			vals[4] = from_host;
+			vals[5] = full_via;
+			vals[6] = full_to;
+			vals[7] = full_from;
+			vals[8] = contact;
+
+			match.call_id = call_id;
+			sofia_presence_store_sub_update(profile->pres_store, &match, set, vals, 9);
+		}
 	} else {
 
 		if (sub_state == nua_substate_terminated) {
@@ -3948,6 +4292,14 @@ void sofia_presence_handle_sip_i_subscribe(int status,
 
 			switch_assert(sql != NULL);
 			sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+
+			if (sofia_presence_store_enabled(profile)) {
+				sofia_sub_match_t match = { 0 };
+
+				match.call_id = call_id;
+				sofia_presence_store_sub_delete(profile->pres_store, &match);
+			}
+
 			sstr = switch_mprintf("terminated;reason=noresource");
 
 		} else {
@@ -3982,6 +4334,12 @@ void sofia_presence_handle_sip_i_subscribe(int status,
 
 
 			sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+
+			if (sofia_presence_store_enabled(profile) && (zstr(event) || strcmp(event, "line-seize"))) {
+				sofia_presence_store_subscribe(profile, proto, orig_proto, from_user, from_host, to_user, to_host, event, contact_str, call_id,
+											   full_from, full_via, full_to, use_to_tag, full_agent, accept_header, &np, switch_epoch_time_now(NULL) + exp_delta);
+			}
+
 			sstr = switch_mprintf("active;expires=%ld", exp_delta);
 		}
 
@@ -5075,6 +5433,7 @@ void sofia_presence_check_subscriptions(sofia_profile_t *profile, time_t now)
 
 	if (now) {
 		struct pres_sql_cb cb = {profile, 0};
+		sofia_sub_match_t match = { 0 };
 
 		if (profile->pres_type != PRES_TYPE_FULL) {
 			if (mod_sofia_globals.debug_presence > 0) {
@@ -5090,6 +5449,11 @@ void sofia_presence_check_subscriptions(sofia_profile_t *profile, time_t now)
 		sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
 		switch_safe_free(sql);
 
+		if (sofia_presence_store_enabled(profile)) {
+			match.expired_by = now;
+			sofia_presence_store_sub_select(profile->pres_store, &match, SWITCH_TRUE, NULL, NULL);
+		}
+
 		sql = switch_mprintf("select full_to, full_from, contact, -1, call_id, event, network_ip, network_port, "
 							 "NULL as ct, NULL as pt "
 							 " from sip_subscriptions where ((expires > 0 and expires <= %ld)) and profile_name='%q' and hostname='%q'",
@@ -5109,6 +5473,10 @@ void sofia_presence_check_subscriptions(sofia_profile_t *profile, time_t now)
 			}
 
 			sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+
+			if (sofia_presence_store_enabled(profile)) {
+				sofia_presence_store_sub_delete(profile->pres_store, &match);
+			}
 		}
 	}
 
@@ -5116,6 +5484,75 @@ void sofia_presence_check_subscriptions(sofia_profile_t *profile, time_t now)
 
 }
 
+static int sofia_presence_store_load_sub_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	sofia_presence_store_sub_insert((sofia_presence_store_t *) pArg, (const char *const *) argv);
+	return 0;
+}
+
+static int sofia_presence_store_load_dialog_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	sofia_presence_store_dialog_insert((sofia_presence_store_t *) pArg, (const char *const *) argv);
+	return 0;
+}
+
+/* mirrors the sip_subscriptions row a SUBSCRIBE or an implied REFER subscription just wrote */
+void sofia_presence_store_subscribe(sofia_profile_t *profile, const char *proto, const char *orig_proto, const char *from_user, const char *from_host,
+									const char *to_user, const char *to_host, const char *event, const char *contact, const char *call_id,
+									const char *full_from, const char *full_via, const char *full_to, const char *to_tag,
+									const char *user_agent, const char *accept, sofia_nat_parse_t *np, time_t expires)
+{
+	const char *cols[SOFIA_SUB_COL_MAX] = { 0 };
+	char expires_str[32], port_str[16];
+	char *to_tagged = switch_mprintf("%s;tag=%s", full_to, to_tag);
+
+	switch_snprintf(expires_str, sizeof(expires_str), "%ld", (long) expires);
+	switch_snprintf(port_str, sizeof(port_str), "%d", np->network_port);
+
+	cols[SOFIA_SUB_COL_PROTO] = proto;
+	cols[SOFIA_SUB_COL_SIP_USER] = from_user;
+	cols[SOFIA_SUB_COL_SIP_HOST] = from_host;
+	cols[SOFIA_SUB_COL_SUB_TO_USER] = to_user;
+	cols[SOFIA_SUB_COL_SUB_TO_HOST] = to_host;
+	cols[SOFIA_SUB_COL_PRESENCE_HOSTS] = profile->presence_hosts;
+	cols[SOFIA_SUB_COL_EVENT] = event;
+	cols[SOFIA_SUB_COL_CONTACT] = contact;
+	cols[SOFIA_SUB_COL_CALL_ID] = call_id;
+	cols[SOFIA_SUB_COL_FULL_FROM] = full_from;
+	cols[SOFIA_SUB_COL_FULL_VIA] = full_via;
+	cols[SOFIA_SUB_COL_EXPIRES] = expires_str;
+	cols[SOFIA_SUB_COL_USER_AGENT] = user_agent;
+	cols[SOFIA_SUB_COL_ACCEPT] = accept;
+	cols[SOFIA_SUB_COL_PROFILE_NAME] = profile->name;
+	cols[SOFIA_SUB_COL_NETWORK_PORT] = port_str;
+	cols[SOFIA_SUB_COL_NETWORK_IP] = np->network_ip;
+	cols[SOFIA_SUB_COL_VERSION] = "-1";
+	cols[SOFIA_SUB_COL_ORIG_PROTO] = orig_proto;
+	cols[SOFIA_SUB_COL_FULL_TO] = to_tagged;
+
+	sofia_presence_store_sub_insert(profile->pres_store, cols);
+	switch_safe_free(to_tagged);
+}
+
+/* subscriptions outlive a restart in sql, pick them and any dialogs up before the profile takes requests */
+void sofia_presence_store_load(sofia_profile_t *profile)
+{
+	char *sql;
+
+	sql = switch_mprintf("select proto,sip_user,sip_host,sub_to_user,sub_to_host,event,contact,call_id,full_from,full_via,"
+						 "expires,user_agent,accept,profile_name,presence_hosts,version,orig_proto,full_to,network_ip,network_port "
+						 "from sip_subscriptions where hostname='%q' and profile_name='%q' and event != 'line-seize'",
+						 mod_sofia_globals.hostname, profile->name);
+	sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_presence_store_load_sub_callback, profile->pres_store);
+	switch_safe_free(sql);
+
+	sql = switch_mprintf("select state,status,rpid,presence_id,uuid,call_id,sip_from_user,sip_from_host,call_info,call_info_state,rcd "
+						 "from sip_dialogs where hostname='%q' and profile_name='%q' and call_info_state != 'seized'",
+						 mod_sofia_globals.hostname, profile->name);
+	sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_presence_store_load_dialog_callback, profile->pres_store);
+	switch_safe_free(sql);
+}
+
 
 /* For Emacs:
  * Local Variables:
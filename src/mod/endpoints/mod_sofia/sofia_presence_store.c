@@ -0,0 +1,1141 @@
+/*
+ * FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ * Copyright (C) 2005-2014, Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Version: MPL 1.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ *
+ * The Initial Developer of the Original Code is
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Portions created by the Initial Developer are Copyright (C)
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Anthony Minessale II <anthm@freeswitch.org>
+ *
+ *
+ * sofia_presence_store.c -- SOFIA SIP Endpoint (in memory subscription and dialog store)
+ *
+ */
+#include "mod_sofia.h"
+
+#define PRES_IDX_MAX 4
+#define PRES_COL_MAX SOFIA_SUB_COL_MAX
+
+typedef enum {
+	SUB_IDX_CALL_ID,
+	SUB_IDX_TO_USER,
+	SUB_IDX_MAX
+} sub_idx_t;
+
+typedef enum {
+	DLG_IDX_UUID,
+	DLG_IDX_CALL_ID,
+	DLG_IDX_FROM,
+	DLG_IDX_PRESENCE,
+	DLG_IDX_MAX
+} dlg_idx_t;
+
+typedef struct pres_entry_s {
+	char *col[PRES_COL_MAX];
+	char *key[PRES_IDX_MAX];
+	struct pres_entry_s *inext[PRES_IDX_MAX];
+	struct pres_entry_s *iprev[PRES_IDX_MAX];
+	struct pres_entry_s *next;
+	struct pres_entry_s *prev;
+	struct pres_entry_s *work;
+	/* subscriptions only, the NOTIFY held back for this subscriber and when it was last sent one */
+	sofia_presence_notify_t *pending;
+	struct pres_entry_s *pnext;
+	struct pres_entry_s *pprev;
+	switch_time_t last_notify;
+	uint64_t seq;
+} pres_entry_t;
+
+typedef struct pres_row_s {
+	char *col[PRES_COL_MAX];
+	time_t rcd;
+	uint64_t seq;
+	struct pres_row_s *next;
+} pres_row_t;
+
+typedef char *(*pres_key_func_t)(int idx, char *const *col, char *buf, switch_size_t len);
+
+typedef struct {
+	int ncols;
+	int nidx;
+	char **col_names;
+	pres_key_func_t key_func;
+	switch_hash_t *index[PRES_IDX_MAX];
+	pres_entry_t *head;
+	uint32_t count;
+	uint64_t inserts;
+	uint64_t deletes;
+} pres_table_t;
+
+struct sofia_presence_store {
+	switch_thread_rwlock_t *rwlock;
+	pres_table_t subs;
+	pres_table_t dialogs;
+	pres_entry_t *pending;
+	uint32_t pending_count;
+	uint64_t seq;
+	uint64_t fanouts;
+	uint64_t notifies_held;
+	uint64_t notifies_coalesced;
+	uint64_t notifies_flushed;
+};
+
+static switch_atomic_t HELD_NOTIFIES = 0;
+
+static char *sub_col_names[] = {
+	"proto", "sip_user", "sip_host", "sub_to_user", "sub_to_host", "event", "contact", "call_id", "full_from", "full_via",
+	"expires", "user_agent", "accept", "profile_name", "presence_hosts", "version", "orig_proto", "full_to", "network_ip", "network_port"
+};
+
+static char *dlg_col_names[] = {
+	"state", "status", "rpid", "presence_id", "uuid", "call_id", "sip_from_user", "sip_from_host", "call_info", "call_info_state", "rcd"
+};
+
+static char *sub_index_key(int idx, char *const *col, char *buf, switch_size_t len)
+{
+	switch (idx) {
+	case SUB_IDX_CALL_ID:
+		return col[SOFIA_SUB_COL_CALL_ID];
+	case SUB_IDX_TO_USER:
+		return col[SOFIA_SUB_COL_SUB_TO_USER];
+	default:
+		return NULL;
+	}
+}
+
+static char *dlg_index_key(int idx, char *const *col, char *buf, switch_size_t len)
+{
+	switch (idx) {
+	case DLG_IDX_UUID:
+		return col[SOFIA_DLG_COL_UUID];
+	case DLG_IDX_CALL_ID:
+		return col[SOFIA_DLG_COL_CALL_ID];
+	case DLG_IDX_FROM:
+		if (zstr(col[SOFIA_DLG_COL_SIP_FROM_USER])) {
+			return NULL;
+		}
+		switch_snprintf(buf, len, "%s@%s", col[SOFIA_DLG_COL_SIP_FROM_USER], col[SOFIA_DLG_COL_SIP_FROM_HOST]);
+		return buf;
+	case DLG_IDX_PRESENCE:
+		return col[SOFIA_DLG_COL_PRESENCE_ID];
+	default:
+		return NULL;
+	}
+}
+
+static void pres_index_link(pres_table_t *table, pres_entry_t *entry, int idx)
+{
+	char buf[512];
+	char *key = table->key_func(idx, entry->col, buf, sizeof(buf));
+	pres_entry_t *head;
+
+	if (zstr(key)) {
+		return;
+	}
+
+	entry->key[idx] = strdup(key);
+	head = switch_core_hash_find(table->index[idx], key);
+
+	entry->iprev[idx] = NULL;
+	entry->inext[idx] = head;
+
+	if (head) {
+		head->iprev[idx] = entry;
+	}
+
+	switch_core_hash_insert(table->index[idx], key, entry);
+}
+
+static void pres_index_unlink(pres_table_t *table, pres_entry_t *entry, int idx)
+{
+	if (!entry->key[idx]) {
+		return;
+	}
+
+	if (entry->iprev[idx]) {
+		entry->iprev[idx]->inext[idx] = entry->inext[idx];
+	} else if (entry->inext[idx]) {
+		switch_core_hash_insert(table->index[idx], entry->key[idx], entry->inext[idx]);
+	} else {
+		switch_core_hash_delete(table->index[idx], entry->key[idx]);
+	}
+
+	if (entry->inext[idx]) {
+		entry->inext[idx]->iprev[idx] = entry->iprev[idx];
+	}
+
+	entry->inext[idx] = entry->iprev[idx] = NULL;
+	switch_safe_free(entry->key[idx]);
+}
+
+static void pres_notify_unhold(sofia_presence_store_t *store, pres_entry_t *entry)
+{
+	if (!entry->pending) {
+		return;
+	}
+
+	if (entry->pprev) {
+		entry->pprev->pnext = entry->pnext;
+	} else {
+		store->pending = entry->pnext;
+	}
+
+	if (entry->pnext) {
+		entry->pnext->pprev = entry->pprev;
+	}
+
+	entry->pnext = entry->pprev = NULL;
+	entry->pending = NULL;
+	store->pending_count--;
+	switch_atomic_dec(&HELD_NOTIFIES);
+}
+
+static void pres_notify_drop(sofia_presence_store_t *store, pres_entry_t *entry)
+{
+	sofia_presence_notify_t *notify = entry->pending;
+
+	if (notify) {
+		pres_notify_unhold(store, entry);
+		sofia_presence_store_free_notify(notify);
+	}
+}
+
+static pres_entry_t *pres_entry_new(sofia_presence_store_t *store, pres_table_t *table, const char *const *cols)
+{
+	pres_entry_t *entry;
+	int i;
+
+	switch_zmalloc(entry, sizeof(*entry));
+
+	for (i = 0; i < table->ncols; i++) {
+		entry->col[i] = strdup(cols[i] ? cols[i] : "");
+	}
+
+	for (i = 0; i < table->nidx; i++) {
+		pres_index_link(table, entry, i);
+	}
+
+	entry->seq = ++store->seq;
+	entry->next = table->head;
+	if (table->head) {
+		table->head->prev = entry;
+	}
+	table->head = entry;
+
+	table->count++;
+	table->inserts++;
+
+	return entry;
+}
+
+static void pres_entry_unlink(sofia_presence_store_t *store, pres_table_t *table, pres_entry_t *entry)
+{
+	int i;
+
+	for (i = 0; i < table->nidx; i++) {
+		pres_index_unlink(table, entry, i);
+	}
+
+	if (entry->prev) {
+		entry->prev->next = entry->next;
+	} else {
+		table->head = entry->next;
+	}
+
+	if (entry->next) {
+		entry->next->prev = entry->prev;
+	}
+
+	entry->next = entry->prev = NULL;
+	table->count--;
+	table->deletes++;
+}
+
+static void pres_entry_free(sofia_presence_store_t *store, pres_table_t *table, pres_entry_t *entry)
+{
+	int i;
+
+	pres_notify_drop(store, entry);
+
+	for (i = 0; i < table->ncols; i++) {
+		switch_safe_free(entry->col[i]);
+	}
+
+	free(entry);
+}
+
+static void pres_entry_set(pres_table_t *table, pres_entry_t *entry, const int *set, const char *const *vals, int nset)
+{
+	int i, x;
+
+	for (i = 0; i < table->nidx; i++) {
+		pres_index_unlink(table, entry, i);
+	}
+
+	for (x = 0; x < nset; x++) {
+		switch_safe_free(entry->col[set[x]]);
+		entry->col[set[x]] = strdup(vals[x] ? vals[x] : "");
+	}
+
+	for (i = 0; i < table->nidx; i++) {
+		pres_index_link(table, entry, i);
+	}
+}
+
+static pres_row_t *pres_row_dup(pres_table_t *table, pres_entry_t *entry)
+{
+	switch_size_t len[PRES_COL_MAX], total = sizeof(pres_row_t);
+	pres_row_t *row;
+	char *p;
+	int i;
+
+	for (i = 0; i < table->ncols; i++) {
+		len[i] = strlen(entry->col[i]) + 1;
+		total += len[i];
+	}
+
+	switch_zmalloc(row, total);
+	p = (char *) (row + 1);
+
+	for (i = 0; i < table->ncols; i++) {
+		memcpy(p, entry->col[i], len[i]);
+		row->col[i] = p;
+		p += len[i];
+	}
+
+	row->seq = entry->seq;
+
+	return row;
+}
+
+static int pres_like(const char *str, const char *needle)
+{
+	return !zstr(str) && switch_stristr(needle, str) != NULL;
+}
+
+static int sub_entry_match(pres_entry_t *entry, const sofia_sub_match_t *match)
+{
+	char **col = entry->col;
+
+	if (!match) {
+		return 1;
+	}
+
+	if (match->call_id && strcmp(col[SOFIA_SUB_COL_CALL_ID], match->call_id)) {
+		return 0;
+	}
+
+	if (match->proto && strcmp(col[SOFIA_SUB_COL_PROTO], match->proto)) {
+		return 0;
+	}
+
+	if (match->sub_to_user && strcmp(col[SOFIA_SUB_COL_SUB_TO_USER], match->sub_to_user)) {
+		return 0;
+	}
+
+	if (match->sub_to_host && strcmp(col[SOFIA_SUB_COL_SUB_TO_HOST], match->sub_to_host)) {
+		return 0;
+	}
+
+	if (match->hosts[0]) {
+		int i, hit = 0;
+
+		for (i = 0; i < 3 && !hit; i++) {
+			hit = match->hosts[i] && !strcmp(col[SOFIA_SUB_COL_SUB_TO_HOST], match->hosts[i]);
+		}
+
+		if (!hit && !pres_like(col[SOFIA_SUB_COL_PRESENCE_HOSTS], match->hosts[0])) {
+			return 0;
+		}
+	}
+
+	if (match->event && strcmp(col[SOFIA_SUB_COL_EVENT], match->event) &&
+		(!match->alt_event || strcmp(col[SOFIA_SUB_COL_EVENT], match->alt_event))) {
+		return 0;
+	}
+
+	if (match->expired_by) {
+		long expires = atol(col[SOFIA_SUB_COL_EXPIRES]);
+
+		if (expires <= 0 || expires > (long) match->expired_by) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static int dlg_entry_match(pres_entry_t *entry, const sofia_dlg_match_t *match)
+{
+	char **col = entry->col;
+
+	if (!match) {
+		return 1;
+	}
+
+	if (match->uuid && strcmp(col[SOFIA_DLG_COL_UUID], match->uuid)) {
+		return 0;
+	}
+
+	if (match->uuid_not && !strcmp(col[SOFIA_DLG_COL_UUID], match->uuid_not)) {
+		return 0;
+	}
+
+	if (match->call_id && strcmp(col[SOFIA_DLG_COL_CALL_ID], match->call_id)) {
+		return 0;
+	}
+
+	if (match->user && match->host) {
+		char buf[512];
+
+		switch_snprintf(buf, sizeof(buf), "%s@%s", match->user, match->host);
+
+		if ((strcmp(col[SOFIA_DLG_COL_SIP_FROM_USER], match->user) || strcmp(col[SOFIA_DLG_COL_SIP_FROM_HOST], match->host)) &&
+			strcmp(col[SOFIA_DLG_COL_PRESENCE_ID], buf)) {
+			return 0;
+		}
+	}
+
+	if (match->call_info && strcmp(col[SOFIA_DLG_COL_CALL_INFO], match->call_info)) {
+		return 0;
+	}
+
+	if (match->call_info_state && strcmp(col[SOFIA_DLG_COL_CALL_INFO_STATE], match->call_info_state)) {
+		return 0;
+	}
+
+	if (match->not_seized && !strcmp(col[SOFIA_DLG_COL_CALL_INFO_STATE], "seized")) {
+		return 0;
+	}
+
+	return 1;
+}
+
+/* chain every matching subscription on work, off the narrowest index the match allows */
+static pres_entry_t *sub_collect(sofia_presence_store_t *store, const sofia_sub_match_t *match)
+{
+	pres_entry_t *entry, *hit = NULL;
+	int idx = SUB_IDX_MAX;
+
+	if (match && match->call_id) {
+		idx = SUB_IDX_CALL_ID;
+		entry = switch_core_hash_find(store->subs.index[idx], match->call_id);
+	} else if (match && match->sub_to_user) {
+		idx = SUB_IDX_TO_USER;
+		entry = switch_core_hash_find(store->subs.index[idx], match->sub_to_user);
+	} else {
+		entry = store->subs.head;
+	}
+
+	for (; entry; entry = idx == SUB_IDX_MAX ? entry->next : entry->inext[idx]) {
+		if (sub_entry_match(entry, match)) {
+			entry->work = hit;
+			hit = entry;
+		}
+	}
+
+	return hit;
+}
+
+/* a dialog belongs to an entity by its from user and host or by its presence id, so that match walks both chains */
+static pres_entry_t *dlg_collect(sofia_presence_store_t *store, const sofia_dlg_match_t *match)
+{
+	pres_entry_t *entry, *hit = NULL;
+	char key[512] = "";
+	int idx, pass, passes = 1;
+
+	if (match && match->uuid) {
+		idx = DLG_IDX_UUID;
+		entry = switch_core_hash_find(store->dialogs.index[idx], match->uuid);
+	} else if (match && match->call_id) {
+		idx = DLG_IDX_CALL_ID;
+		entry = switch_core_hash_find(store->dialogs.index[idx], match->call_id);
+	} else if (match && match->user && match->host) {
+		switch_snprintf(key, sizeof(key), "%s@%s", match->user, match->host);
+		idx = DLG_IDX_FROM;
+		entry = switch_core_hash_find(store->dialogs.index[idx], key);
+		passes = 2;
+	} else {
+		idx = DLG_IDX_MAX;
+		entry = store->dialogs.head;
+	}
+
+	for (pass = 0; pass < passes; pass++) {
+		if (pass) {
+			idx = DLG_IDX_PRESENCE;
+			entry = switch_core_hash_find(store->dialogs.index[idx], key);
+		}
+
+		for (; entry; entry = idx == DLG_IDX_MAX ? entry->next : entry->inext[idx]) {
+			if (pass && entry->key[DLG_IDX_FROM] && !strcmp(entry->key[DLG_IDX_FROM], key)) {
+				continue;
+			}
+
+			if (dlg_entry_match(entry, match)) {
+				entry->work = hit;
+				hit = entry;
+			}
+		}
+	}
+
+	return hit;
+}
+
+static void pres_table_init(pres_table_t *table, int ncols, int nidx, char **col_names, pres_key_func_t key_func)
+{
+	int i;
+
+	table->ncols = ncols;
+	table->nidx = nidx;
+	table->col_names = col_names;
+	table->key_func = key_func;
+
+	for (i = 0; i < nidx; i++) {
+		switch_core_hash_init(&table->index[i]);
+	}
+}
+
+static void pres_table_destroy(sofia_presence_store_t *store, pres_table_t *table)
+{
+	pres_entry_t *entry;
+	int i;
+
+	while ((entry = table->head)) {
+		pres_entry_unlink(store, table, entry);
+		pres_entry_free(store, table, entry);
+	}
+
+	for (i = 0; i < table->nidx; i++) {
+		switch_core_hash_destroy(&table->index[i]);
+	}
+}
+
+switch_status_t sofia_presence_store_create(sofia_presence_store_t **store, switch_memory_pool_t *pool)
+{
+	sofia_presence_store_t *new_store;
+
+	new_store = switch_core_alloc(pool, sizeof(*new_store));
+
+	switch_thread_rwlock_create(&new_store->rwlock, pool);
+	pres_table_init(&new_store->subs, SOFIA_SUB_COL_MAX, SUB_IDX_MAX, sub_col_names, sub_index_key);
+	pres_table_init(&new_store->dialogs, SOFIA_DLG_COL_MAX, DLG_IDX_MAX, dlg_col_names, dlg_index_key);
+
+	*store = new_store;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+void sofia_presence_store_destroy(sofia_presence_store_t **store)
+{
+	sofia_presence_store_t *s = *store;
+
+	if (!s) {
+		return;
+	}
+
+	*store = NULL;
+
+	switch_thread_rwlock_wrlock(s->rwlock);
+	pres_table_destroy(s, &s->subs);
+	pres_table_destroy(s, &s->dialogs);
+	switch_thread_rwlock_unlock(s->rwlock);
+}
+
+/* a new subscription takes over any left under the same call-id, the way a re-SUBSCRIBE replaces its row */
+void sofia_presence_store_sub_insert(sofia_presence_store_t *store, const char *const *cols)
+{
+	pres_entry_t *entry, *next;
+	sofia_sub_match_t match = { 0 };
+
+	match.call_id = cols[SOFIA_SUB_COL_CALL_ID] ? cols[SOFIA_SUB_COL_CALL_ID] : "";
+
+	switch_thread_rwlock_wrlock(store->rwlock);
+
+	for (entry = sub_collect(store, &match); entry; entry = next) {
+		next = entry->work;
+		pres_entry_unlink(store, &store->subs, entry);
+		pres_entry_free(store, &store->subs, entry);
+	}
+
+	pres_entry_new(store, &store->subs, cols);
+
+	switch_thread_rwlock_unlock(store->rwlock);
+}
+
+uint32_t sofia_presence_store_sub_update(sofia_presence_store_t *store, const sofia_sub_match_t *match, const sofia_sub_col_t *set, const char *const *vals, int nset)
+{
+	pres_entry_t *entry, *next;
+	int iset[SOFIA_SUB_COL_MAX];
+	uint32_t count = 0;
+	int x;
+
+	for (x = 0; x < nset && x < SOFIA_SUB_COL_MAX; x++) {
+		iset[x] = set[x];
+	}
+
+	switch_thread_rwlock_wrlock(store->rwlock);
+
+	/* collect first, rewriting an indexed column moves the entry to another chain */
+	for (entry = sub_collect(store, match); entry; entry = next) {
+		next = entry->work;
+		entry->work = NULL;
+		pres_entry_set(&store->subs, entry, iset, vals, x);
+		count++;
+	}
+
+	switch_thread_rwlock_unlock(store->rwlock);
+
+	return count;
+}
+
+/* with bump set every match gets its version raised first, the way the fan-out did it in sql before selecting,
+   the callback gets copies after the lock is dropped so it may send requests and touch the store */
+uint32_t sofia_presence_store_sub_select(sofia_presence_store_t *store, const sofia_sub_match_t *match, switch_bool_t bump,
+										 switch_core_db_callback_func_t callback, void *pArg)
+{
+	pres_entry_t *entry, *next;
+	pres_row_t *rows = NULL, *row;
+	uint32_t count = 0;
+
+	if (bump) {
+		switch_thread_rwlock_wrlock(store->rwlock);
+		store->fanouts++;
+	} else {
+		switch_thread_rwlock_rdlock(store->rwlock);
+	}
+
+	for (entry = sub_collect(store, match); entry; entry = next) {
+		next = entry->work;
+		entry->work = NULL;
+
+		if (bump) {
+			char version[32];
+
+			switch_snprintf(version, sizeof(version), "%d", atoi(entry->col[SOFIA_SUB_COL_VERSION]) + 1);
+			switch_safe_free(entry->col[SOFIA_SUB_COL_VERSION]);
+			entry->col[SOFIA_SUB_COL_VERSION] = strdup(version);
+		}
+
+		if (callback) {
+			row = pres_row_dup(&store->subs, entry);
+			row->next = rows;
+			rows = row;
+		}
+
+		count++;
+	}
+
+	switch_thread_rwlock_unlock(store->rwlock);
+
+	while ((row = rows)) {
+		rows = row->next;
+
+		if (callback(pArg, SOFIA_SUB_COL_MAX, row->col, sub_col_names)) {
+			while ((row = rows)) {
+				rows = row->next;
+				free(row);
+			}
+			break;
+		}
+
+		free(row);
+	}
+
+	return count;
+}
+
+uint32_t sofia_presence_store_sub_delete(sofia_presence_store_t *store, const sofia_sub_match_t *match)
+{
+	pres_entry_t *entry, *next;
+	uint32_t count = 0;
+
+	switch_thread_rwlock_wrlock(store->rwlock);
+
+	for (entry = sub_collect(store, match); entry; entry = next) {
+		next = entry->work;
+		pres_entry_unlink(store, &store->subs, entry);
+		pres_entry_free(store, &store->subs, entry);
+		count++;
+	}
+
+	switch_thread_rwlock_unlock(store->rwlock);
+
+	return count;
+}
+
+void sofia_presence_store_dialog_insert(sofia_presence_store_t *store, const char *const *cols)
+{
+	switch_thread_rwlock_wrlock(store->rwlock);
+	pres_entry_new(store, &store->dialogs, cols);
+	switch_thread_rwlock_unlock(store->rwlock);
+}
+
+uint32_t sofia_presence_store_dialog_update(sofia_presence_store_t *store, const sofia_dlg_match_t *match, const sofia_dlg_col_t *set, const char *const *vals, int nset)
+{
+	pres_entry_t *entry, *next;
+	int iset[SOFIA_DLG_COL_MAX];
+	uint32_t count = 0;
+	int x;
+
+	for (x = 0; x < nset && x < SOFIA_DLG_COL_MAX; x++) {
+		iset[x] = set[x];
+	}
+
+	switch_thread_rwlock_wrlock(store->rwlock);
+
+	for (entry = dlg_collect(store, match); entry; entry = next) {
+		next = entry->work;
+		entry->work = NULL;
+		pres_entry_set(&store->dialogs, entry, iset, vals, x);
+		count++;
+	}
+
+	switch_thread_rwlock_unlock(store->rwlock);
+
+	return count;
+}
+
+static int dlg_row_cmp(const void *a, const void *b)
+{
+	const pres_row_t *ra = *(const pres_row_t **) a;
+	const pres_row_t *rb = *(const pres_row_t **) b;
+
+	if (ra->rcd != rb->rcd) {
+		return ra->rcd > rb->rcd ? -1 : 1;
+	}
+
+	return ra->seq > rb->seq ? -1 : ra->seq < rb->seq;
+}
+
+/* rows come newest first, matching the order by rcd desc the presence handler relies on */
+uint32_t sofia_presence_store_dialog_select(sofia_presence_store_t *store, const sofia_dlg_match_t *match, switch_core_db_callback_func_t callback, void *pArg)
+{
+	pres_entry_t *entry, *next;
+	pres_row_t *rows = NULL, *row, **sorted;
+	uint32_t count = 0, i;
+
+	switch_thread_rwlock_rdlock(store->rwlock);
+
+	for (entry = dlg_collect(store, match); entry; entry = next) {
+		next = entry->work;
+		entry->work = NULL;
+
+		if (callback) {
+			row = pres_row_dup(&store->dialogs, entry);
+			row->rcd = (time_t) atol(row->col[SOFIA_DLG_COL_RCD]);
+			row->next = rows;
+			rows = row;
+		}
+
+		count++;
+	}
+
+	switch_thread_rwlock_unlock(store->rwlock);
+
+	if (!rows) {
+		return count;
+	}
+
+	switch_zmalloc(sorted, sizeof(*sorted) * count);
+
+	for (i = 0, row = rows; row; row = row->next) {
+		sorted[i++] = row;
+	}
+
+	qsort(sorted, count, sizeof(*sorted), dlg_row_cmp);
+
+	for (i = 0; i < count; i++) {
+		if (callback(pArg, SOFIA_DLG_COL_MAX, sorted[i]->col, dlg_col_names)) {
+			break;
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		free(sorted[i]);
+	}
+
+	free(sorted);
+
+	return count;
+}
+
+uint32_t sofia_presence_store_dialog_delete(sofia_presence_store_t *store, const sofia_dlg_match_t *match)
+{
+	pres_entry_t *entry, *next;
+	uint32_t count = 0;
+
+	switch_thread_rwlock_wrlock(store->rwlock);
+
+	for (entry = dlg_collect(store, match); entry; entry = next) {
+		next = entry->work;
+		pres_entry_unlink(store, &store->dialogs, entry);
+		pres_entry_free(store, &store->dialogs, entry);
+		count++;
+	}
+
+	switch_thread_rwlock_unlock(store->rwlock);
+
+	return count;
+}
+
+static sofia_presence_notify_t *pres_notify_dup(const sofia_presence_notify_t *notify)
+{
+	sofia_presence_notify_t *dup;
+
+	switch_zmalloc(dup, sizeof(*dup));
+
+	dup->full_to = notify->full_to ? strdup(notify->full_to) : NULL;
+	dup->full_from = notify->full_from ? strdup(notify->full_from) : NULL;
+	dup->contact = notify->contact ? strdup(notify->contact) : NULL;
+	dup->expires = notify->expires ? strdup(notify->expires) : NULL;
+	dup->call_id = notify->call_id ? strdup(notify->call_id) : NULL;
+	dup->event = notify->event ? strdup(notify->event) : NULL;
+	dup->remote_ip = notify->remote_ip ? strdup(notify->remote_ip) : NULL;
+	dup->remote_port = notify->remote_port ? strdup(notify->remote_port) : NULL;
+	dup->ct = notify->ct ? strdup(notify->ct) : NULL;
+	dup->pl = notify->pl ? strdup(notify->pl) : NULL;
+
+	return dup;
+}
+
+void sofia_presence_store_free_notify(sofia_presence_notify_t *notify)
+{
+	sofia_presence_notify_t *next;
+
+	for (; notify; notify = next) {
+		next = notify->next;
+
+		switch_safe_free(notify->full_to);
+		switch_safe_free(notify->full_from);
+		switch_safe_free(notify->contact);
+		switch_safe_free(notify->expires);
+		switch_safe_free(notify->call_id);
+		switch_safe_free(notify->event);
+		switch_safe_free(notify->remote_ip);
+		switch_safe_free(notify->remote_port);
+		switch_safe_free(notify->ct);
+		switch_safe_free(notify->pl);
+		free(notify);
+	}
+}
+
+/* a subscriber gets at most one NOTIFY per interval, anything newer inside the interval is held and
+   replaces whatever was already held for it, returns SWITCH_FALSE when the caller should send it now */
+switch_bool_t sofia_presence_store_hold_notify(sofia_presence_store_t *store, const sofia_presence_notify_t *notify, switch_interval_time_t interval)
+{
+	switch_time_t now = switch_micro_time_now();
+	pres_entry_t *entry;
+	switch_bool_t held = SWITCH_FALSE;
+
+	if (zstr(notify->call_id)) {
+		return SWITCH_FALSE;
+	}
+
+	switch_thread_rwlock_wrlock(store->rwlock);
+
+	if (!(entry = switch_core_hash_find(store->subs.index[SUB_IDX_CALL_ID], notify->call_id))) {
+		goto end;
+	}
+
+	if (interval <= 0) {
+		/* holding was turned off, whatever is still held is older than what goes out now */
+		pres_notify_drop(store, entry);
+		entry->last_notify = now;
+	} else if (entry->pending) {
+		switch_time_t due = entry->pending->due;
+
+		sofia_presence_store_free_notify(entry->pending);
+		entry->pending = pres_notify_dup(notify);
+		entry->pending->due = due;
+		store->notifies_coalesced++;
+		held = SWITCH_TRUE;
+	} else if (now - entry->last_notify < interval) {
+		entry->pending = pres_notify_dup(notify);
+		entry->pending->due = entry->last_notify + interval;
+		entry->pprev = NULL;
+		entry->pnext = store->pending;
+		if (store->pending) {
+			store->pending->pprev = entry;
+		}
+		store->pending = entry;
+		store->pending_count++;
+		switch_atomic_inc(&HELD_NOTIFIES);
+		held = SWITCH_TRUE;
+	} else {
+		entry->last_notify = now;
+	}
+
+	if (held) {
+		store->notifies_held++;
+	}
+
+ end:
+
+	switch_thread_rwlock_unlock(store->rwlock);
+
+	return held;
+}
+
+/* the caller sent this subscriber a NOTIFY of its own, anything held for it is older and must not follow */
+void sofia_presence_store_notify_sent(sofia_presence_store_t *store, const char *call_id)
+{
+	pres_entry_t *entry;
+
+	if (zstr(call_id)) {
+		return;
+	}
+
+	switch_thread_rwlock_wrlock(store->rwlock);
+
+	if ((entry = switch_core_hash_find(store->subs.index[SUB_IDX_CALL_ID], call_id))) {
+		pres_notify_drop(store, entry);
+		entry->last_notify = switch_micro_time_now();
+	}
+
+	switch_thread_rwlock_unlock(store->rwlock);
+}
+
+/* hands back every held NOTIFY that is due chained on next, the caller sends them and frees the chain */
+sofia_presence_notify_t *sofia_presence_store_due_notifies(sofia_presence_store_t *store, switch_time_t now)
+{
+	sofia_presence_notify_t *due = NULL, *notify;
+	pres_entry_t *entry, *next;
+
+	switch_thread_rwlock_wrlock(store->rwlock);
+
+	for (entry = store->pending; entry; entry = next) {
+		next = entry->pnext;
+
+		if (entry->pending->due > now) {
+			continue;
+		}
+
+		notify = entry->pending;
+		pres_notify_unhold(store, entry);
+		entry->last_notify = now;
+
+		notify->next = due;
+		due = notify;
+		store->notifies_flushed++;
+	}
+
+	switch_thread_rwlock_unlock(store->rwlock);
+
+	return due;
+}
+
+uint32_t sofia_presence_store_held(void)
+{
+	return switch_atomic_read(&HELD_NOTIFIES);
+}
+
+void sofia_presence_store_status(sofia_presence_store_t *store, switch_stream_handle_t *stream)
+{
+	switch_thread_rwlock_rdlock(store->rwlock);
+	stream->write_function(stream, "SUBSCRIPTIONS    \t%u\n", store->subs.count);
+	stream->write_function(stream, "DIALOGS          \t%u\n", store->dialogs.count);
+	stream->write_function(stream, "FAN-OUTS         \t%" SWITCH_UINT64_T_FMT "\n", store->fanouts);
+	stream->write_function(stream, "NOTIFY-HELD      \t%" SWITCH_UINT64_T_FMT "\n", store->notifies_held);
+	stream->write_function(stream, "NOTIFY-COALESCED \t%" SWITCH_UINT64_T_FMT "\n", store->notifies_coalesced);
+	stream->write_function(stream, "NOTIFY-FLUSHED   \t%" SWITCH_UINT64_T_FMT "\n", store->notifies_flushed);
+	stream->write_function(stream, "NOTIFY-PENDING   \t%u\n", store->pending_count);
+	switch_thread_rwlock_unlock(store->rwlock);
+}
+
+typedef struct {
+	sofia_presence_store_t *store;
+	switch_interval_time_t interval;
+	uint32_t rows;
+	uint32_t sent;
+	uint32_t held;
+} pres_bench_t;
+
+static int pres_bench_dialog_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	(*(uint32_t *) pArg)++;
+	return 0;
+}
+
+static int pres_bench_sub_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	pres_bench_t *b = (pres_bench_t *) pArg;
+	sofia_presence_notify_t notify = { 0 };
+
+	b->rows++;
+
+	notify.full_to = argv[SOFIA_SUB_COL_FULL_TO];
+	notify.full_from = argv[SOFIA_SUB_COL_FULL_FROM];
+	notify.contact = argv[SOFIA_SUB_COL_CONTACT];
+	notify.expires = argv[SOFIA_SUB_COL_EXPIRES];
+	notify.call_id = argv[SOFIA_SUB_COL_CALL_ID];
+	notify.event = argv[SOFIA_SUB_COL_EVENT];
+	notify.ct = "application/dialog-info+xml";
+	notify.pl = argv[SOFIA_SUB_COL_VERSION];
+
+	if (sofia_presence_store_hold_notify(b->store, &notify, b->interval)) {
+		b->held++;
+	} else {
+		b->sent++;
+	}
+
+	return 0;
+}
+
+/* busy lamp field against a private store: count dialog subscriptions spread watchers to a monitored extension,
+   then every extension places a call that rings, answers and hangs up, each step looking up the extension's
+   dialogs and fanning out to its watchers the way a presence event does, with NOTIFYs going through the hold */
+void sofia_presence_store_bench(uint32_t count, uint32_t watchers, switch_stream_handle_t *stream)
+{
+	switch_memory_pool_t *pool = NULL;
+	sofia_presence_store_t *store = NULL;
+	const char *cols[SOFIA_SUB_COL_MAX];
+	char bufs[6][128];
+	sofia_dlg_col_t set[] = { SOFIA_DLG_COL_STATE, SOFIA_DLG_COL_STATUS };
+	const char *states[] = { "early", "confirmed" };
+	const char *vals[2];
+	pres_bench_t b = { 0 };
+	sofia_presence_notify_t *due, *notify;
+	switch_time_t start;
+	uint32_t u, s, x, ext, dialog_rows = 0, flushed = 0, events = 0;
+	int i;
+
+	if (!watchers) {
+		watchers = 1;
+	}
+
+	ext = count / watchers ? count / watchers : 1;
+
+	switch_core_new_memory_pool(&pool);
+	sofia_presence_store_create(&store, pool);
+
+	b.store = store;
+	b.interval = 200000;
+
+	start = switch_micro_time_now();
+	for (s = 0; s < count; s++) {
+		for (i = 0; i < SOFIA_SUB_COL_MAX; i++) {
+			cols[i] = "";
+		}
+
+		switch_snprintf(bufs[0], 128, "blf-%u", s);
+		switch_snprintf(bufs[1], 128, "%u", 2000 + s / 64);
+		switch_snprintf(bufs[2], 128, "%u", 1000 + s % ext);
+		switch_snprintf(bufs[3], 128, "<sip:%u@10.0.%u.%u:5060>", 2000 + s / 64, (s >> 8) & 0xff, s & 0xff);
+		switch_snprintf(bufs[4], 128, "<sip:%u@bench.local>;tag=%u", 2000 + s / 64, s);
+
+		cols[SOFIA_SUB_COL_PROTO] = "sip";
+		cols[SOFIA_SUB_COL_SIP_USER] = bufs[1];
+		cols[SOFIA_SUB_COL_SIP_HOST] = "bench.local";
+		cols[SOFIA_SUB_COL_SUB_TO_USER] = bufs[2];
+		cols[SOFIA_SUB_COL_SUB_TO_HOST] = "bench.local";
+		cols[SOFIA_SUB_COL_EVENT] = "dialog";
+		cols[SOFIA_SUB_COL_CONTACT] = bufs[3];
+		cols[SOFIA_SUB_COL_CALL_ID] = bufs[0];
+		cols[SOFIA_SUB_COL_FULL_FROM] = bufs[4];
+		cols[SOFIA_SUB_COL_EXPIRES] = "3600";
+		cols[SOFIA_SUB_COL_PROFILE_NAME] = "bench";
+		cols[SOFIA_SUB_COL_VERSION] = "-1";
+		sofia_presence_store_sub_insert(store, cols);
+	}
+	stream->write_function(stream, "insert   %8u subscriptions on %u extensions: %8.3f us each\n", count, ext,
+						   (switch_micro_time_now() - start) / (double) (count ? count : 1));
+
+	start = switch_micro_time_now();
+	for (u = 0; u < ext; u++) {
+		sofia_sub_match_t match = { 0 };
+		sofia_dlg_match_t dmatch = { 0 };
+
+		switch_snprintf(bufs[0], 128, "%u", 1000 + u);
+		switch_snprintf(bufs[1], 128, "bench-%u", u);
+		switch_snprintf(bufs[2], 128, "%u@bench.local", 1000 + u);
+		switch_snprintf(bufs[3], 128, "%ld", (long) switch_epoch_time_now(NULL));
+
+		for (i = 0; i < SOFIA_DLG_COL_MAX; i++) {
+			cols[i] = "";
+		}
+
+		cols[SOFIA_DLG_COL_STATE] = "trying";
+		cols[SOFIA_DLG_COL_UUID] = bufs[1];
+		cols[SOFIA_DLG_COL_CALL_ID] = bufs[1];
+		cols[SOFIA_DLG_COL_SIP_FROM_USER] = bufs[0];
+		cols[SOFIA_DLG_COL_SIP_FROM_HOST] = "bench.local";
+		cols[SOFIA_DLG_COL_PRESENCE_ID] = bufs[2];
+		cols[SOFIA_DLG_COL_RCD] = bufs[3];
+		sofia_presence_store_dialog_insert(store, cols);
+
+		match.proto = "sip";
+		match.sub_to_user = bufs[0];
+		match.hosts[0] = "bench.local";
+		match.event = "dialog";
+		match.alt_event = "presence";
+
+		dmatch.user = bufs[0];
+		dmatch.host = "bench.local";
+		dmatch.not_seized = SWITCH_TRUE;
+
+		/* ringing, answered, hung up */
+		for (x = 0; x < 3; x++) {
+			dmatch.uuid = bufs[1];
+
+			if (x < 2) {
+				vals[0] = states[x];
+				vals[1] = x ? "CS_EXECUTE" : "CS_ROUTING";
+				sofia_presence_store_dialog_update(store, &dmatch, set, vals, 2);
+			} else {
+				sofia_presence_store_dialog_delete(store, &dmatch);
+			}
+
+			dmatch.uuid = NULL;
+
+			sofia_presence_store_dialog_select(store, &dmatch, pres_bench_dialog_callback, &dialog_rows);
+			sofia_presence_store_sub_select(store, &match, SWITCH_TRUE, pres_bench_sub_callback, &b);
+			events++;
+		}
+	}
+	stream->write_function(stream, "fan-out  %8u events to %u watchers each: %8.3f us per event\n", events, watchers,
+						   (switch_micro_time_now() - start) / (double) (events ? events : 1));
+
+	start = switch_micro_time_now();
+	due = sofia_presence_store_due_notifies(store, switch_micro_time_now() + b.interval);
+	while ((notify = due)) {
+		due = notify->next;
+		notify->next = NULL;
+		sofia_presence_store_free_notify(notify);
+		flushed++;
+	}
+	stream->write_function(stream, "flush    %8u held NOTIFYs: %8.3f ms\n", flushed, (switch_micro_time_now() - start) / 1000.0);
+	stream->write_function(stream, "dialog rows %u, subscription rows %u, NOTIFYs sent %u, held %u, coalesced %u\n",
+						   dialog_rows, b.rows, b.sent, b.held, b.held - flushed);
+
+	sofia_presence_store_destroy(&store);
+	switch_core_destroy_memory_pool(&pool);
+}
+
+/* For Emacs:
+ * Local Variables:
+ * mode:c
+ * indent-tabs-mode:t
+ * tab-width:4
+ * c-basic-offset:4
+ * End:
+ * For VIM:
+ * vim:set softtabstop=4 shiftwidth=4 tabstop=4 noet:
+ */
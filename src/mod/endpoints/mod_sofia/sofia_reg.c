@@ -671,7 +671,7 @@ int sofia_sla_dialog_del_callback(void *pArg, int argc, char **argv, char **colu
 	sofia_profile_t *profile = (sofia_profile_t *) pArg;
 	nua_handle_t *nh = NULL;
 
-	if ((nh = nua_handle_by_call_id(profile->nua, argv[0]))) {
+	if ((nh = sofia_glue_handle_by_call_id(profile, argv[0]))) {
 		nua_handle_destroy(nh);
 	}
 
@@ -693,7 +693,133 @@ void sofia_reg_check_socket(sofia_profile_t *profile, const char *call_id, const
 	switch_mutex_unlock(profile->flag_mutex);
 }
 
+/* with the memory store in charge the table is only a mirror, written behind on the same queue or not at all */
+void sofia_reg_execute_sql(sofia_profile_t *profile, char **sqlp, switch_bool_t now)
+{
+	if (!sofia_reg_store_enabled(profile)) {
+		if (now) {
+			sofia_glue_execute_sql_now(profile, sqlp, SWITCH_TRUE);
+		} else {
+			sofia_glue_execute_sql(profile, sqlp, SWITCH_TRUE);
+		}
+	} else if (sofia_test_pflag(profile, PFLAG_REG_DB_MIRROR)) {
+		sofia_glue_execute_sql_soon(profile, sqlp, SWITCH_TRUE);
+	} else {
+		switch_safe_free(*sqlp);
+	}
+}
+
+/* registrations outlive a restart in the mirror table, pick them up before the profile takes requests */
+void sofia_reg_store_load(sofia_profile_t *profile)
+{
+	char *sql = sofia_reg_store_load_sql(mod_sofia_globals.hostname, profile->name);
+
+	sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_store_load_callback, profile->reg_store);
+	switch_safe_free(sql);
+}
+
+struct reg_store_helper {
+	sofia_profile_t *profile;
+	int reboot;
+	switch_core_db_callback_func_t callback;
+};
+
+/* feeds a store row to the callbacks written for "select call_id,...,server_host,profile_name,network_ip,network_port,<reboot>,sip_realm" */
+static int sofia_reg_store_row_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	struct reg_store_helper *helper = (struct reg_store_helper *) pArg;
+	char reboot[16];
+	char *row[15];
+	int i;
+
+	for (i = 0; i <= SOFIA_REG_COL_SERVER_HOST; i++) {
+		row[i] = argv[i];
+	}
+
+	switch_snprintf(reboot, sizeof(reboot), "%d", helper->reboot);
+	row[10] = argv[SOFIA_REG_COL_PROFILE_NAME];
+	row[11] = argv[SOFIA_REG_COL_NETWORK_IP];
+	row[12] = argv[SOFIA_REG_COL_NETWORK_PORT];
+	row[13] = reboot;
+	row[14] = argv[SOFIA_REG_COL_SIP_REALM];
+
+	return helper->callback(helper->profile, 15, row, NULL);
+}
+
+static int sofia_reg_store_ping_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	sofia_profile_t *profile = (sofia_profile_t *) pArg;
+
+	if (!sofia_reg_store_ping_wanted(profile, argv)) {
+		return 1;
+	}
+
+	sofia_reg_nat_callback(profile, argc, argv, columnNames);
+
+	return 0;
+}
+
+static int sofia_reg_store_contact_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	return sofia_reg_find_callback(pArg, 1, &argv[SOFIA_REG_COL_CONTACT], NULL);
+}
+
+static int sofia_reg_store_contact_expires_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	char *row[2];
+
+	row[0] = argv[SOFIA_REG_COL_CONTACT];
+	row[1] = argv[SOFIA_REG_COL_EXPIRES];
+
+	return sofia_reg_find_reg_with_positive_expires_callback(pArg, 2, row, NULL);
+}
+
+/* matches the "call_id='x' or (sip_user='u' and sip_host='h')" lookups of the flush and check_sync commands */
+static void sofia_reg_store_by_call_id(sofia_profile_t *profile, const char *call_id, const char *user, const char *host,
+									   switch_bool_t del, struct reg_store_helper *helper)
+{
+	sofia_reg_match_t match = { 0 };
+
+	match.call_id = call_id;
+
+	if (del) {
+		sofia_reg_store_delete(profile->reg_store, &match, sofia_reg_store_row_callback, helper);
+	} else {
+		sofia_reg_store_select(profile->reg_store, &match, sofia_reg_store_row_callback, helper);
+	}
+
+	memset(&match, 0, sizeof(match));
+	match.call_id_not = call_id;
+	match.user = zstr(user) ? NULL : user;
+	match.host = host;
+
+	if (del) {
+		sofia_reg_store_delete(profile->reg_store, &match, sofia_reg_store_row_callback, helper);
+	} else {
+		sofia_reg_store_select(profile->reg_store, &match, sofia_reg_store_row_callback, helper);
+	}
+}
+
+/* the deletes register_token and the propagated unregisters make, by call-id, by contact or by user */
+void sofia_reg_store_drop(sofia_profile_t *profile, int multi_reg, int multi_reg_contact,
+						  const char *user, const char *host, const char *contact, const char *call_id)
+{
+	sofia_reg_match_t match = { 0 };
 
+	if (!sofia_reg_store_enabled(profile)) {
+		return;
+	}
+
+	if (multi_reg && !multi_reg_contact) {
+		match.call_id = call_id;
+	} else {
+		match.user = user;
+		match.host = host;
+		match.contact = multi_reg ? contact : NULL;
+	}
+
+	sofia_reg_store_delete(profile->reg_store, &match, NULL, NULL);
+}
 
 int sofia_reg_del_callback(void *pArg, int argc, char **argv, char **columnNames)
 {
@@ -771,16 +897,21 @@ void sofia_reg_expire_call_id(sofia_profile_t *profile, const char *call_id, int
 		sqlextra = switch_mprintf(" or (sip_user='%q' and sip_host='%q')", user, host);
 	}
 
-	sql = switch_mprintf("select call_id,sip_user,sip_host,contact,status,rpid,expires"
-						 ",user_agent,server_user,server_host,profile_name,network_ip,network_port"
-						 ",%d,sip_realm from sip_registrations where call_id='%q' %s", reboot, call_id, sqlextra);
+	if (sofia_reg_store_enabled(profile)) {
+		struct reg_store_helper helper = { profile, reboot, sofia_reg_del_callback };
 
+		sofia_reg_store_by_call_id(profile, call_id, user, host, SWITCH_TRUE, &helper);
+	} else {
+		sql = switch_mprintf("select call_id,sip_user,sip_host,contact,status,rpid,expires"
+							 ",user_agent,server_user,server_host,profile_name,network_ip,network_port"
+							 ",%d,sip_realm from sip_registrations where call_id='%q' %s", reboot, call_id, sqlextra);
 
-	sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_del_callback, profile);
-	switch_safe_free(sql);
+		sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_del_callback, profile);
+		switch_safe_free(sql);
+	}
 
 	sql = switch_mprintf("delete from sip_registrations where call_id='%q' %s", call_id, sqlextra);
-	sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+	sofia_reg_execute_sql(profile, &sql, SWITCH_TRUE);
 
 	switch_safe_free(sqlextra);
 	switch_safe_free(sql);
@@ -792,17 +923,23 @@ void sofia_reg_check_expire(sofia_profile_t *profile, time_t now, int reboot)
 {
 	char *sql;
 
-	if (now) {
-		sql = switch_mprintf("select call_id,sip_user,sip_host,contact,status,rpid,expires"
-						",user_agent,server_user,server_host,profile_name,network_ip, network_port"
-						",%d,sip_realm from sip_registrations where expires > 0 and expires <= %ld", reboot, (long) now);
+	if (sofia_reg_store_enabled(profile)) {
+		struct reg_store_helper helper = { profile, reboot, sofia_reg_del_callback };
+
+		sofia_reg_store_expire(profile->reg_store, now, sofia_reg_store_row_callback, &helper);
 	} else {
-		sql = switch_mprintf("select call_id,sip_user,sip_host,contact,status,rpid,expires"
-						",user_agent,server_user,server_host,profile_name,network_ip, network_port" ",%d,sip_realm from sip_registrations where expires > 0", reboot);
-	}
+		if (now) {
+			sql = switch_mprintf("select call_id,sip_user,sip_host,contact,status,rpid,expires"
+							",user_agent,server_user,server_host,profile_name,network_ip, network_port"
+							",%d,sip_realm from sip_registrations where expires > 0 and expires <= %ld", reboot, (long) now);
+		} else {
+			sql = switch_mprintf("select call_id,sip_user,sip_host,contact,status,rpid,expires"
+							",user_agent,server_user,server_host,profile_name,network_ip, network_port" ",%d,sip_realm from sip_registrations where expires > 0", reboot);
+		}
 
-	sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_del_callback, profile);
-	free(sql);
+		sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_del_callback, profile);
+		free(sql);
+	}
 
 	if (now) {
 		sql = switch_mprintf("delete from sip_registrations where expires > 0 and expires <= %ld and hostname='%q'",
@@ -810,7 +947,7 @@ void sofia_reg_check_expire(sofia_profile_t *profile, time_t now, int reboot)
 	} else {
 		sql = switch_mprintf("delete from sip_registrations where expires > 0 and hostname='%q'", mod_sofia_globals.hostname);
 	}
-	sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+	sofia_reg_execute_sql(profile, &sql, SWITCH_FALSE);
 
 
 
@@ -839,14 +976,18 @@ void sofia_reg_check_expire(sofia_profile_t *profile, time_t now, int reboot)
 
 	sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
 
-	if (now) {
-		sql = switch_mprintf("delete from sip_authentication where expires > 0 and expires <= %ld and hostname='%q'",
-						(long) now, mod_sofia_globals.hostname);
+	if (sofia_nonce_store_enabled(profile)) {
+		sofia_nonce_store_expire(profile->nonce_store, now);
 	} else {
-		sql = switch_mprintf("delete from sip_authentication where expires > 0 and hostname='%q'", mod_sofia_globals.hostname);
-	}
+		if (now) {
+			sql = switch_mprintf("delete from sip_authentication where expires > 0 and expires <= %ld and hostname='%q'",
+							(long) now, mod_sofia_globals.hostname);
+		} else {
+			sql = switch_mprintf("delete from sip_authentication where expires > 0 and hostname='%q'", mod_sofia_globals.hostname);
+		}
 
-	sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+		sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+	}
 
 	sofia_presence_check_subscriptions(profile, now);
 
@@ -855,6 +996,10 @@ void sofia_reg_check_expire(sofia_profile_t *profile, time_t now, int reboot)
 						(long) now, mod_sofia_globals.hostname);
 	} else {
 		sql = switch_mprintf("delete from sip_dialogs where expires >= -1 and hostname='%q'", mod_sofia_globals.hostname);
+
+		if (sofia_presence_store_enabled(profile)) {
+			sofia_presence_store_dialog_delete(profile->pres_store, NULL);
+		}
 	}
 
 	sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
@@ -884,6 +1029,11 @@ void sofia_reg_check_ping_expire(sofia_profile_t *profile, time_t now, int inter
 	char buf[32] = "";
 	int count;
 
+	if (now && sofia_reg_store_enabled(profile)) {
+		sofia_reg_store_ping(profile->reg_store, now, interval, sofia_reg_store_ping_callback, profile);
+		return;
+	}
+
 	if (now) {
 		if (sofia_test_pflag(profile, PFLAG_ALL_REG_OPTIONS_PING)) {
 			sql = switch_mprintf("select call_id,sip_user,sip_host,contact,status,rpid,"
@@ -983,15 +1133,19 @@ void sofia_reg_check_call_id(sofia_profile_t *profile, const char *call_id)
 		sqlextra = switch_mprintf(" or (sip_user='%q' and sip_host='%q')", user, host);
 	}
 
-	sql = switch_mprintf("select call_id,sip_user,sip_host,contact,status,rpid,expires"
-						 ",user_agent,server_user,server_host,profile_name,network_ip"
-						 " from sip_registrations where call_id='%q' %s", call_id, sqlextra);
+	if (sofia_reg_store_enabled(profile)) {
+		struct reg_store_helper helper = { profile, 0, sofia_reg_check_callback };
 
+		sofia_reg_store_by_call_id(profile, call_id, user, host, SWITCH_FALSE, &helper);
+	} else {
+		sql = switch_mprintf("select call_id,sip_user,sip_host,contact,status,rpid,expires"
+							 ",user_agent,server_user,server_host,profile_name,network_ip"
+							 " from sip_registrations where call_id='%q' %s", call_id, sqlextra);
 
-	sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_check_callback, profile);
-
+		sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_check_callback, profile);
+		switch_safe_free(sql);
+	}
 
-	switch_safe_free(sql);
 	switch_safe_free(sqlextra);
 	switch_safe_free(dup);
 
@@ -1001,22 +1155,31 @@ void sofia_reg_check_sync(sofia_profile_t *profile)
 {
 	char *sql;
 
-	sql = switch_mprintf("select call_id,sip_user,sip_host,contact,status,rpid,expires"
-					",user_agent,server_user,server_host,profile_name,network_ip,network_port,0,sip_realm"
-					" from sip_registrations where expires > 0");
+	if (sofia_reg_store_enabled(profile)) {
+		struct reg_store_helper helper = { profile, 0, sofia_reg_del_callback };
 
+		sofia_reg_store_expire(profile->reg_store, 0, sofia_reg_store_row_callback, &helper);
+	} else {
+		sql = switch_mprintf("select call_id,sip_user,sip_host,contact,status,rpid,expires"
+						",user_agent,server_user,server_host,profile_name,network_ip,network_port,0,sip_realm"
+						" from sip_registrations where expires > 0");
 
-	sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_del_callback, profile);
-	switch_safe_free(sql);
+		sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_del_callback, profile);
+		switch_safe_free(sql);
+	}
 
 	sql = switch_mprintf("delete from sip_registrations where expires > 0 and hostname='%q'", mod_sofia_globals.hostname);
-	sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+	sofia_reg_execute_sql(profile, &sql, SWITCH_TRUE);
 
 	sql = switch_mprintf("delete from sip_presence where expires > 0 and hostname='%q'", mod_sofia_globals.hostname);
 	sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
 
-	sql = switch_mprintf("delete from sip_authentication where expires > 0 and hostname='%q'", mod_sofia_globals.hostname);
-	sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+	if (sofia_nonce_store_enabled(profile)) {
+		sofia_nonce_store_expire(profile->nonce_store, 0);
+	} else {
+		sql = switch_mprintf("delete from sip_authentication where expires > 0 and hostname='%q'", mod_sofia_globals.hostname);
+		sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+	}
 
 	sql = switch_mprintf("delete from sip_subscriptions where expires >= -1 and hostname='%q'", mod_sofia_globals.hostname);
 	sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
@@ -1024,6 +1187,11 @@ void sofia_reg_check_sync(sofia_profile_t *profile)
 	sql = switch_mprintf("delete from sip_dialogs where expires >= -1 and hostname='%q'", mod_sofia_globals.hostname);
 	sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
 
+	if (sofia_presence_store_enabled(profile)) {
+		sofia_presence_store_sub_delete(profile->pres_store, NULL);
+		sofia_presence_store_dialog_delete(profile->pres_store, NULL);
+	}
+
 }
 
 char *sofia_reg_find_reg_url(sofia_profile_t *profile, const char *user, const char *host, char *val, switch_size_t len)
@@ -1039,17 +1207,24 @@ char *sofia_reg_find_reg_url(sofia_profile_t *profile, const char *user, const c
 	cbt.val = val;
 	cbt.len = len;
 
-	if (host) {
-		sql = switch_mprintf("select contact from sip_registrations where sip_user='%q' and (sip_host='%q' or presence_hosts like '%%%q%%')",
-						user, host, host);
-	} else {
-		sql = switch_mprintf("select contact from sip_registrations where sip_user='%q'", user);
-	}
+	if (sofia_reg_store_enabled(profile)) {
+		sofia_reg_match_t match = { 0 };
 
+		match.user = user;
+		match.host_or_presence = host;
+		sofia_reg_store_select(profile->reg_store, &match, sofia_reg_store_contact_callback, &cbt);
+	} else {
+		if (host) {
+			sql = switch_mprintf("select contact from sip_registrations where sip_user='%q' and (sip_host='%q' or presence_hosts like '%%%q%%')",
+							user, host, host);
+		} else {
+			sql = switch_mprintf("select contact from sip_registrations where sip_user='%q'", user);
+		}
 
-	sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_find_callback, &cbt);
+		sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_find_callback, &cbt);
 
-	switch_safe_free(sql);
+		switch_safe_free(sql);
+	}
 
 	if (cbt.list) {
 		switch_console_free_matches(&cbt.list);
@@ -1073,17 +1248,24 @@ switch_console_callback_match_t *sofia_reg_find_reg_url_multi(sofia_profile_t *p
 		return NULL;
 	}
 
-	if (host) {
-		sql = switch_mprintf("select contact from sip_registrations where sip_user='%q' and (sip_host='%q' or presence_hosts like '%%%q%%')",
-						user, host, host);
-	} else {
-		sql = switch_mprintf("select contact from sip_registrations where sip_user='%q'", user);
-	}
+	if (sofia_reg_store_enabled(profile)) {
+		sofia_reg_match_t match = { 0 };
 
+		match.user = user;
+		match.host_or_presence = host;
+		sofia_reg_store_select(profile->reg_store, &match, sofia_reg_store_contact_callback, &cbt);
+	} else {
+		if (host) {
+			sql = switch_mprintf("select contact from sip_registrations where sip_user='%q' and (sip_host='%q' or presence_hosts like '%%%q%%')",
+							user, host, host);
+		} else {
+			sql = switch_mprintf("select contact from sip_registrations where sip_user='%q'", user);
+		}
 
-	sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_find_callback, &cbt);
+		sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_find_callback, &cbt);
 
-	switch_safe_free(sql);
+		switch_safe_free(sql);
+	}
 
 	return cbt.list;
 }
@@ -1099,19 +1281,27 @@ switch_console_callback_match_t *sofia_reg_find_reg_url_with_positive_expires_mu
 		return NULL;
 	}
 
-	if (host) {
-		sql = switch_mprintf("select contact,expires from sip_registrations where sip_user='%q' and (sip_host='%q' or presence_hosts like '%%%q%%')",
-						user, host, host);
-	} else {
-		sql = switch_mprintf("select contact,expires from sip_registrations where sip_user='%q'", user);
-	}
-
 	cbt.time = reg_time;
 	cbt.contact_str = contact_str;
 	cbt.exptime = exptime;
 
-	sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_find_reg_with_positive_expires_callback, &cbt);
-	free(sql);
+	if (sofia_reg_store_enabled(profile)) {
+		sofia_reg_match_t match = { 0 };
+
+		match.user = user;
+		match.host_or_presence = host;
+		sofia_reg_store_select(profile->reg_store, &match, sofia_reg_store_contact_expires_callback, &cbt);
+	} else {
+		if (host) {
+			sql = switch_mprintf("select contact,expires from sip_registrations where sip_user='%q' and (sip_host='%q' or presence_hosts like '%%%q%%')",
+							user, host, host);
+		} else {
+			sql = switch_mprintf("select contact,expires from sip_registrations where sip_user='%q'", user);
+		}
+
+		sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_find_reg_with_positive_expires_callback, &cbt);
+		free(sql);
+	}
 
 	return cbt.list;
 }
@@ -1121,24 +1311,27 @@ void sofia_reg_auth_challenge(sofia_profile_t *profile, nua_handle_t *nh, sofia_
 							  sofia_regtype_t regtype, const char *realm, int stale, long exptime)
 {
 	switch_uuid_t uuid;
-	char uuid_str[SWITCH_UUID_FORMATTED_LENGTH + 1];
+	char uuid_str[80];
 	char *sql, *auth_str;
 	msg_t *msg = NULL;
+	long expires = (long) switch_epoch_time_now(NULL) + (profile->nonce_ttl ? profile->nonce_ttl : DEFAULT_NONCE_TTL) + exptime;
 
 
 	if (de && de->data) {
 		msg = de->data->e_msg;
 	}
 
-	switch_uuid_get(&uuid);
-	switch_uuid_format(uuid_str, &uuid);
+	if (sofia_nonce_store_enabled(profile)) {
+		sofia_nonce_store_issue(profile->nonce_store, sofia_test_pflag(profile, PFLAG_STATELESS_NONCES), expires, uuid_str, sizeof(uuid_str));
+	} else {
+		switch_uuid_get(&uuid);
+		switch_uuid_format(uuid_str, &uuid);
 
-	sql = switch_mprintf("insert into sip_authentication (nonce,expires,profile_name,hostname, last_nc) "
-						 "values('%q', %ld, '%q', '%q', 0)", uuid_str,
-						 (long) switch_epoch_time_now(NULL) + (profile->nonce_ttl ? profile->nonce_ttl : DEFAULT_NONCE_TTL) + exptime,
-						 profile->name, mod_sofia_globals.hostname);
-	switch_assert(sql != NULL);
-	sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+		sql = switch_mprintf("insert into sip_authentication (nonce,expires,profile_name,hostname, last_nc) "
+							 "values('%q', %ld, '%q', '%q', 0)", uuid_str, expires, profile->name, mod_sofia_globals.hostname);
+		switch_assert(sql != NULL);
+		sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+	}
 
 	auth_str = switch_mprintf("Digest realm=\"%q\", nonce=\"%q\",%s algorithm=MD5, qop=\"auth\"", realm, uuid_str, stale ? " stale=true," : "");
 
@@ -1156,13 +1349,26 @@ void sofia_reg_auth_challenge(sofia_profile_t *profile, nua_handle_t *nh, sofia_
 uint32_t sofia_reg_reg_count(sofia_profile_t *profile, const char *user, const char *host)
 {
 	char buf[32] = "";
-	char *sql;
+	char *like;
+	const char *params[4];
 
-	sql = switch_mprintf("select count(*) from sip_registrations where profile_name='%q' and "
-						 "sip_user='%q' and (sip_host='%q' or presence_hosts like '%%%q%%')", profile->name, user, host, host);
+	if (sofia_reg_store_enabled(profile)) {
+		sofia_reg_match_t match = { 0 };
 
-	sofia_glue_execute_sql2str(profile, profile->dbh_mutex, sql, buf, sizeof(buf));
-	switch_safe_free(sql);
+		match.user = user;
+		match.host_or_presence = host;
+		return sofia_reg_store_select(profile->reg_store, &match, NULL, NULL);
+	}
+
+	like = switch_mprintf("%%%s%%", host);
+	params[0] = profile->name;
+	params[1] = user;
+	params[2] = host;
+	params[3] = like;
+
+	sofia_glue_execute_sql2str_params(profile, profile->dbh_mutex, "select count(*) from sip_registrations where profile_name=? and "
+									  "sip_user=? and (sip_host=? or presence_hosts like ?)", 4, params, buf, sizeof(buf));
+	switch_safe_free(like);
 	return atoi(buf);
 }
 
@@ -1873,6 +2079,8 @@ uint8_t sofia_reg_handle_register_token(nua_t *nua, sofia_profile_t *profile, nu
 
 	if (exptime) {
 		char guess_ip4[256];
+		char expires_c[32];
+		char force_ping_c[16];
 		const char *username = "unknown";
 		const char *realm = reg_host;
 		char *url = NULL;
@@ -1887,27 +2095,36 @@ uint8_t sofia_reg_handle_register_token(nua_t *nua, sofia_profile_t *profile, nu
 		if (auth_res != AUTH_RENEWED || !multi_reg) {
 			if (multi_reg) {
 				if (multi_reg_contact) {
-					sql =
-						switch_mprintf("delete from sip_registrations where sip_user='%q' and sip_host='%q' and contact='%q'", to_user, reg_host, contact_str);
+					const char *params[] = { to_user, reg_host, contact_str };
+					sql = switch_sql_bind_params("delete from sip_registrations where sip_user=? and sip_host=? and contact=?", 3, params);
 				} else {
-					sql = switch_mprintf("delete from sip_registrations where call_id='%q'", call_id);
+					sql = switch_sql_bind_params("delete from sip_registrations where call_id=?", 1, &call_id);
 				}
 			} else {
-				sql = switch_mprintf("delete from sip_registrations where sip_user='%q' and sip_host='%q'", to_user, reg_host);
+				const char *params[] = { to_user, reg_host };
+				sql = switch_sql_bind_params("delete from sip_registrations where sip_user=? and sip_host=?", 2, params);
 			}
 
-			sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
-		} else {
-			char buf[32] = "";
-
-
-			sql = switch_mprintf("select count(*) from sip_registrations where sip_user='%q' and sip_username='%q' and sip_host='%q' and contact='%q'",
-								 to_user, username, reg_host, contact_str);
+			sofia_reg_store_drop(profile, multi_reg, multi_reg_contact, to_user, reg_host, contact_str, call_id);
+			sofia_reg_execute_sql(profile, &sql, SWITCH_TRUE);
+		} else if (sofia_reg_store_enabled(profile)) {
+			sofia_reg_match_t match = { 0 };
 
+			match.user = to_user;
+			match.username = username;
+			match.host = reg_host;
+			match.contact = contact_str;
 
+			if (sofia_reg_store_select(profile->reg_store, &match, NULL, NULL) > 0) {
+				update_registration = SWITCH_TRUE;
+			}
+		} else {
+			char buf[32] = "";
+			const char *params[] = { to_user, username, reg_host, contact_str };
 
-			sofia_glue_execute_sql2str(profile, profile->dbh_mutex, sql, buf, sizeof(buf));
-			switch_safe_free(sql);
+			sofia_glue_execute_sql2str_params(profile, profile->dbh_mutex,
+											  "select count(*) from sip_registrations where sip_user=? and sip_username=? and sip_host=? and contact=?",
+											  4, params, buf, sizeof(buf));
 			if (atoi(buf) > 0) {
 				update_registration = SWITCH_TRUE;
 			}
@@ -1955,31 +2172,85 @@ uint8_t sofia_reg_handle_register_token(nua_t *nua, sofia_profile_t *profile, nu
 		}
 
 
+		switch_snprintf(expires_c, sizeof(expires_c), "%ld", (long) reg_time + (long) exptime + profile->sip_expires_late_margin);
+		switch_snprintf(force_ping_c, sizeof(force_ping_c), "%d", force_ping);
+
 		if (!update_registration) {
-			sql = switch_mprintf("insert into sip_registrations "
+			const char *params[] = { call_id, to_user, reg_host, profile->presence_hosts ? profile->presence_hosts : "",
+									 contact_str, reg_desc, rpid, expires_c,
+									 agent, from_user, guess_ip4, profile->name, mod_sofia_globals.hostname, network_ip, network_port_c, username, realm,
+									 mwi_user, mwi_host, guess_ip4, mod_sofia_globals.hostname, sub_host, "Reachable", "0", force_ping_c };
+
+			sql = switch_sql_bind_params("insert into sip_registrations "
 					"(call_id,sip_user,sip_host,presence_hosts,contact,status,rpid,expires,"
 					"user_agent,server_user,server_host,profile_name,hostname,network_ip,network_port,sip_username,sip_realm,"
 					"mwi_user,mwi_host, orig_server_host, orig_hostname, sub_host, ping_status, ping_count, force_ping) "
-					"values ('%q','%q', '%q','%q','%q','%q', '%q', %ld, '%q', '%q', '%q', '%q', '%q', '%q', '%q','%q','%q','%q','%q','%q','%q','%q', '%q', %d, %d)",
-					call_id, to_user, reg_host, profile->presence_hosts ? profile->presence_hosts : "",
-					contact_str, reg_desc, rpid, (long) reg_time + (long) exptime + profile->sip_expires_late_margin,
-					agent, from_user, guess_ip4, profile->name, mod_sofia_globals.hostname, network_ip, network_port_c, username, realm,
-								 mwi_user, mwi_host, guess_ip4, mod_sofia_globals.hostname, sub_host, "Reachable", 0, force_ping);
+					"values (?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)", 25, params);
+
+			if (sofia_reg_store_enabled(profile)) {
+				const char *cols[SOFIA_REG_COL_MAX];
+
+				cols[SOFIA_REG_COL_CALL_ID] = call_id;
+				cols[SOFIA_REG_COL_SIP_USER] = to_user;
+				cols[SOFIA_REG_COL_SIP_HOST] = reg_host;
+				cols[SOFIA_REG_COL_CONTACT] = contact_str;
+				cols[SOFIA_REG_COL_STATUS] = reg_desc;
+				cols[SOFIA_REG_COL_RPID] = rpid;
+				cols[SOFIA_REG_COL_EXPIRES] = expires_c;
+				cols[SOFIA_REG_COL_USER_AGENT] = agent;
+				cols[SOFIA_REG_COL_SERVER_USER] = from_user;
+				cols[SOFIA_REG_COL_SERVER_HOST] = guess_ip4;
+				cols[SOFIA_REG_COL_PROFILE_NAME] = profile->name;
+				cols[SOFIA_REG_COL_HOSTNAME] = mod_sofia_globals.hostname;
+				cols[SOFIA_REG_COL_NETWORK_IP] = network_ip;
+				cols[SOFIA_REG_COL_NETWORK_PORT] = network_port_c;
+				cols[SOFIA_REG_COL_SIP_USERNAME] = username;
+				cols[SOFIA_REG_COL_SIP_REALM] = realm;
+				cols[SOFIA_REG_COL_MWI_USER] = mwi_user;
+				cols[SOFIA_REG_COL_MWI_HOST] = mwi_host;
+				cols[SOFIA_REG_COL_PING_STATUS] = "Reachable";
+				cols[SOFIA_REG_COL_PING_TIME] = "0";
+				cols[SOFIA_REG_COL_PRESENCE_HOSTS] = profile->presence_hosts ? profile->presence_hosts : "";
+				cols[SOFIA_REG_COL_SUB_HOST] = sub_host;
+				cols[SOFIA_REG_COL_ORIG_SERVER_HOST] = guess_ip4;
+				cols[SOFIA_REG_COL_ORIG_HOSTNAME] = mod_sofia_globals.hostname;
+				cols[SOFIA_REG_COL_PING_COUNT] = "0";
+				cols[SOFIA_REG_COL_FORCE_PING] = force_ping_c;
+
+				sofia_reg_store_insert(profile->reg_store, cols);
+			}
 		} else {
-			sql = switch_mprintf("update sip_registrations set call_id='%q',"
-								 "sub_host='%q', network_ip='%q',network_port='%q',"
-								 "presence_hosts='%q', server_host='%q', orig_server_host='%q',"
-								 "hostname='%q', orig_hostname='%q',"
-								 "expires = %ld, force_ping=%d where sip_user='%q' and sip_username='%q' and sip_host='%q' and contact='%q'",
-								 call_id, sub_host, network_ip, network_port_c,
-								 profile->presence_hosts ? profile->presence_hosts : "", guess_ip4, guess_ip4,
-                                                                 mod_sofia_globals.hostname, mod_sofia_globals.hostname,
-								 (long) reg_time + (long) exptime + profile->sip_expires_late_margin, force_ping,
-								 to_user, username, reg_host, contact_str);
+			const char *params[] = { call_id, sub_host, network_ip, network_port_c,
+									 profile->presence_hosts ? profile->presence_hosts : "", guess_ip4, guess_ip4,
+									 mod_sofia_globals.hostname, mod_sofia_globals.hostname,
+									 expires_c, force_ping_c,
+									 to_user, username, reg_host, contact_str };
+
+			sql = switch_sql_bind_params("update sip_registrations set call_id=?,"
+								 "sub_host=?, network_ip=?,network_port=?,"
+								 "presence_hosts=?, server_host=?, orig_server_host=?,"
+								 "hostname=?, orig_hostname=?,"
+								 "expires = ?, force_ping=? where sip_user=? and sip_username=? and sip_host=? and contact=?", 15, params);
+
+			if (sofia_reg_store_enabled(profile)) {
+				static const sofia_reg_col_t set[] = {
+					SOFIA_REG_COL_CALL_ID, SOFIA_REG_COL_SUB_HOST, SOFIA_REG_COL_NETWORK_IP, SOFIA_REG_COL_NETWORK_PORT,
+					SOFIA_REG_COL_PRESENCE_HOSTS, SOFIA_REG_COL_SERVER_HOST, SOFIA_REG_COL_ORIG_SERVER_HOST,
+					SOFIA_REG_COL_HOSTNAME, SOFIA_REG_COL_ORIG_HOSTNAME, SOFIA_REG_COL_EXPIRES, SOFIA_REG_COL_FORCE_PING
+				};
+				sofia_reg_match_t match = { 0 };
+
+				match.user = to_user;
+				match.username = username;
+				match.host = reg_host;
+				match.contact = contact_str;
+
+				sofia_reg_store_update(profile->reg_store, &match, set, params, 11);
+			}
 		}
 
 		if (sql) {
-			sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+			sofia_reg_execute_sql(profile, &sql, SWITCH_TRUE);
 		}
 
 		if (!update_registration && sofia_reg_reg_count(profile, to_user, reg_host) == 1) {
@@ -1993,12 +2264,27 @@ uint8_t sofia_reg_handle_register_token(nua_t *nua, sofia_profile_t *profile, nu
 
 		if (multi_reg) {
 			if (multi_reg_contact) {
-				sql = switch_mprintf("delete from sip_registrations where contact='%q' and expires!=%ld", contact_str, (long) reg_time + (long) exptime + profile->sip_expires_late_margin);
+				const char *params[] = { contact_str, expires_c };
+				sql = switch_sql_bind_params("delete from sip_registrations where contact=? and expires!=?", 2, params);
 			} else {
-				sql = switch_mprintf("delete from sip_registrations where call_id='%q' and expires!=%ld", call_id, (long) reg_time + (long) exptime + profile->sip_expires_late_margin);
+				const char *params[] = { call_id, expires_c };
+				sql = switch_sql_bind_params("delete from sip_registrations where call_id=? and expires!=?", 2, params);
 			}
 
-			sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+			if (sofia_reg_store_enabled(profile)) {
+				sofia_reg_match_t match = { 0 };
+
+				if (multi_reg_contact) {
+					match.contact = contact_str;
+				} else {
+					match.call_id = call_id;
+				}
+				match.expires_not = expires_c;
+
+				sofia_reg_store_delete(profile->reg_store, &match, NULL, NULL);
+			}
+
+			sofia_reg_execute_sql(profile, &sql, SWITCH_FALSE);
 		}
 
 
@@ -2072,20 +2358,23 @@ uint8_t sofia_reg_handle_register_token(nua_t *nua, sofia_profile_t *profile, nu
 			}
 
 			if (multi_reg_contact) {
-				sql =
-					switch_mprintf("delete from sip_registrations where sip_user='%q' and sip_host='%q' and contact='%q'", to_user, reg_host, contact_str);
+				const char *params[] = { to_user, reg_host, contact_str };
+				sql = switch_sql_bind_params("delete from sip_registrations where sip_user=? and sip_host=? and contact=?", 3, params);
 			} else {
-				sql = switch_mprintf("delete from sip_registrations where call_id='%q'", call_id);
+				sql = switch_sql_bind_params("delete from sip_registrations where call_id=?", 1, &call_id);
 			}
 
-			sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+			sofia_reg_store_drop(profile, multi_reg, multi_reg_contact, to_user, reg_host, contact_str, call_id);
+			sofia_reg_execute_sql(profile, &sql, SWITCH_TRUE);
 
 			switch_safe_free(icontact);
 		} else {
 
-			if ((sql = switch_mprintf("delete from sip_registrations where sip_user='%q' and sip_host='%q'", to_user, reg_host))) {
-				sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
-			}
+			const char *params[] = { to_user, reg_host };
+
+			sql = switch_sql_bind_params("delete from sip_registrations where sip_user=? and sip_host=?", 2, params);
+			sofia_reg_store_drop(profile, multi_reg, multi_reg_contact, to_user, reg_host, contact_str, call_id);
+			sofia_reg_execute_sql(profile, &sql, SWITCH_TRUE);
 		}
 	}
 
@@ -2800,23 +3089,39 @@ auth_res_t sofia_reg_parse_auth(sofia_profile_t *profile,
 
 		if (nc) {
 			nc_long = strtoul(nc, 0, 16);
-			sql = switch_mprintf("select nonce,last_nc from sip_authentication where nonce='%q' and last_nc < %lu", nonce, nc_long);
-		} else {
-			sql = switch_mprintf("select nonce from sip_authentication where nonce='%q'", nonce);
 		}
 
 		cb.nonce = np;
 		cb.nplen = nplen;
 
-		switch_assert(sql != NULL);
+		if (sofia_nonce_store_enabled(profile)) {
+			uint32_t last_nc = 0;
 
-		sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_nonce_callback, &cb);
-		free(sql);
+			if (sofia_nonce_store_check(profile->nonce_store, nonce, (uint32_t) nc_long, &last_nc) == SWITCH_STATUS_SUCCESS) {
+				switch_copy_string(np, nonce, nplen);
+				cb.last_nc = (int) last_nc;
+			}
+		} else {
+			if (nc) {
+				sql = switch_mprintf("select nonce,last_nc from sip_authentication where nonce='%q' and last_nc < %lu", nonce, nc_long);
+			} else {
+				sql = switch_mprintf("select nonce from sip_authentication where nonce='%q'", nonce);
+			}
+
+			switch_assert(sql != NULL);
+
+			sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_nonce_callback, &cb);
+			free(sql);
+		}
 
 		//if (!sofia_glue_execute_sql2str(profile, profile->dbh_mutex, sql, np, nplen)) {
 		if (zstr(np) || (profile->max_auth_validity != 0 && (uint32_t)cb.last_nc >= profile->max_auth_validity )) {
-			sql = switch_mprintf("delete from sip_authentication where nonce='%q'", nonce);
-			sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+			if (sofia_nonce_store_enabled(profile)) {
+				sofia_nonce_store_delete(profile->nonce_store, nonce);
+			} else {
+				sql = switch_mprintf("delete from sip_authentication where nonce='%q'", nonce);
+				sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+			}
 			ret = AUTH_STALE;
 			goto end;
 		}
@@ -3074,11 +3379,20 @@ auth_res_t sofia_reg_parse_auth(sofia_profile_t *profile,
 		call_id = sip->sip_call_id->i_id;
 		switch_assert(call_id);
 
-		sql = switch_mprintf("select count(sip_user) from sip_registrations where sip_user='%q' AND call_id <> '%q' AND sip_host='%q'",
-							 username, call_id, domain_name);
-		switch_assert(sql != NULL);
-		sofia_glue_execute_sql_callback(profile, NULL, sql, sofia_reg_regcount_callback, &count);
-		free(sql);
+		if (sofia_reg_store_enabled(profile)) {
+			sofia_reg_match_t match = { 0 };
+
+			match.user = username;
+			match.host = domain_name;
+			match.call_id_not = call_id;
+			count = sofia_reg_store_select(profile->reg_store, &match, NULL, NULL);
+		} else {
+			sql = switch_mprintf("select count(sip_user) from sip_registrations where sip_user='%q' AND call_id <> '%q' AND sip_host='%q'",
+								 username, call_id, domain_name);
+			switch_assert(sql != NULL);
+			sofia_glue_execute_sql_callback(profile, NULL, sql, sofia_reg_regcount_callback, &count);
+			free(sql);
+		}
 
 		if (count + 1 > max_registrations_perext) {
 			ret = AUTH_FORBIDDEN;
@@ -3238,13 +3552,18 @@ auth_res_t sofia_reg_parse_auth(sofia_profile_t *profile,
 
 
 	if (nc && cnonce && qop) {
+		long expires = (long)switch_epoch_time_now(NULL) + (profile->nonce_ttl ? profile->nonce_ttl : DEFAULT_NONCE_TTL) + exptime;
+
 		ncl = strtoul(nc, 0, 16);
 
-		sql = switch_mprintf("update sip_authentication set expires='%ld',last_nc=%lu where nonce='%q'",
-							 (long)switch_epoch_time_now(NULL) + (profile->nonce_ttl ? profile->nonce_ttl : DEFAULT_NONCE_TTL) + exptime, ncl, nonce);
+		if (sofia_nonce_store_enabled(profile)) {
+			sofia_nonce_store_update(profile->nonce_store, nonce, expires, (uint32_t) ncl);
+		} else {
+			sql = switch_mprintf("update sip_authentication set expires='%ld',last_nc=%lu where nonce='%q'", expires, ncl, nonce);
 
-		switch_assert(sql != NULL);
-		sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+			switch_assert(sql != NULL);
+			sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+		}
 
 		if (ret == AUTH_OK)
 			ret = AUTH_RENEWED;
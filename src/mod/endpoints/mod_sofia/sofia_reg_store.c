@@ -0,0 +1,893 @@
+/*
+ * FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ * Copyright (C) 2005-2014, Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Version: MPL 1.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ *
+ * The Initial Developer of the Original Code is
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Portions created by the Initial Developer are Copyright (C)
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Anthony Minessale II <anthm@freeswitch.org>
+ *
+ *
+ * sofia_reg_store.c -- SOFIA SIP Endpoint (in memory registration store)
+ *
+ */
+#include "mod_sofia.h"
+
+/* one second per slot, a registration further out than this just stays in its slot for another lap */
+#define REG_WHEEL_SLOTS 4096
+#define REG_WHEEL_MASK (REG_WHEEL_SLOTS - 1)
+
+typedef enum {
+	REG_IDX_CALL_ID,
+	REG_IDX_USER,
+	REG_IDX_CONTACT,
+	REG_IDX_NETWORK,
+	REG_IDX_MAX
+} reg_idx_t;
+
+struct reg_entry_s;
+
+typedef struct reg_timer_s {
+	struct reg_entry_s *entry;
+	struct reg_timer_s *next;
+	struct reg_timer_s *prev;
+	time_t when;
+	uint32_t slot;
+	int linked;
+} reg_timer_t;
+
+typedef struct {
+	reg_timer_t *slots[REG_WHEEL_SLOTS];
+	time_t last;
+	uint32_t count;
+} reg_wheel_t;
+
+typedef struct reg_entry_s {
+	char *col[SOFIA_REG_COL_MAX];
+	char *key[REG_IDX_MAX];
+	struct reg_entry_s *inext[REG_IDX_MAX];
+	struct reg_entry_s *iprev[REG_IDX_MAX];
+	struct reg_entry_s *next;
+	struct reg_entry_s *prev;
+	struct reg_entry_s *work;
+	reg_timer_t expire_timer;
+	reg_timer_t ping_timer;
+} reg_entry_t;
+
+typedef struct reg_row_s {
+	char *col[SOFIA_REG_COL_MAX];
+	struct reg_row_s *next;
+} reg_row_t;
+
+struct sofia_reg_store {
+	switch_thread_rwlock_t *rwlock;
+	switch_hash_t *index[REG_IDX_MAX];
+	reg_entry_t *head;
+	reg_wheel_t *expire_wheel;
+	reg_wheel_t *ping_wheel;
+	int ping_interval;
+	uint32_t count;
+	uint64_t inserts;
+	uint64_t deletes;
+	uint64_t expired;
+	uint64_t pings;
+};
+
+static char *reg_col_names[] = {
+	"call_id", "sip_user", "sip_host", "contact", "status", "rpid", "expires", "user_agent", "server_user", "server_host",
+	"profile_name", "hostname", "network_ip", "network_port", "sip_username", "sip_realm", "mwi_user", "mwi_host",
+	"ping_status", "ping_time", "presence_hosts", "sub_host", "orig_server_host", "orig_hostname", "ping_count", "force_ping"
+};
+
+static void reg_timer_unlink(reg_wheel_t *wheel, reg_timer_t *timer)
+{
+	if (!timer->linked) {
+		return;
+	}
+
+	if (timer->prev) {
+		timer->prev->next = timer->next;
+	} else {
+		wheel->slots[timer->slot] = timer->next;
+	}
+
+	if (timer->next) {
+		timer->next->prev = timer->prev;
+	}
+
+	timer->next = timer->prev = NULL;
+	timer->linked = 0;
+	wheel->count--;
+}
+
+static void reg_timer_schedule(reg_wheel_t *wheel, reg_timer_t *timer, time_t when)
+{
+	time_t at = when;
+
+	reg_timer_unlink(wheel, timer);
+
+	if (when <= 0) {
+		return;
+	}
+
+	/* anything already overdue goes in the next slot to be visited */
+	if (at <= wheel->last) {
+		at = wheel->last + 1;
+	}
+
+	timer->when = when;
+	timer->slot = (uint32_t) (at & REG_WHEEL_MASK);
+	timer->prev = NULL;
+	timer->next = wheel->slots[timer->slot];
+
+	if (timer->next) {
+		timer->next->prev = timer;
+	}
+
+	wheel->slots[timer->slot] = timer;
+	timer->linked = 1;
+	wheel->count++;
+}
+
+/* unlink every timer due by now and hand them back chained on next, each slot is visited once per second passed */
+static reg_timer_t *reg_wheel_advance(reg_wheel_t *wheel, time_t now)
+{
+	reg_timer_t *due = NULL, *timer, *next;
+	time_t t, from;
+
+	if (now <= wheel->last) {
+		return NULL;
+	}
+
+	from = wheel->last + 1;
+
+	if (now - from >= REG_WHEEL_SLOTS) {
+		from = now - REG_WHEEL_SLOTS + 1;
+	}
+
+	for (t = from; t <= now; t++) {
+		for (timer = wheel->slots[t & REG_WHEEL_MASK]; timer; timer = next) {
+			next = timer->next;
+
+			if (timer->when <= now) {
+				reg_timer_unlink(wheel, timer);
+				timer->next = due;
+				due = timer;
+			}
+		}
+	}
+
+	wheel->last = now;
+
+	return due;
+}
+
+static char *reg_index_key(reg_idx_t idx, char *const *col, char *buf, switch_size_t len)
+{
+	switch (idx) {
+	case REG_IDX_CALL_ID:
+		return col[SOFIA_REG_COL_CALL_ID];
+	case REG_IDX_USER:
+		return col[SOFIA_REG_COL_SIP_USER];
+	case REG_IDX_CONTACT:
+		return col[SOFIA_REG_COL_CONTACT];
+	case REG_IDX_NETWORK:
+		if (zstr(col[SOFIA_REG_COL_NETWORK_IP])) {
+			return NULL;
+		}
+		switch_snprintf(buf, len, "%s:%s", col[SOFIA_REG_COL_NETWORK_IP], col[SOFIA_REG_COL_NETWORK_PORT]);
+		return buf;
+	default:
+		return NULL;
+	}
+}
+
+static void reg_index_link(sofia_reg_store_t *store, reg_entry_t *entry, reg_idx_t idx)
+{
+	char buf[256];
+	char *key = reg_index_key(idx, entry->col, buf, sizeof(buf));
+	reg_entry_t *head;
+
+	if (zstr(key)) {
+		return;
+	}
+
+	entry->key[idx] = strdup(key);
+	head = switch_core_hash_find(store->index[idx], key);
+
+	entry->iprev[idx] = NULL;
+	entry->inext[idx] = head;
+
+	if (head) {
+		head->iprev[idx] = entry;
+	}
+
+	switch_core_hash_insert(store->index[idx], key, entry);
+}
+
+static void reg_index_unlink(sofia_reg_store_t *store, reg_entry_t *entry, reg_idx_t idx)
+{
+	if (!entry->key[idx]) {
+		return;
+	}
+
+	if (entry->iprev[idx]) {
+		entry->iprev[idx]->inext[idx] = entry->inext[idx];
+	} else if (entry->inext[idx]) {
+		switch_core_hash_insert(store->index[idx], entry->key[idx], entry->inext[idx]);
+	} else {
+		switch_core_hash_delete(store->index[idx], entry->key[idx]);
+	}
+
+	if (entry->inext[idx]) {
+		entry->inext[idx]->iprev[idx] = entry->iprev[idx];
+	}
+
+	entry->inext[idx] = entry->iprev[idx] = NULL;
+	switch_safe_free(entry->key[idx]);
+}
+
+static void reg_entry_unlink(sofia_reg_store_t *store, reg_entry_t *entry)
+{
+	int i;
+
+	for (i = 0; i < REG_IDX_MAX; i++) {
+		reg_index_unlink(store, entry, i);
+	}
+
+	reg_timer_unlink(store->expire_wheel, &entry->expire_timer);
+	reg_timer_unlink(store->ping_wheel, &entry->ping_timer);
+
+	if (entry->prev) {
+		entry->prev->next = entry->next;
+	} else {
+		store->head = entry->next;
+	}
+
+	if (entry->next) {
+		entry->next->prev = entry->prev;
+	}
+
+	entry->next = entry->prev = NULL;
+	store->count--;
+}
+
+static void reg_entry_free(reg_entry_t *entry)
+{
+	int i;
+
+	for (i = 0; i < SOFIA_REG_COL_MAX; i++) {
+		switch_safe_free(entry->col[i]);
+	}
+
+	free(entry);
+}
+
+static void reg_schedule_ping(sofia_reg_store_t *store, reg_entry_t *entry, time_t now)
+{
+	int interval = store->ping_interval > 0 ? store->ping_interval : 1;
+
+	reg_timer_schedule(store->ping_wheel, &entry->ping_timer, now + interval / 2 + (rand() % (interval + 1)));
+}
+
+static int reg_like(const char *str, const char *needle)
+{
+	return !zstr(str) && switch_stristr(needle, str) != NULL;
+}
+
+static int reg_entry_match(reg_entry_t *entry, const sofia_reg_match_t *match)
+{
+	char **col = entry->col;
+
+	if (!match) {
+		return 1;
+	}
+
+	if (match->call_id && strcmp(col[SOFIA_REG_COL_CALL_ID], match->call_id)) {
+		return 0;
+	}
+
+	if (match->call_id_not && !strcmp(col[SOFIA_REG_COL_CALL_ID], match->call_id_not)) {
+		return 0;
+	}
+
+	if (match->user && (match->user_nocase ? strcasecmp(col[SOFIA_REG_COL_SIP_USER], match->user) : strcmp(col[SOFIA_REG_COL_SIP_USER], match->user))) {
+		return 0;
+	}
+
+	if (match->host && strcmp(col[SOFIA_REG_COL_SIP_HOST], match->host)) {
+		return 0;
+	}
+
+	if (match->host_or_presence && strcmp(col[SOFIA_REG_COL_SIP_HOST], match->host_or_presence) &&
+		!reg_like(col[SOFIA_REG_COL_PRESENCE_HOSTS], match->host_or_presence)) {
+		return 0;
+	}
+
+	if (match->username && strcmp(col[SOFIA_REG_COL_SIP_USERNAME], match->username)) {
+		return 0;
+	}
+
+	if (match->contact && strcmp(col[SOFIA_REG_COL_CONTACT], match->contact)) {
+		return 0;
+	}
+
+	if (match->contact_like && !reg_like(col[SOFIA_REG_COL_CONTACT], match->contact_like)) {
+		return 0;
+	}
+
+	if (match->exclude_contact_like && reg_like(col[SOFIA_REG_COL_CONTACT], match->exclude_contact_like)) {
+		return 0;
+	}
+
+	if (match->presence_like && !reg_like(col[SOFIA_REG_COL_PRESENCE_HOSTS], match->presence_like)) {
+		return 0;
+	}
+
+	if (match->user_agent_like && !reg_like(col[SOFIA_REG_COL_USER_AGENT], match->user_agent_like)) {
+		return 0;
+	}
+
+	if (match->network_ip && strcmp(col[SOFIA_REG_COL_NETWORK_IP], match->network_ip)) {
+		return 0;
+	}
+
+	if (match->network_port && strcmp(col[SOFIA_REG_COL_NETWORK_PORT], match->network_port)) {
+		return 0;
+	}
+
+	if (match->expires_not && !strcmp(col[SOFIA_REG_COL_EXPIRES], match->expires_not)) {
+		return 0;
+	}
+
+	if (match->expiring && atol(col[SOFIA_REG_COL_EXPIRES]) <= 0) {
+		return 0;
+	}
+
+	return 1;
+}
+
+/* pick the narrowest index the match allows, REG_IDX_MAX means walking every registration */
+static reg_entry_t *reg_first(sofia_reg_store_t *store, const sofia_reg_match_t *match, reg_idx_t *idx)
+{
+	char buf[256];
+
+	if (match && match->call_id) {
+		*idx = REG_IDX_CALL_ID;
+		return switch_core_hash_find(store->index[REG_IDX_CALL_ID], match->call_id);
+	}
+
+	if (match && match->user) {
+		*idx = REG_IDX_USER;
+		return switch_core_hash_find(store->index[REG_IDX_USER], match->user);
+	}
+
+	if (match && match->contact) {
+		*idx = REG_IDX_CONTACT;
+		return switch_core_hash_find(store->index[REG_IDX_CONTACT], match->contact);
+	}
+
+	if (match && match->network_ip && match->network_port) {
+		*idx = REG_IDX_NETWORK;
+		switch_snprintf(buf, sizeof(buf), "%s:%s", match->network_ip, match->network_port);
+		return switch_core_hash_find(store->index[REG_IDX_NETWORK], buf);
+	}
+
+	*idx = REG_IDX_MAX;
+	return store->head;
+}
+
+#define reg_next(_entry, _idx) ((_idx) == REG_IDX_MAX ? (_entry)->next : (_entry)->inext[_idx])
+
+static reg_row_t *reg_row_dup(char *const *col)
+{
+	switch_size_t len[SOFIA_REG_COL_MAX], total = sizeof(reg_row_t);
+	reg_row_t *row;
+	char *p;
+	int i;
+
+	for (i = 0; i < SOFIA_REG_COL_MAX; i++) {
+		len[i] = strlen(col[i]) + 1;
+		total += len[i];
+	}
+
+	switch_zmalloc(row, total);
+	p = (char *) (row + 1);
+
+	for (i = 0; i < SOFIA_REG_COL_MAX; i++) {
+		memcpy(p, col[i], len[i]);
+		row->col[i] = p;
+		p += len[i];
+	}
+
+	return row;
+}
+
+switch_status_t sofia_reg_store_create(sofia_reg_store_t **store, int ping_interval, switch_memory_pool_t *pool)
+{
+	sofia_reg_store_t *new_store;
+	time_t now = switch_epoch_time_now(NULL);
+
+	new_store = switch_core_alloc(pool, sizeof(*new_store));
+	new_store->expire_wheel = switch_core_alloc(pool, sizeof(reg_wheel_t));
+	new_store->ping_wheel = switch_core_alloc(pool, sizeof(reg_wheel_t));
+	new_store->expire_wheel->last = now;
+	new_store->ping_wheel->last = now;
+	new_store->ping_interval = ping_interval;
+
+	switch_thread_rwlock_create(&new_store->rwlock, pool);
+	switch_core_hash_init(&new_store->index[REG_IDX_CALL_ID]);
+	switch_core_hash_init_nocase(&new_store->index[REG_IDX_USER]);
+	switch_core_hash_init(&new_store->index[REG_IDX_CONTACT]);
+	switch_core_hash_init(&new_store->index[REG_IDX_NETWORK]);
+
+	*store = new_store;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+void sofia_reg_store_destroy(sofia_reg_store_t **store)
+{
+	sofia_reg_store_t *s = *store;
+	reg_entry_t *entry;
+	int i;
+
+	if (!s) {
+		return;
+	}
+
+	*store = NULL;
+
+	switch_thread_rwlock_wrlock(s->rwlock);
+
+	while ((entry = s->head)) {
+		reg_entry_unlink(s, entry);
+		reg_entry_free(entry);
+	}
+
+	for (i = 0; i < REG_IDX_MAX; i++) {
+		switch_core_hash_destroy(&s->index[i]);
+	}
+
+	switch_thread_rwlock_unlock(s->rwlock);
+}
+
+switch_status_t sofia_reg_store_insert(sofia_reg_store_t *store, const char *const *cols)
+{
+	reg_entry_t *entry;
+	time_t now = switch_epoch_time_now(NULL);
+	int i;
+
+	switch_zmalloc(entry, sizeof(*entry));
+
+	for (i = 0; i < SOFIA_REG_COL_MAX; i++) {
+		entry->col[i] = strdup(cols[i] ? cols[i] : "");
+	}
+
+	entry->expire_timer.entry = entry;
+	entry->ping_timer.entry = entry;
+
+	switch_thread_rwlock_wrlock(store->rwlock);
+
+	for (i = 0; i < REG_IDX_MAX; i++) {
+		reg_index_link(store, entry, i);
+	}
+
+	entry->next = store->head;
+	if (store->head) {
+		store->head->prev = entry;
+	}
+	store->head = entry;
+
+	reg_timer_schedule(store->expire_wheel, &entry->expire_timer, atol(entry->col[SOFIA_REG_COL_EXPIRES]));
+	reg_schedule_ping(store, entry, now);
+
+	store->count++;
+	store->inserts++;
+
+	switch_thread_rwlock_unlock(store->rwlock);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+/* the sip_registrations rows of one profile with the columns in SOFIA_REG_COL order, for sofia_reg_store_load_callback */
+char *sofia_reg_store_load_sql(const char *hostname, const char *profile_name)
+{
+	return switch_mprintf("select call_id,sip_user,sip_host,contact,status,rpid,expires,user_agent,server_user,server_host,"
+						  "profile_name,hostname,network_ip,network_port,sip_username,sip_realm,mwi_user,mwi_host,ping_status,ping_time,"
+						  "presence_hosts,sub_host,orig_server_host,orig_hostname,ping_count,force_ping "
+						  "from sip_registrations where hostname='%q' and profile_name='%q'", hostname, profile_name);
+}
+
+int sofia_reg_store_load_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	if (argc == SOFIA_REG_COL_MAX) {
+		sofia_reg_store_insert((sofia_reg_store_t *) pArg, (const char *const *) argv);
+	}
+
+	return 0;
+}
+
+uint32_t sofia_reg_store_update(sofia_reg_store_t *store, const sofia_reg_match_t *match, const sofia_reg_col_t *set, const char *const *vals, int nset)
+{
+	reg_entry_t *entry, *next, *hit = NULL;
+	reg_idx_t idx;
+	uint32_t count = 0;
+	int i, x;
+
+	switch_thread_rwlock_wrlock(store->rwlock);
+
+	/* collect first, rewriting an indexed column moves the entry to another chain */
+	for (entry = reg_first(store, match, &idx); entry; entry = next) {
+		next = reg_next(entry, idx);
+
+		if (reg_entry_match(entry, match)) {
+			entry->work = hit;
+			hit = entry;
+		}
+	}
+
+	for (entry = hit; entry; entry = next) {
+		next = entry->work;
+		entry->work = NULL;
+
+		for (i = 0; i < REG_IDX_MAX; i++) {
+			reg_index_unlink(store, entry, i);
+		}
+
+		for (x = 0; x < nset; x++) {
+			switch_safe_free(entry->col[set[x]]);
+			entry->col[set[x]] = strdup(vals[x] ? vals[x] : "");
+
+			if (set[x] == SOFIA_REG_COL_EXPIRES) {
+				reg_timer_schedule(store->expire_wheel, &entry->expire_timer, atol(entry->col[SOFIA_REG_COL_EXPIRES]));
+			}
+		}
+
+		for (i = 0; i < REG_IDX_MAX; i++) {
+			reg_index_link(store, entry, i);
+		}
+
+		count++;
+	}
+
+	switch_thread_rwlock_unlock(store->rwlock);
+
+	return count;
+}
+
+uint32_t sofia_reg_store_select(sofia_reg_store_t *store, const sofia_reg_match_t *match, switch_core_db_callback_func_t callback, void *pArg)
+{
+	reg_entry_t *entry;
+	reg_idx_t idx;
+	uint32_t count = 0;
+
+	switch_thread_rwlock_rdlock(store->rwlock);
+
+	for (entry = reg_first(store, match, &idx); entry; entry = reg_next(entry, idx)) {
+		if (!reg_entry_match(entry, match)) {
+			continue;
+		}
+
+		count++;
+
+		if (callback && callback(pArg, SOFIA_REG_COL_MAX, entry->col, reg_col_names)) {
+			break;
+		}
+	}
+
+	switch_thread_rwlock_unlock(store->rwlock);
+
+	return count;
+}
+
+/* the callback gets every removed row after the lock is dropped, so it may fire events and send requests */
+static uint32_t reg_store_reap(sofia_reg_store_t *store, reg_entry_t *gone, switch_core_db_callback_func_t callback, void *pArg)
+{
+	reg_entry_t *entry, *next;
+	uint32_t count = 0;
+
+	for (entry = gone; entry; entry = next) {
+		next = entry->next;
+
+		if (callback) {
+			callback(pArg, SOFIA_REG_COL_MAX, entry->col, reg_col_names);
+		}
+
+		reg_entry_free(entry);
+		count++;
+	}
+
+	return count;
+}
+
+uint32_t sofia_reg_store_delete(sofia_reg_store_t *store, const sofia_reg_match_t *match, switch_core_db_callback_func_t callback, void *pArg)
+{
+	reg_entry_t *entry, *next, *gone = NULL;
+	reg_idx_t idx;
+	uint32_t count;
+
+	switch_thread_rwlock_wrlock(store->rwlock);
+
+	for (entry = reg_first(store, match, &idx); entry; entry = next) {
+		next = reg_next(entry, idx);
+
+		if (reg_entry_match(entry, match)) {
+			reg_entry_unlink(store, entry);
+			entry->next = gone;
+			gone = entry;
+		}
+	}
+
+	switch_thread_rwlock_unlock(store->rwlock);
+
+	count = reg_store_reap(store, gone, callback, pArg);
+
+	switch_thread_rwlock_wrlock(store->rwlock);
+	store->deletes += count;
+	switch_thread_rwlock_unlock(store->rwlock);
+
+	return count;
+}
+
+uint32_t sofia_reg_store_expire(sofia_reg_store_t *store, time_t now, switch_core_db_callback_func_t callback, void *pArg)
+{
+	reg_timer_t *timer, *next;
+	reg_entry_t *gone = NULL;
+	uint32_t count;
+
+	if (!now) {
+		sofia_reg_match_t match = { 0 };
+
+		match.expiring = SWITCH_TRUE;
+		return sofia_reg_store_delete(store, &match, callback, pArg);
+	}
+
+	switch_thread_rwlock_wrlock(store->rwlock);
+
+	for (timer = reg_wheel_advance(store->expire_wheel, now); timer; timer = next) {
+		reg_entry_t *entry = timer->entry;
+
+		next = timer->next;
+		timer->next = NULL;
+
+		reg_entry_unlink(store, entry);
+		entry->next = gone;
+		gone = entry;
+	}
+
+	switch_thread_rwlock_unlock(store->rwlock);
+
+	count = reg_store_reap(store, gone, callback, pArg);
+
+	switch_thread_rwlock_wrlock(store->rwlock);
+	store->expired += count;
+	switch_thread_rwlock_unlock(store->rwlock);
+
+	return count;
+}
+
+/* the callback gets a copy of each registration due a ping and returns 0 when it sent one */
+uint32_t sofia_reg_store_ping(sofia_reg_store_t *store, time_t now, int interval, switch_core_db_callback_func_t callback, void *pArg)
+{
+	reg_timer_t *timer, *next;
+	reg_row_t *rows = NULL, *row;
+	uint32_t count = 0;
+
+	switch_thread_rwlock_wrlock(store->rwlock);
+
+	store->ping_interval = interval;
+
+	for (timer = reg_wheel_advance(store->ping_wheel, now); timer; timer = next) {
+		next = timer->next;
+		timer->next = NULL;
+
+		row = reg_row_dup(timer->entry->col);
+		row->next = rows;
+		rows = row;
+
+		reg_schedule_ping(store, timer->entry, now);
+	}
+
+	switch_thread_rwlock_unlock(store->rwlock);
+
+	while ((row = rows)) {
+		rows = row->next;
+
+		if (callback && !callback(pArg, SOFIA_REG_COL_MAX, row->col, reg_col_names)) {
+			count++;
+		}
+
+		free(row);
+	}
+
+	switch_thread_rwlock_wrlock(store->rwlock);
+	store->pings += count;
+	switch_thread_rwlock_unlock(store->rwlock);
+
+	return count;
+}
+
+/* the same selection the queries in sofia_reg_check_ping_expire make */
+switch_bool_t sofia_reg_store_ping_wanted(sofia_profile_t *profile, char *const *col)
+{
+	int ours = !strcmp(col[SOFIA_REG_COL_ORIG_HOSTNAME], mod_sofia_globals.hostname);
+	int force = atoi(col[SOFIA_REG_COL_FORCE_PING]) == 1;
+
+	if (sofia_test_pflag(profile, PFLAG_ALL_REG_OPTIONS_PING)) {
+		return ours ? SWITCH_TRUE : SWITCH_FALSE;
+	}
+
+	if (sofia_test_pflag(profile, PFLAG_UDP_NAT_OPTIONS_PING)) {
+		return (force || switch_stristr("UDP-NAT", col[SOFIA_REG_COL_STATUS])) ? SWITCH_TRUE : SWITCH_FALSE;
+	}
+
+	if (sofia_test_pflag(profile, PFLAG_NAT_OPTIONS_PING)) {
+		return (ours && (force || switch_stristr("NAT", col[SOFIA_REG_COL_STATUS]) || switch_stristr("fs_nat=yes", col[SOFIA_REG_COL_CONTACT]))) ?
+			SWITCH_TRUE : SWITCH_FALSE;
+	}
+
+	return (ours && force) ? SWITCH_TRUE : SWITCH_FALSE;
+}
+
+uint32_t sofia_reg_store_count(sofia_reg_store_t *store)
+{
+	uint32_t count;
+
+	switch_thread_rwlock_rdlock(store->rwlock);
+	count = store->count;
+	switch_thread_rwlock_unlock(store->rwlock);
+
+	return count;
+}
+
+void sofia_reg_store_status(sofia_reg_store_t *store, switch_stream_handle_t *stream)
+{
+	switch_thread_rwlock_rdlock(store->rwlock);
+	stream->write_function(stream, "REGISTRATIONS    \t%u\n", store->count);
+	stream->write_function(stream, "INSERTS          \t%" SWITCH_UINT64_T_FMT "\n", store->inserts);
+	stream->write_function(stream, "DELETES          \t%" SWITCH_UINT64_T_FMT "\n", store->deletes);
+	stream->write_function(stream, "EXPIRED          \t%" SWITCH_UINT64_T_FMT "\n", store->expired);
+	stream->write_function(stream, "PINGS            \t%" SWITCH_UINT64_T_FMT "\n", store->pings);
+	stream->write_function(stream, "EXPIRE-TIMERS    \t%u\n", store->expire_wheel->count);
+	stream->write_function(stream, "PING-TIMERS      \t%u\n", store->ping_wheel->count);
+	stream->write_function(stream, "PING-INTERVAL    \t%d\n", store->ping_interval);
+	switch_thread_rwlock_unlock(store->rwlock);
+}
+
+static void reg_bench_cols(const char **cols, char bufs[][128], uint32_t user, uint32_t gen, time_t expires)
+{
+	int i;
+
+	for (i = 0; i < SOFIA_REG_COL_MAX; i++) {
+		cols[i] = "";
+	}
+
+	switch_snprintf(bufs[0], 128, "bench-%u-%u", user, gen);
+	switch_snprintf(bufs[1], 128, "%u", 1000 + user);
+	switch_snprintf(bufs[2], 128, "<sip:%u@10.%u.%u.%u:%u;fs_nat=yes>", 1000 + user, (user >> 16) & 0xff, (user >> 8) & 0xff, user & 0xff, 5060 + gen % 100);
+	switch_snprintf(bufs[3], 128, "%ld", (long) expires);
+	switch_snprintf(bufs[4], 128, "10.%u.%u.%u", (user >> 16) & 0xff, (user >> 8) & 0xff, user & 0xff);
+	switch_snprintf(bufs[5], 128, "%u", 5060 + gen % 100);
+
+	cols[SOFIA_REG_COL_CALL_ID] = bufs[0];
+	cols[SOFIA_REG_COL_SIP_USER] = bufs[1];
+	cols[SOFIA_REG_COL_SIP_USERNAME] = bufs[1];
+	cols[SOFIA_REG_COL_SIP_HOST] = "bench.local";
+	cols[SOFIA_REG_COL_SIP_REALM] = "bench.local";
+	cols[SOFIA_REG_COL_CONTACT] = bufs[2];
+	cols[SOFIA_REG_COL_STATUS] = "Registered(UDP-NAT)";
+	cols[SOFIA_REG_COL_EXPIRES] = bufs[3];
+	cols[SOFIA_REG_COL_NETWORK_IP] = bufs[4];
+	cols[SOFIA_REG_COL_NETWORK_PORT] = bufs[5];
+	cols[SOFIA_REG_COL_PROFILE_NAME] = "bench";
+	cols[SOFIA_REG_COL_PING_STATUS] = "Reachable";
+	cols[SOFIA_REG_COL_PING_COUNT] = "0";
+	cols[SOFIA_REG_COL_FORCE_PING] = "0";
+}
+
+static int reg_bench_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	(*(uint32_t *) pArg)++;
+	return 0;
+}
+
+/* re-registration storm against a private store: every endpoint refreshes, a third of them
+   from a new call-id the way rebooting phones do, with a lookup per refresh and the expiry sweeps in between */
+void sofia_reg_store_bench(uint32_t count, uint32_t rounds, switch_stream_handle_t *stream)
+{
+	switch_memory_pool_t *pool = NULL;
+	sofia_reg_store_t *store = NULL;
+	const char *cols[SOFIA_REG_COL_MAX];
+	char bufs[6][128];
+	sofia_reg_col_t set[] = { SOFIA_REG_COL_EXPIRES, SOFIA_REG_COL_NETWORK_PORT };
+	const char *vals[2];
+	switch_time_t start;
+	time_t now = switch_epoch_time_now(NULL);
+	uint32_t u, r, seen = 0, hits = 0, expired = 0, pinged = 0;
+
+	switch_core_new_memory_pool(&pool);
+	sofia_reg_store_create(&store, 30, pool);
+
+	start = switch_micro_time_now();
+	for (u = 0; u < count; u++) {
+		reg_bench_cols(cols, bufs, u, 0, now + 60 + u % 3600);
+		sofia_reg_store_insert(store, cols);
+	}
+	stream->write_function(stream, "insert   %8u registrations: %8.3f us each\n", count,
+						   (switch_micro_time_now() - start) / (double) (count ? count : 1));
+
+	for (r = 1; r <= rounds; r++) {
+		now += 60;
+		start = switch_micro_time_now();
+
+		for (u = 0; u < count; u++) {
+			sofia_reg_match_t match = { 0 };
+
+			reg_bench_cols(cols, bufs, u, r, now + 60 + u % 3600);
+
+			match.user = cols[SOFIA_REG_COL_SIP_USER];
+			match.host = "bench.local";
+
+			if (u % 3) {
+				vals[0] = cols[SOFIA_REG_COL_EXPIRES];
+				vals[1] = cols[SOFIA_REG_COL_NETWORK_PORT];
+				if (!sofia_reg_store_update(store, &match, set, vals, 2)) {
+					sofia_reg_store_insert(store, cols);
+				}
+			} else {
+				sofia_reg_store_delete(store, &match, NULL, NULL);
+				sofia_reg_store_insert(store, cols);
+			}
+
+			match.host = NULL;
+			match.host_or_presence = "bench.local";
+			hits += sofia_reg_store_select(store, &match, NULL, NULL);
+		}
+
+		stream->write_function(stream, "storm %3u %8u re-registrations: %8.3f us each\n", r, count,
+							   (switch_micro_time_now() - start) / (double) (count ? count : 1));
+
+		start = switch_micro_time_now();
+		expired += sofia_reg_store_expire(store, now, reg_bench_callback, &seen);
+		pinged += sofia_reg_store_ping(store, now, 30, reg_bench_callback, &seen);
+		stream->write_function(stream, "sweep %3u: %8.3f ms\n", r, (switch_micro_time_now() - start) / 1000.0);
+	}
+
+	start = switch_micro_time_now();
+	expired += sofia_reg_store_expire(store, now + 7200, NULL, NULL);
+	stream->write_function(stream, "expire   %8u registrations: %8.3f ms\n", expired, (switch_micro_time_now() - start) / 1000.0);
+	stream->write_function(stream, "lookups hit %u, pings due %u, left %u\n", hits, pinged, sofia_reg_store_count(store));
+
+	sofia_reg_store_destroy(&store);
+	switch_core_destroy_memory_pool(&pool);
+}
+
+/* For Emacs:
+ * Local Variables:
+ * mode:c
+ * indent-tabs-mode:t
+ * tab-width:4
+ * c-basic-offset:4
+ * End:
+ * For VIM:
+ * vim:set softtabstop=4 shiftwidth=4 tabstop=4 noet:
+ */
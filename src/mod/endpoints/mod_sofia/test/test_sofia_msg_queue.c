@@ -0,0 +1,92 @@
+#include "mod_sofia.h"
+#include <tap.h>
+
+#define QUEUES 8
+
+static sip_t *make_sip(sip_t *sip, sip_call_id_t *cid, sip_to_t *to, const char *call_id, const char *to_tag)
+{
+  memset(sip, 0, sizeof(*sip));
+  memset(cid, 0, sizeof(*cid));
+  memset(to, 0, sizeof(*to));
+
+  cid->i_id = call_id;
+  to->a_tag = to_tag;
+
+  sip->sip_call_id = call_id ? cid : NULL;
+  sip->sip_to = to;
+
+  return sip;
+}
+
+int main () {
+  sip_t sip;
+  sip_call_id_t cid;
+  sip_to_t to;
+  sofia_private_t bound;
+  int handles[4], used[QUEUES] = { 0 };
+  const char *err = NULL;
+  char call_id[64];
+  int x, q, wrong = 0, spread = 0;
+
+  plan(10);
+
+  if (!ok(switch_core_init(SCF_MINIMAL, SWITCH_TRUE, &err) == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+  memset(&bound, 0, sizeof(bound));
+  bound.call_id = "reg-1@example.com";
+
+  /* a call-id keeps every event of a dialog on one worker whichever handle raised it */
+  for (x = 0; x < 1000; x++) {
+    switch_snprintf(call_id, sizeof(call_id), "%d@example.com", x);
+    make_sip(&sip, &cid, &to, call_id, NULL);
+    q = sofia_msg_queue_select(nua_i_invite, &sip, NULL, &handles[0], QUEUES, SWITCH_TRUE);
+
+    if (q != sofia_msg_queue_select(nua_i_bye, &sip, NULL, &handles[1], QUEUES, SWITCH_TRUE) ||
+        q != sofia_msg_queue_select(nua_r_invite, &sip, &bound, &handles[2], QUEUES, SWITCH_FALSE)) {
+      wrong++;
+    }
+
+    if (q >= 0 && q < QUEUES && !used[q]++) {
+      spread++;
+    }
+  }
+  ok(wrong == 0, "the message call-id picks the worker");
+  ok(spread == QUEUES, "call-ids spread over all %d workers", QUEUES);
+
+  /* nua raises these without a message, they must follow the rest of their handle */
+  make_sip(&sip, &cid, &to, bound.call_id, NULL);
+  q = sofia_msg_queue_select(nua_r_register, &sip, &bound, &handles[0], QUEUES, SWITCH_TRUE);
+  ok(sofia_msg_queue_select(nua_i_terminated, NULL, &bound, &handles[0], QUEUES, SWITCH_TRUE) == q,
+     "an event without a message follows the call-id its handle is bound with");
+
+  for (x = 0, wrong = 0; x < 100; x++) {
+    if (sofia_msg_queue_select(nua_i_state, NULL, NULL, &handles[3], QUEUES, SWITCH_TRUE) !=
+        sofia_msg_queue_select(nua_i_terminated, NULL, NULL, &handles[3], QUEUES, SWITCH_TRUE) ||
+        sofia_msg_queue_select(nua_r_options, NULL, NULL, &handles[3], QUEUES, SWITCH_TRUE) < 0) {
+      wrong++;
+    }
+  }
+  ok(wrong == 0, "events of an unbound handle all go to that handle's worker, never the steal queue");
+
+  ok(sofia_msg_queue_select(nua_i_state, NULL, &mod_sofia_globals.destroy_private, &handles[3], QUEUES, SWITCH_TRUE) ==
+     sofia_msg_queue_select(nua_i_state, NULL, NULL, &handles[3], QUEUES, SWITCH_TRUE), "the shared private markers are not a call-id");
+
+  /* only pings outside a dialog may be stolen */
+  make_sip(&sip, &cid, &to, "ping@example.com", NULL);
+  ok(sofia_msg_queue_select(nua_i_options, &sip, NULL, &handles[0], QUEUES, SWITCH_TRUE) == -1, "out of dialog OPTIONS can be stolen");
+  ok(sofia_msg_queue_select(nua_i_options, &sip, NULL, &handles[0], QUEUES, SWITCH_FALSE) >= 0, "nothing is stolen with stealing off");
+
+  make_sip(&sip, &cid, &to, "dialog@example.com", "totag");
+  q = sofia_msg_queue_select(nua_i_info, &sip, NULL, &handles[0], QUEUES, SWITCH_TRUE);
+  ok(sofia_msg_queue_select(nua_i_options, &sip, NULL, &handles[0], QUEUES, SWITCH_TRUE) == q, "in dialog OPTIONS stay with their dialog");
+
+  make_sip(&sip, &cid, &to, NULL, NULL);
+  ok(sofia_msg_queue_select(nua_i_message, &sip, NULL, &handles[1], QUEUES, SWITCH_TRUE) ==
+     sofia_msg_queue_select(nua_i_terminated, NULL, NULL, &handles[1], QUEUES, SWITCH_TRUE), "a message without a call-id follows its handle");
+
+  switch_core_destroy();
+
+  done_testing();
+}
@@ -0,0 +1,85 @@
+#include <switch.h>
+#include <tap.h>
+
+/* the store only needs the core, build it in place instead of loading the whole endpoint */
+#include "../sofia_nonce_store.c"
+
+struct mod_sofia_globals mod_sofia_globals;
+
+/* only the sql half of the bench talks to a profile, it is never run here */
+void sofia_glue_execute_sql_now(sofia_profile_t *profile, char **sqlp, switch_bool_t sql_already_dynamic)
+{
+  switch_safe_free(*sqlp);
+}
+
+switch_bool_t sofia_glue_execute_sql_callback(sofia_profile_t *profile, switch_mutex_t *mutex, char *sql, switch_core_db_callback_func_t callback,
+                                              void *pdata)
+{
+  return SWITCH_FALSE;
+}
+
+int main () {
+  switch_memory_pool_t *pool = NULL;
+  sofia_nonce_store_t *store = NULL;
+  char stateful[80], tracked[80], revoked[80], forged[80], stale[80];
+  const char *err = NULL;
+  uint32_t last_nc = 0;
+  time_t now;
+
+  plan(17);
+
+  if (!ok(switch_core_init(SCF_MINIMAL, SWITCH_TRUE, &err) == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+  switch_core_new_memory_pool(&pool);
+  sofia_nonce_store_create(&store, pool);
+  sofia_nonce_store_set_secret(store, "unit-test-secret");
+  now = switch_epoch_time_now(NULL);
+
+  /* a stateful nonce lives in the table from the challenge on */
+  sofia_nonce_store_issue(store, SWITCH_FALSE, now + 60, stateful, sizeof(stateful));
+  ok(sofia_nonce_store_check(store, stateful, 1, &last_nc) == SWITCH_STATUS_SUCCESS && last_nc == 0, "stateful nonce answered once");
+  sofia_nonce_store_update(store, stateful, now + 60, 1);
+  ok(sofia_nonce_store_check(store, stateful, 1, &last_nc) != SWITCH_STATUS_SUCCESS, "stateful replay of nc 1 refused");
+  ok(sofia_nonce_store_check(store, stateful, 2, &last_nc) == SWITCH_STATUS_SUCCESS && last_nc == 1, "stateful nc 2 accepted");
+  ok(sofia_nonce_store_check(store, "00000000-0000-0000-0000-000000000000", 1, &last_nc) != SWITCH_STATUS_SUCCESS,
+     "a nonce nobody issued is refused");
+
+  /* a stateless nonce is only tracked once it is answered */
+  sofia_nonce_store_issue(store, SWITCH_TRUE, now + 60, tracked, sizeof(tracked));
+  ok(strlen(tracked) == NONCE_STATELESS_LEN, "stateless nonce carries its own expiry and mac");
+  ok(sofia_nonce_store_check(store, tracked, 1, &last_nc) == SWITCH_STATUS_SUCCESS, "stateless nonce answered once");
+  sofia_nonce_store_update(store, tracked, now + 60, 1);
+  ok(sofia_nonce_store_check(store, tracked, 1, &last_nc) != SWITCH_STATUS_SUCCESS, "stateless replay of nc 1 refused");
+
+  switch_copy_string(forged, tracked, sizeof(forged));
+  forged[NONCE_STATELESS_LEN - 1] = forged[NONCE_STATELESS_LEN - 1] == '0' ? '1' : '0';
+  ok(sofia_nonce_store_check(store, forged, 1, &last_nc) != SWITCH_STATUS_SUCCESS, "a nonce with a bad mac is refused");
+
+  sofia_nonce_store_issue(store, SWITCH_TRUE, now - 1, stale, sizeof(stale));
+  ok(sofia_nonce_store_check(store, stale, 1, &last_nc) != SWITCH_STATUS_SUCCESS, "a stateless nonce past its expiry is refused");
+
+  /* revoking a stateless nonce leaves a tombstone behind */
+  sofia_nonce_store_issue(store, SWITCH_TRUE, now + 60, revoked, sizeof(revoked));
+  sofia_nonce_store_check(store, revoked, 1, &last_nc);
+  sofia_nonce_store_delete(store, revoked);
+  ok(sofia_nonce_store_check(store, revoked, 2, &last_nc) != SWITCH_STATUS_SUCCESS, "a revoked stateless nonce is refused");
+
+  /* flush-all and check_sync expire with 0, that must not hand replays back to stateless nonces */
+  ok(sofia_nonce_store_expire(store, 0) == 1, "expire 0 drops only the stateful nonce");
+  ok(sofia_nonce_store_check(store, stateful, 3, &last_nc) != SWITCH_STATUS_SUCCESS, "the flushed stateful nonce is gone");
+  ok(sofia_nonce_store_check(store, tracked, 1, &last_nc) != SWITCH_STATUS_SUCCESS, "stateless replay still refused after expire 0");
+  ok(sofia_nonce_store_check(store, revoked, 3, &last_nc) != SWITCH_STATUS_SUCCESS, "revocation survives expire 0");
+  ok(sofia_nonce_store_check(store, tracked, 2, &last_nc) == SWITCH_STATUS_SUCCESS && last_nc == 1,
+     "stateless nc tracking survives expire 0");
+
+  ok(sofia_nonce_store_expire(store, now + 61) == 2, "stateless entries go once their mac runs out");
+
+  sofia_nonce_store_destroy(&store);
+  switch_core_destroy_memory_pool(&pool);
+
+  switch_core_destroy();
+
+  done_testing();
+}
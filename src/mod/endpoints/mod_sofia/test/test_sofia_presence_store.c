@@ -0,0 +1,227 @@
+#include <switch.h>
+#include <tap.h>
+
+/* the store only needs the core, build it in place instead of loading the whole endpoint */
+#include "../sofia_presence_store.c"
+
+struct mod_sofia_globals mod_sofia_globals;
+
+struct pres_seen {
+  uint32_t count;
+  char ids[256];
+};
+
+static int sub_seen_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+  struct pres_seen *seen = (struct pres_seen *) pArg;
+
+  seen->count++;
+  switch_snprintf(seen->ids + strlen(seen->ids), sizeof(seen->ids) - strlen(seen->ids), "%s ", argv[SOFIA_SUB_COL_CALL_ID]);
+
+  return 0;
+}
+
+static int dlg_seen_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+  struct pres_seen *seen = (struct pres_seen *) pArg;
+
+  seen->count++;
+  switch_snprintf(seen->ids + strlen(seen->ids), sizeof(seen->ids) - strlen(seen->ids), "%s ", argv[SOFIA_DLG_COL_UUID]);
+
+  return 0;
+}
+
+static int sub_version_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+  struct pres_seen *seen = (struct pres_seen *) pArg;
+
+  seen->count++;
+  switch_copy_string(seen->ids, argv[SOFIA_SUB_COL_VERSION], sizeof(seen->ids));
+
+  return 0;
+}
+
+static void sub_insert(sofia_presence_store_t *store, const char *call_id, const char *to_user, const char *version)
+{
+  const char *cols[SOFIA_SUB_COL_MAX] = { 0 };
+
+  cols[SOFIA_SUB_COL_PROTO] = "sip";
+  cols[SOFIA_SUB_COL_SUB_TO_USER] = to_user;
+  cols[SOFIA_SUB_COL_SUB_TO_HOST] = "example.com";
+  cols[SOFIA_SUB_COL_EVENT] = "dialog";
+  cols[SOFIA_SUB_COL_CALL_ID] = call_id;
+  cols[SOFIA_SUB_COL_EXPIRES] = "3600";
+  cols[SOFIA_SUB_COL_VERSION] = version;
+
+  sofia_presence_store_sub_insert(store, cols);
+}
+
+static void dlg_insert(sofia_presence_store_t *store, const char *uuid, const char *user, const char *presence_id, const char *rcd)
+{
+  const char *cols[SOFIA_DLG_COL_MAX] = { 0 };
+
+  cols[SOFIA_DLG_COL_STATE] = "early";
+  cols[SOFIA_DLG_COL_UUID] = uuid;
+  cols[SOFIA_DLG_COL_CALL_ID] = uuid;
+  cols[SOFIA_DLG_COL_SIP_FROM_USER] = user;
+  cols[SOFIA_DLG_COL_SIP_FROM_HOST] = "example.com";
+  cols[SOFIA_DLG_COL_PRESENCE_ID] = presence_id;
+  cols[SOFIA_DLG_COL_RCD] = rcd;
+
+  sofia_presence_store_dialog_insert(store, cols);
+}
+
+static uint32_t sub_count_to(sofia_presence_store_t *store, const char *to_user)
+{
+  sofia_sub_match_t match = { 0 };
+
+  match.sub_to_user = to_user;
+
+  return sofia_presence_store_sub_select(store, &match, SWITCH_FALSE, NULL, NULL);
+}
+
+static uint32_t dlg_select_for(sofia_presence_store_t *store, const char *user, struct pres_seen *seen)
+{
+  sofia_dlg_match_t match = { 0 };
+
+  match.user = user;
+  match.host = "example.com";
+  memset(seen, 0, sizeof(*seen));
+
+  return sofia_presence_store_dialog_select(store, &match, dlg_seen_callback, seen);
+}
+
+static sofia_presence_notify_t *make_notify(sofia_presence_notify_t *notify, const char *call_id, const char *pl)
+{
+  memset(notify, 0, sizeof(*notify));
+  notify->call_id = (char *) call_id;
+  notify->event = "dialog";
+  notify->pl = (char *) pl;
+
+  return notify;
+}
+
+int main () {
+  switch_memory_pool_t *pool = NULL;
+  sofia_presence_store_t *store = NULL;
+  sofia_sub_match_t match = { 0 };
+  sofia_dlg_match_t dmatch = { 0 };
+  sofia_sub_col_t sset[] = { SOFIA_SUB_COL_SUB_TO_USER };
+  sofia_dlg_col_t dset[] = { SOFIA_DLG_COL_SIP_FROM_USER, SOFIA_DLG_COL_PRESENCE_ID };
+  const char *vals[2];
+  sofia_presence_notify_t notify, *due;
+  switch_interval_time_t interval = 60000000;
+  struct pres_seen seen;
+  const char *err = NULL;
+  uint32_t held;
+
+  plan(20);
+
+  if (!ok(switch_core_init(SCF_MINIMAL, SWITCH_TRUE, &err) == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+  switch_core_new_memory_pool(&pool);
+  sofia_presence_store_create(&store, pool);
+
+  /* three watchers of 1000 so its chain is s3 s2 s1, one of 1001 */
+  sub_insert(store, "s1", "1000", "0");
+  sub_insert(store, "s2", "1000", "0");
+  sub_insert(store, "s3", "1000", "0");
+  sub_insert(store, "s4", "1001", "0");
+  ok(sub_count_to(store, "1000") == 3 && sub_count_to(store, "1001") == 1, "watchers found by the user they watch");
+
+  sub_insert(store, "s2", "1000", "5");
+  memset(&seen, 0, sizeof(seen));
+  match.call_id = "s2";
+  ok(sofia_presence_store_sub_select(store, &match, SWITCH_FALSE, sub_seen_callback, &seen) == 1 && sub_count_to(store, "1000") == 3,
+     "a re-SUBSCRIBE replaces the subscription under its call-id");
+
+  /* the chain is s2 s3 s1 now, move its tail and then its middle to another user */
+  vals[0] = "1001";
+  match.call_id = "s1";
+  ok(sofia_presence_store_sub_update(store, &match, sset, vals, 1) == 1, "update by call-id hits one subscription");
+  match.call_id = "s3";
+  sofia_presence_store_sub_update(store, &match, sset, vals, 1);
+  ok(sub_count_to(store, "1000") == 1 && sub_count_to(store, "1001") == 3, "moved subscriptions relink on their new user");
+
+  memset(&seen, 0, sizeof(seen));
+  match.call_id = NULL;
+  match.sub_to_user = "1000";
+  sofia_presence_store_sub_select(store, &match, SWITCH_FALSE, sub_seen_callback, &seen);
+  ok(!strcmp(seen.ids, "s2 "), "the old chain keeps only what stayed, got %s", seen.ids);
+
+  match.call_id = "s4";
+  match.sub_to_user = NULL;
+  ok(sofia_presence_store_sub_delete(store, &match) == 1 && sub_count_to(store, "1001") == 2 && sofia_presence_store_sub_select(store, NULL, SWITCH_FALSE, NULL, NULL) == 3,
+     "deleting the tail of a chain keeps the rest of it");
+
+  match.call_id = NULL;
+  match.sub_to_user = "1001";
+  sofia_presence_store_sub_select(store, &match, SWITCH_TRUE, NULL, NULL);
+  memset(&seen, 0, sizeof(seen));
+  match.sub_to_user = NULL;
+  match.call_id = "s1";
+  sofia_presence_store_sub_select(store, &match, SWITCH_FALSE, sub_version_callback, &seen);
+  ok(seen.count == 1 && !strcmp(seen.ids, "1"), "a bumping select raises the version, got %s", seen.ids);
+
+  /* dialogs come back newest first, the same second falls back to the order they were stored in */
+  dlg_insert(store, "d1", "1000", "1000@example.com", "100");
+  dlg_insert(store, "d2", "1000", "1000@example.com", "300");
+  dlg_insert(store, "d3", "2000", "1000@example.com", "200");
+  dlg_insert(store, "d4", "1000", "1000@example.com", "300");
+  dlg_insert(store, "d5", "2000", "2000@example.com", "400");
+
+  ok(dlg_select_for(store, "1000", &seen) == 4 && !strcmp(seen.ids, "d4 d2 d3 d1 "),
+     "dialogs by from user or presence id ordered by rcd desc, got %s", seen.ids);
+  ok(dlg_select_for(store, "2000", &seen) == 2 && !strcmp(seen.ids, "d5 d3 "),
+     "a dialog on both chains of a user is not counted twice, got %s", seen.ids);
+
+  vals[0] = "3000";
+  vals[1] = "3000@example.com";
+  dmatch.uuid = "d2";
+  ok(sofia_presence_store_dialog_update(store, &dmatch, dset, vals, 2) == 1, "update by uuid hits one dialog");
+  ok(dlg_select_for(store, "1000", &seen) == 3 && !strcmp(seen.ids, "d4 d3 d1 ") &&
+     dlg_select_for(store, "3000", &seen) == 1 && !strcmp(seen.ids, "d2 "), "a moved dialog relinks on its new user and presence id");
+
+  dmatch.uuid = NULL;
+  dmatch.call_id = "d3";
+  ok(sofia_presence_store_dialog_delete(store, &dmatch) == 1 && dlg_select_for(store, "1000", &seen) == 2 &&
+     dlg_select_for(store, "2000", &seen) == 1, "deleting a dialog unlinks it from every index");
+
+  /* one NOTIFY per interval, anything newer is held and the latest held wins */
+  held = sofia_presence_store_held();
+  ok(!sofia_presence_store_hold_notify(store, make_notify(&notify, "s1", "v1"), interval), "the first NOTIFY goes out");
+  ok(sofia_presence_store_hold_notify(store, make_notify(&notify, "s1", "v2"), interval) &&
+     sofia_presence_store_hold_notify(store, make_notify(&notify, "s1", "v3"), interval) && sofia_presence_store_held() == held + 1,
+     "NOTIFYs inside the interval are held as one");
+  ok(!sofia_presence_store_due_notifies(store, switch_micro_time_now()), "nothing is due before the interval ends");
+
+  due = sofia_presence_store_due_notifies(store, switch_micro_time_now() + interval);
+  ok(due && !due->next && !strcmp(due->pl, "v3") && sofia_presence_store_held() == held, "the latest held NOTIFY comes out once due");
+  sofia_presence_store_free_notify(due);
+
+  /* a NOTIFY sent around the hold makes anything held for that subscriber stale */
+  sofia_presence_store_hold_notify(store, make_notify(&notify, "s3", "v1"), interval);
+  sofia_presence_store_hold_notify(store, make_notify(&notify, "s3", "v2"), interval);
+  sofia_presence_store_notify_sent(store, "s3");
+  ok(sofia_presence_store_held() == held && !sofia_presence_store_due_notifies(store, switch_micro_time_now() + interval * 2),
+     "a direct NOTIFY drops the held one");
+
+  sofia_presence_store_hold_notify(store, make_notify(&notify, "s2", "v1"), interval);
+  sofia_presence_store_hold_notify(store, make_notify(&notify, "s2", "v2"), interval);
+  ok(!sofia_presence_store_hold_notify(store, make_notify(&notify, "s2", "v3"), 0) && sofia_presence_store_held() == held,
+     "with holding off a NOTIFY goes out and drops the held one");
+
+  sofia_presence_store_hold_notify(store, make_notify(&notify, "s1", "v4"), interval);
+  match.call_id = "s1";
+  sofia_presence_store_sub_delete(store, &match);
+  ok(sofia_presence_store_held() == held, "unsubscribing drops what was held for it");
+
+  sofia_presence_store_destroy(&store);
+  switch_core_destroy_memory_pool(&pool);
+
+  switch_core_destroy();
+
+  done_testing();
+}
@@ -0,0 +1,239 @@
+#include <switch.h>
+#include <tap.h>
+
+/* the store only needs the core, build it in place instead of loading the whole endpoint */
+#include "../sofia_reg_store.c"
+
+struct mod_sofia_globals mod_sofia_globals;
+
+struct reg_seen {
+  uint32_t count;
+  char call_ids[256];
+};
+
+static int reg_seen_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+  struct reg_seen *seen = (struct reg_seen *) pArg;
+
+  seen->count++;
+  switch_snprintf(seen->call_ids + strlen(seen->call_ids), sizeof(seen->call_ids) - strlen(seen->call_ids), "%s ", argv[SOFIA_REG_COL_CALL_ID]);
+
+  return 0;
+}
+
+static int reg_refuse_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+  return 1;
+}
+
+static void reg_insert(sofia_reg_store_t *store, const char *call_id, const char *user, const char *contact, const char *ip, time_t expires)
+{
+  const char *cols[SOFIA_REG_COL_MAX] = { 0 };
+  char buf[32];
+
+  switch_snprintf(buf, sizeof(buf), "%ld", (long) expires);
+
+  cols[SOFIA_REG_COL_CALL_ID] = call_id;
+  cols[SOFIA_REG_COL_SIP_USER] = user;
+  cols[SOFIA_REG_COL_SIP_HOST] = "example.com";
+  cols[SOFIA_REG_COL_CONTACT] = contact;
+  cols[SOFIA_REG_COL_EXPIRES] = buf;
+  cols[SOFIA_REG_COL_NETWORK_IP] = ip;
+  cols[SOFIA_REG_COL_NETWORK_PORT] = "5060";
+
+  sofia_reg_store_insert(store, cols);
+}
+
+/* what a restart finds in the sip_registrations mirror, one row of another profile */
+static void reg_seed(sofia_reg_store_t *store, switch_core_db_t *db)
+{
+  char *sql = sofia_reg_store_load_sql("here", "internal");
+
+  switch_core_db_exec(db, sql, sofia_reg_store_load_callback, store, NULL);
+  switch_safe_free(sql);
+}
+
+static uint32_t reg_count_by(sofia_reg_store_t *store, const char *user, const char *contact, const char *ip)
+{
+  sofia_reg_match_t match = { 0 };
+
+  match.user = user;
+  match.contact = contact;
+  match.network_ip = ip;
+  match.network_port = ip ? "5060" : NULL;
+
+  return sofia_reg_store_select(store, &match, NULL, NULL);
+}
+
+int main () {
+  switch_memory_pool_t *pool = NULL;
+  sofia_reg_store_t *store = NULL;
+  sofia_reg_match_t match = { 0 };
+  sofia_reg_col_t set[3] = { SOFIA_REG_COL_SIP_USER, SOFIA_REG_COL_CONTACT, SOFIA_REG_COL_NETWORK_IP };
+  const char *vals[3];
+  char expires[32];
+  struct reg_seen seen;
+  static sofia_profile_t profile;
+  switch_core_db_t *db = NULL;
+  const char *err = NULL;
+  time_t now;
+  char *col[SOFIA_REG_COL_MAX];
+  int i, wrong = 0;
+  /* flag, status, contact, orig hostname, force ping, wanted */
+  static const struct {
+    PFLAGS flag;
+    const char *status;
+    const char *contact;
+    const char *hostname;
+    const char *force;
+    switch_bool_t wanted;
+  } pings[] = {
+    { PFLAG_ALL_REG_OPTIONS_PING, "Registered(UDP)", "sip:a@1.1.1.1", "here", "0", SWITCH_TRUE },
+    { PFLAG_ALL_REG_OPTIONS_PING, "Registered(UDP)", "sip:a@1.1.1.1", "there", "1", SWITCH_FALSE },
+    { PFLAG_UDP_NAT_OPTIONS_PING, "Registered(UDP-NAT)", "sip:a@1.1.1.1", "there", "0", SWITCH_TRUE },
+    { PFLAG_UDP_NAT_OPTIONS_PING, "Registered(TCP-NAT)", "sip:a@1.1.1.1", "here", "0", SWITCH_FALSE },
+    { PFLAG_NAT_OPTIONS_PING, "Registered(TCP-NAT)", "sip:a@1.1.1.1", "here", "0", SWITCH_TRUE },
+    { PFLAG_NAT_OPTIONS_PING, "Registered(UDP)", "sip:a@1.1.1.1;fs_nat=yes", "here", "0", SWITCH_TRUE },
+    { PFLAG_NAT_OPTIONS_PING, "Registered(UDP-NAT)", "sip:a@1.1.1.1", "there", "1", SWITCH_FALSE },
+    { PFLAG_NAT_OPTIONS_PING, "Registered(UDP)", "sip:a@1.1.1.1", "here", "0", SWITCH_FALSE },
+    { PFLAG_MAX, "Registered(UDP)", "sip:a@1.1.1.1", "here", "1", SWITCH_TRUE },
+    { PFLAG_MAX, "Registered(UDP-NAT)", "sip:a@1.1.1.1", "here", "0", SWITCH_FALSE }
+  };
+
+  plan(21);
+
+  if (!ok(switch_core_init(SCF_MINIMAL, SWITCH_TRUE, &err) == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+  switch_core_new_memory_pool(&pool);
+  sofia_reg_store_create(&store, 30, pool);
+  now = switch_epoch_time_now(NULL);
+
+  /* alice twice so the user index has a chain, bob once; c2 ends up at the head of alice's chain */
+  reg_insert(store, "c1", "alice", "sip:alice@10.0.0.1", "10.0.0.1", now + 60);
+  reg_insert(store, "c2", "alice", "sip:alice@10.0.0.2", "10.0.0.2", now + 120);
+  reg_insert(store, "c3", "bob", "sip:bob@10.0.0.3", "10.0.0.3", now + 30);
+
+  ok(sofia_reg_store_count(store) == 3 && reg_count_by(store, "alice", NULL, NULL) == 2, "three registrations, two for alice");
+
+  /* rewrite every indexed column of the chain tail, then of the chain head */
+  vals[0] = "carol";
+  vals[1] = "sip:carol@10.0.0.9";
+  vals[2] = "10.0.0.9";
+  match.call_id = "c1";
+  ok(sofia_reg_store_update(store, &match, set, vals, 3) == 1, "update by call-id hits one registration");
+  ok(reg_count_by(store, "alice", NULL, NULL) == 1 && reg_count_by(store, "carol", NULL, NULL) == 1,
+     "user index follows the new user");
+  ok(reg_count_by(store, NULL, "sip:alice@10.0.0.1", NULL) == 0 && reg_count_by(store, NULL, "sip:carol@10.0.0.9", NULL) == 1,
+     "contact index follows the new contact");
+  ok(reg_count_by(store, NULL, NULL, "10.0.0.1") == 0 && reg_count_by(store, NULL, NULL, "10.0.0.9") == 1,
+     "network index follows the new address");
+
+  vals[0] = "dave";
+  match.call_id = "c2";
+  sofia_reg_store_update(store, &match, set, vals, 1);
+  ok(reg_count_by(store, "alice", NULL, NULL) == 0 && reg_count_by(store, "dave", NULL, NULL) == 1 &&
+     reg_count_by(store, NULL, "sip:alice@10.0.0.2", NULL) == 1, "moving the head of a chain leaves the other indexes alone");
+
+  /* expiry comes off the wheel, an update reschedules */
+  switch_snprintf(expires, sizeof(expires), "%ld", (long) (now + 200));
+  set[0] = SOFIA_REG_COL_EXPIRES;
+  vals[0] = expires;
+  match.call_id = "c1";
+  sofia_reg_store_update(store, &match, set, vals, 1);
+
+  memset(&seen, 0, sizeof(seen));
+  ok(sofia_reg_store_expire(store, now + 5, reg_seen_callback, &seen) == 0, "nothing due yet");
+
+  memset(&seen, 0, sizeof(seen));
+  ok(sofia_reg_store_expire(store, now + 61, reg_seen_callback, &seen) == 1 && !strcmp(seen.call_ids, "c3 "),
+     "bob expires on time and c1 was moved past its old slot, got %s", seen.call_ids);
+
+  memset(&seen, 0, sizeof(seen));
+  ok(sofia_reg_store_expire(store, now + 121, reg_seen_callback, &seen) == 1 && !strcmp(seen.call_ids, "c2 "),
+     "c2 expires on time, got %s", seen.call_ids);
+
+  reg_insert(store, "c4", "erin", "sip:erin@10.0.0.4", "10.0.0.4", now + 5000);
+  reg_insert(store, "c5", "frank", "sip:frank@10.0.0.5", "10.0.0.5", 0);
+
+  memset(&seen, 0, sizeof(seen));
+  ok(sofia_reg_store_expire(store, now + 4200, reg_seen_callback, &seen) == 1 && !strcmp(seen.call_ids, "c1 "),
+     "a full lap of the wheel only takes what is due, got %s", seen.call_ids);
+
+  memset(&seen, 0, sizeof(seen));
+  ok(sofia_reg_store_expire(store, now + 5001, reg_seen_callback, &seen) == 1 && !strcmp(seen.call_ids, "c4 "),
+     "a registration further out than the wheel waits its extra lap, got %s", seen.call_ids);
+  ok(sofia_reg_store_count(store) == 1 && reg_count_by(store, "frank", NULL, NULL) == 1, "expires 0 never comes off the wheel");
+
+  reg_insert(store, "c6", "gina", "sip:gina@10.0.0.6", "10.0.0.6", now + 10000);
+  ok(sofia_reg_store_expire(store, 0, NULL, NULL) == 1 && sofia_reg_store_count(store) == 1, "expire 0 drops everything still counting down");
+
+  /* pings come round once per interval with jitter, inside [interval / 2, interval * 1.5] */
+  reg_insert(store, "c7", "hank", "sip:hank@10.0.0.7", "10.0.0.7", now + 100000);
+  reg_insert(store, "c8", "ivan", "sip:ivan@10.0.0.8", "10.0.0.8", now + 100000);
+
+  memset(&seen, 0, sizeof(seen));
+  ok(sofia_reg_store_ping(store, now + 14, 30, reg_seen_callback, &seen) == 0, "nobody due a ping before half the interval");
+  ok(sofia_reg_store_ping(store, now + 46, 30, reg_seen_callback, &seen) == 3, "everybody pinged by one and a half intervals");
+  ok(sofia_reg_store_ping(store, now + 46, 30, reg_seen_callback, &seen) == 0, "a ping reschedules the registration");
+  ok(sofia_reg_store_ping(store, now + 200, 30, reg_refuse_callback, NULL) == 0, "pings the callback skipped are not counted");
+
+  /* which registrations the profile wants pinged */
+  switch_set_string(mod_sofia_globals.hostname, "here");
+
+  for (i = 0; i < (int) (sizeof(pings) / sizeof(pings[0])); i++) {
+    memset(col, 0, sizeof(col));
+    col[SOFIA_REG_COL_STATUS] = (char *) pings[i].status;
+    col[SOFIA_REG_COL_CONTACT] = (char *) pings[i].contact;
+    col[SOFIA_REG_COL_ORIG_HOSTNAME] = (char *) pings[i].hostname;
+    col[SOFIA_REG_COL_FORCE_PING] = (char *) pings[i].force;
+
+    memset(profile.pflags, 0, sizeof(profile.pflags));
+    if (pings[i].flag != PFLAG_MAX) {
+      sofia_set_pflag(&profile, pings[i].flag);
+    }
+
+    if (sofia_reg_store_ping_wanted(&profile, col) != pings[i].wanted) {
+      note("ping case %d wrong\n", i);
+      wrong++;
+    }
+  }
+  ok(wrong == 0, "ping filter matches sofia_reg_check_ping_expire for every case");
+
+  sofia_reg_store_destroy(&store);
+
+  /* the store is seeded from the mirror table when the profile comes up */
+  switch_core_db_open(":memory:", &db);
+  switch_core_db_exec(db, "create table sip_registrations (call_id VARCHAR(255), sip_user VARCHAR(255), sip_host VARCHAR(255), "
+                      "presence_hosts VARCHAR(255), contact VARCHAR(1024), status VARCHAR(255), ping_status VARCHAR(255), "
+                      "ping_count INTEGER, ping_time BIGINT, force_ping INTEGER, rpid VARCHAR(255), expires BIGINT, "
+                      "user_agent VARCHAR(255), server_user VARCHAR(255), server_host VARCHAR(255), profile_name VARCHAR(255), "
+                      "hostname VARCHAR(255), network_ip VARCHAR(255), network_port VARCHAR(6), sip_username VARCHAR(255), "
+                      "sip_realm VARCHAR(255), mwi_user VARCHAR(255), mwi_host VARCHAR(255), orig_server_host VARCHAR(255), "
+                      "orig_hostname VARCHAR(255), sub_host VARCHAR(255))", NULL, NULL, NULL);
+  switch_core_db_exec(db, "insert into sip_registrations (call_id,sip_user,sip_host,contact,status,expires,profile_name,hostname,"
+                      "network_ip,network_port) values ('s1','kim','example.com','sip:kim@10.0.0.10','Registered(UDP)',"
+                      "4102444800,'internal','here','10.0.0.10','5060')", NULL, NULL, NULL);
+  switch_core_db_exec(db, "insert into sip_registrations (call_id,sip_user,sip_host,contact,status,expires,profile_name,hostname,"
+                      "network_ip,network_port) values ('s2','lee','example.com','sip:lee@10.0.0.11','Registered(UDP)',"
+                      "4102444800,'external','here','10.0.0.11','5060')", NULL, NULL, NULL);
+
+  sofia_reg_store_create(&store, 30, pool);
+  reg_seed(store, db);
+  ok(sofia_reg_store_count(store) == 1 && reg_count_by(store, "kim", "sip:kim@10.0.0.10", "10.0.0.10") == 1,
+     "a seeded store holds the rows of its own profile");
+
+  sofia_reg_store_destroy(&store);
+  sofia_reg_store_create(&store, 30, pool);
+  reg_seed(store, db);
+  ok(sofia_reg_store_count(store) == 1 && reg_count_by(store, "kim", NULL, NULL) == 1, "and a recreated store finds the seeded row again");
+
+  sofia_reg_store_destroy(&store);
+  switch_core_db_close(db);
+  switch_core_destroy_memory_pool(&pool);
+
+  switch_core_destroy();
+
+  done_testing();
+}
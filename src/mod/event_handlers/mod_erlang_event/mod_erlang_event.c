@@ -156,7 +156,7 @@ static void send_event_to_attached_sessions(listener_t *listener, switch_event_t
 		if (send) {
 			switch_log_printf(SWITCH_CHANNEL_UUID_LOG(s->uuid_str), SWITCH_LOG_DEBUG, "Sending event %s to attached session %s\n",
 					switch_event_name(event->event_id), s->uuid_str);
-			if (switch_event_dup(&clone, event) == SWITCH_STATUS_SUCCESS) {
+			if ((clone = switch_event_ref(event))) {
 				/* add the event to the queue for this session */
 				if (switch_queue_trypush(s->event_queue, clone) != SWITCH_STATUS_SUCCESS) {
 					switch_log_printf(SWITCH_CHANNEL_UUID_LOG(s->uuid_str), SWITCH_LOG_ERROR, "Lost event!\n");
@@ -282,7 +282,7 @@ static void event_handler(switch_event_t *event)
 		switch_thread_rwlock_unlock(l->event_rwlock);
 
 		if (send) {
-			if (switch_event_dup(&clone, event) == SWITCH_STATUS_SUCCESS) {
+			if ((clone = switch_event_ref(event))) {
 				if (switch_queue_trypush(l->event_queue, clone) == SWITCH_STATUS_SUCCESS) {
 					if (l->lost_events) {
 						int le = l->lost_events;
@@ -280,13 +280,19 @@ static void event_handler(switch_event_t *event)
 
 	if (send) {
 		char *packet;
+		switch_event_t *out = NULL;
 
 		switch (event->event_id) {
 		case SWITCH_EVENT_LOG:
 			return;
 		default:
-			switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Multicast-Sender", switch_core_get_switchname());
-			if (switch_event_serialize(event, &packet, SWITCH_TRUE) == SWITCH_STATUS_SUCCESS) {
+			/* other subscribers may be sharing the event, stamp our own copy */
+			if (switch_event_dup(&out, event) != SWITCH_STATUS_SUCCESS) {
+				break;
+			}
+
+			switch_event_add_header_string(out, SWITCH_STACK_BOTTOM, "Multicast-Sender", switch_core_get_switchname());
+			if (switch_event_serialize(out, &packet, SWITCH_TRUE) == SWITCH_STATUS_SUCCESS) {
 				size_t len;
 				char *buf;
 #ifdef HAVE_OPENSSL
@@ -353,6 +359,7 @@ static void event_handler(switch_event_t *event)
 				switch_safe_free(packet);
 				switch_safe_free(buf);
 			}
+			switch_event_destroy(&out);
 			break;
 		}
 	}
@@ -98,6 +98,10 @@ struct listener {
 	time_t linger_timeout;
 	struct listener *next;
 	switch_pollfd_t *pollfd;
+	char *rbuf;
+	switch_size_t rbuf_pos;
+	switch_size_t rbuf_len;
+	char *wbuf;
 };
 
 typedef struct listener listener_t;
@@ -378,7 +382,7 @@ static void event_handler(switch_event_t *event)
 		}
 
 		if (send) {
-			if (switch_event_dup(&clone, event) == SWITCH_STATUS_SUCCESS) {
+			if ((clone = switch_event_ref(event))) {
 				qstatus = switch_queue_trypush(l->event_queue, clone); 
 				if (qstatus == SWITCH_STATUS_SUCCESS) {
 					if (l->lost_events) {
@@ -1190,6 +1194,60 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_event_socket_load)
 	return SWITCH_STATUS_SUCCESS;
 }
 
+#define LISTENER_RBUF_LEN 65536
+#define LISTENER_WBUF_LEN 65536
+
+/* pull whatever the socket has into the read buffer so commands are parsed without a syscall per byte */
+static switch_status_t listener_fill(listener_t *listener)
+{
+	switch_size_t mlen;
+	switch_status_t status;
+
+	if (!listener->rbuf) {
+		listener->rbuf = switch_core_alloc(listener->pool, LISTENER_RBUF_LEN);
+	}
+
+	if (listener->rbuf_pos) {
+		memmove(listener->rbuf, listener->rbuf + listener->rbuf_pos, listener->rbuf_len);
+		listener->rbuf_pos = 0;
+	}
+
+	if (!(mlen = LISTENER_RBUF_LEN - listener->rbuf_len)) {
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	status = switch_socket_recv(listener->sock, listener->rbuf + listener->rbuf_len, &mlen);
+
+	if (status == SWITCH_STATUS_SUCCESS || SWITCH_STATUS_IS_BREAK(status)) {
+		listener->rbuf_len += mlen;
+	}
+
+	return status;
+}
+
+/* queue a frame behind the ones already batched, flushing first when it will not fit */
+static void listener_batch(listener_t *listener, switch_size_t *wlen, const char *data, switch_size_t len)
+{
+	if (!listener->wbuf) {
+		listener->wbuf = switch_core_alloc(listener->pool, LISTENER_WBUF_LEN);
+	}
+
+	if (*wlen + len > LISTENER_WBUF_LEN) {
+		if (*wlen) {
+			switch_socket_send(listener->sock, listener->wbuf, wlen);
+			*wlen = 0;
+		}
+
+		if (len > LISTENER_WBUF_LEN) {
+			switch_socket_send(listener->sock, data, &len);
+			return;
+		}
+	}
+
+	memcpy(listener->wbuf + *wlen, data, len);
+	*wlen += len;
+}
+
 static switch_status_t read_packet(listener_t *listener, switch_event_t **event, uint32_t timeout)
 {
 	switch_size_t mlen, bytes = 0;
@@ -1226,50 +1284,54 @@ static switch_status_t read_packet(listener_t *listener, switch_event_t **event,
 
 	while (listener->sock && !prefs.done) {
 		uint8_t do_sleep = 1;
-		mlen = 1;
 
-		if (bytes == buf_len - 1) {
-			char *tmp;
-			int pos;
-
-			pos = (int)(ptr - mbuf);
-			buf_len += block_len;
-			tmp = realloc(mbuf, buf_len);
-			switch_assert(tmp);
-			mbuf = tmp;
-			memset(mbuf + bytes, 0, buf_len - bytes);
-			ptr = (mbuf + pos);
+		if (!listener->rbuf_len) {
+			status = listener_fill(listener);
 
+			if (prefs.done || (!SWITCH_STATUS_IS_BREAK(status) && status != SWITCH_STATUS_SUCCESS)) {
+				switch_goto_status(SWITCH_STATUS_FALSE, end);
+			}
 		}
 
-		status = switch_socket_recv(listener->sock, ptr, &mlen);
+		/* anything left after this packet stays buffered for the next call, so pipelined commands cost no extra reads */
+		while (listener->rbuf_len && crcount < 2) {
+			char c = listener->rbuf[listener->rbuf_pos++];
 
-		if (prefs.done || (!SWITCH_STATUS_IS_BREAK(status) && status != SWITCH_STATUS_SUCCESS)) {
-			switch_goto_status(SWITCH_STATUS_FALSE, end);
-		}
-
-		if (mlen) {
-			bytes += mlen;
+			listener->rbuf_len--;
 			do_sleep = 0;
 
-			if (*mbuf == '\r' || *mbuf == '\n') {	/* bah */
-				ptr = mbuf;
-				mbuf[0] = '\0';
-				bytes = 0;
+			if (!bytes && (c == '\r' || c == '\n')) {	/* bah */
 				continue;
 			}
 
-			if (*ptr == '\n') {
+			if (bytes == buf_len - 1) {
+				char *tmp;
+				int pos;
+
+				pos = (int)(ptr - mbuf);
+				buf_len += block_len;
+				tmp = realloc(mbuf, buf_len);
+				switch_assert(tmp);
+				mbuf = tmp;
+				memset(mbuf + bytes, 0, buf_len - bytes);
+				ptr = (mbuf + pos);
+			}
+
+			*ptr++ = c;
+			bytes++;
+
+			if (c == '\n') {
 				crcount++;
-			} else if (*ptr != '\r') {
+			} else if (c != '\r') {
 				crcount = 0;
 			}
-			ptr++;
 
 			if (bytes >= max_len) {
 				crcount = 2;
 			}
+		}
 
+		if (bytes) {
 			if (crcount == 2) {
 				char *next;
 				char *cur = mbuf;
@@ -1307,6 +1369,16 @@ static switch_status_t read_packet(listener_t *listener, switch_event_t **event,
 										switch_zmalloc(body, clen + 1);
 
 										p = body;
+
+										if (listener->rbuf_len) {
+											mlen = listener->rbuf_len < (switch_size_t) clen ? listener->rbuf_len : (switch_size_t) clen;
+											memcpy(p, listener->rbuf + listener->rbuf_pos, mlen);
+											listener->rbuf_pos += mlen;
+											listener->rbuf_len -= mlen;
+											clen -= (int) mlen;
+											p += mlen;
+										}
+
 										while (clen > 0) {
 											mlen = clen;
 
@@ -1395,42 +1467,56 @@ static switch_status_t read_packet(listener_t *listener, switch_event_t **event,
 			}
 
 			if (switch_test_flag(listener, LFLAG_EVENTS)) {
+				switch_size_t wlen = 0;
+
 				while (switch_queue_trypop(listener->event_queue, &pop) == SWITCH_STATUS_SUCCESS) {
 					char hbuf[512];
 					switch_event_t *pevent = (switch_event_t *) pop;
 					char *etype;
+					const char *ebuf;
+					switch_event_render_t render;
 
 					do_sleep = 0;
 					if (listener->format == EVENT_FORMAT_PLAIN) {
 						etype = "plain";
-						switch_event_serialize(pevent, &listener->ebuf, SWITCH_TRUE);
+						render = SWITCH_EVENT_RENDER_PLAIN;
 					} else if (listener->format == EVENT_FORMAT_JSON) {
 						etype = "json";
-						switch_event_serialize_json(pevent, &listener->ebuf);
+						render = SWITCH_EVENT_RENDER_JSON;
 					} else {
-						switch_xml_t xml;
 						etype = "xml";
+						render = SWITCH_EVENT_RENDER_XML;
+					}
 
-						if ((xml = switch_event_xmlize(pevent, SWITCH_VA_NONE))) {
-							listener->ebuf = switch_xml_toxml(xml, SWITCH_FALSE);
-							switch_xml_free(xml);
+					/* events shared between listeners are rendered once, by whoever gets there first */
+					if (!(ebuf = switch_event_get_rendered(pevent, render))) {
+						if (listener->format == EVENT_FORMAT_PLAIN) {
+							switch_event_serialize(pevent, &listener->ebuf, SWITCH_TRUE);
+						} else if (listener->format == EVENT_FORMAT_JSON) {
+							switch_event_serialize_json(pevent, &listener->ebuf);
 						} else {
-							switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(listener->session), SWITCH_LOG_ERROR, "XML ERROR!\n");
-							goto endloop;
+							switch_xml_t xml;
+
+							if ((xml = switch_event_xmlize(pevent, SWITCH_VA_NONE))) {
+								listener->ebuf = switch_xml_toxml(xml, SWITCH_FALSE);
+								switch_xml_free(xml);
+							} else {
+								switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(listener->session), SWITCH_LOG_ERROR, "XML ERROR!\n");
+								goto endloop;
+							}
 						}
+
+						ebuf = listener->ebuf;
 					}
 
-					switch_assert(listener->ebuf);
+					switch_assert(ebuf);
 
-					len = strlen(listener->ebuf);
+					len = strlen(ebuf);
 
 					switch_snprintf(hbuf, sizeof(hbuf), "Content-Length: %" SWITCH_SSIZE_T_FMT "\n" "Content-Type: text/event-%s\n" "\n", len, etype);
 
-					len = strlen(hbuf);
-					switch_socket_send(listener->sock, hbuf, &len);
-
-					len = strlen(listener->ebuf);
-					switch_socket_send(listener->sock, listener->ebuf, &len);
+					listener_batch(listener, &wlen, hbuf, strlen(hbuf));
+					listener_batch(listener, &wlen, ebuf, strlen(ebuf));
 
 					switch_safe_free(listener->ebuf);
 
@@ -1438,6 +1524,11 @@ static switch_status_t read_packet(listener_t *listener, switch_event_t **event,
 
 					switch_event_destroy(&pevent);
 				}
+
+				/* one write for everything that was queued */
+				if (wlen) {
+					switch_socket_send(listener->sock, listener->wbuf, &wlen);
+				}
 			}
 		}
 
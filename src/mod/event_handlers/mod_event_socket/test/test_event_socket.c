@@ -0,0 +1,196 @@
+#include <switch.h>
+#include <tap.h>
+
+/* read_packet and the listener buffers are static, test them in place */
+#include "../mod_event_socket.c"
+
+#define BIG_HEADER_LEN 100000
+
+/* sends its chunks one by one with a pause in between so each lands in its own read */
+typedef struct {
+  switch_socket_t *sock;
+  const char *chunks[8];
+} feed_t;
+
+static void *SWITCH_THREAD_FUNC feed_thread(switch_thread_t *thread, void *obj)
+{
+  feed_t *feed = (feed_t *) obj;
+  switch_size_t len;
+  int x;
+
+  for (x = 0; x < 8 && feed->chunks[x]; x++) {
+    switch_yield(50000);
+    len = strlen(feed->chunks[x]);
+    switch_socket_send(feed->sock, feed->chunks[x], &len);
+  }
+
+  return NULL;
+}
+
+static void feed_start(switch_memory_pool_t *pool, feed_t *feed, switch_thread_t **thread)
+{
+  switch_threadattr_t *thd_attr = NULL;
+
+  switch_threadattr_create(&thd_attr, pool);
+  switch_thread_create(thread, thd_attr, feed_thread, feed, pool);
+}
+
+static void feed_wait(switch_thread_t *thread)
+{
+  switch_status_t st;
+
+  switch_thread_join(&st, thread);
+}
+
+static void send_all(switch_socket_t *sock, const char *data)
+{
+  switch_size_t len = strlen(data);
+
+  switch_socket_send(sock, data, &len);
+}
+
+static const char *command_of(switch_event_t *event)
+{
+  return event ? switch_str_nil(switch_event_get_header(event, "Command")) : "";
+}
+
+/* a connected pair on the loopback, the server end set up the way listener_run leaves it */
+static switch_status_t listener_connect(switch_memory_pool_t *pool, listener_t *listener, switch_socket_t **client)
+{
+  switch_socket_t *server = NULL;
+  switch_sockaddr_t *sa = NULL, *local = NULL, *remote = NULL;
+
+  if (switch_sockaddr_info_get(&sa, "127.0.0.1", SWITCH_INET, 0, 0, pool) != SWITCH_STATUS_SUCCESS ||
+      switch_socket_create(&server, SWITCH_INET, SOCK_STREAM, SWITCH_PROTO_TCP, pool) != SWITCH_STATUS_SUCCESS ||
+      switch_socket_bind(server, sa) != SWITCH_STATUS_SUCCESS || switch_socket_listen(server, 1) != SWITCH_STATUS_SUCCESS ||
+      switch_socket_addr_get(&local, SWITCH_FALSE, server) != SWITCH_STATUS_SUCCESS ||
+      switch_sockaddr_info_get(&remote, "127.0.0.1", SWITCH_INET, switch_sockaddr_get_port(local), 0, pool) != SWITCH_STATUS_SUCCESS ||
+      switch_socket_create(client, SWITCH_INET, SOCK_STREAM, SWITCH_PROTO_TCP, pool) != SWITCH_STATUS_SUCCESS ||
+      switch_socket_connect(*client, remote) != SWITCH_STATUS_SUCCESS ||
+      switch_socket_accept(&listener->sock, server, pool) != SWITCH_STATUS_SUCCESS) {
+    return SWITCH_STATUS_FALSE;
+  }
+
+  switch_socket_close(server);
+
+  listener->pool = pool;
+  switch_mutex_init(&listener->flag_mutex, SWITCH_MUTEX_NESTED, pool);
+  switch_socket_opt_set(listener->sock, SWITCH_SO_TCP_NODELAY, TRUE);
+  switch_socket_opt_set(listener->sock, SWITCH_SO_NONBLOCK, TRUE);
+  switch_socket_create_pollset(&listener->pollfd, listener->sock, SWITCH_POLLIN | SWITCH_POLLERR, pool);
+
+  return SWITCH_STATUS_SUCCESS;
+}
+
+int main () {
+  switch_memory_pool_t *pool = NULL;
+  switch_socket_t *client = NULL;
+  switch_thread_t *thread = NULL;
+  listener_t listener;
+  switch_event_t *event = NULL;
+  feed_t feed;
+  const char *err = NULL, *val;
+  char *big;
+  switch_status_t status;
+
+  plan(13);
+
+  if (!ok(switch_core_init(SCF_MINIMAL, SWITCH_TRUE, &err) == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+  switch_core_new_memory_pool(&pool);
+  memset(&listener, 0, sizeof(listener));
+
+  if (!ok(listener_connect(pool, &listener, &client) == SWITCH_STATUS_SUCCESS, "listener connected on the loopback")) {
+    bail_out(0, "Bail due to failure to connect");
+  }
+
+  /* a command arriving a few bytes at a time, the blank line split between CR and LF */
+  memset(&feed, 0, sizeof(feed));
+  feed.sock = client;
+  feed.chunks[0] = "api sta";
+  feed.chunks[1] = "tus\r";
+  feed.chunks[2] = "\nfoo: b";
+  feed.chunks[3] = "ar\r\n\r";
+  feed.chunks[4] = "\n";
+  feed_start(pool, &feed, &thread);
+  status = read_packet(&listener, &event, 5);
+  feed_wait(thread);
+  ok(status == SWITCH_STATUS_SUCCESS && !strcmp(command_of(event), "api status") &&
+     (val = switch_event_get_header(event, "foo")) && !strcmp(val, "bar"), "a command split over many reads is put back together");
+  switch_event_destroy(&event);
+
+  /* bare LF line endings and pipelined commands sent in one go */
+  send_all(client, "api one\nbar: baz\n\napi two\n\n");
+  status = read_packet(&listener, &event, 5);
+  ok(status == SWITCH_STATUS_SUCCESS && !strcmp(command_of(event), "api one") &&
+     (val = switch_event_get_header(event, "bar")) && !strcmp(val, "baz"), "bare LF ends lines and headers");
+  switch_event_destroy(&event);
+  status = read_packet(&listener, &event, 5);
+  ok(status == SWITCH_STATUS_SUCCESS && !strcmp(command_of(event), "api two"), "a pipelined command waits in the buffer for the next read");
+  switch_event_destroy(&event);
+
+  /* a body taken from the buffer with the next command right behind it */
+  send_all(client, "sendmsg\nContent-Length: 11\n\nhello worldapi three\n\n");
+  status = read_packet(&listener, &event, 5);
+  ok(status == SWITCH_STATUS_SUCCESS && !strcmp(command_of(event), "sendmsg") && event->body && !strcmp(event->body, "hello world"),
+     "a Content-Length body is cut from the buffer");
+  switch_event_destroy(&event);
+  status = read_packet(&listener, &event, 5);
+  ok(status == SWITCH_STATUS_SUCCESS && !strcmp(command_of(event), "api three"), "the command after a body is not swallowed by it");
+  switch_event_destroy(&event);
+
+  /* a body that is still on its way when the headers have been parsed */
+  memset(&feed, 0, sizeof(feed));
+  feed.sock = client;
+  feed.chunks[0] = "sendmsg\nContent-Length: 11\n\nhel";
+  feed.chunks[1] = "lo wor";
+  feed.chunks[2] = "ld";
+  feed_start(pool, &feed, &thread);
+  status = read_packet(&listener, &event, 5);
+  feed_wait(thread);
+  ok(status == SWITCH_STATUS_SUCCESS && event && event->body && !strcmp(event->body, "hello world"), "a body split over many reads is read to its length");
+  switch_event_destroy(&event);
+
+  /* a header far bigger than the read buffer */
+  switch_zmalloc(big, BIG_HEADER_LEN + 64);
+  memcpy(big, "api big\nbig: ", 13);
+  memset(big + 13, 'x', BIG_HEADER_LEN);
+  memcpy(big + 13 + BIG_HEADER_LEN, "\n\n", 2);
+
+  memset(&feed, 0, sizeof(feed));
+  feed.sock = client;
+  feed.chunks[0] = big;
+  feed_start(pool, &feed, &thread);
+  status = read_packet(&listener, &event, 5);
+  feed_wait(thread);
+  ok(status == SWITCH_STATUS_SUCCESS && !strcmp(command_of(event), "api big") && (val = switch_event_get_header(event, "big")) &&
+     strlen(val) == BIG_HEADER_LEN, "an oversized header comes through whole");
+  switch_event_destroy(&event);
+  free(big);
+
+  send_all(client, "api small\n\n");
+  status = read_packet(&listener, &event, 5);
+  ok(status == SWITCH_STATUS_SUCCESS && !strcmp(command_of(event), "api small"), "the buffer is back in step after an oversized header");
+  switch_event_destroy(&event);
+
+  /* without its blank line a command is never complete */
+  switch_set_flag_locked((&listener), LFLAG_RUNNING);
+  send_all(client, "api unfinished\n");
+  status = read_packet(&listener, &event, 1);
+  ok(status != SWITCH_STATUS_SUCCESS && !event, "a command missing its blank line is not handed out");
+  ok(!switch_test_flag((&listener), LFLAG_RUNNING), "and the listener is stopped when it times out");
+
+  switch_socket_shutdown(client, SWITCH_SHUTDOWN_READWRITE);
+  status = read_packet(&listener, &event, 5);
+  ok(status != SWITCH_STATUS_SUCCESS && !event, "a closed connection ends the read");
+
+  switch_socket_close(client);
+  switch_socket_close(listener.sock);
+  switch_core_destroy_memory_pool(&pool);
+
+  switch_core_destroy();
+
+  done_testing();
+}
@@ -54,14 +54,6 @@ static void time_t_to_datetime(time_t epoch, char *buf, switch_size_t buflen)
 }
 
 
-static int sql_count_callback(void *pArg, int argc, char **argv, char **columnNames)
-{
-	uint32_t *count = (uint32_t *) pArg;
-	*count = atoi(argv[0]);
-	return 0;
-}
-
-
 static int channelList_callback(void *pArg, int argc, char **argv, char **columnNames)
 {
 	chan_entry_t *entry;
@@ -128,21 +120,12 @@ void channelList_free(netsnmp_cache *cache, void *magic)
 
 int channelList_load(netsnmp_cache *cache, void *vmagic)
 {
-	switch_cache_db_handle_t *dbh;
-	char sql[1024] = "";
-
 	channelList_free(cache, NULL);
 
-	if (switch_core_db_handle(&dbh) != SWITCH_STATUS_SUCCESS) {
-		return 0;
-	}
-
 	idx = 1;
 
-	switch_snprintfv(sql, sizeof(sql), "SELECT * FROM channels WHERE hostname='%q' ORDER BY created_epoch", switch_core_get_switchname());
-	switch_cache_db_execute_sql_callback(dbh, sql, channelList_callback, NULL, NULL);
-
-	switch_cache_db_release_db_handle(&dbh);
+	/* the registry only holds our own channels, in creation order, whether or not channel-sql-export is on */
+	switch_channel_registry_query(SWITCH_CHANNEL_REGISTRY_CHANNELS, NULL, SWITCH_FALSE, channelList_callback, NULL);
 
 	return 0;
 }
@@ -235,19 +218,9 @@ int handle_systemStats(netsnmp_mib_handler *handler, netsnmp_handler_registratio
 			snmp_set_var_typed_integer(requests->requestvb, ASN_GAUGE, int_val);
 			break;
 		case SS_CURRENT_CALLS:
-			{
-			switch_cache_db_handle_t *dbh;
-			char sql[1024] = "";
-
-			if (switch_core_db_handle(&dbh) != SWITCH_STATUS_SUCCESS) {
-				return SNMP_ERR_GENERR;
-			}
-
-			switch_snprintfv(sql, sizeof(sql), "SELECT COUNT(*) FROM calls WHERE hostname='%q'", switch_core_get_switchname());
-			switch_cache_db_execute_sql_callback(dbh, sql, sql_count_callback, &int_val, NULL);
+			/* a row of the calls table is a bridged pair */
+			int_val = switch_channel_registry_query(SWITCH_CHANNEL_REGISTRY_CALLS, NULL, SWITCH_TRUE, NULL, NULL);
 			snmp_set_var_typed_integer(requests->requestvb, ASN_GAUGE, int_val);
-			switch_cache_db_release_db_handle(&dbh);
-			}
 			break;
 		case SS_SESSIONS_PER_SECOND:
 			switch_core_session_ctl(SCSC_LAST_SPS, &int_val);
@@ -1453,16 +1453,28 @@ void do_broadcast(switch_stream_handle_t *stream)
 	}
 }
 
+/* picks the columns web_callback wants out of a channel registry row */
+static int index_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	static char *cols[] = { "uuid", "created", "cid_name", "cid_num", "dest", "application", "application_data", "read_codec", "read_rate" };
+	char *row[9] = { 0 };
+	int i, x;
+
+	for (i = 0; i < 9; i++) {
+		for (x = 0; x < argc; x++) {
+			if (!strcmp(columnNames[x], cols[i])) {
+				row[i] = argv[x];
+				break;
+			}
+		}
+	}
+
+	return web_callback(pArg, 9, row, cols);
+}
+
 void do_index(switch_stream_handle_t *stream)
 {
-	switch_cache_db_handle_t *db;
-	const char *sql = "select uuid, created, cid_name, cid_num, dest, application, application_data, read_codec, read_rate from channels";
 	struct holder holder;
-	char *errmsg;
-
-	if (switch_core_db_handle(&db) != SWITCH_STATUS_SUCCESS) {
-		return;
-	}
 
 	holder.host = switch_event_get_header(stream->param_event, "http-host");
 	holder.port = switch_event_get_header(stream->param_event, "http-port");
@@ -1475,14 +1487,9 @@ void do_index(switch_stream_handle_t *stream)
 						   "<tr><td>%s</td><td>%s</td><td>%s</td><td>%s</td><td>%s</td><td>%s</td><td>%s</td><td>%s</td><td>%s</td></tr>\n",
 						   "Created", "CID Name", "CID Num", "Ext", "App", "Data", "Codec", "Rate", "Listen");
 
-	switch_cache_db_execute_sql_callback(db, sql, web_callback, &holder, &errmsg);
+	switch_channel_registry_query(SWITCH_CHANNEL_REGISTRY_CHANNELS, NULL, SWITCH_FALSE, index_callback, &holder);
 
 	stream->write_function(stream, "</table>");
-
-	if (errmsg) {
-		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error [%s]\n", errmsg);
-		switch_safe_free(errmsg);
-	}
 }
 
 #define TELECAST_SYNTAX ""
@@ -39,7 +39,25 @@ SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_xml_curl_shutdown);
 SWITCH_MODULE_DEFINITION(mod_xml_curl, mod_xml_curl_load, mod_xml_curl_shutdown, NULL);
 
 
+#define XML_CURL_LATENCY_BUCKETS 16
+#define XML_CURL_MAX_IDLE 16
+
+/* Handles are kept between fetches so the connection (and TLS session) to the gateway stays up */
+typedef struct xml_curl_pool {
+	switch_mutex_t *mutex;
+	switch_thread_cond_t *cond;
+	switch_CURL *idle[XML_CURL_MAX_IDLE];
+	uint32_t idle_count;
+	uint32_t active;
+	uint64_t requests;
+	uint64_t reused;
+	uint64_t waits;
+	uint64_t errors;
+	uint64_t latency[XML_CURL_LATENCY_BUCKETS];
+} xml_curl_pool_t;
+
 struct xml_binding {
+	char *name;
 	char *method;
 	char *url;
 	char *bindings;
@@ -59,6 +77,10 @@ struct xml_binding {
 	int use_dynamic_url;
 	long auth_scheme;
 	int timeout;
+	uint32_t max_connections;
+	int enable_http2;
+	xml_curl_pool_t pool;
+	struct xml_binding *next;
 };
 
 static int keep_files_around = 0;
@@ -84,9 +106,167 @@ static struct {
 	switch_memory_pool_t *pool;
 	hash_node_t *hash_root;
 	hash_node_t *hash_tail;
+	xml_binding_t *bindings;
+	CURLSH *share;
+	switch_mutex_t *share_mutex[CURL_LOCK_DATA_LAST];
 } globals;
 
-#define XML_CURL_SYNTAX "[debug_on|debug_off]"
+static void xml_curl_share_lock(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr)
+{
+	switch_mutex_lock(globals.share_mutex[data]);
+}
+
+static void xml_curl_share_unlock(CURL *handle, curl_lock_data data, void *userptr)
+{
+	switch_mutex_unlock(globals.share_mutex[data]);
+}
+
+static void xml_curl_share_init(void)
+{
+	int i;
+
+	for (i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+		switch_mutex_init(&globals.share_mutex[i], SWITCH_MUTEX_NESTED, globals.pool);
+	}
+
+	if (!(globals.share = curl_share_init())) {
+		return;
+	}
+
+	curl_share_setopt(globals.share, CURLSHOPT_LOCKFUNC, xml_curl_share_lock);
+	curl_share_setopt(globals.share, CURLSHOPT_UNLOCKFUNC, xml_curl_share_unlock);
+	curl_share_setopt(globals.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+	curl_share_setopt(globals.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900
+	/* one connection cache for all handles so a burst can reuse whatever is open */
+	curl_share_setopt(globals.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+}
+
+static void xml_curl_pool_init(xml_binding_t *binding)
+{
+	switch_mutex_init(&binding->pool.mutex, SWITCH_MUTEX_NESTED, globals.pool);
+	switch_thread_cond_create(&binding->pool.cond, globals.pool);
+}
+
+/* Waits for a slot when the binding has max-connections set */
+static switch_CURL *xml_curl_handle_get(xml_binding_t *binding)
+{
+	xml_curl_pool_t *pool = &binding->pool;
+	switch_CURL *curl_handle = NULL;
+
+	switch_mutex_lock(pool->mutex);
+	if (binding->max_connections && pool->active >= binding->max_connections) {
+		pool->waits++;
+		while (pool->active >= binding->max_connections) {
+			switch_thread_cond_wait(pool->cond, pool->mutex);
+		}
+	}
+
+	pool->active++;
+	pool->requests++;
+
+	if (pool->idle_count) {
+		curl_handle = pool->idle[--pool->idle_count];
+		pool->reused++;
+	}
+	switch_mutex_unlock(pool->mutex);
+
+	if (!curl_handle) {
+		curl_handle = switch_curl_easy_init();
+	}
+
+	if (globals.share) {
+		switch_curl_easy_setopt(curl_handle, CURLOPT_SHARE, globals.share);
+	}
+
+#if LIBCURL_VERSION_NUM >= 0x071900
+	switch_curl_easy_setopt(curl_handle, CURLOPT_TCP_KEEPALIVE, 1L);
+#endif
+
+#if defined(CURL_HTTP_VERSION_2TLS)
+	if (binding->enable_http2) {
+		switch_curl_easy_setopt(curl_handle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+	}
+#endif
+
+	return curl_handle;
+}
+
+static void xml_curl_handle_put(xml_binding_t *binding, switch_CURL *curl_handle, switch_CURLcode cc, switch_time_t elapsed)
+{
+	xml_curl_pool_t *pool = &binding->pool;
+	uint32_t bucket = 0;
+	switch_time_t ms = elapsed / 1000;
+
+	/* reset drops the options but keeps the live connection */
+	curl_easy_reset(curl_handle);
+
+	while (ms && bucket < XML_CURL_LATENCY_BUCKETS - 1) {
+		ms >>= 1;
+		bucket++;
+	}
+
+	switch_mutex_lock(pool->mutex);
+	if (cc) {
+		pool->errors++;
+	}
+
+	if (elapsed >= 0) {
+		pool->latency[bucket]++;
+	}
+
+	if (!cc && pool->idle_count < XML_CURL_MAX_IDLE) {
+		pool->idle[pool->idle_count++] = curl_handle;
+		curl_handle = NULL;
+	}
+
+	pool->active--;
+	switch_thread_cond_signal(pool->cond);
+	switch_mutex_unlock(pool->mutex);
+
+	if (curl_handle) {
+		switch_curl_easy_cleanup(curl_handle);
+	}
+}
+
+static void xml_curl_pool_destroy(xml_binding_t *binding)
+{
+	xml_curl_pool_t *pool = &binding->pool;
+
+	switch_mutex_lock(pool->mutex);
+	while (pool->idle_count) {
+		switch_curl_easy_cleanup(pool->idle[--pool->idle_count]);
+	}
+	switch_mutex_unlock(pool->mutex);
+}
+
+static void xml_curl_status(switch_stream_handle_t *stream)
+{
+	xml_binding_t *binding;
+	int i;
+
+	stream->write_function(stream, "name,url,active,max,idle,requests,reused,waits,errors,latency_ms\n");
+
+	for (binding = globals.bindings; binding; binding = binding->next) {
+		xml_curl_pool_t *pool = &binding->pool;
+
+		switch_mutex_lock(pool->mutex);
+		stream->write_function(stream, "%s,%s,%u,%u,%u,%" SWITCH_UINT64_T_FMT ",%" SWITCH_UINT64_T_FMT ",%" SWITCH_UINT64_T_FMT ",%" SWITCH_UINT64_T_FMT ",",
+							   binding->name, binding->url, pool->active, binding->max_connections, pool->idle_count,
+							   pool->requests, pool->reused, pool->waits, pool->errors);
+
+		/* log2 buckets, <1 <2 <4 ... milliseconds */
+		for (i = 0; i < XML_CURL_LATENCY_BUCKETS; i++) {
+			stream->write_function(stream, "%s%" SWITCH_UINT64_T_FMT, i ? " " : "", pool->latency[i]);
+		}
+		switch_mutex_unlock(pool->mutex);
+
+		stream->write_function(stream, "\n");
+	}
+}
+
+#define XML_CURL_SYNTAX "[debug_on|debug_off|status]"
 SWITCH_STANDARD_API(xml_curl_function)
 {
 	if (session) {
@@ -101,6 +281,9 @@ SWITCH_STANDARD_API(xml_curl_function)
 		keep_files_around = 1;
 	} else if (!strcasecmp(cmd, "debug_off")) {
 		keep_files_around = 0;
+	} else if (!strcasecmp(cmd, "status")) {
+		xml_curl_status(stream);
+		return SWITCH_STATUS_SUCCESS;
 	} else {
 		goto usage;
 	}
@@ -157,6 +340,7 @@ static switch_xml_t xml_url_fetch(const char *section, const char *tag_name, con
 	char basic_data[512];
 	char *uri = NULL;
 	char *dynamic_url = NULL;
+	switch_time_t started;
 
     strncpy(hostname, switch_core_get_switchname(), sizeof(hostname) - 1);
 
@@ -207,7 +391,7 @@ static switch_xml_t xml_url_fetch(const char *section, const char *tag_name, con
 	switch_uuid_format(uuid_str, &uuid);
 
 	switch_snprintf(filename, sizeof(filename), "%s%s%s.tmp.xml", SWITCH_GLOBAL_dirs.temp_dir, SWITCH_PATH_SEPARATOR, uuid_str);
-	curl_handle = switch_curl_easy_init();
+	curl_handle = xml_curl_handle_get(binding);
 	headers = switch_curl_slist_append(headers, "Content-Type: application/x-www-form-urlencoded");
 
 	if (!strncasecmp(binding->url, "https", 5)) {
@@ -289,18 +473,27 @@ static switch_xml_t xml_url_fetch(const char *section, const char *tag_name, con
 			curl_easy_setopt(curl_handle, CURLOPT_INTERFACE, binding->bind_local);
 		}
 
+		started = switch_time_now();
 		cc = switch_curl_easy_perform(curl_handle);
 		if (cc && cc != CURLE_WRITE_ERROR) {
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "CURL returned error:[%d] %s\n", cc, switch_curl_easy_strerror(cc));
 		}
 
 		switch_curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, &httpRes);
-		switch_curl_easy_cleanup(curl_handle);
+
+		if (binding->cookie_file) {
+			/* the handle outlives this request, write the jar now */
+			switch_curl_easy_setopt(curl_handle, CURLOPT_COOKIELIST, "FLUSH");
+		}
+
+		xml_curl_handle_put(binding, curl_handle, cc, switch_time_now() - started);
 		switch_curl_slist_free_all(headers);
 		switch_curl_slist_free_all(slist);
 		close(config_data.fd);
 	} else {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error Opening temp file!\n");
+		xml_curl_handle_put(binding, curl_handle, 0, -1);
+		switch_curl_slist_free_all(headers);
 	}
 
 	if (config_data.err) {
@@ -363,7 +556,8 @@ static switch_status_t do_config(void)
 		char *bind_mask = NULL;
 		char *method = NULL;
 		int disable100continue = 1;
-		int use_dynamic_url = 0, timeout = 0;
+		int use_dynamic_url = 0, timeout = 0, enable_http2 = 0;
+		uint32_t max_connections = 0;
 		uint32_t enable_cacert_check = 0;
 		char *ssl_cert_file = NULL;
 		char *ssl_key_file = NULL;
@@ -452,6 +646,15 @@ static switch_status_t do_config(void)
 				}
 			} else if (!strcasecmp(var, "bind-local")) {
 				bind_local = val;
+			} else if (!strcasecmp(var, "max-connections")) {
+				int tmp = atoi(val);
+				if (tmp >= 0) {
+					max_connections = (uint32_t) tmp;
+				} else {
+					switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Can't set a negative max-connections!\n");
+				}
+			} else if (!strcasecmp(var, "enable-http2")) {
+				enable_http2 = switch_true(val);
 			}
 		}
 
@@ -469,8 +672,12 @@ static switch_status_t do_config(void)
 		}
 		memset(binding, 0, sizeof(*binding));
 
+		binding->name = switch_core_strdup(globals.pool, zstr(bname) ? "N/A" : bname);
 		binding->auth_scheme = auth_scheme;
 		binding->timeout = timeout;
+		binding->max_connections = max_connections;
+		binding->enable_http2 = enable_http2;
+		xml_curl_pool_init(binding);
 		binding->url = switch_core_strdup(globals.pool, url);
 		switch_assert(binding->url);
 
@@ -543,6 +750,8 @@ static switch_status_t do_config(void)
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Binding [%s] XML Fetch Function [%s] [%s]\n",
 						  zstr(bname) ? "N/A" : bname, binding->url, binding->bindings ? binding->bindings : "all");
 		switch_xml_bind_search_function(xml_url_fetch, switch_xml_parse_section_string(binding->bindings), binding);
+		binding->next = globals.bindings;
+		globals.bindings = binding;
 		x++;
 		binding = NULL;
 	}
@@ -565,6 +774,8 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_xml_curl_load)
 	globals.hash_root = NULL;
 	globals.hash_tail = NULL;
 
+	xml_curl_share_init();
+
 	if (do_config() != SWITCH_STATUS_SUCCESS) {
 		return SWITCH_STATUS_FALSE;
 	}
@@ -572,6 +783,7 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_xml_curl_load)
 	SWITCH_ADD_API(xml_curl_api_interface, "xml_curl", "XML Curl", xml_curl_function, XML_CURL_SYNTAX);
 	switch_console_set_complete("add xml_curl debug_on");
 	switch_console_set_complete("add xml_curl debug_off");
+	switch_console_set_complete("add xml_curl status");
 
 	/* indicate that the module should continue to be loaded */
 	return SWITCH_STATUS_SUCCESS;
@@ -580,6 +792,7 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_xml_curl_load)
 SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_xml_curl_shutdown)
 {
 	hash_node_t *ptr = NULL;
+	xml_binding_t *binding;
 
 	while (globals.hash_root) {
 		ptr = globals.hash_root;
@@ -590,6 +803,15 @@ SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_xml_curl_shutdown)
 
 	switch_xml_unbind_search_function_ptr(xml_url_fetch);
 
+	for (binding = globals.bindings; binding; binding = binding->next) {
+		xml_curl_pool_destroy(binding);
+	}
+
+	if (globals.share) {
+		curl_share_cleanup(globals.share);
+		globals.share = NULL;
+	}
+
 	return SWITCH_STATUS_SUCCESS;
 }
 
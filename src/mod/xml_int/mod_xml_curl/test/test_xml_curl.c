@@ -0,0 +1,236 @@
+#include <switch.h>
+#include <tap.h>
+
+/* the connection pool is static, test it in place */
+#include "../mod_xml_curl.c"
+
+#define STUB_MAX_CONNS 16
+#define BURST_THREADS 6
+
+/* a minimal keep-alive HTTP/1.1 server answering every request with the same document */
+static struct {
+  switch_memory_pool_t *pool;
+  switch_socket_t *listener;
+  uint16_t port;
+  int running;
+  int delay_ms;
+  switch_thread_t *conn_threads[STUB_MAX_CONNS];
+  volatile switch_atomic_t connections;
+  volatile switch_atomic_t requests;
+  volatile switch_atomic_t in_flight;
+  volatile switch_atomic_t max_in_flight;
+} stub;
+
+static const char *STUB_DOC = "<document type=\"freeswitch/xml\"><section name=\"directory\"><domain name=\"stub.example.com\"/></section></document>";
+
+static int stub_read_request(switch_socket_t *sock)
+{
+  char buf[4096];
+  switch_size_t used = 0, len;
+  char *body;
+  const char *cl;
+  int need = 0;
+
+  for (;;) {
+    len = sizeof(buf) - 1 - used;
+    if (!len || switch_socket_recv(sock, buf + used, &len) != SWITCH_STATUS_SUCCESS || !len) {
+      return 0;
+    }
+    used += len;
+    buf[used] = '\0';
+
+    if ((body = strstr(buf, "\r\n\r\n"))) {
+      body += 4;
+      if (!need && (cl = switch_stristr("Content-Length:", buf))) {
+        need = atoi(cl + 15);
+      }
+      if ((int) (used - (body - buf)) >= need) {
+        return 1;
+      }
+    }
+  }
+}
+
+static void *SWITCH_THREAD_FUNC stub_conn_thread(switch_thread_t *thread, void *obj)
+{
+  switch_socket_t *sock = (switch_socket_t *) obj;
+  char *reply = switch_mprintf("HTTP/1.1 200 OK\r\nContent-Type: text/xml\r\nContent-Length: %d\r\n\r\n%s", (int) strlen(STUB_DOC), STUB_DOC);
+  switch_size_t len;
+  uint32_t now;
+
+  while (stub.running && stub_read_request(sock)) {
+    switch_atomic_inc(&stub.requests);
+    switch_atomic_inc(&stub.in_flight);
+
+    now = switch_atomic_read(&stub.in_flight);
+    while (now > switch_atomic_read(&stub.max_in_flight)) {
+      switch_atomic_set(&stub.max_in_flight, now);
+    }
+
+    if (stub.delay_ms) {
+      switch_yield(stub.delay_ms * 1000);
+    }
+
+    switch_atomic_dec(&stub.in_flight);
+    len = strlen(reply);
+    switch_socket_send(sock, reply, &len);
+  }
+
+  free(reply);
+  switch_socket_close(sock);
+
+  return NULL;
+}
+
+static void *SWITCH_THREAD_FUNC stub_listen_thread(switch_thread_t *thread, void *obj)
+{
+  switch_threadattr_t *thd_attr = NULL;
+  switch_socket_t *sock;
+
+  switch_threadattr_create(&thd_attr, stub.pool);
+
+  while (stub.running && switch_socket_accept(&sock, stub.listener, stub.pool) == SWITCH_STATUS_SUCCESS) {
+    uint32_t n = switch_atomic_read(&stub.connections);
+
+    if (!stub.running || n >= STUB_MAX_CONNS) {
+      switch_socket_close(sock);
+      continue;
+    }
+
+    switch_atomic_inc(&stub.connections);
+    switch_thread_create(&stub.conn_threads[n], thd_attr, stub_conn_thread, sock, stub.pool);
+  }
+
+  return NULL;
+}
+
+static switch_status_t stub_start(switch_memory_pool_t *pool, switch_thread_t **thread)
+{
+  switch_threadattr_t *thd_attr = NULL;
+  switch_sockaddr_t *sa = NULL, *local = NULL;
+
+  memset(&stub, 0, sizeof(stub));
+  stub.pool = pool;
+
+  if (switch_sockaddr_info_get(&sa, "127.0.0.1", SWITCH_INET, 0, 0, pool) != SWITCH_STATUS_SUCCESS ||
+      switch_socket_create(&stub.listener, SWITCH_INET, SOCK_STREAM, SWITCH_PROTO_TCP, pool) != SWITCH_STATUS_SUCCESS ||
+      switch_socket_bind(stub.listener, sa) != SWITCH_STATUS_SUCCESS || switch_socket_listen(stub.listener, 16) != SWITCH_STATUS_SUCCESS ||
+      switch_socket_addr_get(&local, SWITCH_FALSE, stub.listener) != SWITCH_STATUS_SUCCESS) {
+    return SWITCH_STATUS_FALSE;
+  }
+
+  stub.port = switch_sockaddr_get_port(local);
+  stub.running = 1;
+
+  switch_threadattr_create(&thd_attr, pool);
+  return switch_thread_create(thread, thd_attr, stub_listen_thread, NULL, pool);
+}
+
+static void stub_stop(switch_thread_t *thread)
+{
+  switch_status_t st;
+  uint32_t x;
+
+  stub.running = 0;
+  switch_socket_shutdown(stub.listener, SWITCH_SHUTDOWN_READWRITE);
+  switch_socket_close(stub.listener);
+  switch_thread_join(&st, thread);
+
+  for (x = 0; x < switch_atomic_read(&stub.connections); x++) {
+    switch_thread_join(&st, stub.conn_threads[x]);
+  }
+}
+
+static int fetch_ok(xml_binding_t *binding)
+{
+  switch_xml_t xml = xml_url_fetch("directory", "domain", "name", "stub.example.com", NULL, binding);
+  int good = xml && switch_xml_find_child(switch_xml_child(xml, "section"), "domain", "name", "stub.example.com") != NULL;
+
+  switch_xml_free(xml);
+
+  return good;
+}
+
+static volatile switch_atomic_t burst_good = 0;
+
+static void *SWITCH_THREAD_FUNC burst_thread(switch_thread_t *thread, void *obj)
+{
+  int x;
+
+  for (x = 0; x < 2; x++) {
+    if (fetch_ok((xml_binding_t *) obj)) {
+      switch_atomic_inc(&burst_good);
+    }
+  }
+
+  return NULL;
+}
+
+int main () {
+  switch_memory_pool_t *pool = NULL;
+  switch_thread_t *listen_thread = NULL, *threads[BURST_THREADS];
+  switch_threadattr_t *thd_attr = NULL;
+  xml_binding_t *binding;
+  switch_status_t st;
+  const char *err = NULL;
+  int x, good = 0;
+
+  plan(8);
+
+  if (!ok(switch_core_init(SCF_MINIMAL, SWITCH_TRUE, &err) == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+  switch_core_new_memory_pool(&pool);
+  ok(stub_start(pool, &listen_thread) == SWITCH_STATUS_SUCCESS, "stub server listening");
+
+  memset(&globals, 0, sizeof(globals));
+  globals.pool = pool;
+  xml_curl_share_init();
+
+  binding = switch_core_alloc(pool, sizeof(*binding));
+  binding->name = "stub";
+  binding->url = switch_core_sprintf(pool, "http://127.0.0.1:%u/fetch", stub.port);
+  binding->max_connections = 2;
+  binding->timeout = 10;
+  xml_curl_pool_init(binding);
+  globals.bindings = binding;
+
+  /* back to back fetches ride one connection */
+  for (x = 0; x < 5; x++) {
+    good += fetch_ok(binding);
+  }
+  ok(good == 5, "sequential fetches return the document");
+  ok(switch_atomic_read(&stub.connections) == 1, "sequential fetches share one keep-alive connection");
+  ok(binding->pool.reused == 4, "pooled handle reused after the first fetch");
+
+  /* a burst wider than max-connections queues on the binding */
+  stub.delay_ms = 50;
+  switch_threadattr_create(&thd_attr, pool);
+  for (x = 0; x < BURST_THREADS; x++) {
+    switch_thread_create(&threads[x], thd_attr, burst_thread, binding, pool);
+  }
+  for (x = 0; x < BURST_THREADS; x++) {
+    switch_thread_join(&st, threads[x]);
+  }
+
+  ok(switch_atomic_read(&burst_good) == BURST_THREADS * 2, "every fetch in the burst returns the document");
+  ok(switch_atomic_read(&stub.max_in_flight) <= 2 && binding->pool.waits > 0, "burst held to max-connections");
+  ok(switch_atomic_read(&stub.connections) <= 2, "burst reuses the pooled connections");
+
+  note("xml_curl stub: %u connections, %u requests, %" SWITCH_UINT64_T_FMT " reused, %" SWITCH_UINT64_T_FMT " waits\n",
+       switch_atomic_read(&stub.connections), switch_atomic_read(&stub.requests), binding->pool.reused, binding->pool.waits);
+
+  /* closing the pooled handles ends the stub's connections */
+  xml_curl_pool_destroy(binding);
+  if (globals.share) {
+    curl_share_cleanup(globals.share);
+    globals.share = NULL;
+  }
+  stub_stop(listen_thread);
+
+  switch_core_destroy_memory_pool(&pool);
+  switch_core_destroy();
+
+  done_testing();
+}
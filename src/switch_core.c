@@ -1906,6 +1906,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_init(switch_core_flag_t flags, switc
 	switch_thread_rwlock_create(&runtime.global_var_rwlock, runtime.memory_pool);
 	switch_core_set_globals();
 	switch_core_session_init(runtime.memory_pool);
+	switch_resample_pool_init(runtime.memory_pool);
 	switch_event_create_plain(&runtime.global_vars, SWITCH_EVENT_CHANNEL_DATA);
 	switch_core_hash_init_case(&runtime.mime_types, SWITCH_FALSE);
 	switch_core_hash_init_case(&runtime.mime_type_exts, SWITCH_FALSE);
@@ -1959,6 +1960,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_init(switch_core_flag_t flags, switc
 	switch_console_init(runtime.memory_pool);
 	switch_event_init(runtime.memory_pool);
 	switch_channel_global_init(runtime.memory_pool);
+	switch_regex_init(runtime.memory_pool);
 
 	if (switch_xml_init(runtime.memory_pool, err) != SWITCH_STATUS_SUCCESS) {
 		apr_terminate();
@@ -1991,6 +1993,8 @@ SWITCH_DECLARE(switch_status_t) switch_core_init(switch_core_flag_t flags, switc
 	switch_nat_late_init();
 
 	switch_rtp_init(runtime.memory_pool);
+	switch_ivr_record_writer_start(runtime.memory_pool);
+	switch_core_channel_registry_start(runtime.memory_pool);
 
 	runtime.running = 1;
 	runtime.initiated = switch_mono_micro_time_now();
@@ -2234,6 +2238,10 @@ static void switch_load_core_config(const char *file)
 						}
 					}
 					switch_time_set_timerfd(ival);
+				} else if (!strcasecmp(var, "enable-softtimer-wheel")) {
+					switch_time_set_wheel(switch_true(val));
+				} else if (!strcasecmp(var, "resample-polyphase")) {
+					switch_resample_set_polyphase(switch_true(val));
 				} else if (!strcasecmp(var, "enable-clock-nanosleep")) {
 					switch_time_set_nanosleep(switch_true(val));
 				} else if (!strcasecmp(var, "enable-cond-yield")) {
@@ -2306,6 +2314,52 @@ static void switch_load_core_config(const char *file)
 					switch_rtp_set_end_port((switch_port_t) atoi(val));
 				} else if (!strcasecmp(var, "rtp-port-usage-robustness") && switch_true(val)) {
 					runtime.port_alloc_flags |= SPF_ROBUST_UDP;
+				} else if (!strcasecmp(var, "rtp-media-reactor-threads") && !zstr(val)) {
+					int tmp = atoi(val);
+
+					if (tmp < 0 || tmp > runtime.cpu_count) {
+						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "rtp-media-reactor-threads must be between 0 and %d\n", runtime.cpu_count);
+					} else {
+						switch_rtp_set_media_reactor_threads((uint32_t) tmp);
+					}
+				} else if (!strcasecmp(var, "recording-writer-threads") && !zstr(val)) {
+					int tmp = atoi(val);
+
+					if (tmp < 0 || tmp > 64) {
+						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "recording-writer-threads must be between 0 and 64\n");
+					} else {
+						switch_ivr_record_writer_set_threads((uint32_t) tmp);
+					}
+				} else if (!strcasecmp(var, "recording-writer-max-buffer-kb") && !zstr(val)) {
+					int tmp = atoi(val);
+
+					if (tmp < 16) {
+						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "recording-writer-max-buffer-kb must be at least 16\n");
+					} else {
+						switch_ivr_record_writer_set_max_buffer((switch_size_t) tmp * 1024);
+					}
+				} else if (!strcasecmp(var, "channel-sql-export")) {
+					runtime.channel_sql_export = switch_true(val);
+				} else if (!strcasecmp(var, "regex-cache-size") && !zstr(val)) {
+					int tmp = atoi(val);
+
+					if (tmp < 0) {
+						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "regex-cache-size must not be negative\n");
+					} else {
+						switch_regex_set_cache_size((uint32_t) tmp);
+					}
+				} else if (!strcasecmp(var, "xml-cache-sections")) {
+					switch_xml_set_result_cache_sections(val);
+				} else if (!strcasecmp(var, "xml-cache-ttl") && !zstr(val)) {
+					int tmp = atoi(val);
+
+					if (tmp < 0) {
+						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "xml-cache-ttl must not be negative\n");
+					} else {
+						switch_xml_set_result_cache_ttl((uint32_t) tmp);
+					}
+				} else if (!strcasecmp(var, "xml-cache-key-params") && !zstr(val)) {
+					switch_xml_set_result_cache_key_params(val);
 				} else if (!strcasecmp(var, "core-db-name") && !zstr(val)) {
 					runtime.dbname = switch_core_strdup(runtime.memory_pool, val);
 				} else if (!strcasecmp(var, "core-db-dsn") && !zstr(val)) {
@@ -2946,6 +3000,8 @@ SWITCH_DECLARE(switch_status_t) switch_core_destroy(void)
 	}
 	switch_scheduler_task_thread_stop();
 
+	switch_core_channel_registry_stop();
+	switch_ivr_record_writer_stop();
 	switch_rtp_shutdown();
 	switch_msrp_destroy();
 
@@ -2955,6 +3011,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_destroy(void)
 	switch_xml_destroy();
 	switch_console_shutdown();
 	switch_channel_global_uninit();
+	switch_regex_shutdown();
 
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "Closing Event Engine.\n");
 	switch_event_shutdown();
@@ -2963,6 +3020,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_destroy(void)
 	switch_log_shutdown();
 
 	switch_core_session_uninit();
+	switch_resample_pool_shutdown();
 	switch_core_unset_variables();
 	switch_core_memory_stop();
 
@@ -0,0 +1,1009 @@
+/*
+ * FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ * Copyright (C) 2005-2014, Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Version: MPL 1.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ *
+ * The Initial Developer of the Original Code is
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Portions created by the Initial Developer are Copyright (C)
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Anthony Minessale II <anthm@freeswitch.org>
+ *
+ *
+ * switch_core_channel_registry.c -- In-memory registry of the local channels and calls
+ *
+ */
+
+#include <switch.h>
+#include "private/switch_core_pvt.h"
+
+/*
+ * The registry keeps the same rows the core db keeps in the "channels" and "calls" tables,
+ * maintained straight from the channel events so show channels/calls and friends never
+ * have to go through sql.  Rows are arrays of column values in the order of the channels
+ * table so they can be handed to the usual switch_core_db_callback_func_t callbacks as is.
+ */
+
+typedef enum {
+	CR_UUID,
+	CR_DIRECTION,
+	CR_CREATED,
+	CR_CREATED_EPOCH,
+	CR_NAME,
+	CR_STATE,
+	CR_CID_NAME,
+	CR_CID_NUM,
+	CR_IP_ADDR,
+	CR_DEST,
+	CR_APPLICATION,
+	CR_APPLICATION_DATA,
+	CR_DIALPLAN,
+	CR_CONTEXT,
+	CR_READ_CODEC,
+	CR_READ_RATE,
+	CR_READ_BIT_RATE,
+	CR_WRITE_CODEC,
+	CR_WRITE_RATE,
+	CR_WRITE_BIT_RATE,
+	CR_SECURE,
+	CR_HOSTNAME,
+	CR_PRESENCE_ID,
+	CR_PRESENCE_DATA,
+	CR_ACCOUNTCODE,
+	CR_CALLSTATE,
+	CR_CALLEE_NAME,
+	CR_CALLEE_NUM,
+	CR_CALLEE_DIRECTION,
+	CR_CALL_UUID,
+	CR_SENT_CALLEE_NAME,
+	CR_SENT_CALLEE_NUM,
+	CR_INITIAL_CID_NAME,
+	CR_INITIAL_CID_NUM,
+	CR_INITIAL_IP_ADDR,
+	CR_INITIAL_DEST,
+	CR_INITIAL_DIALPLAN,
+	CR_INITIAL_CONTEXT,
+	CR_COLS
+} cr_col_t;
+
+static const char *cr_col_names[CR_COLS] = {
+	"uuid", "direction", "created", "created_epoch", "name", "state", "cid_name", "cid_num", "ip_addr", "dest",
+	"application", "application_data", "dialplan", "context", "read_codec", "read_rate", "read_bit_rate",
+	"write_codec", "write_rate", "write_bit_rate", "secure", "hostname", "presence_id", "presence_data",
+	"accountcode", "callstate", "callee_name", "callee_num", "callee_direction", "call_uuid", "sent_callee_name",
+	"sent_callee_num", "initial_cid_name", "initial_cid_num", "initial_ip_addr", "initial_dest", "initial_dialplan",
+	"initial_context"
+};
+
+/* secondary indexes, uuid has its own unique hash */
+static const cr_col_t cr_indexed[] = { CR_CALL_UUID, CR_PRESENCE_ID, CR_HOSTNAME };
+#define CR_INDEXES (sizeof(cr_indexed) / sizeof(cr_indexed[0]))
+
+/* the a and b leg columns of the basic_calls and detailed_calls views */
+static const cr_col_t cr_basic_cols[] = {
+	CR_UUID, CR_DIRECTION, CR_CREATED, CR_CREATED_EPOCH, CR_NAME, CR_STATE, CR_CID_NAME, CR_CID_NUM, CR_IP_ADDR, CR_DEST,
+	CR_PRESENCE_ID, CR_PRESENCE_DATA, CR_ACCOUNTCODE, CR_CALLSTATE, CR_CALLEE_NAME, CR_CALLEE_NUM, CR_CALLEE_DIRECTION,
+	CR_CALL_UUID, CR_HOSTNAME, CR_SENT_CALLEE_NAME, CR_SENT_CALLEE_NUM
+};
+static const cr_col_t cr_basic_b_cols[] = {
+	CR_UUID, CR_DIRECTION, CR_CREATED, CR_CREATED_EPOCH, CR_NAME, CR_STATE, CR_CID_NAME, CR_CID_NUM, CR_IP_ADDR, CR_DEST,
+	CR_PRESENCE_ID, CR_PRESENCE_DATA, CR_ACCOUNTCODE, CR_CALLSTATE, CR_CALLEE_NAME, CR_CALLEE_NUM, CR_CALLEE_DIRECTION,
+	CR_SENT_CALLEE_NAME, CR_SENT_CALLEE_NUM
+};
+#define CR_DETAILED_COLS (CR_SENT_CALLEE_NUM + 1)
+#define CR_VIEW_MAX (CR_DETAILED_COLS * 2 + 1)
+
+struct cr_call {
+	char *callee_uuid;
+	char epoch[32];
+};
+
+struct cr_row {
+	char *col[CR_COLS];
+	/* the call we placed (we are the caller_uuid of the calls row) */
+	struct cr_call *call;
+	/* the caller of the call we are the callee of */
+	char *caller_uuid;
+	struct cr_row *prev, *next;
+	struct cr_row *iprev[CR_INDEXES], *inext[CR_INDEXES];
+};
+
+struct cr_map {
+	cr_col_t col;
+	const char *header;
+};
+
+static const struct cr_map cr_codec_map[] = {
+	{ CR_READ_CODEC, "channel-read-codec-name" },
+	{ CR_READ_RATE, "channel-read-codec-rate" },
+	{ CR_READ_BIT_RATE, "channel-read-codec-bit-rate" },
+	{ CR_WRITE_CODEC, "channel-write-codec-name" },
+	{ CR_WRITE_RATE, "channel-write-codec-rate" },
+	{ CR_WRITE_BIT_RATE, "channel-write-codec-bit-rate" }
+};
+
+static const struct cr_map cr_execute_map[] = {
+	{ CR_APPLICATION, "application" },
+	{ CR_APPLICATION_DATA, "application-data" },
+	{ CR_PRESENCE_ID, "channel-presence-id" },
+	{ CR_PRESENCE_DATA, "channel-presence-data" },
+	{ CR_ACCOUNTCODE, "variable_accountcode" }
+};
+
+static const struct cr_map cr_originate_map[] = {
+	{ CR_PRESENCE_ID, "channel-presence-id" },
+	{ CR_PRESENCE_DATA, "channel-presence-data" },
+	{ CR_ACCOUNTCODE, "variable_accountcode" },
+	{ CR_CALL_UUID, "channel-call-uuid" }
+};
+
+static const struct cr_map cr_call_update_map[] = {
+	{ CR_CALLEE_NAME, "caller-callee-id-name" },
+	{ CR_CALLEE_NUM, "caller-callee-id-number" },
+	{ CR_SENT_CALLEE_NAME, "sent-callee-id-name" },
+	{ CR_SENT_CALLEE_NUM, "sent-callee-id-number" },
+	{ CR_CALLEE_DIRECTION, "direction" },
+	{ CR_CID_NAME, "caller-caller-id-name" },
+	{ CR_CID_NUM, "caller-caller-id-number" }
+};
+
+static const struct cr_map cr_routing_map[] = {
+	{ CR_STATE, "channel-state" },
+	{ CR_CID_NAME, "caller-caller-id-name" },
+	{ CR_CID_NUM, "caller-caller-id-number" },
+	{ CR_CALLEE_NAME, "caller-callee-id-name" },
+	{ CR_CALLEE_NUM, "caller-callee-id-number" },
+	{ CR_SENT_CALLEE_NAME, "sent-callee-id-name" },
+	{ CR_SENT_CALLEE_NUM, "sent-callee-id-number" },
+	{ CR_IP_ADDR, "caller-network-addr" },
+	{ CR_DEST, "caller-destination-number" },
+	{ CR_DIALPLAN, "caller-dialplan" },
+	{ CR_CONTEXT, "caller-context" },
+	{ CR_PRESENCE_ID, "channel-presence-id" },
+	{ CR_PRESENCE_DATA, "channel-presence-data" },
+	{ CR_ACCOUNTCODE, "variable_accountcode" }
+};
+
+static const struct cr_map cr_create_map[] = {
+	{ CR_UUID, "unique-id" },
+	{ CR_DIRECTION, "call-direction" },
+	{ CR_CREATED, "event-date-local" },
+	{ CR_NAME, "channel-name" },
+	{ CR_STATE, "channel-state" },
+	{ CR_CALLSTATE, "channel-call-state" },
+	{ CR_DIALPLAN, "caller-dialplan" },
+	{ CR_CONTEXT, "caller-context" },
+	{ CR_INITIAL_CID_NAME, "caller-caller-id-name" },
+	{ CR_INITIAL_CID_NUM, "caller-caller-id-number" },
+	{ CR_INITIAL_IP_ADDR, "caller-network-addr" },
+	{ CR_INITIAL_DEST, "caller-destination-number" },
+	{ CR_INITIAL_DIALPLAN, "caller-dialplan" },
+	{ CR_INITIAL_CONTEXT, "caller-context" }
+};
+
+#define cr_apply_map(_row, _event, _map) cr_apply(_row, _event, _map, sizeof(_map) / sizeof(_map[0]))
+
+static switch_event_types_t cr_events[] = {
+	SWITCH_EVENT_CHANNEL_CREATE,
+	SWITCH_EVENT_CHANNEL_DESTROY,
+	SWITCH_EVENT_CHANNEL_UUID,
+	SWITCH_EVENT_CHANNEL_ANSWER,
+	SWITCH_EVENT_CHANNEL_PROGRESS_MEDIA,
+	SWITCH_EVENT_CODEC,
+	SWITCH_EVENT_CHANNEL_HOLD,
+	SWITCH_EVENT_CHANNEL_UNHOLD,
+	SWITCH_EVENT_CHANNEL_EXECUTE,
+	SWITCH_EVENT_CHANNEL_ORIGINATE,
+	SWITCH_EVENT_CALL_UPDATE,
+	SWITCH_EVENT_CHANNEL_CALLSTATE,
+	SWITCH_EVENT_CHANNEL_STATE,
+	SWITCH_EVENT_CHANNEL_BRIDGE,
+	SWITCH_EVENT_CHANNEL_UNBRIDGE,
+	SWITCH_EVENT_CALL_SECURE
+};
+
+static struct {
+	switch_memory_pool_t *pool;
+	switch_thread_rwlock_t *rwlock;
+	switch_hash_t *by_uuid;
+	switch_hash_t *index[CR_INDEXES];
+	struct cr_row *head, *tail;
+	char *view_names[2][CR_VIEW_MAX];
+	uint32_t channels;
+	uint32_t calls;
+	uint64_t events;
+	uint64_t queries;
+	int running;
+	int bound;
+	switch_channel_registry_live_func_t live;
+} registry;
+
+/* is the channel alive in the core, with snapshot set also fill in a CREATE shaped event from its current data */
+static switch_status_t cr_channel_live(const char *uuid, switch_event_t **snapshot)
+{
+	switch_core_session_t *session;
+	switch_time_exp_t tm;
+	switch_size_t retsize;
+	char date[80] = "";
+
+	if (!snapshot) {
+		return switch_ivr_uuid_exists(uuid) ? SWITCH_STATUS_SUCCESS : SWITCH_STATUS_FALSE;
+	}
+
+	if (!(session = switch_core_session_locate(uuid))) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	switch_event_create(snapshot, SWITCH_EVENT_CHANNEL_CREATE);
+	switch_channel_event_set_data(switch_core_session_get_channel(session), *snapshot);
+	switch_core_session_rwunlock(session);
+
+	switch_time_exp_lt(&tm, switch_micro_time_now());
+	switch_strftime_nocheck(date, &retsize, sizeof(date), "%Y-%m-%d %T", &tm);
+	switch_event_add_header_string(*snapshot, SWITCH_STACK_BOTTOM, "Event-Date-Local", date);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static void cr_index_unlink(struct cr_row *row, size_t i)
+{
+	const char *key = row->col[cr_indexed[i]];
+
+	if (zstr(key)) {
+		return;
+	}
+
+	if (row->iprev[i]) {
+		row->iprev[i]->inext[i] = row->inext[i];
+	} else if (row->inext[i]) {
+		switch_core_hash_insert(registry.index[i], key, row->inext[i]);
+	} else {
+		switch_core_hash_delete(registry.index[i], key);
+	}
+
+	if (row->inext[i]) {
+		row->inext[i]->iprev[i] = row->iprev[i];
+	}
+
+	row->iprev[i] = row->inext[i] = NULL;
+}
+
+static void cr_index_link(struct cr_row *row, size_t i)
+{
+	const char *key = row->col[cr_indexed[i]];
+	struct cr_row *head;
+
+	if (zstr(key)) {
+		return;
+	}
+
+	if ((head = switch_core_hash_find(registry.index[i], key))) {
+		head->iprev[i] = row;
+	}
+
+	row->inext[i] = head;
+	row->iprev[i] = NULL;
+	switch_core_hash_insert(registry.index[i], key, row);
+}
+
+static void cr_set(struct cr_row *row, cr_col_t col, const char *val)
+{
+	size_t i;
+	int idx = -1;
+
+	if (row->col[col] && val && !strcmp(row->col[col], val)) {
+		return;
+	}
+
+	for (i = 0; i < CR_INDEXES; i++) {
+		if (cr_indexed[i] == col) {
+			idx = (int) i;
+			cr_index_unlink(row, i);
+			break;
+		}
+	}
+
+	switch_safe_free(row->col[col]);
+	row->col[col] = val ? strdup(val) : NULL;
+
+	if (idx > -1) {
+		cr_index_link(row, (size_t) idx);
+	}
+}
+
+static void cr_apply(struct cr_row *row, switch_event_t *event, const struct cr_map *map, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		cr_set(row, map[i].col, switch_event_get_header_nil(event, map[i].header));
+	}
+}
+
+/* same columns the core db fills in from presence-data-cols, names that are not channels columns are ignored */
+static void cr_apply_presence_data(struct cr_row *row, switch_event_t *event)
+{
+	const char *data = switch_event_get_header(event, "presence-data-cols");
+	char *data_copy, *cols[128] = { 0 };
+	char col_name[128] = "";
+	int col_count, i, x;
+
+	if (zstr(data)) {
+		return;
+	}
+
+	data_copy = strdup(data);
+	col_count = switch_split(data_copy, ':', cols);
+
+	for (i = 0; i < col_count; i++) {
+		const char *val;
+
+		for (x = 0; x < CR_COLS; x++) {
+			if (!strcasecmp(cols[i], cr_col_names[x])) {
+				break;
+			}
+		}
+
+		if (x == CR_COLS || x == CR_UUID) {
+			continue;
+		}
+
+		switch_snprintf(col_name, sizeof(col_name), "PD-%s", cols[i]);
+		val = switch_event_get_header(event, col_name);
+		cr_set(row, (cr_col_t) x, zstr(val) ? NULL : val);
+	}
+
+	free(data_copy);
+}
+
+static struct cr_row *cr_find(const char *uuid)
+{
+	return zstr(uuid) ? NULL : switch_core_hash_find(registry.by_uuid, uuid);
+}
+
+/* what "delete from calls where caller_uuid=? or callee_uuid=?" does to the calls table */
+static void cr_calls_drop(const char *uuid)
+{
+	struct cr_row *row, *other;
+
+	if (!(row = cr_find(uuid))) {
+		return;
+	}
+
+	if (row->call) {
+		if ((other = cr_find(row->call->callee_uuid)) && other->caller_uuid && !strcmp(other->caller_uuid, uuid)) {
+			switch_safe_free(other->caller_uuid);
+		}
+		free(row->call->callee_uuid);
+		switch_safe_free(row->call);
+		registry.calls--;
+	}
+
+	if (row->caller_uuid) {
+		if ((other = cr_find(row->caller_uuid)) && other->call && !strcmp(other->call->callee_uuid, uuid)) {
+			free(other->call->callee_uuid);
+			switch_safe_free(other->call);
+			registry.calls--;
+		}
+		switch_safe_free(row->caller_uuid);
+	}
+}
+
+static void cr_row_destroy(struct cr_row *row)
+{
+	size_t i;
+	int x;
+
+	cr_calls_drop(row->col[CR_UUID]);
+
+	for (i = 0; i < CR_INDEXES; i++) {
+		cr_index_unlink(row, i);
+	}
+
+	switch_core_hash_delete(registry.by_uuid, row->col[CR_UUID]);
+
+	if (row->prev) {
+		row->prev->next = row->next;
+	} else {
+		registry.head = row->next;
+	}
+
+	if (row->next) {
+		row->next->prev = row->prev;
+	} else {
+		registry.tail = row->prev;
+	}
+
+	for (x = 0; x < CR_COLS; x++) {
+		switch_safe_free(row->col[x]);
+	}
+
+	free(row);
+	registry.channels--;
+}
+
+static void cr_channel_create(switch_event_t *event, const char *uuid)
+{
+	struct cr_row *row;
+	char epoch[32];
+
+	if (cr_find(uuid)) {
+		return;
+	}
+
+	switch_zmalloc(row, sizeof(*row));
+	cr_apply_map(row, event, cr_create_map);
+
+	switch_snprintf(epoch, sizeof(epoch), "%ld", (long) switch_epoch_time_now(NULL));
+	cr_set(row, CR_CREATED_EPOCH, epoch);
+	cr_set(row, CR_HOSTNAME, switch_core_get_switchname());
+
+	switch_core_hash_insert(registry.by_uuid, row->col[CR_UUID], row);
+
+	if ((row->prev = registry.tail)) {
+		registry.tail->next = row;
+	} else {
+		registry.head = row;
+	}
+	registry.tail = row;
+
+	registry.channels++;
+}
+
+static void cr_channel_rename(const char *old_uuid, const char *uuid)
+{
+	struct cr_row *row, *other, *next;
+	switch_event_t *snapshot = NULL;
+
+	if (zstr(uuid) || zstr(old_uuid) || cr_find(uuid)) {
+		return;
+	}
+
+	if (!(row = cr_find(old_uuid))) {
+		/* the rename is sharded by the new uuid and the CREATE by the old one, a CREATE that comes in after the core renamed
+		   the channel finds old_uuid gone and is dropped, so the row is built from the live channel here instead */
+		if (registry.live(uuid, &snapshot) == SWITCH_STATUS_SUCCESS && snapshot) {
+			cr_channel_create(snapshot, uuid);
+			switch_event_destroy(&snapshot);
+		}
+
+		for (other = switch_core_hash_find(registry.index[0], old_uuid); other; other = next) {
+			next = other->inext[0];
+			cr_set(other, CR_CALL_UUID, uuid);
+		}
+
+		return;
+	}
+
+	switch_core_hash_delete(registry.by_uuid, old_uuid);
+
+	if (row->call && (other = cr_find(row->call->callee_uuid))) {
+		switch_safe_free(other->caller_uuid);
+		other->caller_uuid = strdup(uuid);
+	}
+
+	if (row->caller_uuid && (other = cr_find(row->caller_uuid)) && other->call) {
+		free(other->call->callee_uuid);
+		other->call->callee_uuid = strdup(uuid);
+	}
+
+	/* update channels set call_uuid=<new> where call_uuid=<old> */
+	for (other = switch_core_hash_find(registry.index[0], old_uuid); other; other = next) {
+		next = other->inext[0];
+		cr_set(other, CR_CALL_UUID, uuid);
+	}
+
+	cr_set(row, CR_UUID, uuid);
+	switch_core_hash_insert(registry.by_uuid, row->col[CR_UUID], row);
+}
+
+static void cr_channel_bridge(switch_event_t *event, const char *uuid)
+{
+	const char *a_uuid, *b_uuid, *call_uuid;
+	struct cr_row *row, *a, *b;
+
+	a_uuid = switch_event_get_header(event, "Bridge-A-Unique-ID");
+	b_uuid = switch_event_get_header(event, "Bridge-B-Unique-ID");
+	call_uuid = switch_event_get_header_nil(event, "channel-call-uuid");
+
+	if (zstr(a_uuid) || zstr(b_uuid)) {
+		a_uuid = switch_event_get_header_nil(event, "caller-unique-id");
+		b_uuid = switch_event_get_header_nil(event, "other-leg-unique-id");
+	}
+
+	if ((row = cr_find(uuid))) {
+		cr_apply_presence_data(row, event);
+	}
+
+	if (!(a = cr_find(a_uuid)) || !(b = cr_find(b_uuid))) {
+		return;
+	}
+
+	cr_set(a, CR_CALL_UUID, call_uuid);
+	cr_set(b, CR_CALL_UUID, call_uuid);
+
+	/* one call per caller, a rebridge replaces the old one */
+	cr_calls_drop(a_uuid);
+	cr_calls_drop(b_uuid);
+
+	switch_zmalloc(a->call, sizeof(*a->call));
+	a->call->callee_uuid = strdup(b_uuid);
+	switch_snprintf(a->call->epoch, sizeof(a->call->epoch), "%ld", (long) switch_epoch_time_now(NULL));
+	b->caller_uuid = strdup(a_uuid);
+	registry.calls++;
+}
+
+static void cr_channel_unbridge(switch_event_t *event, const char *uuid)
+{
+	const char *call_uuid = switch_event_get_header(event, "channel-call-uuid");
+	struct cr_row *row, *next;
+
+	if ((row = cr_find(uuid))) {
+		cr_apply_presence_data(row, event);
+	}
+
+	/* update channels set call_uuid=uuid where call_uuid=? */
+	if (!zstr(call_uuid)) {
+		for (row = switch_core_hash_find(registry.index[0], call_uuid); row; row = next) {
+			next = row->inext[0];
+			cr_set(row, CR_CALL_UUID, row->col[CR_UUID]);
+		}
+	}
+
+	cr_calls_drop(switch_event_get_header(event, "caller-unique-id"));
+}
+
+static void channel_registry_event_handler(switch_event_t *event)
+{
+	const char *uuid = switch_event_get_header(event, "unique-id");
+	struct cr_row *row = NULL;
+
+	switch_thread_rwlock_wrlock(registry.rwlock);
+
+	registry.events++;
+
+	if (!registry.running) {
+		goto end;
+	}
+
+	switch (event->event_id) {
+	case SWITCH_EVENT_CHANNEL_CREATE:
+		/* a late create must not bring back a channel that is already gone or renamed, checked under the lock
+		   so a rename that finds no row yet can rely on the create having been dropped */
+		if (!zstr(uuid) && registry.live(uuid, NULL) == SWITCH_STATUS_SUCCESS) {
+			cr_channel_create(event, uuid);
+		}
+		break;
+	case SWITCH_EVENT_CHANNEL_DESTROY:
+		if ((row = cr_find(uuid))) {
+			cr_row_destroy(row);
+		}
+		break;
+	case SWITCH_EVENT_CHANNEL_UUID:
+		cr_channel_rename(switch_event_get_header(event, "old-unique-id"), uuid);
+		break;
+	case SWITCH_EVENT_CHANNEL_BRIDGE:
+		cr_channel_bridge(event, uuid);
+		break;
+	case SWITCH_EVENT_CHANNEL_UNBRIDGE:
+		cr_channel_unbridge(event, uuid);
+		break;
+	case SWITCH_EVENT_CALL_SECURE:
+		{
+			const char *type = switch_event_get_header(event, "secure_type");
+
+			if (!zstr(type) && (row = cr_find(switch_event_get_header(event, "caller-unique-id")))) {
+				cr_set(row, CR_SECURE, type);
+			}
+		}
+		break;
+	default:
+		if (!(row = cr_find(uuid))) {
+			break;
+		}
+
+		switch (event->event_id) {
+		case SWITCH_EVENT_CHANNEL_ANSWER:
+		case SWITCH_EVENT_CHANNEL_PROGRESS_MEDIA:
+		case SWITCH_EVENT_CODEC:
+			cr_apply_map(row, event, cr_codec_map);
+			break;
+		case SWITCH_EVENT_CHANNEL_HOLD:
+		case SWITCH_EVENT_CHANNEL_UNHOLD:
+		case SWITCH_EVENT_CHANNEL_EXECUTE:
+			cr_apply_map(row, event, cr_execute_map);
+			break;
+		case SWITCH_EVENT_CHANNEL_ORIGINATE:
+			cr_apply_map(row, event, cr_originate_map);
+			cr_apply_presence_data(row, event);
+			break;
+		case SWITCH_EVENT_CALL_UPDATE:
+			cr_apply_map(row, event, cr_call_update_map);
+			break;
+		case SWITCH_EVENT_CHANNEL_CALLSTATE:
+			{
+				const char *num = switch_event_get_header(event, "channel-call-state-number");
+				switch_channel_callstate_t callstate = num ? atoi(num) : CCS_DOWN;
+
+				if (callstate != CCS_DOWN && callstate != CCS_HANGUP) {
+					cr_set(row, CR_CALLSTATE, switch_event_get_header_nil(event, "channel-call-state"));
+					cr_apply_presence_data(row, event);
+				}
+			}
+			break;
+		case SWITCH_EVENT_CHANNEL_STATE:
+			{
+				const char *state = switch_event_get_header(event, "channel-state-number");
+				switch_channel_state_t state_i = zstr(state) ? CS_DESTROY : atoi(state);
+
+				switch (state_i) {
+				case CS_NEW:
+				case CS_DESTROY:
+				case CS_REPORTING:
+				case CS_HANGUP:
+				case CS_INIT:
+					break;
+				case CS_ROUTING:
+					cr_apply_map(row, event, cr_routing_map);
+					cr_apply_presence_data(row, event);
+					break;
+				case CS_EXECUTE:
+					cr_set(row, CR_STATE, switch_event_get_header_nil(event, "channel-state"));
+					cr_apply_presence_data(row, event);
+					break;
+				default:
+					cr_set(row, CR_STATE, switch_event_get_header_nil(event, "channel-state"));
+					break;
+				}
+			}
+			break;
+		default:
+			break;
+		}
+		break;
+	}
+
+ end:
+
+	switch_thread_rwlock_unlock(registry.rwlock);
+}
+
+/* sql LIKE, case insensitive, % and _ wildcards */
+static switch_bool_t cr_like(const char *pattern, const char *str)
+{
+	for (; *pattern; pattern++, str++) {
+		if (*pattern == '%') {
+			while (*pattern == '%') {
+				pattern++;
+			}
+
+			if (!*pattern) {
+				return SWITCH_TRUE;
+			}
+
+			for (; *str; str++) {
+				if (cr_like(pattern, str)) {
+					return SWITCH_TRUE;
+				}
+			}
+
+			return SWITCH_FALSE;
+		}
+
+		if (!*str || (*pattern != '_' && switch_tolower(*pattern) != switch_tolower(*str))) {
+			return SWITCH_FALSE;
+		}
+	}
+
+	return *str ? SWITCH_FALSE : SWITCH_TRUE;
+}
+
+static switch_bool_t cr_row_like(struct cr_row *row, const char *like)
+{
+	static const cr_col_t cols[] = { CR_UUID, CR_NAME, CR_CID_NAME, CR_CID_NUM, CR_PRESENCE_DATA, CR_ACCOUNTCODE };
+	size_t i;
+
+	for (i = 0; i < sizeof(cols) / sizeof(cols[0]); i++) {
+		if (row->col[cols[i]] && cr_like(like, row->col[cols[i]])) {
+			return SWITCH_TRUE;
+		}
+	}
+
+	return SWITCH_FALSE;
+}
+
+/* lay out one row of a calls view, returns the column count */
+static int cr_call_row(switch_channel_registry_view_t view, struct cr_row *a, struct cr_row *b, char **argv)
+{
+	int argc = 0;
+	size_t i;
+
+	if (view == SWITCH_CHANNEL_REGISTRY_DETAILED_CALLS) {
+		for (i = 0; i < CR_DETAILED_COLS; i++) {
+			argv[argc++] = a->col[i];
+		}
+		for (i = 0; i < CR_DETAILED_COLS; i++) {
+			argv[argc++] = b ? b->col[i] : NULL;
+		}
+	} else {
+		for (i = 0; i < sizeof(cr_basic_cols) / sizeof(cr_basic_cols[0]); i++) {
+			argv[argc++] = a->col[cr_basic_cols[i]];
+		}
+		for (i = 0; i < sizeof(cr_basic_b_cols) / sizeof(cr_basic_b_cols[0]); i++) {
+			argv[argc++] = b ? b->col[cr_basic_b_cols[i]] : NULL;
+		}
+	}
+
+	argv[argc++] = a->call ? a->call->epoch : NULL;
+
+	return argc;
+}
+
+SWITCH_DECLARE(uint32_t) switch_channel_registry_query(switch_channel_registry_view_t view, const char *like, switch_bool_t bridged_only,
+													   switch_core_db_callback_func_t callback, void *pArg)
+{
+	struct cr_row *row, *b;
+	char *argv[CR_VIEW_MAX];
+	char *pattern = NULL;
+	uint32_t count = 0;
+	int argc;
+
+	/* not started (minimal core) */
+	if (!registry.rwlock) {
+		return 0;
+	}
+
+	if (!zstr(like)) {
+		pattern = strchr(like, '%') ? strdup(like) : switch_mprintf("%%%s%%", like);
+	}
+
+	switch_thread_rwlock_rdlock(registry.rwlock);
+
+	registry.queries++;
+
+	for (row = registry.running ? registry.head : NULL; row; row = row->next) {
+		if (pattern && !cr_row_like(row, pattern)) {
+			continue;
+		}
+
+		if (view == SWITCH_CHANNEL_REGISTRY_CHANNELS) {
+			count++;
+			if (callback && callback(pArg, CR_COLS, row->col, (char **) cr_col_names)) {
+				break;
+			}
+			continue;
+		}
+
+		/* the calls views list every caller plus every channel that is not the callee of a call */
+		if (row->caller_uuid) {
+			continue;
+		}
+
+		b = row->call ? cr_find(row->call->callee_uuid) : NULL;
+
+		if (bridged_only && !b) {
+			continue;
+		}
+
+		count++;
+
+		if (callback) {
+			argc = cr_call_row(view, row, b, argv);
+			if (callback(pArg, argc, argv, registry.view_names[view == SWITCH_CHANNEL_REGISTRY_DETAILED_CALLS])) {
+				break;
+			}
+		}
+	}
+
+	switch_thread_rwlock_unlock(registry.rwlock);
+
+	switch_safe_free(pattern);
+
+	return count;
+}
+
+SWITCH_DECLARE(uint32_t) switch_channel_registry_count(switch_channel_registry_view_t view)
+{
+	uint32_t count;
+
+	if (!registry.rwlock || view != SWITCH_CHANNEL_REGISTRY_CHANNELS) {
+		return switch_channel_registry_query(view, NULL, SWITCH_FALSE, NULL, NULL);
+	}
+
+	switch_thread_rwlock_rdlock(registry.rwlock);
+	count = registry.channels;
+	switch_thread_rwlock_unlock(registry.rwlock);
+
+	return count;
+}
+
+SWITCH_DECLARE(uint32_t) switch_channel_registry_lookup(const char *column, const char *key, switch_core_db_callback_func_t callback, void *pArg)
+{
+	struct cr_row *row;
+	uint32_t count = 0;
+	size_t i;
+
+	if (!registry.rwlock || zstr(column) || zstr(key)) {
+		return 0;
+	}
+
+	switch_thread_rwlock_rdlock(registry.rwlock);
+
+	registry.queries++;
+
+	if (!registry.running) {
+		count = 0;
+	} else if (!strcasecmp(column, "uuid")) {
+		if ((row = cr_find(key))) {
+			count++;
+			if (callback) {
+				callback(pArg, CR_COLS, row->col, (char **) cr_col_names);
+			}
+		}
+	} else {
+		for (i = 0; i < CR_INDEXES; i++) {
+			if (!strcasecmp(column, cr_col_names[cr_indexed[i]])) {
+				break;
+			}
+		}
+
+		if (i == CR_INDEXES) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Channel registry has no index on %s\n", column);
+		} else {
+			for (row = switch_core_hash_find(registry.index[i], key); row; row = row->inext[i]) {
+				count++;
+				if (callback && callback(pArg, CR_COLS, row->col, (char **) cr_col_names)) {
+					break;
+				}
+			}
+		}
+	}
+
+	switch_thread_rwlock_unlock(registry.rwlock);
+
+	return count;
+}
+
+SWITCH_DECLARE(void) switch_channel_registry_status(switch_stream_handle_t *stream)
+{
+	if (!registry.rwlock) {
+		stream->write_function(stream, "Channel registry: not started\n");
+		return;
+	}
+
+	switch_thread_rwlock_rdlock(registry.rwlock);
+	stream->write_function(stream, "Channel registry: %s\n\tChannels: %u\n\tCalls: %u\n\tEvents: %" SWITCH_UINT64_T_FMT
+						   "\n\tQueries: %" SWITCH_UINT64_T_FMT "\n\tSQL export: %s\n",
+						   registry.running ? "running" : "stopped", registry.channels, registry.calls, registry.events, registry.queries,
+						   runtime.channel_sql_export ? "enabled" : "disabled");
+	switch_thread_rwlock_unlock(registry.rwlock);
+}
+
+static void cr_init(switch_memory_pool_t *pool, switch_channel_registry_live_func_t live)
+{
+	size_t i, x;
+	int argc;
+
+	memset(&registry, 0, sizeof(registry));
+	registry.pool = pool;
+	registry.live = live;
+
+	switch_thread_rwlock_create(&registry.rwlock, pool);
+	switch_core_hash_init(&registry.by_uuid);
+
+	for (i = 0; i < CR_INDEXES; i++) {
+		switch_core_hash_init(&registry.index[i]);
+	}
+
+	/* column names of the basic_calls and detailed_calls views */
+	for (x = 0; x < 2; x++) {
+		argc = 0;
+
+		if (x) {
+			for (i = 0; i < CR_DETAILED_COLS; i++) {
+				registry.view_names[x][argc++] = (char *) cr_col_names[i];
+			}
+			for (i = 0; i < CR_DETAILED_COLS; i++) {
+				registry.view_names[x][argc++] = switch_core_sprintf(pool, "b_%s", cr_col_names[i]);
+			}
+		} else {
+			for (i = 0; i < sizeof(cr_basic_cols) / sizeof(cr_basic_cols[0]); i++) {
+				registry.view_names[x][argc++] = (char *) cr_col_names[cr_basic_cols[i]];
+			}
+			for (i = 0; i < sizeof(cr_basic_b_cols) / sizeof(cr_basic_b_cols[0]); i++) {
+				registry.view_names[x][argc++] = switch_core_sprintf(pool, "b_%s", cr_col_names[cr_basic_b_cols[i]]);
+			}
+		}
+
+		registry.view_names[x][argc++] = "call_created_epoch";
+	}
+
+	registry.running = 1;
+}
+
+void switch_core_channel_registry_start(switch_memory_pool_t *pool)
+{
+	size_t i;
+
+	cr_init(pool, cr_channel_live);
+
+	/* sharded so CREATE, STATE and DESTROY of one channel reach us in order even with several dispatch threads */
+	for (i = 0; i < sizeof(cr_events) / sizeof(cr_events[0]); i++) {
+		switch_event_bind_sharded("core_channel_registry", cr_events[i], SWITCH_EVENT_SUBCLASS_ANY, channel_registry_event_handler, NULL, NULL);
+	}
+
+	registry.bound = 1;
+}
+
+SWITCH_DECLARE(void) switch_channel_registry_test_start(switch_memory_pool_t *pool, switch_channel_registry_live_func_t live)
+{
+	cr_init(pool, live ? live : cr_channel_live);
+}
+
+SWITCH_DECLARE(void) switch_channel_registry_test_event(switch_event_t *event)
+{
+	if (registry.rwlock) {
+		channel_registry_event_handler(event);
+	}
+}
+
+void switch_core_channel_registry_stop(void)
+{
+	size_t i;
+
+	if (!registry.running) {
+		return;
+	}
+
+	if (registry.bound) {
+		switch_event_unbind_callback(channel_registry_event_handler);
+		registry.bound = 0;
+	}
+
+	switch_thread_rwlock_wrlock(registry.rwlock);
+	registry.running = 0;
+
+	while (registry.head) {
+		cr_row_destroy(registry.head);
+	}
+
+	switch_core_hash_destroy(&registry.by_uuid);
+
+	for (i = 0; i < CR_INDEXES; i++) {
+		switch_core_hash_destroy(&registry.index[i]);
+	}
+
+	switch_thread_rwlock_unlock(registry.rwlock);
+}
+
+SWITCH_DECLARE(void) switch_channel_registry_test_stop(void)
+{
+	switch_core_channel_registry_stop();
+}
+
+/* For Emacs:
+ * Local Variables:
+ * mode:c
+ * indent-tabs-mode:t
+ * tab-width:4
+ * c-basic-offset:4
+ * End:
+ * For VIM:
+ * vim:set softtabstop=4 shiftwidth=4 tabstop=4 noet:
+ */
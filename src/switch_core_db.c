@@ -133,6 +133,16 @@ SWITCH_DECLARE(int) switch_core_db_reset(switch_core_db_stmt_t *pStmt)
 	return sqlite3_reset(pStmt);
 }
 
+SWITCH_DECLARE(int) switch_core_db_clear_bindings(switch_core_db_stmt_t *pStmt)
+{
+	return sqlite3_clear_bindings(pStmt);
+}
+
+SWITCH_DECLARE(int) switch_core_db_bind_parameter_count(switch_core_db_stmt_t *pStmt)
+{
+	return sqlite3_bind_parameter_count(pStmt);
+}
+
 SWITCH_DECLARE(int) switch_core_db_bind_int(switch_core_db_stmt_t *pStmt, int i, int iValue)
 {
 	return sqlite3_bind_int(pStmt, i, iValue);
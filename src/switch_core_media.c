@@ -15518,6 +15518,28 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_write_frame(switch_core_sess
 		switch_set_flag(session, SSF_WARN_TRANSCODE);
 	}
 
+	/* PCMU and PCMA at the same ptime map onto each other byte for byte, skip the trip through linear */
+	if (frame->codec && !session->bugs && !do_resample && !ptime_mismatch && !session->write_resampler && !switch_test_flag(frame, SFF_CNG) &&
+		frame->datalen == session->write_impl.encoded_bytes_per_packet && frame->datalen <= session->enc_write_frame.buflen &&
+		switch_core_codec_g711_transcode(frame->codec->implementation, &session->write_impl,
+										 frame->data, session->enc_write_frame.data, frame->datalen) == SWITCH_STATUS_SUCCESS) {
+		session->enc_write_frame.datalen = frame->datalen;
+		session->enc_write_frame.codec = session->write_codec;
+		session->enc_write_frame.samples = frame->datalen;
+		session->enc_write_frame.channels = 1;
+		session->enc_write_frame.rate = session->write_impl.actual_samples_per_second;
+		session->enc_write_frame.timestamp = frame->timestamp;
+		session->enc_write_frame.payload = session->write_impl.ianacode;
+		session->enc_write_frame.m = frame->m;
+		session->enc_write_frame.ssrc = frame->ssrc;
+		session->enc_write_frame.seq = frame->seq;
+		session->enc_write_frame.flags = 0;
+
+		write_frame = &session->enc_write_frame;
+		do_write = TRUE;
+		goto done;
+	}
+
 	if (frame->codec) {
 		session->raw_write_frame.datalen = session->raw_write_frame.buflen;
 		frame->codec->cur_frame = frame;
@@ -1039,7 +1039,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_queue_message(switch_core_se
 	switch_assert(session != NULL);
 
 	if (session->message_queue) {
-		if (switch_queue_trypush(session->message_queue, message) == SWITCH_STATUS_SUCCESS) {
+		if (switch_mpsc_queue_trypush(session->message_queue, message) == SWITCH_STATUS_SUCCESS) {
 			status = SWITCH_STATUS_SUCCESS;
 		}
 
@@ -1082,7 +1082,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_dequeue_message(switch_core_
 	switch_assert(session != NULL);
 
 	if (session->message_queue) {
-		if ((status = (switch_status_t) switch_queue_trypop(session->message_queue, &pop)) == SWITCH_STATUS_SUCCESS) {
+		if ((status = (switch_status_t) switch_mpsc_queue_trypop(session->message_queue, &pop)) == SWITCH_STATUS_SUCCESS) {
 			*message = (switch_core_session_message_t *) pop;
 			if ((*message)->delivery_time && (*message)->delivery_time > switch_epoch_time_now(NULL)) {
 				switch_core_session_queue_message(session, *message);
@@ -1105,7 +1105,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_flush_message(switch_core_se
 
 
 	if (session->message_queue) {
-		while ((status = (switch_status_t) switch_queue_trypop(session->message_queue, &pop)) == SWITCH_STATUS_SUCCESS) {
+		while ((status = (switch_status_t) switch_mpsc_queue_trypop(session->message_queue, &pop)) == SWITCH_STATUS_SUCCESS) {
 			message = (switch_core_session_message_t *) pop;
 			switch_ivr_process_indications(session, message);
 			switch_core_session_free_message(&message);
@@ -1122,7 +1122,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_queue_signal_data(switch_cor
 	switch_assert(session != NULL);
 
 	if (session->signal_data_queue) {
-		if (switch_queue_push(session->signal_data_queue, signal_data) == SWITCH_STATUS_SUCCESS) {
+		if (switch_mpsc_queue_push(session->signal_data_queue, signal_data) == SWITCH_STATUS_SUCCESS) {
 			status = SWITCH_STATUS_SUCCESS;
 		}
 
@@ -1143,7 +1143,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_dequeue_signal_data(switch_c
 	switch_assert(session != NULL);
 
 	if (session->signal_data_queue) {
-		if ((status = (switch_status_t) switch_queue_trypop(session->signal_data_queue, &pop)) == SWITCH_STATUS_SUCCESS) {
+		if ((status = (switch_status_t) switch_mpsc_queue_trypop(session->signal_data_queue, &pop)) == SWITCH_STATUS_SUCCESS) {
 			*signal_data = pop;
 		}
 	}
@@ -1196,7 +1196,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_queue_event(switch_core_sess
 	switch_assert(session != NULL);
 
 	if (session->event_queue) {
-		if (switch_queue_trypush(session->event_queue, *event) == SWITCH_STATUS_SUCCESS) {
+		if (switch_mpsc_queue_trypush(session->event_queue, *event) == SWITCH_STATUS_SUCCESS) {
 			*event = NULL;
 			status = SWITCH_STATUS_SUCCESS;
 
@@ -1212,11 +1212,11 @@ SWITCH_DECLARE(uint32_t) switch_core_session_messages_waiting(switch_core_sessio
 	int x = 0;
 
 	if (session->private_event_queue) {
-		x += switch_queue_size(session->private_event_queue);
+		x += switch_mpsc_queue_size(session->private_event_queue);
 	}
 
 	if (session->message_queue) {
-		x += switch_queue_size(session->message_queue);
+		x += switch_mpsc_queue_size(session->message_queue);
 	}
 
 	return x;
@@ -1225,7 +1225,7 @@ SWITCH_DECLARE(uint32_t) switch_core_session_messages_waiting(switch_core_sessio
 SWITCH_DECLARE(uint32_t) switch_core_session_event_count(switch_core_session_t *session)
 {
 	if (session->event_queue) {
-		return switch_queue_size(session->event_queue);
+		return switch_mpsc_queue_size(session->event_queue);
 	}
 
 	return 0;
@@ -1239,7 +1239,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_dequeue_event(switch_core_se
 	switch_assert(session != NULL);
 
 	if (session->event_queue && (force || !switch_channel_test_flag(session->channel, CF_DIVERT_EVENTS))) {
-		if ((status = (switch_status_t) switch_queue_trypop(session->event_queue, &pop)) == SWITCH_STATUS_SUCCESS) {
+		if ((status = (switch_status_t) switch_mpsc_queue_trypop(session->event_queue, &pop)) == SWITCH_STATUS_SUCCESS) {
 			*event = (switch_event_t *) pop;
 		}
 	}
@@ -1250,7 +1250,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_dequeue_event(switch_core_se
 SWITCH_DECLARE(switch_status_t) switch_core_session_queue_private_event(switch_core_session_t *session, switch_event_t **event, switch_bool_t priority)
 {
 	switch_status_t status = SWITCH_STATUS_FALSE;
-	switch_queue_t *queue;
+	switch_mpsc_queue_t *queue;
 
 	switch_assert(session != NULL);
 	switch_assert(event != NULL);
@@ -1259,7 +1259,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_queue_private_event(switch_c
 		queue = priority ? session->private_event_queue_pri : session->private_event_queue;
 
 		(*event)->event_id = SWITCH_EVENT_PRIVATE_COMMAND;
-		if (switch_queue_trypush(queue, *event) == SWITCH_STATUS_SUCCESS) {
+		if (switch_mpsc_queue_trypush(queue, *event) == SWITCH_STATUS_SUCCESS) {
 			*event = NULL;
 			switch_core_session_kill_channel(session, SWITCH_SIG_BREAK);
 			status = SWITCH_STATUS_SUCCESS;
@@ -1285,11 +1285,11 @@ SWITCH_DECLARE(uint32_t) switch_core_session_private_event_count(switch_core_ses
 	if (session->private_event_queue) {
 
 		if (!switch_channel_test_flag(channel, CF_EVENT_LOCK)) {
-			count = switch_queue_size(session->private_event_queue);
+			count = switch_mpsc_queue_size(session->private_event_queue);
 		}
 
 		if (!switch_channel_test_flag(channel, CF_EVENT_LOCK_PRI)) {
-			count += switch_queue_size(session->private_event_queue_pri);
+			count += switch_mpsc_queue_size(session->private_event_queue_pri);
 		}
 
 		if (count == 0) {
@@ -1305,10 +1305,10 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_dequeue_private_event(switch
 	switch_status_t status = SWITCH_STATUS_FALSE;
 	void *pop;
 	switch_channel_t *channel = switch_core_session_get_channel(session);
-	switch_queue_t *queue;
+	switch_mpsc_queue_t *queue;
 
 	if (session->private_event_queue) {
-		if (switch_queue_size(session->private_event_queue_pri)) {
+		if (switch_mpsc_queue_size(session->private_event_queue_pri)) {
 			queue = session->private_event_queue_pri;
 
 			if (switch_channel_test_flag(channel, CF_EVENT_LOCK_PRI)) {
@@ -1322,7 +1322,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_dequeue_private_event(switch
 			}
 		}
 
-		if ((status = (switch_status_t) switch_queue_trypop(queue, &pop)) == SWITCH_STATUS_SUCCESS) {
+		if ((status = (switch_status_t) switch_mpsc_queue_trypop(queue, &pop)) == SWITCH_STATUS_SUCCESS) {
 			*event = (switch_event_t *) pop;
 		} else {
 			check_media(session);
@@ -1339,14 +1339,14 @@ SWITCH_DECLARE(uint32_t) switch_core_session_flush_private_events(switch_core_se
 	void *pop;
 
 	if (session->private_event_queue) {
-		while ((status = (switch_status_t) switch_queue_trypop(session->private_event_queue_pri, &pop)) == SWITCH_STATUS_SUCCESS) {
+		while ((status = (switch_status_t) switch_mpsc_queue_trypop(session->private_event_queue_pri, &pop)) == SWITCH_STATUS_SUCCESS) {
 			if (pop) {
 				switch_event_t *event = (switch_event_t *) pop;
 				switch_event_destroy(&event);
 			}
 			x++;
 		}
-		while ((status = (switch_status_t) switch_queue_trypop(session->private_event_queue, &pop)) == SWITCH_STATUS_SUCCESS) {
+		while ((status = (switch_status_t) switch_mpsc_queue_trypop(session->private_event_queue, &pop)) == SWITCH_STATUS_SUCCESS) {
 			if (pop) {
 				switch_event_t *event = (switch_event_t *) pop;
 				switch_event_destroy(&event);
@@ -2412,11 +2412,11 @@ SWITCH_DECLARE(switch_core_session_t *) switch_core_session_request_uuid(switch_
 	switch_thread_cond_create(&session->cond, session->pool);
 	switch_thread_rwlock_create(&session->rwlock, session->pool);
 	switch_thread_rwlock_create(&session->io_rwlock, session->pool);
-	switch_queue_create(&session->message_queue, SWITCH_MESSAGE_QUEUE_LEN, session->pool);
-	switch_queue_create(&session->signal_data_queue, SWITCH_MESSAGE_QUEUE_LEN, session->pool);
-	switch_queue_create(&session->event_queue, SWITCH_EVENT_QUEUE_LEN, session->pool);
-	switch_queue_create(&session->private_event_queue, SWITCH_EVENT_QUEUE_LEN, session->pool);
-	switch_queue_create(&session->private_event_queue_pri, SWITCH_EVENT_QUEUE_LEN, session->pool);
+	switch_mpsc_queue_create(&session->message_queue, SWITCH_MESSAGE_QUEUE_LEN, session->pool);
+	switch_mpsc_queue_create(&session->signal_data_queue, SWITCH_MESSAGE_QUEUE_LEN, session->pool);
+	switch_mpsc_queue_create(&session->event_queue, SWITCH_EVENT_QUEUE_LEN, session->pool);
+	switch_mpsc_queue_create(&session->private_event_queue, SWITCH_EVENT_QUEUE_LEN, session->pool);
+	switch_mpsc_queue_create(&session->private_event_queue_pri, SWITCH_EVENT_QUEUE_LEN, session->pool);
 
 	switch_mutex_lock(runtime.session_hash_mutex);
 	switch_core_hash_insert(session_manager.session_table, session->uuid_str, session);
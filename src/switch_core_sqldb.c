@@ -54,9 +54,99 @@ struct switch_cache_db_handle {
 	char last_user[CACHE_DB_LEN];
 	uint32_t use_count;
 	uint64_t total_used_count;
+	switch_hash_t *stmt_hash;
+	struct switch_cache_db_stmt *stmt_head;
+	struct switch_cache_db_stmt *stmt_tail;
+	uint32_t stmt_count;
+	uint64_t stmt_hits;
+	uint64_t stmt_misses;
+	uint64_t stmt_expanded;
 	struct switch_cache_db_handle *next;
 };
 
+/* compiled statements kept per native handle, most recently used first */
+#define SQL_STMT_CACHE_SIZE 256
+
+struct switch_cache_db_stmt {
+	char *sql;
+	switch_core_db_stmt_t *stmt;
+	struct switch_cache_db_stmt *prev;
+	struct switch_cache_db_stmt *next;
+};
+
+/* first byte of a queued job carrying sql plus its parameters, see switch_sql_bind_params() */
+#define SQL_PARAMS_MARK '\001'
+/* first byte of a queued row update that later updates to the same row are merged into, see switch_sql_queue_manager_push_update() */
+#define SQL_UPDATE_MARK '\002'
+
+/* a pending row update, it stays mergeable until the sql thread pops it */
+struct sql_update {
+	char mark;
+	uint32_t pos;
+	char *hash_key;
+	char *table;
+	char *key_col;
+	char *key;
+	int ncols;
+	int alloced;
+	char **cols;
+	char **values;
+};
+
+static void sql_update_free(struct sql_update *up)
+{
+	int i;
+
+	for (i = 0; i < up->ncols; i++) {
+		free(up->cols[i]);
+		switch_safe_free(up->values[i]);
+	}
+
+	switch_safe_free(up->cols);
+	switch_safe_free(up->values);
+	free(up->hash_key);
+	free(up->table);
+	free(up->key_col);
+	free(up->key);
+	free(up);
+}
+
+/* last write wins per column, columns are kept sorted so merged updates share few statement shapes */
+static void sql_update_set(struct sql_update *up, const char *col, const char *value)
+{
+	int i, cmp = 1;
+
+	for (i = 0; i < up->ncols && (cmp = strcmp(up->cols[i], col)) < 0; i++);
+
+	if (i < up->ncols && !cmp) {
+		switch_safe_free(up->values[i]);
+		up->values[i] = value ? strdup(value) : NULL;
+		return;
+	}
+
+	if (up->ncols == up->alloced) {
+		up->alloced = up->alloced ? up->alloced * 2 : 8;
+		up->cols = realloc(up->cols, sizeof(char *) * up->alloced);
+		up->values = realloc(up->values, sizeof(char *) * up->alloced);
+		switch_assert(up->cols && up->values);
+	}
+
+	memmove(up->cols + i + 1, up->cols + i, sizeof(char *) * (up->ncols - i));
+	memmove(up->values + i + 1, up->values + i, sizeof(char *) * (up->ncols - i));
+	up->cols[i] = strdup(col);
+	up->values[i] = value ? strdup(value) : NULL;
+	up->ncols++;
+}
+
+static void sql_job_free(void *job)
+{
+	if (job && *(char *) job == SQL_UPDATE_MARK) {
+		sql_update_free((struct sql_update *) job);
+	} else {
+		switch_safe_free(job);
+	}
+}
+
 static struct {
 	switch_memory_pool_t *memory_pool;
 	switch_thread_t *db_thread;
@@ -70,6 +160,7 @@ static struct {
 	uint32_t total_used_handles;
 	switch_cache_db_handle_t *dbh;
 	switch_sql_queue_manager_t *qm;
+	switch_sql_queue_manager_t *qm_list;
 	int paused;
 } sql_manager;
 
@@ -209,6 +300,89 @@ SWITCH_DECLARE(switch_status_t) _switch_core_db_handle(switch_cache_db_handle_t
 #define SQL_REG_TIMEOUT 15
 
 
+static void stmt_unlink(switch_cache_db_handle_t *dbh, struct switch_cache_db_stmt *cs)
+{
+	if (cs->prev) {
+		cs->prev->next = cs->next;
+	} else {
+		dbh->stmt_head = cs->next;
+	}
+
+	if (cs->next) {
+		cs->next->prev = cs->prev;
+	} else {
+		dbh->stmt_tail = cs->prev;
+	}
+
+	cs->prev = cs->next = NULL;
+}
+
+static void stmt_drop(switch_cache_db_handle_t *dbh, struct switch_cache_db_stmt *cs)
+{
+	stmt_unlink(dbh, cs);
+	switch_core_hash_delete(dbh->stmt_hash, cs->sql);
+	switch_core_db_finalize(cs->stmt);
+	dbh->stmt_count--;
+	free(cs->sql);
+	free(cs);
+}
+
+static void stmt_cache_flush(switch_cache_db_handle_t *dbh)
+{
+	while (dbh->stmt_head) {
+		stmt_drop(dbh, dbh->stmt_head);
+	}
+
+	if (dbh->stmt_hash) {
+		switch_core_hash_destroy(&dbh->stmt_hash);
+	}
+}
+
+/* hand out a reset statement for sql, compiling it on the first use */
+static struct switch_cache_db_stmt *stmt_cache_get(switch_cache_db_handle_t *dbh, const char *sql)
+{
+	struct switch_cache_db_stmt *cs = NULL;
+	switch_core_db_stmt_t *stmt = NULL;
+
+	if (!dbh->stmt_hash) {
+		switch_core_hash_init(&dbh->stmt_hash);
+	}
+
+	if ((cs = switch_core_hash_find(dbh->stmt_hash, sql))) {
+		dbh->stmt_hits++;
+		stmt_unlink(dbh, cs);
+	} else {
+		dbh->stmt_misses++;
+
+		if (switch_core_db_prepare(dbh->native_handle.core_db_dbh, sql, -1, &stmt, NULL) != SWITCH_CORE_DB_OK || !stmt) {
+			if (stmt) {
+				switch_core_db_finalize(stmt);
+			}
+			return NULL;
+		}
+
+		switch_zmalloc(cs, sizeof(*cs));
+		cs->sql = strdup(sql);
+		cs->stmt = stmt;
+		switch_core_hash_insert(dbh->stmt_hash, cs->sql, cs);
+
+		if (++dbh->stmt_count > SQL_STMT_CACHE_SIZE) {
+			stmt_drop(dbh, dbh->stmt_tail);
+		}
+	}
+
+	cs->next = dbh->stmt_head;
+	if (dbh->stmt_head) {
+		dbh->stmt_head->prev = cs;
+	}
+	dbh->stmt_head = cs;
+	if (!dbh->stmt_tail) {
+		dbh->stmt_tail = cs;
+	}
+
+	return cs;
+}
+
 static void sql_close(time_t prune)
 {
 	switch_cache_db_handle_t *dbh = NULL;
@@ -246,6 +420,7 @@ static void sql_close(time_t prune)
 				break;
 			case SCDB_TYPE_CORE_DB:
 				{
+					stmt_cache_flush(dbh);
 					switch_core_db_close(dbh->native_handle.core_db_dbh);
 					dbh->native_handle.core_db_dbh = NULL;
 				}
@@ -798,6 +973,318 @@ SWITCH_DECLARE(char *) switch_cache_db_execute_sql2str(switch_cache_db_handle_t
 
 }
 
+/* replace each ? outside a quoted literal with its parameter as an escaped literal, for back ends without a statement cache */
+static char *sql_expand_params(const char *sql, int nparams, const char **params)
+{
+	switch_stream_handle_t stream = { 0 };
+	const char *p;
+	int quoted = 0, i = 0;
+
+	SWITCH_STANDARD_STREAM(stream);
+
+	for (p = sql; *p; p++) {
+		if (*p == '\'') {
+			quoted = !quoted;
+		}
+
+		if (*p != '?' || quoted) {
+			stream.raw_write_function(&stream, (uint8_t *) p, 1);
+		} else if (i < nparams && params[i]) {
+			char *esc = switch_mprintf("'%q'", params[i++]);
+			stream.write_function(&stream, "%s", esc);
+			switch_safe_free(esc);
+		} else {
+			stream.write_function(&stream, "NULL");
+			i++;
+		}
+	}
+
+	if (!stream.data) {
+		return strdup("");
+	}
+
+	return (char *) stream.data;
+}
+
+/* run a cached statement; rows go to callback, or the first column of the first row to str */
+static switch_status_t stmt_execute(switch_cache_db_handle_t *dbh, const char *sql, int nparams, const char **params,
+									switch_core_db_callback_func_t callback, void *pdata, char *str, size_t len, char **err)
+{
+	struct switch_cache_db_stmt *cs;
+	switch_status_t status = SWITCH_STATUS_FALSE;
+	int result = SWITCH_CORE_DB_ERROR, i, retried = 0, busy = 0, got = 0;
+
+ again:
+
+	if (!(cs = stmt_cache_get(dbh, sql))) {
+		const char *errmsg = switch_core_db_errmsg(dbh->native_handle.core_db_dbh);
+
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Statement Error [%s] %s\n", sql, errmsg);
+		if (err) {
+			*err = strdup(errmsg ? errmsg : "prepare failed");
+		}
+		return SWITCH_STATUS_FALSE;
+	}
+
+	/* a short parameter list would run the statement with whatever the last caller bound, a long one binds nothing */
+	if (nparams != switch_core_db_bind_parameter_count(cs->stmt)) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Statement Error [%s] takes %d parameters, %d given\n",
+						  sql, switch_core_db_bind_parameter_count(cs->stmt), nparams);
+		if (err) {
+			*err = strdup("parameter count mismatch");
+		}
+		return SWITCH_STATUS_FALSE;
+	}
+
+	for (i = 0; i < nparams; i++) {
+		switch_core_db_bind_text(cs->stmt, i + 1, params[i], -1, SWITCH_CORE_DB_TRANSIENT);
+	}
+
+	for (;;) {
+		result = switch_core_db_step(cs->stmt);
+
+		if (result == SWITCH_CORE_DB_ROW) {
+			int colcount = switch_core_db_column_count(cs->stmt);
+
+			if (str) {
+				const unsigned char *txt = colcount > 0 ? switch_core_db_column_text(cs->stmt, 0) : NULL;
+
+				if (txt) {
+					switch_copy_string(str, (char *) txt, len);
+					got = 1;
+				}
+				result = SWITCH_CORE_DB_DONE;
+				break;
+			}
+
+			if (callback && colcount > 0) {
+				char **argv, **names;
+
+				switch_zmalloc(argv, sizeof(char *) * colcount * 2);
+				names = argv + colcount;
+
+				for (i = 0; i < colcount; i++) {
+					argv[i] = (char *) switch_core_db_column_text(cs->stmt, i);
+					names[i] = (char *) switch_core_db_column_name(cs->stmt, i);
+				}
+
+				i = callback(pdata, colcount, argv, names);
+				free(argv);
+
+				if (i) {
+					result = SWITCH_CORE_DB_DONE;
+					break;
+				}
+			}
+		} else if (result == SWITCH_CORE_DB_BUSY && ++busy < 5000) {
+			switch_cond_next();
+		} else {
+			break;
+		}
+	}
+
+	if (result == SWITCH_CORE_DB_DONE) {
+		status = (str && !got) ? SWITCH_STATUS_FALSE : SWITCH_STATUS_SUCCESS;
+		switch_core_db_reset(cs->stmt);
+		switch_core_db_clear_bindings(cs->stmt);
+	} else {
+		const char *errmsg;
+
+		/* a legacy prepared statement reports the real error from reset, schema changes need a fresh compile */
+		result = switch_core_db_reset(cs->stmt);
+		stmt_drop(dbh, cs);
+
+		if (result == SWITCH_CORE_DB_SCHEMA && !retried++) {
+			goto again;
+		}
+
+		errmsg = switch_core_db_errmsg(dbh->native_handle.core_db_dbh);
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "NATIVE SQL ERR [%s]\n%s\n", errmsg, sql);
+		if (err) {
+			*err = strdup(errmsg ? errmsg : "step failed");
+		}
+	}
+
+	return status;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_cache_db_execute_sql_params(switch_cache_db_handle_t *dbh, const char *sql, int nparams, const char **params, char **err)
+{
+	switch_status_t status = SWITCH_STATUS_FALSE;
+	switch_mutex_t *io_mutex = dbh->io_mutex;
+
+	if (err) {
+		*err = NULL;
+	}
+
+	if (dbh->type == SCDB_TYPE_CORE_DB) {
+		if (io_mutex) switch_mutex_lock(io_mutex);
+		status = stmt_execute(dbh, sql, nparams, params, NULL, NULL, NULL, 0, err);
+		if (io_mutex) switch_mutex_unlock(io_mutex);
+	} else {
+		char *expanded = sql_expand_params(sql, nparams, params);
+
+		dbh->stmt_expanded++;
+		status = switch_cache_db_execute_sql(dbh, expanded, err);
+		free(expanded);
+	}
+
+	return status;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_cache_db_execute_sql_callback_params(switch_cache_db_handle_t *dbh, const char *sql, int nparams, const char **params,
+																			switch_core_db_callback_func_t callback, void *pdata, char **err)
+{
+	switch_status_t status = SWITCH_STATUS_FALSE;
+	switch_mutex_t *io_mutex = dbh->io_mutex;
+
+	if (err) {
+		*err = NULL;
+	}
+
+	if (dbh->type == SCDB_TYPE_CORE_DB) {
+		if (io_mutex) switch_mutex_lock(io_mutex);
+		status = stmt_execute(dbh, sql, nparams, params, callback, pdata, NULL, 0, err);
+		if (io_mutex) switch_mutex_unlock(io_mutex);
+	} else {
+		char *expanded = sql_expand_params(sql, nparams, params);
+
+		dbh->stmt_expanded++;
+		status = switch_cache_db_execute_sql_callback(dbh, expanded, callback, pdata, err);
+		free(expanded);
+	}
+
+	return status;
+}
+
+SWITCH_DECLARE(char *) switch_cache_db_execute_sql2str_params(switch_cache_db_handle_t *dbh, const char *sql, int nparams, const char **params,
+															  char *str, size_t len, char **err)
+{
+	switch_status_t status = SWITCH_STATUS_FALSE;
+	switch_mutex_t *io_mutex = dbh->io_mutex;
+	char *ret = NULL;
+
+	if (err) {
+		*err = NULL;
+	}
+
+	if (dbh->type == SCDB_TYPE_CORE_DB) {
+		memset(str, 0, len);
+		if (io_mutex) switch_mutex_lock(io_mutex);
+		status = stmt_execute(dbh, sql, nparams, params, NULL, NULL, str, len, err);
+		if (io_mutex) switch_mutex_unlock(io_mutex);
+		ret = status == SWITCH_STATUS_SUCCESS ? str : NULL;
+	} else {
+		char *expanded = sql_expand_params(sql, nparams, params);
+
+		dbh->stmt_expanded++;
+		ret = switch_cache_db_execute_sql2str(dbh, expanded, str, len, err);
+		free(expanded);
+	}
+
+	return ret;
+}
+
+SWITCH_DECLARE(char *) switch_sql_bind_params(const char *sql, int nparams, const char **params)
+{
+	switch_size_t slen = strlen(sql), need = slen + 3;
+	char *job, *p;
+	int i;
+
+	switch_assert(nparams >= 0 && nparams < 256);
+
+	for (i = 0; i < nparams; i++) {
+		need += (params[i] ? strlen(params[i]) : 0) + 2;
+	}
+
+	switch_malloc(job, need);
+	p = job;
+	*p++ = SQL_PARAMS_MARK;
+	*p++ = (char) nparams;
+	memcpy(p, sql, slen + 1);
+	p += slen + 1;
+
+	for (i = 0; i < nparams; i++) {
+		*p++ = params[i] ? 't' : 'n';
+		if (params[i]) {
+			size_t plen = strlen(params[i]);
+			memcpy(p, params[i], plen);
+			p += plen;
+		}
+		*p++ = '\0';
+	}
+
+	return job;
+}
+
+static char *sql_job_dup(const char *job)
+{
+	const char *p;
+	char *dup;
+	int i, nparams;
+
+	if (*job != SQL_PARAMS_MARK) {
+		return strdup(job);
+	}
+
+	nparams = (unsigned char) job[1];
+	p = job + 2;
+	p += strlen(p) + 1;
+
+	for (i = 0; i < nparams; i++) {
+		p += strlen(p + 1) + 2;
+	}
+
+	switch_malloc(dup, p - job);
+	memcpy(dup, job, p - job);
+
+	return dup;
+}
+
+/* execute a queued job, either plain sql or the output of switch_sql_bind_params() */
+static switch_status_t sql_execute_job(switch_cache_db_handle_t *dbh, char *job, char **err)
+{
+	const char *params[256];
+	const char *sql;
+	char *p;
+	int nparams, i;
+
+	if (*job == SQL_UPDATE_MARK) {
+		struct sql_update *up = (struct sql_update *) job;
+		switch_stream_handle_t stream = { 0 };
+		switch_status_t status;
+
+		SWITCH_STANDARD_STREAM(stream);
+		stream.write_function(&stream, "update %s set ", up->table);
+		for (i = 0; i < up->ncols; i++) {
+			stream.write_function(&stream, "%s%s=?", i ? "," : "", up->cols[i]);
+			params[i] = up->values[i];
+		}
+		stream.write_function(&stream, " where %s=?", up->key_col);
+		params[i] = up->key;
+
+		status = switch_cache_db_execute_sql_params(dbh, (char *) stream.data, up->ncols + 1, params, err);
+		free(stream.data);
+
+		return status;
+	}
+
+	if (*job != SQL_PARAMS_MARK) {
+		return switch_cache_db_execute_sql(dbh, job, err);
+	}
+
+	nparams = (unsigned char) job[1];
+	sql = job + 2;
+	p = (char *) sql + strlen(sql) + 1;
+
+	for (i = 0; i < nparams; i++) {
+		params[i] = *p == 't' ? p + 1 : NULL;
+		p += strlen(p + 1) + 2;
+	}
+
+	return switch_cache_db_execute_sql_params(dbh, sql, nparams, params, err);
+}
+
 SWITCH_DECLARE(switch_status_t) switch_cache_db_persistant_execute(switch_cache_db_handle_t *dbh, const char *sql, uint32_t retries)
 {
 	char *errmsg = NULL;
@@ -1424,8 +1911,27 @@ struct switch_sql_queue_manager {
 	uint32_t max_trans;
 	uint32_t confirm;
 	uint8_t paused;
+	switch_hash_t *pending;
+	uint64_t pushed;
+	uint64_t updates;
+	uint64_t merged;
+	uint64_t trans;
+	uint64_t flushed;
+	uint64_t flush_us_total;
+	uint64_t flush_us_max;
+	struct switch_sql_queue_manager *next;
 };
 
+/* a popped update can no longer take merges, caller holds qm->mutex */
+static void qm_unpend(switch_sql_queue_manager_t *qm, void *pop)
+{
+	struct sql_update *up = (struct sql_update *) pop;
+
+	if (pop && *(char *) pop == SQL_UPDATE_MARK && switch_core_hash_find(qm->pending, up->hash_key) == up) {
+		switch_core_hash_delete(qm->pending, up->hash_key);
+	}
+}
+
 static int qm_wake(switch_sql_queue_manager_t *qm)
 {
 	switch_status_t status;
@@ -1602,10 +2108,11 @@ static void do_flush(switch_sql_queue_manager_t *qm, int i, switch_cache_db_hand
 	switch_mutex_lock(qm->mutex);
 	while (switch_queue_trypop(q, &pop) == SWITCH_STATUS_SUCCESS) {
 		if (pop) {
+			qm_unpend(qm, pop);
 			if (dbh) {
-				switch_cache_db_execute_sql(dbh, (char *) pop, NULL);
+				sql_execute_job(dbh, (char *) pop, NULL);
 			}
-			switch_safe_free(pop);
+			sql_job_free(pop);
 		}
 	}
 	switch_mutex_unlock(qm->mutex);
@@ -1703,7 +2210,7 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_start(switch_sql_queue_
 
 SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_destroy(switch_sql_queue_manager_t **qmp)
 {
-	switch_sql_queue_manager_t *qm;
+	switch_sql_queue_manager_t *qm, **lp;
 	switch_status_t status = SWITCH_STATUS_SUCCESS;
 	switch_memory_pool_t *pool;
 	uint32_t i;
@@ -1727,6 +2234,17 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_destroy(switch_sql_queu
 		do_flush(qm, i, NULL);
 	}
 
+	switch_mutex_lock(sql_manager.dbh_mutex);
+	for (lp = &sql_manager.qm_list; *lp; lp = &(*lp)->next) {
+		if (*lp == qm) {
+			*lp = qm->next;
+			break;
+		}
+	}
+	switch_mutex_unlock(sql_manager.dbh_mutex);
+
+	switch_core_hash_destroy(&qm->pending);
+
 	pool = qm->pool;
 	switch_core_destroy_memory_pool(&pool);
 
@@ -1755,11 +2273,14 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push(switch_sql_queue_m
 		pos = 0;
 	}
 
-	sqlptr = dup ? strdup(sql) : (char *)sql;
+	sqlptr = dup ? sql_job_dup(sql) : (char *)sql;
 
 	do {
 		switch_mutex_lock(qm->mutex);
 		status = switch_queue_trypush(qm->sql_queue[pos], sqlptr);
+		if (status == SWITCH_STATUS_SUCCESS) {
+			qm->pushed++;
+		}
 		switch_mutex_unlock(qm->mutex);
 		if (status != SWITCH_STATUS_SUCCESS) {
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG1, "Delay %d sending sql\n", x);
@@ -1789,7 +2310,7 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push_confirm(switch_sql
 	}
 
 	if (switch_cache_db_get_db_handle_dsn(&dbh, qm->dsn) == SWITCH_STATUS_SUCCESS) {
-		switch_cache_db_execute_sql(dbh, (char *)sql, NULL);
+		sql_execute_job(dbh, (char *)sql, NULL);
 		switch_cache_db_release_db_handle(&dbh);
 	}
 
@@ -1817,7 +2338,7 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push_confirm(switch_sql
 
 	switch_mutex_lock(qm->mutex);
 	qm->confirm++;
-	switch_queue_push(qm->sql_queue[pos], dup ? strdup(sql) : (char *)sql);
+	switch_queue_push(qm->sql_queue[pos], dup ? sql_job_dup(sql) : (char *)sql);
 	written = qm->pre_written[pos];
 	size = switch_sql_queue_manager_size(qm, pos);
 	want = written + size;
@@ -1845,9 +2366,120 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push_confirm(switch_sql
 	return SWITCH_STATUS_SUCCESS;
 }
 
+static switch_bool_t qm_pending_in_table(const void *key, const void *val, void *pData)
+{
+	const struct sql_update *up = (const struct sql_update *) val;
 
+	return !strcmp(up->table, (const char *) pData) ? SWITCH_TRUE : SWITCH_FALSE;
+}
 
+SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push_keyed(switch_sql_queue_manager_t *qm, const char *sql, const char *table, const char *key,
+																   uint32_t pos, switch_bool_t dup)
+{
+	char hash_key[512];
 
+	if (table && key) {
+		switch_snprintf(hash_key, sizeof(hash_key), "%s\t%s", table, key);
+		switch_mutex_lock(qm->mutex);
+		switch_core_hash_delete(qm->pending, hash_key);
+		switch_mutex_unlock(qm->mutex);
+	} else if (table) {
+		switch_mutex_lock(qm->mutex);
+		switch_core_hash_delete_multi(qm->pending, qm_pending_in_table, (void *) table);
+		switch_mutex_unlock(qm->mutex);
+	}
+
+	return switch_sql_queue_manager_push(qm, sql, pos, dup);
+}
+
+SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push_update(switch_sql_queue_manager_t *qm, uint32_t pos, const char *table, const char *key_col,
+																	 const char *key, int ncols, const char **cols, const char **values)
+{
+	struct sql_update *up;
+	char hash_key[512];
+	switch_status_t status;
+	int i, x = 0;
+
+	switch_assert(ncols > 0 && ncols < 255);
+
+	if (sql_manager.paused || qm->thread_running != 1) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG1, "DROP update of %s %s\n", table, key);
+		qm_wake(qm);
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	if (pos > qm->numq - 1) {
+		pos = 0;
+	}
+
+	switch_snprintf(hash_key, sizeof(hash_key), "%s\t%s", table, key);
+
+	switch_mutex_lock(qm->mutex);
+	qm->updates++;
+	if ((up = switch_core_hash_find(qm->pending, hash_key)) && up->pos == pos && up->ncols + ncols < 255) {
+		for (i = 0; i < ncols; i++) {
+			sql_update_set(up, cols[i], values[i]);
+		}
+		qm->merged++;
+		switch_mutex_unlock(qm->mutex);
+		return SWITCH_STATUS_SUCCESS;
+	}
+	switch_mutex_unlock(qm->mutex);
+
+	switch_zmalloc(up, sizeof(*up));
+	up->mark = SQL_UPDATE_MARK;
+	up->pos = pos;
+	up->hash_key = strdup(hash_key);
+	up->table = strdup(table);
+	up->key_col = strdup(key_col);
+	up->key = strdup(key);
+
+	for (i = 0; i < ncols; i++) {
+		sql_update_set(up, cols[i], values[i]);
+	}
+
+	do {
+		switch_mutex_lock(qm->mutex);
+		status = switch_queue_trypush(qm->sql_queue[pos], up);
+		if (status == SWITCH_STATUS_SUCCESS) {
+			qm->pushed++;
+			switch_core_hash_insert(qm->pending, up->hash_key, up);
+		}
+		switch_mutex_unlock(qm->mutex);
+		if (status != SWITCH_STATUS_SUCCESS) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG1, "Delay %d sending sql\n", x);
+			if (x++) {
+				switch_yield(1000000 * x);
+			}
+		}
+	} while(status != SWITCH_STATUS_SUCCESS);
+
+	qm_wake(qm);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(void) switch_sql_queue_manager_status(switch_sql_queue_manager_t *qm, switch_stream_handle_t *stream)
+{
+	uint32_t i, depth = 0;
+
+	switch_mutex_lock(qm->mutex);
+
+	for (i = 0; i < qm->numq; i++) {
+		depth += switch_queue_size(qm->sql_queue[i]);
+	}
+
+	stream->write_function(stream, "%s\n\tQueue depth: %u\n\tPushed: %" SWITCH_UINT64_T_FMT "\n"
+						   "\tRow updates: %" SWITCH_UINT64_T_FMT ", %" SWITCH_UINT64_T_FMT " merged (%.1f%% compacted)\n"
+						   "\tTransactions: %" SWITCH_UINT64_T_FMT ", %" SWITCH_UINT64_T_FMT " statements\n"
+						   "\tFlush latency: %" SWITCH_UINT64_T_FMT "us avg, %" SWITCH_UINT64_T_FMT "us max\n",
+						   qm->name, depth, qm->pushed,
+						   qm->updates, qm->merged, qm->updates ? (double) qm->merged * 100 / qm->updates : 0.0,
+						   qm->trans, qm->flushed,
+						   qm->trans ? qm->flush_us_total / qm->trans : 0, qm->flush_us_max);
+
+	switch_mutex_unlock(qm->mutex);
+}
 
 SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_init_name(const char *name,
 																   switch_sql_queue_manager_t **qmp,
@@ -1876,6 +2508,7 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_init_name(const char *n
 	switch_mutex_init(&qm->cond2_mutex, SWITCH_MUTEX_NESTED, qm->pool);
 	switch_mutex_init(&qm->mutex, SWITCH_MUTEX_NESTED, qm->pool);
 	switch_thread_cond_create(&qm->cond, qm->pool);
+	switch_core_hash_init(&qm->pending);
 
 	qm->sql_queue = switch_core_alloc(qm->pool, sizeof(switch_queue_t *) * numq);
 	qm->written = switch_core_alloc(qm->pool, sizeof(uint32_t) * numq);
@@ -1898,6 +2531,11 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_init_name(const char *n
 		qm->inner_post_trans_execute = switch_core_strdup(qm->pool, inner_post_trans_execute);
 	}
 
+	switch_mutex_lock(sql_manager.dbh_mutex);
+	qm->next = sql_manager.qm_list;
+	sql_manager.qm_list = qm;
+	switch_mutex_unlock(sql_manager.dbh_mutex);
+
 	*qmp = qm;
 
 	return SWITCH_STATUS_SUCCESS;
@@ -1912,6 +2550,7 @@ static uint32_t do_trans(switch_sql_queue_manager_t *qm)
 	uint32_t ttl = 0;
 	switch_mutex_t *io_mutex = qm->event_db->io_mutex;
 	uint32_t i;
+	switch_time_t started = switch_time_now(), took;
 
 	if (io_mutex) switch_mutex_lock(io_mutex);
 
@@ -1975,18 +2614,19 @@ static uint32_t do_trans(switch_sql_queue_manager_t *qm)
 		for (i = 0; (qm->max_trans == 0 || ttl <= qm->max_trans) && (i < qm->numq); i++) {
 			switch_mutex_lock(qm->mutex);
 			switch_queue_trypop(qm->sql_queue[i], &pop);
+			qm_unpend(qm, pop);
 			switch_mutex_unlock(qm->mutex);
 			if (pop) break;
 		}
 
 		if (pop) {
-			if ((status = switch_cache_db_execute_sql(qm->event_db, (char *) pop, NULL)) == SWITCH_STATUS_SUCCESS) {
+			if ((status = sql_execute_job(qm->event_db, (char *) pop, NULL)) == SWITCH_STATUS_SUCCESS) {
 				switch_mutex_lock(qm->mutex);
 				qm->pre_written[i]++;
 				switch_mutex_unlock(qm->mutex);
 				ttl++;
 			}
-			switch_safe_free(pop);
+			sql_job_free(pop);
 			if (status != SWITCH_STATUS_SUCCESS) break;
 		} else {
 			break;
@@ -2035,10 +2675,18 @@ static uint32_t do_trans(switch_sql_queue_manager_t *qm)
 	}
 
 
+	took = switch_time_now() - started;
+
 	switch_mutex_lock(qm->mutex);
 	for (i = 0; i < qm->numq; i++) {
 		qm->written[i] = qm->pre_written[i];
 	}
+	qm->trans++;
+	qm->flushed += ttl;
+	qm->flush_us_total += took;
+	if ((uint64_t) took > qm->flush_us_max) {
+		qm->flush_us_max = took;
+	}
 	switch_mutex_unlock(qm->mutex);
 
 
@@ -2208,17 +2856,92 @@ static char *parse_presence_data_cols(switch_event_t *event)
 #define MAX_SQL 5
 #define new_sql()   switch_assert(sql_idx+1 < MAX_SQL); if (exists) sql[sql_idx++]
 #define new_sql_a() switch_assert(sql_idx+1 < MAX_SQL); sql[sql_idx++]
+/* a statement on channel rows other than the event's own, every pending channel update goes out ahead of it */
+#define new_sql_rows() switch_assert(sql_idx+1 < MAX_SQL); if (exists) sql_rows[sql_idx] = 1, sql[sql_idx++]
+/* fixed shape statements go out with ? placeholders so the handle can keep them compiled */
+#define new_sql_params(_sql, ...) do { const char *_params[] = { __VA_ARGS__ }; \
+		new_sql() = switch_sql_bind_params(_sql, sizeof(_params) / sizeof(_params[0]), _params); } while (0)
+#define new_sql_params_rows(_sql, ...) do { const char *_params[] = { __VA_ARGS__ }; \
+		new_sql_rows() = switch_sql_bind_params(_sql, sizeof(_params) / sizeof(_params[0]), _params); } while (0)
+/* plain column updates of one channel row, merged in the queue with whatever is still pending for that row.
+   They are held until the event's own statements are queued so they never overtake them */
+#define MAX_CHANNEL_UPDATES 2
+#define CHANNEL_UPDATE_MAX_COLS 32
+#define new_channel_update(_uuid, _cols, ...) do { const char *_values[] = { __VA_ARGS__ }; \
+		switch_assert(update_idx < MAX_CHANNEL_UPDATES); \
+		if (exists) channel_update_hold(&updates[update_idx++], _uuid, _cols, sizeof(_values) / sizeof(_values[0]), _values); } while (0)
+
+typedef struct {
+	const char *uuid;
+	const char *col_list;
+	int ncols;
+	const char *values[CHANNEL_UPDATE_MAX_COLS];
+} channel_update_t;
+
+static void channel_update_hold(channel_update_t *update, const char *uuid, const char *col_list, int ncols, const char **values)
+{
+	switch_assert(ncols <= CHANNEL_UPDATE_MAX_COLS);
+
+	update->uuid = uuid;
+	update->col_list = col_list;
+	update->ncols = ncols;
+	memcpy(update->values, values, sizeof(*values) * ncols);
+}
+
+static void channel_update(channel_update_t *update)
+{
+	char buf[512];
+	char *cols[CHANNEL_UPDATE_MAX_COLS];
+
+	switch_copy_string(buf, update->col_list, sizeof(buf));
+
+	if ((int) switch_split(buf, ',', cols) != update->ncols) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "Column count mismatch updating channel %s [%s]\n", update->uuid, update->col_list);
+		return;
+	}
+
+	switch_sql_queue_manager_push_update(sql_manager.qm, 1, "channels", "uuid", update->uuid, update->ncols, (const char **) cols, update->values);
+}
 
 static void core_event_handler(switch_event_t *event)
 {
 	char *sql[MAX_SQL] = { 0 };
+	int sql_rows[MAX_SQL] = { 0 };
 	int sql_idx = 0;
+	channel_update_t updates[MAX_CHANNEL_UPDATES];
+	int update_idx = 0;
+	int i;
 	char *extra_cols;
 	int exists = 1;
 	char *uuid = NULL;
 
 	switch_assert(event);
 
+	/* the channel registry has these, the tables are only kept for installations that read them */
+	if (!runtime.channel_sql_export) {
+		switch (event->event_id) {
+		case SWITCH_EVENT_CHANNEL_DESTROY:
+		case SWITCH_EVENT_CHANNEL_UUID:
+		case SWITCH_EVENT_CHANNEL_CREATE:
+		case SWITCH_EVENT_CHANNEL_ANSWER:
+		case SWITCH_EVENT_CHANNEL_PROGRESS_MEDIA:
+		case SWITCH_EVENT_CODEC:
+		case SWITCH_EVENT_CHANNEL_HOLD:
+		case SWITCH_EVENT_CHANNEL_UNHOLD:
+		case SWITCH_EVENT_CHANNEL_EXECUTE:
+		case SWITCH_EVENT_CHANNEL_ORIGINATE:
+		case SWITCH_EVENT_CALL_UPDATE:
+		case SWITCH_EVENT_CHANNEL_CALLSTATE:
+		case SWITCH_EVENT_CHANNEL_STATE:
+		case SWITCH_EVENT_CHANNEL_BRIDGE:
+		case SWITCH_EVENT_CHANNEL_UNBRIDGE:
+		case SWITCH_EVENT_CALL_SECURE:
+			return;
+		default:
+			break;
+		}
+	}
+
 	switch (event->event_id) {
 	case SWITCH_EVENT_CHANNEL_UUID:
 	case SWITCH_EVENT_CHANNEL_CREATE:
@@ -2290,35 +3013,37 @@ static void core_event_handler(switch_event_t *event)
 			const char *uuid = switch_event_get_header(event, "unique-id");
 
 			if (uuid) {
-				new_sql() = switch_mprintf("delete from channels where uuid='%q'",
-										   uuid);
+				new_sql_params("delete from channels where uuid=?", uuid);
 
-				new_sql() = switch_mprintf("delete from calls where (caller_uuid='%q' or callee_uuid='%q')",
-										   uuid, uuid);
+				new_sql_params("delete from calls where (caller_uuid=? or callee_uuid=?)", uuid, uuid);
 
 			}
 		}
 		break;
 	case SWITCH_EVENT_CHANNEL_UUID:
 		{
-			new_sql() = switch_mprintf("update channels set uuid='%q' where uuid='%q'",
+			new_sql_rows() = switch_mprintf("update channels set uuid='%q' where uuid='%q'",
 									   switch_event_get_header_nil(event, "unique-id"),
 									   switch_event_get_header_nil(event, "old-unique-id")
 									   );
 
-			new_sql() = switch_mprintf("update channels set call_uuid='%q' where call_uuid='%q'",
+			new_sql_rows() = switch_mprintf("update channels set call_uuid='%q' where call_uuid='%q'",
 									   switch_event_get_header_nil(event, "unique-id"),
 									   switch_event_get_header_nil(event, "old-unique-id")
 									   );
 			break;
 		}
 	case SWITCH_EVENT_CHANNEL_CREATE:
-		new_sql() = switch_mprintf("insert into channels (uuid,direction,created,created_epoch, name,state,callstate,dialplan,context,hostname,initial_cid_name,initial_cid_num,initial_ip_addr,initial_dest,initial_dialplan,initial_context) "
-								   "values('%q','%q','%q','%ld','%q','%q','%q','%q','%q','%q','%q','%q','%q','%q','%q','%q')",
+		{
+			char epoch[32];
+
+			switch_snprintf(epoch, sizeof(epoch), "%ld", (long) switch_epoch_time_now(NULL));
+			new_sql_params("insert into channels (uuid,direction,created,created_epoch, name,state,callstate,dialplan,context,hostname,initial_cid_name,initial_cid_num,initial_ip_addr,initial_dest,initial_dialplan,initial_context) "
+								   "values(?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)",
 								   switch_event_get_header_nil(event, "unique-id"),
 								   switch_event_get_header_nil(event, "call-direction"),
 								   switch_event_get_header_nil(event, "event-date-local"),
-								   (long) switch_epoch_time_now(NULL),
+								   epoch,
 								   switch_event_get_header_nil(event, "channel-name"),
 								   switch_event_get_header_nil(event, "channel-state"),
 								   switch_event_get_header_nil(event, "channel-call-state"),
@@ -2331,33 +3056,31 @@ static void core_event_handler(switch_event_t *event)
 								   switch_event_get_header_nil(event, "caller-dialplan"),
 								   switch_event_get_header_nil(event, "caller-context")
 								   );
+		}
 		break;
 	case SWITCH_EVENT_CHANNEL_ANSWER:
 	case SWITCH_EVENT_CHANNEL_PROGRESS_MEDIA:
 	case SWITCH_EVENT_CODEC:
-		new_sql() =
-			switch_mprintf
-			("update channels set read_codec='%q',read_rate='%q',read_bit_rate='%q',write_codec='%q',write_rate='%q',write_bit_rate='%q' where uuid='%q'",
+		new_channel_update
+			(switch_event_get_header_nil(event, "unique-id"), "read_codec,read_rate,read_bit_rate,write_codec,write_rate,write_bit_rate",
 			 switch_event_get_header_nil(event, "channel-read-codec-name"),
 			 switch_event_get_header_nil(event, "channel-read-codec-rate"),
 			 switch_event_get_header_nil(event, "channel-read-codec-bit-rate"),
 			 switch_event_get_header_nil(event, "channel-write-codec-name"),
 			 switch_event_get_header_nil(event, "channel-write-codec-rate"),
-			 switch_event_get_header_nil(event, "channel-write-codec-bit-rate"),
-			 switch_event_get_header_nil(event, "unique-id"));
+			 switch_event_get_header_nil(event, "channel-write-codec-bit-rate"));
 		break;
 	case SWITCH_EVENT_CHANNEL_HOLD:
 	case SWITCH_EVENT_CHANNEL_UNHOLD:
 	case SWITCH_EVENT_CHANNEL_EXECUTE: {
 
-		new_sql() = switch_mprintf("update channels set application='%q',application_data='%q',"
-								   "presence_id='%q',presence_data='%q',accountcode='%q' where uuid='%q'",
+		new_channel_update(switch_event_get_header_nil(event, "unique-id"),
+								   "application,application_data,presence_id,presence_data,accountcode",
 								   switch_event_get_header_nil(event, "application"),
 								   switch_event_get_header_nil(event, "application-data"),
 								   switch_event_get_header_nil(event, "channel-presence-id"),
 								   switch_event_get_header_nil(event, "channel-presence-data"),
-								   switch_event_get_header_nil(event, "variable_accountcode"),
-								   switch_event_get_header_nil(event, "unique-id")
+								   switch_event_get_header_nil(event, "variable_accountcode")
 								   );
 
 	}
@@ -2376,13 +3099,12 @@ static void core_event_handler(switch_event_t *event)
 										   switch_event_get_header_nil(event, "unique-id"));
 				free(extra_cols);
 			} else {
-				new_sql() = switch_mprintf("update channels set "
-										   "presence_id='%q',presence_data='%q',accountcode='%q',call_uuid='%q' where uuid='%q'",
+				new_channel_update(switch_event_get_header_nil(event, "unique-id"),
+										   "presence_id,presence_data,accountcode,call_uuid",
 										   switch_event_get_header_nil(event, "channel-presence-id"),
 										   switch_event_get_header_nil(event, "channel-presence-data"),
 										   switch_event_get_header_nil(event, "variable_accountcode"),
-										   switch_event_get_header_nil(event, "channel-call-uuid"),
-										   switch_event_get_header_nil(event, "unique-id"));
+										   switch_event_get_header_nil(event, "channel-call-uuid"));
 			}
 
 		}
@@ -2390,16 +3112,15 @@ static void core_event_handler(switch_event_t *event)
 		break;
 	case SWITCH_EVENT_CALL_UPDATE:
 		{
-			new_sql() = switch_mprintf("update channels set callee_name='%q',callee_num='%q',sent_callee_name='%q',sent_callee_num='%q',callee_direction='%q',"
-									   "cid_name='%q',cid_num='%q' where uuid='%q'",
+			new_channel_update(switch_event_get_header_nil(event, "unique-id"),
+									   "callee_name,callee_num,sent_callee_name,sent_callee_num,callee_direction,cid_name,cid_num",
 									   switch_event_get_header_nil(event, "caller-callee-id-name"),
 									   switch_event_get_header_nil(event, "caller-callee-id-number"),
 									   switch_event_get_header_nil(event, "sent-callee-id-name"),
 									   switch_event_get_header_nil(event, "sent-callee-id-number"),
 									   switch_event_get_header_nil(event, "direction"),
 									   switch_event_get_header_nil(event, "caller-caller-id-name"),
-									   switch_event_get_header_nil(event, "caller-caller-id-number"),
-									   switch_event_get_header_nil(event, "unique-id")
+									   switch_event_get_header_nil(event, "caller-caller-id-number")
 									   );
 		}
 		break;
@@ -2420,9 +3141,8 @@ static void core_event_handler(switch_event_t *event)
 											   switch_event_get_header_nil(event, "unique-id"));
 					free(extra_cols);
 				} else {
-					new_sql() = switch_mprintf("update channels set callstate='%q' where uuid='%q'",
-											   switch_event_get_header_nil(event, "channel-call-state"),
-											   switch_event_get_header_nil(event, "unique-id"));
+					new_channel_update(switch_event_get_header_nil(event, "unique-id"), "callstate",
+											   switch_event_get_header_nil(event, "channel-call-state"));
 				}
 			}
 
@@ -2462,9 +3182,8 @@ static void core_event_handler(switch_event_t *event)
 					free(extra_cols);
 
 				} else {
-					new_sql() = switch_mprintf("update channels set state='%q' where uuid='%q'",
-											   switch_event_get_header_nil(event, "channel-state"),
-											   switch_event_get_header_nil(event, "unique-id"));
+					new_channel_update(switch_event_get_header_nil(event, "unique-id"), "state",
+											   switch_event_get_header_nil(event, "channel-state"));
 				}
 				break;
 			case CS_ROUTING:
@@ -2491,10 +3210,9 @@ static void core_event_handler(switch_event_t *event)
 											   switch_event_get_header_nil(event, "unique-id"));
 					free(extra_cols);
 				} else {
-					new_sql() = switch_mprintf("update channels set state='%q',cid_name='%q',cid_num='%q',callee_name='%q',callee_num='%q',"
-											   "sent_callee_name='%q',sent_callee_num='%q',"
-											   "ip_addr='%q',dest='%q',dialplan='%q',context='%q',presence_id='%q',presence_data='%q',accountcode='%q' "
-											   "where uuid='%q'",
+					new_channel_update(switch_event_get_header_nil(event, "unique-id"),
+											   "state,cid_name,cid_num,callee_name,callee_num,sent_callee_name,sent_callee_num,"
+											   "ip_addr,dest,dialplan,context,presence_id,presence_data,accountcode",
 											   switch_event_get_header_nil(event, "channel-state"),
 											   switch_event_get_header_nil(event, "caller-caller-id-name"),
 											   switch_event_get_header_nil(event, "caller-caller-id-number"),
@@ -2508,14 +3226,12 @@ static void core_event_handler(switch_event_t *event)
 											   switch_event_get_header_nil(event, "caller-context"),
 											   switch_event_get_header_nil(event, "channel-presence-id"),
 											   switch_event_get_header_nil(event, "channel-presence-data"),
-											   switch_event_get_header_nil(event, "variable_accountcode"),
-											   switch_event_get_header_nil(event, "unique-id"));
+											   switch_event_get_header_nil(event, "variable_accountcode"));
 				}
 				break;
 			default:
-				new_sql() = switch_mprintf("update channels set state='%q' where uuid='%q'",
-										   switch_event_get_header_nil(event, "channel-state"),
-										   switch_event_get_header_nil(event, "unique-id"));
+				new_channel_update(switch_event_get_header_nil(event, "unique-id"), "state",
+										   switch_event_get_header_nil(event, "channel-state"));
 				break;
 			}
 
@@ -2526,6 +3242,7 @@ static void core_event_handler(switch_event_t *event)
 	case SWITCH_EVENT_CHANNEL_BRIDGE:
 		{
 			const char *a_uuid, *b_uuid, *uuid;
+			char epoch[32];
 
 			a_uuid = switch_event_get_header(event, "Bridge-A-Unique-ID");
 			b_uuid = switch_event_get_header(event, "Bridge-B-Unique-ID");
@@ -2541,16 +3258,16 @@ static void core_event_handler(switch_event_t *event)
 				switch_safe_free(extra_cols);
 			}
 
-			new_sql() = switch_mprintf("update channels set call_uuid='%q' where uuid='%q' or uuid='%q'",
-									   switch_event_get_header_nil(event, "channel-call-uuid"), a_uuid, b_uuid);
-
+			new_channel_update(a_uuid, "call_uuid", switch_event_get_header_nil(event, "channel-call-uuid"));
+			new_channel_update(b_uuid, "call_uuid", switch_event_get_header_nil(event, "channel-call-uuid"));
 
-			new_sql() = switch_mprintf("insert into calls (call_uuid,call_created,call_created_epoch,"
+			switch_snprintf(epoch, sizeof(epoch), "%ld", (long) switch_epoch_time_now(NULL));
+			new_sql_params("insert into calls (call_uuid,call_created,call_created_epoch,"
 									   "caller_uuid,callee_uuid,hostname) "
-									   "values ('%q','%q','%ld','%q','%q','%q')",
+									   "values (?,?,?,?,?,?)",
 									   switch_event_get_header_nil(event, "channel-call-uuid"),
 									   switch_event_get_header_nil(event, "event-date-local"),
-									   (long) switch_epoch_time_now(NULL),
+									   epoch,
 									   a_uuid,
 									   b_uuid,
 									   switch_core_get_switchname()
@@ -2567,15 +3284,15 @@ static void core_event_handler(switch_event_t *event)
 				switch_safe_free(extra_cols);
 			}
 
-			new_sql() = switch_mprintf("update channels set call_uuid=uuid where call_uuid='%q'",
+			new_sql_params_rows("update channels set call_uuid=uuid where call_uuid=?",
 									   switch_event_get_header_nil(event, "channel-call-uuid"));
 
-			new_sql() = switch_mprintf("delete from calls where (caller_uuid='%q' or callee_uuid='%q')",
+			new_sql_params("delete from calls where (caller_uuid=? or callee_uuid=?)",
 									   cuuid, cuuid);
 			break;
 		}
 	case SWITCH_EVENT_SHUTDOWN:
-		new_sql() = switch_mprintf("delete from channels where hostname='%q';"
+		new_sql_rows() = switch_mprintf("delete from channels where hostname='%q';"
 								   "delete from interfaces where hostname='%q';"
 								   "delete from calls where hostname='%q'",
 								   switch_core_get_switchname(), switch_core_get_hostname(), switch_core_get_switchname()
@@ -2650,18 +3367,25 @@ static void core_event_handler(switch_event_t *event)
 	}
 
 	if (sql_idx) {
-		int i = 0;
-
-
 		for (i = 0; i < sql_idx; i++) {
-			if (switch_stristr("update channels", sql[i]) || switch_stristr("delete from channels", sql[i])) {
-				switch_sql_queue_manager_push(sql_manager.qm, sql[i], 1, SWITCH_FALSE);
+			if (sql_rows[i]) {
+				/* rows besides the event's own are touched, none of the pending updates may be merged past it */
+				switch_sql_queue_manager_push_keyed(sql_manager.qm, sql[i], "channels", NULL, 1, SWITCH_FALSE);
+			} else if (switch_stristr("update channels", sql[i] + (*sql[i] == SQL_PARAMS_MARK ? 2 : 0)) ||
+				switch_stristr("delete from channels", sql[i] + (*sql[i] == SQL_PARAMS_MARK ? 2 : 0))) {
+				/* keep later merged updates of this row from jumping ahead of the statement */
+				switch_sql_queue_manager_push_keyed(sql_manager.qm, sql[i], "channels", switch_event_get_header(event, "unique-id"), 1, SWITCH_FALSE);
 			} else {
 				switch_sql_queue_manager_push(sql_manager.qm, sql[i], 0, SWITCH_FALSE);
 			}
 			sql[i] = NULL;
 		}
 	}
+
+	/* after the statements of the same event, still open for merges from the events that follow */
+	for (i = 0; i < update_idx; i++) {
+		channel_update(&updates[i]);
+	}
 }
 
 
@@ -3795,10 +4519,28 @@ SWITCH_DECLARE(void) switch_cache_db_status(switch_stream_handle_t *stream)
 							   dbh->total_used_count,
 							   locked ? "Locked" : "Unlocked",
 							   dbh->use_count ? "Attached" : "Detached", dbh->use_count, dbh->creator, dbh->last_user);
+
+		if (dbh->stmt_hits || dbh->stmt_misses || dbh->stmt_expanded) {
+			uint64_t total = dbh->stmt_hits + dbh->stmt_misses;
+
+			stream->write_function(stream, "\tStatements: %u cached, %" SWITCH_UINT64_T_FMT " hits, %" SWITCH_UINT64_T_FMT " misses (%.1f%% hit rate), %"
+								   SWITCH_UINT64_T_FMT " expanded\n",
+								   dbh->stmt_count, dbh->stmt_hits, dbh->stmt_misses, total ? (double) dbh->stmt_hits * 100 / total : 0.0,
+								   dbh->stmt_expanded);
+		}
 	}
 
 	stream->write_function(stream, "%d total. %d in use.\n", count, used);
 
+	if (sql_manager.qm_list) {
+		switch_sql_queue_manager_t *qm;
+
+		stream->write_function(stream, "\nSQL queues:\n");
+		for (qm = sql_manager.qm_list; qm; qm = qm->next) {
+			switch_sql_queue_manager_status(qm, stream);
+		}
+	}
+
 	switch_mutex_unlock(sql_manager.dbh_mutex);
 }
 
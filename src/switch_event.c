@@ -54,6 +54,8 @@ struct switch_event_node {
 	switch_event_callback_t callback;
 	/*! private data */
 	void *user_data;
+	/*! deliver events of one call in order from a single dispatch thread */
+	int sharded;
 	struct switch_event_node *next;
 };
 
@@ -90,10 +92,11 @@ static switch_memory_pool_t *RUNTIME_POOL = NULL;
 static switch_memory_pool_t *THRUNTIME_POOL = NULL;
 static switch_thread_t *EVENT_DISPATCH_QUEUE_THREADS[MAX_DISPATCH_VAL] = { 0 };
 static uint8_t EVENT_DISPATCH_QUEUE_RUNNING[MAX_DISPATCH_VAL] = { 0 };
-static switch_queue_t *EVENT_DISPATCH_QUEUE = NULL;
 static switch_queue_t *EVENT_CHANNEL_DISPATCH_QUEUE = NULL;
 static switch_mutex_t *EVENT_QUEUE_MUTEX = NULL;
 static switch_mutex_t *CUSTOM_HASH_MUTEX = NULL;
+static switch_mutex_t *RENDER_MUTEX = NULL;
+static volatile switch_atomic_t FROZEN_WRITES = 0;
 static switch_hash_t *CUSTOM_HASH = NULL;
 static int THREAD_COUNT = 0;
 static int DISPATCH_THREAD_COUNT = 0;
@@ -103,7 +106,6 @@ static int SYSTEM_RUNNING = 0;
 static uint64_t EVENT_SEQUENCE_NR = 0;
 #ifdef SWITCH_EVENT_RECYCLE
 static switch_queue_t *EVENT_RECYCLE_QUEUE = NULL;
-static switch_queue_t *EVENT_HEADER_RECYCLE_QUEUE = NULL;
 #endif
 
 static void unsub_all_switch_event_channel(void);
@@ -290,10 +292,238 @@ static void switch_event_deliver_thread_pool(switch_event_t **event)
 
 }
 
+/*
+ * Dispatch rings
+ *
+ * Each dispatch thread owns two bounded lock-free rings.  The shared ring takes events
+ * that may be delivered in any order and can be drained by any dispatch thread, so an
+ * idle thread steals from its busy peers.  The pinned ring takes events carrying a
+ * Unique-ID when a subscriber asked for them to be sharded by call; it is consumed by
+ * one thread at a time so every event of a given call is delivered in firing order.
+ */
+
+#define DISPATCH_RING_LEN 16384 /* power of 2, >= DISPATCH_QUEUE_LEN */
+#define DISPATCH_BATCH 64
+#define DISPATCH_HIST_BUCKETS 24
+
+typedef struct {
+	volatile switch_atomic_t seq;
+	switch_event_t *event;
+	switch_time_t queued;
+} dispatch_cell_t;
+
+typedef struct {
+	volatile switch_atomic_t head;
+	char pad1[64 - sizeof(switch_atomic_t)];
+	volatile switch_atomic_t tail;
+	char pad2[64 - sizeof(switch_atomic_t)];
+	dispatch_cell_t *cells;
+	uint32_t mask;
+} dispatch_ring_t;
+
+typedef struct {
+	uint64_t delivered;
+	uint64_t stolen;
+	uint64_t pinned;
+	/* bumped by any producer, the others are only written by the owning thread */
+	volatile switch_atomic_t full;
+	switch_time_t max_latency;
+	uint64_t latency[DISPATCH_HIST_BUCKETS];
+	uint64_t depth[DISPATCH_HIST_BUCKETS];
+} dispatch_stats_t;
+
+typedef struct {
+	dispatch_ring_t shared;
+	dispatch_ring_t pinned;
+	volatile switch_atomic_t pinned_busy;
+	volatile switch_atomic_t sleeping;
+	/* set once the slot's thread runs, producers use it to spot a subscriber firing from inside a delivery */
+	volatile switch_atomic_t running;
+	switch_thread_id_t thread_id;
+	switch_mutex_t *mutex;
+	switch_thread_cond_t *cond;
+	dispatch_stats_t stats;
+} dispatch_slot_t;
+
+static dispatch_slot_t *DISPATCH_SLOTS = NULL;
+static volatile switch_atomic_t DISPATCH_NEXT = 0;
+static volatile switch_atomic_t SHARDED_NODES[SWITCH_EVENT_ALL + 1] = { 0 };
+
+static void dispatch_ring_init(dispatch_ring_t *ring, switch_memory_pool_t *pool)
+{
+	uint32_t i;
+
+	ring->cells = switch_core_alloc(pool, sizeof(dispatch_cell_t) * DISPATCH_RING_LEN);
+	ring->mask = DISPATCH_RING_LEN - 1;
+
+	for (i = 0; i < DISPATCH_RING_LEN; i++) {
+		ring->cells[i].seq = i;
+	}
+}
+
+static switch_status_t dispatch_ring_push(dispatch_ring_t *ring, switch_event_t *event)
+{
+	uint32_t pos = switch_atomic_read(&ring->tail);
+
+	for (;;) {
+		dispatch_cell_t *cell = &ring->cells[pos & ring->mask];
+		uint32_t seq = switch_atomic_read(&cell->seq);
+		int32_t dif = (int32_t) (seq - pos);
+
+		if (dif == 0) {
+			if (switch_atomic_cas(&ring->tail, pos + 1, pos) == pos) {
+				cell->event = event;
+				cell->queued = switch_micro_time_now();
+				/* publish, the cas is our release barrier */
+				switch_atomic_cas(&cell->seq, pos + 1, seq);
+				return SWITCH_STATUS_SUCCESS;
+			}
+		} else if (dif < 0) {
+			return SWITCH_STATUS_FALSE;
+		}
+
+		pos = switch_atomic_read(&ring->tail);
+	}
+}
+
+static switch_event_t *dispatch_ring_pop(dispatch_ring_t *ring, switch_time_t *queued, uint32_t *depth)
+{
+	uint32_t pos = switch_atomic_read(&ring->head);
+
+	for (;;) {
+		dispatch_cell_t *cell = &ring->cells[pos & ring->mask];
+		uint32_t seq = switch_atomic_read(&cell->seq);
+		int32_t dif = (int32_t) (seq - (pos + 1));
+
+		if (dif == 0) {
+			if (switch_atomic_cas(&ring->head, pos + 1, pos) == pos) {
+				switch_event_t *event = cell->event;
+
+				*queued = cell->queued;
+				*depth = switch_atomic_read(&ring->tail) - pos;
+				switch_atomic_cas(&cell->seq, pos + ring->mask + 1, seq);
+				return event;
+			}
+		} else if (dif < 0) {
+			return NULL;
+		}
+
+		pos = switch_atomic_read(&ring->head);
+	}
+}
+
+static int dispatch_bucket(uint64_t val)
+{
+	int bucket = 0;
+
+	while (val && bucket < DISPATCH_HIST_BUCKETS - 1) {
+		val >>= 1;
+		bucket++;
+	}
+
+	return bucket;
+}
+
+static void dispatch_deliver(dispatch_slot_t *slot, switch_event_t *event, switch_time_t queued, uint32_t depth)
+{
+	switch_time_t latency = switch_micro_time_now() - queued;
+
+	if (latency < 0) {
+		latency = 0;
+	}
+
+	slot->stats.delivered++;
+	slot->stats.latency[dispatch_bucket((uint64_t) latency)]++;
+	slot->stats.depth[dispatch_bucket(depth)]++;
+
+	if (latency > slot->stats.max_latency) {
+		slot->stats.max_latency = latency;
+	}
+
+	switch_event_deliver(&event);
+}
+
+static int dispatch_drain_pinned(dispatch_slot_t *me, dispatch_slot_t *slot, int stolen)
+{
+	switch_event_t *event;
+	switch_time_t queued;
+	uint32_t depth;
+	int x = 0;
+
+	/* only one thread may consume a pinned ring at a time or per call ordering is lost */
+	if (switch_atomic_cas(&slot->pinned_busy, 1, 0) != 0) {
+		return 0;
+	}
+
+	while (x < DISPATCH_BATCH && (event = dispatch_ring_pop(&slot->pinned, &queued, &depth))) {
+		me->stats.pinned++;
+		if (stolen) {
+			me->stats.stolen++;
+		}
+		dispatch_deliver(me, event, queued, depth);
+		x++;
+	}
+
+	switch_atomic_set(&slot->pinned_busy, 0);
+
+	return x;
+}
+
+static int dispatch_drain_shared(dispatch_slot_t *me, dispatch_slot_t *slot, int stolen)
+{
+	switch_event_t *event;
+	switch_time_t queued;
+	uint32_t depth;
+	int x = 0;
+
+	while (x < DISPATCH_BATCH && (event = dispatch_ring_pop(&slot->shared, &queued, &depth))) {
+		if (stolen) {
+			me->stats.stolen++;
+		}
+		dispatch_deliver(me, event, queued, depth);
+		x++;
+	}
+
+	return x;
+}
+
+static int dispatch_ring_empty(dispatch_ring_t *ring)
+{
+	return switch_atomic_read(&ring->head) == switch_atomic_read(&ring->tail);
+}
+
+/* pinned rings are hashed over MAX_DISPATCH so a call keeps its ring when threads are added,
+   ring x belongs to thread x % SOFT_MAX_DISPATCH */
+static int dispatch_idle(uint32_t my_id, uint32_t count)
+{
+	uint32_t x;
+
+	if (!dispatch_ring_empty(&DISPATCH_SLOTS[my_id].shared)) {
+		return 0;
+	}
+
+	for (x = my_id; x < MAX_DISPATCH; x += count) {
+		if (!dispatch_ring_empty(&DISPATCH_SLOTS[x].pinned)) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static void dispatch_wake(dispatch_slot_t *slot)
+{
+	if (switch_atomic_read(&slot->sleeping)) {
+		switch_mutex_lock(slot->mutex);
+		switch_thread_cond_signal(slot->cond);
+		switch_mutex_unlock(slot->mutex);
+	}
+}
+
 static void *SWITCH_THREAD_FUNC switch_event_dispatch_thread(switch_thread_t *thread, void *obj)
 {
-	switch_queue_t *queue = (switch_queue_t *) obj;
 	int my_id = 0;
+	dispatch_slot_t *me;
 
 	switch_mutex_lock(EVENT_QUEUE_MUTEX);
 	THREAD_COUNT++;
@@ -310,32 +540,70 @@ static void *SWITCH_THREAD_FUNC switch_event_dispatch_thread(switch_thread_t *th
 		return NULL;
 	}
 
+	me = &DISPATCH_SLOTS[my_id];
+	me->thread_id = switch_thread_self();
+	switch_atomic_set(&me->running, 1);
 	EVENT_DISPATCH_QUEUE_RUNNING[my_id] = 1;
 	switch_mutex_unlock(EVENT_QUEUE_MUTEX);
 
 
-	for (;;) {
-		void *pop = NULL;
-		switch_event_t *event = NULL;
+	while (EVENT_DISPATCH_QUEUE_RUNNING[my_id]) {
+		uint32_t x, count = SOFT_MAX_DISPATCH;
+		int got = 0;
 
 		if (!SYSTEM_RUNNING) {
 			break;
 		}
 
-		if (switch_queue_pop(queue, &pop) != SWITCH_STATUS_SUCCESS) {
+		if ((uint32_t) my_id >= count) {
+			/* still being launched */
+			switch_yield(1000);
 			continue;
 		}
 
-		if (!pop) {
-			break;
+		for (x = my_id; x < MAX_DISPATCH; x += count) {
+			got += dispatch_drain_pinned(me, &DISPATCH_SLOTS[x], 0);
 		}
 
-		event = (switch_event_t *) pop;
-		switch_event_deliver(&event);
-		switch_os_yield();
+		got += dispatch_drain_shared(me, me, 0);
+
+		if (got) {
+			continue;
+		}
+
+		/* nothing of our own, help whoever is behind */
+		for (x = 0; x < MAX_DISPATCH && !got; x++) {
+			if (x % count == (uint32_t) my_id) {
+				continue;
+			}
+
+			got = dispatch_drain_pinned(me, &DISPATCH_SLOTS[x], 1);
+
+			if (!got && x < count) {
+				got = dispatch_drain_shared(me, &DISPATCH_SLOTS[x], 1);
+			}
+		}
+
+		if (got) {
+			continue;
+		}
+
+		switch_mutex_lock(me->mutex);
+		switch_atomic_set(&me->sleeping, 1);
+		/* the cas orders the flag before the re-check against the producer's publish */
+		switch_atomic_cas(&me->sleeping, 1, 1);
+
+		if (EVENT_DISPATCH_QUEUE_RUNNING[my_id] && SYSTEM_RUNNING && dispatch_idle(my_id, count)) {
+			switch_thread_cond_timedwait(me->cond, me->mutex, 100000);
+		}
+
+		switch_atomic_set(&me->sleeping, 0);
+		switch_mutex_unlock(me->mutex);
 	}
 
 
+	switch_atomic_set(&me->running, 0);
+
 	switch_mutex_lock(EVENT_QUEUE_MUTEX);
 	EVENT_DISPATCH_QUEUE_RUNNING[my_id] = 0;
 	THREAD_COUNT--;
@@ -347,50 +615,142 @@ static void *SWITCH_THREAD_FUNC switch_event_dispatch_thread(switch_thread_t *th
 
 }
 
-static int PENDING = 0;
+static volatile switch_atomic_t PENDING = 0;
+
+/* the slot of the dispatch thread we are running on, NULL for any other thread */
+static dispatch_slot_t *dispatch_self(void)
+{
+	switch_thread_id_t self = switch_thread_self();
+	uint32_t x;
+
+	for (x = 0; x < MAX_DISPATCH; x++) {
+		if (switch_atomic_read(&DISPATCH_SLOTS[x].running) && switch_thread_equal(DISPATCH_SLOTS[x].thread_id, self)) {
+			return &DISPATCH_SLOTS[x];
+		}
+	}
+
+	return NULL;
+}
 
 static switch_status_t switch_event_queue_dispatch_event(switch_event_t **eventp)
 {
 
 	switch_event_t *event = *eventp;
+	uint32_t count, index;
+	int pinned = 0;
 
 	if (!SYSTEM_RUNNING) {
 		return SWITCH_STATUS_FALSE;
 	}
 
-	while (event) {
-		int launch = 0;
+	if (!(count = SOFT_MAX_DISPATCH)) {
+		return SWITCH_STATUS_FALSE;
+	}
 
-		switch_mutex_lock(EVENT_QUEUE_MUTEX);
+	if (switch_atomic_read(&SHARDED_NODES[event->event_id]) || switch_atomic_read(&SHARDED_NODES[SWITCH_EVENT_ALL])) {
+		const char *uuid = switch_event_get_header(event, "Unique-ID");
 
-		if (!PENDING && switch_queue_size(EVENT_DISPATCH_QUEUE) > (unsigned int)(DISPATCH_QUEUE_LEN * DISPATCH_THREAD_COUNT)) {
-			if (SOFT_MAX_DISPATCH + 1 < MAX_DISPATCH) {
-				launch++;
-				PENDING++;
-			}
+		if (uuid) {
+			switch_ssize_t len = (switch_ssize_t) strlen(uuid);
+
+			index = switch_ci_hashfunc_default(uuid, &len) % MAX_DISPATCH;
+			pinned = 1;
 		}
+	}
 
-		switch_mutex_unlock(EVENT_QUEUE_MUTEX);
+	if (!pinned) {
+		uint32_t next;
+
+		do {
+			next = switch_atomic_read(&DISPATCH_NEXT);
+		} while (switch_atomic_cas(&DISPATCH_NEXT, next + 1, next) != next);
+
+		index = next % count;
+	}
+
+	*eventp = NULL;
+
+	while (dispatch_ring_push(pinned ? &DISPATCH_SLOTS[index].pinned : &DISPATCH_SLOTS[index].shared, event) != SWITCH_STATUS_SUCCESS) {
+		dispatch_slot_t *self;
+		uint32_t x;
+
+		switch_atomic_inc(&DISPATCH_SLOTS[index].stats.full);
+
+		if (count + 1 < MAX_DISPATCH && switch_atomic_cas(&PENDING, 1, 0) == 0) {
+			switch_event_launch_dispatch_threads(count + 1);
+			switch_atomic_set(&PENDING, 0);
+		}
 
-		if (launch) {
-			if (SOFT_MAX_DISPATCH + 1 < MAX_DISPATCH) {
-				switch_event_launch_dispatch_threads(SOFT_MAX_DISPATCH + 1);
+		if (!pinned) {
+			/* any other ring will do */
+			for (x = 1; x < count; x++) {
+				uint32_t i = (index + x) % count;
+
+				if (dispatch_ring_push(&DISPATCH_SLOTS[i].shared, event) == SWITCH_STATUS_SUCCESS) {
+					dispatch_wake(&DISPATCH_SLOTS[i]);
+					return SWITCH_STATUS_SUCCESS;
+				}
 			}
+		}
 
-			switch_mutex_lock(EVENT_QUEUE_MUTEX);
-			PENDING--;
-			switch_mutex_unlock(EVENT_QUEUE_MUTEX);
+		if (!SYSTEM_RUNNING) {
+			switch_event_destroy(&event);
+			return SWITCH_STATUS_SUCCESS;
 		}
 
-		*eventp = NULL;
-		switch_queue_push(EVENT_DISPATCH_QUEUE, event);
-		event = NULL;
+		/* a subscriber fired this from a dispatch thread, which may hold the very ring that is full;
+		   waiting would wait on ourselves, so deliver it here the way a nested fire always went out */
+		if ((self = dispatch_self())) {
+			dispatch_deliver(self, event, switch_micro_time_now(), 0);
+			return SWITCH_STATUS_SUCCESS;
+		}
 
+		/* back pressure, the same as a full queue always gave us */
+		switch_cond_next();
 	}
 
+	dispatch_wake(&DISPATCH_SLOTS[index % count]);
+
 	return SWITCH_STATUS_SUCCESS;
 }
 
+SWITCH_DECLARE(void) switch_event_dispatch_status(switch_stream_handle_t *stream)
+{
+	uint32_t x, b, count = SOFT_MAX_DISPATCH;
+	dispatch_stats_t total = { 0 };
+
+	if (!DISPATCH_SLOTS || !count) {
+		stream->write_function(stream, "Event dispatch not running\n");
+		return;
+	}
+
+	for (x = 0; x < count; x++) {
+		dispatch_slot_t *slot = &DISPATCH_SLOTS[x];
+
+		stream->write_function(stream, "thread %u: depth shared %u pinned %u delivered %"SWITCH_UINT64_T_FMT" pinned %"SWITCH_UINT64_T_FMT
+							   " stolen %"SWITCH_UINT64_T_FMT" full %u max-latency %"SWITCH_TIME_T_FMT"us\n",
+							   x, switch_atomic_read(&slot->shared.tail) - switch_atomic_read(&slot->shared.head),
+							   switch_atomic_read(&slot->pinned.tail) - switch_atomic_read(&slot->pinned.head),
+							   slot->stats.delivered, slot->stats.pinned, slot->stats.stolen, switch_atomic_read(&slot->stats.full), slot->stats.max_latency);
+
+		for (b = 0; b < DISPATCH_HIST_BUCKETS; b++) {
+			total.latency[b] += slot->stats.latency[b];
+			total.depth[b] += slot->stats.depth[b];
+		}
+	}
+
+	stream->write_function(stream, "\nlatency (us)          events    depth          events\n");
+
+	for (b = 0; b < DISPATCH_HIST_BUCKETS; b++) {
+		if (!total.latency[b] && !total.depth[b]) {
+			continue;
+		}
+
+		stream->write_function(stream, "< %-12u %15"SWITCH_UINT64_T_FMT"    < %-8u %15"SWITCH_UINT64_T_FMT"\n",
+							   1U << b, total.latency[b], 1U << b, total.depth[b]);
+	}
+}
+
 SWITCH_DECLARE(void) switch_event_deliver(switch_event_t **event)
 {
 	switch_event_types_t e;
@@ -518,13 +878,6 @@ SWITCH_DECLARE(void) switch_core_memory_reclaim_events(void)
 	size = switch_queue_size(EVENT_RECYCLE_QUEUE);
 
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "Returning %d recycled event(s) %d bytes\n", size, (int) sizeof(switch_event_t) * size);
-	size = switch_queue_size(EVENT_HEADER_RECYCLE_QUEUE);
-	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "Returning %d recycled event header(s) %d bytes\n",
-					  size, (int) sizeof(switch_event_header_t) * size);
-
-	while (switch_queue_trypop(EVENT_HEADER_RECYCLE_QUEUE, &pop) == SWITCH_STATUS_SUCCESS && pop) {
-		free(pop);
-	}
 	while (switch_queue_trypop(EVENT_RECYCLE_QUEUE, &pop) == SWITCH_STATUS_SUCCESS && pop) {
 		free(pop);
 	}
@@ -560,16 +913,16 @@ SWITCH_DECLARE(switch_status_t) switch_event_shutdown(void)
 	if (runtime.events_use_dispatch) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "Stopping dispatch queues\n");
 
-		for(x = 0; x < (uint32_t)DISPATCH_THREAD_COUNT; x++) {
-			switch_queue_trypush(EVENT_DISPATCH_QUEUE, NULL);
+		for(x = 0; x < SOFT_MAX_DISPATCH; x++) {
+			EVENT_DISPATCH_QUEUE_RUNNING[x] = 0;
+			switch_mutex_lock(DISPATCH_SLOTS[x].mutex);
+			switch_thread_cond_signal(DISPATCH_SLOTS[x].cond);
+			switch_mutex_unlock(DISPATCH_SLOTS[x].mutex);
 		}
 
-
-		switch_queue_interrupt_all(EVENT_DISPATCH_QUEUE);
-
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "Stopping dispatch threads\n");
 
-		for(x = 0; x < (uint32_t)DISPATCH_THREAD_COUNT; x++) {
+		for(x = 0; x < SOFT_MAX_DISPATCH; x++) {
 			switch_status_t st;
 			switch_thread_join(&st, EVENT_DISPATCH_QUEUE_THREADS[x]);
 		}
@@ -584,13 +937,18 @@ SWITCH_DECLARE(switch_status_t) switch_event_shutdown(void)
 		last = THREAD_COUNT;
 	}
 
-	if (runtime.events_use_dispatch) {
-		void *pop = NULL;
+	if (runtime.events_use_dispatch && DISPATCH_SLOTS) {
 		switch_event_t *event = NULL;
+		switch_time_t queued;
+		uint32_t depth;
 
-		while (switch_queue_trypop(EVENT_DISPATCH_QUEUE, &pop) == SWITCH_STATUS_SUCCESS && pop) {
-			event = (switch_event_t *) pop;
-			switch_event_destroy(&event);
+		for (x = 0; x < MAX_DISPATCH; x++) {
+			while ((event = dispatch_ring_pop(&DISPATCH_SLOTS[x].shared, &queued, &depth))) {
+				switch_event_destroy(&event);
+			}
+			while ((event = dispatch_ring_pop(&DISPATCH_SLOTS[x].pinned, &queued, &depth))) {
+				switch_event_destroy(&event);
+			}
 		}
 	}
 
@@ -616,11 +974,21 @@ SWITCH_DECLARE(switch_status_t) switch_event_shutdown(void)
 
 static void check_dispatch(void)
 {
-	if (!EVENT_DISPATCH_QUEUE) {
+	if (!DISPATCH_SLOTS) {
 		switch_mutex_lock(BLOCK);
 
-		if (!EVENT_DISPATCH_QUEUE) {
-			switch_queue_create(&EVENT_DISPATCH_QUEUE, DISPATCH_QUEUE_LEN * MAX_DISPATCH, THRUNTIME_POOL);
+		if (!DISPATCH_SLOTS) {
+			dispatch_slot_t *slots = switch_core_alloc(THRUNTIME_POOL, sizeof(*slots) * MAX_DISPATCH);
+			uint32_t x;
+
+			for (x = 0; x < MAX_DISPATCH; x++) {
+				dispatch_ring_init(&slots[x].shared, THRUNTIME_POOL);
+				dispatch_ring_init(&slots[x].pinned, THRUNTIME_POOL);
+				switch_mutex_init(&slots[x].mutex, SWITCH_MUTEX_NESTED, THRUNTIME_POOL);
+				switch_thread_cond_create(&slots[x].cond, THRUNTIME_POOL);
+			}
+
+			DISPATCH_SLOTS = slots;
 			switch_event_launch_dispatch_threads(1);
 
 			while (!THREAD_COUNT) {
@@ -660,7 +1028,7 @@ SWITCH_DECLARE(void) switch_event_launch_dispatch_threads(uint32_t max)
 		switch_threadattr_create(&thd_attr, pool);
 		switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
 		switch_threadattr_priority_set(thd_attr, SWITCH_PRI_REALTIME);
-		switch_thread_create(&EVENT_DISPATCH_QUEUE_THREADS[index], thd_attr, switch_event_dispatch_thread, EVENT_DISPATCH_QUEUE, pool);
+		switch_thread_create(&EVENT_DISPATCH_QUEUE_THREADS[index], thd_attr, switch_event_dispatch_thread, NULL, pool);
 		while(--sanity && !EVENT_DISPATCH_QUEUE_RUNNING[index]) switch_yield(10000);
 
 		if (index == 1) {
@@ -690,6 +1058,7 @@ SWITCH_DECLARE(switch_status_t) switch_event_init(switch_memory_pool_t *pool)
 	switch_mutex_init(&POOL_LOCK, SWITCH_MUTEX_NESTED, RUNTIME_POOL);
 	switch_mutex_init(&EVENT_QUEUE_MUTEX, SWITCH_MUTEX_NESTED, RUNTIME_POOL);
 	switch_mutex_init(&CUSTOM_HASH_MUTEX, SWITCH_MUTEX_NESTED, RUNTIME_POOL);
+	switch_mutex_init(&RENDER_MUTEX, SWITCH_MUTEX_NESTED, RUNTIME_POOL);
 	switch_core_hash_init(&CUSTOM_HASH);
 
 	if (switch_core_test_flag(SCF_MINIMAL)) {
@@ -717,7 +1086,6 @@ SWITCH_DECLARE(switch_status_t) switch_event_init(switch_memory_pool_t *pool)
 
 #ifdef SWITCH_EVENT_RECYCLE
 	switch_queue_create(&EVENT_RECYCLE_QUEUE, 250000, THRUNTIME_POOL);
-	switch_queue_create(&EVENT_HEADER_RECYCLE_QUEUE, 250000, THRUNTIME_POOL);
 #endif
 
 	check_dispatch();
@@ -771,13 +1139,255 @@ SWITCH_DECLARE(switch_status_t) switch_event_create_subclass_detailed(const char
 	return SWITCH_STATUS_SUCCESS;
 }
 
+/*
+ * A fired event may be shared by every subscriber that took a reference, they read it from their own
+ * threads so nobody may change it any more.  The one exception is a sole holder (the delivery thread
+ * before anyone took a reference), it gets the event back as writable and loses the cached renderings.
+ */
+static switch_bool_t event_writable(switch_event_t *event, const char *what)
+{
+	int i;
+
+	if (!switch_test_flag(event, EF_FROZEN)) {
+		return SWITCH_TRUE;
+	}
+
+	if (switch_atomic_read(&event->refs) > 1) {
+		switch_atomic_inc(&FROZEN_WRITES);
+
+		if (switch_atomic_read(&FROZEN_WRITES) % 1000 == 1) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
+							  "Refusing to change [%s] on a shared %s event, switch_event_dup it first (%u so far)\n",
+							  switch_str_nil(what), switch_event_name(event->event_id), switch_atomic_read(&FROZEN_WRITES));
+		}
+
+		return SWITCH_FALSE;
+	}
+
+	for (i = 0; i < SWITCH_EVENT_RENDER_MAX; i++) {
+		FREE(event->rendered[i]);
+	}
+
+	return SWITCH_TRUE;
+}
+
 SWITCH_DECLARE(switch_status_t) switch_event_set_priority(switch_event_t *event, switch_priority_t priority)
 {
+	if (!event_writable(event, "priority")) {
+		return SWITCH_STATUS_FALSE;
+	}
+
 	event->priority = priority;
 	switch_event_add_header_string(event, SWITCH_STACK_TOP, "priority", switch_priority_name(priority));
 	return SWITCH_STATUS_SUCCESS;
 }
 
+/*
+ * Header storage
+ *
+ * Header nodes are carved out of slabs owned by the event and recycled through a per event
+ * free list, short names live inside the node.  Once an event carries EVENT_INDEX_MIN headers
+ * an open addressed table on the case insensitive name hash points at the first header of
+ * each name, so lookups and the del_header done by EF_UNIQ_HEADERS stop walking the list.
+ */
+
+#define EVENT_SLAB_HEADERS 32
+#define EVENT_INDEX_MIN 16
+
+struct switch_event_header_slab {
+	struct switch_event_header_slab *next;
+	switch_event_header_t headers[EVENT_SLAB_HEADERS];
+};
+
+static switch_event_header_t INDEX_DELETED;
+
+static void set_header_name(switch_event_header_t *header, const char *name)
+{
+	switch_size_t len = strlen(name);
+	switch_ssize_t hlen = (switch_ssize_t) len;
+
+	if (header->name && header->name != header->name_buf) {
+		FREE(header->name);
+	}
+
+	if (len < sizeof(header->name_buf)) {
+		memcpy(header->name_buf, name, len + 1);
+		header->name = header->name_buf;
+	} else {
+		header->name = DUP(name);
+	}
+
+	header->hash = switch_ci_hashfunc_default(header->name, &hlen);
+}
+
+static switch_event_header_t *new_header(switch_event_t *event, const char *header_name)
+{
+	switch_event_header_t *header;
+
+	if (!event->free_headers) {
+		struct switch_event_header_slab *slab;
+		int i;
+
+		slab = ALLOC(sizeof(*slab));
+		switch_assert(slab);
+		slab->next = event->slabs;
+		event->slabs = slab;
+
+		for (i = EVENT_SLAB_HEADERS - 1; i >= 0; i--) {
+			slab->headers[i].next = event->free_headers;
+			event->free_headers = &slab->headers[i];
+		}
+	}
+
+	header = event->free_headers;
+	event->free_headers = header->next;
+
+	memset(header, 0, sizeof(*header));
+	set_header_name(header, header_name);
+
+	return header;
+}
+
+static void release_header(switch_event_t *event, switch_event_header_t *header)
+{
+	if (header->idx) {
+		int i = 0;
+
+		for (i = 0; i < header->idx; i++) {
+			FREE(header->array[i]);
+		}
+		FREE(header->array);
+	}
+
+	if (header->name != header->name_buf) {
+		FREE(header->name);
+	}
+
+	FREE(header->value);
+
+	memset(header, 0, sizeof(*header));
+	header->next = event->free_headers;
+	event->free_headers = header;
+}
+
+static switch_event_header_t *index_lookup(switch_event_t *event, const char *header_name, unsigned long hash)
+{
+	uint32_t mask = event->index_size - 1, i = (uint32_t) hash & mask;
+	switch_event_header_t *hp;
+
+	while ((hp = event->index[i])) {
+		if (hp != &INDEX_DELETED && hp->hash == hash && !strcasecmp(hp->name, header_name)) {
+			return hp;
+		}
+		i = (i + 1) & mask;
+	}
+
+	return NULL;
+}
+
+static void index_rebuild(switch_event_t *event);
+
+static void index_insert(switch_event_t *event, switch_event_header_t *header, int replace)
+{
+	uint32_t mask, i;
+	switch_event_header_t **slot = NULL, *hp;
+
+	if ((event->index_used + 1) * 2 > event->index_size) {
+		index_rebuild(event);
+		return;
+	}
+
+	mask = event->index_size - 1;
+	i = (uint32_t) header->hash & mask;
+
+	while ((hp = event->index[i])) {
+		if (hp == &INDEX_DELETED) {
+			if (!slot) {
+				slot = &event->index[i];
+			}
+		} else if (hp->hash == header->hash && !strcasecmp(hp->name, header->name)) {
+			if (replace) {
+				event->index[i] = header;
+			}
+			return;
+		}
+		i = (i + 1) & mask;
+	}
+
+	if (!slot) {
+		slot = &event->index[i];
+		event->index_used++;
+	}
+
+	*slot = header;
+}
+
+static void index_remove(switch_event_t *event, const char *header_name, unsigned long hash)
+{
+	uint32_t mask = event->index_size - 1, i = (uint32_t) hash & mask;
+	switch_event_header_t *hp;
+
+	while ((hp = event->index[i])) {
+		if (hp != &INDEX_DELETED && hp->hash == hash && !strcasecmp(hp->name, header_name)) {
+			event->index[i] = &INDEX_DELETED;
+			return;
+		}
+		i = (i + 1) & mask;
+	}
+}
+
+static void index_rebuild(switch_event_t *event)
+{
+	switch_event_header_t *hp;
+	uint32_t size = 32;
+
+	while (size < event->header_count * 4) {
+		size <<= 1;
+	}
+
+	if (size != event->index_size) {
+		FREE(event->index);
+		switch_zmalloc(event->index, sizeof(*event->index) * size);
+		event->index_size = size;
+	} else {
+		memset(event->index, 0, sizeof(*event->index) * size);
+	}
+
+	event->index_used = 0;
+
+	/* walk in list order so the first header of a name is the one indexed */
+	for (hp = event->headers; hp; hp = hp->next) {
+		index_insert(event, hp, 0);
+	}
+}
+
+static void link_header(switch_event_t *event, switch_event_header_t *header, int top)
+{
+	if (top) {
+		header->next = event->headers;
+		event->headers = header;
+		if (!event->last_header) {
+			event->last_header = header;
+		}
+	} else {
+		if (event->last_header) {
+			event->last_header->next = header;
+		} else {
+			event->headers = header;
+		}
+		header->next = NULL;
+		event->last_header = header;
+	}
+
+	event->header_count++;
+
+	if (event->index) {
+		index_insert(event, header, top);
+	} else if (event->header_count >= EVENT_INDEX_MIN) {
+		index_rebuild(event);
+	}
+}
+
 SWITCH_DECLARE(switch_status_t) switch_event_rename_header(switch_event_t *event, const char *header_name, const char *new_header_name)
 {
 	switch_event_header_t *hp;
@@ -787,22 +1397,27 @@ SWITCH_DECLARE(switch_status_t) switch_event_rename_header(switch_event_t *event
 
 	switch_assert(event);
 
-	if (!header_name) {
+	if (!header_name || !event_writable(event, header_name)) {
 		return SWITCH_STATUS_FALSE;
 	}
 
 	hash = switch_ci_hashfunc_default(header_name, &hlen);
 
+	if (event->index && !index_lookup(event, header_name, hash)) {
+		return SWITCH_STATUS_FALSE;
+	}
+
 	for (hp = event->headers; hp; hp = hp->next) {
 		if ((!hp->hash || hash == hp->hash) && !strcasecmp(hp->name, header_name)) {
-			FREE(hp->name);
-			hp->name = DUP(new_header_name);
-			hlen = -1;
-			hp->hash = switch_ci_hashfunc_default(hp->name, &hlen);
+			set_header_name(hp, new_header_name);
 			x++;
 		}
 	}
 
+	if (x && event->index) {
+		index_rebuild(event);
+	}
+
 	return x ? SWITCH_STATUS_SUCCESS : SWITCH_STATUS_FALSE;
 }
 
@@ -820,6 +1435,10 @@ SWITCH_DECLARE(switch_event_header_t *) switch_event_get_header_ptr(switch_event
 
 	hash = switch_ci_hashfunc_default(header_name, &hlen);
 
+	if (event->index) {
+		return index_lookup(event, header_name, hash);
+	}
+
 	for (hp = event->headers; hp; hp = hp->next) {
 		if ((!hp->hash || hash == hp->hash) && !strcasecmp(hp->name, header_name)) {
 			return hp;
@@ -856,14 +1475,28 @@ SWITCH_DECLARE(char *) switch_event_get_body(switch_event_t *event)
 
 SWITCH_DECLARE(switch_status_t) switch_event_del_header_val(switch_event_t *event, const char *header_name, const char *val)
 {
-	switch_event_header_t *hp, *lp = NULL, *tp;
+	switch_event_header_t *hp, *lp = NULL, *tp, *kept = NULL;
 	switch_status_t status = SWITCH_STATUS_FALSE;
 	int x = 0;
 	switch_ssize_t hlen = -1;
 	unsigned long hash = 0;
 
+	if (!event_writable(event, header_name)) {
+		return status;
+	}
+
 	tp = event->headers;
 	hash = switch_ci_hashfunc_default(header_name, &hlen);
+
+	if (event->index) {
+		if (!index_lookup(event, header_name, hash)) {
+			return status;
+		}
+
+		/* drop the entry before its header can be released, the first survivor goes back below */
+		index_remove(event, header_name, hash);
+	}
+
 	while (tp) {
 		hp = tp;
 		tp = tp->next;
@@ -880,57 +1513,23 @@ SWITCH_DECLARE(switch_status_t) switch_event_del_header_val(switch_event_t *even
 			if (hp == event->last_header || !hp->next) {
 				event->last_header = lp;
 			}
-			FREE(hp->name);
 
-			if (hp->idx) {
-				int i = 0;
-
-				for (i = 0; i < hp->idx; i++) {
-					FREE(hp->array[i]);
-				}
-				FREE(hp->array);
-			}
-
-			FREE(hp->value);
-
-			memset(hp, 0, sizeof(*hp));
-#ifdef SWITCH_EVENT_RECYCLE
-			if (switch_queue_trypush(EVENT_HEADER_RECYCLE_QUEUE, hp) != SWITCH_STATUS_SUCCESS) {
-				FREE(hp);
-			}
-#else
-			FREE(hp);
-#endif
+			release_header(event, hp);
+			event->header_count--;
 			status = SWITCH_STATUS_SUCCESS;
 		} else {
+			if (!kept && (!hp->hash || hash == hp->hash) && !strcasecmp(header_name, hp->name)) {
+				kept = hp;
+			}
 			lp = hp;
 		}
 	}
 
-	return status;
-}
-
-static switch_event_header_t *new_header(const char *header_name)
-{
-	switch_event_header_t *header;
-
-#ifdef SWITCH_EVENT_RECYCLE
-		void *pop;
-		if (EVENT_HEADER_RECYCLE_QUEUE && switch_queue_trypop(EVENT_HEADER_RECYCLE_QUEUE, &pop) == SWITCH_STATUS_SUCCESS) {
-			header = (switch_event_header_t *) pop;
-		} else {
-#endif
-			header = ALLOC(sizeof(*header));
-			switch_assert(header);
-#ifdef SWITCH_EVENT_RECYCLE
-		}
-#endif
-
-		memset(header, 0, sizeof(*header));
-		header->name = DUP(header_name);
-
-		return header;
+	if (kept && event->index) {
+		index_insert(event, kept, 0);
+	}
 
+	return status;
 }
 
 SWITCH_DECLARE(int) switch_event_add_array(switch_event_t *event, const char *var, const char *val)
@@ -982,13 +1581,17 @@ SWITCH_DECLARE(int) switch_event_add_array(switch_event_t *event, const char *va
 static switch_status_t switch_event_base_add_header(switch_event_t *event, switch_stack_t stack, const char *header_name, char *data)
 {
 	switch_event_header_t *header = NULL;
-	switch_ssize_t hlen = -1;
 	int exists = 0, fly = 0;
 	char *index_ptr;
 	int index = 0;
 	char *real_header_name = NULL;
 
 
+	if (!event_writable(event, header_name)) {
+		FREE(data);
+		return SWITCH_STATUS_FALSE;
+	}
+
 	if (!strcmp(header_name, "_body")) {
 		switch_event_set_body(event, data);
 	}
@@ -1007,7 +1610,7 @@ static switch_status_t switch_event_base_add_header(switch_event_t *event, switc
 
 		if (!(header = switch_event_get_header_ptr(event, header_name)) && index_ptr) {
 
-			header = new_header(header_name);
+			header = new_header(event, header_name);
 
 			if (switch_test_flag(event, EF_UNIQ_HEADERS)) {
 				switch_event_del_header(event, header_name);
@@ -1074,7 +1677,7 @@ static switch_status_t switch_event_base_add_header(switch_event_t *event, switc
 		}
 
 
-		header = new_header(header_name);
+		header = new_header(event, header_name);
 	}
 
 	if ((stack & SWITCH_STACK_PUSH) || (stack & SWITCH_STACK_UNSHIFT)) {
@@ -1145,23 +1748,7 @@ static switch_status_t switch_event_base_add_header(switch_event_t *event, switc
 	}
 
 	if (!exists) {
-		header->hash = switch_ci_hashfunc_default(header->name, &hlen);
-
-		if ((stack & SWITCH_STACK_TOP)) {
-			header->next = event->headers;
-			event->headers = header;
-			if (!event->last_header) {
-				event->last_header = header;
-			}
-		} else {
-			if (event->last_header) {
-				event->last_header->next = header;
-			} else {
-				event->headers = header;
-				header->next = NULL;
-			}
-			event->last_header = header;
-		}
+		link_header(event, header, (stack & SWITCH_STACK_TOP));
 	}
 
  end:
@@ -1193,6 +1780,10 @@ SWITCH_DECLARE(switch_status_t) switch_event_set_subclass_name(switch_event_t *e
 	if (!event || !subclass_name)
 		return SWITCH_STATUS_GENERR;
 
+	if (!event_writable(event, "Event-Subclass")) {
+		return SWITCH_STATUS_FALSE;
+	}
+
 	switch_safe_free(event->subclass_name);
 	event->subclass_name = DUP(subclass_name);
 	switch_event_del_header(event, "Event-Subclass");
@@ -1210,6 +1801,10 @@ SWITCH_DECLARE(switch_status_t) switch_event_add_header_string(switch_event_t *e
 
 SWITCH_DECLARE(switch_status_t) switch_event_set_body(switch_event_t *event, const char *body)
 {
+	if (!event_writable(event, "_body")) {
+		return SWITCH_STATUS_FALSE;
+	}
+
 	switch_safe_free(event->body);
 
 	if (body) {
@@ -1225,6 +1820,11 @@ SWITCH_DECLARE(switch_status_t) switch_event_add_body(switch_event_t *event, con
 	char *data;
 
 	va_list ap;
+
+	if (!event_writable(event, "_body")) {
+		return SWITCH_STATUS_FALSE;
+	}
+
 	if (fmt) {
 		va_start(ap, fmt);
 		ret = switch_vasprintf(&data, fmt, ap);
@@ -1246,6 +1846,14 @@ SWITCH_DECLARE(void) switch_event_destroy(switch_event_t **event)
 {
 	switch_event_t *ep = *event;
 	switch_event_header_t *hp, *this;
+	struct switch_event_header_slab *slab;
+	int i;
+
+	if (ep && switch_test_flag(ep, EF_FROZEN) && switch_atomic_dec(&ep->refs)) {
+		/* someone else still holds it */
+		*event = NULL;
+		return;
+	}
 
 	if (ep) {
 		for (hp = ep->headers; hp;) {
@@ -1265,20 +1873,22 @@ SWITCH_DECLARE(void) switch_event_destroy(switch_event_t **event)
 				}
 			}
 
-			FREE(this->name);
-			FREE(this->value);
-
-
-#ifdef SWITCH_EVENT_RECYCLE
-			if (switch_queue_trypush(EVENT_HEADER_RECYCLE_QUEUE, this) != SWITCH_STATUS_SUCCESS) {
-				FREE(this);
+			if (this->name != this->name_buf) {
+				FREE(this->name);
 			}
-#else
-			FREE(this);
-#endif
+			FREE(this->value);
+		}
 
+		while ((slab = ep->slabs)) {
+			ep->slabs = slab->next;
+			FREE(slab);
+		}
 
+		for (i = 0; i < SWITCH_EVENT_RENDER_MAX; i++) {
+			FREE(ep->rendered[i]);
 		}
+
+		FREE(ep->index);
 		FREE(ep->body);
 		FREE(ep->subclass_name);
 #ifdef SWITCH_EVENT_RECYCLE
@@ -1324,7 +1934,7 @@ SWITCH_DECLARE(switch_status_t) switch_event_dup(switch_event_t **event, switch_
 	(*event)->event_id = todup->event_id;
 	(*event)->event_user_data = todup->event_user_data;
 	(*event)->bind_user_data = todup->bind_user_data;
-	(*event)->flags = todup->flags;
+	(*event)->flags = todup->flags & ~EF_FROZEN;
 	for (hp = todup->headers; hp; hp = hp->next) {
 		if (todup->subclass_name && !strcmp(hp->name, "Event-Subclass")) {
 			continue;
@@ -1350,6 +1960,73 @@ SWITCH_DECLARE(switch_status_t) switch_event_dup(switch_event_t **event, switch_
 }
 
 
+SWITCH_DECLARE(switch_event_t *) switch_event_ref(switch_event_t *event)
+{
+	switch_event_t *clone = NULL;
+
+	if (switch_test_flag(event, EF_FROZEN)) {
+		switch_atomic_inc(&event->refs);
+		return event;
+	}
+
+	if (switch_event_dup(&clone, event) != SWITCH_STATUS_SUCCESS) {
+		return NULL;
+	}
+
+	return clone;
+}
+
+SWITCH_DECLARE(const char *) switch_event_get_rendered(switch_event_t *event, switch_event_render_t type)
+{
+	char *str = NULL;
+	switch_xml_t xml;
+
+	if (!switch_test_flag(event, EF_FROZEN) || type >= SWITCH_EVENT_RENDER_MAX) {
+		return NULL;
+	}
+
+	switch_mutex_lock(RENDER_MUTEX);
+	str = event->rendered[type];
+	switch_mutex_unlock(RENDER_MUTEX);
+
+	if (str) {
+		return str;
+	}
+
+	/* render outside the lock, a holder racing us just throws its copy away */
+	switch (type) {
+	case SWITCH_EVENT_RENDER_PLAIN:
+		switch_event_serialize(event, &str, SWITCH_TRUE);
+		break;
+	case SWITCH_EVENT_RENDER_JSON:
+		switch_event_serialize_json(event, &str);
+		break;
+	case SWITCH_EVENT_RENDER_XML:
+		if ((xml = switch_event_xmlize(event, SWITCH_VA_NONE))) {
+			str = switch_xml_toxml(xml, SWITCH_FALSE);
+			switch_xml_free(xml);
+		}
+		break;
+	default:
+		break;
+	}
+
+	if (!str) {
+		return NULL;
+	}
+
+	switch_mutex_lock(RENDER_MUTEX);
+	if (event->rendered[type]) {
+		free(str);
+	} else {
+		event->rendered[type] = str;
+	}
+	str = event->rendered[type];
+	switch_mutex_unlock(RENDER_MUTEX);
+
+	return str;
+}
+
 SWITCH_DECLARE(switch_status_t) switch_event_dup_reply(switch_event_t **event, switch_event_t *todup)
 {
 	switch_event_header_t *hp;
@@ -1363,7 +2040,7 @@ SWITCH_DECLARE(switch_status_t) switch_event_dup_reply(switch_event_t **event, s
 	(*event)->event_id = todup->event_id;
 	(*event)->event_user_data = todup->event_user_data;
 	(*event)->bind_user_data = todup->bind_user_data;
-	(*event)->flags = todup->flags;
+	(*event)->flags = todup->flags & ~EF_FROZEN;
 
 	for (hp = todup->headers; hp; hp = hp->next) {
 		char *name = hp->name, *value = hp->value;
@@ -1993,6 +2670,9 @@ SWITCH_DECLARE(switch_status_t) switch_event_fire_detailed(const char *file, con
 		(*event)->event_user_data = user_data;
 	}
 
+	/* from here on subscribers may share the event through switch_event_ref */
+	(*event)->flags |= EF_FROZEN;
+	switch_atomic_set(&(*event)->refs, 1);
 
 
 	if (runtime.events_use_dispatch) {
@@ -2098,6 +2778,26 @@ SWITCH_DECLARE(switch_status_t) switch_event_bind(const char *id, switch_event_t
 	return switch_event_bind_removable(id, event, subclass_name, callback, user_data, NULL);
 }
 
+SWITCH_DECLARE(switch_status_t) switch_event_bind_sharded(const char *id, switch_event_types_t event, const char *subclass_name,
+														  switch_event_callback_t callback, void *user_data, switch_event_node_t **node)
+{
+	switch_event_node_t *event_node = NULL;
+	switch_status_t status;
+
+	if ((status = switch_event_bind_removable(id, event, subclass_name, callback, user_data, &event_node)) == SWITCH_STATUS_SUCCESS) {
+		switch_mutex_lock(BLOCK);
+		event_node->sharded = 1;
+		switch_atomic_inc(&SHARDED_NODES[event]);
+		switch_mutex_unlock(BLOCK);
+	}
+
+	if (node) {
+		*node = event_node;
+	}
+
+	return status;
+}
+
 
 SWITCH_DECLARE(switch_status_t) switch_event_unbind_callback(switch_event_callback_t callback)
 {
@@ -2122,6 +2822,9 @@ SWITCH_DECLARE(switch_status_t) switch_event_unbind_callback(switch_event_callba
 				}
 
 				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Event Binding deleted for %s:%s\n", n->id, switch_event_name(n->event_id));
+				if (n->sharded) {
+					switch_atomic_dec(&SHARDED_NODES[n->event_id]);
+				}
 				FREE(n->subclass_name);
 				FREE(n->id);
 				FREE(n);
@@ -2162,6 +2865,9 @@ SWITCH_DECLARE(switch_status_t) switch_event_unbind(switch_event_node_t **node)
 				EVENT_NODES[n->event_id] = n->next;
 			}
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Event Binding deleted for %s:%s\n", n->id, switch_event_name(n->event_id));
+			if (n->sharded) {
+				switch_atomic_dec(&SHARDED_NODES[n->event_id]);
+			}
 			FREE(n->subclass_name);
 			FREE(n->id);
 			FREE(n);
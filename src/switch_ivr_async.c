@@ -1108,10 +1108,19 @@ struct record_helper {
 	switch_buffer_t *thread_buffer;
 	switch_thread_t *thread;
 	switch_mutex_t *buffer_mutex;
+	switch_thread_cond_t *writer_cond;
 	int thread_ready;
 	uint32_t writes;
 	uint32_t vwrites;
 	const char *completion_cause;
+	switch_core_session_t *session;
+	int channels;
+	int pooled;
+	int writer_queued;
+	int writer_closing;
+	int writer_failed;
+	switch_size_t dropped;
+	switch_time_t drop_warned;
 };
 
 /**
@@ -1177,6 +1186,304 @@ static void send_record_stop_event(switch_channel_t *channel, switch_codec_imple
 	}
 }
 
+#define RECORD_WRITER_MAX_THREADS 64
+#define RECORD_WRITER_BATCH (1024 * 8)
+#define RECORD_WRITER_CHUNK (1024 * 64)
+#define RECORD_WRITER_DROP_WARN_SEC 5
+
+/* Recordings hand their audio to a small shared pool of writer threads instead of running a thread each.
+   A recording is queued once it has RECORD_WRITER_BATCH bytes waiting and stays queued until a writer drained it,
+   so at most one writer touches a file handle at a time and the session thread never blocks on disk. */
+static struct {
+	uint32_t threads;
+	switch_size_t max_buffer;
+	switch_queue_t *queue;
+	switch_thread_t *thread[RECORD_WRITER_MAX_THREADS];
+	uint32_t started;
+	switch_mutex_t *mutex;
+	uint32_t recordings;
+	uint64_t batches;
+	uint64_t errors;
+	uint64_t bytes_written;
+	uint64_t latency_total;
+	uint64_t latency_max;
+	volatile int64_t bytes_in;
+	volatile int64_t bytes_out;
+	volatile int64_t bytes_dropped;
+} record_writer = { 4, 1024 * 512 };
+
+SWITCH_DECLARE(uint32_t) switch_ivr_record_writer_set_threads(uint32_t threads)
+{
+	if (!record_writer.started && threads <= RECORD_WRITER_MAX_THREADS) {
+		record_writer.threads = threads;
+	}
+
+	return record_writer.threads;
+}
+
+SWITCH_DECLARE(switch_size_t) switch_ivr_record_writer_set_max_buffer(switch_size_t bytes)
+{
+	if (bytes >= RECORD_WRITER_BATCH * 2) {
+		record_writer.max_buffer = bytes;
+	}
+
+	return record_writer.max_buffer;
+}
+
+static void record_write_failed(struct record_helper *rh)
+{
+	switch_channel_t *channel = switch_core_session_get_channel(rh->session);
+
+	switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rh->session), SWITCH_LOG_ERROR, "Error writing %s\n", rh->file);
+	/* File write failed */
+	set_completion_cause(rh, "uri-failure");
+	rh->writer_failed = 1;
+
+	if (rh->hangup_on_error) {
+		switch_channel_hangup(channel, SWITCH_CAUSE_DESTINATION_OUT_OF_ORDER);
+	}
+}
+
+static void record_writer_drain(struct record_helper *rh, unsigned char *data)
+{
+	switch_size_t frame_bytes = 2 * rh->channels, bytes, samples;
+	switch_time_t start, took;
+	switch_status_t status;
+
+	for (;;) {
+		switch_mutex_lock(rh->buffer_mutex);
+
+		if (rh->writer_failed || switch_buffer_inuse(rh->thread_buffer) < frame_bytes) {
+			rh->writer_queued = 0;
+			if (rh->writer_cond) {
+				switch_thread_cond_signal(rh->writer_cond);
+			}
+			switch_mutex_unlock(rh->buffer_mutex);
+			break;
+		}
+
+		bytes = switch_buffer_read(rh->thread_buffer, data, RECORD_WRITER_CHUNK - (RECORD_WRITER_CHUNK % frame_bytes));
+		switch_mutex_unlock(rh->buffer_mutex);
+
+		__sync_fetch_and_add(&record_writer.bytes_out, (int64_t) bytes);
+		samples = bytes / frame_bytes;
+
+		start = switch_time_now();
+		status = switch_core_file_write(rh->fh, data, &samples);
+		took = switch_time_now() - start;
+
+		switch_mutex_lock(record_writer.mutex);
+		record_writer.batches++;
+		record_writer.latency_total += took;
+		if ((uint64_t) took > record_writer.latency_max) {
+			record_writer.latency_max = took;
+		}
+		if (status == SWITCH_STATUS_SUCCESS) {
+			record_writer.bytes_written += bytes;
+		} else {
+			record_writer.errors++;
+		}
+		switch_mutex_unlock(record_writer.mutex);
+
+		if (status != SWITCH_STATUS_SUCCESS) {
+			record_write_failed(rh);
+		}
+	}
+}
+
+static void *SWITCH_THREAD_FUNC record_writer_thread(switch_thread_t *thread, void *obj)
+{
+	unsigned char *data = malloc(RECORD_WRITER_CHUNK);
+	void *pop = NULL;
+
+	switch_assert(data);
+
+	while (switch_queue_pop(record_writer.queue, &pop) == SWITCH_STATUS_SUCCESS && pop) {
+		record_writer_drain((struct record_helper *) pop, data);
+	}
+
+	free(data);
+
+	return NULL;
+}
+
+void switch_ivr_record_writer_start(switch_memory_pool_t *pool)
+{
+	switch_threadattr_t *thd_attr = NULL;
+	uint32_t i;
+
+	if (!record_writer.threads) {
+		return;
+	}
+
+	switch_mutex_init(&record_writer.mutex, SWITCH_MUTEX_NESTED, pool);
+	switch_queue_create(&record_writer.queue, SWITCH_CORE_QUEUE_LEN, pool);
+
+	for (i = 0; i < record_writer.threads; i++) {
+		switch_threadattr_create(&thd_attr, pool);
+		switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+		switch_thread_create(&record_writer.thread[i], thd_attr, record_writer_thread, NULL, pool);
+	}
+
+	record_writer.started = 1;
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Started %u recording writer threads\n", record_writer.threads);
+}
+
+void switch_ivr_record_writer_stop(void)
+{
+	switch_status_t st;
+	uint32_t i;
+
+	if (!record_writer.started) {
+		return;
+	}
+
+	for (i = 0; i < record_writer.threads; i++) {
+		switch_queue_push(record_writer.queue, NULL);
+	}
+
+	for (i = 0; i < record_writer.threads; i++) {
+		switch_thread_join(&st, record_writer.thread[i]);
+	}
+
+	/* only now that no writer is left may a closing recording finish its tail itself */
+	record_writer.started = 0;
+}
+
+SWITCH_DECLARE(void) switch_ivr_record_writer_status(switch_stream_handle_t *stream)
+{
+	uint64_t batches, latency_total;
+
+	if (!record_writer.started) {
+		/* thread recordings go through the same bounded buffers, their totals still count */
+		stream->write_function(stream, "recording writer pool disabled, one thread per recording\n");
+		stream->write_function(stream, "bytes-queued: %" SWITCH_INT64_T_FMT "\n", record_writer.bytes_in - record_writer.bytes_out);
+		stream->write_function(stream, "bytes-dropped: %" SWITCH_INT64_T_FMT "\n", record_writer.bytes_dropped);
+		return;
+	}
+
+	switch_mutex_lock(record_writer.mutex);
+	batches = record_writer.batches;
+	latency_total = record_writer.latency_total;
+
+	stream->write_function(stream, "threads: %u\n", record_writer.threads);
+	stream->write_function(stream, "max-buffer-per-recording: %" SWITCH_SIZE_T_FMT "\n", record_writer.max_buffer);
+	stream->write_function(stream, "recordings: %u\n", record_writer.recordings);
+	stream->write_function(stream, "queue-depth: %u\n", switch_queue_size(record_writer.queue));
+	stream->write_function(stream, "bytes-queued: %" SWITCH_INT64_T_FMT "\n", record_writer.bytes_in - record_writer.bytes_out);
+	stream->write_function(stream, "bytes-written: %" SWITCH_UINT64_T_FMT "\n", record_writer.bytes_written);
+	stream->write_function(stream, "bytes-dropped: %" SWITCH_INT64_T_FMT "\n", record_writer.bytes_dropped);
+	stream->write_function(stream, "batches: %" SWITCH_UINT64_T_FMT "\n", batches);
+	stream->write_function(stream, "write-errors: %" SWITCH_UINT64_T_FMT "\n", record_writer.errors);
+	stream->write_function(stream, "write-latency-avg-us: %" SWITCH_UINT64_T_FMT "\n", batches ? latency_total / batches : 0);
+	stream->write_function(stream, "write-latency-max-us: %" SWITCH_UINT64_T_FMT "\n", record_writer.latency_max);
+	switch_mutex_unlock(record_writer.mutex);
+}
+
+/* append to a recording's bounded buffer, caller holds buffer_mutex.
+   When whoever drains it is not keeping up the audio is dropped rather than grown without bound,
+   counted, and warned about at most every RECORD_WRITER_DROP_WARN_SEC for each recording. */
+static switch_bool_t record_buffer_write(struct record_helper *rh, const void *data, switch_size_t datalen)
+{
+	switch_time_t now;
+
+	if (switch_buffer_write(rh->thread_buffer, data, datalen)) {
+		__sync_fetch_and_add(&record_writer.bytes_in, (int64_t) datalen);
+		return SWITCH_TRUE;
+	}
+
+	rh->dropped += datalen;
+	__sync_fetch_and_add(&record_writer.bytes_dropped, (int64_t) datalen);
+
+	now = switch_micro_time_now();
+
+	if (!rh->drop_warned || now - rh->drop_warned >= RECORD_WRITER_DROP_WARN_SEC * 1000000) {
+		rh->drop_warned = now;
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rh->session), SWITCH_LOG_WARNING,
+						  "Recording buffer for %s is full, %" SWITCH_SIZE_T_FMT " bytes dropped so far\n", rh->file, rh->dropped);
+	}
+
+	return SWITCH_FALSE;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_ivr_record_buffer_create(switch_ivr_record_buffer_t **rbP, switch_size_t max_buffer, const char *file)
+{
+	struct record_helper *rh;
+
+	switch_zmalloc(rh, sizeof(*rh));
+	rh->file = strdup(file);
+
+	if (switch_buffer_create_dynamic(&rh->thread_buffer, 1024, 1024, max_buffer) != SWITCH_STATUS_SUCCESS) {
+		switch_safe_free(rh->file);
+		free(rh);
+		return SWITCH_STATUS_MEMERR;
+	}
+
+	*rbP = (switch_ivr_record_buffer_t *) rh;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(switch_bool_t) switch_ivr_record_buffer_write(switch_ivr_record_buffer_t *rb, const void *data, switch_size_t datalen)
+{
+	return record_buffer_write((struct record_helper *) rb, data, datalen);
+}
+
+SWITCH_DECLARE(switch_size_t) switch_ivr_record_buffer_read(switch_ivr_record_buffer_t *rb, void *data, switch_size_t datalen)
+{
+	return switch_buffer_read(((struct record_helper *) rb)->thread_buffer, data, datalen);
+}
+
+SWITCH_DECLARE(switch_size_t) switch_ivr_record_buffer_inuse(switch_ivr_record_buffer_t *rb)
+{
+	return switch_buffer_inuse(((struct record_helper *) rb)->thread_buffer);
+}
+
+SWITCH_DECLARE(switch_size_t) switch_ivr_record_buffer_dropped(switch_ivr_record_buffer_t *rb, switch_time_t *warned)
+{
+	struct record_helper *rh = (struct record_helper *) rb;
+
+	if (warned) {
+		*warned = rh->drop_warned;
+	}
+
+	return rh->dropped;
+}
+
+SWITCH_DECLARE(void) switch_ivr_record_buffer_destroy(switch_ivr_record_buffer_t **rbP)
+{
+	struct record_helper *rh = (struct record_helper *) *rbP;
+
+	*rbP = NULL;
+
+	if (rh) {
+		switch_buffer_destroy(&rh->thread_buffer);
+		switch_safe_free(rh->file);
+		free(rh);
+	}
+}
+
+/* queue whatever the session thread put in the buffer, caller holds buffer_mutex */
+static void record_writer_offer(struct record_helper *rh, const void *data, switch_size_t datalen)
+{
+	switch_size_t inuse;
+
+	if (rh->writer_failed) {
+		return;
+	}
+
+	record_buffer_write(rh, data, datalen);
+
+	inuse = switch_buffer_inuse(rh->thread_buffer);
+
+	if (!rh->writer_queued && !rh->writer_closing && record_writer.started && inuse >= RECORD_WRITER_BATCH) {
+		rh->writer_queued = 1;
+		if (switch_queue_trypush(record_writer.queue, rh) != SWITCH_STATUS_SUCCESS) {
+			rh->writer_queued = 0;
+		}
+	}
+}
+
 static void *SWITCH_THREAD_FUNC recording_thread(switch_thread_t *thread, void *obj)
 {
 	switch_media_bug_t *bug = (switch_media_bug_t *) obj;
@@ -1193,7 +1500,7 @@ static void *SWITCH_THREAD_FUNC recording_thread(switch_thread_t *thread, void *
 	}
 
 	rh = switch_core_media_bug_get_user_data(bug);
-	switch_buffer_create_dynamic(&rh->thread_buffer, 1024 * 512, 1024 * 64, 0);
+	switch_buffer_create_dynamic(&rh->thread_buffer, 1024 * 512, 1024 * 64, record_writer.max_buffer);
 	rh->thread_ready = 1;
 
 	channels = switch_core_media_bug_test_flag(bug, SMBF_STEREO) ? 2 : rh->read_impl.number_of_channels;
@@ -1219,9 +1526,12 @@ static void *SWITCH_THREAD_FUNC recording_thread(switch_thread_t *thread, void *
 			break;
 		}
 
-		samples = switch_buffer_read(rh->thread_buffer, data, bsize) / 2 / channels;
+		samples = switch_buffer_read(rh->thread_buffer, data, bsize);
 		switch_mutex_unlock(rh->buffer_mutex);
 
+		__sync_fetch_and_add(&record_writer.bytes_out, (int64_t) samples);
+		samples = samples / 2 / channels;
+
 		if (switch_core_file_write(rh->fh, data, &samples) != SWITCH_STATUS_SUCCESS) {
 			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_ERROR, "Error writing %s\n", rh->file);
 			/* File write failed */
@@ -1254,7 +1564,23 @@ static switch_bool_t record_callback(switch_media_bug_t *bug, void *user_data, s
 		{
 			const char *var = switch_channel_get_variable(channel, "RECORD_USE_THREAD");
 
-			if (!rh->native && rh->fh && (zstr(var) || switch_true(var))) {
+			switch_core_session_get_read_impl(session, &rh->read_impl);
+			rh->session = session;
+			rh->channels = switch_core_media_bug_test_flag(bug, SMBF_STEREO) ? 2 : rh->read_impl.number_of_channels;
+			if (rh->channels < 1) {
+				rh->channels = 1;
+			}
+
+			if (!rh->native && rh->fh && (zstr(var) || switch_true(var)) && record_writer.started && !switch_core_file_has_video(rh->fh, SWITCH_TRUE)) {
+				switch_mutex_init(&rh->buffer_mutex, SWITCH_MUTEX_NESTED, switch_core_session_get_pool(session));
+				switch_thread_cond_create(&rh->writer_cond, switch_core_session_get_pool(session));
+				switch_buffer_create_dynamic(&rh->thread_buffer, RECORD_WRITER_BATCH * 2, RECORD_WRITER_BATCH * 2, record_writer.max_buffer);
+				rh->pooled = 1;
+
+				switch_mutex_lock(record_writer.mutex);
+				record_writer.recordings++;
+				switch_mutex_unlock(record_writer.mutex);
+			} else if (!rh->native && rh->fh && (zstr(var) || switch_true(var))) {
 				switch_threadattr_t *thd_attr = NULL;
 				switch_memory_pool_t *pool = switch_core_session_get_pool(session);
 				int sanity = 200;
@@ -1391,6 +1717,52 @@ static switch_bool_t record_callback(switch_media_bug_t *bug, void *user_data, s
 
 					rh->thread_ready = 0;
 					switch_thread_join(&st, rh->thread);
+
+					if (rh->dropped) {
+						switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_WARNING, "Dropped %" SWITCH_SIZE_T_FMT " bytes of %s, the recording thread could not keep up\n",
+										  rh->dropped, rh->file);
+					}
+				} else if (rh->pooled) {
+					switch_size_t left;
+
+					/* wait for a writer that is busy with this recording, then finish the tail ourselves.
+					   Once the pool is stopped nobody will pop the recording again, so the wait ends there too */
+					switch_mutex_lock(rh->buffer_mutex);
+					rh->writer_closing = 1;
+					while (rh->writer_queued && record_writer.started) {
+						switch_thread_cond_timedwait(rh->writer_cond, rh->buffer_mutex, 100000);
+					}
+					rh->writer_queued = 0;
+					switch_mutex_unlock(rh->buffer_mutex);
+
+					while (!rh->writer_failed && (left = switch_buffer_read(rh->thread_buffer, data, sizeof(data) - (sizeof(data) % (2 * rh->channels))))) {
+						__sync_fetch_and_add(&record_writer.bytes_out, (int64_t) left);
+						len = left / 2 / rh->channels;
+
+						if (switch_core_file_write(rh->fh, data, &len) != SWITCH_STATUS_SUCCESS) {
+							record_write_failed(rh);
+						}
+					}
+
+					__sync_fetch_and_add(&record_writer.bytes_out, (int64_t) switch_buffer_inuse(rh->thread_buffer));
+
+					if (rh->dropped) {
+						switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_WARNING, "Dropped %" SWITCH_SIZE_T_FMT " bytes of %s, the recording writers could not keep up\n",
+										  rh->dropped, rh->file);
+					}
+
+					switch_mutex_lock(record_writer.mutex);
+					record_writer.recordings--;
+					switch_mutex_unlock(record_writer.mutex);
+
+					if (rh->writer_failed) {
+						if (rh->hangup_on_error) {
+							switch_core_session_reset(session, SWITCH_TRUE, SWITCH_TRUE);
+						}
+						switch_buffer_destroy(&rh->thread_buffer);
+						send_record_stop_event(channel, &read_impl, rh);
+						return SWITCH_FALSE;
+					}
 				}
 
 				if (rh->thread_buffer) {
@@ -1504,9 +1876,20 @@ static switch_bool_t record_callback(switch_media_bug_t *bug, void *user_data, s
 				} else {
 					len = (switch_size_t) frame.datalen / 2 / frame.channels;
 
-					if (rh->thread_buffer) {
+					if (rh->pooled) {
+						if (rh->writer_failed) {
+							if (rh->hangup_on_error) {
+								switch_core_session_reset(session, SWITCH_TRUE, SWITCH_TRUE);
+							}
+							return SWITCH_FALSE;
+						}
+
+						switch_mutex_lock(rh->buffer_mutex);
+						record_writer_offer(rh, mask ? null_data : data, frame.datalen);
+						switch_mutex_unlock(rh->buffer_mutex);
+					} else if (rh->thread_buffer) {
 						switch_mutex_lock(rh->buffer_mutex);
-						switch_buffer_write(rh->thread_buffer, mask ? null_data : data, frame.datalen);
+						record_buffer_write(rh, mask ? null_data : data, frame.datalen);
 						switch_mutex_unlock(rh->buffer_mutex);
 					} else if (switch_core_file_write(rh->fh, mask ? null_data : data, &len) != SWITCH_STATUS_SUCCESS) {
 						switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_ERROR, "Error writing %s\n", rh->file);
@@ -1708,6 +2091,10 @@ static void* switch_ivr_record_user_data_dup(switch_core_session_t *session, voi
 	dup->file = switch_core_session_strdup(session, rh->file);
 	dup->fh = switch_core_session_alloc(session, sizeof(switch_file_handle_t));
 	memcpy(dup->fh, rh->fh, sizeof(switch_file_handle_t));
+	dup->thread_buffer = NULL;
+	dup->writer_cond = NULL;
+	dup->pooled = dup->writer_queued = dup->writer_closing = 0;
+	dup->dropped = 0;
 
 	return dup;
 }
@@ -0,0 +1,340 @@
+/*
+ * FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ * Copyright (C) 2005-2014, Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Version: MPL 1.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ *
+ * The Initial Developer of the Original Code is
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Portions created by the Initial Developer are Copyright (C)
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Anthony Minessale II <anthm@freeswitch.org>
+ *
+ *
+ * switch_lfqueue.c -- Lock free bounded queues
+ *
+ */
+
+#include <switch.h>
+
+#define LF_CACHE_LINE 64
+
+#ifdef _MSC_VER
+/* msvc volatile accesses are acquire/release */
+#define lf_load(_p) (*(_p))
+#define lf_load_relaxed(_p) (*(_p))
+#define lf_store(_p, _v) (*(_p) = (_v))
+#define lf_fence() MemoryBarrier()
+#define lf_add(_p, _v) InterlockedExchangeAdd((volatile LONG *) (_p), (LONG) (_v))
+static __inline int lf_cas(volatile uint32_t *p, uint32_t old, uint32_t new)
+{
+	return (uint32_t) InterlockedCompareExchange((volatile LONG *) p, (LONG) new, (LONG) old) == old;
+}
+#else
+#define lf_load(_p) __atomic_load_n(_p, __ATOMIC_ACQUIRE)
+#define lf_load_relaxed(_p) __atomic_load_n(_p, __ATOMIC_RELAXED)
+#define lf_store(_p, _v) __atomic_store_n(_p, _v, __ATOMIC_RELEASE)
+#define lf_fence() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define lf_add(_p, _v) __atomic_fetch_add(_p, _v, __ATOMIC_SEQ_CST)
+static inline int lf_cas(volatile uint32_t *p, uint32_t old, uint32_t new)
+{
+	return __atomic_compare_exchange_n(p, &old, new, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+#endif
+
+/* where a consumer sleeps when it asked to wait, producers only look at waiters */
+typedef struct {
+	volatile int32_t waiters;
+	switch_mutex_t *mutex;
+	switch_thread_cond_t *cond;
+} lf_park_t;
+
+typedef struct {
+	volatile uint32_t seq;
+	void *data;
+} lf_cell_t;
+
+struct switch_mpsc_queue {
+	lf_cell_t *cells;
+	uint32_t mask;
+	char pad0[LF_CACHE_LINE];
+	volatile uint32_t enqueue_pos;
+	char pad1[LF_CACHE_LINE];
+	volatile uint32_t dequeue_pos;
+	char pad2[LF_CACHE_LINE];
+	lf_park_t park;
+};
+
+struct switch_spsc_queue {
+	void **slots;
+	uint32_t mask;
+	char pad0[LF_CACHE_LINE];
+	volatile uint32_t tail;
+	char pad1[LF_CACHE_LINE];
+	volatile uint32_t head;
+	char pad2[LF_CACHE_LINE];
+	lf_park_t park;
+};
+
+static uint32_t lf_capacity(uint32_t capacity)
+{
+	uint32_t size = 2;
+
+	while (size < capacity && size < 0x40000000) {
+		size <<= 1;
+	}
+
+	return size;
+}
+
+static void lf_park_init(lf_park_t *park, switch_memory_pool_t *pool)
+{
+	switch_mutex_init(&park->mutex, SWITCH_MUTEX_NESTED, pool);
+	switch_thread_cond_create(&park->cond, pool);
+}
+
+static void lf_wake(lf_park_t *park)
+{
+	/* the push has to be visible before we look at waiters, pairs with the fence in lf_park */
+	lf_fence();
+
+	if (lf_load_relaxed(&park->waiters)) {
+		switch_mutex_lock(park->mutex);
+		switch_thread_cond_signal(park->cond);
+		switch_mutex_unlock(park->mutex);
+	}
+}
+
+typedef switch_status_t (*lf_trypop_t)(void *queue, void **data);
+
+static switch_status_t lf_park(lf_park_t *park, lf_trypop_t trypop, void *queue, void **data, switch_interval_time_t timeout)
+{
+	switch_time_t deadline = switch_micro_time_now() + timeout;
+	switch_status_t status;
+
+	while ((status = trypop(queue, data)) != SWITCH_STATUS_SUCCESS) {
+		switch_interval_time_t left = deadline - switch_micro_time_now();
+
+		if (left <= 0) {
+			return SWITCH_STATUS_TIMEOUT;
+		}
+
+		switch_mutex_lock(park->mutex);
+		lf_add(&park->waiters, 1);
+
+		/* anything pushed before the producer could see us waiting */
+		if ((status = trypop(queue, data)) != SWITCH_STATUS_SUCCESS) {
+			switch_thread_cond_timedwait(park->cond, park->mutex, left);
+		}
+
+		lf_add(&park->waiters, -1);
+		switch_mutex_unlock(park->mutex);
+
+		if (status == SWITCH_STATUS_SUCCESS) {
+			break;
+		}
+	}
+
+	return status;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_mpsc_queue_create(switch_mpsc_queue_t **queue, uint32_t capacity, switch_memory_pool_t *pool)
+{
+	switch_mpsc_queue_t *q;
+	uint32_t i, size = lf_capacity(capacity);
+
+	q = switch_core_alloc(pool, sizeof(*q));
+	q->cells = switch_core_alloc(pool, sizeof(lf_cell_t) * size);
+	q->mask = size - 1;
+
+	for (i = 0; i < size; i++) {
+		q->cells[i].seq = i;
+	}
+
+	lf_park_init(&q->park, pool);
+
+	*queue = q;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+/* every cell carries the position it is next good for, so producers claim cells with one cas
+   and the consumer can tell a claimed but not yet filled cell from a filled one */
+SWITCH_DECLARE(switch_status_t) switch_mpsc_queue_trypush(switch_mpsc_queue_t *queue, void *data)
+{
+	lf_cell_t *cell;
+	uint32_t pos = lf_load_relaxed(&queue->enqueue_pos);
+
+	for (;;) {
+		int32_t diff;
+
+		cell = &queue->cells[pos & queue->mask];
+		diff = (int32_t) (lf_load(&cell->seq) - pos);
+
+		if (diff == 0) {
+			if (lf_cas(&queue->enqueue_pos, pos, pos + 1)) {
+				break;
+			}
+			pos = lf_load_relaxed(&queue->enqueue_pos);
+		} else if (diff < 0) {
+			return SWITCH_STATUS_FALSE;
+		} else {
+			pos = lf_load_relaxed(&queue->enqueue_pos);
+		}
+	}
+
+	cell->data = data;
+	lf_store(&cell->seq, pos + 1);
+
+	lf_wake(&queue->park);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_mpsc_queue_push(switch_mpsc_queue_t *queue, void *data)
+{
+	while (switch_mpsc_queue_trypush(queue, data) != SWITCH_STATUS_SUCCESS) {
+		switch_cond_next();
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_mpsc_queue_trypop(switch_mpsc_queue_t *queue, void **data)
+{
+	lf_cell_t *cell;
+	uint32_t pos = lf_load_relaxed(&queue->dequeue_pos);
+
+	for (;;) {
+		int32_t diff;
+
+		cell = &queue->cells[pos & queue->mask];
+		diff = (int32_t) (lf_load(&cell->seq) - (pos + 1));
+
+		if (diff == 0) {
+			if (lf_cas(&queue->dequeue_pos, pos, pos + 1)) {
+				break;
+			}
+			pos = lf_load_relaxed(&queue->dequeue_pos);
+		} else if (diff < 0) {
+			return SWITCH_STATUS_FALSE;
+		} else {
+			pos = lf_load_relaxed(&queue->dequeue_pos);
+		}
+	}
+
+	*data = cell->data;
+	lf_store(&cell->seq, pos + queue->mask + 1);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t mpsc_trypop(void *queue, void **data)
+{
+	return switch_mpsc_queue_trypop((switch_mpsc_queue_t *) queue, data);
+}
+
+SWITCH_DECLARE(switch_status_t) switch_mpsc_queue_pop_timeout(switch_mpsc_queue_t *queue, void **data, switch_interval_time_t timeout)
+{
+	return lf_park(&queue->park, mpsc_trypop, queue, data, timeout);
+}
+
+SWITCH_DECLARE(uint32_t) switch_mpsc_queue_size(switch_mpsc_queue_t *queue)
+{
+	uint32_t out = lf_load_relaxed(&queue->dequeue_pos);
+	uint32_t in = lf_load_relaxed(&queue->enqueue_pos);
+	int32_t size = (int32_t) (in - out);
+
+	if (size < 0) {
+		return 0;
+	}
+
+	return (uint32_t) size > queue->mask + 1 ? queue->mask + 1 : (uint32_t) size;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_spsc_queue_create(switch_spsc_queue_t **queue, uint32_t capacity, switch_memory_pool_t *pool)
+{
+	switch_spsc_queue_t *q;
+	uint32_t size = lf_capacity(capacity);
+
+	q = switch_core_alloc(pool, sizeof(*q));
+	q->slots = switch_core_alloc(pool, sizeof(void *) * size);
+	q->mask = size - 1;
+
+	lf_park_init(&q->park, pool);
+
+	*queue = q;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_spsc_queue_trypush(switch_spsc_queue_t *queue, void *data)
+{
+	uint32_t tail = lf_load_relaxed(&queue->tail);
+
+	if (tail - lf_load(&queue->head) > queue->mask) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	queue->slots[tail & queue->mask] = data;
+	lf_store(&queue->tail, tail + 1);
+
+	lf_wake(&queue->park);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_spsc_queue_trypop(switch_spsc_queue_t *queue, void **data)
+{
+	uint32_t head = lf_load_relaxed(&queue->head);
+
+	if (head == lf_load(&queue->tail)) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	*data = queue->slots[head & queue->mask];
+	lf_store(&queue->head, head + 1);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t spsc_trypop(void *queue, void **data)
+{
+	return switch_spsc_queue_trypop((switch_spsc_queue_t *) queue, data);
+}
+
+SWITCH_DECLARE(switch_status_t) switch_spsc_queue_pop_timeout(switch_spsc_queue_t *queue, void **data, switch_interval_time_t timeout)
+{
+	return lf_park(&queue->park, spsc_trypop, queue, data, timeout);
+}
+
+SWITCH_DECLARE(uint32_t) switch_spsc_queue_size(switch_spsc_queue_t *queue)
+{
+	return lf_load_relaxed(&queue->tail) - lf_load_relaxed(&queue->head);
+}
+
+/* For Emacs:
+ * Local Variables:
+ * mode:c
+ * indent-tabs-mode:t
+ * tab-width:4
+ * c-basic-offset:4
+ * End:
+ * For VIM:
+ * vim:set softtabstop=4 shiftwidth=4 tabstop=4 noet:
+ */
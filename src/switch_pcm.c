@@ -154,9 +154,8 @@ static switch_status_t switch_g711u_encode(switch_codec_t *codec,
 	dbuf = decoded_data;
 	ebuf = encoded_data;
 
-	for (i = 0; i < decoded_data_len / sizeof(short); i++) {
-		ebuf[i] = linear_to_ulaw(dbuf[i]);
-	}
+	i = decoded_data_len / sizeof(short);
+	linear_to_ulaw_block(ebuf, dbuf, i);
 
 	*encoded_data_len = i;
 
@@ -172,7 +171,6 @@ static switch_status_t switch_g711u_decode(switch_codec_t *codec,
 {
 	short *dbuf;
 	unsigned char *ebuf;
-	uint32_t i;
 
 	dbuf = decoded_data;
 	ebuf = encoded_data;
@@ -181,11 +179,9 @@ static switch_status_t switch_g711u_decode(switch_codec_t *codec,
 		memset(dbuf, 0, codec->implementation->decoded_bytes_per_packet);
 		*decoded_data_len = codec->implementation->decoded_bytes_per_packet;
 	} else {
-		for (i = 0; i < encoded_data_len; i++) {
-			dbuf[i] = ulaw_to_linear(ebuf[i]);
-		}
+		ulaw_to_linear_block(dbuf, ebuf, encoded_data_len);
 
-		*decoded_data_len = i * 2;
+		*decoded_data_len = encoded_data_len * 2;
 	}
 
 	return SWITCH_STATUS_SUCCESS;
@@ -225,9 +221,8 @@ static switch_status_t switch_g711a_encode(switch_codec_t *codec,
 	dbuf = decoded_data;
 	ebuf = encoded_data;
 
-	for (i = 0; i < decoded_data_len / sizeof(short); i++) {
-		ebuf[i] = linear_to_alaw(dbuf[i]);
-	}
+	i = decoded_data_len / sizeof(short);
+	linear_to_alaw_block(ebuf, dbuf, i);
 
 	*encoded_data_len = i;
 
@@ -243,7 +238,6 @@ static switch_status_t switch_g711a_decode(switch_codec_t *codec,
 {
 	short *dbuf;
 	unsigned char *ebuf;
-	uint32_t i;
 
 	dbuf = decoded_data;
 	ebuf = encoded_data;
@@ -252,11 +246,9 @@ static switch_status_t switch_g711a_decode(switch_codec_t *codec,
 		memset(dbuf, 0, codec->implementation->decoded_bytes_per_packet);
 		*decoded_data_len = codec->implementation->decoded_bytes_per_packet;
 	} else {
-		for (i = 0; i < encoded_data_len; i++) {
-			dbuf[i] = alaw_to_linear(ebuf[i]);
-		}
+		alaw_to_linear_block(dbuf, ebuf, encoded_data_len);
 
-		*decoded_data_len = i * 2;
+		*decoded_data_len = encoded_data_len * 2;
 	}
 
 	return SWITCH_STATUS_SUCCESS;
@@ -267,6 +259,24 @@ static switch_status_t switch_g711a_destroy(switch_codec_t *codec)
 	return SWITCH_STATUS_SUCCESS;
 }
 
+SWITCH_DECLARE(switch_status_t) switch_core_codec_g711_transcode(const switch_codec_implementation_t *from, const switch_codec_implementation_t *to,
+																 const void *in, void *out, uint32_t len)
+{
+	if (from->number_of_channels != 1 || to->number_of_channels != 1) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	if (from->ianacode == 0 && to->ianacode == 8) {
+		ulaw_to_alaw_block(out, in, len);
+	} else if (from->ianacode == 8 && to->ianacode == 0) {
+		alaw_to_ulaw_block(out, in, len);
+	} else {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 
 static void mod_g711_load(switch_loadable_module_interface_t ** module_interface, switch_memory_pool_t *pool)
 {
@@ -33,6 +33,318 @@
 #include <switch.h>
 #include <pcre.h>
 
+/*
+ * Compiled pattern cache
+ *
+ * Dialplans run the same few hundred expressions on every call, so compiled (and studied)
+ * patterns are kept in a bounded LRU keyed by options and expression.  Entries are shared
+ * read only between threads; a caller that needs its own switch_regex_t after a match gets
+ * a copy of the compiled block, which is position independent and cheap to duplicate.
+ */
+
+#define REGEX_CACHE_DEFAULT_SIZE 1024
+
+typedef struct regex_cache_entry_s {
+	char *key;
+	pcre *re;
+	pcre_extra *extra;
+	size_t size;
+	uint32_t refs;
+	uint8_t evicted;
+	struct regex_cache_entry_s *prev;
+	struct regex_cache_entry_s *next;
+} regex_cache_entry_t;
+
+static struct {
+	switch_mutex_t *mutex;
+	switch_hash_t *hash;
+	regex_cache_entry_t *head;
+	regex_cache_entry_t *tail;
+	uint32_t count;
+	uint32_t max;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+} regex_cache = { NULL, NULL, NULL, NULL, 0, REGEX_CACHE_DEFAULT_SIZE, 0, 0, 0 };
+
+static void regex_entry_free(regex_cache_entry_t *entry)
+{
+	if (entry->extra) {
+#ifdef PCRE_STUDY_JIT_COMPILE
+		pcre_free_study(entry->extra);
+#else
+		pcre_free(entry->extra);
+#endif
+	}
+	pcre_free(entry->re);
+	free(entry->key);
+	free(entry);
+}
+
+static void regex_entry_unlink(regex_cache_entry_t *entry)
+{
+	if (entry->prev) {
+		entry->prev->next = entry->next;
+	} else {
+		regex_cache.head = entry->next;
+	}
+
+	if (entry->next) {
+		entry->next->prev = entry->prev;
+	} else {
+		regex_cache.tail = entry->prev;
+	}
+
+	entry->prev = entry->next = NULL;
+}
+
+static void regex_entry_push(regex_cache_entry_t *entry)
+{
+	entry->prev = NULL;
+	entry->next = regex_cache.head;
+
+	if (regex_cache.head) {
+		regex_cache.head->prev = entry;
+	}
+
+	regex_cache.head = entry;
+
+	if (!regex_cache.tail) {
+		regex_cache.tail = entry;
+	}
+}
+
+/* must be called with the mutex held */
+static void regex_entry_evict(regex_cache_entry_t *entry)
+{
+	regex_entry_unlink(entry);
+	switch_core_hash_delete(regex_cache.hash, entry->key);
+	regex_cache.count--;
+	regex_cache.evictions++;
+
+	if (entry->refs) {
+		entry->evicted = 1;
+	} else {
+		regex_entry_free(entry);
+	}
+}
+
+static regex_cache_entry_t *regex_entry_compile(const char *key, const char *expression, int flags)
+{
+	regex_cache_entry_t *entry;
+	const char *error = NULL;
+	int erroffset = 0;
+	pcre *re;
+
+	re = pcre_compile(expression, flags, &error, &erroffset, NULL);
+
+	if (error) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "COMPILE ERROR: %d [%s][%s]\n", erroffset, error, expression);
+		if (re) {
+			pcre_free(re);
+		}
+		return NULL;
+	}
+
+	switch_zmalloc(entry, sizeof(*entry));
+	entry->key = strdup(key);
+	entry->re = re;
+	pcre_fullinfo(re, NULL, PCRE_INFO_SIZE, &entry->size);
+
+#ifdef PCRE_STUDY_JIT_COMPILE
+	entry->extra = pcre_study(re, PCRE_STUDY_JIT_COMPILE, &error);
+#else
+	entry->extra = pcre_study(re, 0, &error);
+#endif
+
+	return entry;
+}
+
+/* the jit code runs on a small fixed stack a deep backtrack can run out of, that is not a miss,
+   so run it again the way the interpreter always did before the jit was used */
+static int regex_entry_exec(regex_cache_entry_t *entry, const char *subject, int options, int *ovector, int olen)
+{
+	int rc = pcre_exec(entry->re, entry->extra, subject, (int) strlen(subject), 0, options, ovector, olen);
+
+#ifdef PCRE_ERROR_JIT_STACKLIMIT
+	if (rc == PCRE_ERROR_JIT_STACKLIMIT) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "JIT stack exhausted matching [%s], using the interpreter\n", entry->key);
+		rc = pcre_exec(entry->re, NULL, subject, (int) strlen(subject), 0, options, ovector, olen);
+	}
+#endif
+
+	if (rc < 0 && rc != PCRE_ERROR_NOMATCH && rc != PCRE_ERROR_PARTIAL && rc != PCRE_ERROR_BADPARTIAL) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Regular Expression Error %d matching [%s]\n", rc, entry->key);
+	}
+
+	return rc;
+}
+
+/* returns a referenced entry, release it with regex_cache_put() */
+static regex_cache_entry_t *regex_cache_get(const char *expression, int flags)
+{
+	regex_cache_entry_t *entry = NULL;
+	char kbuf[512];
+	char *key = kbuf;
+
+	if (switch_snprintf(kbuf, sizeof(kbuf), "%x:%s", flags, expression) >= (int) sizeof(kbuf) - 1) {
+		key = switch_mprintf("%x:%s", flags, expression);
+	}
+
+	if (!regex_cache.mutex || !regex_cache.max) {
+		if ((entry = regex_entry_compile(key, expression, flags))) {
+			entry->refs = 1;
+			entry->evicted = 1;
+		}
+		goto end;
+	}
+
+	switch_mutex_lock(regex_cache.mutex);
+	if ((entry = switch_core_hash_find(regex_cache.hash, key))) {
+		regex_cache.hits++;
+		entry->refs++;
+		regex_entry_unlink(entry);
+		regex_entry_push(entry);
+	} else {
+		regex_cache.misses++;
+	}
+	switch_mutex_unlock(regex_cache.mutex);
+
+	if (entry) {
+		goto end;
+	}
+
+	/* compile outside the lock, if another thread beat us to it we simply use theirs */
+	if (!(entry = regex_entry_compile(key, expression, flags))) {
+		goto end;
+	}
+
+	switch_mutex_lock(regex_cache.mutex);
+	{
+		regex_cache_entry_t *exists;
+
+		if ((exists = switch_core_hash_find(regex_cache.hash, key))) {
+			regex_entry_free(entry);
+			entry = exists;
+		} else {
+			while (regex_cache.count >= regex_cache.max && regex_cache.tail) {
+				regex_entry_evict(regex_cache.tail);
+			}
+			switch_core_hash_insert(regex_cache.hash, entry->key, entry);
+			regex_entry_push(entry);
+			regex_cache.count++;
+		}
+		entry->refs++;
+	}
+	switch_mutex_unlock(regex_cache.mutex);
+
+  end:
+
+	if (key != kbuf) {
+		free(key);
+	}
+
+	return entry;
+}
+
+static void regex_cache_put(regex_cache_entry_t *entry)
+{
+	int done;
+
+	if (regex_cache.mutex) {
+		switch_mutex_lock(regex_cache.mutex);
+	}
+
+	done = (--entry->refs == 0 && entry->evicted);
+
+	if (regex_cache.mutex) {
+		switch_mutex_unlock(regex_cache.mutex);
+	}
+
+	if (done) {
+		regex_entry_free(entry);
+	}
+}
+
+/* a private copy of the compiled pattern for callers that own (and free) the switch_regex_t */
+static switch_regex_t *regex_entry_copy(regex_cache_entry_t *entry)
+{
+	pcre *re;
+
+	if (!(re = pcre_malloc(entry->size))) {
+		return NULL;
+	}
+
+	memcpy(re, entry->re, entry->size);
+
+	return (switch_regex_t *) re;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_regex_init(switch_memory_pool_t *pool)
+{
+	switch_mutex_init(&regex_cache.mutex, SWITCH_MUTEX_NESTED, pool);
+	switch_core_hash_init(&regex_cache.hash);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(void) switch_regex_shutdown(void)
+{
+	switch_mutex_t *mutex = regex_cache.mutex;
+
+	if (!mutex) {
+		return;
+	}
+
+	switch_mutex_lock(mutex);
+	while (regex_cache.tail) {
+		regex_entry_evict(regex_cache.tail);
+	}
+	switch_core_hash_destroy(&regex_cache.hash);
+	regex_cache.mutex = NULL;
+	switch_mutex_unlock(mutex);
+}
+
+SWITCH_DECLARE(void) switch_regex_set_cache_size(uint32_t size)
+{
+	if (regex_cache.mutex) {
+		switch_mutex_lock(regex_cache.mutex);
+	}
+
+	regex_cache.max = size;
+
+	while (regex_cache.count > regex_cache.max && regex_cache.tail) {
+		regex_entry_evict(regex_cache.tail);
+	}
+
+	if (regex_cache.mutex) {
+		switch_mutex_unlock(regex_cache.mutex);
+	}
+}
+
+SWITCH_DECLARE(void) switch_regex_cache_status(switch_stream_handle_t *stream)
+{
+	uint64_t hits, misses, evictions;
+	uint32_t count, max;
+
+	if (!regex_cache.mutex) {
+		stream->write_function(stream, "Regex cache not running\n");
+		return;
+	}
+
+	switch_mutex_lock(regex_cache.mutex);
+	hits = regex_cache.hits;
+	misses = regex_cache.misses;
+	evictions = regex_cache.evictions;
+	count = regex_cache.count;
+	max = regex_cache.max;
+	switch_mutex_unlock(regex_cache.mutex);
+
+	stream->write_function(stream, "entries,max,hits,misses,evictions,hit_rate\n");
+	stream->write_function(stream, "%u,%u,%" SWITCH_UINT64_T_FMT ",%" SWITCH_UINT64_T_FMT ",%" SWITCH_UINT64_T_FMT ",%.2f%%\n",
+						   count, max, hits, misses, evictions, (hits + misses) ? (double) hits * 100 / (double) (hits + misses) : 0.0);
+}
+
 SWITCH_DECLARE(switch_regex_t *) switch_regex_compile(const char *pattern,
 													  int options, const char **errorptr, int *erroroffset, const unsigned char *tables)
 {
@@ -54,14 +366,15 @@ SWITCH_DECLARE(void) switch_regex_free(void *data)
 
 SWITCH_DECLARE(int) switch_regex_perform(const char *field, const char *expression, switch_regex_t **new_re, int *ovector, uint32_t olen)
 {
-	const char *error = NULL;
-	int erroffset = 0;
-	pcre *re = NULL;
+	regex_cache_entry_t *entry = NULL;
 	int match_count = 0;
 	char *tmp = NULL;
 	uint32_t flags = 0;
 	char abuf[256] = "";
 
+	/* callers free whatever they get back, even after a miss */
+	*new_re = NULL;
+
 	if (!(field && expression)) {
 		return 0;
 	}
@@ -95,33 +408,20 @@ SWITCH_DECLARE(int) switch_regex_perform(const char *field, const char *expressi
 		}
 	}
 
-	re = pcre_compile(expression,	/* the pattern */
-					  flags,	/* default options */
-					  &error,	/* for error message */
-					  &erroffset,	/* for error offset */
-					  NULL);	/* use default character tables */
-	if (error) {
-		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "COMPILE ERROR: %d [%s][%s]\n", erroffset, error, expression);
-		switch_regex_safe_free(re);
+	if (!(entry = regex_cache_get(expression, flags))) {
 		goto end;
 	}
 
-	match_count = pcre_exec(re,	/* result of pcre_compile() */
-							NULL,	/* we didn't study the pattern */
-							field,	/* the subject string */
-							(int) strlen(field),	/* the length of the subject string */
-							0,	/* start at offset 0 in the subject */
-							0,	/* default options */
-							ovector,	/* vector of integers for substring information */
-							olen);	/* number of elements (NOT size in bytes) */
+	match_count = regex_entry_exec(entry, field, 0, ovector, olen);
 
 
 	if (match_count <= 0) {
-		switch_regex_safe_free(re);
 		match_count = 0;
+	} else {
+		*new_re = regex_entry_copy(entry);
 	}
 
-	*new_re = (switch_regex_t *) re;
+	regex_cache_put(entry);
 
   end:
 	switch_safe_free(tmp);
@@ -214,9 +514,7 @@ SWITCH_DECLARE(void) switch_capture_regex(switch_regex_t *re, int match_count, c
 
 SWITCH_DECLARE(switch_status_t) switch_regex_match_partial(const char *target, const char *expression, int *partial)
 {
-	const char *error = NULL;	/* Used to hold any errors                                           */
-	int error_offset = 0;		/* Holds the offset of an error                                      */
-	pcre *pcre_prepared = NULL;	/* Holds the compiled regex                                          */
+	regex_cache_entry_t *entry = NULL;	/* Holds the compiled regex                                  */
 	int match_count = 0;		/* Number of times the regex was matched                             */
 	int offset_vectors[255];	/* not used, but has to exist or pcre won't even try to find a match */
 	int pcre_flags = 0;
@@ -247,20 +545,8 @@ SWITCH_DECLARE(switch_status_t) switch_regex_match_partial(const char *target, c
 		}
 	}
 
-	/* Compile the expression */
-	pcre_prepared = pcre_compile(expression, flags, &error, &error_offset, NULL);
-
-	/* See if there was an error in the expression */
-	if (error != NULL) {
-		/* Clean up after ourselves */
-		if (pcre_prepared) {
-			pcre_free(pcre_prepared);
-			pcre_prepared = NULL;
-		}
-		/* Note our error */
-		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
-						  "Regular Expression Error expression[%s] error[%s] location[%d]\n", expression, error, error_offset);
-
+	/* Compile the expression, or find it already compiled; errors are logged there */
+	if (!(entry = regex_cache_get(expression, flags))) {
 		/* We definitely didn't match anything */
 		goto end;
 	}
@@ -269,16 +555,16 @@ SWITCH_DECLARE(switch_status_t) switch_regex_match_partial(const char *target, c
 		pcre_flags = PCRE_PARTIAL;
 	}
 
-	/* So far so good, run the regex */
-	match_count =
-		pcre_exec(pcre_prepared, NULL, target, (int) strlen(target), 0, pcre_flags, offset_vectors, sizeof(offset_vectors) / sizeof(offset_vectors[0]));
-
-	/* Clean up */
-	if (pcre_prepared) {
-		pcre_free(pcre_prepared);
-		pcre_prepared = NULL;
+	/* So far so good, run the regex, the jit code is only good for complete matches */
+	if (*partial) {
+		match_count = pcre_exec(entry->re, NULL, target, (int) strlen(target), 0, pcre_flags, offset_vectors,
+								sizeof(offset_vectors) / sizeof(offset_vectors[0]));
+	} else {
+		match_count = regex_entry_exec(entry, target, pcre_flags, offset_vectors, sizeof(offset_vectors) / sizeof(offset_vectors[0]));
 	}
 
+	regex_cache_put(entry);
+
 	/* switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "number of matches: %d\n", match_count); */
 
 	/* Was it a match made in heaven? */
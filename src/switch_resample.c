@@ -32,6 +32,7 @@
 
 #include <switch.h>
 #include <switch_resample.h>
+#include "private/switch_core_pvt.h"
 #ifndef WIN32
 #include <switch_private.h>
 #endif
@@ -42,6 +43,10 @@
 #define MAXSAMPLEC (char)0x7F
 #define QUALITY 0
 
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
 #ifndef MIN
 #define MIN(a,b) ((a) < (b) ? (a) : (b))
 #endif
@@ -52,6 +57,178 @@
 
 #define resample_buffer(a, b, c) a > b ? ((a / 1000) / 2) * c : ((b / 1000) / 2) * c
 
+/* Resamplers are created and destroyed with every call that needs one, so idle handles are kept in a pool
+   keyed by rate, channels and quality and reset on reuse instead of being built from scratch each time. */
+
+#define RESAMPLE_POOL_KEYS 32
+#define RESAMPLE_POOL_MAX_IDLE 64
+
+typedef struct resample_polyphase_s resample_polyphase_t;
+
+static resample_polyphase_t *resample_polyphase_create(uint32_t from_rate, uint32_t to_rate, int quality);
+static void resample_polyphase_reset(resample_polyphase_t *pp);
+static uint32_t resample_polyphase_process(resample_polyphase_t *pp, const int16_t *src, uint32_t srclen, int16_t *dst);
+static void resample_polyphase_destroy(resample_polyphase_t *pp);
+
+typedef struct {
+	int from_rate;
+	int to_rate;
+	int channels;
+	int quality;
+	uint32_t idle;
+	switch_audio_resampler_t *head;
+} resample_pool_key_t;
+
+static struct {
+	switch_mutex_t *mutex;
+	int running;
+	switch_bool_t no_polyphase;
+	resample_pool_key_t keys[RESAMPLE_POOL_KEYS];
+	int nkeys;
+	uint32_t idle;
+	uint64_t hits;
+	uint64_t misses;
+} resample_pool;
+
+static switch_audio_resampler_t *resample_pool_get(uint32_t from_rate, uint32_t to_rate, uint32_t channels, int quality)
+{
+	switch_audio_resampler_t *resampler = NULL;
+	int i;
+
+	if (!resample_pool.running) {
+		return NULL;
+	}
+
+	switch_mutex_lock(resample_pool.mutex);
+	for (i = 0; i < resample_pool.nkeys; i++) {
+		resample_pool_key_t *key = &resample_pool.keys[i];
+
+		if (key->from_rate == (int) from_rate && key->to_rate == (int) to_rate && key->channels == (int) channels && key->quality == quality) {
+			if ((resampler = key->head)) {
+				key->head = resampler->next;
+				key->idle--;
+				resample_pool.idle--;
+			}
+			break;
+		}
+	}
+
+	if (resampler) {
+		resample_pool.hits++;
+	} else {
+		resample_pool.misses++;
+	}
+	switch_mutex_unlock(resample_pool.mutex);
+
+	return resampler;
+}
+
+static switch_bool_t resample_pool_put(switch_audio_resampler_t *resampler)
+{
+	resample_pool_key_t *key = NULL;
+	switch_bool_t kept = SWITCH_FALSE;
+	int i;
+
+	if (!resample_pool.running) {
+		return SWITCH_FALSE;
+	}
+
+	switch_mutex_lock(resample_pool.mutex);
+	for (i = 0; i < resample_pool.nkeys; i++) {
+		if (resample_pool.keys[i].from_rate == resampler->from_rate && resample_pool.keys[i].to_rate == resampler->to_rate &&
+			resample_pool.keys[i].channels == resampler->channels && resample_pool.keys[i].quality == resampler->quality) {
+			key = &resample_pool.keys[i];
+			break;
+		}
+	}
+
+	if (!key && resample_pool.nkeys < RESAMPLE_POOL_KEYS) {
+		key = &resample_pool.keys[resample_pool.nkeys++];
+		key->from_rate = resampler->from_rate;
+		key->to_rate = resampler->to_rate;
+		key->channels = resampler->channels;
+		key->quality = resampler->quality;
+	}
+
+	if (resample_pool.running && key && key->idle < RESAMPLE_POOL_MAX_IDLE) {
+		resampler->next = key->head;
+		key->head = resampler;
+		key->idle++;
+		resample_pool.idle++;
+		kept = SWITCH_TRUE;
+	}
+	switch_mutex_unlock(resample_pool.mutex);
+
+	return kept;
+}
+
+static void resample_free(switch_audio_resampler_t *resampler)
+{
+	if (resampler->resampler) {
+		speex_resampler_destroy(resampler->resampler);
+	}
+	if (resampler->polyphase) {
+		resample_polyphase_destroy(resampler->polyphase);
+	}
+	free(resampler->to);
+	free(resampler);
+}
+
+void switch_resample_pool_init(switch_memory_pool_t *pool)
+{
+	switch_mutex_init(&resample_pool.mutex, SWITCH_MUTEX_NESTED, pool);
+	resample_pool.running = 1;
+}
+
+static void resample_pool_flush(void)
+{
+	int i;
+
+	for (i = 0; i < resample_pool.nkeys; i++) {
+		switch_audio_resampler_t *resampler;
+
+		while ((resampler = resample_pool.keys[i].head)) {
+			resample_pool.keys[i].head = resampler->next;
+			resample_free(resampler);
+		}
+
+		resample_pool.keys[i].idle = 0;
+	}
+
+	resample_pool.nkeys = 0;
+	resample_pool.idle = 0;
+}
+
+void switch_resample_pool_shutdown(void)
+{
+	if (!resample_pool.running) {
+		return;
+	}
+
+	switch_mutex_lock(resample_pool.mutex);
+	resample_pool.running = 0;
+	resample_pool_flush();
+	switch_mutex_unlock(resample_pool.mutex);
+}
+
+SWITCH_DECLARE(void) switch_resample_set_polyphase(switch_bool_t enabled)
+{
+	if (resample_pool.running) switch_mutex_lock(resample_pool.mutex);
+	resample_pool.no_polyphase = !enabled;
+	/* idle handles were built for the old setting */
+	resample_pool_flush();
+	if (resample_pool.running) switch_mutex_unlock(resample_pool.mutex);
+}
+
+SWITCH_DECLARE(void) switch_resample_pool_stats(uint64_t *hits, uint64_t *misses, uint32_t *idle)
+{
+	if (resample_pool.running) switch_mutex_lock(resample_pool.mutex);
+	if (hits) *hits = resample_pool.hits;
+	if (misses) *misses = resample_pool.misses;
+	if (idle) *idle = resample_pool.idle;
+	if (resample_pool.running) switch_mutex_unlock(resample_pool.mutex);
+}
+
 SWITCH_DECLARE(switch_status_t) switch_resample_perform_create(switch_audio_resampler_t **new_resampler,
 															   uint32_t from_rate, uint32_t to_rate,
 															   uint32_t to_size,
@@ -60,16 +237,33 @@ SWITCH_DECLARE(switch_status_t) switch_resample_perform_create(switch_audio_resa
 	int err = 0;
 	switch_audio_resampler_t *resampler;
 	double lto_rate, lfrom_rate;
-
-	switch_zmalloc(resampler, sizeof(*resampler));
+	uint32_t need;
 
 	if (!channels) channels = 1;
 
-	resampler->resampler = speex_resampler_init(channels, from_rate, to_rate, quality, &err);
+	if ((resampler = resample_pool_get(from_rate, to_rate, channels, quality))) {
+		if (resampler->polyphase) {
+			resample_polyphase_reset(resampler->polyphase);
+		} else {
+			speex_resampler_reset_mem(resampler->resampler);
+		}
+		resampler->next = NULL;
+		resampler->to_len = 0;
+	} else {
+		switch_zmalloc(resampler, sizeof(*resampler));
+
+		if (channels == 1 && !resample_pool.no_polyphase) {
+			resampler->polyphase = resample_polyphase_create(from_rate, to_rate, quality);
+		}
+
+		if (!resampler->polyphase) {
+			resampler->resampler = speex_resampler_init(channels, from_rate, to_rate, quality, &err);
 
-	if (!resampler->resampler) {
-		free(resampler);
-		return SWITCH_STATUS_GENERR;
+			if (!resampler->resampler) {
+				free(resampler);
+				return SWITCH_STATUS_GENERR;
+			}
+		}
 	}
 
 	*new_resampler = resampler;
@@ -80,19 +274,25 @@ SWITCH_DECLARE(switch_status_t) switch_resample_perform_create(switch_audio_resa
 	resampler->factor = (lto_rate / lfrom_rate);
 	resampler->rfactor = (lfrom_rate / lto_rate);
 	resampler->channels = channels;
+	resampler->quality = quality;
 
 	//resampler->to_size = resample_buffer(to_rate, from_rate, (uint32_t) to_size);
 
-	resampler->to_size = switch_resample_calc_buffer_size(resampler->to_rate, resampler->from_rate, to_size) / 2;
-	resampler->to = malloc(resampler->to_size * sizeof(int16_t) * resampler->channels);
-	switch_assert(resampler->to);
+	/* the polyphase decimator can owe one sample from the previous block */
+	need = switch_resample_calc_buffer_size(resampler->to_rate, resampler->from_rate, to_size) / 2 + (resampler->polyphase ? 1 : 0);
+
+	if (!resampler->to || need > resampler->to_size) {
+		resampler->to_size = need;
+		resampler->to = realloc(resampler->to, resampler->to_size * sizeof(int16_t) * resampler->channels);
+		switch_assert(resampler->to);
+	}
 
 	return SWITCH_STATUS_SUCCESS;
 }
 
 SWITCH_DECLARE(uint32_t) switch_resample_process(switch_audio_resampler_t *resampler, int16_t *src, uint32_t srclen)
 {
-	int to_size = switch_resample_calc_buffer_size(resampler->to_rate, resampler->from_rate, srclen) / 2;
+	int to_size = switch_resample_calc_buffer_size(resampler->to_rate, resampler->from_rate, srclen) / 2 + (resampler->polyphase ? 1 : 0);
 
 	if (to_size > resampler->to_size) {
 		resampler->to_size = to_size;
@@ -100,6 +300,11 @@ SWITCH_DECLARE(uint32_t) switch_resample_process(switch_audio_resampler_t *resam
 		switch_assert(resampler->to);
 	}
 
+	if (resampler->polyphase) {
+		resampler->to_len = resample_polyphase_process(resampler->polyphase, src, srclen, resampler->to);
+		return resampler->to_len;
+	}
+
 	resampler->to_len = resampler->to_size;
 	speex_resampler_process_interleaved_int(resampler->resampler, src, &srclen, resampler->to, &resampler->to_len);
 	return resampler->to_len;
@@ -109,11 +314,9 @@ SWITCH_DECLARE(void) switch_resample_destroy(switch_audio_resampler_t **resample
 {
 
 	if (resampler && *resampler) {
-		if ((*resampler)->resampler) {
-			speex_resampler_destroy((*resampler)->resampler);
+		if (!resample_pool_put(*resampler)) {
+			resample_free(*resampler);
 		}
-		free((*resampler)->to);
-		free(*resampler);
 		*resampler = NULL;
 	}
 }
@@ -228,10 +431,738 @@ SWITCH_DECLARE(void) switch_generate_sln_silence(int16_t *data, uint32_t samples
 	}
 }
 
+/* Signed linear mixing kernels.
+   Every kernel has a portable scalar version and, on x86 with gcc or clang, SSE2 and AVX2 versions that are picked at runtime.
+   All versions produce bit identical output so the choice never changes what anybody hears. */
+
+#define SLN_GAIN_SHIFT 12
+
+typedef struct {
+	const char *name;
+	void (*accumulate)(int32_t *acc, const int16_t *data, uint32_t samples);
+	void (*deaccumulate)(int32_t *acc, const int16_t *data, uint32_t samples);
+	void (*narrow)(int16_t *data, const int32_t *acc, uint32_t samples);
+	void (*mix_minus)(int16_t *data, const int32_t *acc, const int16_t *self, uint32_t samples);
+	void (*gain)(int16_t *data, uint32_t samples, int32_t gain);
+	void (*merge)(int16_t *data, const int16_t *other_data, uint32_t samples);
+	void (*unmerge)(int16_t *data, const int16_t *other_data, uint32_t samples);
+	void (*downmix_stereo)(int16_t *data, uint32_t samples);
+	void (*upmix_stereo)(int16_t *data, uint32_t samples);
+	int32_t (*dot)(const int16_t *data, const int16_t *coefs, uint32_t samples);
+} sln_kernels_t;
+
+static void sln_accumulate_scalar(int32_t *acc, const int16_t *data, uint32_t samples)
+{
+	uint32_t x;
+
+	for (x = 0; x < samples; x++) {
+		acc[x] += data[x];
+	}
+}
+
+static void sln_deaccumulate_scalar(int32_t *acc, const int16_t *data, uint32_t samples)
+{
+	uint32_t x;
+
+	for (x = 0; x < samples; x++) {
+		acc[x] -= data[x];
+	}
+}
+
+static void sln_narrow_scalar(int16_t *data, const int32_t *acc, uint32_t samples)
+{
+	uint32_t x;
+
+	for (x = 0; x < samples; x++) {
+		int32_t z = acc[x];
+		switch_normalize_to_16bit(z);
+		data[x] = (int16_t) z;
+	}
+}
+
+static void sln_mix_minus_scalar(int16_t *data, const int32_t *acc, const int16_t *self, uint32_t samples)
+{
+	uint32_t x;
+
+	for (x = 0; x < samples; x++) {
+		int32_t z = acc[x] - self[x];
+		switch_normalize_to_16bit(z);
+		data[x] = (int16_t) z;
+	}
+}
+
+static void sln_gain_scalar(int16_t *data, uint32_t samples, int32_t gain)
+{
+	uint32_t x;
+
+	for (x = 0; x < samples; x++) {
+		int32_t z = (data[x] * gain) / (1 << SLN_GAIN_SHIFT);
+		switch_normalize_to_16bit(z);
+		data[x] = (int16_t) z;
+	}
+}
+
+static void sln_merge_scalar(int16_t *data, const int16_t *other_data, uint32_t samples)
+{
+	uint32_t x;
+
+	for (x = 0; x < samples; x++) {
+		int32_t z = data[x] + other_data[x];
+		switch_normalize_to_16bit(z);
+		data[x] = (int16_t) z;
+	}
+}
+
+static void sln_unmerge_scalar(int16_t *data, const int16_t *other_data, uint32_t samples)
+{
+	uint32_t x;
+
+	for (x = 0; x < samples; x++) {
+		data[x] -= other_data[x];
+	}
+}
+
+static void sln_downmix_stereo_scalar(int16_t *data, uint32_t samples)
+{
+	uint32_t x;
+
+	for (x = 0; x < samples; x++) {
+		int32_t z = data[x * 2] + data[x * 2 + 1];
+		switch_normalize_to_16bit(z);
+		data[x] = (int16_t) z;
+	}
+}
+
+static void sln_upmix_stereo_scalar(int16_t *data, uint32_t samples)
+{
+	uint32_t x;
+
+	/* walk backwards so the buffer can be expanded in place */
+	for (x = samples; x > 0; x--) {
+		data[(x - 1) * 2 + 1] = data[(x - 1) * 2] = data[x - 1];
+	}
+}
+
+static int32_t sln_dot_scalar(const int16_t *data, const int16_t *coefs, uint32_t samples)
+{
+	int32_t z = 0;
+	uint32_t x;
+
+	for (x = 0; x < samples; x++) {
+		z += data[x] * coefs[x];
+	}
+
+	return z;
+}
+
+static const sln_kernels_t sln_kernels_scalar = {
+	"scalar",
+	sln_accumulate_scalar,
+	sln_deaccumulate_scalar,
+	sln_narrow_scalar,
+	sln_mix_minus_scalar,
+	sln_gain_scalar,
+	sln_merge_scalar,
+	sln_unmerge_scalar,
+	sln_downmix_stereo_scalar,
+	sln_upmix_stereo_scalar,
+	sln_dot_scalar
+};
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__) && (defined(__clang__) || __GNUC__ >= 5)
+#define SWITCH_SLN_KERNELS_X86 1
+#include <immintrin.h>
+
+static void sln_accumulate_sse2(int32_t *acc, const int16_t *data, uint32_t samples)
+{
+	uint32_t x = 0;
+
+	for (; x + 8 <= samples; x += 8) {
+		__m128i s = _mm_loadu_si128((const __m128i *) (data + x));
+		__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+		__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+
+		_mm_storeu_si128((__m128i *) (acc + x), _mm_add_epi32(_mm_loadu_si128((const __m128i *) (acc + x)), lo));
+		_mm_storeu_si128((__m128i *) (acc + x + 4), _mm_add_epi32(_mm_loadu_si128((const __m128i *) (acc + x + 4)), hi));
+	}
+
+	sln_accumulate_scalar(acc + x, data + x, samples - x);
+}
+
+static void sln_deaccumulate_sse2(int32_t *acc, const int16_t *data, uint32_t samples)
+{
+	uint32_t x = 0;
+
+	for (; x + 8 <= samples; x += 8) {
+		__m128i s = _mm_loadu_si128((const __m128i *) (data + x));
+		__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+		__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+
+		_mm_storeu_si128((__m128i *) (acc + x), _mm_sub_epi32(_mm_loadu_si128((const __m128i *) (acc + x)), lo));
+		_mm_storeu_si128((__m128i *) (acc + x + 4), _mm_sub_epi32(_mm_loadu_si128((const __m128i *) (acc + x + 4)), hi));
+	}
+
+	sln_deaccumulate_scalar(acc + x, data + x, samples - x);
+}
+
+static void sln_narrow_sse2(int16_t *data, const int32_t *acc, uint32_t samples)
+{
+	uint32_t x = 0;
+
+	for (; x + 8 <= samples; x += 8) {
+		__m128i lo = _mm_loadu_si128((const __m128i *) (acc + x));
+		__m128i hi = _mm_loadu_si128((const __m128i *) (acc + x + 4));
+
+		_mm_storeu_si128((__m128i *) (data + x), _mm_packs_epi32(lo, hi));
+	}
+
+	sln_narrow_scalar(data + x, acc + x, samples - x);
+}
+
+static void sln_mix_minus_sse2(int16_t *data, const int32_t *acc, const int16_t *self, uint32_t samples)
+{
+	uint32_t x = 0;
+
+	for (; x + 8 <= samples; x += 8) {
+		__m128i s = _mm_loadu_si128((const __m128i *) (self + x));
+		__m128i lo = _mm_sub_epi32(_mm_loadu_si128((const __m128i *) (acc + x)), _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16));
+		__m128i hi = _mm_sub_epi32(_mm_loadu_si128((const __m128i *) (acc + x + 4)), _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16));
+
+		_mm_storeu_si128((__m128i *) (data + x), _mm_packs_epi32(lo, hi));
+	}
+
+	sln_mix_minus_scalar(data + x, acc + x, self + x, samples - x);
+}
+
+static inline __m128i sln_gain_trunc_sse2(__m128i p)
+{
+	/* round toward zero like the scalar division does */
+	__m128i bias = _mm_and_si128(_mm_srai_epi32(p, 31), _mm_set1_epi32((1 << SLN_GAIN_SHIFT) - 1));
+	return _mm_srai_epi32(_mm_add_epi32(p, bias), SLN_GAIN_SHIFT);
+}
+
+static void sln_gain_sse2(int16_t *data, uint32_t samples, int32_t gain)
+{
+	uint32_t x = 0;
+	__m128i g = _mm_set1_epi16((int16_t) gain);
+
+	for (; x + 8 <= samples; x += 8) {
+		__m128i s = _mm_loadu_si128((const __m128i *) (data + x));
+		__m128i pl = _mm_mullo_epi16(s, g);
+		__m128i ph = _mm_mulhi_epi16(s, g);
+		__m128i lo = sln_gain_trunc_sse2(_mm_unpacklo_epi16(pl, ph));
+		__m128i hi = sln_gain_trunc_sse2(_mm_unpackhi_epi16(pl, ph));
+
+		_mm_storeu_si128((__m128i *) (data + x), _mm_packs_epi32(lo, hi));
+	}
+
+	sln_gain_scalar(data + x, samples - x, gain);
+}
+
+static void sln_merge_sse2(int16_t *data, const int16_t *other_data, uint32_t samples)
+{
+	uint32_t x = 0;
+
+	for (; x + 8 <= samples; x += 8) {
+		__m128i a = _mm_loadu_si128((const __m128i *) (data + x));
+		__m128i b = _mm_loadu_si128((const __m128i *) (other_data + x));
+
+		_mm_storeu_si128((__m128i *) (data + x), _mm_adds_epi16(a, b));
+	}
+
+	sln_merge_scalar(data + x, other_data + x, samples - x);
+}
+
+static void sln_unmerge_sse2(int16_t *data, const int16_t *other_data, uint32_t samples)
+{
+	uint32_t x = 0;
+
+	for (; x + 8 <= samples; x += 8) {
+		__m128i a = _mm_loadu_si128((const __m128i *) (data + x));
+		__m128i b = _mm_loadu_si128((const __m128i *) (other_data + x));
+
+		_mm_storeu_si128((__m128i *) (data + x), _mm_sub_epi16(a, b));
+	}
+
+	sln_unmerge_scalar(data + x, other_data + x, samples - x);
+}
+
+static void sln_downmix_stereo_sse2(int16_t *data, uint32_t samples)
+{
+	uint32_t x = 0;
+	__m128i ones = _mm_set1_epi16(1);
+
+	/* output never overtakes input so this is safe in place */
+	for (; x + 8 <= samples; x += 8) {
+		__m128i lo = _mm_madd_epi16(_mm_loadu_si128((const __m128i *) (data + x * 2)), ones);
+		__m128i hi = _mm_madd_epi16(_mm_loadu_si128((const __m128i *) (data + x * 2 + 8)), ones);
+
+		_mm_storeu_si128((__m128i *) (data + x), _mm_packs_epi32(lo, hi));
+	}
+
+	for (; x < samples; x++) {
+		int32_t z = data[x * 2] + data[x * 2 + 1];
+		switch_normalize_to_16bit(z);
+		data[x] = (int16_t) z;
+	}
+}
+
+static void sln_upmix_stereo_sse2(int16_t *data, uint32_t samples)
+{
+	uint32_t x = samples;
+
+	/* tail first, then whole blocks from the end towards the start so nothing is overwritten before it is read */
+	for (; x % 8; x--) {
+		data[(x - 1) * 2 + 1] = data[(x - 1) * 2] = data[x - 1];
+	}
+
+	while (x) {
+		__m128i s;
+
+		x -= 8;
+		s = _mm_loadu_si128((const __m128i *) (data + x));
+		_mm_storeu_si128((__m128i *) (data + x * 2 + 8), _mm_unpackhi_epi16(s, s));
+		_mm_storeu_si128((__m128i *) (data + x * 2), _mm_unpacklo_epi16(s, s));
+	}
+}
+
+static int32_t sln_dot_sse2(const int16_t *data, const int16_t *coefs, uint32_t samples)
+{
+	__m128i acc = _mm_setzero_si128();
+	uint32_t x = 0;
+
+	for (; x + 8 <= samples; x += 8) {
+		acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_loadu_si128((const __m128i *) (data + x)), _mm_loadu_si128((const __m128i *) (coefs + x))));
+	}
+
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0x4E));
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0xB1));
+
+	return _mm_cvtsi128_si32(acc) + sln_dot_scalar(data + x, coefs + x, samples - x);
+}
+
+static const sln_kernels_t sln_kernels_sse2 = {
+	"sse2",
+	sln_accumulate_sse2,
+	sln_deaccumulate_sse2,
+	sln_narrow_sse2,
+	sln_mix_minus_sse2,
+	sln_gain_sse2,
+	sln_merge_sse2,
+	sln_unmerge_sse2,
+	sln_downmix_stereo_sse2,
+	sln_upmix_stereo_sse2,
+	sln_dot_sse2
+};
+
+#define SLN_AVX2 __attribute__((target("avx2")))
+
+SLN_AVX2 static void sln_accumulate_avx2(int32_t *acc, const int16_t *data, uint32_t samples)
+{
+	uint32_t x = 0;
+
+	for (; x + 8 <= samples; x += 8) {
+		__m256i s = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (data + x)));
+
+		_mm256_storeu_si256((__m256i *) (acc + x), _mm256_add_epi32(_mm256_loadu_si256((const __m256i *) (acc + x)), s));
+	}
+
+	sln_accumulate_scalar(acc + x, data + x, samples - x);
+}
+
+SLN_AVX2 static void sln_deaccumulate_avx2(int32_t *acc, const int16_t *data, uint32_t samples)
+{
+	uint32_t x = 0;
+
+	for (; x + 8 <= samples; x += 8) {
+		__m256i s = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (data + x)));
+
+		_mm256_storeu_si256((__m256i *) (acc + x), _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *) (acc + x)), s));
+	}
+
+	sln_deaccumulate_scalar(acc + x, data + x, samples - x);
+}
+
+/* packs works per 128 bit lane so the quadwords have to be put back in order afterwards */
+#define sln_pack_avx2(_lo, _hi) _mm256_permute4x64_epi64(_mm256_packs_epi32(_lo, _hi), 0xD8)
+
+SLN_AVX2 static void sln_narrow_avx2(int16_t *data, const int32_t *acc, uint32_t samples)
+{
+	uint32_t x = 0;
+
+	for (; x + 16 <= samples; x += 16) {
+		__m256i lo = _mm256_loadu_si256((const __m256i *) (acc + x));
+		__m256i hi = _mm256_loadu_si256((const __m256i *) (acc + x + 8));
+
+		_mm256_storeu_si256((__m256i *) (data + x), sln_pack_avx2(lo, hi));
+	}
+
+	sln_narrow_scalar(data + x, acc + x, samples - x);
+}
+
+SLN_AVX2 static void sln_mix_minus_avx2(int16_t *data, const int32_t *acc, const int16_t *self, uint32_t samples)
+{
+	uint32_t x = 0;
+
+	for (; x + 16 <= samples; x += 16) {
+		__m256i lo = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *) (acc + x)),
+									  _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (self + x))));
+		__m256i hi = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *) (acc + x + 8)),
+									  _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (self + x + 8))));
+
+		_mm256_storeu_si256((__m256i *) (data + x), sln_pack_avx2(lo, hi));
+	}
+
+	sln_mix_minus_scalar(data + x, acc + x, self + x, samples - x);
+}
+
+SLN_AVX2 static inline __m256i sln_gain_trunc_avx2(__m256i p)
+{
+	__m256i bias = _mm256_and_si256(_mm256_srai_epi32(p, 31), _mm256_set1_epi32((1 << SLN_GAIN_SHIFT) - 1));
+	return _mm256_srai_epi32(_mm256_add_epi32(p, bias), SLN_GAIN_SHIFT);
+}
+
+SLN_AVX2 static void sln_gain_avx2(int16_t *data, uint32_t samples, int32_t gain)
+{
+	uint32_t x = 0;
+	__m256i g = _mm256_set1_epi32(gain);
+
+	for (; x + 16 <= samples; x += 16) {
+		__m256i lo = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (data + x)));
+		__m256i hi = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (data + x + 8)));
+
+		lo = sln_gain_trunc_avx2(_mm256_mullo_epi32(lo, g));
+		hi = sln_gain_trunc_avx2(_mm256_mullo_epi32(hi, g));
+		_mm256_storeu_si256((__m256i *) (data + x), sln_pack_avx2(lo, hi));
+	}
+
+	sln_gain_scalar(data + x, samples - x, gain);
+}
+
+SLN_AVX2 static void sln_merge_avx2(int16_t *data, const int16_t *other_data, uint32_t samples)
+{
+	uint32_t x = 0;
+
+	for (; x + 16 <= samples; x += 16) {
+		__m256i a = _mm256_loadu_si256((const __m256i *) (data + x));
+		__m256i b = _mm256_loadu_si256((const __m256i *) (other_data + x));
+
+		_mm256_storeu_si256((__m256i *) (data + x), _mm256_adds_epi16(a, b));
+	}
+
+	sln_merge_scalar(data + x, other_data + x, samples - x);
+}
+
+SLN_AVX2 static void sln_unmerge_avx2(int16_t *data, const int16_t *other_data, uint32_t samples)
+{
+	uint32_t x = 0;
+
+	for (; x + 16 <= samples; x += 16) {
+		__m256i a = _mm256_loadu_si256((const __m256i *) (data + x));
+		__m256i b = _mm256_loadu_si256((const __m256i *) (other_data + x));
+
+		_mm256_storeu_si256((__m256i *) (data + x), _mm256_sub_epi16(a, b));
+	}
+
+	sln_unmerge_scalar(data + x, other_data + x, samples - x);
+}
+
+SLN_AVX2 static int32_t sln_dot_avx2(const int16_t *data, const int16_t *coefs, uint32_t samples)
+{
+	__m256i acc = _mm256_setzero_si256();
+	__m128i sum;
+	uint32_t x = 0;
+
+	for (; x + 16 <= samples; x += 16) {
+		acc = _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_loadu_si256((const __m256i *) (data + x)), _mm256_loadu_si256((const __m256i *) (coefs + x))));
+	}
+
+	sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+
+	return _mm_cvtsi128_si32(sum) + sln_dot_scalar(data + x, coefs + x, samples - x);
+}
+
+static const sln_kernels_t sln_kernels_avx2 = {
+	"avx2",
+	sln_accumulate_avx2,
+	sln_deaccumulate_avx2,
+	sln_narrow_avx2,
+	sln_mix_minus_avx2,
+	sln_gain_avx2,
+	sln_merge_avx2,
+	sln_unmerge_avx2,
+	sln_downmix_stereo_sse2,
+	sln_upmix_stereo_sse2,
+	sln_dot_avx2
+};
+#endif
+
+static const sln_kernels_t *sln_kernels = NULL;
+
+static const sln_kernels_t *sln_kernels_detect(void)
+{
+#ifdef SWITCH_SLN_KERNELS_X86
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2")) {
+		return &sln_kernels_avx2;
+	}
+
+	return &sln_kernels_sse2;
+#else
+	return &sln_kernels_scalar;
+#endif
+}
+
+static inline const sln_kernels_t *sln_get_kernels(void)
+{
+	/* racing first callers all detect the same answer so there is nothing to lock */
+	if (!sln_kernels) {
+		sln_kernels = sln_kernels_detect();
+	}
+
+	return sln_kernels;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_sln_kernels_select(const char *name)
+{
+	const sln_kernels_t *kernels = NULL;
+
+	if (zstr(name) || !strcasecmp(name, "auto")) {
+		kernels = sln_kernels_detect();
+	} else if (!strcasecmp(name, "scalar")) {
+		kernels = &sln_kernels_scalar;
+#ifdef SWITCH_SLN_KERNELS_X86
+	} else if (!strcasecmp(name, "sse2")) {
+		kernels = &sln_kernels_sse2;
+	} else if (!strcasecmp(name, "avx2") && __builtin_cpu_supports("avx2")) {
+		kernels = &sln_kernels_avx2;
+#endif
+	}
+
+	if (!kernels) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	sln_kernels = kernels;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(const char *) switch_sln_kernels_name(void)
+{
+	return sln_get_kernels()->name;
+}
+
+SWITCH_DECLARE(void) switch_sln_accumulate(int32_t *acc, const int16_t *data, uint32_t samples)
+{
+	sln_get_kernels()->accumulate(acc, data, samples);
+}
+
+SWITCH_DECLARE(void) switch_sln_deaccumulate(int32_t *acc, const int16_t *data, uint32_t samples)
+{
+	sln_get_kernels()->deaccumulate(acc, data, samples);
+}
+
+SWITCH_DECLARE(void) switch_sln_narrow(int16_t *data, const int32_t *acc, uint32_t samples)
+{
+	sln_get_kernels()->narrow(data, acc, samples);
+}
+
+SWITCH_DECLARE(void) switch_sln_mix_minus(int16_t *data, const int32_t *acc, const int16_t *self, uint32_t self_samples, uint32_t samples)
+{
+	const sln_kernels_t *kernels = sln_get_kernels();
+
+	if (self_samples > samples) {
+		self_samples = samples;
+	}
+
+	if (self && self_samples) {
+		kernels->mix_minus(data, acc, self, self_samples);
+	} else {
+		self_samples = 0;
+	}
+
+	kernels->narrow(data + self_samples, acc + self_samples, samples - self_samples);
+}
+
+SWITCH_DECLARE(void) switch_sln_gain(int16_t *data, uint32_t samples, int32_t gain)
+{
+	if (gain > SWITCH_SMAX) {
+		gain = SWITCH_SMAX;
+	} else if (gain < SWITCH_SMIN) {
+		gain = SWITCH_SMIN;
+	}
+
+	sln_get_kernels()->gain(data, samples, gain);
+}
+
+/* Integer ratio polyphase resampler.
+   8k, 16k and 48k are all 2x, 3x or 6x apart, for those a fixed Kaiser windowed sinc lowpass in Q15 does the job
+   with one dot product per output sample, and the dot product comes from the SIMD kernels above. */
+
+#define POLYPHASE_TAPS_LOW 16
+#define POLYPHASE_TAPS_HIGH 32
+
+struct resample_polyphase_s {
+	/* interpolation factor, 1 when decimating */
+	uint32_t up;
+	/* decimation factor, 1 when interpolating */
+	uint32_t down;
+	/* length of the dot product behind each output sample */
+	uint32_t taps;
+	/* input samples already seen towards the next decimated output */
+	uint32_t phase;
+	/* up sets of taps coefficients, reversed so they line up with the history */
+	int16_t *coefs;
+	/* taps - 1 samples of history followed by the block being processed */
+	int16_t *buf;
+	uint32_t buf_size;
+};
+
+static double polyphase_bessel_i0(double x)
+{
+	double sum = 1.0, term = 1.0, k;
+
+	for (k = 1.0; k < 50.0; k++) {
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+		if (term < sum * 1e-12) {
+			break;
+		}
+	}
+
+	return sum;
+}
+
+static resample_polyphase_t *resample_polyphase_create(uint32_t from_rate, uint32_t to_rate, int quality)
+{
+	resample_polyphase_t *pp;
+	uint32_t ratio, per_phase, len, n, p, j;
+	double *h, fc, beta = 7.0, center, sum = 0;
+
+	if (!from_rate || !to_rate || from_rate == to_rate) {
+		return NULL;
+	}
+
+	ratio = from_rate > to_rate ? from_rate / to_rate : to_rate / from_rate;
+
+	if ((from_rate > to_rate ? to_rate * ratio != from_rate : from_rate * ratio != to_rate) || (ratio != 2 && ratio != 3 && ratio != 6)) {
+		return NULL;
+	}
+
+	switch_zmalloc(pp, sizeof(*pp));
+
+	per_phase = quality > 3 ? POLYPHASE_TAPS_HIGH : POLYPHASE_TAPS_LOW;
+
+	if (to_rate > from_rate) {
+		pp->up = ratio;
+		pp->down = 1;
+		pp->taps = per_phase;
+	} else {
+		pp->up = 1;
+		pp->down = ratio;
+		pp->taps = per_phase * ratio;
+	}
+
+	/* design the full filter at the high rate, cutting off a little under the low rate's nyquist */
+	len = per_phase * ratio;
+	fc = 0.45 / ratio;
+	center = (len - 1) / 2.0;
+
+	switch_zmalloc(h, len * sizeof(double));
+
+	for (n = 0; n < len; n++) {
+		double t = n - center, r = t / (center + 0.5);
+		double sinc = t == 0 ? 2.0 * fc : sin(2.0 * M_PI * fc * t) / (M_PI * t);
+
+		h[n] = sinc * polyphase_bessel_i0(beta * sqrt(1.0 - r * r)) / polyphase_bessel_i0(beta);
+		sum += h[n];
+	}
+
+	/* unity gain, interpolation puts back the energy of the zeros it stuffs in */
+	for (n = 0; n < len; n++) {
+		h[n] *= pp->up / sum;
+	}
+
+	switch_zmalloc(pp->coefs, pp->up * pp->taps * sizeof(int16_t));
+
+	for (p = 0; p < pp->up; p++) {
+		for (j = 0; j < pp->taps; j++) {
+			double c = h[(pp->taps - 1 - j) * pp->up + p] * 32768.0;
+
+			if (c > SWITCH_SMAX) c = SWITCH_SMAX;
+			if (c < SWITCH_SMIN) c = SWITCH_SMIN;
+			pp->coefs[p * pp->taps + j] = (int16_t) (c < 0 ? c - 0.5 : c + 0.5);
+		}
+	}
+
+	free(h);
+
+	return pp;
+}
+
+static void resample_polyphase_reset(resample_polyphase_t *pp)
+{
+	pp->phase = 0;
+
+	if (pp->buf) {
+		memset(pp->buf, 0, (pp->taps - 1) * sizeof(int16_t));
+	}
+}
+
+static uint32_t resample_polyphase_process(resample_polyphase_t *pp, const int16_t *src, uint32_t srclen, int16_t *dst)
+{
+	int32_t (*dot)(const int16_t *, const int16_t *, uint32_t) = sln_get_kernels()->dot;
+	uint32_t hist = pp->taps - 1, i, p, out = 0;
+
+	if (!pp->buf || hist + srclen > pp->buf_size) {
+		/* only grows, and only the first block or a bigger one than before gets here */
+		pp->buf = realloc(pp->buf, (hist + srclen) * sizeof(int16_t));
+		switch_assert(pp->buf);
+		if (!pp->buf_size) {
+			memset(pp->buf, 0, hist * sizeof(int16_t));
+		}
+		pp->buf_size = hist + srclen;
+	}
+
+	memcpy(pp->buf + hist, src, srclen * sizeof(int16_t));
+
+	if (pp->up > 1) {
+		for (i = 0; i < srclen; i++) {
+			for (p = 0; p < pp->up; p++) {
+				int32_t z = (dot(pp->buf + i, pp->coefs + p * pp->taps, pp->taps) + (1 << 14)) >> 15;
+				switch_normalize_to_16bit(z);
+				dst[out++] = (int16_t) z;
+			}
+		}
+	} else {
+		for (i = pp->down - 1 - pp->phase; i < srclen; i += pp->down) {
+			int32_t z = (dot(pp->buf + i, pp->coefs, pp->taps) + (1 << 14)) >> 15;
+			switch_normalize_to_16bit(z);
+			dst[out++] = (int16_t) z;
+		}
+
+		pp->phase = (pp->phase + srclen) % pp->down;
+	}
+
+	memmove(pp->buf, pp->buf + srclen, hist * sizeof(int16_t));
+
+	return out;
+}
+
+static void resample_polyphase_destroy(resample_polyphase_t *pp)
+{
+	free(pp->coefs);
+	free(pp->buf);
+	free(pp);
+}
+
 SWITCH_DECLARE(uint32_t) switch_merge_sln(int16_t *data, uint32_t samples, int16_t *other_data, uint32_t other_samples, int channels)
 {
-	int i;
-	int32_t x, z;
+	int32_t x;
 
 	if (channels == 0) channels = 1;
 
@@ -241,11 +1172,7 @@ SWITCH_DECLARE(uint32_t) switch_merge_sln(int16_t *data, uint32_t samples, int16
 		x = samples;
 	}
 
-	for (i = 0; i < x * channels; i++) {
-		z = data[i] + other_data[i];
-		switch_normalize_to_16bit(z);
-		data[i] = (int16_t) z;
-	}
+	sln_get_kernels()->merge(data, other_data, x * channels);
 
 	return x;
 }
@@ -253,7 +1180,6 @@ SWITCH_DECLARE(uint32_t) switch_merge_sln(int16_t *data, uint32_t samples, int16
 
 SWITCH_DECLARE(uint32_t) switch_unmerge_sln(int16_t *data, uint32_t samples, int16_t *other_data, uint32_t other_samples, int channels)
 {
-	int i;
 	int32_t x;
 
 	if (channels == 0) channels = 1;
@@ -264,9 +1190,7 @@ SWITCH_DECLARE(uint32_t) switch_unmerge_sln(int16_t *data, uint32_t samples, int
 		x = samples;
 	}
 
-	for (i = 0; i < x * channels; i++) {
-		data[i] -= other_data[i];
-	}
+	sln_get_kernels()->unmerge(data, other_data, x * channels);
 
 	return x;
 }
@@ -278,7 +1202,11 @@ SWITCH_DECLARE(void) switch_mux_channels(int16_t *data, switch_size_t samples, u
 
 	switch_assert(channels < 11);
 
-	if (orig_channels > channels) {
+	if (orig_channels == 2 && channels == 1) {
+		sln_get_kernels()->downmix_stereo(data, (uint32_t) samples);
+	} else if (orig_channels == 1 && channels == 2) {
+		sln_get_kernels()->upmix_stereo(data, (uint32_t) samples);
+	} else if (orig_channels > channels) {
 		for (i = 0; i < samples; i++) {
 			int32_t z = 0;
 			for (j = 0; j < orig_channels; j++) {
@@ -323,12 +1251,21 @@ SWITCH_DECLARE(void) switch_mux_channels(int16_t *data, switch_size_t samples, u
 	}
 }
 
+/* volume charts in SLN_GAIN_SHIFT fixed point */
+#define SLN_GAIN(_f) ((int32_t) ((_f) * (1 << SLN_GAIN_SHIFT) + 0.5))
+
 SWITCH_DECLARE(void) switch_change_sln_volume_granular(int16_t *data, uint32_t samples, int32_t vol)
 {
-	double newrate = 0;
-	double pos[13] = {1.25, 1.50, 1.75, 2.0, 2.25, 2.50, 2.75, 3.0, 3.25, 3.50, 3.75, 4.0, 4.5};
-	double neg[13] = {.917, .834, .751, .668, .585, .502, .419, .336, .253, .087, .017, .004, 0.0};
-	double *chart;
+	int32_t newrate = 0;
+	static const int32_t pos[13] = {
+		SLN_GAIN(1.25), SLN_GAIN(1.50), SLN_GAIN(1.75), SLN_GAIN(2.0), SLN_GAIN(2.25), SLN_GAIN(2.50), SLN_GAIN(2.75),
+		SLN_GAIN(3.0), SLN_GAIN(3.25), SLN_GAIN(3.50), SLN_GAIN(3.75), SLN_GAIN(4.0), SLN_GAIN(4.5)
+	};
+	static const int32_t neg[13] = {
+		SLN_GAIN(.917), SLN_GAIN(.834), SLN_GAIN(.751), SLN_GAIN(.668), SLN_GAIN(.585), SLN_GAIN(.502), SLN_GAIN(.419),
+		SLN_GAIN(.336), SLN_GAIN(.253), SLN_GAIN(.087), SLN_GAIN(.017), SLN_GAIN(.004), 0
+	};
+	const int32_t *chart;
 	uint32_t i;
 
 	if (vol == 0) return;
@@ -348,15 +1285,7 @@ SWITCH_DECLARE(void) switch_change_sln_volume_granular(int16_t *data, uint32_t s
 	newrate = chart[i];
 
 	if (newrate) {
-		int32_t tmp;
-		uint32_t x;
-		int16_t *fp = data;
-
-		for (x = 0; x < samples; x++) {
-			tmp = (int32_t) (fp[x] * newrate);
-			switch_normalize_to_16bit(tmp);
-			fp[x] = (int16_t) tmp;
-		}
+		sln_get_kernels()->gain(data, samples, newrate);
 	} else {
 		memset(data, 0, samples * 2);
 	}
@@ -364,10 +1293,10 @@ SWITCH_DECLARE(void) switch_change_sln_volume_granular(int16_t *data, uint32_t s
 
 SWITCH_DECLARE(void) switch_change_sln_volume(int16_t *data, uint32_t samples, int32_t vol)
 {
-	double newrate = 0;
-	double pos[4] = {1.3, 2.3, 3.3, 4.3};
-	double neg[4] = {.80, .60, .40, .20};
-	double *chart;
+	int32_t newrate = 0;
+	static const int32_t pos[4] = {SLN_GAIN(1.3), SLN_GAIN(2.3), SLN_GAIN(3.3), SLN_GAIN(4.3)};
+	static const int32_t neg[4] = {SLN_GAIN(.80), SLN_GAIN(.60), SLN_GAIN(.40), SLN_GAIN(.20)};
+	const int32_t *chart;
 	uint32_t i;
 
 	if (vol == 0) return;
@@ -387,15 +1316,7 @@ SWITCH_DECLARE(void) switch_change_sln_volume(int16_t *data, uint32_t samples, i
 	newrate = chart[i];
 
 	if (newrate) {
-		int32_t tmp;
-		uint32_t x;
-		int16_t *fp = data;
-
-		for (x = 0; x < samples; x++) {
-			tmp = (int32_t) (fp[x] * newrate);
-			switch_normalize_to_16bit(tmp);
-			fp[x] = (int16_t) tmp;
-		}
+		sln_get_kernels()->gain(data, samples, newrate);
 	}
 }
 
@@ -321,6 +321,7 @@ struct switch_rtp {
 	switch_socket_t *sock_input, *sock_output, *rtcp_sock_input, *rtcp_sock_output;
 	switch_pollfd_t *read_pollfd, *rtcp_read_pollfd;
 	switch_pollfd_t *jb_pollfd;
+	struct rtp_reactor_link_s *reactor_link;
 
 	switch_sockaddr_t *local_addr, *rtcp_local_addr;
 	rtp_msg_t send_msg;
@@ -1468,6 +1469,673 @@ static void zrtp_logger(int level, const char *data, int len, int offset)
 }
 #endif
 
+/*
+ * Shared media reactor
+ *
+ * When rtp-media-reactor-threads is configured, audio sessions hand their RTP socket to a
+ * small pool of epoll driven I/O threads instead of polling it from the session thread.
+ * A reactor drains each readable socket with recvmmsg() into a short per session ring
+ * that read_rtp_packet() consumes, and flushes packets queued by rtp_common_write() with
+ * sendmmsg().  The session thread only parks on the ring when there is nothing to read.
+ */
+
+#if defined(HAVE_RECVMMSG) && defined(HAVE_SENDMMSG) && defined(HAVE_EPOLL_CREATE1) && defined(HAVE_SYS_EPOLL_H)
+#define RTP_MEDIA_REACTOR 1
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+#define RTP_REACTOR_MAX_THREADS 64
+
+static uint32_t MEDIA_REACTOR_THREADS = 0;
+
+#ifdef RTP_MEDIA_REACTOR
+
+#define RTP_REACTOR_BATCH 32
+#define RTP_REACTOR_RX_SLOTS 16 /* must be a power of 2 */
+#define RTP_REACTOR_TX_SLOTS 8
+#define RTP_REACTOR_PACKET_LEN 1500
+#define RTP_REACTOR_WAKE_KEY UINT64_MAX
+#define rtp_reactor_key(_link) (((uint64_t)(_link)->generation << 32) | (_link)->slot)
+
+typedef struct rtp_reactor_s rtp_reactor_t;
+
+typedef struct rtp_reactor_packet_s {
+	uint32_t len;
+	socklen_t addr_len;
+	struct sockaddr_storage addr;
+	char data[RTP_REACTOR_PACKET_LEN];
+} rtp_reactor_packet_t;
+
+struct rtp_reactor_link_s {
+	rtp_reactor_t *reactor;
+	switch_os_socket_t fd;
+	uint32_t slot;
+	uint32_t generation;
+	switch_mutex_t *mutex;
+	switch_thread_cond_t *cond;
+	int waiting;
+	int dead;
+	int tx_pending;
+	uint32_t rx_head;
+	uint32_t rx_tail;
+	uint32_t tx_count;
+	rtp_reactor_packet_t rx[RTP_REACTOR_RX_SLOTS];
+	rtp_reactor_packet_t tx[RTP_REACTOR_TX_SLOTS];
+};
+
+struct rtp_reactor_s {
+	uint32_t id;
+	int epfd;
+	int wakefd;
+	int running;
+	switch_thread_t *thread;
+	switch_mutex_t *mutex;
+	switch_mutex_t *tx_mutex;
+	struct rtp_reactor_link_s **links;
+	uint32_t link_alloc;
+	uint32_t link_count;
+	uint32_t next_generation;
+	uint64_t *tx_ready;
+	uint32_t tx_ready_count;
+	uint32_t tx_ready_alloc;
+	uint64_t *tx_work;
+	uint32_t tx_work_alloc;
+	uint64_t rx_syscalls;
+	uint64_t rx_packets;
+	uint64_t rx_dropped;
+	uint64_t rx_truncated;
+	uint64_t tx_syscalls;
+	uint64_t tx_packets;
+	uint64_t tx_dropped;
+	uint64_t tx_fallback;
+};
+
+static rtp_reactor_t *MEDIA_REACTORS[RTP_REACTOR_MAX_THREADS] = { 0 };
+static uint32_t MEDIA_REACTOR_COUNT = 0;
+
+static struct rtp_reactor_link_s *rtp_reactor_lookup(rtp_reactor_t *reactor, uint64_t key)
+{
+	uint32_t slot = (uint32_t) (key & 0xffffffff);
+	struct rtp_reactor_link_s *link;
+
+	if (slot < reactor->link_alloc && (link = reactor->links[slot]) && link->generation == (uint32_t) (key >> 32)) {
+		return link;
+	}
+
+	return NULL;
+}
+
+static void rtp_reactor_recv(rtp_reactor_t *reactor, struct rtp_reactor_link_s *link)
+{
+	struct mmsghdr msgs[RTP_REACTOR_BATCH];
+	struct iovec iov[RTP_REACTOR_BATCH];
+	uint32_t space, tail, i;
+	int n;
+
+	for (;;) {
+		switch_mutex_lock(link->mutex);
+		space = RTP_REACTOR_RX_SLOTS - (link->rx_tail - link->rx_head);
+		tail = link->rx_tail;
+		switch_mutex_unlock(link->mutex);
+
+		if (!space) {
+			char scratch[RTP_REACTOR_PACKET_LEN];
+
+			/* the session is not keeping up, shed one batch so we don't spin on a readable socket,
+			   epoll is level triggered and brings us back for the rest after the other links had their turn */
+			for (i = 0; i < RTP_REACTOR_BATCH; i++) {
+				reactor->rx_syscalls++;
+				if (recv(link->fd, scratch, sizeof(scratch), MSG_DONTWAIT) < 0) {
+					break;
+				}
+				reactor->rx_dropped++;
+			}
+			return;
+		}
+
+		if (space > RTP_REACTOR_BATCH) {
+			space = RTP_REACTOR_BATCH;
+		}
+
+		memset(msgs, 0, sizeof(msgs[0]) * space);
+
+		/* slots between rx_tail and rx_head are owned by us until rx_tail is advanced */
+		for (i = 0; i < space; i++) {
+			rtp_reactor_packet_t *pkt = &link->rx[(tail + i) & (RTP_REACTOR_RX_SLOTS - 1)];
+
+			iov[i].iov_base = pkt->data;
+			iov[i].iov_len = sizeof(pkt->data);
+			msgs[i].msg_hdr.msg_iov = &iov[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+			msgs[i].msg_hdr.msg_name = &pkt->addr;
+			msgs[i].msg_hdr.msg_namelen = sizeof(pkt->addr);
+		}
+
+		n = recvmmsg(link->fd, msgs, space, MSG_DONTWAIT, NULL);
+		reactor->rx_syscalls++;
+
+		if (n <= 0) {
+			return;
+		}
+
+		for (i = 0; i < (uint32_t) n; i++) {
+			rtp_reactor_packet_t *pkt = &link->rx[(tail + i) & (RTP_REACTOR_RX_SLOTS - 1)];
+
+			if ((msgs[i].msg_hdr.msg_flags & MSG_TRUNC)) {
+				/* zero length slots are skipped by the reader */
+				pkt->len = 0;
+				reactor->rx_truncated++;
+			} else {
+				pkt->len = msgs[i].msg_len;
+			}
+
+			pkt->addr_len = msgs[i].msg_hdr.msg_namelen;
+		}
+
+		reactor->rx_packets += n;
+
+		switch_mutex_lock(link->mutex);
+		link->rx_tail += n;
+		if (link->waiting) {
+			switch_thread_cond_signal(link->cond);
+		}
+		switch_mutex_unlock(link->mutex);
+
+		if ((uint32_t) n < space) {
+			return;
+		}
+	}
+}
+
+static void rtp_reactor_flush(rtp_reactor_t *reactor)
+{
+	struct mmsghdr msgs[RTP_REACTOR_TX_SLOTS];
+	struct iovec iov[RTP_REACTOR_TX_SLOTS];
+	uint32_t count, i, j;
+
+	switch_mutex_lock(reactor->tx_mutex);
+	if (!(count = reactor->tx_ready_count)) {
+		switch_mutex_unlock(reactor->tx_mutex);
+		return;
+	}
+
+	if (count > reactor->tx_work_alloc) {
+		reactor->tx_work = realloc(reactor->tx_work, sizeof(uint64_t) * reactor->tx_ready_alloc);
+		switch_assert(reactor->tx_work);
+		reactor->tx_work_alloc = reactor->tx_ready_alloc;
+	}
+
+	memcpy(reactor->tx_work, reactor->tx_ready, sizeof(uint64_t) * count);
+	reactor->tx_ready_count = 0;
+	switch_mutex_unlock(reactor->tx_mutex);
+
+	switch_mutex_lock(reactor->mutex);
+	for (i = 0; i < count; i++) {
+		struct rtp_reactor_link_s *link;
+		int n;
+
+		if (!(link = rtp_reactor_lookup(reactor, reactor->tx_work[i]))) {
+			continue;
+		}
+
+		switch_mutex_lock(link->mutex);
+
+		if (link->tx_count) {
+			memset(msgs, 0, sizeof(msgs[0]) * link->tx_count);
+
+			for (j = 0; j < link->tx_count; j++) {
+				rtp_reactor_packet_t *pkt = &link->tx[j];
+
+				iov[j].iov_base = pkt->data;
+				iov[j].iov_len = pkt->len;
+				msgs[j].msg_hdr.msg_iov = &iov[j];
+				msgs[j].msg_hdr.msg_iovlen = 1;
+				msgs[j].msg_hdr.msg_name = &pkt->addr;
+				msgs[j].msg_hdr.msg_namelen = pkt->addr_len;
+			}
+
+			n = sendmmsg(link->fd, msgs, link->tx_count, MSG_DONTWAIT);
+			reactor->tx_syscalls++;
+
+			if (n > 0) {
+				reactor->tx_packets += n;
+				reactor->tx_dropped += link->tx_count - n;
+			} else {
+				reactor->tx_dropped += link->tx_count;
+			}
+
+			link->tx_count = 0;
+		}
+
+		link->tx_pending = 0;
+		switch_mutex_unlock(link->mutex);
+	}
+	switch_mutex_unlock(reactor->mutex);
+}
+
+static void *SWITCH_THREAD_FUNC rtp_reactor_thread(switch_thread_t *thread, void *obj)
+{
+	rtp_reactor_t *reactor = (rtp_reactor_t *) obj;
+	struct epoll_event events[RTP_REACTOR_BATCH];
+	int i, n;
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Media reactor %u started\n", reactor->id);
+
+	while (reactor->running) {
+		if ((n = epoll_wait(reactor->epfd, events, RTP_REACTOR_BATCH, 1000)) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Media reactor %u epoll error: %s\n", reactor->id, strerror(errno));
+			break;
+		}
+
+		switch_mutex_lock(reactor->mutex);
+		for (i = 0; i < n; i++) {
+			struct rtp_reactor_link_s *link;
+
+			if (events[i].data.u64 == RTP_REACTOR_WAKE_KEY) {
+				uint64_t val;
+
+				if (read(reactor->wakefd, &val, sizeof(val)) < 0) {
+					/* nothing pending, harmless */
+				}
+				continue;
+			}
+
+			if ((link = rtp_reactor_lookup(reactor, events[i].data.u64))) {
+				rtp_reactor_recv(reactor, link);
+			}
+		}
+		switch_mutex_unlock(reactor->mutex);
+
+		rtp_reactor_flush(reactor);
+	}
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Media reactor %u stopped\n", reactor->id);
+
+	return NULL;
+}
+
+static void rtp_reactor_start(switch_memory_pool_t *pool)
+{
+	switch_threadattr_t *thd_attr;
+	uint32_t i;
+
+	for (i = 0; i < MEDIA_REACTOR_THREADS && i < RTP_REACTOR_MAX_THREADS; i++) {
+		rtp_reactor_t *reactor = switch_core_alloc(pool, sizeof(*reactor));
+		struct epoll_event ev = { 0 };
+
+		reactor->id = i;
+
+		if ((reactor->epfd = epoll_create1(EPOLL_CLOEXEC)) < 0 || (reactor->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Cannot create media reactor %u: %s\n", i, strerror(errno));
+			if (reactor->epfd >= 0) {
+				close(reactor->epfd);
+			}
+			break;
+		}
+
+		ev.events = EPOLLIN;
+		ev.data.u64 = RTP_REACTOR_WAKE_KEY;
+		epoll_ctl(reactor->epfd, EPOLL_CTL_ADD, reactor->wakefd, &ev);
+
+		switch_mutex_init(&reactor->mutex, SWITCH_MUTEX_NESTED, pool);
+		switch_mutex_init(&reactor->tx_mutex, SWITCH_MUTEX_NESTED, pool);
+		reactor->running = 1;
+
+		switch_threadattr_create(&thd_attr, pool);
+		switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+		switch_threadattr_priority_set(thd_attr, SWITCH_PRI_REALTIME);
+		switch_thread_create(&reactor->thread, thd_attr, rtp_reactor_thread, reactor, pool);
+
+		MEDIA_REACTORS[MEDIA_REACTOR_COUNT++] = reactor;
+	}
+
+	if (MEDIA_REACTOR_COUNT) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "Started %u media reactor thread%s\n",
+						  MEDIA_REACTOR_COUNT, MEDIA_REACTOR_COUNT == 1 ? "" : "s");
+	}
+}
+
+static void rtp_reactor_stop(void)
+{
+	uint32_t i;
+
+	for (i = 0; i < MEDIA_REACTOR_COUNT; i++) {
+		rtp_reactor_t *reactor = MEDIA_REACTORS[i];
+		switch_status_t st;
+		uint64_t one = 1;
+
+		reactor->running = 0;
+		if (write(reactor->wakefd, &one, sizeof(one)) < 0) {
+			/* the 1 second epoll timeout will catch it */
+		}
+		switch_thread_join(&st, reactor->thread);
+
+		close(reactor->wakefd);
+		close(reactor->epfd);
+		switch_safe_free(reactor->links);
+		switch_safe_free(reactor->tx_ready);
+		switch_safe_free(reactor->tx_work);
+		MEDIA_REACTORS[i] = NULL;
+	}
+
+	MEDIA_REACTOR_COUNT = 0;
+}
+
+static void rtp_reactor_attach(switch_rtp_t *rtp_session)
+{
+	rtp_reactor_t *reactor = NULL;
+	struct rtp_reactor_link_s *link;
+	struct epoll_event ev = { 0 };
+	uint32_t i, slot;
+
+	/* least loaded reactor, the count is only a hint so no locking here */
+	for (i = 0; i < MEDIA_REACTOR_COUNT; i++) {
+		if (!reactor || MEDIA_REACTORS[i]->link_count < reactor->link_count) {
+			reactor = MEDIA_REACTORS[i];
+		}
+	}
+
+	if (!reactor) {
+		return;
+	}
+
+	link = switch_core_alloc(rtp_session->pool, sizeof(*link));
+	link->reactor = reactor;
+
+	if (switch_os_sock_get(&link->fd, rtp_session->sock_input) != SWITCH_STATUS_SUCCESS) {
+		return;
+	}
+
+	switch_mutex_init(&link->mutex, SWITCH_MUTEX_NESTED, rtp_session->pool);
+	switch_thread_cond_create(&link->cond, rtp_session->pool);
+
+	switch_mutex_lock(reactor->mutex);
+
+	for (slot = 0; slot < reactor->link_alloc; slot++) {
+		if (!reactor->links[slot]) {
+			break;
+		}
+	}
+
+	if (slot == reactor->link_alloc) {
+		uint32_t alloc = reactor->link_alloc ? reactor->link_alloc * 2 : 256;
+
+		reactor->links = realloc(reactor->links, sizeof(*reactor->links) * alloc);
+		switch_assert(reactor->links);
+		memset(reactor->links + reactor->link_alloc, 0, sizeof(*reactor->links) * (alloc - reactor->link_alloc));
+		reactor->link_alloc = alloc;
+	}
+
+	link->slot = slot;
+	link->generation = ++reactor->next_generation;
+
+	ev.events = EPOLLIN;
+	ev.data.u64 = rtp_reactor_key(link);
+
+	if (epoll_ctl(reactor->epfd, EPOLL_CTL_ADD, link->fd, &ev) < 0) {
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_WARNING,
+						  "Cannot add RTP socket to media reactor %u: %s\n", reactor->id, strerror(errno));
+		switch_mutex_unlock(reactor->mutex);
+		return;
+	}
+
+	reactor->links[slot] = link;
+	reactor->link_count++;
+	switch_mutex_unlock(reactor->mutex);
+
+	rtp_session->reactor_link = link;
+}
+
+static void rtp_reactor_detach(switch_rtp_t *rtp_session)
+{
+	struct rtp_reactor_link_s *link;
+	rtp_reactor_t *reactor;
+
+	if (!(link = rtp_session->reactor_link)) {
+		return;
+	}
+
+	rtp_session->reactor_link = NULL;
+	reactor = link->reactor;
+
+	switch_mutex_lock(reactor->mutex);
+	epoll_ctl(reactor->epfd, EPOLL_CTL_DEL, link->fd, NULL);
+	if (reactor->links[link->slot] == link) {
+		reactor->links[link->slot] = NULL;
+		reactor->link_count--;
+	}
+	switch_mutex_unlock(reactor->mutex);
+
+	/* the link itself lives in the session pool, a reader may still be parked on it */
+	switch_mutex_lock(link->mutex);
+	link->dead = 1;
+	switch_thread_cond_broadcast(link->cond);
+	switch_mutex_unlock(link->mutex);
+}
+
+static switch_status_t rtp_reactor_poll(struct rtp_reactor_link_s *link, int *fdr, switch_interval_time_t timeout)
+{
+	switch_status_t status = SWITCH_STATUS_TIMEOUT;
+
+	switch_mutex_lock(link->mutex);
+	if (link->rx_head == link->rx_tail && !link->dead && timeout > 0) {
+		link->waiting = 1;
+		switch_thread_cond_timedwait(link->cond, link->mutex, timeout);
+		link->waiting = 0;
+	}
+
+	if (link->rx_head != link->rx_tail) {
+		*fdr = 1;
+		status = SWITCH_STATUS_SUCCESS;
+	}
+	switch_mutex_unlock(link->mutex);
+
+	return status;
+}
+
+static switch_status_t rtp_reactor_read(struct rtp_reactor_link_s *link, switch_sockaddr_t *from, void *buf, switch_size_t *bytes)
+{
+	switch_status_t status = SWITCH_STATUS_FALSE;
+	switch_size_t len = 0;
+
+	switch_mutex_lock(link->mutex);
+	while (link->rx_head != link->rx_tail) {
+		rtp_reactor_packet_t *pkt = &link->rx[link->rx_head & (RTP_REACTOR_RX_SLOTS - 1)];
+
+		link->rx_head++;
+
+		if (!pkt->len) {
+			continue;
+		}
+
+		len = pkt->len > *bytes ? *bytes : pkt->len;
+		memcpy(buf, pkt->data, len);
+
+		memcpy(&from->sa, &pkt->addr, pkt->addr_len);
+		from->salen = pkt->addr_len;
+		from->family = ((struct sockaddr *) &pkt->addr)->sa_family;
+		from->port = ntohs(from->sa.sin.sin_port);
+
+		if (from->family == AF_INET6) {
+			from->ipaddr_ptr = &(from->sa.sin6.sin6_addr);
+			from->ipaddr_len = sizeof(struct in6_addr);
+			from->addr_str_len = 46;
+		} else {
+			from->ipaddr_ptr = &(from->sa.sin.sin_addr);
+			from->ipaddr_len = sizeof(struct in_addr);
+			from->addr_str_len = 16;
+		}
+
+		status = SWITCH_STATUS_SUCCESS;
+		break;
+	}
+	switch_mutex_unlock(link->mutex);
+
+	*bytes = len;
+
+	return status;
+}
+
+static switch_status_t rtp_reactor_write(struct rtp_reactor_link_s *link, switch_sockaddr_t *to, const void *buf, switch_size_t len)
+{
+	rtp_reactor_t *reactor = link->reactor;
+	rtp_reactor_packet_t *pkt;
+	int kick;
+
+	if (len > RTP_REACTOR_PACKET_LEN || to->salen > sizeof(pkt->addr)) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	switch_mutex_lock(link->mutex);
+	if (link->dead || link->tx_count == RTP_REACTOR_TX_SLOTS) {
+		switch_mutex_unlock(link->mutex);
+		switch_mutex_lock(reactor->tx_mutex);
+		reactor->tx_fallback++;
+		switch_mutex_unlock(reactor->tx_mutex);
+		return SWITCH_STATUS_FALSE;
+	}
+
+	pkt = &link->tx[link->tx_count++];
+	memcpy(pkt->data, buf, len);
+	pkt->len = (uint32_t) len;
+	memcpy(&pkt->addr, &to->sa, to->salen);
+	pkt->addr_len = to->salen;
+
+	kick = !link->tx_pending;
+	link->tx_pending = 1;
+	switch_mutex_unlock(link->mutex);
+
+	if (kick) {
+		int wake;
+
+		switch_mutex_lock(reactor->tx_mutex);
+		if (reactor->tx_ready_count == reactor->tx_ready_alloc) {
+			reactor->tx_ready_alloc = reactor->tx_ready_alloc ? reactor->tx_ready_alloc * 2 : 256;
+			reactor->tx_ready = realloc(reactor->tx_ready, sizeof(uint64_t) * reactor->tx_ready_alloc);
+			switch_assert(reactor->tx_ready);
+		}
+		reactor->tx_ready[reactor->tx_ready_count++] = rtp_reactor_key(link);
+		/* only the first writer after a flush pays for the wakeup */
+		wake = reactor->tx_ready_count == 1;
+		switch_mutex_unlock(reactor->tx_mutex);
+
+		if (wake) {
+			uint64_t one = 1;
+
+			if (write(reactor->wakefd, &one, sizeof(one)) < 0) {
+				/* counter saturated, the reactor is already awake */
+			}
+		}
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+#endif
+
+SWITCH_DECLARE(uint32_t) switch_rtp_set_media_reactor_threads(uint32_t threads)
+{
+#ifdef RTP_MEDIA_REACTOR
+	if (threads > RTP_REACTOR_MAX_THREADS) {
+		threads = RTP_REACTOR_MAX_THREADS;
+	}
+
+	if (!global_init) {
+		MEDIA_REACTOR_THREADS = threads;
+	}
+#else
+	if (threads) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "The media reactor is not available on this platform\n");
+	}
+#endif
+
+	return MEDIA_REACTOR_THREADS;
+}
+
+SWITCH_DECLARE(void) switch_rtp_media_reactor_status(switch_stream_handle_t *stream)
+{
+#ifdef RTP_MEDIA_REACTOR
+	uint64_t rx_syscalls = 0, rx_packets = 0, tx_syscalls = 0, tx_packets = 0;
+	uint32_t i, links = 0;
+
+	if (!MEDIA_REACTOR_COUNT) {
+		stream->write_function(stream, "Media reactor disabled\n");
+		return;
+	}
+
+	for (i = 0; i < MEDIA_REACTOR_COUNT; i++) {
+		rtp_reactor_t *reactor = MEDIA_REACTORS[i];
+
+		stream->write_function(stream,
+							   "reactor %u: sockets %u rx %"SWITCH_UINT64_T_FMT"/%"SWITCH_UINT64_T_FMT" (%.2f pkts/syscall) "
+							   "tx %"SWITCH_UINT64_T_FMT"/%"SWITCH_UINT64_T_FMT" (%.2f pkts/syscall) "
+							   "rx_dropped %"SWITCH_UINT64_T_FMT" rx_truncated %"SWITCH_UINT64_T_FMT
+							   " tx_dropped %"SWITCH_UINT64_T_FMT" tx_fallback %"SWITCH_UINT64_T_FMT"\n",
+							   reactor->id, reactor->link_count,
+							   reactor->rx_packets, reactor->rx_syscalls, reactor->rx_syscalls ? (double) reactor->rx_packets / reactor->rx_syscalls : 0.0,
+							   reactor->tx_packets, reactor->tx_syscalls, reactor->tx_syscalls ? (double) reactor->tx_packets / reactor->tx_syscalls : 0.0,
+							   reactor->rx_dropped, reactor->rx_truncated, reactor->tx_dropped, reactor->tx_fallback);
+
+		links += reactor->link_count;
+		rx_syscalls += reactor->rx_syscalls;
+		rx_packets += reactor->rx_packets;
+		tx_syscalls += reactor->tx_syscalls;
+		tx_packets += reactor->tx_packets;
+	}
+
+	stream->write_function(stream, "total: %u reactor%s, %u sockets, rx %.2f pkts/syscall, tx %.2f pkts/syscall\n",
+						   MEDIA_REACTOR_COUNT, MEDIA_REACTOR_COUNT == 1 ? "" : "s", links,
+						   rx_syscalls ? (double) rx_packets / rx_syscalls : 0.0, tx_syscalls ? (double) tx_packets / tx_syscalls : 0.0);
+#else
+	stream->write_function(stream, "Media reactor not available on this platform\n");
+#endif
+}
+
+static switch_status_t rtp_read_poll(switch_rtp_t *rtp_session, int *fdr, switch_interval_time_t timeout)
+{
+#ifdef RTP_MEDIA_REACTOR
+	struct rtp_reactor_link_s *link = rtp_session->reactor_link;
+
+	if (link && !link->dead) {
+		return rtp_reactor_poll(link, fdr, timeout);
+	}
+#endif
+
+	return switch_poll(rtp_session->read_pollfd, 1, fdr, timeout);
+}
+
+static switch_status_t rtp_read_socket(switch_rtp_t *rtp_session, switch_size_t *bytes)
+{
+#ifdef RTP_MEDIA_REACTOR
+	struct rtp_reactor_link_s *link = rtp_session->reactor_link;
+
+	if (link && !link->dead) {
+		return rtp_reactor_read(link, rtp_session->from_addr, &rtp_session->recv_msg, bytes);
+	}
+#endif
+
+	return switch_socket_recvfrom(rtp_session->from_addr, rtp_session->sock_input, 0, (void *) &rtp_session->recv_msg, bytes);
+}
+
+static switch_status_t rtp_write_socket(switch_rtp_t *rtp_session, void *data, switch_size_t *bytes)
+{
+#ifdef RTP_MEDIA_REACTOR
+	struct rtp_reactor_link_s *link = rtp_session->reactor_link;
+
+	if (link && rtp_session->sock_output == rtp_session->sock_input &&
+		rtp_reactor_write(link, rtp_session->remote_addr, data, *bytes) == SWITCH_STATUS_SUCCESS) {
+		return SWITCH_STATUS_SUCCESS;
+	}
+#endif
+
+	return switch_socket_sendto(rtp_session->sock_output, rtp_session->remote_addr, 0, data, bytes);
+}
+
 SWITCH_DECLARE(void) switch_rtp_init(switch_memory_pool_t *pool)
 {
 #ifdef ENABLE_ZRTP
@@ -1513,6 +2181,11 @@ SWITCH_DECLARE(void) switch_rtp_init(switch_memory_pool_t *pool)
 	srtp_init();
 #endif
 	switch_mutex_init(&port_lock, SWITCH_MUTEX_NESTED, pool);
+#ifdef RTP_MEDIA_REACTOR
+	if (MEDIA_REACTOR_THREADS) {
+		rtp_reactor_start(pool);
+	}
+#endif
 	global_init = 1;
 }
 
@@ -2448,6 +3121,10 @@ SWITCH_DECLARE(void) switch_rtp_shutdown(void)
 	switch_core_hash_destroy(&alloc_hash);
 	switch_mutex_unlock(port_lock);
 
+#ifdef RTP_MEDIA_REACTOR
+	rtp_reactor_stop();
+#endif
+
 #ifdef ENABLE_ZRTP
 	if (zrtp_on) {
 		zrtp_status_t status = zrtp_status_ok;
@@ -2799,6 +3476,13 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_set_local_address(switch_rtp_t *rtp_s
 
 	switch_socket_create_pollset(&rtp_session->read_pollfd, rtp_session->sock_input, SWITCH_POLLIN | SWITCH_POLLERR, rtp_session->pool);
 
+#ifdef RTP_MEDIA_REACTOR
+	if (MEDIA_REACTOR_COUNT && rtp_session->flags[SWITCH_RTP_FLAG_NOBLOCK] && !rtp_session->flags[SWITCH_RTP_FLAG_VIDEO] &&
+		!rtp_session->flags[SWITCH_RTP_FLAG_TEXT] && !rtp_session->flags[SWITCH_RTP_FLAG_UDPTL]) {
+		rtp_reactor_attach(rtp_session);
+	}
+#endif
+
 	if (rtp_session->flags[SWITCH_RTP_FLAG_ENABLE_RTCP]) {
 		if ((status = enable_local_rtcp_socket(rtp_session, err)) == SWITCH_STATUS_SUCCESS) {
 			*err = "Success";
@@ -2975,6 +3659,9 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_udptl_mode(switch_rtp_t *rtp_session)
 
 	switch_rtp_set_flag(rtp_session, SWITCH_RTP_FLAG_UDPTL);
 	switch_rtp_set_flag(rtp_session, SWITCH_RTP_FLAG_PROXY_MEDIA);
+#ifdef RTP_MEDIA_REACTOR
+	rtp_reactor_detach(rtp_session);
+#endif
 	switch_socket_opt_set(rtp_session->sock_input, SWITCH_SO_NONBLOCK, FALSE);
 	switch_rtp_clear_flag(rtp_session, SWITCH_RTP_FLAG_NOBLOCK);
 
@@ -4895,6 +5582,9 @@ SWITCH_DECLARE(void) switch_rtp_kill_socket(switch_rtp_t *rtp_session)
 {
 	switch_assert(rtp_session != NULL);
 	switch_mutex_lock(rtp_session->flag_mutex);
+#ifdef RTP_MEDIA_REACTOR
+	rtp_reactor_detach(rtp_session);
+#endif
 	if (rtp_session->flags[SWITCH_RTP_FLAG_IO]) {
 		rtp_session->flags[SWITCH_RTP_FLAG_IO] = 0;
 		if (rtp_session->sock_input) {
@@ -5525,7 +6215,7 @@ static switch_size_t do_flush(switch_rtp_t *rtp_session, int force, switch_size_
 		do {
 			if (switch_rtp_ready(rtp_session)) {
 				bytes = sizeof(rtp_msg_t);
-				switch_socket_recvfrom(rtp_session->from_addr, rtp_session->sock_input, 0, (void *) &rtp_session->recv_msg, &bytes);
+				rtp_read_socket(rtp_session, &bytes);
 
 				if (bytes) {
 					int do_cng = 0;
@@ -5664,7 +6354,7 @@ static switch_status_t read_rtp_packet(switch_rtp_t *rtp_session, switch_size_t
 			}
 		}
 
-		poll_status = switch_poll(rtp_session->read_pollfd, 1, &fdr, to);
+		poll_status = rtp_read_poll(rtp_session, &fdr, to);
 
 		if (rtp_session->flags[SWITCH_RTP_FLAG_USE_TIMER] && rtp_session->timer.interval) {
 			switch_core_timer_sync(&rtp_session->timer);
@@ -5690,7 +6380,7 @@ static switch_status_t read_rtp_packet(switch_rtp_t *rtp_session, switch_size_t
 	memset(&rtp_session->last_rtp_hdr, 0, sizeof(rtp_session->last_rtp_hdr));
 
 	if (poll_status == SWITCH_STATUS_SUCCESS) {
-		status = switch_socket_recvfrom(rtp_session->from_addr, rtp_session->sock_input, 0, (void *) &rtp_session->recv_msg, bytes);
+		status = rtp_read_socket(rtp_session, bytes);
 	} else {
 		*bytes = 0;
 	}
@@ -7032,7 +7722,7 @@ static int rtp_common_read(switch_rtp_t *rtp_session, switch_payload_t *payload_
 			rtp_session->read_pollfd) {
 
 			if (rtp_session->jb && !rtp_session->pause_jb && jb_valid(rtp_session)) {
-				while (switch_poll(rtp_session->read_pollfd, 1, &fdr, 0) == SWITCH_STATUS_SUCCESS) {
+				while (rtp_read_poll(rtp_session, &fdr, 0) == SWITCH_STATUS_SUCCESS) {
 					status = read_rtp_packet(rtp_session, &bytes, flags, pmapP, SWITCH_STATUS_SUCCESS, SWITCH_FALSE);
 
 					if (status == SWITCH_STATUS_GENERR) {
@@ -7055,7 +7745,7 @@ static int rtp_common_read(switch_rtp_t *rtp_session, switch_payload_t *payload_
 
 			} else if ((rtp_session->flags[SWITCH_RTP_FLAG_AUTOFLUSH] || rtp_session->flags[SWITCH_RTP_FLAG_STICKY_FLUSH])) {
 
-				if (switch_poll(rtp_session->read_pollfd, 1, &fdr, 0) == SWITCH_STATUS_SUCCESS) {
+				if (rtp_read_poll(rtp_session, &fdr, 0) == SWITCH_STATUS_SUCCESS) {
 					status = read_rtp_packet(rtp_session, &bytes, flags, pmapP, SWITCH_STATUS_SUCCESS, SWITCH_FALSE);
 					if (status == SWITCH_STATUS_GENERR) {
 						ret = -1;
@@ -7074,7 +7764,7 @@ static int rtp_common_read(switch_rtp_t *rtp_session, switch_payload_t *payload_
 					}
 
 					if (bytes) {
-						if (switch_poll(rtp_session->read_pollfd, 1, &fdr, 0) == SWITCH_STATUS_SUCCESS) {
+						if (rtp_read_poll(rtp_session, &fdr, 0) == SWITCH_STATUS_SUCCESS) {
 							rtp_session->hot_hits++;//+= rtp_session->samples_per_interval;
 
 							switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_DEBUG10, "%s Hot Hit %d\n",
@@ -7184,7 +7874,7 @@ static int rtp_common_read(switch_rtp_t *rtp_session, switch_payload_t *payload_
 				pt = 0;
 			}
 
-			poll_status = switch_poll(rtp_session->read_pollfd, 1, &fdr, pt);
+			poll_status = rtp_read_poll(rtp_session, &fdr, pt);
 
 			if (!rtp_session->flags[SWITCH_RTP_FLAG_VIDEO] && rtp_session->dtmf_data.out_digit_dur > 0) {
 				return_cng_frame();
@@ -8515,7 +9205,7 @@ static int rtp_common_write(switch_rtp_t *rtp_session,
 		//
 		//	//switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "SEND %u\n", ntohs(send_msg->header.seq));
 		//}
-		if (switch_socket_sendto(rtp_session->sock_output, rtp_session->remote_addr, 0, (void *) send_msg, &bytes) != SWITCH_STATUS_SUCCESS) {
+		if (rtp_write_socket(rtp_session, (void *) send_msg, &bytes) != SWITCH_STATUS_SUCCESS) {
 			rtp_session->seq -= delta;
 
 			ret = -1;
@@ -35,6 +35,12 @@
 #include <stdio.h>
 #include "private/switch_core_pvt.h"
 
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <limits.h>
+#endif
+
 #ifdef HAVE_TIMERFD_CREATE
 #include <sys/timerfd.h>
 #endif
@@ -524,6 +530,418 @@ static switch_status_t _timerfd_destroy(switch_timer_t *timer)
 #endif
 ////////
 
+/////////
+/*
+  Timing wheel for soft timers.  Timers with the same interval that were started on the same
+  millisecond phase share a group; one thread walks a two level wheel every millisecond and fires
+  each due group with a single wakeup (a futex on Linux) instead of waking every timer on its own.
+*/
+
+#define WHEEL_L0_BITS 8
+#define WHEEL_L0_SIZE (1 << WHEEL_L0_BITS)
+#define WHEEL_L0_MASK (WHEEL_L0_SIZE - 1)
+#define WHEEL_L1_SIZE 64
+#define WHEEL_L1_MASK (WHEEL_L1_SIZE - 1)
+
+#if defined(__linux__) && defined(SYS_futex)
+#define WHEEL_FUTEX 1
+#endif
+
+typedef struct wheel_group wheel_group_t;
+
+struct wheel_group {
+	volatile uint64_t tick;
+#ifdef WHEEL_FUTEX
+	volatile int32_t seq;
+#else
+	switch_mutex_t *mutex;
+	switch_thread_cond_t *cond;
+#endif
+	uint32_t interval;
+	uint32_t phase;
+	uint32_t members;
+	uint32_t scheduled;
+	uint64_t due;
+	wheel_group_t *next;
+	wheel_group_t *gnext;
+};
+
+struct wheel_timer {
+	wheel_group_t *group;
+	uint64_t reference;
+	uint64_t start;
+	uint32_t ready;
+};
+typedef struct wheel_timer wheel_timer_t;
+
+static struct {
+	switch_mutex_t *mutex;
+	switch_thread_cond_t *cond;
+	switch_thread_t *thread;
+	wheel_group_t *l0[WHEEL_L0_SIZE];
+	wheel_group_t *l1[WHEEL_L1_SIZE];
+	wheel_group_t *groups;
+	uint64_t now;
+	switch_time_t epoch;
+	uint32_t timers;
+	int running;
+} WHEEL;
+
+static int USE_WHEEL = 0;
+
+SWITCH_DECLARE(void) switch_time_set_wheel(switch_bool_t enable)
+{
+	USE_WHEEL = enable ? 1 : 0;
+}
+
+static void wheel_insert(wheel_group_t *group)
+{
+	wheel_group_t **slot;
+
+	if (group->due - WHEEL.now < WHEEL_L0_SIZE) {
+		slot = &WHEEL.l0[group->due & WHEEL_L0_MASK];
+	} else if ((group->due >> WHEEL_L0_BITS) - (WHEEL.now >> WHEEL_L0_BITS) < WHEEL_L1_SIZE) {
+		slot = &WHEEL.l1[(group->due >> WHEEL_L0_BITS) & WHEEL_L1_MASK];
+	} else {
+		/* further out than the wheel reaches, park it in the last bucket and look again when it cascades */
+		slot = &WHEEL.l1[((WHEEL.now >> WHEEL_L0_BITS) + WHEEL_L1_MASK) & WHEEL_L1_MASK];
+	}
+
+	group->next = *slot;
+	*slot = group;
+}
+
+static void wheel_fire(wheel_group_t *group)
+{
+	group->tick++;
+
+#ifdef WHEEL_FUTEX
+	__sync_fetch_and_add(&group->seq, 1);
+	syscall(SYS_futex, &group->seq, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#else
+	switch_mutex_lock(group->mutex);
+	switch_thread_cond_broadcast(group->cond);
+	switch_mutex_unlock(group->mutex);
+#endif
+}
+
+static void wheel_advance(void)
+{
+	wheel_group_t *group, *next;
+
+	WHEEL.now++;
+
+	if (!(WHEEL.now & WHEEL_L0_MASK)) {
+		uint32_t x = (WHEEL.now >> WHEEL_L0_BITS) & WHEEL_L1_MASK;
+
+		group = WHEEL.l1[x];
+		WHEEL.l1[x] = NULL;
+
+		for (; group; group = next) {
+			next = group->next;
+			wheel_insert(group);
+		}
+	}
+
+	group = WHEEL.l0[WHEEL.now & WHEEL_L0_MASK];
+	WHEEL.l0[WHEEL.now & WHEEL_L0_MASK] = NULL;
+
+	for (; group; group = next) {
+		next = group->next;
+
+		if (group->due != WHEEL.now) {
+			wheel_insert(group);
+			continue;
+		}
+
+		wheel_fire(group);
+
+		if (group->members) {
+			group->due += group->interval;
+			wheel_insert(group);
+		} else {
+			group->scheduled = 0;
+		}
+	}
+}
+
+static void *SWITCH_THREAD_FUNC wheel_thread(switch_thread_t *thread, void *obj)
+{
+	uint64_t target;
+#ifdef HAVE_TIMERFD_CREATE
+	struct itimerspec spec = { { 0 } };
+	int fd = timerfd_create(CLOCK_MONOTONIC, 0);
+
+	if (fd > -1) {
+		spec.it_interval.tv_nsec = 1000000;
+		spec.it_value.tv_nsec = 1000000;
+
+		if (timerfd_settime(fd, 0, &spec, NULL)) {
+			close(fd);
+			fd = -1;
+		}
+	}
+#endif
+
+	switch_mutex_lock(WHEEL.mutex);
+	while (WHEEL.running) {
+		if (!WHEEL.timers) {
+			switch_thread_cond_wait(WHEEL.cond, WHEEL.mutex);
+			/* nothing moved while idle, carry on from where the wheel stopped */
+			WHEEL.epoch = switch_mono_micro_time_now() - (switch_time_t) WHEEL.now * 1000;
+			continue;
+		}
+
+		target = (uint64_t) (switch_mono_micro_time_now() - WHEEL.epoch) / 1000;
+
+		while (WHEEL.now < target) {
+			wheel_advance();
+		}
+		switch_mutex_unlock(WHEEL.mutex);
+
+#ifdef HAVE_TIMERFD_CREATE
+		if (fd > -1) {
+			uint64_t exp;
+
+			if (read(fd, &exp, sizeof(exp)) < 0) {
+				do_sleep(1000);
+			}
+		} else
+#endif
+		{
+			do_sleep(1000);
+		}
+
+		switch_mutex_lock(WHEEL.mutex);
+	}
+	switch_mutex_unlock(WHEEL.mutex);
+
+#ifdef HAVE_TIMERFD_CREATE
+	if (fd > -1) {
+		close(fd);
+	}
+#endif
+
+	return NULL;
+}
+
+static switch_status_t _wheel_init(switch_timer_t *timer)
+{
+	wheel_timer_t *wt;
+	wheel_group_t *group;
+	uint32_t phase;
+
+	if (timer->interval < 1 || !WHEEL.mutex) {
+		return SWITCH_STATUS_GENERR;
+	}
+
+	if (!(wt = switch_core_alloc(timer->memory_pool, sizeof(*wt)))) {
+		return SWITCH_STATUS_MEMERR;
+	}
+
+	switch_mutex_lock(WHEEL.mutex);
+
+	if (!WHEEL.thread) {
+		switch_threadattr_t *thd_attr = NULL;
+
+		WHEEL.running = 1;
+		WHEEL.epoch = switch_mono_micro_time_now();
+		switch_threadattr_create(&thd_attr, module_pool);
+		switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+		switch_threadattr_priority_set(thd_attr, SWITCH_PRI_REALTIME);
+		switch_thread_create(&WHEEL.thread, thd_attr, wheel_thread, NULL, module_pool);
+	}
+
+	phase = (uint32_t) (WHEEL.now % timer->interval);
+
+	for (group = WHEEL.groups; group; group = group->gnext) {
+		if (group->interval == (uint32_t) timer->interval && group->phase == phase) {
+			break;
+		}
+	}
+
+	if (!group) {
+		group = switch_core_alloc(module_pool, sizeof(*group));
+		group->interval = timer->interval;
+		group->phase = phase;
+#ifndef WHEEL_FUTEX
+		switch_mutex_init(&group->mutex, SWITCH_MUTEX_NESTED, module_pool);
+		switch_thread_cond_create(&group->cond, module_pool);
+#endif
+		group->gnext = WHEEL.groups;
+		WHEEL.groups = group;
+	}
+
+	if (!group->scheduled) {
+		group->due = WHEEL.now + ((group->phase + group->interval - (WHEEL.now % group->interval)) % group->interval);
+		if (group->due <= WHEEL.now) {
+			group->due += group->interval;
+		}
+		group->scheduled = 1;
+		wheel_insert(group);
+	}
+
+	group->members++;
+
+	if (!WHEEL.timers++) {
+		switch_thread_cond_signal(WHEEL.cond);
+	}
+
+	wt->group = group;
+	wt->start = wt->reference = group->tick;
+	wt->start -= 2; /* switch_core_timer_init sets samplecount to samples, this makes first next() step once */
+	wt->ready = 1;
+
+	switch_mutex_unlock(WHEEL.mutex);
+
+	timer->start = switch_micro_time_now();
+	timer->private_info = wt;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t _wheel_step(switch_timer_t *timer)
+{
+	wheel_timer_t *wt = timer->private_info;
+	uint64_t samples;
+
+	if (!wt->ready) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	samples = (uint64_t)timer->samples * (wt->reference - wt->start);
+
+	if (samples > UINT32_MAX) {
+		wt->start = wt->reference - 1; /* Must have a diff */
+		samples = timer->samples;
+	}
+
+	timer->samplecount = (uint32_t) samples;
+	wt->reference++;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t _wheel_sync(switch_timer_t *timer)
+{
+	wheel_timer_t *wt = timer->private_info;
+
+	if (!wt->ready) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	wt->reference = timer->tick = wt->group->tick;
+
+	return _wheel_step(timer);
+}
+
+static switch_status_t _wheel_next(switch_timer_t *timer)
+{
+	wheel_timer_t *wt = timer->private_info;
+	wheel_group_t *group = wt->group;
+
+	/* a timer that was not serviced for a while would otherwise return instantly until it caught up */
+	if ((int64_t) (wt->reference - group->tick) < -1) {
+		wt->reference = timer->tick = group->tick;
+	}
+
+	_wheel_step(timer);
+
+	while (WHEEL.running && wt->ready && group->tick < wt->reference) {
+#ifdef WHEEL_FUTEX
+		struct timespec ts;
+		int32_t seq = __sync_fetch_and_add(&group->seq, 0);
+
+		if (group->tick >= wt->reference) {
+			break;
+		}
+
+		ts.tv_sec = 0;
+		ts.tv_nsec = (long) group->interval * 2000000;
+		if (ts.tv_nsec >= 1000000000) {
+			ts.tv_sec = ts.tv_nsec / 1000000000;
+			ts.tv_nsec %= 1000000000;
+		}
+
+		syscall(SYS_futex, &group->seq, FUTEX_WAIT_PRIVATE, seq, &ts, NULL, 0);
+#else
+		switch_mutex_lock(group->mutex);
+		if (group->tick < wt->reference) {
+			switch_thread_cond_timedwait(group->cond, group->mutex, (switch_interval_time_t) group->interval * 2000);
+		}
+		switch_mutex_unlock(group->mutex);
+#endif
+	}
+
+	return WHEEL.running ? SWITCH_STATUS_SUCCESS : SWITCH_STATUS_FALSE;
+}
+
+static switch_status_t _wheel_check(switch_timer_t *timer, switch_bool_t step)
+{
+	wheel_timer_t *wt = timer->private_info;
+
+	if (!wt->ready) {
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	timer->tick = wt->group->tick;
+
+	if (timer->tick < wt->reference) {
+		timer->diff = (switch_size_t)(wt->reference - timer->tick);
+		return SWITCH_STATUS_FALSE;
+	}
+
+	timer->diff = 0;
+
+	if (step) {
+		_wheel_step(timer);
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t _wheel_destroy(switch_timer_t *timer)
+{
+	wheel_timer_t *wt = timer->private_info;
+
+	if (!wt || !wt->ready) {
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	switch_mutex_lock(WHEEL.mutex);
+	wt->ready = 0;
+	wt->group->members--;
+	WHEEL.timers--;
+	switch_mutex_unlock(WHEEL.mutex);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static void wheel_shutdown(void)
+{
+	switch_status_t st;
+	wheel_group_t *group;
+
+	if (!WHEEL.thread) {
+		return;
+	}
+
+	switch_mutex_lock(WHEEL.mutex);
+	WHEEL.running = 0;
+	switch_thread_cond_signal(WHEEL.cond);
+
+	/* let anyone still parked in next() see the wheel is gone */
+	for (group = WHEEL.groups; group; group = group->gnext) {
+		wheel_fire(group);
+	}
+	switch_mutex_unlock(WHEEL.mutex);
+
+	switch_thread_join(&st, WHEEL.thread);
+	WHEEL.thread = NULL;
+}
+
+////////
+
 
 static switch_time_t time_now(int64_t offset)
 {
@@ -699,6 +1117,10 @@ static switch_status_t timer_init(switch_timer_t *timer)
 		return SWITCH_STATUS_SUCCESS;
 	}
 
+	if (USE_WHEEL) {
+		return _wheel_init(timer);
+	}
+
 #ifdef HAVE_TIMERFD_CREATE
 	if (TFD == 2) {
 		return _timerfd_init(timer);
@@ -770,6 +1192,10 @@ static switch_status_t timer_step(switch_timer_t *timer)
 		return SWITCH_STATUS_FALSE;
 	}
 
+	if (USE_WHEEL) {
+		return _wheel_step(timer);
+	}
+
 #ifdef HAVE_TIMERFD_CREATE
 	if (TFD == 2) {
 		return _timerfd_step(timer);
@@ -804,6 +1230,10 @@ static switch_status_t timer_sync(switch_timer_t *timer)
 		return timer_generic_sync(timer);
 	}
 
+	if (USE_WHEEL) {
+		return _wheel_sync(timer);
+	}
+
 #ifdef HAVE_TIMERFD_CREATE
 	if (TFD == 2) {
 		return timer_generic_sync(timer);
@@ -841,6 +1271,10 @@ static switch_status_t timer_next(switch_timer_t *timer)
 		return SWITCH_STATUS_FALSE;
 	}
 
+	if (USE_WHEEL) {
+		return _wheel_next(timer);
+	}
+
 #ifdef HAVE_TIMERFD_CREATE
 	if (TFD == 2) {
 		return _timerfd_next(timer);
@@ -898,6 +1332,10 @@ static switch_status_t timer_check(switch_timer_t *timer, switch_bool_t step)
 		return SWITCH_STATUS_FALSE;
 	}
 
+	if (USE_WHEEL) {
+		return _wheel_check(timer, step);
+	}
+
 #ifdef HAVE_TIMERFD_CREATE
 	if (TFD == 2) {
 		return _timerfd_check(timer, step);
@@ -943,6 +1381,10 @@ static switch_status_t timer_destroy(switch_timer_t *timer)
 		return SWITCH_STATUS_SUCCESS;
 	}
 
+	if (USE_WHEEL) {
+		return _wheel_destroy(timer);
+	}
+
 #ifdef HAVE_TIMERFD_CREATE
 	if (TFD == 2) {
 		return _timerfd_destroy(timer);
@@ -1516,6 +1958,10 @@ SWITCH_MODULE_LOAD_FUNCTION(softtimer_load)
 	memset(&globals, 0, sizeof(globals));
 	switch_mutex_init(&globals.mutex, SWITCH_MUTEX_NESTED, module_pool);
 
+	memset(&WHEEL, 0, sizeof(WHEEL));
+	switch_mutex_init(&WHEEL.mutex, SWITCH_MUTEX_NESTED, module_pool);
+	switch_thread_cond_create(&WHEEL.cond, module_pool);
+
 	if ((switch_event_bind_removable(modname, SWITCH_EVENT_RELOADXML, NULL, event_handler, NULL, &NODE) != SWITCH_STATUS_SUCCESS)) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Couldn't bind!\n");
 	}
@@ -1576,6 +2022,8 @@ SWITCH_MODULE_SHUTDOWN_FUNCTION(softtimer_shutdown)
 {
 	globals.use_cond_yield = 0;
 
+	wheel_shutdown();
+
 	if (globals.RUNNING == 1) {
 		switch_mutex_lock(globals.mutex);
 		globals.RUNNING = -1;
@@ -206,6 +206,37 @@ static void *XML_OPEN_ROOT_FUNCTION_USER_DATA = NULL;
 static switch_hash_t *CACHE_HASH = NULL;
 static switch_hash_t *CACHE_EXPIRES_HASH = NULL;
 
+#define RESULT_CACHE_MAX_PARAMS 32
+
+/* A binding result shared by every lookup with the same key until it expires.
+   While the first fetch is in flight the entry is pending and identical lookups wait on its cond.
+   An entry dropped from the hash while it is pending or still has waiters is an orphan, whoever
+   leaves it last (the fetcher or the last waiter) frees it. */
+typedef struct xml_result_cache_entry_s {
+	switch_xml_t xml;
+	switch_time_t expires;
+	switch_xml_section_t section;
+	switch_memory_pool_t *pool;
+	switch_thread_cond_t *cond;
+	uint32_t waiters;
+	uint8_t pending;
+	uint8_t orphan;
+} xml_result_cache_entry_t;
+
+static struct {
+	switch_mutex_t *mutex;
+	switch_hash_t *hash;
+	switch_xml_section_t sections;
+	uint32_t ttl;
+	char *key_params_str;
+	char *key_params[RESULT_CACHE_MAX_PARAMS];
+	int key_param_count;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t coalesced;
+	uint64_t expired;
+} RESULT_CACHE;
+
 struct xml_section_t {
 	const char *name;
 	/* switch_xml_section_t section; */
@@ -1672,18 +1703,12 @@ SWITCH_DECLARE(switch_xml_t) switch_xml_parse_file(const char *file)
 	return xml;
 }
 
-SWITCH_DECLARE(switch_status_t) switch_xml_locate(const char *section,
-												  const char *tag_name,
-												  const char *key_name,
-												  const char *key_value,
-												  switch_xml_t *root, switch_xml_t *node, switch_event_t *params, switch_bool_t clone)
+static switch_xml_t xml_locate_bindings(const char *section, switch_xml_section_t sections, const char *tag_name, const char *key_name,
+										  const char *key_value, switch_event_t *params)
 {
 	switch_xml_t conf = NULL;
-	switch_xml_t tag = NULL;
 	switch_xml_t xml = NULL;
 	switch_xml_binding_t *binding;
-	uint8_t loops = 0;
-	switch_xml_section_t sections = BINDINGS ? switch_xml_parse_section_string(section) : 0;
 
 	switch_thread_rwlock_rdlock(B_RWLOCK);
 
@@ -1720,6 +1745,175 @@ SWITCH_DECLARE(switch_status_t) switch_xml_locate(const char *section,
 	}
 	switch_thread_rwlock_unlock(B_RWLOCK);
 
+	return xml;
+}
+
+static void xml_result_cache_entry_free(xml_result_cache_entry_t *entry)
+{
+	switch_xml_free(entry->xml);
+
+	if (entry->pool) {
+		switch_core_destroy_memory_pool(&entry->pool);
+	}
+
+	free(entry);
+}
+
+/* the entry is already out of the hash, free it unless a fetcher or a waiter still holds it; returns 1 when freed */
+static int xml_result_cache_entry_drop(xml_result_cache_entry_t *entry)
+{
+	if (entry->pending || entry->waiters) {
+		entry->orphan = 1;
+		return 0;
+	}
+
+	xml_result_cache_entry_free(entry);
+
+	return 1;
+}
+
+/* hand out one more reference to a cached document, the caller releases it with switch_xml_free() */
+static switch_xml_t xml_result_cache_take(xml_result_cache_entry_t *entry)
+{
+	if (entry->xml) {
+		switch_mutex_lock(REFLOCK);
+		entry->xml->refs++;
+		switch_mutex_unlock(REFLOCK);
+	}
+
+	return entry->xml;
+}
+
+static char *xml_result_cache_key(const char *section, const char *tag_name, const char *key_name, const char *key_value, switch_event_t *params)
+{
+	switch_stream_handle_t stream = { 0 };
+	int i;
+
+	SWITCH_STANDARD_STREAM(stream);
+	stream.write_function(&stream, "%s|%s|%s|%s", section, switch_str_nil(tag_name), switch_str_nil(key_name), switch_str_nil(key_value));
+
+	for (i = 0; i < RESULT_CACHE.key_param_count; i++) {
+		const char *val = params ? switch_event_get_header(params, RESULT_CACHE.key_params[i]) : NULL;
+		stream.write_function(&stream, "|%s", switch_str_nil(val));
+	}
+
+	return (char *) stream.data;
+}
+
+static switch_xml_t xml_result_cache_fetch(const char *section, switch_xml_section_t sections, const char *tag_name, const char *key_name,
+										   const char *key_value, switch_event_t *params)
+{
+	xml_result_cache_entry_t *entry;
+	switch_xml_t xml = NULL;
+	switch_time_t now = switch_micro_time_now();
+	const char *ttl_str;
+	uint32_t ttl;
+	char *key;
+
+	switch_mutex_lock(RESULT_CACHE.mutex);
+	key = xml_result_cache_key(section, tag_name, key_name, key_value, params);
+
+	if ((entry = switch_core_hash_find(RESULT_CACHE.hash, key))) {
+		if (entry->pending) {
+			RESULT_CACHE.coalesced++;
+
+			if (!entry->cond) {
+				switch_core_new_memory_pool(&entry->pool);
+				switch_thread_cond_create(&entry->cond, entry->pool);
+			}
+
+			entry->waiters++;
+			while (entry->pending) {
+				switch_thread_cond_wait(entry->cond, RESULT_CACHE.mutex);
+			}
+			entry->waiters--;
+			xml = xml_result_cache_take(entry);
+
+			if (entry->orphan && !entry->waiters) {
+				xml_result_cache_entry_free(entry);
+			}
+
+			goto end;
+		}
+
+		if (entry->expires > now) {
+			RESULT_CACHE.hits++;
+			xml = xml_result_cache_take(entry);
+			goto end;
+		}
+
+		RESULT_CACHE.expired++;
+		switch_core_hash_delete(RESULT_CACHE.hash, key);
+		xml_result_cache_entry_drop(entry);
+	}
+
+	RESULT_CACHE.misses++;
+	switch_zmalloc(entry, sizeof(*entry));
+	entry->pending = 1;
+	entry->section = sections;
+	switch_core_hash_insert(RESULT_CACHE.hash, key, entry);
+	ttl = RESULT_CACHE.ttl;
+	switch_mutex_unlock(RESULT_CACHE.mutex);
+
+	xml = xml_locate_bindings(section, sections, tag_name, key_name, key_value, params);
+
+	/* the backend may say how long its answer stays good */
+	if (xml && (ttl_str = switch_xml_attr(xml, "cache-ttl"))) {
+		ttl = atoi(ttl_str) > 0 ? (uint32_t) atoi(ttl_str) : 0;
+	}
+
+	if (xml) {
+		/* cache and callers share the document, the last switch_xml_free() releases it */
+		switch_set_flag(xml, SWITCH_XML_ROOT);
+		xml->refs = 2;
+	}
+
+	switch_mutex_lock(RESULT_CACHE.mutex);
+	entry->xml = xml;
+	entry->expires = switch_micro_time_now() + (switch_time_t) ttl * 1000000;
+	entry->pending = 0;
+
+	if (entry->cond) {
+		switch_thread_cond_broadcast(entry->cond);
+	}
+
+	if (!entry->orphan && (!xml || !ttl)) {
+		/* nothing worth keeping, only the waiters get this one */
+		switch_core_hash_delete(RESULT_CACHE.hash, key);
+		entry->orphan = 1;
+	}
+
+	if (entry->orphan && !entry->waiters) {
+		xml_result_cache_entry_free(entry);
+	}
+
+  end:
+	switch_mutex_unlock(RESULT_CACHE.mutex);
+	free(key);
+
+	return xml;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_xml_locate(const char *section,
+												  const char *tag_name,
+												  const char *key_name,
+												  const char *key_value,
+												  switch_xml_t *root, switch_xml_t *node, switch_event_t *params, switch_bool_t clone)
+{
+	switch_xml_t conf = NULL;
+	switch_xml_t tag = NULL;
+	switch_xml_t xml = NULL;
+	uint8_t loops = 0;
+	switch_xml_section_t sections = BINDINGS ? switch_xml_parse_section_string(section) : 0;
+
+	if (BINDINGS) {
+		if ((sections & RESULT_CACHE.sections & ~SWITCH_XML_SECTION_RESULT)) {
+			xml = xml_result_cache_fetch(section, sections, tag_name, key_name, key_value, params);
+		} else {
+			xml = xml_locate_bindings(section, sections, tag_name, key_name, key_value, params);
+		}
+	}
+
 	for (;;) {
 		if (!xml) {
 			if (!(xml = switch_xml_root())) {
@@ -1993,6 +2187,92 @@ SWITCH_DECLARE(uint32_t) switch_xml_clear_user_cache(const char *key, const char
 
 }
 
+SWITCH_DECLARE(uint32_t) switch_xml_clear_result_cache(const char *section)
+{
+	switch_hash_index_t *hi = NULL;
+	void *val;
+	const void *var;
+	xml_result_cache_entry_t *entry;
+	switch_xml_section_t sections = zstr(section) ? 0 : switch_xml_parse_section_string(section) & ~SWITCH_XML_SECTION_RESULT;
+	uint32_t r = 0;
+
+	if (!RESULT_CACHE.mutex) {
+		return 0;
+	}
+
+	switch_mutex_lock(RESULT_CACHE.mutex);
+	for (hi = switch_core_hash_first(RESULT_CACHE.hash); hi;) {
+		switch_core_hash_this(hi, &var, NULL, &val);
+		entry = (xml_result_cache_entry_t *) val;
+		hi = switch_core_hash_next(&hi);
+
+		if (sections && !(entry->section & sections)) {
+			continue;
+		}
+
+		switch_core_hash_delete(RESULT_CACHE.hash, var);
+		r += xml_result_cache_entry_drop(entry);
+	}
+	switch_mutex_unlock(RESULT_CACHE.mutex);
+
+	return r;
+}
+
+SWITCH_DECLARE(void) switch_xml_set_result_cache_sections(const char *sections)
+{
+	switch_mutex_lock(RESULT_CACHE.mutex);
+	RESULT_CACHE.sections = zstr(sections) ? 0 : switch_xml_parse_section_string(sections) & ~SWITCH_XML_SECTION_RESULT;
+	switch_mutex_unlock(RESULT_CACHE.mutex);
+}
+
+SWITCH_DECLARE(void) switch_xml_set_result_cache_ttl(uint32_t seconds)
+{
+	switch_mutex_lock(RESULT_CACHE.mutex);
+	RESULT_CACHE.ttl = seconds;
+	switch_mutex_unlock(RESULT_CACHE.mutex);
+}
+
+SWITCH_DECLARE(void) switch_xml_set_result_cache_key_params(const char *params)
+{
+	char *str = zstr(params) ? NULL : strdup(params);
+
+	switch_mutex_lock(RESULT_CACHE.mutex);
+	switch_safe_free(RESULT_CACHE.key_params_str);
+	RESULT_CACHE.key_params_str = str;
+	RESULT_CACHE.key_param_count = str ? switch_separate_string(str, ',', RESULT_CACHE.key_params, RESULT_CACHE_MAX_PARAMS) : 0;
+	switch_mutex_unlock(RESULT_CACHE.mutex);
+
+	/* keys built from the old list can never be hit again */
+	switch_xml_clear_result_cache(NULL);
+}
+
+SWITCH_DECLARE(void) switch_xml_result_cache_status(switch_stream_handle_t *stream)
+{
+	uint64_t hits, misses, coalesced, expired;
+	uint32_t entries = 0, pending = 0;
+	switch_hash_index_t *hi;
+	void *val;
+
+	switch_mutex_lock(RESULT_CACHE.mutex);
+	for (hi = switch_core_hash_first(RESULT_CACHE.hash); hi; hi = switch_core_hash_next(&hi)) {
+		switch_core_hash_this(hi, NULL, NULL, &val);
+		if (((xml_result_cache_entry_t *) val)->pending) {
+			pending++;
+		} else {
+			entries++;
+		}
+	}
+	hits = RESULT_CACHE.hits;
+	misses = RESULT_CACHE.misses;
+	coalesced = RESULT_CACHE.coalesced;
+	expired = RESULT_CACHE.expired;
+	switch_mutex_unlock(RESULT_CACHE.mutex);
+
+	stream->write_function(stream, "entries,pending,ttl,hits,misses,coalesced,expired\n");
+	stream->write_function(stream, "%u,%u,%u,%" SWITCH_UINT64_T_FMT ",%" SWITCH_UINT64_T_FMT ",%" SWITCH_UINT64_T_FMT ",%" SWITCH_UINT64_T_FMT "\n",
+						   entries, pending, RESULT_CACHE.ttl, hits, misses, coalesced, expired);
+}
+
 static switch_status_t switch_xml_locate_user_cache(const char *key, const char *user_name, const char *domain_name, switch_xml_t *user)
 {
 	char mega_key[1024];
@@ -2373,6 +2653,11 @@ SWITCH_DECLARE(switch_status_t) switch_xml_init(switch_memory_pool_t *pool, cons
 	switch_core_hash_init(&CACHE_HASH);
 	switch_core_hash_init(&CACHE_EXPIRES_HASH);
 
+	memset(&RESULT_CACHE, 0, sizeof(RESULT_CACHE));
+	switch_mutex_init(&RESULT_CACHE.mutex, SWITCH_MUTEX_NESTED, XML_MEMORY_POOL);
+	switch_core_hash_init(&RESULT_CACHE.hash);
+	switch_xml_set_result_cache_key_params(SWITCH_XML_RESULT_CACHE_KEY_PARAMS);
+
 	switch_thread_rwlock_create(&B_RWLOCK, XML_MEMORY_POOL);
 
 	assert(pool != NULL);
@@ -2407,6 +2692,10 @@ SWITCH_DECLARE(switch_status_t) switch_xml_destroy(void)
 
 	switch_core_hash_destroy(&CACHE_HASH);
 
+	switch_xml_clear_result_cache(NULL);
+	switch_core_hash_destroy(&RESULT_CACHE.hash);
+	switch_safe_free(RESULT_CACHE.key_params_str);
+
 	return status;
 }
 
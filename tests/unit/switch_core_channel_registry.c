@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <switch.h>
+#include <tap.h>
+
+#define MAX_LIVE 4
+
+/* stands in for the session table, the registry asks it which channels are alive */
+static const char *live[MAX_LIVE];
+
+static void live_set(const char *a, const char *b)
+{
+  memset(live, 0, sizeof(live));
+  live[0] = a;
+  live[1] = b;
+}
+
+static switch_status_t test_live(const char *uuid, switch_event_t **snapshot)
+{
+  int x;
+
+  for ( x = 0; x < MAX_LIVE; x++) {
+    if (live[x] && !strcmp(live[x], uuid)) {
+      if (snapshot) {
+        char name[128];
+
+        switch_snprintf(name, sizeof(name), "snapshot/%s", uuid);
+        switch_event_create(snapshot, SWITCH_EVENT_CHANNEL_CREATE);
+        switch_event_add_header_string(*snapshot, SWITCH_STACK_BOTTOM, "Unique-ID", uuid);
+        switch_event_add_header_string(*snapshot, SWITCH_STACK_BOTTOM, "Channel-Name", name);
+        switch_event_add_header_string(*snapshot, SWITCH_STACK_BOTTOM, "Channel-State", "CS_EXECUTE");
+      }
+      return SWITCH_STATUS_SUCCESS;
+    }
+  }
+
+  return SWITCH_STATUS_FALSE;
+}
+
+/* header name and value pairs after the uuid, NULL terminated */
+static void feed(switch_event_types_t id, const char *uuid, ...)
+{
+  switch_event_t *event = NULL;
+  const char *name, *val;
+  va_list ap;
+
+  switch_event_create(&event, id);
+  switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Unique-ID", uuid);
+
+  va_start(ap, uuid);
+  while ((name = va_arg(ap, const char *))) {
+    val = va_arg(ap, const char *);
+    switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, name, val);
+  }
+  va_end(ap);
+
+  switch_channel_registry_test_event(event);
+  switch_event_destroy(&event);
+}
+
+static void feed_create(const char *uuid)
+{
+  char name[128];
+
+  switch_snprintf(name, sizeof(name), "create/%s", uuid);
+  feed(SWITCH_EVENT_CHANNEL_CREATE, uuid, "Channel-Name", name, "Channel-State", "CS_NEW", NULL);
+}
+
+static void feed_state(const char *uuid, switch_channel_state_t state)
+{
+  char num[16];
+
+  switch_snprintf(num, sizeof(num), "%d", state);
+  feed(SWITCH_EVENT_CHANNEL_STATE, uuid, "Channel-State", switch_channel_state_name(state), "Channel-State-Number", num, NULL);
+}
+
+struct col_seen {
+  const char *col;
+  char val[128];
+};
+
+static int col_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+  struct col_seen *seen = (struct col_seen *) pArg;
+  int x;
+
+  for ( x = 0; x < argc; x++) {
+    if (!strcmp(columnNames[x], seen->col)) {
+      switch_copy_string(seen->val, switch_str_nil(argv[x]), sizeof(seen->val));
+    }
+  }
+
+  return 0;
+}
+
+/* one column of the row of uuid, "" when there is no such row */
+static const char *col_of(const char *uuid, const char *col, struct col_seen *seen)
+{
+  memset(seen, 0, sizeof(*seen));
+  seen->col = col;
+  switch_channel_registry_lookup("uuid", uuid, col_callback, seen);
+
+  return seen->val;
+}
+
+static uint32_t channels(void)
+{
+  return switch_channel_registry_count(SWITCH_CHANNEL_REGISTRY_CHANNELS);
+}
+
+static uint32_t bridged_calls(void)
+{
+  return switch_channel_registry_query(SWITCH_CHANNEL_REGISTRY_CALLS, NULL, SWITCH_TRUE, NULL, NULL);
+}
+
+int main () {
+  switch_memory_pool_t *pool = NULL;
+  struct col_seen seen;
+  const char *err = NULL;
+
+  plan(14);
+
+  if (!ok(switch_core_init(SCF_MINIMAL, SWITCH_TRUE, &err) == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+  switch_core_new_memory_pool(&pool);
+  switch_channel_registry_test_start(pool, test_live);
+
+  live_set("a1", "b1");
+  feed_create("a1");
+  ok(channels() == 1 && !strcmp(col_of("a1", "name", &seen), "create/a1"), "a create adds the channel");
+
+  feed_create("gone");
+  ok(channels() == 1 && !switch_channel_registry_lookup("uuid", "gone", NULL, NULL), "a create of a channel that is already gone is dropped");
+
+  feed_state("a1", CS_EXECUTE);
+  ok(!strcmp(col_of("a1", "state", &seen), "CS_EXECUTE"), "a state change updates the row");
+
+  feed_create("b1");
+  feed(SWITCH_EVENT_CHANNEL_BRIDGE, "a1", "Bridge-A-Unique-ID", "a1", "Bridge-B-Unique-ID", "b1", "Channel-Call-UUID", "a1", NULL);
+  ok(bridged_calls() == 1 && !strcmp(col_of("b1", "call_uuid", &seen), "a1"), "a bridge makes one call of the two channels");
+
+  /* the core renames a1 before the rename event gets here */
+  live_set("a2", "b1");
+  feed(SWITCH_EVENT_CHANNEL_UUID, "a2", "Old-Unique-ID", "a1", NULL);
+  ok(!switch_channel_registry_lookup("uuid", "a1", NULL, NULL) && !strcmp(col_of("a2", "name", &seen), "create/a1"),
+     "a rename moves the row to the new uuid");
+  ok(!strcmp(col_of("a2", "state", &seen), "CS_EXECUTE"), "and keeps what was set under the old one");
+  ok(bridged_calls() == 1 && !strcmp(col_of("b1", "call_uuid", &seen), "a2"),
+     "the call follows the rename");
+
+  feed(SWITCH_EVENT_CHANNEL_DESTROY, "a2", NULL);
+  ok(channels() == 1 && !bridged_calls(), "a destroy removes the renamed row and its call");
+  feed(SWITCH_EVENT_CHANNEL_DESTROY, "b1", NULL);
+  ok(channels() == 0, "and the other leg goes with its own destroy");
+
+  /* the rename is sharded by the new uuid and can overtake the create of the old one */
+  live_set("c2", NULL);
+  feed(SWITCH_EVENT_CHANNEL_UUID, "c2", "Old-Unique-ID", "c1", NULL);
+  feed_create("c1");
+  ok(channels() == 1 && !strcmp(col_of("c2", "name", &seen), "snapshot/c2"), "a rename that overtook its create builds the row from the live channel");
+  ok(!switch_channel_registry_lookup("uuid", "c1", NULL, NULL), "and the late create does not bring the old uuid back");
+
+  feed(SWITCH_EVENT_CHANNEL_DESTROY, "c2", NULL);
+  ok(channels() == 0, "the rebuilt row goes with the destroy of the new uuid");
+
+  live_set(NULL, NULL);
+  feed(SWITCH_EVENT_CHANNEL_UUID, "d2", "Old-Unique-ID", "d1", NULL);
+  ok(channels() == 0, "a rename of a channel that is already gone adds nothing");
+
+  switch_channel_registry_test_stop();
+  switch_core_destroy_memory_pool(&pool);
+
+  switch_core_destroy();
+
+  done_testing();
+}
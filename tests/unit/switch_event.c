@@ -4,6 +4,154 @@
 
 // #define BENCHMARK 1
 
+#define CHANNEL_HEADERS 150
+
+/* roughly the shape of a channel event: many headers, looked up, cloned and serialized */
+static void channel_event_build(switch_event_t **event, char **names)
+{
+  int x;
+
+  switch_event_create(event, SWITCH_EVENT_CHANNEL_CREATE);
+
+  for ( x = 0; x < CHANNEL_HEADERS; x++) {
+    switch_event_add_header_string(*event, SWITCH_STACK_BOTTOM, names[x], names[x]);
+  }
+}
+
+static void channel_event_checks(void)
+{
+  switch_event_t *event = NULL, *clone = NULL;
+  char *names[CHANNEL_HEADERS];
+  char *str = NULL;
+  int x, good = 1;
+#ifdef BENCHMARK
+  int y, rounds = 10000;
+  switch_time_t small_start_ts, small_end_ts;
+#endif
+
+  for ( x = 0; x < CHANNEL_HEADERS; x++) {
+    names[x] = switch_mprintf("variable_header_%d", x);
+  }
+
+#ifndef BENCHMARK
+  channel_event_build(&event, names);
+
+  for ( x = 0; x < CHANNEL_HEADERS; x++) {
+    if (strcmp(switch_str_nil(switch_event_get_header(event, names[x])), names[x])) {
+      good = 0;
+    }
+  }
+  ok(good, "all channel headers found");
+  is(switch_event_get_header(event, "VARIABLE_HEADER_20"), "variable_header_20", "header lookup ignores case");
+
+  switch_event_add_header_string(event, SWITCH_STACK_PUSH, "Array-Header", "a");
+  switch_event_add_header_string(event, SWITCH_STACK_PUSH, "Array-Header", "b");
+  switch_event_add_header_string(event, SWITCH_STACK_UNSHIFT, "Array-Header", "z");
+  is(switch_event_get_header_idx(event, "Array-Header", 0), "z", "unshift puts value first");
+  is(switch_event_get_header_idx(event, "Array-Header", 2), "b", "push puts value last");
+  is(switch_event_get_header(event, "Array-Header"), "ARRAY::z|:a|:b", "array value serialized");
+
+  switch_event_add_header_string(event, SWITCH_STACK_TOP, names[5], "top");
+  is(switch_event_get_header(event, names[5]), "top", "header added at top shadows older one");
+  switch_event_del_header_val(event, names[5], "top");
+  is(switch_event_get_header(event, names[5]), names[5], "older header visible again after delete");
+
+  switch_event_del_header(event, names[75]);
+  ok(switch_event_get_header(event, names[75]) == NULL, "deleted header is gone");
+  is(switch_event_get_header(event, names[76]), names[76], "neighbour of deleted header intact");
+
+  switch_event_rename_header(event, names[10], "Renamed-Header");
+  is(switch_event_get_header(event, "Renamed-Header"), names[10], "renamed header found by new name");
+  ok(switch_event_get_header(event, names[10]) == NULL, "renamed header not found by old name");
+
+  switch_event_dup(&clone, event);
+  is(switch_event_get_header(clone, names[CHANNEL_HEADERS - 1]), names[CHANNEL_HEADERS - 1], "dup carries headers");
+  is(switch_event_get_header_idx(clone, "Array-Header", 1), "a", "dup carries arrays");
+
+  switch_event_serialize(clone, &str, SWITCH_FALSE);
+  ok(str && strstr(str, "variable_header_149: variable_header_149"), "serialized event carries headers");
+  switch_safe_free(str);
+
+  switch_event_destroy(&clone);
+  switch_event_destroy(&event);
+#else
+  (void) good;
+
+  small_start_ts = switch_time_now();
+  for ( y = 0; y < rounds; y++) {
+    channel_event_build(&event, names);
+    switch_event_destroy(&event);
+  }
+  small_end_ts = switch_time_now();
+  note("channel event create/add/destroy: %.2f us per event\n", (small_end_ts - small_start_ts) / (double) rounds);
+
+  channel_event_build(&event, names);
+
+  small_start_ts = switch_time_now();
+  for ( y = 0; y < rounds; y++) {
+    for ( x = 0; x < CHANNEL_HEADERS; x++) {
+      if ( !switch_event_get_header(event, names[x])) {
+        fail("Failed to lookup event header value");
+      }
+    }
+  }
+  small_end_ts = switch_time_now();
+  note("channel event get_header: %.3f us per lookup\n", (small_end_ts - small_start_ts) / (double) (rounds * CHANNEL_HEADERS));
+
+  small_start_ts = switch_time_now();
+  for ( y = 0; y < rounds; y++) {
+    switch_event_dup(&clone, event);
+    switch_event_destroy(&clone);
+  }
+  small_end_ts = switch_time_now();
+  note("channel event dup: %.2f us per event\n", (small_end_ts - small_start_ts) / (double) rounds);
+
+  small_start_ts = switch_time_now();
+  for ( y = 0; y < rounds; y++) {
+    switch_event_serialize(event, &str, SWITCH_FALSE);
+    switch_safe_free(str);
+  }
+  small_end_ts = switch_time_now();
+  note("channel event serialize: %.2f us per event\n", (small_end_ts - small_start_ts) / (double) rounds);
+
+  switch_event_destroy(&event);
+#endif
+
+  for ( x = 0; x < CHANNEL_HEADERS; x++) {
+    free(names[x]);
+  }
+}
+
+/* what switch_event_fire does before handing the event to the subscribers */
+static void frozen_event_checks(void)
+{
+  switch_event_t *event = NULL, *ref = NULL;
+  const char *text;
+
+  switch_event_create(&event, SWITCH_EVENT_CHANNEL_STATE);
+  switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Unique-ID", "frozen-uuid");
+  event->flags |= EF_FROZEN;
+  switch_atomic_set(&event->refs, 1);
+
+  text = switch_event_get_rendered(event, SWITCH_EVENT_RENDER_PLAIN);
+  ok(text && strstr(text, "frozen-uuid"), "frozen event renders");
+  ok(switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Sole-Holder", "yes") == SWITCH_STATUS_SUCCESS, "sole holder may still change the event");
+  text = switch_event_get_rendered(event, SWITCH_EVENT_RENDER_PLAIN);
+  ok(text && strstr(text, "Sole-Holder"), "change by the sole holder drops the stale rendering");
+
+  ref = switch_event_ref(event);
+  ok(ref == event, "reference on a frozen event shares it");
+  ok(switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Shared-Write", "no") != SWITCH_STATUS_SUCCESS, "shared event refuses new headers");
+  ok(switch_event_del_header(event, "Unique-ID") != SWITCH_STATUS_SUCCESS, "shared event refuses header deletes");
+  ok(switch_event_set_body(event, "body") != SWITCH_STATUS_SUCCESS, "shared event refuses a body");
+  ok(switch_event_get_header(event, "Shared-Write") == NULL && switch_event_get_header(event, "Unique-ID"), "shared event left as it was");
+  ok(!strstr(switch_event_get_rendered(event, SWITCH_EVENT_RENDER_PLAIN), "Shared-Write"), "shared rendering left as it was");
+
+  switch_event_destroy(&ref);
+  ok(ref == NULL && switch_event_get_header(event, "Unique-ID"), "dropping one reference keeps the event");
+  switch_event_destroy(&event);
+}
+
 int main () {
   switch_event_t *event = NULL;
   switch_bool_t verbose = SWITCH_TRUE;
@@ -21,7 +169,7 @@ int main () {
 
   plan(2);
 #else
-  plan(2 + ( 2 * loops));
+  plan(2 + ( 2 * loops) + 14 + 10);
 #endif
 
   status = switch_core_init(SCF_MINIMAL, verbose, &err);
@@ -100,6 +248,11 @@ int main () {
   diag("switch_event Total %ldus / %d loops, %.2f us per loop, %.0f loops per second\n", 
        micro_total, loops, micro_per, rate_per_sec);
 
+  channel_event_checks();
+#ifndef BENCHMARK
+  frozen_event_checks();
+#endif
+
   switch_core_destroy();
 
   done_testing();
@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <switch.h>
+#include <g711.h>
+#include <tap.h>
+
+// #define BENCHMARK 1
+
+#define ALL_SAMPLES 65536
+
+static const char *kernel_names[] = { "scalar", "sse2", "avx2" };
+
+int main () {
+  switch_bool_t verbose = SWITCH_TRUE;
+  const char *err = NULL;
+  switch_status_t status = SWITCH_STATUS_SUCCESS;
+  int16_t *linear, *decoded;
+  uint8_t *encoded, codes[256], other[256];
+  int x, k, available = 0;
+#ifdef BENCHMARK
+  int loops = 2000;
+  switch_time_t small_start_ts, small_end_ts;
+#else
+  int mismatches;
+#endif
+
+#ifndef BENCHMARK
+  plan(6);
+#else
+  plan(1);
+#endif
+
+  status = switch_core_init(SCF_MINIMAL, verbose, &err);
+
+  if ( !ok( status == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+  linear = malloc(ALL_SAMPLES * sizeof(int16_t));
+  decoded = malloc(ALL_SAMPLES * sizeof(int16_t));
+  encoded = malloc(ALL_SAMPLES);
+
+  for ( x = 0; x < ALL_SAMPLES; x++) {
+    linear[x] = (int16_t) (x - 32768);
+  }
+
+  for ( x = 0; x < 256; x++) {
+    codes[x] = (uint8_t) x;
+  }
+
+  for ( k = 0; k < 3; k++) {
+    if (!g711_kernels_select(kernel_names[k])) {
+      available++;
+    }
+  }
+
+#ifndef BENCHMARK
+  /* every possible input through every kernel set, then again one in so the odd length runs the scalar tails
+     over the top of the range (32767, code 0xFF) */
+  for ( k = 0, mismatches = 0; k < available; k++) {
+    g711_kernels_select(kernel_names[k]);
+    linear_to_ulaw_block(encoded, linear, ALL_SAMPLES);
+    for ( x = 0; x < ALL_SAMPLES; x++) {
+      if (encoded[x] != linear_to_ulaw(linear[x])) mismatches++;
+    }
+    linear_to_ulaw_block(encoded, linear + 1, ALL_SAMPLES - 1);
+    for ( x = 0; x < ALL_SAMPLES - 1; x++) {
+      if (encoded[x] != linear_to_ulaw(linear[x + 1])) mismatches++;
+    }
+  }
+  ok(mismatches == 0, "u-law encode bit exact across %d kernel sets", available);
+
+  for ( k = 0, mismatches = 0; k < available; k++) {
+    g711_kernels_select(kernel_names[k]);
+    linear_to_alaw_block(encoded, linear, ALL_SAMPLES);
+    for ( x = 0; x < ALL_SAMPLES; x++) {
+      if (encoded[x] != linear_to_alaw(linear[x])) mismatches++;
+    }
+    linear_to_alaw_block(encoded, linear + 1, ALL_SAMPLES - 1);
+    for ( x = 0; x < ALL_SAMPLES - 1; x++) {
+      if (encoded[x] != linear_to_alaw(linear[x + 1])) mismatches++;
+    }
+  }
+  ok(mismatches == 0, "A-law encode bit exact across %d kernel sets", available);
+
+  for ( k = 0, mismatches = 0; k < available; k++) {
+    g711_kernels_select(kernel_names[k]);
+    ulaw_to_linear_block(decoded, codes, 256);
+    for ( x = 0; x < 256; x++) {
+      if (decoded[x] != ulaw_to_linear(codes[x])) mismatches++;
+    }
+    ulaw_to_linear_block(decoded, codes + 1, 255);
+    for ( x = 0; x < 255; x++) {
+      if (decoded[x] != ulaw_to_linear(codes[x + 1])) mismatches++;
+    }
+    alaw_to_linear_block(decoded, codes, 256);
+    for ( x = 0; x < 256; x++) {
+      if (decoded[x] != alaw_to_linear(codes[x])) mismatches++;
+    }
+    alaw_to_linear_block(decoded, codes + 1, 255);
+    for ( x = 0; x < 255; x++) {
+      if (decoded[x] != alaw_to_linear(codes[x + 1])) mismatches++;
+    }
+  }
+  ok(mismatches == 0, "decode bit exact across %d kernel sets", available);
+
+  ulaw_to_alaw_block(other, codes, 256);
+  for ( x = 0, mismatches = 0; x < 256; x++) {
+    if (other[x] != ulaw_to_alaw(codes[x])) mismatches++;
+  }
+  alaw_to_ulaw_block(other, codes, 256);
+  for ( x = 0; x < 256; x++) {
+    if (other[x] != alaw_to_ulaw(codes[x])) mismatches++;
+  }
+  ok(mismatches == 0, "direct transcode matches the G.711 tables");
+
+  ok(g711_kernels_select("auto") == 0 && g711_kernels_select("nonesuch") == -1, "kernel selection");
+#else
+  (void) other;
+  (void) codes;
+
+  for ( k = 0; k < available; k++) {
+    g711_kernels_select(kernel_names[k]);
+
+    small_start_ts = switch_time_now();
+    for ( x = 0; x < loops; x++) {
+      linear_to_ulaw_block(encoded, linear, ALL_SAMPLES);
+    }
+    small_end_ts = switch_time_now();
+    note("u-law encode %-6s: %6.1f Msamples/s\n", kernel_names[k], (double) loops * ALL_SAMPLES / (small_end_ts - small_start_ts));
+
+    small_start_ts = switch_time_now();
+    for ( x = 0; x < loops; x++) {
+      ulaw_to_linear_block(decoded, encoded, ALL_SAMPLES);
+    }
+    small_end_ts = switch_time_now();
+    note("u-law decode %-6s: %6.1f Msamples/s\n", kernel_names[k], (double) loops * ALL_SAMPLES / (small_end_ts - small_start_ts));
+
+    small_start_ts = switch_time_now();
+    for ( x = 0; x < loops; x++) {
+      linear_to_alaw_block(encoded, linear, ALL_SAMPLES);
+    }
+    small_end_ts = switch_time_now();
+    note("A-law encode %-6s: %6.1f Msamples/s\n", kernel_names[k], (double) loops * ALL_SAMPLES / (small_end_ts - small_start_ts));
+
+    small_start_ts = switch_time_now();
+    for ( x = 0; x < loops; x++) {
+      alaw_to_linear_block(decoded, encoded, ALL_SAMPLES);
+    }
+    small_end_ts = switch_time_now();
+    note("A-law decode %-6s: %6.1f Msamples/s\n", kernel_names[k], (double) loops * ALL_SAMPLES / (small_end_ts - small_start_ts));
+  }
+
+  small_start_ts = switch_time_now();
+  for ( x = 0; x < loops; x++) {
+    ulaw_to_alaw_block(encoded, encoded, ALL_SAMPLES);
+  }
+  small_end_ts = switch_time_now();
+  note("u-law to A-law direct : %6.1f Msamples/s\n", (double) loops * ALL_SAMPLES / (small_end_ts - small_start_ts));
+#endif
+
+  free(linear);
+  free(decoded);
+  free(encoded);
+
+  switch_core_destroy();
+
+  done_testing();
+}
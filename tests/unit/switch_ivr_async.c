@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <switch.h>
+#include <tap.h>
+
+#define FRAME_BYTES 320
+/* the smallest per recording limit the writer accepts */
+#define MAX_BUFFER (1024 * 16)
+
+/* the writer totals are only published through the status report */
+static int64_t writer_bytes_dropped(void)
+{
+  switch_stream_handle_t stream = { 0 };
+  int64_t dropped = -1;
+  char *p;
+
+  SWITCH_STANDARD_STREAM(stream);
+  switch_ivr_record_writer_status(&stream);
+
+  if ((p = strstr((char *) stream.data, "bytes-dropped: "))) {
+    dropped = strtoll(p + strlen("bytes-dropped: "), NULL, 10);
+  }
+
+  switch_safe_free(stream.data);
+
+  return dropped;
+}
+
+int main () {
+  switch_bool_t verbose = SWITCH_TRUE;
+  const char *err = NULL;
+  switch_status_t status = SWITCH_STATUS_SUCCESS;
+  switch_ivr_record_buffer_t *rb = NULL;
+  unsigned char frame[FRAME_BYTES] = { 0 }, drain[FRAME_BYTES];
+  switch_size_t accepted = 0, max;
+  switch_time_t warned = 0, rewarned = 0;
+  int64_t dropped_before;
+  int x, refused = 0;
+
+  plan(8);
+
+  status = switch_core_init(SCF_MINIMAL, verbose, &err);
+
+  if ( !ok( status == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+  max = switch_ivr_record_writer_set_max_buffer(MAX_BUFFER);
+
+  switch_ivr_record_buffer_create(&rb, max, "unit-test.wav");
+
+  dropped_before = writer_bytes_dropped();
+
+  /* fill it the way the per-recording thread path does when its thread is stalled */
+  for ( x = 0; x < 1000 && switch_ivr_record_buffer_write(rb, frame, FRAME_BYTES); x++) {
+    accepted += FRAME_BYTES;
+  }
+
+  ok(accepted > 0 && accepted <= max && switch_ivr_record_buffer_inuse(rb) == accepted,
+     "buffer takes %" SWITCH_SIZE_T_FMT " bytes up to its %" SWITCH_SIZE_T_FMT " byte limit", accepted, max);
+  ok(switch_ivr_record_buffer_dropped(rb, &warned) == FRAME_BYTES, "the write that did not fit is counted as dropped");
+
+  ok(warned != 0, "the first drop warns");
+
+  for ( x = 0; x < 100; x++) {
+    if (!switch_ivr_record_buffer_write(rb, frame, FRAME_BYTES)) {
+      refused++;
+    }
+  }
+
+  ok(refused == 100 && switch_ivr_record_buffer_dropped(rb, &rewarned) == 101 * FRAME_BYTES, "every write to a full buffer is refused and counted");
+  ok(writer_bytes_dropped() - dropped_before == 101 * FRAME_BYTES, "drops show up in the writer totals");
+  ok(rewarned == warned, "further drops inside the warning interval stay quiet");
+
+  ok(switch_ivr_record_buffer_read(rb, drain, FRAME_BYTES) == FRAME_BYTES && switch_ivr_record_buffer_write(rb, frame, FRAME_BYTES) &&
+     switch_ivr_record_buffer_dropped(rb, NULL) == 101 * FRAME_BYTES, "buffer accepts audio again once drained");
+
+  switch_ivr_record_buffer_destroy(&rb);
+
+  switch_core_destroy();
+
+  done_testing();
+}
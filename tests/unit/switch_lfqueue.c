@@ -0,0 +1,233 @@
+#include <stdio.h>
+#include <switch.h>
+#include <tap.h>
+
+// #define BENCHMARK 1
+
+#define MAX_PRODUCERS 4
+
+typedef enum {
+  QUEUE_APR,
+  QUEUE_MPSC,
+  QUEUE_SPSC
+} queue_kind_t;
+
+static const char *kind_names[] = { "switch_queue", "mpsc", "spsc" };
+
+typedef struct producer_s {
+  queue_kind_t kind;
+  void *queue;
+  uintptr_t id;
+  uint32_t count;
+} producer_t;
+
+/* entries carry the producer in the top byte and a 1 based sequence below it */
+static void *SWITCH_THREAD_FUNC producer_thread(switch_thread_t *thread, void *obj)
+{
+  producer_t *p = (producer_t *) obj;
+  uintptr_t x;
+
+  for ( x = 1; x <= p->count; x++) {
+    void *data = (void *) ((p->id << 24) | x);
+
+    switch (p->kind) {
+    case QUEUE_APR:
+      switch_queue_push((switch_queue_t *) p->queue, data);
+      break;
+    case QUEUE_MPSC:
+      switch_mpsc_queue_push((switch_mpsc_queue_t *) p->queue, data);
+      break;
+    case QUEUE_SPSC:
+      while (switch_spsc_queue_trypush((switch_spsc_queue_t *) p->queue, data) != SWITCH_STATUS_SUCCESS) {
+        switch_cond_next();
+      }
+      break;
+    }
+  }
+
+  return NULL;
+}
+
+/* producers push count entries each while this thread drains them, returns the number that arrived
+   out of order per producer and the wall time per entry in nanoseconds */
+static int run_queue(queue_kind_t kind, int producers, uint32_t count, double *ns_per_op)
+{
+  switch_memory_pool_t *pool = NULL;
+  switch_threadattr_t *thd_attr = NULL;
+  switch_thread_t *threads[MAX_PRODUCERS];
+  producer_t prod[MAX_PRODUCERS];
+  uint32_t last[MAX_PRODUCERS] = { 0 };
+  switch_time_t start, end;
+  switch_status_t st;
+  void *queue = NULL, *pop;
+  uint32_t got = 0, total = count * producers;
+  int x, bad = 0;
+
+  switch_core_new_memory_pool(&pool);
+
+  switch (kind) {
+  case QUEUE_APR:
+    switch_queue_create((switch_queue_t **) &queue, 256, pool);
+    break;
+  case QUEUE_MPSC:
+    switch_mpsc_queue_create((switch_mpsc_queue_t **) &queue, 256, pool);
+    break;
+  case QUEUE_SPSC:
+    switch_spsc_queue_create((switch_spsc_queue_t **) &queue, 256, pool);
+    break;
+  }
+
+  switch_threadattr_create(&thd_attr, pool);
+  switch_threadattr_stacksize_set(thd_attr, 128 * 1024);
+
+  start = switch_time_now();
+
+  for ( x = 0; x < producers; x++) {
+    prod[x].kind = kind;
+    prod[x].queue = queue;
+    prod[x].id = x;
+    prod[x].count = count;
+    switch_thread_create(&threads[x], thd_attr, producer_thread, &prod[x], pool);
+  }
+
+  while (got < total) {
+    switch (kind) {
+    case QUEUE_APR:
+      st = switch_queue_pop_timeout((switch_queue_t *) queue, &pop, 1000000);
+      break;
+    case QUEUE_MPSC:
+      st = switch_mpsc_queue_pop_timeout((switch_mpsc_queue_t *) queue, &pop, 1000000);
+      break;
+    default:
+      st = switch_spsc_queue_pop_timeout((switch_spsc_queue_t *) queue, &pop, 1000000);
+      break;
+    }
+
+    if (st != SWITCH_STATUS_SUCCESS) {
+      bad++;
+      break;
+    }
+
+    x = (int) ((uintptr_t) pop >> 24);
+
+    if (x >= producers || ((uintptr_t) pop & 0xffffff) != last[x] + 1) {
+      bad++;
+    } else {
+      last[x]++;
+    }
+    got++;
+  }
+
+  end = switch_time_now();
+
+  for ( x = 0; x < producers; x++) {
+    switch_thread_join(&st, threads[x]);
+  }
+
+  *ns_per_op = (end - start) * 1000.0 / total;
+
+  switch_core_destroy_memory_pool(&pool);
+
+  return bad;
+}
+
+int main () {
+  switch_bool_t verbose = SWITCH_TRUE;
+  const char *err = NULL;
+  switch_status_t status = SWITCH_STATUS_SUCCESS;
+  double ns;
+#ifdef BENCHMARK
+  int producers[] = { 1, 2, 4 };
+  int k, n;
+#else
+  switch_memory_pool_t *pool = NULL;
+  switch_mpsc_queue_t *mq;
+  switch_spsc_queue_t *sq;
+  switch_time_t start;
+  uintptr_t x;
+  void *pop;
+  int fifo = 1;
+#endif
+
+#ifndef BENCHMARK
+  plan(10);
+#else
+  plan(1);
+#endif
+
+  status = switch_core_init(SCF_MINIMAL, verbose, &err);
+
+  if ( !ok( status == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+#ifndef BENCHMARK
+  switch_core_new_memory_pool(&pool);
+
+  /* 5 rounds up to 8 */
+  switch_mpsc_queue_create(&mq, 5, pool);
+  for ( x = 1; x <= 8; x++) {
+    switch_mpsc_queue_trypush(mq, (void *) x);
+  }
+  ok(switch_mpsc_queue_size(mq) == 8 && switch_mpsc_queue_trypush(mq, (void *) x) == SWITCH_STATUS_FALSE, "mpsc rounds capacity up and refuses pushes when full");
+
+  /* go round the ring a few times so the sequence numbers wrap over the cells */
+  for ( x = 1; x <= 64; x++) {
+    if (switch_mpsc_queue_trypop(mq, &pop) != SWITCH_STATUS_SUCCESS || (uintptr_t) pop != x) {
+      fifo = 0;
+    }
+    switch_mpsc_queue_trypush(mq, (void *) (x + 8));
+  }
+  for ( x = 65; x <= 72; x++) {
+    if (switch_mpsc_queue_trypop(mq, &pop) != SWITCH_STATUS_SUCCESS || (uintptr_t) pop != x) {
+      fifo = 0;
+    }
+  }
+  ok(fifo && switch_mpsc_queue_trypop(mq, &pop) == SWITCH_STATUS_FALSE, "mpsc is fifo across wraps and empty afterwards");
+
+  start = switch_time_now();
+  status = switch_mpsc_queue_pop_timeout(mq, &pop, 20000);
+  ok(status == SWITCH_STATUS_TIMEOUT && switch_time_now() - start >= 19000, "mpsc pop times out on an empty queue");
+
+  switch_spsc_queue_create(&sq, 4, pool);
+  for ( x = 1; x <= 4; x++) {
+    switch_spsc_queue_trypush(sq, (void *) x);
+  }
+  ok(switch_spsc_queue_size(sq) == 4 && switch_spsc_queue_trypush(sq, (void *) x) == SWITCH_STATUS_FALSE, "spsc refuses pushes when full");
+
+  fifo = 1;
+  for ( x = 1; x <= 4; x++) {
+    if (switch_spsc_queue_pop_timeout(sq, &pop, 1000) != SWITCH_STATUS_SUCCESS || (uintptr_t) pop != x) {
+      fifo = 0;
+    }
+  }
+  ok(fifo && switch_spsc_queue_trypop(sq, &pop) == SWITCH_STATUS_FALSE, "spsc is fifo and empty afterwards");
+
+  switch_core_destroy_memory_pool(&pool);
+
+  ok(run_queue(QUEUE_MPSC, 1, 100000, &ns) == 0, "mpsc keeps order with one producer");
+  ok(run_queue(QUEUE_MPSC, MAX_PRODUCERS, 100000, &ns) == 0, "mpsc keeps per producer order with %d producers", MAX_PRODUCERS);
+  ok(run_queue(QUEUE_SPSC, 1, 100000, &ns) == 0, "spsc keeps order across threads");
+  ok(run_queue(QUEUE_APR, MAX_PRODUCERS, 10000, &ns) == 0, "switch_queue reference run");
+#else
+  for ( k = 0; k < 3; k++) {
+    for ( n = 0; n < 3; n++) {
+      if (k == QUEUE_SPSC && producers[n] > 1) {
+        continue;
+      }
+
+      if (run_queue((queue_kind_t) k, producers[n], 1000000, &ns)) {
+        note("%-12s %d producers: lost or reordered entries\n", kind_names[k], producers[n]);
+      } else {
+        note("%-12s %d producers: %7.1f ns per enqueue/dequeue\n", kind_names[k], producers[n], ns);
+      }
+    }
+  }
+#endif
+
+  (void) kind_names;
+
+  switch_core_destroy();
+
+  done_testing();
+}
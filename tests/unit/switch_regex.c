@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <switch.h>
+#include <tap.h>
+
+// #define BENCHMARK 1
+
+#define DIALPLAN_EXTENSIONS 500
+#define CALLERS 200
+#define DEEP_SUBJECT_LEN 2000
+
+/* one pass of a large dialplan: every extension's condition against every caller, like call setup does */
+static int replay_dialplan(char **expressions, char **callers, int rounds)
+{
+  int x, y, r, matches = 0;
+  int ovector[30];
+
+  for ( r = 0; r < rounds; r++) {
+    for ( y = 0; y < CALLERS; y++) {
+      for ( x = 0; x < DIALPLAN_EXTENSIONS; x++) {
+        switch_regex_t *re = NULL;
+
+        if (switch_regex_perform(callers[y], expressions[x], &re, ovector, sizeof(ovector) / sizeof(ovector[0])) > 0) {
+          matches++;
+        }
+        switch_regex_safe_free(re);
+      }
+    }
+  }
+
+  return matches;
+}
+
+int main () {
+  switch_bool_t verbose = SWITCH_TRUE;
+  const char *err = NULL;
+  switch_status_t status = SWITCH_STATUS_SUCCESS;
+  char *expressions[DIALPLAN_EXTENSIONS];
+  char *callers[CALLERS];
+  int x, cached, uncached;
+  int ovector[30];
+  switch_regex_t *re = NULL;
+  char substituted[256] = "";
+  switch_stream_handle_t stream = { 0 };
+  char *deep;
+#ifdef BENCHMARK
+  switch_time_t small_start_ts, small_end_ts;
+  int rounds = 10;
+#endif
+
+#ifndef BENCHMARK
+  plan(10);
+#else
+  plan(1);
+#endif
+
+  status = switch_core_init(SCF_MINIMAL, verbose, &err);
+
+  if ( !ok( status == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+  /* a mix of the shapes found in real dialplans */
+  for ( x = 0; x < DIALPLAN_EXTENSIONS; x++) {
+    switch (x % 4) {
+    case 0:
+      expressions[x] = switch_mprintf("^%d$", 1000 + x);
+      break;
+    case 1:
+      expressions[x] = switch_mprintf("^\\+?1?(%03d)(\\d{7})$", 200 + x);
+      break;
+    case 2:
+      expressions[x] = switch_mprintf("/^(conf|room)_%d$/i", x);
+      break;
+    default:
+      expressions[x] = switch_mprintf("_%dXXX", 10 + x % 90);
+      break;
+    }
+  }
+
+  for ( x = 0; x < CALLERS; x++) {
+    switch (x % 3) {
+    case 0:
+      callers[x] = switch_mprintf("%d", 1000 + (x * 7) % DIALPLAN_EXTENSIONS);
+      break;
+    case 1:
+      callers[x] = switch_mprintf("+1%03d555%04d", 200 + (x * 13) % DIALPLAN_EXTENSIONS, x);
+      break;
+    default:
+      callers[x] = switch_mprintf("CONF_%d", (x * 11) % DIALPLAN_EXTENSIONS);
+      break;
+    }
+  }
+
+#ifndef BENCHMARK
+  cached = replay_dialplan(expressions, callers, 1);
+  switch_regex_set_cache_size(0);
+  uncached = replay_dialplan(expressions, callers, 1);
+  switch_regex_set_cache_size(1024);
+
+  ok(cached > 0, "dialplan replay matched some callers");
+  ok(cached == uncached, "cached and uncached patterns agree");
+
+  ok(switch_regex_perform("+12125551234", "^\\+?1?(\\d{3})(\\d{7})$", &re, ovector, sizeof(ovector) / sizeof(ovector[0])) == 3, "captures counted");
+  switch_perform_substitution(re, 3, "$2-$1", "+12125551234", substituted, sizeof(substituted), ovector);
+  is(substituted, "5551234-212", "substitution from a cached pattern");
+  switch_regex_safe_free(re);
+
+  re = (switch_regex_t *) &stream;
+  ok(switch_regex_perform("bob", "^\\d+$", &re, ovector, sizeof(ovector) / sizeof(ovector[0])) == 0 && re == NULL, "miss hands back no regex");
+  re = (switch_regex_t *) &stream;
+  ok(switch_regex_perform("bob", "/^bob", &re, ovector, sizeof(ovector) / sizeof(ovector[0])) == 0 && re == NULL, "bad expression hands back no regex");
+  switch_regex_safe_free(re);
+
+  /* a backtrack deep enough to run the jit out of stack must still match, not read as a miss */
+  deep = malloc(DEEP_SUBJECT_LEN + 1);
+  memset(deep, 'a', DEEP_SUBJECT_LEN);
+  deep[DEEP_SUBJECT_LEN] = '\0';
+  ok(switch_regex_perform(deep, "^(a|b)*$", &re, ovector, sizeof(ovector) / sizeof(ovector[0])) == 2, "deep backtrack still matches");
+  switch_regex_safe_free(re);
+  ok(switch_regex_match(deep, "^(a|b)*$") == SWITCH_STATUS_SUCCESS, "deep backtrack still matches through switch_regex_match");
+  free(deep);
+
+  SWITCH_STANDARD_STREAM(stream);
+  switch_regex_cache_status(&stream);
+  ok(stream.data && strstr((char *) stream.data, "hit_rate"), "cache status reported");
+  switch_safe_free(stream.data);
+#else
+  (void) re;
+  (void) deep;
+  (void) ovector;
+  (void) substituted;
+  (void) stream;
+
+  switch_regex_set_cache_size(0);
+  small_start_ts = switch_time_now();
+  uncached = replay_dialplan(expressions, callers, rounds);
+  small_end_ts = switch_time_now();
+  note("dialplan replay uncached: %.3f us per condition (%d matches)\n",
+       (small_end_ts - small_start_ts) / (double) (rounds * CALLERS * DIALPLAN_EXTENSIONS), uncached);
+
+  switch_regex_set_cache_size(1024);
+  small_start_ts = switch_time_now();
+  cached = replay_dialplan(expressions, callers, rounds);
+  small_end_ts = switch_time_now();
+  note("dialplan replay cached: %.3f us per condition (%d matches)\n",
+       (small_end_ts - small_start_ts) / (double) (rounds * CALLERS * DIALPLAN_EXTENSIONS), cached);
+#endif
+
+  for ( x = 0; x < DIALPLAN_EXTENSIONS; x++) {
+    free(expressions[x]);
+  }
+
+  for ( x = 0; x < CALLERS; x++) {
+    free(callers[x]);
+  }
+
+  switch_core_destroy();
+
+  done_testing();
+}
@@ -0,0 +1,285 @@
+#include <stdio.h>
+#include <switch.h>
+#include <tap.h>
+
+// #define BENCHMARK 1
+
+#define MAX_MEMBERS 1000
+#define MAX_SAMPLES 960
+
+static const char *kernel_names[] = { "scalar", "sse2", "avx2" };
+
+/* one conference tick: sum everybody, then hand each member the mix without their own voice,
+   member x's share lands at out + x * samples */
+static void mix_tick(int16_t **frames, int members, uint32_t samples, int32_t *acc, int16_t *out)
+{
+  int x;
+
+  memset(acc, 0, samples * sizeof(*acc));
+
+  for ( x = 0; x < members; x++) {
+    switch_sln_accumulate(acc, frames[x], samples);
+  }
+
+  for ( x = 0; x < members; x++) {
+    switch_sln_mix_minus(out + x * samples, acc, frames[x], samples, samples);
+  }
+}
+
+/* run a second of 20ms blocks through a fresh resampler, returns the samples produced */
+static uint32_t resample_second(uint32_t from, uint32_t to, int16_t *in, int16_t *out, switch_audio_resampler_t **rp)
+{
+  switch_audio_resampler_t *resampler = NULL;
+  uint32_t x, total = 0;
+
+  switch_resample_create(&resampler, from, to, from / 50 * 2, SWITCH_RESAMPLE_QUALITY, 1);
+
+  for ( x = 0; x < 50; x++) {
+    switch_resample_process(resampler, in + x * (from / 50), from / 50);
+    memcpy(out + total, resampler->to, resampler->to_len * sizeof(int16_t));
+    total += resampler->to_len;
+  }
+
+  if (rp) {
+    *rp = resampler;
+  } else {
+    switch_resample_destroy(&resampler);
+  }
+
+  return total;
+}
+
+static void fill_noise(int16_t *data, uint32_t samples, uint32_t seed)
+{
+  uint32_t x;
+
+  for ( x = 0; x < samples; x++) {
+    seed = seed * 1103515245 + 12345;
+    data[x] = (int16_t) (seed >> 16);
+  }
+}
+
+int main () {
+  switch_bool_t verbose = SWITCH_TRUE;
+  const char *err = NULL;
+  switch_status_t status = SWITCH_STATUS_SUCCESS;
+  int16_t **frames;
+  int32_t acc[MAX_SAMPLES];
+  int16_t ref[MAX_SAMPLES * 2], out[MAX_SAMPLES * 2], other[MAX_SAMPLES * 2];
+  int16_t *mixed_ref, *mixed;
+  int x, k, available = 0;
+#ifdef BENCHMARK
+  int rates[] = { 8000, 16000, 48000 };
+  int sizes[] = { 10, 100, 1000 };
+  int r, n, loops = 200;
+  switch_time_t small_start_ts, small_end_ts;
+  int16_t *tone, *resampled;
+  switch_audio_resampler_t *resampler, *again;
+#else
+  int mismatches = 0, wrong = 0;
+  int vol;
+  uint32_t i;
+  int16_t *tone, *resampled;
+  switch_audio_resampler_t *resampler, *again;
+  switch_audio_resampler_t *resampler_was;
+  uint32_t produced, peak;
+#endif
+
+#ifndef BENCHMARK
+  plan(12);
+#else
+  plan(1);
+#endif
+
+  status = switch_core_init(SCF_MINIMAL, verbose, &err);
+
+  if ( !ok( status == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+  frames = malloc(MAX_MEMBERS * sizeof(*frames));
+
+  for ( x = 0; x < MAX_MEMBERS; x++) {
+    frames[x] = malloc(MAX_SAMPLES * sizeof(int16_t));
+    fill_noise(frames[x], MAX_SAMPLES, x + 1);
+  }
+
+  for ( k = 0; k < 3; k++) {
+    if (switch_sln_kernels_select(kernel_names[k]) == SWITCH_STATUS_SUCCESS) {
+      available++;
+    }
+  }
+
+  mixed_ref = malloc(MAX_MEMBERS * MAX_SAMPLES * sizeof(int16_t));
+  mixed = malloc(MAX_MEMBERS * MAX_SAMPLES * sizeof(int16_t));
+
+  tone = malloc(48000 * sizeof(int16_t));
+  resampled = malloc(48000 * 6 * sizeof(int16_t));
+
+  for ( x = 0; x < 48000; x++) {
+    tone[x] = (int16_t) (10000 * sin(2 * M_PI * 1000 * x / 48000.0));
+  }
+
+#ifndef BENCHMARK
+  /* odd lengths so the vector bodies and the scalar tails both get exercised */
+  ok(switch_sln_kernels_select("scalar") == SWITCH_STATUS_SUCCESS && !strcmp(switch_sln_kernels_name(), "scalar"), "scalar kernels selectable");
+
+  switch_sln_kernels_select("scalar");
+  mix_tick(frames, 50, 317, acc, mixed_ref);
+
+  /* every member gets everybody else, clamped to 16 bits */
+  for ( x = 0; x < 50; x++) {
+    for ( i = 0; i < 317; i++) {
+      int32_t want = acc[i] - frames[x][i];
+
+      switch_normalize_to_16bit(want);
+      if (mixed_ref[x * 317 + i] != want) {
+        wrong++;
+      }
+    }
+  }
+  ok(wrong == 0, "every member's mix-minus is the sum of the others, %d samples wrong", wrong);
+
+  for ( k = 1; k < available; k++) {
+    switch_sln_kernels_select(kernel_names[k]);
+    mix_tick(frames, 50, 317, acc, mixed);
+    for ( x = 0; x < 50; x++) {
+      if (memcmp(mixed_ref + x * 317, mixed + x * 317, 317 * sizeof(int16_t))) {
+        mismatches++;
+      }
+    }
+  }
+  ok(mismatches == 0, "mix-minus identical for all 50 members across %d kernel sets", available);
+
+  mismatches = 0;
+  for ( vol = -4; vol <= 4; vol++) {
+    switch_sln_kernels_select("scalar");
+    memcpy(ref, frames[7], 317 * sizeof(int16_t));
+    switch_change_sln_volume(ref, 317, vol);
+
+    for ( k = 1; k < available; k++) {
+      switch_sln_kernels_select(kernel_names[k]);
+      memcpy(out, frames[7], 317 * sizeof(int16_t));
+      switch_change_sln_volume(out, 317, vol);
+      if (memcmp(ref, out, 317 * sizeof(int16_t))) {
+        mismatches++;
+      }
+    }
+  }
+  ok(mismatches == 0, "volume identical across kernel sets");
+
+  switch_sln_kernels_select("auto");
+
+  ref[0] = 30000;
+  other[0] = 10000;
+  ref[1] = -30000;
+  other[1] = -10000;
+  switch_merge_sln(ref, 2, other, 2, 1);
+  ok(ref[0] == SWITCH_SMAX && ref[1] == SWITCH_SMIN, "merge saturates");
+
+  for ( x = 0; x < 101; x++) {
+    ref[x * 2] = (int16_t) x;
+    ref[x * 2 + 1] = (int16_t) (x * 3);
+  }
+  switch_mux_channels(ref, 101, 2, 1);
+  for ( x = 0, mismatches = 0; x < 101; x++) {
+    if (ref[x] != x * 4) {
+      mismatches++;
+    }
+  }
+  ok(mismatches == 0, "stereo folds down to mono");
+
+  switch_mux_channels(ref, 101, 1, 2);
+  for ( x = 0, mismatches = 0; x < 101; x++) {
+    if (ref[x * 2] != x * 4 || ref[x * 2 + 1] != x * 4) {
+      mismatches++;
+    }
+  }
+  ok(mismatches == 0, "mono expands to stereo in place");
+
+  /* 8k of the 48k tone is still a 1kHz tone, 6x up must give exactly 6x the samples at the same level */
+  for ( x = 0; x < 8000; x++) {
+    resampled[x] = tone[x * 6];
+  }
+  memcpy(tone, resampled, 8000 * sizeof(int16_t));
+  produced = resample_second(8000, 48000, tone, resampled, &resampler);
+  for ( x = 24000, peak = 0; x < 48000; x++) {
+    if ((uint32_t) abs(resampled[x]) > peak) peak = abs(resampled[x]);
+  }
+  ok(resampler->polyphase && produced == 48000 && peak > 9800 && peak < 10200, "8k to 48k goes polyphase, %u samples, peak %u", produced, peak);
+  resampler_was = resampler;
+
+  switch_resample_destroy(&resampler);
+  switch_resample_create(&again, 8000, 48000, 320, SWITCH_RESAMPLE_QUALITY, 1);
+  ok(again == resampler_was, "a destroyed resampler is handed out again from the pool");
+  switch_resample_destroy(&again);
+
+  switch_resample_set_polyphase(SWITCH_FALSE);
+  switch_resample_create(&resampler, 8000, 48000, 320, SWITCH_RESAMPLE_QUALITY, 1);
+  ok(resampler->resampler && !resampler->polyphase, "speex is used with polyphase turned off");
+  switch_resample_destroy(&resampler);
+  switch_resample_set_polyphase(SWITCH_TRUE);
+
+  produced = resample_second(48000 / 6, 48000 / 6 / 2, tone, resampled, NULL);
+  ok(produced == 4000, "8k to 4k decimates to exactly half, %u samples", produced);
+#else
+  (void) other;
+  (void) out;
+
+  for ( r = 0; r < 3; r++) {
+    uint32_t samples = rates[r] / 50;
+
+    for ( n = 0; n < 3; n++) {
+      for ( k = 0; k < available; k++) {
+        switch_sln_kernels_select(kernel_names[k]);
+
+        small_start_ts = switch_time_now();
+        for ( x = 0; x < loops; x++) {
+          mix_tick(frames, sizes[n], samples, acc, mixed);
+        }
+        small_end_ts = switch_time_now();
+
+        note("mix %4d members at %5dhz %-6s: %8.1f us per 20ms tick\n", sizes[n], rates[r], kernel_names[k],
+             (small_end_ts - small_start_ts) / (double) loops);
+      }
+    }
+  }
+
+  for ( r = 0; r < 6; r++) {
+    uint32_t from[] = { 8000, 8000, 16000, 16000, 48000, 48000 };
+    uint32_t to[] = { 16000, 48000, 48000, 8000, 8000, 16000 };
+
+    for ( k = 0; k < 2; k++) {
+      switch_resample_set_polyphase(k ? SWITCH_TRUE : SWITCH_FALSE);
+
+      small_start_ts = switch_time_now();
+      for ( x = 0; x < 20; x++) {
+        resample_second(from[r], to[r], tone, resampled, NULL);
+      }
+      small_end_ts = switch_time_now();
+
+      note("resample %5d to %5d %-9s: %6.2f us per 20ms frame\n", from[r], to[r], k ? "polyphase" : "speex",
+           (small_end_ts - small_start_ts) / (20.0 * 50));
+    }
+  }
+
+  switch_resample_set_polyphase(SWITCH_TRUE);
+  (void) resampler;
+  (void) again;
+  (void) ref;
+#endif
+
+  free(tone);
+  free(resampled);
+  free(mixed_ref);
+  free(mixed);
+
+  for ( x = 0; x < MAX_MEMBERS; x++) {
+    free(frames[x]);
+  }
+  free(frames);
+
+  switch_core_destroy();
+
+  done_testing();
+}
@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <switch.h>
+#include <tap.h>
+
+// #define BENCHMARK 1
+
+#define TIMER_INTERVAL 20
+
+typedef struct bench_timer_s {
+  switch_memory_pool_t *pool;
+  int ticks;
+  int32_t *jitter;
+  int done;
+} bench_timer_t;
+
+static int cmp_int32(const void *a, const void *b)
+{
+  int32_t x = *(const int32_t *) a, y = *(const int32_t *) b;
+
+  return x < y ? -1 : x > y;
+}
+
+/* one session worth of timer: wait for each tick and record how far from the interval it landed */
+static void *SWITCH_THREAD_FUNC timer_thread(switch_thread_t *thread, void *obj)
+{
+  bench_timer_t *bt = (bench_timer_t *) obj;
+  switch_timer_t timer = { 0 };
+  switch_time_t last, now;
+  int x;
+
+  if (switch_core_timer_init(&timer, "soft", TIMER_INTERVAL, 160, bt->pool) != SWITCH_STATUS_SUCCESS) {
+    return NULL;
+  }
+
+  switch_core_timer_next(&timer);
+  last = switch_time_now();
+
+  for ( x = 0; x < bt->ticks; x++) {
+    switch_core_timer_next(&timer);
+    now = switch_time_now();
+    bt->jitter[x] = (int32_t) ((now - last) - TIMER_INTERVAL * 1000);
+    last = now;
+  }
+
+  switch_core_timer_destroy(&timer);
+  bt->done = 1;
+
+  return NULL;
+}
+
+/* runs count timers side by side, returns the p50/p99/p999 of the absolute jitter in microseconds */
+static int run_timers(int count, int ticks, int32_t *p50, int32_t *p99, int32_t *p999)
+{
+  switch_memory_pool_t *pool = NULL;
+  switch_threadattr_t *thd_attr = NULL;
+  switch_thread_t **threads;
+  bench_timer_t *timers;
+  int32_t *all;
+  switch_status_t st;
+  int x, y, done = 0;
+  size_t n = 0;
+
+  switch_core_new_memory_pool(&pool);
+  threads = switch_core_alloc(pool, sizeof(*threads) * count);
+  timers = switch_core_alloc(pool, sizeof(*timers) * count);
+  all = malloc(sizeof(int32_t) * count * ticks);
+
+  switch_threadattr_create(&thd_attr, pool);
+  switch_threadattr_stacksize_set(thd_attr, 128 * 1024);
+
+  for ( x = 0; x < count; x++) {
+    timers[x].pool = pool;
+    timers[x].ticks = ticks;
+    timers[x].jitter = switch_core_alloc(pool, sizeof(int32_t) * ticks);
+    switch_thread_create(&threads[x], thd_attr, timer_thread, &timers[x], pool);
+  }
+
+  for ( x = 0; x < count; x++) {
+    switch_thread_join(&st, threads[x]);
+    if (timers[x].done) {
+      done++;
+      for ( y = 0; y < ticks; y++) {
+        all[n++] = abs(timers[x].jitter[y]);
+      }
+    }
+  }
+
+  if (n) {
+    qsort(all, n, sizeof(int32_t), cmp_int32);
+    *p50 = all[n / 2];
+    *p99 = all[(n * 99) / 100];
+    *p999 = all[(n * 999) / 1000];
+  }
+
+  free(all);
+  switch_core_destroy_memory_pool(&pool);
+
+  return done;
+}
+
+int main () {
+  switch_bool_t verbose = SWITCH_TRUE;
+  const char *err = NULL;
+  switch_status_t status = SWITCH_STATUS_SUCCESS;
+  int32_t p50 = 0, p99 = 0, p999 = 0;
+  int done;
+#ifdef BENCHMARK
+  int counts[] = { 1000, 5000, 20000 };
+  int x, wheel;
+#endif
+
+#ifndef BENCHMARK
+  plan(5);
+#else
+  plan(2);
+#endif
+
+  status = switch_core_init(SCF_MINIMAL, verbose, &err);
+
+  if ( !ok( status == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+  switch_loadable_module_init(SWITCH_FALSE);
+  status = switch_loadable_module_load_module("", "CORE_SOFTTIMER_MODULE", SWITCH_FALSE, &err);
+
+  if ( !ok( status == SWITCH_STATUS_SUCCESS, "Load the soft timer\n")) {
+    bail_out(0, "Bail due to failure to load the soft timer[%s]", err);
+  }
+
+#ifndef BENCHMARK
+  switch_time_set_wheel(SWITCH_TRUE);
+
+  done = run_timers(50, 25, &p50, &p99, &p999);
+  ok(done == 50, "every wheel timer ran to the end");
+  ok(p50 < TIMER_INTERVAL * 1000, "median wheel jitter stays under one interval");
+  diag("wheel jitter p50 %dus p99 %dus p99.9 %dus\n", p50, p99, p999);
+
+  switch_time_set_wheel(SWITCH_FALSE);
+
+  done = run_timers(50, 25, &p50, &p99, &p999);
+  ok(done == 50, "every default soft timer ran to the end");
+#else
+  (void) done;
+
+  /* timer bench: wake-up jitter with and without the wheel */
+  for ( wheel = 0; wheel < 2; wheel++) {
+    switch_time_set_wheel(wheel ? SWITCH_TRUE : SWITCH_FALSE);
+
+    for ( x = 0; x < (int) (sizeof(counts) / sizeof(counts[0])); x++) {
+      done = run_timers(counts[x], 250, &p50, &p99, &p999);
+      note("%s %5d timers (%d ran): jitter p50 %6dus p99 %6dus p99.9 %6dus\n",
+           wheel ? "wheel  " : "default", counts[x], done, p50, p99, p999);
+    }
+  }
+
+  switch_time_set_wheel(SWITCH_FALSE);
+#endif
+
+  switch_core_destroy();
+
+  done_testing();
+}
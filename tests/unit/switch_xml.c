@@ -0,0 +1,206 @@
+#include <stdio.h>
+#include <switch.h>
+#include <tap.h>
+
+#define LOOKUP_THREADS 4
+#define STRESS_THREADS 8
+
+static switch_mutex_t *gate_mutex;
+static switch_thread_cond_t *gate_cond;
+static int gate_open = 1;
+static int backend_ttl = 60;
+static int backend_delay_ms = 0;
+static volatile switch_atomic_t backend_calls = 0;
+
+/* a binding that can be held up so lookups pile up behind the fetch in flight */
+static switch_xml_t backend(const char *section, const char *tag_name, const char *key_name, const char *key_value, switch_event_t *params,
+                            void *user_data)
+{
+  char *text;
+
+  switch_atomic_inc(&backend_calls);
+
+  switch_mutex_lock(gate_mutex);
+  while (!gate_open) {
+    switch_thread_cond_wait(gate_cond, gate_mutex);
+  }
+  switch_mutex_unlock(gate_mutex);
+
+  if (backend_delay_ms) {
+    switch_yield(backend_delay_ms * 1000);
+  }
+
+  text = switch_mprintf("<document type=\"freeswitch/xml\" cache-ttl=\"%d\"><section name=\"directory\"><domain name=\"%s\"/></section></document>",
+                        backend_ttl, key_value);
+
+  return switch_xml_parse_str_dynamic(text, SWITCH_FALSE);
+}
+
+static void cache_counters(uint32_t *entries, uint64_t *coalesced, uint64_t *expired)
+{
+  switch_stream_handle_t stream = { 0 };
+  unsigned int e = 0, p = 0, ttl = 0;
+  unsigned long long hits = 0, misses = 0, c = 0, x = 0;
+  char *line;
+
+  SWITCH_STANDARD_STREAM(stream);
+  switch_xml_result_cache_status(&stream);
+
+  if ((line = strchr((char *) stream.data, '\n'))) {
+    sscanf(line + 1, "%u,%u,%u,%llu,%llu,%llu,%llu", &e, &p, &ttl, &hits, &misses, &c, &x);
+  }
+
+  *entries = e;
+  *coalesced = c;
+  *expired = x;
+  free(stream.data);
+}
+
+typedef struct {
+  const char *domain;
+  switch_time_t until;
+  int flush;
+  int good;
+  int bad;
+} lookup_t;
+
+static void *SWITCH_THREAD_FUNC lookup_thread(switch_thread_t *thread, void *obj)
+{
+  lookup_t *lookup = (lookup_t *) obj;
+
+  do {
+    switch_xml_t root = NULL, node = NULL;
+
+    if (switch_xml_locate("directory", "domain", "name", lookup->domain, &root, &node, NULL, SWITCH_FALSE) == SWITCH_STATUS_SUCCESS &&
+        !strcmp(switch_xml_attr_soft(node, "name"), lookup->domain)) {
+      lookup->good++;
+    } else {
+      lookup->bad++;
+    }
+
+    switch_xml_free(root);
+
+    if (lookup->flush) {
+      switch_xml_clear_result_cache("directory");
+    }
+  } while (switch_time_now() < lookup->until);
+
+  return NULL;
+}
+
+static void run_lookups(switch_memory_pool_t *pool, lookup_t *lookups, switch_thread_t **threads, int count)
+{
+  switch_threadattr_t *thd_attr = NULL;
+  int x;
+
+  switch_threadattr_create(&thd_attr, pool);
+
+  for (x = 0; x < count; x++) {
+    switch_thread_create(&threads[x], thd_attr, lookup_thread, &lookups[x], pool);
+  }
+}
+
+static void join_lookups(lookup_t *lookups, switch_thread_t **threads, int count, int *good, int *bad)
+{
+  switch_status_t st;
+  int x;
+
+  *good = *bad = 0;
+
+  for (x = 0; x < count; x++) {
+    switch_thread_join(&st, threads[x]);
+    *good += lookups[x].good;
+    *bad += lookups[x].bad;
+  }
+}
+
+int main () {
+  switch_memory_pool_t *pool = NULL;
+  switch_thread_t *threads[STRESS_THREADS];
+  lookup_t lookups[STRESS_THREADS];
+  uint64_t coalesced = 0, expired = 0;
+  uint32_t entries = 0;
+  int x, good = 0, bad = 0, stress_good, stress_bad, tries;
+  const char *err = NULL;
+
+  plan(7);
+
+  if (!ok(switch_core_init(SCF_MINIMAL, SWITCH_TRUE, &err) == SWITCH_STATUS_SUCCESS, "Initialize FreeSWITCH core\n")) {
+    bail_out(0, "Bail due to failure to initialize FreeSWITCH[%s]", err);
+  }
+
+  switch_core_new_memory_pool(&pool);
+  switch_mutex_init(&gate_mutex, SWITCH_MUTEX_NESTED, pool);
+  switch_thread_cond_create(&gate_cond, pool);
+
+  switch_xml_bind_search_function(backend, switch_xml_parse_section_string("directory"), NULL);
+  switch_xml_set_result_cache_sections("directory");
+
+  /* flush while every lookup is parked behind the fetch in flight */
+  gate_open = 0;
+  memset(lookups, 0, sizeof(lookups));
+  for (x = 0; x < LOOKUP_THREADS; x++) {
+    lookups[x].domain = "waiting.example.com";
+  }
+  run_lookups(pool, lookups, threads, LOOKUP_THREADS);
+
+  for (tries = 0; tries < 5000; tries++) {
+    cache_counters(&entries, &coalesced, &expired);
+    if (switch_atomic_read(&backend_calls) == 1 && coalesced == LOOKUP_THREADS - 1) {
+      break;
+    }
+    switch_yield(1000);
+  }
+
+  ok(coalesced == LOOKUP_THREADS - 1, "identical lookups wait for the fetch in flight");
+  ok(switch_xml_clear_result_cache("directory") == 0, "flush leaves the pending entry to its fetcher and waiters");
+
+  switch_mutex_lock(gate_mutex);
+  gate_open = 1;
+  switch_thread_cond_broadcast(gate_cond);
+  switch_mutex_unlock(gate_mutex);
+
+  join_lookups(lookups, threads, LOOKUP_THREADS, &good, &bad);
+  cache_counters(&entries, &coalesced, &expired);
+  ok(good == LOOKUP_THREADS && bad == 0, "every waiter gets the flushed document");
+  ok(switch_atomic_read(&backend_calls) == 1 && entries == 0, "one fetch served them all and nothing was kept");
+
+  /* short lived documents, every refetch has waiters that wake up around expiries */
+  backend_ttl = 1;
+  backend_delay_ms = 5;
+  memset(lookups, 0, sizeof(lookups));
+  for (x = 0; x < STRESS_THREADS; x++) {
+    lookups[x].domain = "expiring.example.com";
+    lookups[x].until = switch_time_now() + 2500000;
+  }
+  run_lookups(pool, lookups, threads, STRESS_THREADS);
+  join_lookups(lookups, threads, STRESS_THREADS, &good, &bad);
+  cache_counters(&entries, &coalesced, &expired);
+
+  ok(expired > 0 && coalesced > LOOKUP_THREADS - 1, "entries expired and refetches were coalesced under load");
+
+  /* and flushes racing them */
+  memset(lookups, 0, sizeof(lookups));
+  for (x = 0; x < STRESS_THREADS; x++) {
+    lookups[x].domain = "expiring.example.com";
+    lookups[x].until = switch_time_now() + 500000;
+    lookups[x].flush = (x == 0);
+  }
+  run_lookups(pool, lookups, threads, STRESS_THREADS);
+  stress_good = good;
+  stress_bad = bad;
+  join_lookups(lookups, threads, STRESS_THREADS, &good, &bad);
+  good += stress_good;
+  bad += stress_bad;
+
+  ok(good > 0 && bad == 0, "every lookup got its document while entries expired and were flushed");
+
+  note("xml result cache: %d lookups, %u backend calls, %" SWITCH_UINT64_T_FMT " coalesced, %" SWITCH_UINT64_T_FMT " expired\n",
+       good, switch_atomic_read(&backend_calls), coalesced, expired);
+
+  switch_xml_unbind_search_function_ptr(backend);
+  switch_core_destroy_memory_pool(&pool);
+  switch_core_destroy();
+
+  done_testing();
+}
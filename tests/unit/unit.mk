@@ -15,3 +15,58 @@ tests_unit_switch_hash_CFLAGS = $(SWITCH_AM_CFLAGS)
 tests_unit_switch_hash_LDADD = $(FSLD)
 tests_unit_switch_hash_LDFLAGS = $(SWITCH_AM_LDFLAGS) -ltap
 
+check_PROGRAMS += tests/unit/switch_regex
+
+tests_unit_switch_regex_SOURCES = tests/unit/switch_regex.c
+tests_unit_switch_regex_CFLAGS = $(SWITCH_AM_CFLAGS)
+tests_unit_switch_regex_LDADD = $(FSLD)
+tests_unit_switch_regex_LDFLAGS = $(SWITCH_AM_LDFLAGS) -ltap
+
+check_PROGRAMS += tests/unit/switch_time
+
+tests_unit_switch_time_SOURCES = tests/unit/switch_time.c
+tests_unit_switch_time_CFLAGS = $(SWITCH_AM_CFLAGS)
+tests_unit_switch_time_LDADD = $(FSLD)
+tests_unit_switch_time_LDFLAGS = $(SWITCH_AM_LDFLAGS) -ltap
+
+check_PROGRAMS += tests/unit/switch_resample
+
+tests_unit_switch_resample_SOURCES = tests/unit/switch_resample.c
+tests_unit_switch_resample_CFLAGS = $(SWITCH_AM_CFLAGS)
+tests_unit_switch_resample_LDADD = $(FSLD)
+tests_unit_switch_resample_LDFLAGS = $(SWITCH_AM_LDFLAGS) -ltap
+
+check_PROGRAMS += tests/unit/switch_g711
+
+tests_unit_switch_g711_SOURCES = tests/unit/switch_g711.c
+tests_unit_switch_g711_CFLAGS = $(SWITCH_AM_CFLAGS)
+tests_unit_switch_g711_LDADD = $(FSLD)
+tests_unit_switch_g711_LDFLAGS = $(SWITCH_AM_LDFLAGS) -ltap
+
+check_PROGRAMS += tests/unit/switch_lfqueue
+
+tests_unit_switch_lfqueue_SOURCES = tests/unit/switch_lfqueue.c
+tests_unit_switch_lfqueue_CFLAGS = $(SWITCH_AM_CFLAGS)
+tests_unit_switch_lfqueue_LDADD = $(FSLD)
+tests_unit_switch_lfqueue_LDFLAGS = $(SWITCH_AM_LDFLAGS) -ltap
+
+check_PROGRAMS += tests/unit/switch_xml
+
+tests_unit_switch_xml_SOURCES = tests/unit/switch_xml.c
+tests_unit_switch_xml_CFLAGS = $(SWITCH_AM_CFLAGS)
+tests_unit_switch_xml_LDADD = $(FSLD)
+tests_unit_switch_xml_LDFLAGS = $(SWITCH_AM_LDFLAGS) -ltap
+
+check_PROGRAMS += tests/unit/switch_ivr_async
+
+tests_unit_switch_ivr_async_SOURCES = tests/unit/switch_ivr_async.c
+tests_unit_switch_ivr_async_CFLAGS = $(SWITCH_AM_CFLAGS)
+tests_unit_switch_ivr_async_LDADD = $(FSLD)
+tests_unit_switch_ivr_async_LDFLAGS = $(SWITCH_AM_LDFLAGS) -ltap
+
+check_PROGRAMS += tests/unit/switch_core_channel_registry
+
+tests_unit_switch_core_channel_registry_SOURCES = tests/unit/switch_core_channel_registry.c
+tests_unit_switch_core_channel_registry_CFLAGS = $(SWITCH_AM_CFLAGS)
+tests_unit_switch_core_channel_registry_LDADD = $(FSLD)
+tests_unit_switch_core_channel_registry_LDFLAGS = $(SWITCH_AM_LDFLAGS) -ltap